@@ -21,6 +21,7 @@
 #include "resource.h"
 
 #define FIND_LINE_BUFFER_SIZE 4096
+#define FIND_FILE_BUFFER_SIZE 65536
 
 static BOOL bInvertSearch = FALSE;
 static BOOL bCountLines = FALSE;
@@ -28,60 +29,94 @@ static BOOL bDisplayLineNumbers = FALSE;
 static BOOL bIgnoreCase = FALSE;
 static BOOL bDoNotSkipOfflineFiles = FALSE;
 
+/*
+ * The string to search for, upper-cased when case has to be ignored, and
+ * its Boyer-Moore-Horspool skip table. The table is indexed by the low byte
+ * of the characters, the characters sharing it get the smallest skip.
+ */
+static PWSTR pszSearch = NULL;
+static SIZE_T cchSearch = 0;
+static SIZE_T SkipTable[256];
+
+/**
+ * @name PrepareSearch
+ * @implemented
+ *
+ * Builds the search string and its skip table.
+ *
+ * @param[in] pszSearchString
+ *     The NULL-terminated string to search for.
+ *
+ * @return
+ *     TRUE if successful, FALSE if there is not enough memory.
+ */
+static BOOL
+PrepareSearch(
+    IN PCWSTR pszSearchString)
+{
+    SIZE_T i;
+
+    cchSearch = wcslen(pszSearchString);
+    pszSearch = malloc((cchSearch + 1) * sizeof(WCHAR));
+    if (pszSearch == NULL)
+        return FALSE;
+
+    StringCchCopyW(pszSearch, cchSearch + 1, pszSearchString);
+    if (bIgnoreCase && cchSearch > 0)
+    {
+        LCMapStringW(GetThreadLocale(), LCMAP_UPPERCASE,
+                     pszSearchString, (INT)cchSearch, pszSearch, (INT)cchSearch);
+    }
+
+    for (i = 0; i < _countof(SkipTable); ++i)
+        SkipTable[i] = cchSearch;
+    for (i = 0; i + 1 < cchSearch; ++i)
+        SkipTable[pszSearch[i] & 0xFF] = cchSearch - 1 - i;
+
+    return TRUE;
+}
+
 /**
  * @name StrStrCase
  * @implemented
  *
- * Locates a substring inside a NULL-terminated wide string.
+ * Locates the search string inside a wide string, using the
+ * Boyer-Moore-Horspool algorithm.
  *
  * @param[in] pszStr
- *     The NULL-terminated string to be scanned.
- *
- * @param[in] pszSearch
- *     The NULL-terminated string to search for.
+ *     The string to be scanned, upper-cased if case has to be ignored.
  *
- * @param[in] bIgnoreCase
- *     TRUE if case has to be ignored, FALSE otherwise.
+ * @param[in] cchStr
+ *     The length of pszStr, in characters.
  *
  * @return
- *     Returns a pointer to the first occurrence of pszSearch in pszStr,
- *     or NULL if pszSearch does not appear in pszStr. If pszSearch points
- *     to a string of zero length, the function returns pszStr.
+ *     Returns a pointer to the first occurrence of the search string in
+ *     pszStr, or NULL if it does not appear in pszStr. If the search
+ *     string is of zero length, the function returns pszStr.
  */
-static PWSTR
+static PCWSTR
 StrStrCase(
     IN PCWSTR pszStr,
-    IN PCWSTR pszSearch,
-    IN BOOL bIgnoreCase)
+    IN SIZE_T cchStr)
 {
-    if (bIgnoreCase)
-    {
-        LCID LocaleId;
-        INT i, cch1, cch2;
-
-        LocaleId = GetThreadLocale();
+    SIZE_T i = 0, last;
+    WCHAR ch;
 
-        cch1 = wcslen(pszStr);
-        cch2 = wcslen(pszSearch);
+    if (cchSearch == 0)
+        return pszStr;
 
-        if (cch2 == 0)
-            return (PWSTR)pszStr;
-
-        for (i = 0; i <= cch1 - cch2; ++i)
+    last = cchSearch - 1;
+    while (cchStr >= cchSearch && i <= cchStr - cchSearch)
+    {
+        ch = pszStr[i + last];
+        if (ch == pszSearch[last] &&
+            wmemcmp(pszStr + i, pszSearch, last) == 0)
         {
-            if (CompareStringW(LocaleId /* LOCALE_SYSTEM_DEFAULT */,
-                               NORM_IGNORECASE /* | NORM_LINGUISTIC_CASING */,
-                               pszStr + i, cch2, pszSearch, cch2) == CSTR_EQUAL)
-            {
-                return (PWSTR)(pszStr + i);
-            }
+            return pszStr + i;
         }
-        return NULL;
-    }
-    else
-    {
-        return wcsstr(pszStr, pszSearch);
+        i += SkipTable[ch & 0xFF];
     }
+    return NULL;
 }
 
 /**
@@ -96,23 +131,22 @@ StrStrCase(
  * @param[in] pszFilePath
  *     The file name to print out. Can be NULL.
  *
- * @param[in] pszSearchString
- *     The NULL-terminated string to search for.
- *
  * @return
  *     0 if the string was found at least once, 1 otherwise.
  */
 static int
 FindString(
     IN FILE* pStream,
-    IN PCWSTR pszFilePath OPTIONAL,
-    IN PCWSTR pszSearchString)
+    IN PCWSTR pszFilePath OPTIONAL)
 {
     LONG lLineCount = 0;
     LONG lLineNumber = 0;
     BOOL bSubstringFound;
     int iReturnValue = 1;
+    INT cchLine;
+    LCID LocaleId = GetThreadLocale();
     WCHAR szLineBuffer[FIND_LINE_BUFFER_SIZE];
+    WCHAR szUpperBuffer[FIND_LINE_BUFFER_SIZE];
 
     if (pszFilePath != NULL)
     {
@@ -127,7 +161,19 @@ FindString(
     {
         ++lLineNumber;
 
-        bSubstringFound = (StrStrCase(szLineBuffer, pszSearchString, bIgnoreCase) != NULL);
+        cchLine = (INT)wcslen(szLineBuffer);
+        if (bIgnoreCase && cchLine > 0)
+        {
+            /* Compare the upper-cased line with the upper-cased search string */
+            cchLine = LCMapStringW(LocaleId, LCMAP_UPPERCASE,
+                                   szLineBuffer, cchLine,
+                                   szUpperBuffer, _countof(szUpperBuffer));
+            bSubstringFound = (StrStrCase(szUpperBuffer, cchLine) != NULL);
+        }
+        else
+        {
+            bSubstringFound = (StrStrCase(szLineBuffer, cchLine) != NULL);
+        }
 
         /* Check if this line can be counted */
         if (bSubstringFound != bInvertSearch)
@@ -252,6 +298,9 @@ int wmain(int argc, WCHAR* argv[])
         return 2;
     }
 
+    if (!PrepareSearch(argv[iSearchedStringIndex]))
+        return 2;
+
     if (bFoundFileParameter)
     {
         /* After the command line arguments were parsed, iterate through them again to get the filenames */
@@ -319,8 +368,11 @@ int wmain(int argc, WCHAR* argv[])
                     continue;
                 }
 
+                /* Read the file by large blocks */
+                setvbuf(pOpenedFile, NULL, _IOFBF, FIND_FILE_BUFFER_SIZE);
+
                 /* NOTE: Convert the file path to uppercase for formatting */
-                if (FindString(pOpenedFile, _wcsupr(szFullFilePath), argv[iSearchedStringIndex]) == 0)
+                if (FindString(pOpenedFile, _wcsupr(szFullFilePath)) == 0)
                 {
                     iReturnValue = 0;
                 }
@@ -337,8 +389,10 @@ int wmain(int argc, WCHAR* argv[])
     }
     else
     {
-        iReturnValue = FindString(stdin, NULL, argv[iSearchedStringIndex]);
+        iReturnValue = FindString(stdin, NULL);
     }
 
+    free(pszSearch);
+
     return iReturnValue;
 }
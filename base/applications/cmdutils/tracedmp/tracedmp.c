@@ -0,0 +1,343 @@
+/*
+ * PROJECT:         ReactOS Trace Dump Utility
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            base/applications/cmdutils/tracedmp/tracedmp.c
+ * PURPOSE:         Dumps the events of a trace log file or of a real-time trace session
+ * PROGRAMMERS:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <windef.h>
+#include <winbase.h>
+#include <winioctl.h>
+#include <wmistr.h>
+#include <evntrace.h>
+#include <wmiioctl.h>
+
+typedef struct _SESSION_PROPERTIES
+{
+    EVENT_TRACE_PROPERTIES Properties;
+    WCHAR LoggerName[WMI_MAX_LOGGER_NAME];
+    WCHAR LogFileName[MAX_PATH];
+} SESSION_PROPERTIES, *PSESSION_PROPERTIES;
+
+typedef struct _BUFFER_ENTRY
+{
+    ULONG SequenceNumber;
+    LARGE_INTEGER FileOffset;
+} BUFFER_ENTRY, *PBUFFER_ENTRY;
+
+static LONGLONG FirstTimeStamp = -1;
+static LONGLONG Frequency;
+static ULONG EventCount;
+static ULONG DataBytes = 16;
+
+static void Usage(void)
+{
+    wprintf(L"Dumps the events of a trace log file or of a real-time trace session.\n\n"
+            L"TRACEDMP [/d bytes] logfile\n"
+            L"TRACEDMP [/d bytes] /rt session\n"
+            L"TRACEDMP /l\n\n"
+            L"  logfile     Log file written by a trace session.\n"
+            L"  /rt session Reads the buffers of a real-time session until it stops.\n"
+            L"  /d bytes    Number of data bytes to print for each event (default 16).\n"
+            L"  /l          Lists the running trace sessions.\n");
+}
+
+static void DumpEvent(PEVENT_TRACE_HEADER Header, USHORT ProcessorNumber)
+{
+    PUCHAR Data = (PUCHAR)(Header + 1);
+    ULONG Length = Header->Size - sizeof(EVENT_TRACE_HEADER);
+    LONGLONG Time;
+    ULONG i;
+
+    if (FirstTimeStamp < 0)
+        FirstTimeStamp = Header->TimeStamp.QuadPart;
+
+    /* Microseconds since the first event, or raw ticks if the clock rate is unknown */
+    Time = Header->TimeStamp.QuadPart - FirstTimeStamp;
+    if (Frequency)
+        Time = Time * 1000000 / Frequency;
+
+    wprintf(L"%12I64d %2u %5lu %5lu "
+            L"{%08lx-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x} "
+            L"%s %3u %3u %3u %5lu",
+            Time, ProcessorNumber, Header->ProcessId, Header->ThreadId,
+            Header->Guid.Data1, Header->Guid.Data2, Header->Guid.Data3,
+            Header->Guid.Data4[0], Header->Guid.Data4[1], Header->Guid.Data4[2],
+            Header->Guid.Data4[3], Header->Guid.Data4[4], Header->Guid.Data4[5],
+            Header->Guid.Data4[6], Header->Guid.Data4[7],
+            Header->HeaderType == WMI_HEADER_TYPE_MESSAGE ? L"msg" : L"evt",
+            Header->Class.Type, Header->Class.Level, Header->Class.Version, Length);
+
+    for (i = 0; i < Length && i < DataBytes; i++)
+        wprintf(L"%s%02x", i ? L" " : L"  ", Data[i]);
+    if (Length > DataBytes)
+        wprintf(L" ...");
+    wprintf(L"\n");
+
+    EventCount++;
+}
+
+static BOOL DumpBuffer(PWMI_TRACE_BUFFER_HEADER Buffer, ULONG BufferSize)
+{
+    PEVENT_TRACE_HEADER Header;
+    ULONG Offset, End;
+
+    if (Buffer->BufferSize != BufferSize || Buffer->SavedOffset > BufferSize)
+    {
+        fwprintf(stderr, L"Corrupted buffer %lu\n", Buffer->SequenceNumber);
+        return FALSE;
+    }
+
+    End = Buffer->SavedOffset;
+    for (Offset = sizeof(WMI_TRACE_BUFFER_HEADER); Offset + sizeof(EVENT_TRACE_HEADER) <= End; )
+    {
+        Header = (PEVENT_TRACE_HEADER)((PUCHAR)Buffer + Offset);
+        if (Header->Size < sizeof(EVENT_TRACE_HEADER) || Offset + Header->Size > End)
+        {
+            fwprintf(stderr, L"Corrupted event at offset %lu of buffer %lu\n",
+                     Offset, Buffer->SequenceNumber);
+            return FALSE;
+        }
+
+        DumpEvent(Header, Buffer->ProcessorNumber);
+        Offset += (Header->Size + WMI_TRACE_ALIGNMENT - 1) & ~(WMI_TRACE_ALIGNMENT - 1);
+    }
+
+    return TRUE;
+}
+
+static int __cdecl CompareBuffers(const void *p1, const void *p2)
+{
+    const BUFFER_ENTRY *Entry1 = p1, *Entry2 = p2;
+
+    if (Entry1->SequenceNumber == Entry2->SequenceNumber)
+        return 0;
+    return Entry1->SequenceNumber < Entry2->SequenceNumber ? -1 : 1;
+}
+
+static BOOL ReadAt(HANDLE hFile, LARGE_INTEGER Offset, PVOID Buffer, ULONG Length)
+{
+    DWORD dwRead;
+
+    if (!SetFilePointerEx(hFile, Offset, NULL, FILE_BEGIN))
+        return FALSE;
+    return ReadFile(hFile, Buffer, Length, &dwRead, NULL) && dwRead == Length;
+}
+
+static int DumpLogFile(PCWSTR FileName)
+{
+    WMI_LOGFILE_HEADER LogHeader;
+    WMI_TRACE_BUFFER_HEADER BufferHeader;
+    PBUFFER_ENTRY Entries = NULL;
+    PWMI_TRACE_BUFFER_HEADER Buffer = NULL;
+    LARGE_INTEGER FileSize, Offset;
+    ULONG Count = 0, MaxCount, i;
+    HANDLE hFile;
+    int ret = 1;
+
+    hFile = CreateFileW(FileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        fwprintf(stderr, L"Cannot open %s: error %lu\n", FileName, GetLastError());
+        return 1;
+    }
+
+    Offset.QuadPart = 0;
+    if (!GetFileSizeEx(hFile, &FileSize) ||
+        !ReadAt(hFile, Offset, &LogHeader, sizeof(LogHeader)) ||
+        LogHeader.Signature != WMI_LOGFILE_SIGNATURE ||
+        LogHeader.Version != WMI_LOGFILE_VERSION ||
+        LogHeader.BufferSize < sizeof(WMI_TRACE_BUFFER_HEADER))
+    {
+        fwprintf(stderr, L"%s is not a trace log file\n", FileName);
+        goto Quit;
+    }
+
+    LogHeader.LoggerName[WMI_MAX_LOGGER_NAME - 1] = UNICODE_NULL;
+    wprintf(L"Session:    %s\n", LogHeader.LoggerName);
+    wprintf(L"Buffers:    %lu bytes, %lu written, %lu lost\n",
+            LogHeader.BufferSize, LogHeader.BuffersWritten, LogHeader.BuffersLost);
+    wprintf(L"Events:     %lu lost\n", LogHeader.EventsLost);
+    wprintf(L"Processors: %lu, clock type %lu, frequency %I64d\n\n",
+            LogHeader.NumberOfProcessors, LogHeader.ClockType, LogHeader.PerfFreq.QuadPart);
+    Frequency = LogHeader.PerfFreq.QuadPart;
+
+    /* Circular logs wrap around, sort the buffers in the order they were written */
+    MaxCount = (ULONG)(FileSize.QuadPart / LogHeader.BufferSize);
+    Entries = malloc(max(MaxCount, 1) * sizeof(BUFFER_ENTRY));
+    Buffer = malloc(LogHeader.BufferSize);
+    if (!Entries || !Buffer)
+    {
+        fwprintf(stderr, L"Out of memory\n");
+        goto Quit;
+    }
+
+    for (Offset.QuadPart = LogHeader.BufferSize;
+         Offset.QuadPart + LogHeader.BufferSize <= FileSize.QuadPart;
+         Offset.QuadPart += LogHeader.BufferSize)
+    {
+        if (!ReadAt(hFile, Offset, &BufferHeader, sizeof(BufferHeader)))
+            break;
+        if (BufferHeader.BufferSize != LogHeader.BufferSize)
+            continue;
+
+        Entries[Count].SequenceNumber = BufferHeader.SequenceNumber;
+        Entries[Count].FileOffset = Offset;
+        Count++;
+    }
+    qsort(Entries, Count, sizeof(BUFFER_ENTRY), CompareBuffers);
+
+    wprintf(L"        Time CPU  PID   TID  Guid                                   "
+            L"Typ Cls Lvl Ver  Size  Data\n");
+    for (i = 0; i < Count; i++)
+    {
+        if (!ReadAt(hFile, Entries[i].FileOffset, Buffer, LogHeader.BufferSize))
+            break;
+        DumpBuffer(Buffer, LogHeader.BufferSize);
+    }
+
+    wprintf(L"\n%lu events in %lu buffers\n", EventCount, Count);
+    ret = 0;
+
+Quit:
+    free(Buffer);
+    free(Entries);
+    CloseHandle(hFile);
+    return ret;
+}
+
+static int DumpRealTime(PCWSTR SessionName)
+{
+    SESSION_PROPERTIES Query;
+    PWMI_TRACE_BUFFER_HEADER Buffer;
+    ULONG BufferSize, Error, Buffers = 0;
+    ULONG64 LoggerHandle;
+    LARGE_INTEGER Counter;
+    DWORD dwReturned;
+    HANDLE hDevice;
+
+    ZeroMemory(&Query, sizeof(Query));
+    Query.Properties.Wnode.BufferSize = sizeof(Query);
+    Query.Properties.LoggerNameOffset = FIELD_OFFSET(SESSION_PROPERTIES, LoggerName);
+    Error = QueryTraceW(0, SessionName, &Query.Properties);
+    if (Error != ERROR_SUCCESS)
+    {
+        fwprintf(stderr, L"Cannot query session %s: error %lu\n", SessionName, Error);
+        return 1;
+    }
+
+    if (!(Query.Properties.LogFileMode & EVENT_TRACE_REAL_TIME_MODE))
+    {
+        fwprintf(stderr, L"%s is not a real-time session\n", SessionName);
+        return 1;
+    }
+
+    hDevice = CreateFileW(L"\\\\.\\WMIDataDevice", GENERIC_READ | GENERIC_WRITE,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hDevice == INVALID_HANDLE_VALUE)
+    {
+        fwprintf(stderr, L"Cannot open the WMI device: error %lu\n", GetLastError());
+        return 1;
+    }
+
+    BufferSize = Query.Properties.BufferSize * 1024;
+    LoggerHandle = Query.Properties.Wnode.HistoricalContext;
+    Buffer = malloc(BufferSize);
+    if (!Buffer)
+    {
+        CloseHandle(hDevice);
+        return 1;
+    }
+
+    /* Real-time sessions use the performance counter unless told otherwise */
+    if (Query.Properties.Wnode.ClientContext == 2)
+        Frequency = 10 * 1000 * 1000;
+    else if (Query.Properties.Wnode.ClientContext != 3 && QueryPerformanceFrequency(&Counter))
+        Frequency = Counter.QuadPart;
+
+    wprintf(L"        Time CPU  PID   TID  Guid                                   "
+            L"Typ Cls Lvl Ver  Size  Data\n");
+
+    /* The read returns nothing when no buffer was delivered for a while, and fails once the session stops */
+    while (DeviceIoControl(hDevice, IOCTL_WMI_READ_LOGGER_BUFFER,
+                           &LoggerHandle, sizeof(LoggerHandle),
+                           Buffer, BufferSize, &dwReturned, NULL))
+    {
+        if (dwReturned == 0)
+            continue;
+
+        DumpBuffer(Buffer, BufferSize);
+        Buffers++;
+    }
+
+    wprintf(L"\n%lu events in %lu buffers\n", EventCount, Buffers);
+
+    free(Buffer);
+    CloseHandle(hDevice);
+    return 0;
+}
+
+static int ListSessions(void)
+{
+    static SESSION_PROPERTIES Sessions[WMI_MAX_LOGGERS];
+    PEVENT_TRACE_PROPERTIES Properties[WMI_MAX_LOGGERS];
+    ULONG Count, Error, i;
+
+    ZeroMemory(Sessions, sizeof(Sessions));
+    for (i = 0; i < WMI_MAX_LOGGERS; i++)
+    {
+        Sessions[i].Properties.Wnode.BufferSize = sizeof(Sessions[i]);
+        Sessions[i].Properties.LoggerNameOffset = FIELD_OFFSET(SESSION_PROPERTIES, LoggerName);
+        Sessions[i].Properties.LogFileNameOffset = FIELD_OFFSET(SESSION_PROPERTIES, LogFileName);
+        Properties[i] = &Sessions[i].Properties;
+    }
+
+    Error = QueryAllTracesW(Properties, WMI_MAX_LOGGERS, &Count);
+    if (Error != ERROR_SUCCESS)
+    {
+        fwprintf(stderr, L"Cannot query the trace sessions: error %lu\n", Error);
+        return 1;
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        wprintf(L"%-32s %2lu buffers, %3lu free, %6lu written, %lu events lost  %s\n",
+                Sessions[i].LoggerName,
+                Sessions[i].Properties.NumberOfBuffers,
+                Sessions[i].Properties.FreeBuffers,
+                Sessions[i].Properties.BuffersWritten,
+                Sessions[i].Properties.EventsLost,
+                (Sessions[i].Properties.LogFileMode & EVENT_TRACE_REAL_TIME_MODE) ?
+                    L"(real-time)" : Sessions[i].LogFileName);
+    }
+
+    return 0;
+}
+
+int wmain(int argc, WCHAR *argv[])
+{
+    int i = 1;
+
+    if (argc >= 3 && _wcsicmp(argv[i], L"/d") == 0)
+    {
+        DataBytes = wcstoul(argv[i + 1], NULL, 0);
+        i += 2;
+    }
+
+    if (argc - i == 1 && _wcsicmp(argv[i], L"/l") == 0)
+        return ListSessions();
+
+    if (argc - i == 2 && _wcsicmp(argv[i], L"/rt") == 0)
+        return DumpRealTime(argv[i + 1]);
+
+    if (argc - i == 1 && argv[i][0] != L'/')
+        return DumpLogFile(argv[i]);
+
+    Usage();
+    return 1;
+}
@@ -59,6 +59,23 @@ typedef struct _EXCLUDELIST
   WCHAR               *name;
 } EXCLUDELIST;
 
+#define COPY_QUEUED   0
+#define COPY_DONE     1
+#define COPY_FAILED   2
+#define COPY_DROPPED  3
+
+typedef struct _COPYITEM
+{
+  struct _COPYITEM *next;                /* In the queue of copies to do  */
+  struct _COPYITEM *nextResult;          /* In the source order           */
+  DWORD             srcAttribs;
+  DWORD             flags;
+  DWORD             status;              /* COPY_xxx                      */
+  DWORD             error;
+  WCHAR             from[MAX_PATH];
+  WCHAR             to[MAX_PATH];
+} COPYITEM;
+
 
 /* Global variables */
 static ULONG filesCopied           = 0;              /* Number of files copied  */
@@ -75,6 +92,26 @@ static const WCHAR wchr_dotdot[]  = {'.', '.', 0};
 static WCHAR copyFrom[MAX_PATH];
 static WCHAR copyTo[MAX_PATH];
 
+/* When recursing, files smaller than SMALL_FILE_SIZE are handed to worker
+   threads, so that many of them are opened and copied at the same time.
+   Their names and errors are printed in the source order once they are
+   done, up to MAX_QUEUED of them being in flight                          */
+#define SMALL_FILE_SIZE  (256 * 1024)
+#define MAX_WORKERS      8
+#define MAX_QUEUED       256
+
+static CRITICAL_SECTION queueLock;                  /* Protects the queue  */
+static COPYITEM *queueHead         = NULL;          /* Copies to be done   */
+static COPYITEM *queueTail         = NULL;
+static COPYITEM *resultHead        = NULL;          /* Copies not reported */
+static COPYITEM *resultTail        = NULL;
+static DWORD     resultCount       = 0;
+static HANDLE    queueItems        = NULL;          /* Counts queued items */
+static HANDLE    copyDone          = NULL;          /* Set on each result  */
+static BOOL      queueCancelled    = FALSE;         /* A copy failed       */
+static HANDLE    workers[MAX_WORKERS];
+static DWORD     workerCount       = 0;
+
 
 /* =========================================================================
  * Load a string from the resource file, handling any error
@@ -334,6 +371,239 @@ static BOOL XCOPY_ProcessExcludeList(WCHAR* parms) {
     return FALSE;
 }
 
+/* =========================================================================
+ * Update the attributes of a file which has just been copied, and count it
+ * ========================================================================= */
+static void XCOPY_CopyDone(const WCHAR *from, const WCHAR *to,
+                           DWORD srcAttribs, DWORD flags) {
+
+    /* If keeping attributes, update the destination attributes
+       otherwise remove the read only attribute                 */
+    if (flags & OPT_KEEPATTRS) {
+        SetFileAttributesW(to, srcAttribs | FILE_ATTRIBUTE_ARCHIVE);
+    } else {
+        SetFileAttributesW(to,
+                 (GetFileAttributesW(to) & ~FILE_ATTRIBUTE_READONLY));
+    }
+
+    /* If /M supplied, remove the archive bit after successful copy */
+    if ((srcAttribs & FILE_ATTRIBUTE_ARCHIVE) &&
+        (flags & OPT_REMOVEARCH)) {
+        SetFileAttributesW(from, (srcAttribs & ~FILE_ATTRIBUTE_ARCHIVE));
+    }
+    InterlockedIncrement((LONG *)&filesCopied);
+}
+
+/* =========================================================================
+ * Print the name of a file being copied, as requested by the flags
+ * ========================================================================= */
+static void XCOPY_ShowCopy(const WCHAR *from, const WCHAR *to, DWORD flags) {
+
+    if (flags & OPT_QUIET) {
+        /* Skip message */
+    } else if (flags & OPT_FULL) {
+        const WCHAR infostr[]   = {'%', '1', ' ', '-', '>', ' ',
+                                   '%', '2', '\n', 0};
+
+        XCOPY_wprintf(infostr, from, to);
+    } else {
+        const WCHAR infostr[] = {'%', '1', '\n', 0};
+        XCOPY_wprintf(infostr, from);
+    }
+}
+
+/* =========================================================================
+ * Worker thread, copying the files queued by XCOPY_QueueCopy until it
+ * finds the queue empty. The results are left to XCOPY_ReportCopies, as
+ * only the main thread writes to the console. Unless /C was supplied, the
+ * first failure cancels the copies still queued
+ * ========================================================================= */
+static DWORD WINAPI XCOPY_CopyWorker(void *param) {
+
+    for (;;) {
+        COPYITEM *item;
+        BOOL cancelled;
+        DWORD status, error = 0;
+
+        WaitForSingleObject(queueItems, INFINITE);
+        EnterCriticalSection(&queueLock);
+        item = queueHead;
+        if (item) {
+            queueHead = item->next;
+            if (!queueHead) queueTail = NULL;
+        }
+        cancelled = queueCancelled;
+        LeaveCriticalSection(&queueLock);
+
+        /* XCOPY_StopWorkers wakes us up with nothing left to do */
+        if (!item) break;
+
+        if (cancelled) {
+            /* The serial copy would have stopped before this file */
+            status = COPY_DROPPED;
+        } else if (CopyFileW(item->from, item->to, FALSE)) {
+            XCOPY_CopyDone(item->from, item->to, item->srcAttribs, item->flags);
+            status = COPY_DONE;
+        } else {
+            error = GetLastError();
+            status = COPY_FAILED;
+        }
+
+        EnterCriticalSection(&queueLock);
+        item->status = status;
+        item->error = error;
+        if (status == COPY_FAILED && !(item->flags & OPT_IGNOREERRORS))
+            queueCancelled = TRUE;
+        LeaveCriticalSection(&queueLock);
+        SetEvent(copyDone);
+    }
+    return 0;
+}
+
+/* =========================================================================
+ * Start the worker threads. If none can be started, all the files are
+ * copied by the main thread
+ * ========================================================================= */
+static void XCOPY_StartWorkers(void) {
+
+    SYSTEM_INFO info;
+    DWORD count;
+
+    /* The copies mostly wait for the disk, so use more threads than CPUs */
+    GetSystemInfo(&info);
+    count = info.dwNumberOfProcessors * 2;
+    if (count > MAX_WORKERS) count = MAX_WORKERS;
+
+    InitializeCriticalSection(&queueLock);
+    queueItems = CreateSemaphoreW(NULL, 0, MAX_QUEUED + MAX_WORKERS, NULL);
+    copyDone = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!queueItems || !copyDone) {
+        if (queueItems) CloseHandle(queueItems);
+        if (copyDone) CloseHandle(copyDone);
+        queueItems = copyDone = NULL;
+        DeleteCriticalSection(&queueLock);
+        return;
+    }
+
+    while (workerCount < count) {
+        HANDLE h = CreateThread(NULL, 0, XCOPY_CopyWorker, NULL, 0, NULL);
+        if (!h) break;
+        workers[workerCount++] = h;
+    }
+    WINE_TRACE("Started %u copy workers\n", workerCount);
+}
+
+/* =========================================================================
+ * Print the names and errors of the copies done by the worker threads, in
+ * the order they were queued, stopping at the first one still in progress.
+ * Waits until at most 'keep' copies are left, or all of them once one
+ * failed and /C was not supplied
+ * Returns TRUE if one of them failed and /C was not supplied
+ * ========================================================================= */
+static BOOL XCOPY_ReportCopies(DWORD keep) {
+
+    BOOL failed = FALSE;
+
+    if (!workerCount) return FALSE;
+
+    while (resultHead) {
+        COPYITEM *item = resultHead;
+        DWORD status;
+
+        EnterCriticalSection(&queueLock);
+        status = item->status;
+        if (queueCancelled) keep = 0;
+        LeaveCriticalSection(&queueLock);
+
+        if (status == COPY_QUEUED) {
+            if (resultCount <= keep) break;
+            WaitForSingleObject(copyDone, INFINITE);
+            continue;
+        }
+
+        resultHead = item->nextResult;
+        if (!resultHead) resultTail = NULL;
+        resultCount--;
+
+        if (status != COPY_DROPPED) XCOPY_ShowCopy(item->from, item->to, item->flags);
+        if (status == COPY_FAILED) {
+            XCOPY_wprintf(XCOPY_LoadMessage(STRING_COPYFAIL),
+                   item->from, item->to, item->error);
+            XCOPY_FailMessage(item->error);
+            if (!(item->flags & OPT_IGNOREERRORS)) failed = TRUE;
+        }
+
+        HeapFree(GetProcessHeap(), 0, item);
+    }
+    return failed;
+}
+
+/* =========================================================================
+ * Queue a file to be copied by a worker thread. The caller bounds the
+ * copies in flight with XCOPY_ReportCopies, and once a copy failed the
+ * workers drop the file instead
+ * Returns FALSE if the file has to be copied by the caller instead
+ * ========================================================================= */
+static BOOL XCOPY_QueueCopy(const WCHAR *from, const WCHAR *to,
+                            DWORD srcAttribs, DWORD flags) {
+
+    COPYITEM *item;
+
+    if (!workerCount) return FALSE;
+
+    item = HeapAlloc(GetProcessHeap(), 0, sizeof(COPYITEM));
+    if (!item) return FALSE;
+
+    item->next = NULL;
+    item->nextResult = NULL;
+    item->srcAttribs = srcAttribs;
+    item->flags = flags;
+    item->status = COPY_QUEUED;
+    item->error = 0;
+    lstrcpyW(item->from, from);
+    lstrcpyW(item->to, to);
+
+    if (resultTail) resultTail->nextResult = item;
+    else resultHead = item;
+    resultTail = item;
+    resultCount++;
+
+    EnterCriticalSection(&queueLock);
+    if (queueTail) queueTail->next = item;
+    else queueHead = item;
+    queueTail = item;
+    LeaveCriticalSection(&queueLock);
+    ReleaseSemaphore(queueItems, 1, NULL);
+    return TRUE;
+}
+
+/* =========================================================================
+ * Wait for the queued copies to complete, stop the worker threads and free
+ * what XCOPY_StartWorkers created
+ * Returns TRUE if one of the copies failed and /C was not supplied
+ * ========================================================================= */
+static BOOL XCOPY_StopWorkers(void) {
+
+    DWORD i;
+    BOOL failed;
+
+    if (!queueItems) return FALSE;
+
+    failed = XCOPY_ReportCopies(0);
+    if (workerCount) {
+        ReleaseSemaphore(queueItems, workerCount, NULL);
+        WaitForMultipleObjects(workerCount, workers, TRUE, INFINITE);
+        for (i = 0; i < workerCount; i++) CloseHandle(workers[i]);
+    }
+
+    CloseHandle(queueItems);
+    CloseHandle(copyDone);
+    queueItems = copyDone = NULL;
+    DeleteCriticalSection(&queueLock);
+    workerCount = 0;
+    return failed;
+}
+
 /* =========================================================================
    XCOPY_DoCopy - Recursive function to copy files based on input parms
      of a stem and a spec
@@ -474,6 +744,14 @@ static int XCOPY_DoCopy(WCHAR *srcstem, WCHAR *srcspec,
                 }
             }
 
+            /* Print the copies still queued before asking about this one */
+            if (!skipFile && ((flags & OPT_SRCPROMPT) ||
+                (destAttribs != INVALID_FILE_ATTRIBUTES && !(flags & OPT_NOPROMPT))) &&
+                XCOPY_ReportCopies(0)) {
+                ret = RC_WRITEERROR;
+                goto cleanup;
+            }
+
             /* Prompt each file if necessary */
             if (!skipFile && (flags & OPT_SRCPROMPT)) {
                 DWORD count;
@@ -533,19 +811,7 @@ static int XCOPY_DoCopy(WCHAR *srcstem, WCHAR *srcspec,
                 skipFile = TRUE;
             }
 
-            /* Output a status message */
             if (!skipFile) {
-                if (flags & OPT_QUIET) {
-                    /* Skip message */
-                } else if (flags & OPT_FULL) {
-                    const WCHAR infostr[]   = {'%', '1', ' ', '-', '>', ' ',
-                                               '%', '2', '\n', 0};
-
-                    XCOPY_wprintf(infostr, copyFrom, copyTo);
-                } else {
-                    const WCHAR infostr[] = {'%', '1', '\n', 0};
-                    XCOPY_wprintf(infostr, copyFrom);
-                }
 
                 /* If allowing overwriting of read only files, remove any
                    write protection                                       */
@@ -555,39 +821,44 @@ static int XCOPY_DoCopy(WCHAR *srcstem, WCHAR *srcspec,
                 }
 
                 copiedFile = TRUE;
-                if (flags & OPT_SIMULATE || flags & OPT_NOCOPY) {
-                    /* Skip copy */
-                } else if (CopyFileW(copyFrom, copyTo, FALSE) == 0) {
-
-                    DWORD error = GetLastError();
-                    XCOPY_wprintf(XCOPY_LoadMessage(STRING_COPYFAIL),
-                           copyFrom, copyTo, error);
-                    XCOPY_FailMessage(error);
+                if (XCOPY_ReportCopies(MAX_QUEUED - 1)) {
+
+                    /* Stop as the serial copy would, if an earlier one failed */
+                    ret = RC_WRITEERROR;
+                    goto cleanup;
+                } else if (!(flags & OPT_SIMULATE || flags & OPT_NOCOPY) &&
+                           finddata->nFileSizeHigh == 0 &&
+                           finddata->nFileSizeLow < SMALL_FILE_SIZE &&
+                           XCOPY_QueueCopy(copyFrom, copyTo, srcAttribs, flags)) {
+                    /* Copied by a worker thread, XCOPY_ReportCopies prints it */
+                } else {
 
-                    if (flags & OPT_IGNOREERRORS) {
-                        skipFile = TRUE;
-                    } else {
+                    /* Print the copies still queued first, in the source order */
+                    if (XCOPY_ReportCopies(0)) {
                         ret = RC_WRITEERROR;
                         goto cleanup;
                     }
-                } else {
 
-                    if (!skipFile) {
-                        /* If keeping attributes, update the destination attributes
-                           otherwise remove the read only attribute                 */
-                        if (flags & OPT_KEEPATTRS) {
-                            SetFileAttributesW(copyTo, srcAttribs | FILE_ATTRIBUTE_ARCHIVE);
-                        } else {
-                            SetFileAttributesW(copyTo,
-                                     (GetFileAttributesW(copyTo) & ~FILE_ATTRIBUTE_READONLY));
-                        }
+                    /* Output a status message */
+                    XCOPY_ShowCopy(copyFrom, copyTo, flags);
+
+                    if (flags & OPT_SIMULATE || flags & OPT_NOCOPY) {
+                        /* Skip copy */
+                    } else if (CopyFileW(copyFrom, copyTo, FALSE) == 0) {
+
+                        DWORD error = GetLastError();
+                        XCOPY_wprintf(XCOPY_LoadMessage(STRING_COPYFAIL),
+                               copyFrom, copyTo, error);
+                        XCOPY_FailMessage(error);
 
-                        /* If /M supplied, remove the archive bit after successful copy */
-                        if ((srcAttribs & FILE_ATTRIBUTE_ARCHIVE) &&
-                            (flags & OPT_REMOVEARCH)) {
-                            SetFileAttributesW(copyFrom, (srcAttribs & ~FILE_ATTRIBUTE_ARCHIVE));
+                        if (flags & OPT_IGNOREERRORS) {
+                            skipFile = TRUE;
+                        } else {
+                            ret = RC_WRITEERROR;
+                            goto cleanup;
                         }
-                        filesCopied++;
+                    } else {
+                        XCOPY_CopyDone(copyFrom, copyTo, srcAttribs, flags);
                     }
                 }
             }
@@ -1160,11 +1431,20 @@ int wmain (int argc, WCHAR *argvW[])
                   &count, NULL);
     }
 
+    /* Copy the small files in parallel when recursing. Not when copying
+       everything to a single file, where the order of the copies matters */
+    if ((flags & OPT_RECURSIVE) && !(flags & (OPT_SIMULATE | OPT_NOCOPY)) &&
+        *destinationspec == 0x00) {
+        XCOPY_StartWorkers();
+    }
+
     /* Now do the hard work... */
     rc = XCOPY_DoCopy(sourcestem, sourcespec,
                 destinationstem, destinationspec,
                 flags);
 
+    if (XCOPY_StopWorkers() && rc == RC_OK) rc = RC_WRITEERROR;
+
     /* Clear up exclude list allocated memory */
     while (excludeList) {
         EXCLUDELIST *pos = excludeList;
@@ -27,98 +27,1040 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-//#include <string.h>
-//#include <ctype.h>
+#include <string.h>
+#include <ctype.h>
 #include <windef.h>
 #include <winbase.h>
 #include <winuser.h>
-//#include <io.h>
+#include <io.h>
+#include <fcntl.h>
 #include <dos.h>
+#include <pseh/pseh2.h>
 
 #include "resource.h"
 
-/* Symbol definition */
-#define MAX_STR 1024
+/* Files are scanned through mapped views of this size */
+#define VIEW_SIZE (64 * 1024 * 1024)
 
+/* Standard input is read by blocks of this size */
+#define READ_SIZE (64 * 1024)
 
-/* This function prints out all lines containing a substring.  There are some
- * conditions that may be passed to the function.
- *
- * RETURN: If the string was found at least once, returns 1.
- * If the string was not found at all, returns 0.
+/* Number of files searched at the same time, and of files whose output
+   may be kept waiting for the ones before them to be printed */
+#define MAX_WORKERS 8
+#define MAX_PENDING (2 * MAX_WORKERS)
+
+/* Output kept in memory for a file waiting for its turn to be printed.
+   Past this size the search waits for its turn and prints straight away. */
+#define MAX_KEPT_OUTPUT (1024 * 1024)
+
+
+/* Search options, set once by main () */
+static int invert_search = 0;		/* flag to invert the search */
+static int count_lines = 0;		/* flag to whether/not count lines */
+static int number_output = 0;		/* flag to print line numbers */
+static int ignore_case = 0;		/* flag to be case insensitive */
+static int at_start = 0;		/* flag to Match if at the beginning of a line. */
+static int at_end = 0;			/* flag to Match if at the end of a line. */
+static int reg_express = 0;		/* flag to use/not use regular expressions */
+static int exact_match = 0;		/* flag to be exact match */
+static int sub_dirs = 0;		/* this and all subdirectories */
+static int only_fname = 0;		/* print only the name of the file*/
+
+/* The string to find, case folded through fold[] for /I. Literal strings
+ * are searched with Boyer-Moore-Horspool: skip[] gives how far the search
+ * can move on when the last character of the window does not match.
  */
-int
-find_str (char *sz, FILE *p, int invert_search,
-          int count_lines, int number_output, int ignore_case, int at_start, int literal_search,
-		  int at_end, int reg_express, int exact_match, int sub_dirs, int only_fname)
+static unsigned char fold[256];
+static unsigned char *search_str;
+static size_t search_len;
+static size_t skip[256];
+
+/* Regular expressions (/R) are compiled to a list of nodes */
+enum
+{
+  RE_END,
+  RE_CHAR,			/* c */
+  RE_ANY,			/* . */
+  RE_CLASS,			/* [set] and [^set] */
+  RE_BOL,			/* ^ */
+  RE_EOL,			/* $ */
+  RE_WORD_START,		/* \< */
+  RE_WORD_END			/* \> */
+};
+
+struct re_node
+{
+  int type;
+  int star;			/* followed by *, matches zero or more times */
+  unsigned char c;
+  unsigned char set[32];
+};
+
+static struct re_node *re_nodes;
+static int re_count;		/* nodes before the RE_END one */
+
+/* Output of a file, written straight to stdout or kept in memory while
+   other files are being printed */
+struct output
 {
-  int i, length;
-  long line_number = 0, total_lines = 0;
-  char *c, temp_str[MAX_STR], this_line[MAX_STR];
+  char *buf;
+  size_t len;
+  size_t size;
+  int direct;
+  int no_memory;		/* some output was lost */
+  HANDLE turn;			/* set when the file may be printed */
+};
 
-  /* Convert to upper if needed */
+/* State of the scan of one file */
+struct scan
+{
+  struct output *out;
+  const char *name;
+  long line_number;
+  long total_lines;
+  int done;
+  int *re_states;		/* two lists of re_count + 1 nodes */
+  unsigned int *re_mark;	/* re_gen when a node is in the current list */
+  unsigned int re_gen;
+};
+
+
+static void
+out_write (struct output *out, const void *data, size_t len)
+{
+  if (!out->direct && out->len + len > MAX_KEPT_OUTPUT)
+    {
+      /* Too much to keep: wait for the files before this one to be
+         printed, then print as we go */
+      WaitForSingleObject (out->turn, INFINITE);
+      fwrite (out->buf, 1, out->len, stdout);
+      free (out->buf);
+      out->buf = NULL;
+      out->len = out->size = 0;
+      out->direct = 1;
+    }
+
+  if (out->direct)
+    {
+      fwrite (data, 1, len, stdout);
+      return;
+    }
+
+  if (out->len + len > out->size)
+    {
+      size_t size = out->size ? out->size : 4096;
+      char *buf;
+
+      while (size < out->len + len)
+        size *= 2;
+      buf = realloc (out->buf, size);
+      if (buf == NULL)
+        {
+          out->no_memory = 1;
+          return;
+        }
+      out->buf = buf;
+      out->size = size;
+    }
+  memcpy (out->buf + out->len, data, len);
+  out->len += len;
+}
+
+static void
+out_string (struct output *out, const char *str)
+{
+  out_write (out, str, strlen (str));
+}
+
+static void
+out_of_memory (const char *name)
+{
+  TCHAR lpMessage[4096];
+
+  LoadString (GetModuleHandle (NULL), IDS_OUT_OF_MEMORY, (LPTSTR)lpMessage, 4096);
+  CharToOem (lpMessage, lpMessage);
+  fprintf (stderr, lpMessage, name);
+}
+
+
+static int
+equal_fold (const unsigned char *str, const unsigned char *pattern, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      if (fold[str[i]] != pattern[i])
+        return 0;
+    }
+  return 1;
+}
+
+/* Returns the first occurrence of the search_str in str, or NULL */
+static const unsigned char *
+bmh_find (const unsigned char *str, size_t len)
+{
+  size_t i = 0, last;
+
+  if (search_len == 0)
+    return str;
+
+  last = search_len - 1;
+  while (len >= search_len && i <= len - search_len)
+    {
+      unsigned char c = fold[str[i + last]];
+
+      if (c == search_str[last] && equal_fold (str + i, search_str, last))
+        return str + i;
+      i += skip[c];
+    }
+  return NULL;
+}
+
+static void
+bmh_compile (void)
+{
+  size_t i;
+
+  for (i = 0; i < 256; i++)
+    skip[i] = search_len;
+  for (i = 0; i + 1 < search_len; i++)
+    skip[search_str[i]] = search_len - 1 - i;
+}
+
+
+static void
+re_add_to_set (struct re_node *node, unsigned char c)
+{
+  node->set[c >> 3] |= 1 << (c & 7);
   if (ignore_case)
     {
-      length = strlen (sz);
-      for (i = 0; i < length; i++)
-	sz[i] = toupper (sz[i]);
+      c = toupper (c);
+      node->set[c >> 3] |= 1 << (c & 7);
+      c = tolower (c);
+      node->set[c >> 3] |= 1 << (c & 7);
+    }
+}
+
+/* Parses a [set] starting after the bracket, returns the end of it or NULL
+   if there is no closing bracket */
+static const char *
+re_compile_set (struct re_node *node, const char *p)
+{
+  int negate = 0, i;
+
+  if (*p == '^')
+    {
+      negate = 1;
+      p++;
+    }
+
+  while (*p && *p != ']')
+    {
+      unsigned char first = *p, c;
+
+      if (p[1] == '-' && p[2] && p[2] != ']')
+        {
+          for (c = first; c != (unsigned char)p[2]; c++)
+            re_add_to_set (node, c);
+          re_add_to_set (node, c);
+          p += 3;
+        }
+      else
+        {
+          re_add_to_set (node, first);
+          p++;
+        }
+    }
+  if (*p != ']')
+    return NULL;
+
+  if (negate)
+    {
+      for (i = 0; i < 32; i++)
+        node->set[i] = ~node->set[i];
+    }
+  return p + 1;
+}
+
+/* Compiles the findstr syntax: . * ^ $ [set] [^set] [x-y] \< \> \x */
+static int
+re_compile (const char *pattern)
+{
+  const char *p = pattern, *next;
+  struct re_node *node;
+  int count = 0;
+
+  /* Room for all the characters and the implied anchors */
+  re_nodes = calloc (strlen (pattern) + 3, sizeof (struct re_node));
+  if (re_nodes == NULL)
+    return 0;
+
+  if ((at_start || exact_match) && *p != '^')
+    re_nodes[count++].type = RE_BOL;
+
+  while (*p)
+    {
+      node = &re_nodes[count++];
+
+      if (*p == '^' && p == pattern)
+        {
+          node->type = RE_BOL;
+          p++;
+          continue;
+        }
+      if (*p == '$' && p[1] == '\0')
+        {
+          node->type = RE_EOL;
+          p++;
+          continue;
+        }
+
+      if (*p == '.')
+        {
+          node->type = RE_ANY;
+          p++;
+        }
+      else if (*p == '[' && (next = re_compile_set (node, p + 1)) != NULL)
+        {
+          node->type = RE_CLASS;
+          p = next;
+        }
+      else if (*p == '\\' && p[1] == '<')
+        {
+          node->type = RE_WORD_START;
+          p += 2;
+          continue;
+        }
+      else if (*p == '\\' && p[1] == '>')
+        {
+          node->type = RE_WORD_END;
+          p += 2;
+          continue;
+        }
+      else
+        {
+          if (*p == '\\' && p[1])
+            p++;
+          node->type = RE_CHAR;
+          node->c = fold[(unsigned char)*p];
+          p++;
+        }
+
+      if (*p == '*')
+        {
+          node->star = 1;
+          p++;
+        }
+    }
+
+  if ((at_end || exact_match) &&
+      (count == 0 || re_nodes[count - 1].type != RE_EOL))
+    re_nodes[count++].type = RE_EOL;
+
+  re_nodes[count].type = RE_END;
+  re_count = count;
+  return 1;
+}
+
+static int
+is_word (unsigned char c)
+{
+  return isalnum (c) || c == '_';
+}
+
+static int
+re_match_char (const struct re_node *node, unsigned char c)
+{
+  switch (node->type)
+    {
+      case RE_CHAR:
+        return fold[c] == node->c;
+      case RE_ANY:
+        return 1;
+      case RE_CLASS:
+        return (node->set[c >> 3] >> (c & 7)) & 1;
+    }
+  return 0;
+}
+
+/* Adds a node to the list of the nodes that are matching at p, along
+ * with the nodes that can follow it without reading a character.
+ *
+ * RETURN: The new length of the list, or -1 if the end was reached.
+ */
+static int
+re_add_state (struct scan *sc, int *list, int count, int i,
+              const unsigned char *p, const unsigned char *line,
+              const unsigned char *end)
+{
+  const struct re_node *node;
+
+  for (;; i++)
+    {
+      if (sc->re_mark[i] == sc->re_gen)
+        return count;
+      sc->re_mark[i] = sc->re_gen;
+
+      node = &re_nodes[i];
+      switch (node->type)
+        {
+          case RE_END:
+            return -1;
+          case RE_BOL:
+            if (p != line)
+              return count;
+            break;
+          case RE_EOL:
+            if (p != end)
+              return count;
+            break;
+          case RE_WORD_START:
+            if (p == end || !is_word (*p) || (p > line && is_word (p[-1])))
+              return count;
+            break;
+          case RE_WORD_END:
+            if (p == line || !is_word (p[-1]) || (p < end && is_word (*p)))
+              return count;
+            break;
+          default:
+            list[count++] = i;
+            if (!node->star)
+              return count;
+            break;
+        }
+    }
+}
+
+static void
+re_next_gen (struct scan *sc)
+{
+  if (++sc->re_gen == 0)
+    {
+      memset (sc->re_mark, 0, (re_count + 1) * sizeof (*sc->re_mark));
+      sc->re_gen = 1;
     }
+}
+
+/* Runs all the ways the expression can match at the same time, so that the
+ * time taken is linear in the length of the line whatever the expression.
+ */
+static int
+re_search (struct scan *sc, const unsigned char *line, size_t len)
+{
+  const unsigned char *p = line, *end = line + len;
+  int *list = sc->re_states, *next = sc->re_states + re_count + 1, *tmp;
+  int anchored = (re_nodes[0].type == RE_BOL);
+  int count, next_count, j;
+
+  re_next_gen (sc);
+  count = re_add_state (sc, list, 0, 0, p, line, end);
+
+  while (count > 0 || (!anchored && p < end))
+    {
+      if (count < 0)
+        return 1;
+      if (p == end)
+        return 0;
+
+      re_next_gen (sc);
+      next_count = 0;
+      for (j = 0; j < count && next_count >= 0; j++)
+        {
+          const struct re_node *node = &re_nodes[list[j]];
+
+          if (re_match_char (node, *p))
+            next_count = re_add_state (sc, next, next_count,
+                                       list[j] + !node->star, p + 1, line, end);
+        }
+
+      /* The match may start at any character */
+      if (!anchored && next_count >= 0)
+        next_count = re_add_state (sc, next, next_count, 0, p + 1, line, end);
+
+      tmp = list;
+      list = next;
+      next = tmp;
+      count = next_count;
+      p++;
+    }
+
+  return count < 0;
+}
+
+/* Gets the lists of nodes used by re_search () */
+static int
+scan_init (struct scan *sc)
+{
+  if (!reg_express)
+    return 1;
+
+  sc->re_states = malloc (2 * (re_count + 1) * sizeof (*sc->re_states));
+  sc->re_mark = calloc (re_count + 1, sizeof (*sc->re_mark));
+  return sc->re_states != NULL && sc->re_mark != NULL;
+}
+
+static void
+scan_free (struct scan *sc)
+{
+  free (sc->re_states);
+  free (sc->re_mark);
+}
+
+
+static int
+line_matches (struct scan *sc, const unsigned char *line, size_t len)
+{
+  if (reg_express)
+    return re_search (sc, line, len);
+
+  if (exact_match)
+    return len == search_len && equal_fold (line, search_str, len);
+
+  if (at_start || at_end)
+    {
+      if (len < search_len)
+        return 0;
+      if (at_start && !equal_fold (line, search_str, search_len))
+        return 0;
+      if (at_end && !equal_fold (line + len - search_len, search_str, search_len))
+        return 0;
+      return 1;
+    }
+
+  return bmh_find (line, len) != NULL;
+}
+
+/* Prints a line, that may already end with a newline */
+static void
+print_line (struct scan *sc, const unsigned char *line, size_t len)
+{
+  char number[16];
+
+  sc->total_lines++;
+  if (count_lines)
+    return;
+
+  if (only_fname)
+    {
+      /* Print the file name once, no need to look further */
+      out_string (sc->out, sc->name ? sc->name : "(standard input)");
+      out_string (sc->out, "\r\n");
+      sc->done = 1;
+      return;
+    }
+
+  if (number_output)
+    {
+      sprintf (number, "%ld:", sc->line_number);
+      out_string (sc->out, number);
+    }
+
+  /* Print the line of text */
+  out_write (sc->out, line, len);
+  if (len == 0 || line[len - 1] != '\n')
+    out_string (sc->out, "\r\n");
+
+  /* No use going on if the lines are lost */
+  if (sc->out->no_memory)
+    sc->done = 1;
+}
+
+/* Scans the complete lines of the block, the last one as well if there is
+ * nothing after the block.
+ *
+ * RETURN: The number of bytes that were scanned.
+ */
+static size_t
+scan_block (struct scan *sc, const unsigned char *buf, size_t len, int last)
+{
+  const unsigned char *p = buf, *end = buf + len, *eol, *line, *hit = NULL;
+  int skip_lines = !reg_express && !invert_search &&
+                   !at_start && !at_end && !exact_match;
+  size_t line_len;
+  int found;
 
-  /* Scan the file until EOF */
-  while (fgets (temp_str, MAX_STR, p) != NULL)
+  while (p < end && !sc->done)
     {
+      if (skip_lines)
+        {
+          /* Look for the string in the whole block, the lines before the
+             one that holds it do not need to be looked at */
+          hit = bmh_find (p, end - p);
+          line = hit ? hit : end;
+          while (line > p && line[-1] != '\n')
+            line--;
+
+          if (number_output)
+            {
+              while ((eol = memchr (p, '\n', line - p)) != NULL)
+                {
+                  sc->line_number++;
+                  p = eol + 1;
+                }
+            }
+          p = line;
+          if (p == end)
+            break;
+        }
+
+      eol = memchr (p, '\n', end - p);
+      if (eol == NULL)
+        {
+          if (!last)
+            break;
+          eol = end;
+        }
+
       /* Remove the trailing newline */
-      length = strlen (temp_str);
-      if (temp_str[length-1] == '\n')
-	{
-	  temp_str[length-1] = '\0';
-	}
+      line_len = eol - p;
+      if (line_len > 0 && p[line_len - 1] == '\r')
+        line_len--;
 
       /* Increment number of lines */
-      line_number++;
-      strcpy (this_line, temp_str);
+      sc->line_number++;
 
-      /* Convert to upper if needed */
-      if (ignore_case)
-	{
-	  for (i = 0; i < length; i++)
-	    {
-	      temp_str[i] = toupper (temp_str[i]);
-	    }
-	}
+      if (skip_lines)
+        found = (hit != NULL && hit + search_len <= p + line_len);
+      else
+        found = (line_matches (sc, p, line_len) != invert_search);
 
-      /* Locate the substring */
+      if (found)
+        {
+          /* Print the newline along with the line when it is a plain one */
+          if (eol < end && line_len == (size_t)(eol - p))
+            print_line (sc, p, line_len + 1);
+          else
+            print_line (sc, p, line_len);
+        }
 
-      /* strstr() returns a pointer to the first occurrence in the
-       string of the substring */
-      c = strstr (temp_str, sz);
+      p = (eol < end) ? eol + 1 : end;
+    }
 
-      if ( ((invert_search) ? (c == NULL) : (c != NULL)) )
-	{
-	  if (!count_lines)
-	    {
-	      if (number_output)
-		printf ("%ld:", line_number);
+  return sc->done ? len : (size_t)(p - buf);
+}
 
-	      /* Print the line of text */
-	      puts (this_line);
-	    }
+/* This function prints out all lines of a file containing a substring.
+ * The file is mapped to memory and scanned one view at a time.
+ *
+ * RETURN: If the file cannot be read, returns -1. If memory ran out,
+ * returns -2. If the string was found at least once, returns 1.
+ * If it was not found at all, returns 0.
+ */
+static int
+find_str_file (const char *path, const char *name, struct output *out)
+{
+  struct scan sc = { out, name, 0, 0, 0 };
+  ULONGLONG offset = 0, base, size;
+  SIZE_T view_size = VIEW_SIZE, length, delta, consumed;
+  LARGE_INTEGER file_size;
+  HANDLE file, mapping;
+  SYSTEM_INFO info;
+  unsigned char *view;
+  int ret = 0;
+
+  file = CreateFileA (path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                      NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return -1;
+
+  if (!GetFileSizeEx (file, &file_size))
+    {
+      CloseHandle (file);
+      return -1;
+    }
+  size = file_size.QuadPart;
+
+  /* Empty files cannot be mapped */
+  mapping = NULL;
+  if (size != 0)
+    {
+      mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping == NULL)
+        {
+          CloseHandle (file);
+          return -1;
+        }
+    }
 
-	  total_lines++;
-	} /* long if */
-    } /* while fgets */
+  if (!only_fname)
+    {
+      out_string (out, "---------------- ");
+      out_string (out, name);
+      out_string (out, "\r\n");
+    }
+
+  if (!scan_init (&sc))
+    ret = -2;
+
+  GetSystemInfo (&info);
+  while (ret == 0 && offset < size && !sc.done)
+    {
+      /* Views start on the allocation granularity */
+      base = offset - offset % info.dwAllocationGranularity;
+      delta = (SIZE_T)(offset - base);
+      length = (SIZE_T)min (view_size, size - base);
+
+      view = MapViewOfFile (mapping, FILE_MAP_READ,
+                            (DWORD)(base >> 32), (DWORD)base, length);
+      if (view == NULL)
+        {
+          ret = -1;
+          break;
+        }
+
+      /* Reading the view raises an exception if the file cannot be read
+         any longer, e.g. when it was truncated or is on a lost network */
+      _SEH2_TRY
+        {
+          consumed = scan_block (&sc, view + delta, length - delta,
+                                 base + length == size);
+        }
+      _SEH2_EXCEPT (_SEH2_GetExceptionCode () == EXCEPTION_IN_PAGE_ERROR ?
+                    EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+          consumed = 0;
+          ret = -1;
+        }
+      _SEH2_END;
+      UnmapViewOfFile (view);
+      if (ret < 0)
+        break;
+
+      /* A line longer than a view: try again with a larger one */
+      if (consumed == 0 && base + length != size)
+        {
+          view_size *= 2;
+          continue;
+        }
+      offset += consumed;
+    }
+
+  scan_free (&sc);
+  if (mapping != NULL)
+    CloseHandle (mapping);
+  CloseHandle (file);
+
+  if (ret < 0)
+    return ret;
 
   if (count_lines)
     {
       /* Just show num. lines that contain the string */
-      printf ("%ld\n", total_lines);
+      char number[16];
+
+      sprintf (number, "%ld\r\n", sc.total_lines);
+      out_string (out, number);
     }
 
+  if (out->no_memory)
+    return -2;
+  return (sc.total_lines > 0 ? 1 : 0);
+}
 
- /* RETURN: If the string was found at least once, returns 1.
-  * If the string was not found at all, returns 0.
-  */
-  return (total_lines > 0 ? 1 : 0);
+/* Same as find_str_file () for a stream, which is read by blocks.
+ *
+ * RETURN: If memory ran out, returns -2. If the string was found at
+ * least once, returns 1. If the string was not found at all, returns 0.
+ */
+static int
+find_str (FILE *p)
+{
+  struct output out = { NULL, 0, 0, 1 };
+  struct scan sc = { &out, NULL, 0, 0, 0 };
+  size_t size = READ_SIZE, len = 0, consumed;
+  unsigned char *buf, *new_buf;
+  int n;
+
+  buf = malloc (size);
+  if (buf == NULL || !scan_init (&sc))
+    {
+      free (buf);
+      scan_free (&sc);
+      return -2;
+    }
+
+  for (;;)
+    {
+      /* Make room for lines longer than the buffer */
+      if (len == size)
+        {
+          new_buf = realloc (buf, size * 2);
+          if (new_buf == NULL)
+            {
+              sc.out->no_memory = 1;
+              break;
+            }
+          buf = new_buf;
+          size *= 2;
+        }
+
+      /* _read () returns what is available, so that lines typed on the
+         console are answered as they come */
+      n = _read (_fileno (p), buf + len, (unsigned int)(size - len));
+      if (n > 0)
+        len += n;
+
+      consumed = scan_block (&sc, buf, len, n <= 0);
+      memmove (buf, buf + consumed, len - consumed);
+      len -= consumed;
+
+      if (n <= 0 || sc.done)
+        break;
+    }
+  free (buf);
+  scan_free (&sc);
+
+  if (out.no_memory)
+    return -2;
+
+  if (count_lines)
+    {
+      /* Just show num. lines that contain the string */
+      printf ("%ld\r\n", sc.total_lines);
+    }
+
+  return (sc.total_lines > 0 ? 1 : 0);
+}
+
+
+/* A file to search, or a file specification that matched nothing */
+struct job
+{
+  char *path;
+  char *name;
+  int missing;
+  int ret;
+  struct output out;
+  HANDLE done;
+};
+
+static struct job *jobs;
+static LONG job_count;
+static LONG next_job;
+static HANDLE pending;		/* counts the jobs that may still be started */
+
+static void
+run_job (struct job *job)
+{
+  if (!job->missing)
+    job->ret = find_str_file (job->path, job->name, &job->out);
+}
+
+/* Worker thread, searching the files in order */
+static DWORD WINAPI
+search_worker (void *param)
+{
+  LONG i;
+
+  for (;;)
+    {
+      WaitForSingleObject (pending, INFINITE);
+      i = InterlockedIncrement (&next_job) - 1;
+      if (i >= job_count)
+        break;
+
+      run_job (&jobs[i]);
+      SetEvent (jobs[i].done);
+    }
+
+  /* Let the other workers see that there is nothing left */
+  ReleaseSemaphore (pending, 1, NULL);
+  return 0;
+}
+
+/* RETURN: If memory ran out, returns 0. Otherwise, returns 1. */
+static int
+add_job (const char *path, const char *name, int missing)
+{
+  struct job *new_jobs, *job;
+
+  if ((job_count & (job_count - 1)) == 0)
+    {
+      new_jobs = realloc (jobs, (job_count ? job_count * 2 : 1) * sizeof (*jobs));
+      if (new_jobs == NULL)
+        return 0;
+      jobs = new_jobs;
+    }
+
+  job = &jobs[job_count];
+  memset (job, 0, sizeof (*job));
+  job->path = _strdup (path);
+  job->name = _strdup (name);
+  job->missing = missing;
+  if (job->path == NULL || job->name == NULL)
+    {
+      free (job->path);
+      free (job->name);
+      return 0;
+    }
+  job_count++;
+  return 1;
+}
+
+/* Adds the files matching a specification to the jobs.
+ *
+ * RETURN: If memory ran out, returns 0. Otherwise, returns 1.
+ */
+static int
+add_jobs (const char *spec)
+{
+  struct _finddata_t finddata;	/* _findfirst, filenext block */
+  intptr_t hfind;		/* search handle */
+  char path[MAX_PATH];
+  size_t dir_len;
+  const char *p;
+  int ret = 1;
+
+  /* Keep the directory part of the specification to open the files */
+  dir_len = 0;
+  for (p = spec; *p; p++)
+    {
+      if (*p == '\\' || *p == '/' || *p == ':')
+        dir_len = p + 1 - spec;
+    }
+
+  hfind = _findfirst (spec, &finddata);
+  if (hfind == -1)
+    return add_job (spec, spec, 1);
+
+  /* repeat find next file to match the filemask */
+  do
+    {
+      if (finddata.attrib & _A_SUBDIR)
+        continue;
+
+      if (dir_len + strlen (finddata.name) >= MAX_PATH)
+        {
+          ret = add_job (finddata.name, finddata.name, 0);
+          continue;
+        }
+      memcpy (path, spec, dir_len);
+      strcpy (path + dir_len, finddata.name);
+      ret = add_job (path, finddata.name, 0);
+    }
+  while (ret && _findnext (hfind, &finddata) == 0);
+
+  _findclose (hfind);
+  return ret;
+}
+
+/* Searches all the files, several at a time when there are many of them,
+ * printing the results in order.
+ *
+ * RETURN: If memory ran out, returns -2. If the string was found at least
+ * once, returns 1. If the string was not found at all, returns 0.
+ */
+static int
+find_str_files (void)
+{
+  HANDLE workers[MAX_WORKERS];
+  DWORD worker_count = 0, count;
+  SYSTEM_INFO info;
+  TCHAR lpMessage[4096];
+  int ret = 0;
+  LONG i;
+
+  GetSystemInfo (&info);
+  count = min (info.dwNumberOfProcessors, MAX_WORKERS);
+  if (job_count > 1 && count > 1)
+    {
+      pending = CreateSemaphoreA (NULL, MAX_PENDING, MAX_PENDING + 1, NULL);
+      for (i = 0; pending != NULL && i < job_count; i++)
+        {
+          jobs[i].done = CreateEventA (NULL, TRUE, FALSE, NULL);
+          jobs[i].out.turn = CreateEventA (NULL, TRUE, FALSE, NULL);
+          if (jobs[i].done == NULL || jobs[i].out.turn == NULL)
+            break;
+        }
+
+      if (pending != NULL && i == job_count)
+        {
+          while (worker_count < count)
+            {
+              workers[worker_count] = CreateThread (NULL, 0, search_worker,
+                                                    NULL, 0, NULL);
+              if (workers[worker_count] == NULL)
+                break;
+              worker_count++;
+            }
+        }
+    }
+
+  for (i = 0; i < job_count; i++)
+    {
+      struct job *job = &jobs[i];
+
+      if (worker_count)
+        {
+          /* The search may print what does not fit in memory itself */
+          SetEvent (job->out.turn);
+          WaitForSingleObject (job->done, INFINITE);
+        }
+      else
+        {
+          /* No workers: print straight away */
+          job->out.direct = 1;
+          run_job (job);
+        }
+
+      /* Print what the search found, or why it could not be done */
+      if (job->missing)
+        {
+          /* We were not able to find a file. Display a message and
+             set the exit status. */
+          LoadString (GetModuleHandle (NULL), IDS_NO_SUCH_FILE, (LPTSTR)lpMessage, 4096);
+          CharToOem (lpMessage, lpMessage);
+          fprintf (stderr, lpMessage, job->name);
+        }
+      else if (job->ret == -2)
+        {
+          if (job->out.len)
+            fwrite (job->out.buf, 1, job->out.len, stdout);
+          out_of_memory (job->name);
+          ret = -2;
+        }
+      else if (job->ret < 0)
+        {
+          if (job->out.len)
+            fwrite (job->out.buf, 1, job->out.len, stdout);
+          LoadString (GetModuleHandle (NULL), IDS_CANNOT_OPEN, (LPTSTR)lpMessage, 4096);
+          CharToOem (lpMessage, lpMessage);
+          fprintf (stderr, lpMessage, job->name);
+        }
+      else
+        {
+          if (job->out.len)
+            fwrite (job->out.buf, 1, job->out.len, stdout);
+          if (job->ret > 0 && ret == 0)
+            ret = 1;
+        }
+
+      free (job->out.buf);
+      free (job->path);
+      free (job->name);
+      if (job->done != NULL)
+        CloseHandle (job->done);
+      if (job->out.turn != NULL)
+        CloseHandle (job->out.turn);
+
+      /* Let the workers start on another file */
+      if (worker_count)
+        ReleaseSemaphore (pending, 1, NULL);
+    }
+
+  if (worker_count)
+    {
+      WaitForMultipleObjects (worker_count, workers, TRUE, INFINITE);
+      while (worker_count)
+        CloseHandle (workers[--worker_count]);
+    }
+  if (pending != NULL)
+    CloseHandle (pending);
+
+  free (jobs);
+  return ret;
 }
 
 /* Show usage */
@@ -139,23 +1081,7 @@ main (int argc, char **argv)
 {
   char *opt, *needle = NULL;
   int ret = 0;
-  TCHAR lpMessage[4096];
-
-  int invert_search = 0;		/* flag to invert the search */
-  int count_lines = 0;			/* flag to whether/not count lines */
-  int number_output = 0;		/* flag to print line numbers */
-  int ignore_case = 0;			/* flag to be case insensitive */
-  int at_start = 0;				/* flag to Match if at the beginning of a line. */
-  int at_end = 0;	        	/* flag to Match if at the beginning of a line. */
-  int reg_express = 0;		   /* flag to use/not use regular expressions */
-  int exact_match = 0;			/* flag to be exact match */
-  int sub_dirs= 0;				/* this and all subdirectories */
-  int only_fname= 0;			/* print only the name of the file*/
-  int literal_search=0;
-
-  FILE *pfile;				/* file pointer */
-  int hfind;				/* search handle */
-  struct _finddata_t finddata;		/* _findfirst, filenext block */
+  int i;
 
   /* Scan the command line */
   while ((--argc) && (needle == NULL))
@@ -169,10 +1095,15 @@ main (int argc, char **argv)
 	        at_start = 1;
 	        break;
 			
-	      //case 'c':
-	      //case 'C':		/* Literal? */
-	      //  literal_search = 1;
-	      //  break;
+	      case 'c':
+	      case 'C':		/* /C:string, the string may hold spaces */
+	        if (opt[2] != ':')
+	          {
+	            usage ();
+	            exit (2);
+	          }
+	        needle = opt + 3;
+	        break;
 
 	      case 'e':
 	      case 'E':		/* matches pattern if at end of line */
@@ -239,57 +1170,53 @@ main (int argc, char **argv)
       exit (1);
     }
 
+  /* Prepare the string for the search */
+  for (i = 0; i < 256; i++)
+    fold[i] = ignore_case ? toupper (i) : i;
+
+  if (reg_express)
+    {
+      if (!re_compile (needle))
+        exit (2);
+    }
+  else
+    {
+      search_str = (unsigned char *)needle;
+      search_len = strlen (needle);
+      for (i = 0; i < (int)search_len; i++)
+        search_str[i] = fold[search_str[i]];
+      bmh_compile ();
+    }
+
+  /* The lines are copied as they are, with their own newlines */
+  _setmode (_fileno (stdin), _O_BINARY);
+  _setmode (_fileno (stdout), _O_BINARY);
+
   /* Scan the files for the string */
   if (argc == 0)
     {
-      ret = find_str (needle, stdin, invert_search, count_lines,
-                      number_output, ignore_case, at_start, literal_search, at_end, reg_express, exact_match,
-					  sub_dirs, only_fname);
+      ret = find_str (stdin);
+      if (ret == -2)
+        out_of_memory ("(standard input)");
     }
-
-  while (--argc >= 0)
+  else
     {
-      hfind = _findfirst (*++argv, &finddata);
-      if (hfind < 0)
-	{
-	  /* We were not able to find a file. Display a message and
-	     set the exit status. */
-	  LoadString( GetModuleHandle(NULL), IDS_NO_SUCH_FILE, (LPTSTR)lpMessage, 4096);
-	  CharToOem(lpMessage, lpMessage);
-	  fprintf (stderr, lpMessage, *argv);//
-	}
-      else
+      while (--argc >= 0)
         {
-          /* repeat find next file to match the filemask */
-	  do
+          if (!add_jobs (*++argv))
             {
-              /* We have found a file, so try to open it */
-	      if ((pfile = fopen (finddata.name, "r")) != NULL)
-	        {
-	          printf ("---------------- %s\n", finddata.name);
-	          ret = find_str (needle, pfile, invert_search, count_lines,
-                      number_output, ignore_case, at_start, literal_search, at_end, reg_express, exact_match,
-					  sub_dirs, only_fname);
-	          fclose (pfile);
-	        }
- 	      else
-	        {
-	          LoadString(GetModuleHandle(NULL), IDS_CANNOT_OPEN, (LPTSTR)lpMessage, 4096);
-	          CharToOem(lpMessage, lpMessage);
-	          fprintf (stderr, lpMessage,
-		           finddata.name);
-                }
-	    }
-          while (_findnext(hfind, &finddata) > 0);
+              out_of_memory (*argv);
+              exit (2);
+            }
         }
-      _findclose(hfind);
-    } /* for each argv */
+
+      ret = find_str_files ();
+    }
 
  /* RETURN: If the string was found at least once, returns 0.
   * If the string was not found at all, returns 1.
+  * If memory ran out, returns 2.
   * (Note that find_str.c returns the exact opposite values.)
   */
-  exit ( (ret ? 0 : 1) );
+  exit ( (ret < 0 ? 2 : ret ? 0 : 1) );
 }
-
-
@@ -3,3 +3,4 @@
 #define IDS_USAGE        1000
 #define IDS_NO_SUCH_FILE 1001
 #define IDS_CANNOT_OPEN  1002
+#define IDS_OUT_OF_MEMORY 1003
@@ -14,21 +14,132 @@
 static RESOLVER_CACHE DnsCache;
 static BOOL DnsCacheInitialized = FALSE;
 
-#define DnsCacheLock()          do { EnterCriticalSection(&DnsCache.Lock); } while (0)
-#define DnsCacheUnlock()        do { LeaveCriticalSection(&DnsCache.Lock); } while (0)
+#define DnsCacheLockShared()    do { RtlAcquireResourceShared(&DnsCache.Lock, TRUE); } while (0)
+#define DnsCacheLock()          do { RtlAcquireResourceExclusive(&DnsCache.Lock, TRUE); } while (0)
+#define DnsCacheUnlock()        do { RtlReleaseResource(&DnsCache.Lock); } while (0)
+
+/* Entries are hashed by name only, so all the types of a name share a bucket */
+static
+ULONG
+DnsIntCacheHashName(
+    _In_ LPCWSTR Name)
+{
+    ULONG Hash = 0;
+
+    while (*Name)
+        Hash = Hash * 31 + towlower(*Name++);
+
+    return Hash;
+}
+
+static
+BOOL
+DnsIntCacheIsExpired(
+    _In_ PRESOLVER_CACHE_ENTRY CacheEntry,
+    _In_ DWORD dwNow)
+{
+    if (CacheEntry->bHostsFileEntry)
+        return FALSE;
+
+    return (LONG)(CacheEntry->dwExpireTime - dwNow) <= 0;
+}
+
+/* The cache lock must be held */
+static
+PRESOLVER_CACHE_ENTRY
+DnsIntCacheFindEntry(
+    _In_ LPCWSTR Name,
+    _In_ ULONG Hash,
+    _In_ WORD wType)
+{
+    PLIST_ENTRY BucketHead, NextEntry;
+    PRESOLVER_CACHE_ENTRY CacheEntry;
+
+    BucketHead = &DnsCache.HashTable[Hash % DNS_CACHE_HASH_TABLE_SIZE];
+    for (NextEntry = BucketHead->Flink; NextEntry != BucketHead; NextEntry = NextEntry->Flink)
+    {
+        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, HashLink);
+
+        if (CacheEntry->Hash == Hash &&
+            CacheEntry->wType == wType &&
+            _wcsicmp(CacheEntry->pszName, Name) == 0)
+        {
+            return CacheEntry;
+        }
+    }
+
+    return NULL;
+}
+
+static
+DWORD
+WINAPI
+DnsIntCacheSweeperThread(
+    _In_ LPVOID lpParameter)
+{
+    PLIST_ENTRY Entry, NextEntry;
+    PRESOLVER_CACHE_ENTRY CacheEntry;
+    DWORD dwNow;
+
+    UNREFERENCED_PARAMETER(lpParameter);
+
+    while (WaitForSingleObject(DnsCache.StopEvent, DNS_CACHE_SWEEP_INTERVAL) == WAIT_TIMEOUT)
+    {
+        DnsCacheLock();
+
+        dwNow = GetTickCount();
+        Entry = DnsCache.RecordList.Flink;
+        while (Entry != &DnsCache.RecordList)
+        {
+            NextEntry = Entry->Flink;
+            CacheEntry = CONTAINING_RECORD(Entry, RESOLVER_CACHE_ENTRY, CacheLink);
+
+            if (DnsIntCacheIsExpired(CacheEntry, dwNow))
+            {
+                DnsIntCacheRemoveEntryItem(CacheEntry);
+                DnsCache.Expired++;
+            }
+
+            Entry = NextEntry;
+        }
+
+        DnsCacheUnlock();
+    }
+
+    return 0;
+}
 
 VOID
 DnsIntCacheInitialize(VOID)
 {
+    ULONG i;
+
     DPRINT("DnsIntCacheInitialize()\n");
 
     /* Check if we're initialized */
     if (DnsCacheInitialized)
         return;
 
-    /* Initialize the cache lock and namespace list */
-    InitializeCriticalSection((LPCRITICAL_SECTION)&DnsCache.Lock);
+    /* Initialize the cache lock, the namespace list and the hash table */
+    RtlInitializeResource(&DnsCache.Lock);
     InitializeListHead(&DnsCache.RecordList);
+    for (i = 0; i < DNS_CACHE_HASH_TABLE_SIZE; i++)
+        InitializeListHead(&DnsCache.HashTable[i]);
+
+    /* Start removing the expired entries in the background */
+    DnsCache.StopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (DnsCache.StopEvent)
+    {
+        DnsCache.SweeperThread = CreateThread(NULL,
+                                              0,
+                                              DnsIntCacheSweeperThread,
+                                              NULL,
+                                              0,
+                                              NULL);
+        if (!DnsCache.SweeperThread)
+            DPRINT1("Can't create the cache sweeper thread (%lx)\n", GetLastError());
+    }
+
     DnsCacheInitialized = TRUE;
 }
 
@@ -44,22 +155,43 @@ DnsIntCacheFree(VOID)
     if (!DnsCache.RecordList.Flink)
         return;
 
+    if (DnsCache.SweeperThread)
+    {
+        SetEvent(DnsCache.StopEvent);
+        WaitForSingleObject(DnsCache.SweeperThread, INFINITE);
+        CloseHandle(DnsCache.SweeperThread);
+        DnsCache.SweeperThread = NULL;
+    }
+
+    if (DnsCache.StopEvent)
+    {
+        CloseHandle(DnsCache.StopEvent);
+        DnsCache.StopEvent = NULL;
+    }
+
     DnsIntCacheFlush(CACHE_FLUSH_ALL);
 
-    DeleteCriticalSection(&DnsCache.Lock);
+    RtlDeleteResource(&DnsCache.Lock);
     DnsCacheInitialized = FALSE;
 }
- 
+
+/* The cache lock must be held exclusively */
 VOID
 DnsIntCacheRemoveEntryItem(PRESOLVER_CACHE_ENTRY CacheEntry)
 {
     DPRINT("DnsIntCacheRemoveEntryItem(%p)\n", CacheEntry);
 
-    /* Remove the entry from the list */
+    /* Remove the entry from the list and its bucket */
     RemoveEntryList(&CacheEntry->CacheLink);
- 
+    RemoveEntryList(&CacheEntry->HashLink);
+
+    DnsCache.Entries--;
+
     /* Free record */
-    DnsRecordListFree(CacheEntry->Record, DnsFreeRecordList);
+    if (CacheEntry->Record)
+        DnsRecordListFree(CacheEntry->Record, DnsFreeRecordList);
+    else
+        DnsCache.NegativeEntries--;
 
     /* Delete us */
     HeapFree(GetProcessHeap(), 0, CacheEntry);
@@ -101,6 +233,11 @@ DnsIntCacheFlush(
     return ERROR_SUCCESS;
 }
 
+/*
+ * Returns the cached records for the name and type, or the cached failure
+ * of a name that doesn't resolve. DNS_ERROR_RECORD_DOES_NOT_EXIST means
+ * that the cache knows nothing about the name.
+ */
 DNS_STATUS
 DnsIntCacheGetEntryByName(
     LPCWSTR Name,
@@ -108,9 +245,8 @@ DnsIntCacheGetEntryByName(
     DWORD dwFlags,
     PDNS_RECORDW *Record)
 {
-    DNS_STATUS Status = DNS_INFO_NO_RECORDS;
+    DNS_STATUS Status = DNS_ERROR_RECORD_DOES_NOT_EXIST;
     PRESOLVER_CACHE_ENTRY CacheEntry;
-    PLIST_ENTRY NextEntry;
 
     DPRINT("DnsIntCacheGetEntryByName(%S %hu 0x%lx %p)\n",
            Name, wType, dwFlags, Record);
@@ -118,26 +254,30 @@ DnsIntCacheGetEntryByName(
     /* Assume failure */
     *Record = NULL;
 
-    /* Lock the cache */
-    DnsCacheLock();
+    /* Lock the cache, lookups don't exclude each other */
+    DnsCacheLockShared();
 
-    /* Match the Id with all the entries in the List */
-    NextEntry = DnsCache.RecordList.Flink;
-    while (NextEntry != &DnsCache.RecordList)
+    /* Expired entries are left to the sweeper or to the next answer */
+    CacheEntry = DnsIntCacheFindEntry(Name, DnsIntCacheHashName(Name), wType);
+    if (CacheEntry && !DnsIntCacheIsExpired(CacheEntry, GetTickCount()))
     {
-        /* Get the Current Entry */
-        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
-
-        /* Check if this is the Catalog Entry ID we want */
-        if (_wcsicmp(CacheEntry->Record->pName, Name) == 0)
+        if (CacheEntry->Record)
         {
             /* Copy the entry and return it */
             *Record = DnsRecordSetCopyEx(CacheEntry->Record, DnsCharSetUnicode, DnsCharSetUnicode);
-            Status = ERROR_SUCCESS;
-            break;
+            Status = *Record ? ERROR_SUCCESS : ERROR_OUTOFMEMORY;
+        }
+        else
+        {
+            Status = CacheEntry->Status;
+            InterlockedIncrement(&DnsCache.NegativeHits);
         }
 
-        NextEntry = NextEntry->Flink;
+        InterlockedIncrement(&DnsCache.Hits);
+    }
+    else
+    {
+        InterlockedIncrement(&DnsCache.Misses);
     }
 
     /* Release the cache */
@@ -151,30 +291,31 @@ DnsIntCacheRemoveEntryByName(LPCWSTR Name)
 {
     BOOL Ret = FALSE;
     PRESOLVER_CACHE_ENTRY CacheEntry;
-    PLIST_ENTRY NextEntry;
+    PLIST_ENTRY BucketHead, NextEntry;
+    ULONG Hash;
 
     DPRINT("DnsIntCacheRemoveEntryByName(%S)\n", Name);
 
+    Hash = DnsIntCacheHashName(Name);
+
     /* Lock the cache */
     DnsCacheLock();
 
-    /* Match the Id with all the entries in the List */
-    NextEntry = DnsCache.RecordList.Flink;
-    while (NextEntry != &DnsCache.RecordList)
+    /* Remove the entries of all the types of the name */
+    BucketHead = &DnsCache.HashTable[Hash % DNS_CACHE_HASH_TABLE_SIZE];
+    NextEntry = BucketHead->Flink;
+    while (NextEntry != BucketHead)
     {
         /* Get the Current Entry */
-        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
+        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, HashLink);
+        NextEntry = NextEntry->Flink;
 
-        /* Check if this is the Catalog Entry ID we want */
-        if (_wcsicmp(CacheEntry->Record->pName, Name) == 0)
+        if (CacheEntry->Hash == Hash && _wcsicmp(CacheEntry->pszName, Name) == 0)
         {
             /* Remove the entry */
             DnsIntCacheRemoveEntryItem(CacheEntry);
             Ret = TRUE;
-            break;
         }
-
-        NextEntry = NextEntry->Flink;
     }
 
     /* Release the cache */
@@ -184,90 +325,210 @@ DnsIntCacheRemoveEntryByName(LPCWSTR Name)
     return Ret;
 }
 
+/*
+ * Inserts an entry for the name and type, replacing the one that may
+ * already be there. Entries from the hosts file are never replaced.
+ */
+static
 VOID
-DnsIntCacheAddEntry(
-    _In_ PDNS_RECORDW Record,
+DnsIntCacheInsertEntry(
+    _In_ LPCWSTR Name,
+    _In_ WORD wType,
+    _In_opt_ PDNS_RECORDW Record,
+    _In_ DNS_STATUS Status,
+    _In_ DWORD dwTtl,
     _In_ BOOL bHostsFileEntry)
 {
-    PRESOLVER_CACHE_ENTRY Entry;
+    PRESOLVER_CACHE_ENTRY Entry, OldEntry;
+    SIZE_T NameSize;
+    ULONG Hash;
 
-    DPRINT("DnsIntCacheAddEntry(%p %u)\n",
-           Record, bHostsFileEntry);
+    NameSize = (wcslen(Name) + 1) * sizeof(WCHAR);
+    Hash = DnsIntCacheHashName(Name);
 
-    DPRINT("Name: %S\n", Record->pName);
-    DPRINT("TTL: %lu\n", Record->dwTtl);
+    Entry = (PRESOLVER_CACHE_ENTRY)HeapAlloc(GetProcessHeap(), 0, sizeof(*Entry) + NameSize);
+    if (!Entry)
+        return;
+
+    Entry->Hash = Hash;
+    Entry->wType = wType;
+    Entry->bHostsFileEntry = bHostsFileEntry;
+    Entry->dwExpireTime = GetTickCount() + dwTtl * 1000;
+    Entry->Status = Status;
+    Entry->pszName = (PWSTR)(Entry + 1);
+    CopyMemory(Entry->pszName, Name, NameSize);
+
+    if (Record)
+    {
+        Entry->Record = DnsRecordSetCopyEx(Record, DnsCharSetUnicode, DnsCharSetUnicode);
+        if (!Entry->Record)
+        {
+            HeapFree(GetProcessHeap(), 0, Entry);
+            return;
+        }
+    }
+    else
+    {
+        Entry->Record = NULL;
+    }
 
     /* Lock the cache */
     DnsCacheLock();
 
-    /* Match the Id with all the entries in the List */
-    Entry = (PRESOLVER_CACHE_ENTRY)HeapAlloc(GetProcessHeap(), 0, sizeof(*Entry));
-    if (!Entry)
+    OldEntry = DnsIntCacheFindEntry(Name, Hash, wType);
+    if (OldEntry && OldEntry->bHostsFileEntry)
+    {
+        DnsCacheUnlock();
+
+        if (Entry->Record)
+            DnsRecordListFree(Entry->Record, DnsFreeRecordList);
+        HeapFree(GetProcessHeap(), 0, Entry);
         return;
+    }
 
-    Entry->bHostsFileEntry = bHostsFileEntry;
-    Entry->Record = DnsRecordSetCopyEx(Record, DnsCharSetUnicode, DnsCharSetUnicode);
+    if (OldEntry)
+        DnsIntCacheRemoveEntryItem(OldEntry);
 
-    /* Insert it to our List */
+    /* Insert it to our List and its bucket */
     InsertTailList(&DnsCache.RecordList, &Entry->CacheLink);
+    InsertHeadList(&DnsCache.HashTable[Hash % DNS_CACHE_HASH_TABLE_SIZE], &Entry->HashLink);
+
+    DnsCache.Entries++;
+    if (!Entry->Record)
+        DnsCache.NegativeEntries++;
 
     /* Release the cache */
     DnsCacheUnlock();
 }
 
+VOID
+DnsIntCacheAddEntry(
+    _In_ LPCWSTR Name,
+    _In_ WORD wType,
+    _In_ PDNS_RECORDW Record,
+    _In_ BOOL bHostsFileEntry)
+{
+    PDNS_RECORDW CurrentRecord;
+    DWORD dwTtl = DNS_CACHE_MAX_TTL;
+
+    DPRINT("DnsIntCacheAddEntry(%S %hu %p %u)\n",
+           Name, wType, Record, bHostsFileEntry);
+
+    /* The answer is as old as its shortest lived record */
+    for (CurrentRecord = Record; CurrentRecord; CurrentRecord = CurrentRecord->pNext)
+        dwTtl = min(dwTtl, CurrentRecord->dwTtl);
+
+    DPRINT("TTL: %lu\n", dwTtl);
+
+    if (dwTtl == 0 && !bHostsFileEntry)
+        return;
+
+    DnsIntCacheInsertEntry(Name, wType, Record, ERROR_SUCCESS, dwTtl, bHostsFileEntry);
+}
+
+VOID
+DnsIntCacheAddNegativeEntry(
+    _In_ LPCWSTR Name,
+    _In_ WORD wType,
+    _In_ DNS_STATUS Status)
+{
+    DPRINT("DnsIntCacheAddNegativeEntry(%S %hu %lu)\n",
+           Name, wType, Status);
+
+    DnsIntCacheInsertEntry(Name, wType, NULL, Status, DNS_CACHE_NEGATIVE_TTL, FALSE);
+}
+
 DNS_STATUS
 DnsIntCacheGetEntries(
     _Out_ DNS_CACHE_ENTRY **ppCacheEntries)
 {
+    DNS_STATUS Status = ERROR_SUCCESS;
     PRESOLVER_CACHE_ENTRY CacheEntry;
     PLIST_ENTRY NextEntry;
     PDNS_CACHE_ENTRY pLastEntry = NULL, pNewEntry;
+    DWORD dwNow;
 
     /* Lock the cache */
-    DnsCacheLock();
+    DnsCacheLockShared();
 
     *ppCacheEntries = NULL;
 
+    dwNow = GetTickCount();
     NextEntry = DnsCache.RecordList.Flink;
     while (NextEntry != &DnsCache.RecordList)
     {
         /* Get the Current Entry */
         CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
+        NextEntry = NextEntry->Flink;
 
-        DPRINT("1 %S %lu\n", CacheEntry->Record->pName, CacheEntry->Record->wType);
-        if (CacheEntry->Record->pNext)
-        {
-            DPRINT("2 %S %lu\n", CacheEntry->Record->pNext->pName, CacheEntry->Record->pNext->wType);
-        }
+        /* Only report the names that resolve */
+        if (!CacheEntry->Record || DnsIntCacheIsExpired(CacheEntry, dwNow))
+            continue;
+
+        DPRINT("1 %S %lu\n", CacheEntry->pszName, CacheEntry->wType);
 
         pNewEntry = midl_user_allocate(sizeof(DNS_CACHE_ENTRY));
         if (pNewEntry == NULL)
         {
-            return ERROR_OUTOFMEMORY;
+            Status = ERROR_OUTOFMEMORY;
+            break;
         }
 
-        pNewEntry->pszName = midl_user_allocate((wcslen(CacheEntry->Record->pName) + 1) * sizeof(WCHAR));
+        pNewEntry->pszName = midl_user_allocate((wcslen(CacheEntry->pszName) + 1) * sizeof(WCHAR));
         if (pNewEntry->pszName == NULL)
         {
-            return ERROR_OUTOFMEMORY;
+            midl_user_free(pNewEntry);
+            Status = ERROR_OUTOFMEMORY;
+            break;
         }
 
-        wcscpy(pNewEntry->pszName, CacheEntry->Record->pName);
-        pNewEntry->wType1 = CacheEntry->Record->wType;
+        wcscpy(pNewEntry->pszName, CacheEntry->pszName);
+        pNewEntry->wType1 = CacheEntry->wType;
         pNewEntry->wType2 = 0;
         pNewEntry->wFlags = 0;
+        pNewEntry->pNext = NULL;
 
         if (pLastEntry == NULL)
             *ppCacheEntries = pNewEntry;
         else
             pLastEntry->pNext = pNewEntry;
         pLastEntry = pNewEntry;
-
-        NextEntry = NextEntry->Flink;
     }
 
     /* Release the cache */
     DnsCacheUnlock();
 
-    return ERROR_SUCCESS;
+    /* Do not return a partial list */
+    if (Status != ERROR_SUCCESS)
+    {
+        while (*ppCacheEntries != NULL)
+        {
+            pNewEntry = *ppCacheEntries;
+            *ppCacheEntries = pNewEntry->pNext;
+
+            midl_user_free(pNewEntry->pszName);
+            midl_user_free(pNewEntry);
+        }
+    }
+
+    return Status;
+}
+
+VOID
+DnsIntCacheGetStats(
+    _Out_ PDNS_CACHE_STATS pCacheStats)
+{
+    /* Lock the cache, so that the counts match each other */
+    DnsCacheLock();
+
+    pCacheStats->dwHashTableSize = DNS_CACHE_HASH_TABLE_SIZE;
+    pCacheStats->dwEntries = DnsCache.Entries;
+    pCacheStats->dwNegativeEntries = DnsCache.NegativeEntries;
+    pCacheStats->dwHits = DnsCache.Hits;
+    pCacheStats->dwNegativeHits = DnsCache.NegativeHits;
+    pCacheStats->dwMisses = DnsCache.Misses;
+    pCacheStats->dwExpired = DnsCache.Expired;
+
+    /* Release the cache */
+    DnsCacheUnlock();
 }
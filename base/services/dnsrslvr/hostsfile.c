@@ -130,8 +130,8 @@ AddIpv4HostEntries(
 
     PtrRecord.Data.PTR.pNameHost = pszHostName;
 
-    DnsIntCacheAddEntry(&ARecord, TRUE);
-    DnsIntCacheAddEntry(&PtrRecord, TRUE);
+    DnsIntCacheAddEntry(ARecord.pName, ARecord.wType, &ARecord, TRUE);
+    DnsIntCacheAddEntry(PtrRecord.pName, PtrRecord.wType, &PtrRecord, TRUE);
 }
 
 
@@ -184,8 +184,8 @@ AddIpv6HostEntries(
 
     PtrRecord.Data.PTR.pNameHost = pszHostName;
 
-    DnsIntCacheAddEntry(&AAAARecord, TRUE);
-    DnsIntCacheAddEntry(&PtrRecord, TRUE);
+    DnsIntCacheAddEntry(AAAARecord.pName, AAAARecord.wType, &AAAARecord, TRUE);
+    DnsIntCacheAddEntry(PtrRecord.pName, PtrRecord.wType, &PtrRecord, TRUE);
 }
 
 
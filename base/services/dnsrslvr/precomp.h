@@ -24,17 +24,44 @@
 
 #include <strsafe.h>
 
+/* Number of hash buckets, as in the registry default of Windows */
+#define DNS_CACHE_HASH_TABLE_SIZE   211
+
+/* Longest time a positive answer stays in the cache, in seconds */
+#define DNS_CACHE_MAX_TTL           86400
+
+/* Time a name that doesn't resolve stays in the cache, in seconds */
+#define DNS_CACHE_NEGATIVE_TTL      300
+
+/* Interval between two sweeps of the expired entries, in milliseconds */
+#define DNS_CACHE_SWEEP_INTERVAL    (60 * 1000)
+
 typedef struct _RESOLVER_CACHE_ENTRY
 {
     LIST_ENTRY CacheLink;
+    LIST_ENTRY HashLink;
+    ULONG Hash;
+    WORD wType;
     BOOL bHostsFileEntry;
-    PDNS_RECORDW Record;
+    DWORD dwExpireTime;     /* Tick count, unused for hosts file entries */
+    DNS_STATUS Status;      /* Result of a negative entry */
+    PDNS_RECORDW Record;    /* NULL for a negative entry */
+    PWSTR pszName;
 } RESOLVER_CACHE_ENTRY, *PRESOLVER_CACHE_ENTRY;
 
 typedef struct _RESOLVER_CACHE
 {
     LIST_ENTRY RecordList;
-    CRITICAL_SECTION Lock;
+    LIST_ENTRY HashTable[DNS_CACHE_HASH_TABLE_SIZE];
+    RTL_RESOURCE Lock;
+    HANDLE SweeperThread;
+    HANDLE StopEvent;
+    ULONG Entries;
+    ULONG NegativeEntries;
+    LONG Hits;
+    LONG NegativeHits;
+    LONG Misses;
+    LONG Expired;
 } RESOLVER_CACHE, *PRESOLVER_CACHE;
 
 
@@ -61,9 +88,17 @@ DnsIntCacheGetEntryByName(
 
 VOID
 DnsIntCacheAddEntry(
+    _In_ LPCWSTR Name,
+    _In_ WORD wType,
     _In_ PDNS_RECORDW Record,
     _In_ BOOL bHostsFileEntry);
 
+VOID
+DnsIntCacheAddNegativeEntry(
+    _In_ LPCWSTR Name,
+    _In_ WORD wType,
+    _In_ DNS_STATUS Status);
+
 BOOL
 DnsIntCacheRemoveEntryByName(
     _In_ LPCWSTR Name);
@@ -72,6 +107,10 @@ DNS_STATUS
 DnsIntCacheGetEntries(
     _Out_ DNS_CACHE_ENTRY **ppCacheEntries);
 
+VOID
+DnsIntCacheGetStats(
+    _Out_ PDNS_CACHE_STATS pCacheStats);
+
 
 /* hostsfile.c */
 
@@ -56,6 +56,25 @@ CRrReadCache(
 }
 
 
+/* Function: 0x02 */
+DWORD
+__stdcall
+CRrGetHashTableStats(
+    _In_ DNSRSLVR_HANDLE pwszServerName,
+    _Out_ DNS_CACHE_STATS *pCacheStats)
+{
+    DPRINT("CRrGetHashTableStats(%S %p)\n",
+           pwszServerName, pCacheStats);
+
+    if (pCacheStats == NULL)
+        return ERROR_INVALID_PARAMETER;
+
+    DnsIntCacheGetStats(pCacheStats);
+
+    return ERROR_SUCCESS;
+}
+
+
 /* Function: 0x04 */
 DWORD
 __stdcall
@@ -115,7 +134,7 @@ R_ResolverQuery(
                                            wType,
                                            dwFlags,
                                            ppResultRecords);
-        if (Status == DNS_INFO_NO_RECORDS)
+        if (Status == DNS_ERROR_RECORD_DOES_NOT_EXIST)
         {
             DPRINT("DNS query!\n");
             Status = Query_Main(pszName,
@@ -125,7 +144,12 @@ R_ResolverQuery(
             if (Status == ERROR_SUCCESS)
             {
                 DPRINT("DNS query successful!\n");
-                DnsIntCacheAddEntry(*ppResultRecords, FALSE);
+                DnsIntCacheAddEntry(pszName, wType, *ppResultRecords, FALSE);
+            }
+            else if (Status == DNS_ERROR_RCODE_NAME_ERROR || Status == DNS_INFO_NO_RECORDS)
+            {
+                /* Remember that the name doesn't resolve, for a while */
+                DnsIntCacheAddNegativeEntry(pszName, wType, Status);
             }
         }
     }
@@ -728,7 +728,7 @@ LogfReadEvents(PLOGFILE LogFile,
                BOOLEAN  Ansi)
 {
     NTSTATUS Status;
-    ULONG RecNum;
+    ULONG RecNum, RecordCount;
     SIZE_T ReadLength, NeededSize;
     ULONG BufferUsage;
 
@@ -783,13 +783,28 @@ LogfReadEvents(PLOGFILE LogFile,
     BufferUsage = 0;
     do
     {
-        Status = ReadRecord(&LogFile->LogFile,
-                            RecNum,
-                            (PEVENTLOGRECORD)(Buffer + BufferUsage),
-                            BufSize - BufferUsage,
-                            &ReadLength,
-                            &NeededSize,
-                            Ansi);
+        /* Forward reads get as many records as possible at once */
+        RecordCount = 1;
+        if ((Flags & EVENTLOG_FORWARDS_READ) && !Ansi)
+        {
+            Status = ElfReadRecords(&LogFile->LogFile,
+                                    RecNum,
+                                    (PEVENTLOGRECORD)(Buffer + BufferUsage),
+                                    BufSize - BufferUsage,
+                                    &ReadLength,
+                                    &NeededSize,
+                                    &RecordCount);
+        }
+        else
+        {
+            Status = ReadRecord(&LogFile->LogFile,
+                                RecNum,
+                                (PEVENTLOGRECORD)(Buffer + BufferUsage),
+                                BufSize - BufferUsage,
+                                &ReadLength,
+                                &NeededSize,
+                                Ansi);
+        }
         if (Status == STATUS_NOT_FOUND)
         {
             if (BufferUsage == 0)
@@ -831,7 +846,7 @@ LogfReadEvents(PLOGFILE LogFile,
          * "get_next_record_number" function.
          */
         if (Flags & EVENTLOG_FORWARDS_READ)
-            RecNum++;
+            RecNum += RecordCount;
         else // if (Flags & EVENTLOG_BACKWARDS_READ)
             RecNum--;
 
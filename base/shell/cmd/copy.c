@@ -47,6 +47,172 @@ enum
     COPY_BINARY      = 0x100,   /* /B  */
 };
 
+/* Size of each of the two buffers of CopyOverlapped, and the smallest
+   file size for which it is used */
+#define COPY_CHUNK_SIZE (1024 * 1024)
+
+static BOOL
+ReadChunk(HANDLE hFile,
+          LPBYTE buffer,
+          ULONGLONG Offset,
+          LPOVERLAPPED lpOverlapped,
+          LPDWORD lpdwRead,
+          PBOOL pbPending)
+{
+    lpOverlapped->Offset = (DWORD)Offset;
+    lpOverlapped->OffsetHigh = (DWORD)(Offset >> 32);
+
+    *lpdwRead = 0;
+    *pbPending = FALSE;
+    if (ReadFile(hFile, buffer, COPY_CHUNK_SIZE, lpdwRead, lpOverlapped))
+        return TRUE;
+
+    if (GetLastError() == ERROR_IO_PENDING)
+    {
+        *pbPending = TRUE;
+        return TRUE;
+    }
+
+    return (GetLastError() == ERROR_HANDLE_EOF);
+}
+
+static BOOL
+WriteChunk(HANDLE hFile,
+           LPBYTE buffer,
+           DWORD dwSize,
+           ULONGLONG Offset,
+           LPOVERLAPPED lpOverlapped,
+           LPDWORD lpdwWritten,
+           PBOOL pbPending)
+{
+    lpOverlapped->Offset = (DWORD)Offset;
+    lpOverlapped->OffsetHigh = (DWORD)(Offset >> 32);
+
+    *lpdwWritten = 0;
+    *pbPending = FALSE;
+    if (WriteFile(hFile, buffer, dwSize, lpdwWritten, lpOverlapped))
+        return TRUE;
+
+    if (GetLastError() == ERROR_IO_PENDING)
+    {
+        *pbPending = TRUE;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Waits for a request started by ReadChunk or WriteChunk. Requests that
+   completed right away (devices ignore the OVERLAPPED structure) are not
+   waited for, their event may never be signaled. */
+static BOOL
+WaitChunk(HANDLE hFile,
+          LPOVERLAPPED lpOverlapped,
+          LPDWORD lpdwTransferred,
+          PBOOL pbPending)
+{
+    if (!*pbPending)
+        return TRUE;
+
+    *pbPending = FALSE;
+    if (GetOverlappedResult(hFile, lpOverlapped, lpdwTransferred, TRUE))
+        return TRUE;
+
+    *lpdwTransferred = 0;
+    return (GetLastError() == ERROR_HANDLE_EOF);
+}
+
+/*
+ * Copies a large file in binary mode. The source and destination handles
+ * are opened with FILE_FLAG_OVERLAPPED, and the file goes through the two
+ * halves of buffer in turn: the next chunk is read while the previous one
+ * is being written. DestOffset is where the writing starts, on return it
+ * is advanced past the data that was written.
+ */
+static BOOL
+CopyOverlapped(HANDLE hFileSrc,
+               HANDLE hFileDest,
+               LPBYTE buffer,
+               PLARGE_INTEGER DestOffset)
+{
+    OVERLAPPED ovRead, ovWrite;
+    ULONGLONG SrcOffset = 0;
+    ULONGLONG WriteOffset = DestOffset->QuadPart;
+    DWORD dwRead = 0, dwToWrite = 0, dwWritten = 0;
+    BOOL bReadPending = FALSE, bWritePending = FALSE;
+    BOOL bSuccess = FALSE;
+    INT i = 0;
+
+    ZeroMemory(&ovRead, sizeof(ovRead));
+    ZeroMemory(&ovWrite, sizeof(ovWrite));
+    ovRead.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    ovWrite.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (ovRead.hEvent == NULL || ovWrite.hEvent == NULL)
+        goto Quit;
+
+    if (!ReadChunk(hFileSrc, buffer, SrcOffset, &ovRead, &dwRead, &bReadPending))
+        goto Quit;
+
+    for (;;)
+    {
+        if (!WaitChunk(hFileSrc, &ovRead, &dwRead, &bReadPending))
+            goto Quit;
+
+        if (!WaitChunk(hFileDest, &ovWrite, &dwWritten, &bWritePending) ||
+            dwWritten != dwToWrite)
+        {
+            goto Quit;
+        }
+        DestOffset->QuadPart += dwWritten;
+
+        if (dwRead == 0)
+            break;
+
+        if (CheckCtrlBreak(BREAK_INPUT))
+            goto Quit;
+
+        /* Write the chunk that was just read, and read the next one
+           into the other half of the buffer meanwhile */
+        dwToWrite = dwRead;
+        if (!WriteChunk(hFileDest, buffer + i * COPY_CHUNK_SIZE, dwToWrite,
+                        WriteOffset, &ovWrite, &dwWritten, &bWritePending))
+        {
+            goto Quit;
+        }
+        WriteOffset += dwToWrite;
+        SrcOffset += dwRead;
+
+        i ^= 1;
+        if (!ReadChunk(hFileSrc, buffer + i * COPY_CHUNK_SIZE, SrcOffset,
+                       &ovRead, &dwRead, &bReadPending))
+        {
+            goto Quit;
+        }
+    }
+
+    bSuccess = TRUE;
+
+Quit:
+    /* Do not leave requests running on the buffer when failing */
+    if (bReadPending)
+    {
+        CancelIo(hFileSrc);
+        GetOverlappedResult(hFileSrc, &ovRead, &dwRead, TRUE);
+    }
+    if (bWritePending)
+    {
+        CancelIo(hFileDest);
+        GetOverlappedResult(hFileDest, &ovWrite, &dwWritten, TRUE);
+    }
+
+    if (ovRead.hEvent)
+        CloseHandle(ovRead.hEvent);
+    if (ovWrite.hEvent)
+        CloseHandle(ovWrite.hEvent);
+
+    return bSuccess;
+}
+
 INT
 copy(TCHAR source[MAX_PATH],
      TCHAR dest[MAX_PATH],
@@ -58,6 +224,11 @@ copy(TCHAR source[MAX_PATH],
     HANDLE hFileSrc;
     HANDLE hFileDest;
     LPBYTE buffer;
+    WIN32_FILE_ATTRIBUTE_DATA SrcData;
+    LARGE_INTEGER SrcSize, DestOffset;
+    BOOL   bOverlapped = FALSE;
+    BOOL   bPreallocated = FALSE;
+    DWORD  dwFlagsAndAttributes;
     DWORD  dwAttrib;
     DWORD  dwRead;
     DWORD  dwWritten;
@@ -102,8 +273,19 @@ copy(TCHAR source[MAX_PATH],
 
     dwAttrib = GetFileAttributes (source);
 
+    /* Large binary copies go through CopyOverlapped. Devices have no
+       attributes, so they always use the plain loop below. */
+    if (!(lpdwFlags & COPY_ASCII) &&
+        GetFileAttributesEx(source, GetFileExInfoStandard, &SrcData) &&
+        !(SrcData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+        (SrcData.nFileSizeHigh != 0 || SrcData.nFileSizeLow >= COPY_CHUNK_SIZE))
+    {
+        bOverlapped = TRUE;
+    }
+    dwFlagsAndAttributes = bOverlapped ? FILE_FLAG_OVERLAPPED : 0;
+
     hFileSrc = CreateFile (source, GENERIC_READ, FILE_SHARE_READ,
-        NULL, OPEN_EXISTING, 0, NULL);
+        NULL, OPEN_EXISTING, dwFlagsAndAttributes | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
     if (hFileSrc == INVALID_HANDLE_VALUE)
     {
         ConOutResPrintf(STRING_COPY_ERROR1, source);
@@ -159,7 +341,7 @@ copy(TCHAR source[MAX_PATH],
     {
         TRACE ("opening/creating\n");
         hFileDest =
-            CreateFile (dest, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+            CreateFile (dest, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, dwFlagsAndAttributes, NULL);
     }
     else if (!append)
     {
@@ -169,7 +351,7 @@ copy(TCHAR source[MAX_PATH],
         TRACE ("DeleteFile (%s);\n", debugstr_aw(dest));
         DeleteFile (dest);
 
-        hFileDest =	CreateFile (dest, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        hFileDest =	CreateFile (dest, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, dwFlagsAndAttributes, NULL);
     }
     else
     {
@@ -185,7 +367,7 @@ copy(TCHAR source[MAX_PATH],
         SetFileAttributes (dest, FILE_ATTRIBUTE_NORMAL);
 
         hFileDest =
-            CreateFile (dest, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+            CreateFile (dest, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, dwFlagsAndAttributes, NULL);
 
         /* Move to end of file to start writing */
         SetFilePointer (hFileDest, 0, &lFilePosHigh,FILE_END);
@@ -201,7 +383,8 @@ copy(TCHAR source[MAX_PATH],
     }
 
     /* A page-aligned buffer usually give more speed */
-    buffer = VirtualAlloc(NULL, BUFF_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    buffer = VirtualAlloc(NULL, bOverlapped ? 2 * COPY_CHUNK_SIZE : BUFF_SIZE,
+                          MEM_COMMIT, PAGE_READWRITE);
     if (buffer == NULL)
     {
         CloseHandle (hFileDest);
@@ -211,36 +394,83 @@ copy(TCHAR source[MAX_PATH],
         return 0;
     }
 
-    do
+    if (bOverlapped)
     {
-        ReadFile (hFileSrc, buffer, BUFF_SIZE, &dwRead, NULL);
-        if (lpdwFlags & COPY_ASCII)
+        DestOffset.QuadPart = 0;
+        SrcSize.LowPart = SrcData.nFileSizeLow;
+        SrcSize.HighPart = SrcData.nFileSizeHigh;
+
+        if (append)
         {
-            LPBYTE pEof = memchr(buffer, 0x1A, dwRead);
-            if (pEof != NULL)
-            {
-                bEof = TRUE;
-                dwRead = pEof-buffer+1;
-                break;
-            }
+            /* The file pointer is not used by overlapped writes */
+            if (!GetFileSizeEx (hFileDest, &DestOffset))
+                DestOffset.QuadPart = 0;
+        }
+        else if (GetFileType (hFileDest) == FILE_TYPE_DISK)
+        {
+            /* Allocate the whole destination at once rather than growing
+               it with every write */
+            bPreallocated = SetFilePointerEx (hFileDest, SrcSize, NULL, FILE_BEGIN) &&
+                            SetEndOfFile (hFileDest);
         }
 
-        if (dwRead == 0)
-            break;
-
-        WriteFile (hFileDest, buffer, dwRead, &dwWritten, NULL);
-        if (dwWritten != dwRead || CheckCtrlBreak(BREAK_INPUT))
+        if (!CopyOverlapped (hFileSrc, hFileDest, buffer, &DestOffset))
         {
             ConOutResPuts(STRING_COPY_ERROR3);
 
+            if (bPreallocated)
+            {
+                SetFilePointerEx (hFileDest, DestOffset, NULL, FILE_BEGIN);
+                SetEndOfFile (hFileDest);
+            }
+
             VirtualFree (buffer, 0, MEM_RELEASE);
             CloseHandle (hFileDest);
             CloseHandle (hFileSrc);
             nErrorLevel = 1;
             return 0;
         }
+
+        /* The source may have changed size since it was looked at */
+        if (bPreallocated && DestOffset.QuadPart != SrcSize.QuadPart)
+        {
+            SetFilePointerEx (hFileDest, DestOffset, NULL, FILE_BEGIN);
+            SetEndOfFile (hFileDest);
+        }
+    }
+    else
+    {
+        do
+        {
+            ReadFile (hFileSrc, buffer, BUFF_SIZE, &dwRead, NULL);
+            if (lpdwFlags & COPY_ASCII)
+            {
+                LPBYTE pEof = memchr(buffer, 0x1A, dwRead);
+                if (pEof != NULL)
+                {
+                    bEof = TRUE;
+                    dwRead = pEof-buffer+1;
+                    break;
+                }
+            }
+
+            if (dwRead == 0)
+                break;
+
+            WriteFile (hFileDest, buffer, dwRead, &dwWritten, NULL);
+            if (dwWritten != dwRead || CheckCtrlBreak(BREAK_INPUT))
+            {
+                ConOutResPuts(STRING_COPY_ERROR3);
+
+                VirtualFree (buffer, 0, MEM_RELEASE);
+                CloseHandle (hFileDest);
+                CloseHandle (hFileSrc);
+                nErrorLevel = 1;
+                return 0;
+            }
+        }
+        while (!bEof);
     }
-    while (!bEof);
 
     TRACE ("setting time\n");
     SetFileTime (hFileDest, &srctime, NULL, NULL);
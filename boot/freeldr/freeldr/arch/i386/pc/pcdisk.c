@@ -833,11 +833,12 @@ PcDiskGetCacheableBlockCount(UCHAR DriveNumber)
         return 1; // Unknown count.
 
     /*
-     * If LBA is supported then the block size will be 64 sectors (32k).
+     * If LBA is supported then the block size will be 32 sectors (16k),
+     * so that the cache reads three blocks with one 127 sector read.
      * If not then the block size is the size of one track.
      */
     if (DiskDrive->Int13ExtensionsSupported)
-        return 64;
+        return 32;
     else
         return DiskDrive->Geometry.Sectors;
 }
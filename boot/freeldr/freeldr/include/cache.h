@@ -23,22 +23,32 @@
 #define TAG_CACHE_DATA 'DcaC'
 #define TAG_CACHE_BLOCK 'BcaC'
 
+// Number of hash buckets used to look up cached blocks, must be a power of two.
+// Consecutive blocks land in consecutive buckets.
+#define CACHE_HASH_BUCKETS 256
+#define CACHE_HASH_BLOCK(BlockNumber) ((BlockNumber) & (CACHE_HASH_BUCKETS - 1))
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached block element. The disk is divided up into
 // cache blocks. For disks which LBA is not supported each block is the size of
 // one track. This will force the cache manager to make track sized reads, and
-// therefore maximizes throughput. For disks which support LBA the block size
-// is 64k because they have no cylinder, head, or sector boundaries.
+// therefore maximizes throughput. Disks which support LBA have no cylinder,
+// head, or sector boundaries, and the block size is picked by the machine's
+// DiskGetCacheableBlockCount(): 32 sectors (16k) on PCs, so that one read of
+// the BIOS disk buffer fills a block and its read-ahead, 64 sectors (32k) on
+// Xbox and PC-98. Block N starts at sector N * CACHE_DRIVE::BlockSize.
 //
 ///////////////////////////////////////////////////////////////////////////////////////
 typedef struct
 {
     LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    HashEntry;                    // Links the block in its hash bucket
 
-    ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
+    ULONG            BlockNumber;                // First sector / BlockSize: track index for CHS, block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
     ULONG            AccessCount;                // Access count for this block
+    BOOLEAN        ReadAhead;                    // Block was read ahead and has not been accessed yet
 
     PVOID        BlockData;                    // Pointer to block data
 
@@ -57,10 +67,28 @@ typedef struct
     ULONG            BytesPerSector;
 
     ULONG            BlockSize;            // Block size (in sectors)
-    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    ULONG            ReadAheadBlocks;        // Maximum number of blocks read by one disk read
+    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures, most recently used first
+    LIST_ENTRY        HashTable[CACHE_HASH_BUCKETS];    // Contains CACHE_BLOCK structures, hashed by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
+///////////////////////////////////////////////////////////////////////////////////////
+//
+// Cache statistics, accumulated over all drives since boot.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    ULONGLONG        BytesRead;            // Bytes read from disk
+    ULONG            ReadsIssued;        // Disk reads issued
+    ULONG            Hits;                // Block lookups satisfied from the cache
+    ULONG            Misses;                // Block lookups that went to the disk
+    ULONG            ReadAheadBlocks;    // Blocks read ahead of the requested one
+    ULONG            ReadAheadHits;        // Read ahead blocks that were used later
+
+} CACHE_STATISTICS, *PCACHE_STATISTICS;
+
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //
@@ -72,6 +100,7 @@ extern    BOOLEAN            CacheManagerInitialized;
 extern    ULONG                CacheBlockCount;
 extern    SIZE_T                CacheSizeLimit;
 extern    SIZE_T                CacheSizeCurrent;
+extern    CACHE_STATISTICS    CacheStatistics;
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //
@@ -92,3 +121,4 @@ VOID    CacheInvalidateCacheData(VOID);
 BOOLEAN    CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer);
 BOOLEAN    CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount);
 BOOLEAN    CacheReleaseMemory(ULONG MinimumAmountToRelease);
+VOID    CacheReportStatistics(VOID);
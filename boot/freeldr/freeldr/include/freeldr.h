@@ -91,6 +91,7 @@
 #include <fs/iso.h>
 #include <fs/pxe.h>
 #include <fs/btrfs.h>
+#include <fs/bundle.h>
 
 /* UI support */
 #include <ui/gui.h>
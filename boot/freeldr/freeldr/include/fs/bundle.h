@@ -0,0 +1,11 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot bundle support
+ */
+
+#pragma once
+
+ARC_STATUS BundleLoad(PCSTR SystemRoot);
+VOID BundleUnload(VOID);
+const DEVVTBL* BundleMount(PCSTR Path);
@@ -37,51 +37,46 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     {
         TRACE("Cache hit! BlockNumber: %d CacheBlock->BlockNumber: %d\n", BlockNumber, CacheBlock->BlockNumber);
 
+        CacheStatistics.Hits++;
+        CacheBlock->AccessCount++;
+        if (CacheBlock->ReadAhead)
+        {
+            CacheStatistics.ReadAheadHits++;
+            CacheBlock->ReadAhead = FALSE;
+        }
+
+        // Keep the block list in LRU order
+        CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+
         return CacheBlock;
     }
 
     TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
 
-    CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
-
-    // Optimize the block list so it has a LRU structure
-    CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+    CacheStatistics.Misses++;
 
-    return CacheBlock;
+    // This puts the block at the head of the list
+    return CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
 }
 
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PLIST_ENTRY        BucketHead;
+    PLIST_ENTRY        Entry;
+    PCACHE_BLOCK    CacheBlock;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
     //
-    // Make sure the block list has entries before I start searching it.
+    // Only the blocks hashed to the same bucket need to be searched
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    BucketHead = &CacheDrive->HashTable[CACHE_HASH_BLOCK(BlockNumber)];
+    for (Entry = BucketHead->Flink; Entry != BucketHead; Entry = Entry->Flink)
     {
-        //
-        // Search the list and find the BIOS drive number
-        //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashEntry);
+        if (CacheBlock->BlockNumber == BlockNumber)
         {
-            //
-            // We found the block, so return it
-            //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
-
-                return CacheBlock;
-            }
-
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
+            return CacheBlock;
         }
     }
 
@@ -91,51 +86,100 @@ PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
     PCACHE_BLOCK    CacheBlock = NULL;
+    ULONG            BlockBytes;
+    ULONG            BlockCount;
+    ULONG            Idx;
 
     TRACE("CacheInternalAddBlockToCache() BlockNumber = %d\n", BlockNumber);
 
-    // Check the size of the cache so we don't exceed our limits
-    CacheInternalCheckCacheSizeLimits(CacheDrive);
+    BlockBytes = CacheDrive->BlockSize * CacheDrive->BytesPerSector;
 
-    // We will need to add the block to the
-    // drive's list of cached blocks. So allocate
-    // the block memory.
-    CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
-    if (CacheBlock == NULL)
+    //
+    // Read ahead the following blocks that are not cached yet,
+    // as many as fit in the disk read buffer with a single read
+    //
+    for (BlockCount = 1; BlockCount < CacheDrive->ReadAheadBlocks; BlockCount++)
     {
-        return NULL;
+        if (BlockNumber + BlockCount < BlockNumber ||
+            CacheInternalFindBlock(CacheDrive, BlockNumber + BlockCount) != NULL)
+        {
+            break;
+        }
     }
 
-    // Now initialize the structure and
-    // allocate room for the block data
-    RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
-    CacheBlock->BlockNumber = BlockNumber;
-    CacheBlock->BlockData = FrLdrTempAlloc(CacheDrive->BlockSize * CacheDrive->BytesPerSector,
-                                           TAG_CACHE_DATA);
-    if (CacheBlock->BlockData ==NULL)
+    CacheStatistics.ReadsIssued++;
+    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber,
+                                    (ULONGLONG)BlockNumber * CacheDrive->BlockSize,
+                                    BlockCount * CacheDrive->BlockSize,
+                                    DiskReadBuffer))
     {
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
+        // The read ahead may go past the end of the disk, retry with the requested block alone
+        if (BlockCount == 1)
+        {
+            return NULL;
+        }
+        BlockCount = 1;
+
+        CacheStatistics.ReadsIssued++;
+        if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber,
+                                        (ULONGLONG)BlockNumber * CacheDrive->BlockSize,
+                                        CacheDrive->BlockSize,
+                                        DiskReadBuffer))
+        {
+            return NULL;
+        }
     }
+    CacheStatistics.BytesRead += BlockCount * BlockBytes;
 
-    // Now try to read in the block
-    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, (BlockNumber * CacheDrive->BlockSize), CacheDrive->BlockSize, DiskReadBuffer))
+    //
+    // Add the blocks last to first, so that the requested
+    // block ends up at the head of the LRU list
+    //
+    for (Idx = BlockCount; Idx-- > 0; )
     {
-        FrLdrTempFree(CacheBlock->BlockData, TAG_CACHE_DATA);
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
-    RtlCopyMemory(CacheBlock->BlockData, DiskReadBuffer, CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+        // Check the size of the cache so we don't exceed our limits
+        CacheInternalCheckCacheSizeLimits(CacheDrive);
+
+        // We will need to add the block to the
+        // drive's list of cached blocks. So allocate
+        // the block memory.
+        CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
+        if (CacheBlock == NULL)
+        {
+            continue;
+        }
 
-    // Add it to our list of blocks managed by the cache
-    InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+        // Now initialize the structure and
+        // allocate room for the block data
+        RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
+        CacheBlock->BlockNumber = BlockNumber + Idx;
+        CacheBlock->ReadAhead = (Idx != 0);
+        CacheBlock->BlockData = FrLdrTempAlloc(BlockBytes, TAG_CACHE_DATA);
+        if (CacheBlock->BlockData == NULL)
+        {
+            FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
+            CacheBlock = NULL;
+            continue;
+        }
+        RtlCopyMemory(CacheBlock->BlockData, (PUCHAR)DiskReadBuffer + Idx * BlockBytes, BlockBytes);
 
-    // Update the cache data
-    CacheBlockCount++;
-    CacheSizeCurrent = CacheBlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+        // Add it to our list of blocks managed by the cache
+        InsertHeadList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+        InsertHeadList(&CacheDrive->HashTable[CACHE_HASH_BLOCK(CacheBlock->BlockNumber)], &CacheBlock->HashEntry);
+
+        if (Idx != 0)
+        {
+            CacheStatistics.ReadAheadBlocks++;
+        }
+
+        // Update the cache data
+        CacheBlockCount++;
+        CacheSizeCurrent = CacheBlockCount * BlockBytes;
+    }
 
     CacheInternalDumpBlockList(CacheDrive);
 
+    // CacheBlock is the requested block, or NULL if we ran out of memory for it
     return CacheBlock;
 }
 
@@ -156,12 +200,13 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashEntry);
 
     // Free the block memory and the block structure
     FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
@@ -208,6 +253,7 @@ VOID CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive)
         TRACE("Cache Block: CacheBlock: 0x%x\n", CacheBlock);
         TRACE("Cache Block: Block Number: %d\n", CacheBlock->BlockNumber);
         TRACE("Cache Block: Access Count: %d\n", CacheBlock->AccessCount);
+        TRACE("Cache Block: Read Ahead: %d\n", CacheBlock->ReadAhead);
         TRACE("Cache Block: Block Data: 0x%x\n", CacheBlock->BlockData);
         TRACE("Cache Block: Locked In Cache: %d\n", CacheBlock->LockedInCache);
 
@@ -33,11 +33,14 @@ BOOLEAN            CacheManagerDataInvalid = FALSE;
 ULONG            CacheBlockCount = 0;
 SIZE_T            CacheSizeLimit = 0;
 SIZE_T            CacheSizeCurrent = 0;
+CACHE_STATISTICS    CacheStatistics;
 
 BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 {
     PCACHE_BLOCK    NextCacheBlock;
     GEOMETRY    DriveGeometry;
+    ULONG        BlockBytes;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
     // by all means lets keep it, unless it is a removable
@@ -80,6 +83,10 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Initialize the structure
     RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
     InitializeListHead(&CacheManagerDrive.CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_HASH_BUCKETS; Idx++)
+    {
+        InitializeListHead(&CacheManagerDrive.HashTable[Idx]);
+    }
     CacheManagerDrive.DriveNumber = DriveNumber;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
@@ -95,11 +102,19 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     CacheSizeLimit = TotalPagesInLookupTable / 8 * MM_PAGE_SIZE;
     CacheSizeLimit = min(CacheSizeLimit, TEMP_HEAP_SIZE - (128 * 1024));
 
+    // Read ahead as many blocks as the disk read buffer holds, but
+    // never so many that a single read would flush most of the cache
+    BlockBytes = CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector;
+    CacheManagerDrive.ReadAheadBlocks = (ULONG)(DiskReadBufferSize / BlockBytes);
+    CacheManagerDrive.ReadAheadBlocks = min(CacheManagerDrive.ReadAheadBlocks, (ULONG)(CacheSizeLimit / BlockBytes / 4));
+    CacheManagerDrive.ReadAheadBlocks = max(CacheManagerDrive.ReadAheadBlocks, 1);
+
     CacheManagerInitialized = TRUE;
 
     TRACE("Initializing BIOS drive 0x%x.\n", DriveNumber);
     TRACE("BytesPerSector: %d.\n", CacheManagerDrive.BytesPerSector);
     TRACE("BlockSize: %d.\n", CacheManagerDrive.BlockSize);
+    TRACE("ReadAheadBlocks: %d.\n", CacheManagerDrive.ReadAheadBlocks);
     TRACE("CacheSizeLimit: %d.\n", CacheSizeLimit);
 
     return TRUE;
@@ -319,3 +334,25 @@ BOOLEAN CacheReleaseMemory(ULONG MinimumAmountToRelease)
     // Return status
     return (AmountReleased >= MinimumAmountToRelease);
 }
+
+VOID CacheReportStatistics(VOID)
+{
+    ULONG    Lookups;
+    ULONG    HitRate;
+
+    Lookups = CacheStatistics.Hits + CacheStatistics.Misses;
+    if (Lookups == 0)
+    {
+        return;
+    }
+
+    // In tenths of a percent
+    HitRate = (ULONG)(((ULONGLONG)CacheStatistics.Hits * 1000) / Lookups);
+
+    TRACE("Disk cache: %I64u bytes read in %lu reads\n",
+          CacheStatistics.BytesRead, CacheStatistics.ReadsIssued);
+    TRACE("Disk cache: %lu hits, %lu misses, hit rate %lu.%lu%%\n",
+          CacheStatistics.Hits, CacheStatistics.Misses, HitRate / 10, HitRate % 10);
+    TRACE("Disk cache: %lu blocks read ahead, %lu of them used\n",
+          CacheStatistics.ReadAheadBlocks, CacheStatistics.ReadAheadHits);
+}
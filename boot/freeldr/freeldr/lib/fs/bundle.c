@@ -0,0 +1,328 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot bundle support
+ *
+ * When the system root contains a boot bundle, it is read and decompressed
+ * in one pass before the boot set is loaded, and ArcOpen serves the files
+ * it contains from memory. Files not in the bundle, or all of them when
+ * there is no bundle, are read from their file system as usual.
+ *
+ * The bundle is a snapshot taken at build time. Nothing here checks it
+ * against the files on disk, which is why it is only used on live media.
+ */
+
+#include <freeldr.h>
+#include <bootbundle.h>
+
+#include <debug.h>
+DBG_DEFAULT_CHANNEL(FILESYSTEM);
+
+#define TAG_BUNDLE_FILE 'FdnB'
+
+typedef struct _BUNDLE_FILE
+{
+    PBOOT_BUNDLE_ENTRY Entry;
+    ULONG FilePointer;
+} BUNDLE_FILE, *PBUNDLE_FILE;
+
+static PUCHAR BundleImage;
+static PBOOT_BUNDLE_HEADER BundleHeader;
+static PBOOT_BUNDLE_ENTRY BundleEntries;
+static CHAR BundleRoot[MAX_PATH];
+static SIZE_T BundleRootLength;
+static ULONG BundleFilesServed;
+
+static PBOOT_BUNDLE_ENTRY BundleFindEntry(PCSTR Path)
+{
+    ULONG i;
+
+    if (!BundleImage || _strnicmp(Path, BundleRoot, BundleRootLength) != 0)
+        return NULL;
+    Path += BundleRootLength;
+
+    for (i = 0; i < BundleHeader->EntryCount; i++)
+    {
+        if (_stricmp(Path, (PCSTR)(BundleImage + BundleEntries[i].NameOffset)) == 0)
+            return &BundleEntries[i];
+    }
+
+    return NULL;
+}
+
+static BOOLEAN BundleValidateTable(VOID)
+{
+    ULONG i, Offset = 0;
+    PBOOT_BUNDLE_ENTRY Entry;
+    PCSTR Name;
+
+    for (i = 0; i < BundleHeader->EntryCount; i++)
+    {
+        Entry = &BundleEntries[i];
+
+        if (Entry->NameOffset >= BundleHeader->DataOffset)
+            return FALSE;
+        Name = (PCSTR)(BundleImage + Entry->NameOffset);
+        if (!memchr(Name, ANSI_NULL, BundleHeader->DataOffset - Entry->NameOffset))
+            return FALSE;
+
+        if (Entry->DataOffset < BundleHeader->DataOffset ||
+            Entry->DataOffset - BundleHeader->DataOffset > BundleHeader->CompressedSize ||
+            Entry->DataSize > BundleHeader->CompressedSize - (Entry->DataOffset - BundleHeader->DataOffset))
+        {
+            return FALSE;
+        }
+
+        if (Entry->FileSize > BundleHeader->UncompressedSize - Offset)
+            return FALSE;
+        Offset += Entry->FileSize;
+
+        if (!(Entry->Flags & BOOT_BUNDLE_ENTRY_LZNT1) && Entry->DataSize != Entry->FileSize)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static ARC_STATUS BundleClose(ULONG FileId)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    FrLdrTempFree(FileHandle, TAG_BUNDLE_FILE);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleGetFileInformation(ULONG FileId, FILEINFORMATION* Information)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    RtlZeroMemory(Information, sizeof(*Information));
+    Information->EndingAddress.LowPart = FileHandle->Entry->FileSize;
+    Information->CurrentAddress.LowPart = FileHandle->FilePointer;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
+{
+    PBOOT_BUNDLE_ENTRY Entry;
+    PBUNDLE_FILE FileHandle;
+
+    if (OpenMode != OpenReadOnly)
+        return EACCES;
+
+    Entry = BundleFindEntry(Path);
+    if (!Entry)
+        return ENOENT;
+
+    FileHandle = FrLdrTempAlloc(sizeof(BUNDLE_FILE), TAG_BUNDLE_FILE);
+    if (!FileHandle)
+        return ENOMEM;
+
+    FileHandle->Entry = Entry;
+    FileHandle->FilePointer = 0;
+    FsSetDeviceSpecific(*FileId, FileHandle);
+
+    TRACE("BundleOpen() '%s' served from the boot bundle\n", Path);
+    BundleFilesServed++;
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+    ULONG Remaining;
+
+    Remaining = FileHandle->Entry->FileSize - FileHandle->FilePointer;
+    *Count = min(N, Remaining);
+
+    RtlCopyMemory(Buffer,
+                  BundleImage + FileHandle->Entry->DataOffset + FileHandle->FilePointer,
+                  *Count);
+    FileHandle->FilePointer += *Count;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleSeek(ULONG FileId, LARGE_INTEGER* Position, SEEKMODE SeekMode)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+    LARGE_INTEGER NewPosition = *Position;
+
+    switch (SeekMode)
+    {
+        case SeekAbsolute:
+            break;
+        case SeekRelative:
+            NewPosition.QuadPart += FileHandle->FilePointer;
+            break;
+        default:
+            ASSERT(FALSE);
+            return EINVAL;
+    }
+
+    if (NewPosition.QuadPart < 0 || NewPosition.QuadPart > FileHandle->Entry->FileSize)
+        return EINVAL;
+
+    FileHandle->FilePointer = NewPosition.LowPart;
+    return ESUCCESS;
+}
+
+static DEVVTBL BundleFuncTable =
+{
+    BundleClose,
+    BundleGetFileInformation,
+    BundleOpen,
+    BundleRead,
+    BundleSeek,
+    NULL
+};
+
+const DEVVTBL* BundleMount(PCSTR Path)
+{
+    if (!BundleFindEntry(Path))
+        return NULL;
+    return &BundleFuncTable;
+}
+
+VOID BundleUnload(VOID)
+{
+    if (!BundleImage)
+        return;
+
+    TRACE("Boot bundle served %lu of %lu files\n",
+          BundleFilesServed, BundleHeader->EntryCount);
+
+    MmFreeMemory(BundleImage);
+    BundleImage = NULL;
+    BundleHeader = NULL;
+    BundleEntries = NULL;
+}
+
+ARC_STATUS BundleLoad(PCSTR SystemRoot)
+{
+    CHAR FullPath[MAX_PATH];
+    BOOT_BUNDLE_HEADER Header;
+    PBOOT_BUNDLE_ENTRY Entry;
+    PUCHAR Compressed = NULL;
+    ULONG FileId, BytesRead, FinalSize, Offset, i;
+    ARC_STATUS Status;
+    NTSTATUS NtStatus;
+
+    BundleUnload();
+
+    RtlStringCbCopyA(FullPath, sizeof(FullPath), SystemRoot);
+    RtlStringCbCatA(FullPath, sizeof(FullPath), BOOT_BUNDLE_FILE_NAME);
+
+    Status = ArcOpen(FullPath, OpenReadOnly, &FileId);
+    if (Status != ESUCCESS)
+    {
+        TRACE("No boot bundle '%s'\n", FullPath);
+        return Status;
+    }
+
+    Status = ArcRead(FileId, &Header, sizeof(Header), &BytesRead);
+    if (Status != ESUCCESS || BytesRead != sizeof(Header) ||
+        Header.Signature != BOOT_BUNDLE_SIGNATURE ||
+        Header.Version != BOOT_BUNDLE_VERSION ||
+        Header.HeaderSize != sizeof(Header) ||
+        Header.DataOffset < sizeof(Header) ||
+        Header.EntryCount > (Header.DataOffset - sizeof(Header)) / sizeof(BOOT_BUNDLE_ENTRY) ||
+        Header.UncompressedSize > MAXULONG - Header.DataOffset)
+    {
+        WARN("Invalid boot bundle '%s'\n", FullPath);
+        Status = EINVAL;
+        goto Quit;
+    }
+
+    /* The entry table stays at the start of the image, the files follow it */
+    BundleImage = MmAllocateMemoryWithType(Header.DataOffset + Header.UncompressedSize,
+                                           LoaderFirmwareTemporary);
+    Compressed = MmAllocateMemoryWithType(Header.CompressedSize, LoaderFirmwareTemporary);
+    if (!BundleImage || !Compressed)
+    {
+        WARN("Not enough memory for the boot bundle\n");
+        Status = ENOMEM;
+        goto Quit;
+    }
+
+    /* Read the rest of the table, then all the file data, in one pass */
+    RtlCopyMemory(BundleImage, &Header, sizeof(Header));
+    Status = ArcRead(FileId, BundleImage + sizeof(Header), Header.DataOffset - sizeof(Header), &BytesRead);
+    if (Status == ESUCCESS && BytesRead != Header.DataOffset - sizeof(Header))
+        Status = EIO;
+    if (Status == ESUCCESS)
+    {
+        Status = ArcRead(FileId, Compressed, Header.CompressedSize, &BytesRead);
+        if (Status == ESUCCESS && BytesRead != Header.CompressedSize)
+            Status = EIO;
+    }
+    if (Status != ESUCCESS)
+    {
+        WARN("Error while reading the boot bundle, Status: %u\n", Status);
+        goto Quit;
+    }
+
+    BundleHeader = (PBOOT_BUNDLE_HEADER)BundleImage;
+    BundleEntries = (PBOOT_BUNDLE_ENTRY)(BundleHeader + 1);
+    if (!BundleValidateTable())
+    {
+        WARN("Invalid boot bundle table\n");
+        Status = EINVAL;
+        goto Quit;
+    }
+
+    /* Unpack the files, their DataOffset now refers to the image */
+    Offset = Header.DataOffset;
+    for (i = 0; i < Header.EntryCount; i++)
+    {
+        Entry = &BundleEntries[i];
+
+        if (Entry->Flags & BOOT_BUNDLE_ENTRY_LZNT1)
+        {
+            NtStatus = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1,
+                                           BundleImage + Offset,
+                                           Entry->FileSize,
+                                           Compressed + (Entry->DataOffset - Header.DataOffset),
+                                           Entry->DataSize,
+                                           &FinalSize);
+            if (!NT_SUCCESS(NtStatus) || FinalSize != Entry->FileSize)
+            {
+                WARN("Corrupted file '%s' in the boot bundle\n", (PCSTR)(BundleImage + Entry->NameOffset));
+                Status = EINVAL;
+                goto Quit;
+            }
+        }
+        else
+        {
+            RtlCopyMemory(BundleImage + Offset,
+                          Compressed + (Entry->DataOffset - Header.DataOffset),
+                          Entry->FileSize);
+        }
+
+        Entry->DataOffset = Offset;
+        Offset += Entry->FileSize;
+    }
+
+    /* Bundled files are reported as being on the file system of the bundle */
+    BundleFuncTable.ServiceName = FsGetServiceName(FileId);
+
+    RtlStringCbCopyA(BundleRoot, sizeof(BundleRoot), SystemRoot);
+    BundleRootLength = strlen(BundleRoot);
+    BundleFilesServed = 0;
+
+    TRACE("Boot bundle loaded: %lu files, %lu bytes, %lu compressed\n",
+          Header.EntryCount, Header.UncompressedSize, Header.CompressedSize);
+    Status = ESUCCESS;
+
+Quit:
+    if (Compressed)
+        MmFreeMemory(Compressed);
+    if (Status != ESUCCESS && BundleImage)
+    {
+        MmFreeMemory(BundleImage);
+        BundleImage = NULL;
+    }
+    ArcClose(FileId);
+    return Status;
+}
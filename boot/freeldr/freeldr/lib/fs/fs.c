@@ -66,12 +66,37 @@ ARC_STATUS ArcOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
     SIZE_T Length;
     OPENMODE DeviceOpenMode;
     ULONG DeviceId;
+    const DEVVTBL* FuncTable;
 
     /* Print status message */
     TRACE("Opening file '%s'...\n", Path);
 
     *FileId = MAX_FDS;
 
+    /* Files of the boot bundle are served from memory */
+    FuncTable = BundleMount(Path);
+    if (FuncTable)
+    {
+        for (i = 0; i < MAX_FDS; i++)
+        {
+            if (!FileData[i].FuncTable)
+                break;
+        }
+        if (i == MAX_FDS)
+            return EMFILE;
+
+        FileData[i].FuncTable = FuncTable;
+        FileData[i].DeviceId = (ULONG)-1;
+        *FileId = i;
+        Status = FuncTable->Open(Path, OpenMode, FileId);
+        if (Status == ESUCCESS)
+            return ESUCCESS;
+
+        /* Fall back to the file system */
+        FileData[i].FuncTable = NULL;
+        *FileId = MAX_FDS;
+    }
+
     /* Search last ')', which delimits device and path */
     FileName = strrchr(Path, ')');
     if (!FileName)
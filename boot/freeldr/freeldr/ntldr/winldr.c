@@ -904,6 +904,14 @@ LoadAndBootWindows(
     /* Let user know we started loading */
     //UiDrawStatusText("Loading...");
 
+    /*
+     * Read the boot set in one go if it has been bundled. Only live media
+     * (booted with /MININT) get a bundle: nothing updates it when the files
+     * it contains change, and FreeLoader cannot tell that they did.
+     */
+    if (NtLdrGetOption(BootOptions, "MININT"))
+        BundleLoad(BootPath);
+
     /* Allocate and minimally-initialize the Loader Parameter Block */
     AllocateAndInitLPB(OperatingSystemVersion, &LoaderBlock);
 
@@ -989,6 +997,12 @@ LoadAndBootWindowsCommon(
     Success = WinLdrLoadBootDrivers(LoaderBlock, BootPath);
     TRACE("Boot drivers loading %s\n", Success ? "successful" : "failed");
 
+    /* Report how well the disk cache did while loading */
+    CacheReportStatistics();
+
+    /* Everything the boot bundle could provide has been loaded */
+    BundleUnload();
+
     /* Cleanup ini file */
     IniCleanup();
 
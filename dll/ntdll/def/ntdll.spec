@@ -109,7 +109,7 @@
 @ stdcall -version=0x502 EtwTraceEvent(double ptr)
 @ stdcall -stub EtwTraceEventInstance(double ptr ptr ptr)
 @ varargs EtwTraceMessage(int64 long ptr long)
-@ stdcall -stub EtwTraceMessageVa(int64 long ptr long ptr)
+@ stdcall EtwTraceMessageVa(int64 long ptr long ptr)
 @ stdcall EtwUnregisterTraceGuids(double)
 @ stdcall -version=0x502 EtwUpdateTraceA(double str ptr)
 @ stdcall -version=0x502 EtwUpdateTraceW(double wstr ptr)
@@ -1080,6 +1080,7 @@
 @ stdcall RtlQueryInformationActiveActivationContext(long ptr long ptr)
 @ stdcall RtlQueryInterfaceMemoryStream(ptr ptr ptr)
 @ stub -version=0x600+ RtlQueryModuleInformation
+@ stdcall -version=0x601+ RtlQueryPerformanceCounter(ptr)
 @ stdcall -stub RtlQueryProcessBackTraceInformation(ptr)
 @ stdcall RtlQueryProcessDebugInformation(long long ptr)
 @ stdcall RtlQueryProcessHeapInformation(ptr)
@@ -2,18 +2,629 @@
  * ntdll.dll Event Tracing Functions
  */
 
+/*
+ * Trace sessions live in the kernel (ntoskrnl/wmi/logger.c) and are
+ * controlled through IOCTLs on the WMI device. Events are logged with
+ * NtTraceEvent, which copies them straight into the per-processor buffers
+ * of the session.
+ *
+ * The handle a provider receives in its WMI_ENABLE_EVENTS callback carries
+ * the logger id, the enable level and the enable flags, so that
+ * EtwGetTraceEnableFlags / EtwGetTraceEnableLevel and the provider's own
+ * "am I enabled" checks never leave user mode.
+ */
+
 #include <ntdll.h>
 
+#include <winioctl.h>
 #include <wmistr.h>
 #include <evntrace.h>
+#include <wmiioctl.h>
 
 #define NDEBUG
 #include <debug.h>
 
-#define FIXME DPRINT1
+typedef struct _ETWP_REGISTRATION
+{
+    LIST_ENTRY ListEntry;
+    GUID ControlGuid;
+    WMIDPREQUEST RequestAddress;
+    PVOID RequestContext;
+} ETWP_REGISTRATION, *PETWP_REGISTRATION;
+
+static HANDLE EtwpDeviceHandle;
+static RTL_CRITICAL_SECTION EtwpRegistrationLock;
+static LIST_ENTRY EtwpRegistrationListHead;
+static volatile LONG EtwpInitState;     /* 0: not done, 1: in progress, 2: done */
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+static
+VOID
+EtwpInitialize(VOID)
+{
+    if (EtwpInitState == 2)
+        return;
+
+    if (InterlockedCompareExchange(&EtwpInitState, 1, 0) == 0)
+    {
+        RtlInitializeCriticalSection(&EtwpRegistrationLock);
+        InitializeListHead(&EtwpRegistrationListHead);
+        InterlockedExchange(&EtwpInitState, 2);
+        return;
+    }
+
+    /* Another thread is doing it */
+    while (EtwpInitState != 2)
+        NtYieldExecution();
+}
+
+static
+NTSTATUS
+EtwpGetDeviceHandle(
+    _Out_ PHANDLE DeviceHandle)
+{
+    UNICODE_STRING DeviceName = RTL_CONSTANT_STRING(L"\\Device\\WMIDataDevice");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    if (EtwpDeviceHandle)
+    {
+        *DeviceHandle = EtwpDeviceHandle;
+        return STATUS_SUCCESS;
+    }
+
+    InitializeObjectAttributes(&ObjectAttributes, &DeviceName, 0, NULL, NULL);
+    Status = NtCreateFile(&Handle,
+                          GENERIC_READ | GENERIC_WRITE | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &IoStatusBlock,
+                          NULL,
+                          0,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE,
+                          FILE_OPEN,
+                          FILE_SYNCHRONOUS_IO_NONALERT,
+                          NULL,
+                          0);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to open the WMI device: 0x%lx\n", Status);
+        return Status;
+    }
+
+    /* Keep the first handle if two threads raced */
+    if (InterlockedCompareExchangePointer(&EtwpDeviceHandle, Handle, NULL) != NULL)
+        NtClose(Handle);
+
+    *DeviceHandle = EtwpDeviceHandle;
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+EtwpIoControl(
+    _In_ ULONG IoControlCode,
+    _In_ PVOID InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_ PVOID OutputBuffer,
+    _In_ ULONG OutputBufferLength)
+{
+    IO_STATUS_BLOCK IoStatusBlock;
+    HANDLE DeviceHandle;
+    NTSTATUS Status;
+
+    Status = EtwpGetDeviceHandle(&DeviceHandle);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    return NtDeviceIoControlFile(DeviceHandle,
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 &IoStatusBlock,
+                                 IoControlCode,
+                                 InputBuffer,
+                                 InputBufferLength,
+                                 OutputBuffer,
+                                 OutputBufferLength);
+}
+
+/* Number of bytes available for the string at Offset in the properties */
+static
+ULONG
+EtwpGetStringSpace(
+    _In_ PEVENT_TRACE_PROPERTIES Properties,
+    _In_ ULONG Offset)
+{
+    ULONG End = Properties->Wnode.BufferSize;
+
+    /* The other string may follow this one */
+    if (Properties->LoggerNameOffset > Offset && Properties->LoggerNameOffset < End)
+        End = Properties->LoggerNameOffset;
+    if (Properties->LogFileNameOffset > Offset && Properties->LogFileNameOffset < End)
+        End = Properties->LogFileNameOffset;
+
+    return End - Offset;
+}
+
+static
+ULONG
+EtwpCheckProperties(
+    _In_ PEVENT_TRACE_PROPERTIES Properties)
+{
+    if (Properties->Wnode.BufferSize < sizeof(EVENT_TRACE_PROPERTIES))
+        return ERROR_BAD_LENGTH;
+
+    if ((Properties->LoggerNameOffset &&
+         (Properties->LoggerNameOffset < sizeof(EVENT_TRACE_PROPERTIES) ||
+          Properties->LoggerNameOffset >= Properties->Wnode.BufferSize)) ||
+        (Properties->LogFileNameOffset &&
+         (Properties->LogFileNameOffset < sizeof(EVENT_TRACE_PROPERTIES) ||
+          Properties->LogFileNameOffset >= Properties->Wnode.BufferSize)))
+    {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+/* Stores a string at Offset in the properties, if it fits */
+static
+VOID
+EtwpStoreString(
+    _Inout_ PEVENT_TRACE_PROPERTIES Properties,
+    _In_ ULONG Offset,
+    _In_ PCWSTR String,
+    _In_ BOOLEAN Ansi)
+{
+    ULONG Space, Length, AnsiLength;
+    PVOID Target;
+
+    if (!Offset)
+        return;
+
+    Space = EtwpGetStringSpace(Properties, Offset);
+    Target = (PUCHAR)Properties + Offset;
+    Length = (ULONG)wcslen(String) * sizeof(WCHAR);
+
+    if (Ansi)
+    {
+        RtlUnicodeToMultiByteSize(&AnsiLength, (PWCH)String, Length);
+        if (AnsiLength + sizeof(CHAR) > Space)
+            return;
+
+        RtlUnicodeToMultiByteN(Target, AnsiLength, NULL, (PWCH)String, Length);
+        ((PCHAR)Target)[AnsiLength] = ANSI_NULL;
+    }
+    else
+    {
+        if (Length + sizeof(WCHAR) > Space)
+            return;
+
+        RtlCopyMemory(Target, String, Length + sizeof(WCHAR));
+    }
+}
+
+static
+VOID
+EtwpPropertiesToLoggerInformation(
+    _In_ PEVENT_TRACE_PROPERTIES Properties,
+    _Out_ PWMI_LOGGER_INFORMATION LoggerInfo)
+{
+    RtlZeroMemory(LoggerInfo, sizeof(*LoggerInfo));
+    LoggerInfo->LoggerHandle = Properties->Wnode.HistoricalContext;
+    LoggerInfo->Guid = Properties->Wnode.Guid;
+    LoggerInfo->ClockType = Properties->Wnode.ClientContext;
+    LoggerInfo->BufferSize = Properties->BufferSize;
+    LoggerInfo->MinimumBuffers = Properties->MinimumBuffers;
+    LoggerInfo->MaximumBuffers = Properties->MaximumBuffers;
+    LoggerInfo->MaximumFileSize = Properties->MaximumFileSize;
+    LoggerInfo->LogFileMode = Properties->LogFileMode;
+    LoggerInfo->FlushTimer = Properties->FlushTimer;
+    LoggerInfo->EnableFlags = Properties->EnableFlags;
+}
+
+static
+VOID
+EtwpLoggerInformationToProperties(
+    _In_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _Inout_ PEVENT_TRACE_PROPERTIES Properties,
+    _In_ BOOLEAN Ansi,
+    _In_ BOOLEAN CopyLogFileName)
+{
+    PCWSTR LogFileName = LoggerInfo->LogFileName;
+
+    Properties->Wnode.HistoricalContext = LoggerInfo->LoggerHandle;
+    Properties->Wnode.Guid = LoggerInfo->Guid;
+    Properties->Wnode.ClientContext = LoggerInfo->ClockType;
+    Properties->BufferSize = LoggerInfo->BufferSize;
+    Properties->MinimumBuffers = LoggerInfo->MinimumBuffers;
+    Properties->MaximumBuffers = LoggerInfo->MaximumBuffers;
+    Properties->MaximumFileSize = LoggerInfo->MaximumFileSize;
+    Properties->LogFileMode = LoggerInfo->LogFileMode;
+    Properties->FlushTimer = LoggerInfo->FlushTimer;
+    Properties->EnableFlags = LoggerInfo->EnableFlags;
+    Properties->NumberOfBuffers = LoggerInfo->NumberOfBuffers;
+    Properties->FreeBuffers = LoggerInfo->FreeBuffers;
+    Properties->EventsLost = LoggerInfo->EventsLost;
+    Properties->BuffersWritten = LoggerInfo->BuffersWritten;
+    Properties->LogBuffersLost = LoggerInfo->LogBuffersLost;
+    Properties->RealTimeBuffersLost = LoggerInfo->RealTimeBuffersLost;
+    Properties->LoggerThreadId = UlongToHandle(LoggerInfo->LoggerThreadId);
+
+    EtwpStoreString(Properties, Properties->LoggerNameOffset, LoggerInfo->LoggerName, Ansi);
+
+    if (CopyLogFileName && LogFileName[0] != UNICODE_NULL)
+    {
+        /* Give back a DOS path */
+        if (wcsncmp(LogFileName, L"\\??\\", 4) == 0)
+            LogFileName += 4;
+        EtwpStoreString(Properties, Properties->LogFileNameOffset, LogFileName, Ansi);
+    }
+}
+
+/* Captures the log file name of the properties, converted to an NT path */
+static
+ULONG
+EtwpCaptureLogFileName(
+    _In_ PEVENT_TRACE_PROPERTIES Properties,
+    _In_ BOOLEAN Ansi,
+    _Out_ PWMI_LOGGER_INFORMATION LoggerInfo)
+{
+    UNICODE_STRING DosName, NtName;
+    ANSI_STRING AnsiName;
+    ULONG Space, Length;
+    PVOID Source;
+    NTSTATUS Status;
+
+    if (!Properties->LogFileNameOffset)
+        return ERROR_SUCCESS;
+
+    Source = (PUCHAR)Properties + Properties->LogFileNameOffset;
+    Space = Properties->Wnode.BufferSize - Properties->LogFileNameOffset;
+
+    if (Ansi)
+    {
+        for (Length = 0; Length < Space && ((PCHAR)Source)[Length]; Length++);
+        if (Length == Space || Length > MAXUSHORT)
+            return ERROR_BAD_LENGTH;
+        if (Length == 0)
+            return ERROR_SUCCESS;
+
+        AnsiName.Buffer = Source;
+        AnsiName.Length = AnsiName.MaximumLength = (USHORT)Length;
+        Status = RtlAnsiStringToUnicodeString(&DosName, &AnsiName, TRUE);
+        if (!NT_SUCCESS(Status))
+            return RtlNtStatusToDosError(Status);
+    }
+    else
+    {
+        for (Length = 0; Length < Space / sizeof(WCHAR) && ((PWCHAR)Source)[Length]; Length++);
+        if (Length == Space / sizeof(WCHAR))
+            return ERROR_BAD_LENGTH;
+        if (Length == 0)
+            return ERROR_SUCCESS;
+
+        if (!RtlCreateUnicodeString(&DosName, Source))
+            return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    if (!RtlDosPathNameToNtPathName_U(DosName.Buffer, &NtName, NULL, NULL))
+    {
+        RtlFreeUnicodeString(&DosName);
+        return ERROR_BAD_PATHNAME;
+    }
+    RtlFreeUnicodeString(&DosName);
+
+    if (NtName.Length >= sizeof(LoggerInfo->LogFileName))
+    {
+        RtlFreeUnicodeString(&NtName);
+        return ERROR_BAD_LENGTH;
+    }
+
+    RtlCopyMemory(LoggerInfo->LogFileName, NtName.Buffer, NtName.Length);
+    LoggerInfo->LogFileName[NtName.Length / sizeof(WCHAR)] = UNICODE_NULL;
+    RtlFreeUnicodeString(&NtName);
+    return ERROR_SUCCESS;
+}
+
+static
+ULONG
+EtwpStartTrace(
+    _Out_ PTRACEHANDLE SessionHandle,
+    _In_ PCUNICODE_STRING SessionName,
+    _In_ ULONG NameSize,
+    _Inout_ PEVENT_TRACE_PROPERTIES Properties,
+    _In_ BOOLEAN Ansi)
+{
+    WMI_LOGGER_INFORMATION LoggerInfo;
+    ULONG Error;
+    NTSTATUS Status;
+
+    Error = EtwpCheckProperties(Properties);
+    if (Error != ERROR_SUCCESS)
+        return Error;
+
+    if ((Properties->LogFileMode & EVENT_TRACE_FILE_MODE_SEQUENTIAL) &&
+        (Properties->LogFileMode & EVENT_TRACE_FILE_MODE_CIRCULAR))
+    {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    if (!Properties->LogFileNameOffset &&
+        !(Properties->LogFileMode & EVENT_TRACE_REAL_TIME_MODE))
+    {
+        return ERROR_BAD_PATHNAME;
+    }
+
+    /* The session name is given back in the properties, it must fit there */
+    if (Properties->LoggerNameOffset &&
+        NameSize > EtwpGetStringSpace(Properties, Properties->LoggerNameOffset))
+    {
+        return ERROR_BAD_LENGTH;
+    }
+
+    if (SessionName->Length >= sizeof(LoggerInfo.LoggerName))
+        return ERROR_BAD_LENGTH;
+
+    EtwpPropertiesToLoggerInformation(Properties, &LoggerInfo);
+    RtlCopyMemory(LoggerInfo.LoggerName, SessionName->Buffer, SessionName->Length);
+
+    Error = EtwpCaptureLogFileName(Properties, Ansi, &LoggerInfo);
+    if (Error != ERROR_SUCCESS)
+        return Error;
+
+    Status = EtwpIoControl(IOCTL_WMI_START_LOGGER,
+                           &LoggerInfo,
+                           sizeof(LoggerInfo),
+                           &LoggerInfo,
+                           sizeof(LoggerInfo));
+    if (!NT_SUCCESS(Status))
+        return RtlNtStatusToDosError(Status);
+
+    EtwpLoggerInformationToProperties(&LoggerInfo, Properties, Ansi, FALSE);
+    *SessionHandle = LoggerInfo.LoggerHandle;
+    return ERROR_SUCCESS;
+}
+
+static
+ULONG
+EtwpControlTrace(
+    _In_ TRACEHANDLE SessionHandle,
+    _In_opt_ PCUNICODE_STRING SessionName,
+    _Inout_ PEVENT_TRACE_PROPERTIES Properties,
+    _In_ ULONG ControlCode,
+    _In_ BOOLEAN Ansi)
+{
+    WMI_LOGGER_INFORMATION LoggerInfo;
+    ULONG IoControlCode, Error;
+    NTSTATUS Status;
+
+    if (!Properties)
+        return ERROR_INVALID_PARAMETER;
+
+    Error = EtwpCheckProperties(Properties);
+    if (Error != ERROR_SUCCESS)
+        return Error;
+
+    switch (ControlCode)
+    {
+        case EVENT_TRACE_CONTROL_QUERY:
+            IoControlCode = IOCTL_WMI_QUERY_LOGGER;
+            break;
+        case EVENT_TRACE_CONTROL_STOP:
+            IoControlCode = IOCTL_WMI_STOP_LOGGER;
+            break;
+        case EVENT_TRACE_CONTROL_UPDATE:
+            IoControlCode = IOCTL_WMI_UPDATE_LOGGER;
+            break;
+        case EVENT_TRACE_CONTROL_FLUSH:
+            IoControlCode = IOCTL_WMI_FLUSH_LOGGER;
+            break;
+        default:
+            return ERROR_INVALID_PARAMETER;
+    }
+
+    /* The session is found by handle, or by name when there is none */
+    if (!SessionHandle && (!SessionName || !SessionName->Length))
+        return ERROR_INVALID_PARAMETER;
+
+    EtwpPropertiesToLoggerInformation(Properties, &LoggerInfo);
+    LoggerInfo.LoggerHandle = SessionHandle;
+    if (SessionName)
+    {
+        if (SessionName->Length >= sizeof(LoggerInfo.LoggerName))
+            return ERROR_BAD_LENGTH;
+        RtlCopyMemory(LoggerInfo.LoggerName, SessionName->Buffer, SessionName->Length);
+    }
+
+    Status = EtwpIoControl(IoControlCode,
+                           &LoggerInfo,
+                           sizeof(LoggerInfo),
+                           &LoggerInfo,
+                           sizeof(LoggerInfo));
+    if (!NT_SUCCESS(Status))
+        return RtlNtStatusToDosError(Status);
+
+    EtwpLoggerInformationToProperties(&LoggerInfo, Properties, Ansi, TRUE);
+    return ERROR_SUCCESS;
+}
+
+static
+ULONG
+EtwpQueryAllTraces(
+    _Out_ PEVENT_TRACE_PROPERTIES *PropertyArray,
+    _In_ ULONG PropertyArrayCount,
+    _Out_ PULONG SessionCount,
+    _In_ BOOLEAN Ansi)
+{
+    WMI_LOGGER_INFORMATION LoggerInfo;
+    ULONG LoggerId, Count = 0;
+    NTSTATUS Status;
+
+    if (!PropertyArray || !PropertyArrayCount || !SessionCount)
+        return ERROR_INVALID_PARAMETER;
+
+    for (LoggerId = 1; LoggerId < WMI_MAX_LOGGERS; LoggerId++)
+    {
+        RtlZeroMemory(&LoggerInfo, sizeof(LoggerInfo));
+        LoggerInfo.LoggerHandle = WMI_MAKE_LOGGER_HANDLE(LoggerId, 0, 0);
+        Status = EtwpIoControl(IOCTL_WMI_QUERY_LOGGER,
+                               &LoggerInfo,
+                               sizeof(LoggerInfo),
+                               &LoggerInfo,
+                               sizeof(LoggerInfo));
+        if (!NT_SUCCESS(Status))
+            continue;
+
+        if (Count < PropertyArrayCount)
+        {
+            if (!PropertyArray[Count] ||
+                EtwpCheckProperties(PropertyArray[Count]) != ERROR_SUCCESS)
+            {
+                return ERROR_INVALID_PARAMETER;
+            }
+
+            EtwpLoggerInformationToProperties(&LoggerInfo, PropertyArray[Count], Ansi, TRUE);
+        }
+        Count++;
+    }
+
+    if (Count > PropertyArrayCount)
+    {
+        *SessionCount = PropertyArrayCount;
+        return ERROR_MORE_DATA;
+    }
+
+    *SessionCount = Count;
+    return ERROR_SUCCESS;
+}
+
+static
+VOID
+EtwpNotifyProvider(
+    _In_ PETWP_REGISTRATION Registration,
+    _In_ TRACEHANDLE LoggerHandle)
+{
+    WNODE_HEADER Wnode;
+    ULONG BufferSize = sizeof(Wnode);
+
+    RtlZeroMemory(&Wnode, sizeof(Wnode));
+    Wnode.BufferSize = sizeof(Wnode);
+    Wnode.Guid = Registration->ControlGuid;
+    Wnode.HistoricalContext = LoggerHandle;
+    Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+
+    Registration->RequestAddress(LoggerHandle ? WMI_ENABLE_EVENTS : WMI_DISABLE_EVENTS,
+                                 Registration->RequestContext,
+                                 &BufferSize,
+                                 &Wnode);
+}
+
+static
+ULONG
+EtwpRegisterTraceGuids(
+    _In_ WMIDPREQUEST RequestAddress,
+    _In_opt_ PVOID RequestContext,
+    _In_ LPCGUID ControlGuid,
+    _Out_ PTRACEHANDLE RegistrationHandle)
+{
+    PETWP_REGISTRATION Registration;
+    WMI_TRACE_GUID_CONTROL Control;
+    NTSTATUS Status;
+
+    if (!RequestAddress || !ControlGuid || !RegistrationHandle)
+        return ERROR_INVALID_PARAMETER;
+
+    EtwpInitialize();
+
+    Registration = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(ETWP_REGISTRATION));
+    if (!Registration)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    Registration->ControlGuid = *ControlGuid;
+    Registration->RequestAddress = RequestAddress;
+    Registration->RequestContext = RequestContext;
+
+    RtlEnterCriticalSection(&EtwpRegistrationLock);
+    InsertTailList(&EtwpRegistrationListHead, &Registration->ListEntry);
+
+    /* The provider may have been enabled before it registered */
+    RtlZeroMemory(&Control, sizeof(Control));
+    Control.Guid = *ControlGuid;
+    Status = EtwpIoControl(IOCTL_WMI_QUERY_TRACE_GUID,
+                           &Control,
+                           sizeof(Control),
+                           &Control,
+                           sizeof(Control));
+    if (NT_SUCCESS(Status) && Control.Enable)
+        EtwpNotifyProvider(Registration, Control.LoggerHandle);
+
+    RtlLeaveCriticalSection(&EtwpRegistrationLock);
+
+    *RegistrationHandle = (TRACEHANDLE)(ULONG_PTR)Registration;
+    return ERROR_SUCCESS;
+}
+
+/* PUBLIC FUNCTIONS **********************************************************/
+
+/*
+ * @implemented
+ */
+ULONG
+NTAPI
+EtwTraceMessageVa(
+    TRACEHANDLE  SessionHandle,
+    ULONG        MessageFlags,
+    LPCGUID      MessageGuid,
+    USHORT       MessageNumber,
+    va_list      MessageArgList)
+{
+    struct
+    {
+        EVENT_TRACE_HEADER Header;
+        MOF_FIELD Fields[MAX_MOF_FIELDS];
+    } Event;
+    PVOID Data;
+    SIZE_T Length;
+    ULONG Count = 0;
+    NTSTATUS Status;
+
+    if (!SessionHandle)
+        return ERROR_INVALID_HANDLE;
+
+    RtlZeroMemory(&Event.Header, sizeof(Event.Header));
+    Event.Header.HeaderType = WMI_HEADER_TYPE_MESSAGE;
+    Event.Header.Class.Version = MessageNumber;
+    Event.Header.Flags = WNODE_FLAG_TRACED_GUID | WNODE_FLAG_USE_MOF_PTR;
+    if ((MessageFlags & TRACE_MESSAGE_GUID) && MessageGuid)
+        Event.Header.Guid = *MessageGuid;
+
+    /* The arguments are (PVOID, SIZE_T) pairs ended by a NULL pointer */
+    while ((Data = va_arg(MessageArgList, PVOID)) != NULL)
+    {
+        Length = va_arg(MessageArgList, SIZE_T);
+        if (Count == MAX_MOF_FIELDS)
+            return ERROR_INVALID_PARAMETER;
+
+        Event.Fields[Count].DataPtr = (ULONG64)(ULONG_PTR)Data;
+        Event.Fields[Count].Length = (ULONG)Length;
+        Event.Fields[Count].DataType = 0;
+        Count++;
+    }
+
+    Event.Header.Size = (USHORT)(sizeof(EVENT_TRACE_HEADER) + Count * sizeof(MOF_FIELD));
+    Status = NtTraceEvent(WMI_LOGGER_ID(SessionHandle),
+                          0,
+                          Event.Header.Size,
+                          &Event.Header);
+    return RtlNtStatusToDosError(Status);
+}
 
 /*
- * @unimplemented
+ * @implemented
  */
 ULONG CDECL
 EtwTraceMessage(
@@ -23,21 +634,42 @@ EtwTraceMessage(
     USHORT       MessageNumber,
     ...)
 {
-    FIXME("TraceMessage()\n");
-    return ERROR_SUCCESS;
+    va_list MessageArgList;
+    ULONG Error;
+
+    va_start(MessageArgList, MessageNumber);
+    Error = EtwTraceMessageVa(SessionHandle,
+                              MessageFlags,
+                              MessageGuid,
+                              MessageNumber,
+                              MessageArgList);
+    va_end(MessageArgList);
+
+    return Error;
 }
 
+/*
+ * @implemented
+ */
 TRACEHANDLE
 NTAPI
 EtwGetTraceLoggerHandle(
     PVOID Buffer
 )
 {
-    FIXME("EtwGetTraceLoggerHandle stub()\n");
-    return (TRACEHANDLE)-1;
-}
+    if (!Buffer)
+    {
+        RtlSetLastWin32Error(ERROR_INVALID_PARAMETER);
+        return (TRACEHANDLE)INVALID_HANDLE_VALUE;
+    }
 
+    /* This is the WNODE_HEADER given to the WMI_ENABLE_EVENTS callback */
+    return ((PWNODE_HEADER)Buffer)->HistoricalContext;
+}
 
+/*
+ * @implemented
+ */
 ULONG
 NTAPI
 EtwTraceEvent(
@@ -45,7 +677,7 @@ EtwTraceEvent(
     PEVENT_TRACE_HEADER EventTrace
 )
 {
-    FIXME("EtwTraceEvent stub()\n");
+    NTSTATUS Status;
 
     if (!SessionHandle || !EventTrace)
     {
@@ -53,45 +685,76 @@ EtwTraceEvent(
         return ERROR_INVALID_PARAMETER;
     }
 
-    if (EventTrace->Size != sizeof(EVENT_TRACE_HEADER))
+    if (EventTrace->Size < sizeof(EVENT_TRACE_HEADER))
     {
         /* invalid parameter */
         return ERROR_INVALID_PARAMETER;
     }
 
-    return ERROR_SUCCESS;
+    Status = NtTraceEvent(WMI_LOGGER_ID(SessionHandle), 0, EventTrace->Size, EventTrace);
+    return RtlNtStatusToDosError(Status);
 }
 
+/*
+ * @implemented
+ */
 ULONG
 NTAPI
 EtwGetTraceEnableFlags(
     TRACEHANDLE TraceHandle
 )
 {
-    FIXME("EtwGetTraceEnableFlags stub()\n");
-    return 0xFF;
+    return WMI_LOGGER_FLAGS(TraceHandle);
 }
 
+/*
+ * @implemented
+ */
 UCHAR
 NTAPI
 EtwGetTraceEnableLevel(
     TRACEHANDLE TraceHandle
 )
 {
-    FIXME("EtwGetTraceEnableLevel stub()\n");
-    return 0xFF;
+    return WMI_LOGGER_LEVEL(TraceHandle);
 }
 
+/*
+ * @implemented
+ */
 ULONG
 NTAPI
 EtwUnregisterTraceGuids(
     TRACEHANDLE RegistrationHandle
 )
 {
-    FIXME("EtwUnregisterTraceGuids stub()\n");
-    return ERROR_SUCCESS;
+    PETWP_REGISTRATION Registration;
+    PLIST_ENTRY ListEntry;
+
+    EtwpInitialize();
+
+    RtlEnterCriticalSection(&EtwpRegistrationLock);
+    for (ListEntry = EtwpRegistrationListHead.Flink;
+         ListEntry != &EtwpRegistrationListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Registration = CONTAINING_RECORD(ListEntry, ETWP_REGISTRATION, ListEntry);
+        if ((TRACEHANDLE)(ULONG_PTR)Registration == RegistrationHandle)
+        {
+            RemoveEntryList(&Registration->ListEntry);
+            RtlLeaveCriticalSection(&EtwpRegistrationLock);
+            RtlFreeHeap(RtlGetProcessHeap(), 0, Registration);
+            return ERROR_SUCCESS;
+        }
+    }
+    RtlLeaveCriticalSection(&EtwpRegistrationLock);
+
+    return ERROR_INVALID_PARAMETER;
 }
 
+/*
+ * @implemented
+ */
 ULONG
 NTAPI
 EtwRegisterTraceGuidsA(
@@ -105,10 +768,16 @@ EtwRegisterTraceGuidsA(
     PTRACEHANDLE RegistrationHandle
 )
 {
-    FIXME("EtwRegisterTraceGuidsA stub()\n");
-    return ERROR_SUCCESS;
+    /* The event classes and the MOF resources are only used by consumers */
+    return EtwpRegisterTraceGuids(RequestAddress,
+                                  RequestContext,
+                                  ControlGuid,
+                                  RegistrationHandle);
 }
 
+/*
+ * @implemented
+ */
 ULONG
 NTAPI
 EtwRegisterTraceGuidsW(
@@ -122,22 +791,51 @@ EtwRegisterTraceGuidsW(
     PTRACEHANDLE RegistrationHandle
 )
 {
-    FIXME("EtwRegisterTraceGuidsW stub()\n");
-    return ERROR_SUCCESS;
+    return EtwpRegisterTraceGuids(RequestAddress,
+                                  RequestContext,
+                                  ControlGuid,
+                                  RegistrationHandle);
 }
 
+/*
+ * @implemented
+ */
 ULONG WINAPI EtwStartTraceW( PTRACEHANDLE pSessionHandle, LPCWSTR SessionName, PEVENT_TRACE_PROPERTIES Properties )
 {
-    FIXME("(%p, %s, %p) stub\n", pSessionHandle, SessionName, Properties);
-    if (pSessionHandle) *pSessionHandle = 0xcafe4242;
-    return ERROR_SUCCESS;
+    UNICODE_STRING Name;
+
+    if (!pSessionHandle || !SessionName || !Properties)
+        return ERROR_INVALID_PARAMETER;
+
+    RtlInitUnicodeString(&Name, SessionName);
+    return EtwpStartTrace(pSessionHandle,
+                          &Name,
+                          Name.Length + sizeof(WCHAR),
+                          Properties,
+                          FALSE);
 }
 
+/*
+ * @implemented
+ */
 ULONG WINAPI EtwStartTraceA( PTRACEHANDLE pSessionHandle, LPCSTR SessionName, PEVENT_TRACE_PROPERTIES Properties )
 {
-    FIXME("(%p, %s, %p) stub\n", pSessionHandle, SessionName, Properties);
-    if (pSessionHandle) *pSessionHandle = 0xcafe4242;
-    return ERROR_SUCCESS;
+    UNICODE_STRING Name;
+    ULONG Error;
+
+    if (!pSessionHandle || !SessionName || !Properties)
+        return ERROR_INVALID_PARAMETER;
+
+    if (!RtlCreateUnicodeStringFromAsciiz(&Name, SessionName))
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    Error = EtwpStartTrace(pSessionHandle,
+                           &Name,
+                           (ULONG)strlen(SessionName) + sizeof(CHAR),
+                           Properties,
+                           TRUE);
+    RtlFreeUnicodeString(&Name);
+    return Error;
 }
 
 /******************************************************************************
@@ -148,8 +846,13 @@ ULONG WINAPI EtwStartTraceA( PTRACEHANDLE pSessionHandle, LPCSTR SessionName, PE
  */
 ULONG WINAPI EtwControlTraceW( TRACEHANDLE hSession, LPCWSTR SessionName, PEVENT_TRACE_PROPERTIES Properties, ULONG control )
 {
-    FIXME("(%I64x, %s, %p, %d) stub\n", hSession, SessionName, Properties, control);
-    return ERROR_SUCCESS;
+    UNICODE_STRING Name;
+
+    if (!SessionName)
+        return EtwpControlTrace(hSession, NULL, Properties, control, FALSE);
+
+    RtlInitUnicodeString(&Name, SessionName);
+    return EtwpControlTrace(hSession, &Name, Properties, control, FALSE);
 }
 
 /******************************************************************************
@@ -160,8 +863,18 @@ ULONG WINAPI EtwControlTraceW( TRACEHANDLE hSession, LPCWSTR SessionName, PEVENT
  */
 ULONG WINAPI EtwControlTraceA( TRACEHANDLE hSession, LPCSTR SessionName, PEVENT_TRACE_PROPERTIES Properties, ULONG control )
 {
-    FIXME("(%I64x, %s, %p, %d) stub\n", hSession, SessionName, Properties, control);
-    return ERROR_SUCCESS;
+    UNICODE_STRING Name;
+    ULONG Error;
+
+    if (!SessionName)
+        return EtwpControlTrace(hSession, NULL, Properties, control, TRUE);
+
+    if (!RtlCreateUnicodeStringFromAsciiz(&Name, SessionName))
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    Error = EtwpControlTrace(hSession, &Name, Properties, control, TRUE);
+    RtlFreeUnicodeString(&Name);
+    return Error;
 }
 
 /******************************************************************************
@@ -169,8 +882,41 @@ ULONG WINAPI EtwControlTraceA( TRACEHANDLE hSession, LPCSTR SessionName, PEVENT_
  */
 ULONG WINAPI EtwEnableTrace( ULONG enable, ULONG flag, ULONG level, LPCGUID guid, TRACEHANDLE hSession )
 {
-    FIXME("(%d, 0x%x, %d, %p, %I64x): stub\n", enable, flag, level,
-            guid, hSession);
+    PETWP_REGISTRATION Registration;
+    WMI_TRACE_GUID_CONTROL Control;
+    PLIST_ENTRY ListEntry;
+    NTSTATUS Status;
+
+    if (!guid || !hSession)
+        return ERROR_INVALID_PARAMETER;
+
+    RtlZeroMemory(&Control, sizeof(Control));
+    Control.Guid = *guid;
+    Control.LoggerHandle = hSession;
+    Control.EnableFlags = flag;
+    Control.Level = level;
+    Control.Enable = enable;
+
+    Status = EtwpIoControl(IOCTL_WMI_ENABLE_TRACE,
+                           &Control,
+                           sizeof(Control),
+                           &Control,
+                           sizeof(Control));
+    if (!NT_SUCCESS(Status))
+        return RtlNtStatusToDosError(Status);
+
+    /* Tell the providers of this process, the others see it when they register */
+    EtwpInitialize();
+    RtlEnterCriticalSection(&EtwpRegistrationLock);
+    for (ListEntry = EtwpRegistrationListHead.Flink;
+         ListEntry != &EtwpRegistrationListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Registration = CONTAINING_RECORD(ListEntry, ETWP_REGISTRATION, ListEntry);
+        if (IsEqualGUID(&Registration->ControlGuid, guid))
+            EtwpNotifyProvider(Registration, Control.LoggerHandle);
+    }
+    RtlLeaveCriticalSection(&EtwpRegistrationLock);
 
     return ERROR_SUCCESS;
 }
@@ -183,10 +929,7 @@ ULONG WINAPI EtwEnableTrace( ULONG enable, ULONG flag, ULONG level, LPCGUID guid
  */
 ULONG WINAPI EtwQueryAllTracesW( PEVENT_TRACE_PROPERTIES * parray, ULONG arraycount, PULONG psessioncount )
 {
-    FIXME("(%p, %d, %p) stub\n", parray, arraycount, psessioncount);
-
-    if (psessioncount) *psessioncount = 0;
-    return ERROR_SUCCESS;
+    return EtwpQueryAllTraces(parray, arraycount, psessioncount, FALSE);
 }
 
 /******************************************************************************
@@ -196,10 +939,7 @@ ULONG WINAPI EtwQueryAllTracesW( PEVENT_TRACE_PROPERTIES * parray, ULONG arrayco
  */
 ULONG WINAPI EtwQueryAllTracesA( PEVENT_TRACE_PROPERTIES * parray, ULONG arraycount, PULONG psessioncount )
 {
-    FIXME("(%p, %d, %p) stub\n", parray, arraycount, psessioncount);
-
-    if (psessioncount) *psessioncount = 0;
-    return ERROR_SUCCESS;
+    return EtwpQueryAllTraces(parray, arraycount, psessioncount, TRUE);
 }
 
 /******************************************************************************
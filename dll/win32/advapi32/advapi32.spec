@@ -452,7 +452,7 @@
 @ stdcall QueryServiceStatus(long ptr)
 @ stdcall QueryServiceStatusEx(long long ptr long ptr)
 @ stdcall QueryTraceA(double str ptr) ntdll.EtwQueryTraceA
-@ stdcall QueryTraceW(double str ptr) ntdll.EtwQueryTraceA
+@ stdcall QueryTraceW(double wstr ptr) ntdll.EtwQueryTraceW
 @ stdcall QueryUsersOnEncryptedFile(wstr ptr)
 @ stdcall ReadEncryptedFileRaw(ptr ptr ptr)
 @ stdcall ReadEventLogA(long long long ptr long ptr ptr)
@@ -590,7 +590,7 @@
 @ stdcall StartTraceA(ptr str ptr) ntdll.EtwStartTraceA
 @ stdcall StartTraceW(ptr wstr ptr) ntdll.EtwStartTraceW
 @ stdcall StopTraceA(double str ptr) ntdll.EtwStopTraceA
-@ stdcall StopTraceW(double wstr ptr) ntdll.EtwStopTraceA
+@ stdcall StopTraceW(double wstr ptr) ntdll.EtwStopTraceW
 @ stdcall SystemFunction001(ptr ptr ptr)
 @ stdcall SystemFunction002(ptr ptr ptr)
 @ stdcall SystemFunction003(ptr ptr)
@@ -649,6 +649,19 @@ CheckForCurrentHostname(CONST CHAR * Name, PFIXED_INFO network_info)
 }
 
 
+/* adns gives the time at which an answer expires, turn it back into a TTL */
+static
+DWORD
+DnsIntGetAnswerTtl(adns_answer *answer)
+{
+    DWORD Now = GetCurrentTimeInSeconds();
+
+    if ((DWORD)answer->expires <= Now)
+        return 0;
+
+    return (DWORD)answer->expires - Now;
+}
+
 DNS_STATUS
 WINAPI
 Query_Main(LPCWSTR Name,
@@ -747,6 +760,7 @@ Query_Main(LPCWSTR Name,
             (*QueryResultSet)->pNext = NULL;
             (*QueryResultSet)->wType = Type;
             (*QueryResultSet)->wDataLength = sizeof(DNS_A_DATA);
+            (*QueryResultSet)->dwTtl = 0;
             (*QueryResultSet)->Flags.S.Section = DnsSectionAnswer;
             (*QueryResultSet)->Flags.S.CharSet = DnsCharSetUnicode;
             (*QueryResultSet)->Data.A.IpAddress = Address;
@@ -840,6 +854,7 @@ Query_Main(LPCWSTR Name,
                 (*QueryResultSet)->pNext = NULL;
                 (*QueryResultSet)->wType = Type;
                 (*QueryResultSet)->wDataLength = sizeof(DNS_A_DATA);
+                (*QueryResultSet)->dwTtl = DnsIntGetAnswerTtl(answer);
                 (*QueryResultSet)->Flags.S.Section = DnsSectionAnswer;
                 (*QueryResultSet)->Flags.S.CharSet = DnsCharSetUnicode;
                 (*QueryResultSet)->Data.A.IpAddress = answer->rrs.addr->addr.inet.sin_addr.s_addr;
@@ -853,13 +868,21 @@ Query_Main(LPCWSTR Name,
 
             if (NULL == answer || adns_s_prohibitedcname != answer->status || NULL == answer->cname)
             {
+                DNS_STATUS Status = ERROR_FILE_NOT_FOUND;
+
+                /* Tell apart the answers that say the name or the record doesn't exist */
+                if (answer && answer->status == adns_s_nxdomain)
+                    Status = DNS_ERROR_RCODE_NAME_ERROR;
+                else if (answer && answer->status == adns_s_nodata)
+                    Status = DNS_INFO_NO_RECORDS;
+
                 adns_finish(astate);
 
                 if (CurrentName != AnsiName)
                     RtlFreeHeap(RtlGetProcessHeap(), 0, CurrentName);
 
                 RtlFreeHeap(RtlGetProcessHeap(), 0, AnsiName);
-                return ERROR_FILE_NOT_FOUND;
+                return Status;
             }
 
             if (CurrentName != AnsiName)
@@ -352,6 +352,14 @@ static HRESULT push_instr_uint(compiler_ctx_t *ctx, jsop_t op, unsigned arg)
     return S_OK;
 }
 
+/* Gives the last pushed instruction its own inline cache for the property lookup */
+static HRESULT set_prop_cache(compiler_ctx_t *ctx, HRESULT hres)
+{
+    if(SUCCEEDED(hres))
+        instr_ptr(ctx, ctx->code_off-1)->cache = ctx->code->prop_cache_cnt++;
+    return hres;
+}
+
 static HRESULT compile_binary_expression(compiler_ctx_t *ctx, binary_expression_t *expr, jsop_t op)
 {
     HRESULT hres;
@@ -387,7 +395,7 @@ static HRESULT compile_member_expression(compiler_ctx_t *ctx, member_expression_
     if(FAILED(hres))
         return hres;
 
-    return push_instr_bstr(ctx, OP_member, expr->identifier);
+    return set_prop_cache(ctx, push_instr_bstr(ctx, OP_member, expr->identifier));
 }
 
 #define LABEL_FLAG 0x80000000
@@ -447,7 +455,7 @@ static HRESULT emit_identifier_ref(compiler_ctx_t *ctx, const WCHAR *identifier,
     int local_ref;
     if(bind_local(ctx, identifier, &local_ref))
         return push_instr_int(ctx, OP_local_ref, local_ref);
-    return push_instr_bstr_uint(ctx, OP_identid, identifier, flags);
+    return set_prop_cache(ctx, push_instr_bstr_uint(ctx, OP_identid, identifier, flags));
 }
 
 static HRESULT emit_identifier(compiler_ctx_t *ctx, const WCHAR *identifier)
@@ -455,7 +463,7 @@ static HRESULT emit_identifier(compiler_ctx_t *ctx, const WCHAR *identifier)
     int local_ref;
     if(bind_local(ctx, identifier, &local_ref))
         return push_instr_int(ctx, OP_local, local_ref);
-    return push_instr_bstr(ctx, OP_ident, identifier);
+    return set_prop_cache(ctx, push_instr_bstr(ctx, OP_ident, identifier));
 }
 
 static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *expr, unsigned flags)
@@ -480,7 +488,7 @@ static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *ex
         if(FAILED(hres))
             return hres;
 
-        hres = push_instr_uint(ctx, OP_memberid, flags);
+        hres = set_prop_cache(ctx, push_instr_uint(ctx, OP_memberid, flags));
         break;
     }
     case EXPR_MEMBER: {
@@ -500,7 +508,7 @@ static HRESULT compile_memberid_expression(compiler_ctx_t *ctx, expression_t *ex
         if(FAILED(hres))
             return hres;
 
-        hres = push_instr_uint(ctx, OP_memberid, flags);
+        hres = set_prop_cache(ctx, push_instr_uint(ctx, OP_memberid, flags));
         break;
     }
     DEFAULT_UNREACHABLE;
@@ -2234,11 +2242,16 @@ void release_bytecode(bytecode_t *code)
         SysFreeString(code->bstr_pool[i]);
     for(i=0; i < code->str_cnt; i++)
         jsstr_release(code->str_pool[i]);
+    if(code->prop_caches) {
+        for(i=0; i < code->prop_cache_cnt; i++)
+            prop_cache_release(code->prop_caches + i);
+    }
 
     heap_free(code->source);
     heap_pool_free(&code->heap);
     heap_free(code->bstr_pool);
     heap_free(code->str_pool);
+    heap_free(code->prop_caches);
     heap_free(code->instrs);
     heap_free(code);
 }
@@ -2492,6 +2505,11 @@ HRESULT compile_script(script_ctx_t *ctx, const WCHAR *code, const WCHAR *args,
     hres = compile_function(&compiler, compiler.parser->source, NULL, from_eval, &compiler.code->global_code);
     heap_pool_free(&compiler.heap);
     parser_release(compiler.parser);
+    if(SUCCEEDED(hres) && compiler.code->prop_cache_cnt) {
+        compiler.code->prop_caches = heap_alloc_zero(compiler.code->prop_cache_cnt * sizeof(*compiler.code->prop_caches));
+        if(!compiler.code->prop_caches)
+            hres = E_OUTOFMEMORY;
+    }
     if(FAILED(hres)) {
         release_bytecode(compiler.code);
         return hres;
@@ -57,6 +57,106 @@ struct _dispex_prop_t {
     int bucket_next;
 };
 
+/*
+ * Shapes describe the layout of the props array, that is the names of the
+ * props in the order they were added. Objects that got the same props in the
+ * same order share their shape, so the DISPID a name was found at in one of
+ * them is the DISPID of that name in all of them. The shapes form a tree of
+ * transitions rooted at the script context root shape. Objects with many
+ * props, or that would add too many transitions to a shape, are left without
+ * a shape and are not cached.
+ */
+#define SHAPE_MAX_PROPS     64
+#define SHAPE_MAX_CHILDREN  32
+
+struct _jsshape_t {
+    LONG ref;
+    jsshape_t *parent;
+    jsshape_t *children;
+    jsshape_t *next_sibling;
+    unsigned children_cnt;
+    unsigned prop_cnt;
+    WCHAR name[1];
+};
+
+static jsshape_t *alloc_shape(jsshape_t *parent, const WCHAR *name)
+{
+    jsshape_t *shape;
+    size_t len;
+
+    len = name ? lstrlenW(name) : 0;
+    shape = heap_alloc(FIELD_OFFSET(jsshape_t, name[len+1]));
+    if(!shape)
+        return NULL;
+
+    shape->ref = 1;
+    shape->parent = parent;
+    shape->children = NULL;
+    shape->children_cnt = 0;
+    if(name)
+        memcpy(shape->name, name, (len+1)*sizeof(WCHAR));
+    else
+        shape->name[0] = 0;
+
+    if(parent) {
+        shape->prop_cnt = parent->prop_cnt+1;
+        shape->next_sibling = parent->children;
+        parent->children = shape;
+        parent->children_cnt++;
+    }else {
+        shape->prop_cnt = 1;
+        shape->next_sibling = NULL;
+    }
+    return shape;
+}
+
+static inline jsshape_t *shape_addref(jsshape_t *shape)
+{
+    shape->ref++;
+    return shape;
+}
+
+void release_shape(jsshape_t *shape)
+{
+    jsshape_t *parent, **iter;
+
+    while(shape && !--shape->ref) {
+        parent = shape->parent;
+        if(parent) {
+            for(iter = &parent->children; *iter != shape; iter = &(*iter)->next_sibling);
+            *iter = shape->next_sibling;
+            parent->children_cnt--;
+        }
+        heap_free(shape);
+        shape = parent;
+    }
+}
+
+/* Moves the object to the shape with the prop name appended. */
+static void shape_add_prop(jsdisp_t *This, const WCHAR *name)
+{
+    jsshape_t *shape = This->shape, *iter;
+
+    if(!shape)
+        return;
+
+    for(iter = shape->children; iter; iter = iter->next_sibling) {
+        if(!wcscmp(iter->name, name)) {
+            This->shape = shape_addref(iter);
+            release_shape(shape);
+            return;
+        }
+    }
+
+    /* The new shape takes over the object's reference to its parent. */
+    if(shape->prop_cnt < SHAPE_MAX_PROPS && shape->children_cnt < SHAPE_MAX_CHILDREN)
+        This->shape = alloc_shape(shape, name);
+    else
+        This->shape = NULL;
+    if(!This->shape)
+        release_shape(shape);
+}
+
 static inline DISPID prop_to_id(jsdisp_t *This, dispex_prop_t *prop)
 {
     return prop - This->props;
@@ -179,6 +279,8 @@ static inline dispex_prop_t* alloc_prop(jsdisp_t *This, const WCHAR *name, prop_
     bucket = get_props_idx(This, prop->hash);
     prop->bucket_next = This->props[bucket].bucket_head;
     This->props[bucket].bucket_head = This->prop_cnt++;
+
+    shape_add_prop(This, name);
     return prop;
 }
 
@@ -933,6 +1035,10 @@ HRESULT init_dispex(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *b
         jsdisp_addref(prototype);
 
     dispex->prop_cnt = 1;
+    if(!ctx->root_shape)
+        ctx->root_shape = alloc_shape(NULL, NULL);
+    if(ctx->root_shape)
+        dispex->shape = shape_addref(ctx->root_shape);
     if(builtin_info->value_prop.invoke || builtin_info->value_prop.getter) {
         dispex->props[0].type = PROP_BUILTIN;
         dispex->props[0].u.p = &builtin_info->value_prop;
@@ -996,6 +1102,7 @@ void jsdisp_free(jsdisp_t *obj)
         heap_free(prop->name);
     }
     heap_free(obj->props);
+    release_shape(obj->shape);
     script_release(obj->ctx);
     if(obj->prototype)
         jsdisp_release(obj->prototype);
@@ -1086,6 +1193,37 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+/* Same as jsdisp_get_id, skipping the lookup if the object has the shape of the cache. */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    dispex_prop_t *prop;
+    HRESULT hres;
+
+    if(jsdisp->shape && jsdisp->shape == cache->shape) {
+        prop = jsdisp->props + cache->id;
+        if(prop->type != PROP_DELETED && !wcscmp(prop->name, name)) {
+            *id = cache->id;
+            return S_OK;
+        }
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres) && jsdisp->shape) {
+        if(cache->shape != jsdisp->shape) {
+            release_shape(cache->shape);
+            cache->shape = shape_addref(jsdisp->shape);
+        }
+        cache->id = *id;
+    }
+    return hres;
+}
+
+void prop_cache_release(prop_cache_t *cache)
+{
+    release_shape(cache->shape);
+    cache->shape = NULL;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
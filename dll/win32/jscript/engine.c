@@ -483,6 +483,19 @@ static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name
     return hres;
 }
 
+/* Same as disp_get_id, using the inline cache for our own objects */
+static HRESULT disp_get_id_cached(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name, BSTR name_bstr,
+        DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    jsdisp_t *jsdisp;
+
+    jsdisp = to_jsdisp(disp);
+    if(jsdisp && jsdisp->ctx == ctx)
+        return jsdisp_get_id_cached(jsdisp, name, flags, cache, id);
+
+    return disp_get_id(ctx, disp, name, name_bstr, flags, id);
+}
+
 static HRESULT disp_cmp(IDispatch *disp1, IDispatch *disp2, BOOL *ret)
 {
     IObjectIdentity *identity;
@@ -632,7 +645,7 @@ local_ref_t *lookup_local(const function_code_t *function, const WCHAR *identifi
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
-static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache, exprval_t *ret)
 {
     scope_chain_t *scope;
     named_item_t *item;
@@ -672,7 +685,10 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
         }
     }
 
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    if(cache)
+        hres = jsdisp_get_id_cached(ctx->global, identifier, 0, cache, &id);
+    else
+        hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
     if(SUCCEEDED(hres)) {
         exprval_set_disp_ref(ret, to_disp(ctx->global), id);
         return S_OK;
@@ -745,6 +761,12 @@ static inline double get_op_double(script_ctx_t *ctx)
     return frame->bytecode->instrs[frame->ip].u.dbl;
 }
 
+static inline prop_cache_t *get_op_cache(script_ctx_t *ctx)
+{
+    call_frame_t *frame = ctx->call_ctx;
+    return frame->bytecode->prop_caches + frame->bytecode->instrs[frame->ip].cache;
+}
+
 static inline void jmp_next(script_ctx_t *ctx)
 {
     ctx->call_ctx->ip++;
@@ -1078,7 +1100,7 @@ static HRESULT interp_member(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, arg, arg, 0, &id);
+    hres = disp_get_id_cached(ctx, obj, arg, arg, 0, get_op_cache(ctx), &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1120,7 +1142,7 @@ static HRESULT interp_memberid(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, name, NULL, arg, &id);
+    hres = disp_get_id_cached(ctx, obj, name, NULL, arg, get_op_cache(ctx), &id);
     jsstr_release(name_str);
     if(SUCCEEDED(hres)) {
         ref.type = EXPRVAL_IDREF;
@@ -1229,12 +1251,12 @@ static HRESULT interp_this(script_ctx_t *ctx)
     return stack_push(ctx, jsval_disp(frame->this_obj));
 }
 
-static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigned flags)
+static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigned flags, prop_cache_t *cache)
 {
     exprval_t exprval;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, cache, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1257,13 +1279,13 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     return stack_push_exprval(ctx, &exprval);
 }
 
-static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier)
+static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache)
 {
     exprval_t exprval;
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, cache, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1287,7 +1309,7 @@ static HRESULT interp_local_ref(script_ctx_t *ctx)
     TRACE("%d\n", arg);
 
     if(!frame->base_scope || !frame->base_scope->frame)
-        return interp_identifier_ref(ctx, local_name(frame, arg), flags);
+        return interp_identifier_ref(ctx, local_name(frame, arg), flags, NULL);
 
     ref.type = EXPRVAL_STACK_REF;
     ref.u.off = local_off(frame, arg);
@@ -1304,7 +1326,7 @@ static HRESULT interp_local(script_ctx_t *ctx)
     TRACE("%d: %s\n", arg, debugstr_w(local_name(frame, arg)));
 
     if(!frame->base_scope || !frame->base_scope->frame)
-        return identifier_value(ctx, local_name(frame, arg));
+        return identifier_value(ctx, local_name(frame, arg), NULL);
 
     hres = jsval_copy(ctx->stack[local_off(frame, arg)], &copy);
     if(FAILED(hres))
@@ -1320,7 +1342,7 @@ static HRESULT interp_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    return identifier_value(ctx, arg);
+    return identifier_value(ctx, arg, get_op_cache(ctx));
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
@@ -1331,7 +1353,7 @@ static HRESULT interp_identid(script_ctx_t *ctx)
 
     TRACE("%s %x\n", debugstr_w(arg), flags);
 
-    return interp_identifier_ref(ctx, arg, flags);
+    return interp_identifier_ref(ctx, arg, flags, get_op_cache(ctx));
 }
 
 /* ECMA-262 3rd Edition    7.8.1 */
@@ -1887,7 +1909,7 @@ static HRESULT interp_delete_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1998,7 +2020,7 @@ static HRESULT interp_typeofident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -2850,7 +2872,7 @@ static HRESULT bind_event_target(script_ctx_t *ctx, function_code_t *func, jsdis
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, func->event_target, &exprval);
+    hres = identifier_eval(ctx, func->event_target, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
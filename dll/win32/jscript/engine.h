@@ -125,6 +125,7 @@ typedef enum {
 
 typedef struct {
     jsop_t op;
+    unsigned cache; /* prop_caches index of the property lookups */
     union {
         instr_arg_t arg[2];
         double dbl;
@@ -187,6 +188,9 @@ typedef struct _bytecode_t {
     unsigned str_pool_size;
     unsigned str_cnt;
 
+    prop_cache_t *prop_caches;
+    unsigned prop_cache_cnt;
+
     struct _bytecode_t *next;
 } bytecode_t;
 
@@ -78,6 +78,7 @@ void script_release(script_ctx_t *ctx)
         jsstr_release(ctx->last_match);
     assert(!ctx->stack_top);
     heap_free(ctx->stack);
+    release_shape(ctx->root_shape);
 
     ctx->jscaller->ctx = NULL;
     IServiceProvider_Release(&ctx->jscaller->IServiceProvider_iface);
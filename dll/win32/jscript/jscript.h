@@ -56,6 +56,7 @@ typedef struct _jsstr_t jsstr_t;
 typedef struct _script_ctx_t script_ctx_t;
 typedef struct _dispex_prop_t dispex_prop_t;
 typedef struct _property_desc_t property_desc_t;
+typedef struct _jsshape_t jsshape_t;
 
 typedef struct {
     void **blocks;
@@ -235,6 +236,7 @@ struct jsdisp_t {
     DWORD buf_size;
     DWORD prop_cnt;
     dispex_prop_t *props;
+    jsshape_t *shape;
     script_ctx_t *ctx;
 
     jsdisp_t *prototype;
@@ -296,6 +298,20 @@ HRESULT jsdisp_propput_idx(jsdisp_t*,DWORD,jsval_t) DECLSPEC_HIDDEN;
 HRESULT jsdisp_propget_name(jsdisp_t*,LPCWSTR,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_idx(jsdisp_t*,DWORD,jsval_t*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_get_id(jsdisp_t*,const WCHAR*,DWORD,DISPID*) DECLSPEC_HIDDEN;
+
+/*
+ * Inline cache of a property lookup. It remembers the DISPID a name was last
+ * found at together with the shape of the object, so the lookup is skipped
+ * for objects with the same shape.
+ */
+typedef struct {
+    jsshape_t *shape;
+    DISPID id;
+} prop_cache_t;
+
+HRESULT jsdisp_get_id_cached(jsdisp_t*,const WCHAR*,DWORD,prop_cache_t*,DISPID*) DECLSPEC_HIDDEN;
+void prop_cache_release(prop_cache_t*) DECLSPEC_HIDDEN;
+void release_shape(jsshape_t*) DECLSPEC_HIDDEN;
 HRESULT disp_delete(IDispatch*,DISPID,BOOL*) DECLSPEC_HIDDEN;
 HRESULT disp_delete_name(script_ctx_t*,IDispatch*,jsstr_t*,BOOL*) DECLSPEC_HIDDEN;
 HRESULT jsdisp_delete_idx(jsdisp_t*,DWORD) DECLSPEC_HIDDEN;
@@ -438,6 +454,8 @@ struct _script_ctx_t {
     DWORD last_match_index;
     DWORD last_match_length;
 
+    jsshape_t *root_shape;
+
     jsdisp_t *global;
     jsdisp_t *function_constr;
     jsdisp_t *array_constr;
@@ -25,6 +25,17 @@ QueryPerformanceCounter(OUT PLARGE_INTEGER lpPerformanceCount)
     LARGE_INTEGER Frequency;
     NTSTATUS Status;
 
+#if defined(_M_IX86) || defined(_M_AMD64)
+    /* Read the counter without entering the kernel if the HAL allows it,
+       like RtlQueryPerformanceCounter, which is not exported on NT 5.2 */
+    if (SharedUserTscQpcData->Enabled)
+    {
+        lpPerformanceCount->QuadPart = (__rdtsc() + SharedUserTscQpcData->Bias) >>
+                                       SharedUserTscQpcData->Shift;
+        return TRUE;
+    }
+#endif
+
     Status = NtQueryPerformanceCounter(lpPerformanceCount, &Frequency);
     if (Frequency.QuadPart == 0) Status = STATUS_NOT_IMPLEMENTED;
     
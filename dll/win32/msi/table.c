@@ -48,6 +48,23 @@ typedef struct tagMSICOLUMNHASHENTRY
     UINT row;
 } MSICOLUMNHASHENTRY;
 
+/* each row gets an id that stays the same while other rows are inserted or
+ * deleted; rows with the same primary key hash are chained by id plus one */
+typedef struct tagMSIKEYINDEX
+{
+    UINT  bucket_count; /* power of two */
+    UINT *buckets;      /* first id of each chain, 0 if empty */
+    UINT *next;         /* next id in the chain, or in the free list */
+    UINT *hash;         /* key hash of each id */
+    UINT *ids;          /* id of each row */
+    UINT *rows;         /* row of each id, valid for the rows below stale */
+    UINT  row_count;    /* rows in the index */
+    UINT  id_count;     /* ids handed out so far */
+    UINT  id_alloc;     /* ids allocated in next, hash, ids and rows */
+    UINT  free_ids;     /* first free id plus one */
+    UINT  stale;        /* first row whose entry in rows may be out of date */
+} MSIKEYINDEX;
+
 typedef struct tagMSICOLUMNINFO
 {
     LPCWSTR tablename;
@@ -58,6 +75,7 @@ typedef struct tagMSICOLUMNINFO
     INT     ref_count;
     BOOL    temporary;
     MSICOLUMNHASHENTRY **hash_table;
+    UINT    hash_size;
 } MSICOLUMNINFO;
 
 struct tagMSITABLE
@@ -70,6 +88,7 @@ struct tagMSITABLE
     UINT col_count;
     MSICONDITION persistent;
     INT ref_count;
+    MSIKEYINDEX *key_index;
     WCHAR name[1];
 };
 
@@ -369,6 +388,18 @@ static void msi_free_colinfo( MSICOLUMNINFO *colinfo, UINT count )
     for (i = 0; i < count; i++) msi_free( colinfo[i].hash_table );
 }
 
+static void free_key_index( MSITABLE *table )
+{
+    if (!table->key_index) return;
+    msi_free( table->key_index->buckets );
+    msi_free( table->key_index->next );
+    msi_free( table->key_index->hash );
+    msi_free( table->key_index->ids );
+    msi_free( table->key_index->rows );
+    msi_free( table->key_index );
+    table->key_index = NULL;
+}
+
 static void free_table( MSITABLE *table )
 {
     UINT i;
@@ -378,6 +409,7 @@ static void free_table( MSITABLE *table )
     msi_free( table->data_persistent );
     msi_free_colinfo( table->colinfo, table->col_count );
     msi_free( table->colinfo );
+    free_key_index( table );
     msi_free( table );
 }
 
@@ -603,6 +635,7 @@ static UINT get_table( MSIDATABASE *db, LPCWSTR name, MSITABLE **table_ret )
     table->data_persistent = NULL;
     table->colinfo = NULL;
     table->col_count = 0;
+    table->key_index = NULL;
     table->persistent = MSICONDITION_TRUE;
     lstrcpyW( table->name, name );
 
@@ -741,6 +774,7 @@ UINT msi_create_table( MSIDATABASE *db, LPCWSTR name, column_info *col_info,
     table->data_persistent = NULL;
     table->colinfo = NULL;
     table->col_count = 0;
+    table->key_index = NULL;
     table->persistent = persistent;
     lstrcpyW( table->name, name );
 
@@ -952,6 +986,7 @@ static void msi_update_table_columns( MSIDATABASE *db, LPCWSTR name )
     msi_free_colinfo( table->colinfo, table->col_count );
     msi_free( table->colinfo );
     table->colinfo = NULL;
+    free_key_index( table );
 
     table_get_column_info( db, name, &table->colinfo, &table->col_count );
     if (!table->col_count) return;
@@ -1325,17 +1360,216 @@ static UINT get_table_value_from_record( MSITABLEVIEW *tv, MSIRECORD *rec, UINT
     return ERROR_SUCCESS;
 }
 
-static UINT TABLE_set_row( struct tagMSIVIEW *view, UINT row, MSIRECORD *rec, UINT mask )
+#define MSITABLE_KEY_INDEX_MIN_SIZE 16
+
+static UINT key_hash_add( UINT hash, UINT value )
 {
-    MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
-    UINT i, val, r = ERROR_SUCCESS;
+    return (hash ^ value) * 0x01000193;
+}
 
-    if ( !tv->table )
-        return ERROR_INVALID_PARAMETER;
+static UINT table_key_mask( const MSITABLEVIEW *tv )
+{
+    UINT i, mask = 0;
 
-    /* test if any of the mask bits are invalid */
-    if ( mask >= (1<<tv->num_cols) )
-        return ERROR_INVALID_PARAMETER;
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        if (tv->columns[i].type & MSITYPE_KEY)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+static UINT table_row_key_hash( MSITABLEVIEW *tv, UINT row )
+{
+    UINT i, x, hash = 0x811c9dc5;
+
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        if (~tv->columns[i].type & MSITYPE_KEY)
+            continue;
+
+        if (TABLE_fetch_int( &tv->view, row, i + 1, &x ) != ERROR_SUCCESS)
+            x = 0;
+        hash = key_hash_add( hash, x );
+    }
+    return hash;
+}
+
+static UINT table_data_key_hash( const MSITABLEVIEW *tv, const UINT *data )
+{
+    UINT i, hash = 0x811c9dc5;
+
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        if (~tv->columns[i].type & MSITYPE_KEY)
+            continue;
+
+        hash = key_hash_add( hash, data[i] );
+    }
+    return hash;
+}
+
+static void key_index_link( MSIKEYINDEX *index, UINT row, UINT hash )
+{
+    UINT id = index->ids[row];
+    UINT *bucket = &index->buckets[hash & (index->bucket_count - 1)];
+
+    index->hash[id] = hash;
+    index->next[id] = *bucket;
+    *bucket = id + 1;
+}
+
+static void key_index_unlink( MSIKEYINDEX *index, UINT row )
+{
+    UINT id = index->ids[row];
+    UINT *link = &index->buckets[index->hash[id] & (index->bucket_count - 1)];
+
+    while (*link && *link != id + 1)
+        link = &index->next[*link - 1];
+
+    if (*link)
+        *link = index->next[id];
+    index->next[id] = 0;
+}
+
+/* returns the current row of an id, renumbering the rows that moved */
+static UINT key_index_row( MSIKEYINDEX *index, UINT id )
+{
+    for (; index->stale < index->row_count; index->stale++)
+        index->rows[index->ids[index->stale]] = index->stale;
+
+    return index->rows[id];
+}
+
+static BOOL key_index_rehash( MSIKEYINDEX *index, UINT bucket_count )
+{
+    UINT *buckets, i;
+
+    if (!(buckets = msi_alloc_zero( bucket_count * sizeof(UINT) )))
+        return FALSE;
+
+    msi_free( index->buckets );
+    index->buckets = buckets;
+    index->bucket_count = bucket_count;
+
+    /* link backwards so that the chains are in row order */
+    for (i = index->row_count; i-- > 0;)
+        key_index_link( index, i, index->hash[index->ids[i]] );
+
+    return TRUE;
+}
+
+static BOOL key_index_grow( MSIKEYINDEX *index )
+{
+    UINT *next, *hash, *ids, *rows, size = index->id_alloc * 2;
+
+    if (!(next = msi_realloc( index->next, size * sizeof(UINT) )))
+        return FALSE;
+    index->next = next;
+    if (!(hash = msi_realloc( index->hash, size * sizeof(UINT) )))
+        return FALSE;
+    index->hash = hash;
+    if (!(ids = msi_realloc( index->ids, size * sizeof(UINT) )))
+        return FALSE;
+    index->ids = ids;
+    if (!(rows = msi_realloc( index->rows, size * sizeof(UINT) )))
+        return FALSE;
+    index->rows = rows;
+    index->id_alloc = size;
+    return TRUE;
+}
+
+/* gives a new id to a row inserted before the given one, the other ids stay */
+static BOOL key_index_insert_row( MSIKEYINDEX *index, UINT row )
+{
+    UINT id;
+
+    /* grow the buckets while all the rows are still linked */
+    if (index->row_count >= index->bucket_count * 2 &&
+        !key_index_rehash( index, index->bucket_count * 4 ))
+        return FALSE;
+
+    if (index->free_ids)
+    {
+        id = index->free_ids - 1;
+        index->free_ids = index->next[id];
+    }
+    else
+    {
+        if (index->id_count == index->id_alloc && !key_index_grow( index ))
+            return FALSE;
+        id = index->id_count++;
+    }
+    index->next[id] = 0;
+    index->hash[id] = 0;
+
+    memmove( &index->ids[row + 1], &index->ids[row], (index->row_count - row) * sizeof(UINT) );
+    index->ids[row] = id;
+    index->row_count++;
+    index->stale = min( index->stale, row );
+    return TRUE;
+}
+
+static void key_index_delete_row( MSIKEYINDEX *index, UINT row )
+{
+    UINT id = index->ids[row];
+
+    key_index_unlink( index, row );
+    index->next[id] = index->free_ids;
+    index->free_ids = id + 1;
+
+    memmove( &index->ids[row], &index->ids[row + 1], (index->row_count - row - 1) * sizeof(UINT) );
+    index->row_count--;
+    index->stale = min( index->stale, row );
+}
+
+/* returns the primary key index of the table, building it the first time */
+static MSIKEYINDEX *table_get_key_index( MSITABLEVIEW *tv )
+{
+    MSITABLE *table = tv->table;
+    MSIKEYINDEX *index = table->key_index;
+    UINT size = MSITABLE_KEY_INDEX_MIN_SIZE, i;
+
+    if (index && index->row_count == table->row_count)
+        return index;
+
+    free_key_index( table );
+    if (!table_key_mask( tv ))
+        return NULL;
+
+    while (size < table->row_count)
+        size <<= 1;
+
+    if (!(index = msi_alloc_zero( sizeof(*index) )))
+        return NULL;
+    index->bucket_count = size;
+    index->id_alloc = size;
+    index->buckets = msi_alloc_zero( size * sizeof(UINT) );
+    index->next = msi_alloc( size * sizeof(UINT) );
+    index->hash = msi_alloc( size * sizeof(UINT) );
+    index->ids = msi_alloc( size * sizeof(UINT) );
+    index->rows = msi_alloc( size * sizeof(UINT) );
+    table->key_index = index;
+    if (!index->buckets || !index->next || !index->hash || !index->ids || !index->rows)
+    {
+        free_key_index( table );
+        return NULL;
+    }
+
+    /* the ids start out equal to the rows */
+    index->row_count = index->id_count = index->stale = table->row_count;
+    for (i = 0; i < table->row_count; i++)
+        index->ids[i] = index->rows[i] = i;
+    for (i = table->row_count; i-- > 0;)
+        key_index_link( index, i, table_row_key_hash( tv, i ) );
+
+    TRACE("built key index of %s, %u rows\n", debugstr_w(table->name), table->row_count);
+    return index;
+}
+
+static UINT table_set_row_values( MSITABLEVIEW *tv, UINT row, MSIRECORD *rec, UINT mask )
+{
+    UINT i, val, r = ERROR_SUCCESS;
 
     for ( i = 0; i < tv->num_cols; i++ )
     {
@@ -1411,6 +1645,35 @@ static UINT TABLE_set_row( struct tagMSIVIEW *view, UINT row, MSIRECORD *rec, UI
     return r;
 }
 
+static UINT TABLE_set_row( struct tagMSIVIEW *view, UINT row, MSIRECORD *rec, UINT mask )
+{
+    MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
+    MSIKEYINDEX *index;
+    UINT r;
+
+    if ( !tv->table )
+        return ERROR_INVALID_PARAMETER;
+
+    /* test if any of the mask bits are invalid */
+    if ( mask >= (1<<tv->num_cols) )
+        return ERROR_INVALID_PARAMETER;
+
+    /* a row whose key changes moves to another chain of the key index */
+    index = tv->table->key_index;
+    if ( index && (!(mask & table_key_mask( tv )) || row >= index->row_count) )
+        index = NULL;
+
+    if ( index )
+        key_index_unlink( index, row );
+
+    r = table_set_row_values( tv, row, rec, mask );
+
+    if ( index )
+        key_index_link( index, row, table_row_key_hash( tv, row ) );
+
+    return r;
+}
+
 static UINT table_create_new_row( struct tagMSIVIEW *view, UINT *num, BOOL temporary )
 {
     MSITABLEVIEW *tv = (MSITABLEVIEW*)view;
@@ -1672,6 +1935,10 @@ static UINT TABLE_insert_row( struct tagMSIVIEW *view, MSIRECORD *rec, UINT row,
         tv->table->data_persistent[i] = tv->table->data_persistent[i - 1];
     }
 
+    /* the new row is added to the key index once its values are set */
+    if (tv->table->key_index && !key_index_insert_row( tv->table->key_index, row ))
+        free_key_index( tv->table );
+
     /* Re-set the persistence flag */
     tv->table->data_persistent[row] = !temporary;
     return TABLE_set_row( view, row, rec, (1<<tv->num_cols) - 1 );
@@ -1704,6 +1971,9 @@ static UINT TABLE_delete_row( struct tagMSIVIEW *view, UINT row )
         tv->columns[i].hash_table = NULL;
     }
 
+    if (tv->table->key_index)
+        key_index_delete_row( tv->table->key_index, row );
+
     for (i = row + 1; i < num_rows; i++)
     {
         memcpy(tv->table->data[i - 1], tv->table->data[i], tv->row_size);
@@ -1895,6 +2165,7 @@ static UINT TABLE_find_matching_rows( struct tagMSIVIEW *view, UINT col,
     {
         UINT i;
         UINT num_rows = tv->table->row_count;
+        UINT hash_size = max( num_rows, MSITABLE_HASH_TABLE_SIZE );
         MSICOLUMNHASHENTRY **hash_table;
         MSICOLUMNHASHENTRY *new_entry;
 
@@ -1906,41 +2177,37 @@ static UINT TABLE_find_matching_rows( struct tagMSIVIEW *view, UINT col,
         }
 
         /* allocate contiguous memory for the table and its entries so we
-         * don't have to do an expensive cleanup */
-        hash_table = msi_alloc(MSITABLE_HASH_TABLE_SIZE * sizeof(MSICOLUMNHASHENTRY*) +
+         * don't have to do an expensive cleanup; the table grows with the
+         * rows so that the chains stay short */
+        hash_table = msi_alloc(hash_size * sizeof(MSICOLUMNHASHENTRY*) +
             num_rows * sizeof(MSICOLUMNHASHENTRY));
         if (!hash_table)
             return ERROR_OUTOFMEMORY;
 
-        memset(hash_table, 0, MSITABLE_HASH_TABLE_SIZE * sizeof(MSICOLUMNHASHENTRY*));
+        memset(hash_table, 0, hash_size * sizeof(MSICOLUMNHASHENTRY*));
         tv->columns[col-1].hash_table = hash_table;
+        tv->columns[col-1].hash_size = hash_size;
 
-        new_entry = (MSICOLUMNHASHENTRY *)(hash_table + MSITABLE_HASH_TABLE_SIZE);
+        new_entry = (MSICOLUMNHASHENTRY *)(hash_table + hash_size) + num_rows;
 
-        for (i = 0; i < num_rows; i++, new_entry++)
+        /* insert backwards at the head of the chains, keeping them in row order */
+        for (i = num_rows; i-- > 0;)
         {
             UINT row_value;
 
             if (view->ops->fetch_int( view, i, col, &row_value ) != ERROR_SUCCESS)
                 continue;
 
-            new_entry->next = NULL;
+            new_entry--;
             new_entry->value = row_value;
             new_entry->row = i;
-            if (hash_table[row_value % MSITABLE_HASH_TABLE_SIZE])
-            {
-                MSICOLUMNHASHENTRY *prev_entry = hash_table[row_value % MSITABLE_HASH_TABLE_SIZE];
-                while (prev_entry->next)
-                    prev_entry = prev_entry->next;
-                prev_entry->next = new_entry;
-            }
-            else
-                hash_table[row_value % MSITABLE_HASH_TABLE_SIZE] = new_entry;
+            new_entry->next = hash_table[row_value % hash_size];
+            hash_table[row_value % hash_size] = new_entry;
         }
     }
 
     if( !*handle )
-        entry = tv->columns[col-1].hash_table[val % MSITABLE_HASH_TABLE_SIZE];
+        entry = tv->columns[col-1].hash_table[val % tv->columns[col-1].hash_size];
     else
         entry = (*handle)->next;
 
@@ -2499,11 +2766,33 @@ static UINT msi_row_matches( MSITABLEVIEW *tv, UINT row, const UINT *data, UINT
 
 static UINT msi_table_find_row( MSITABLEVIEW *tv, MSIRECORD *rec, UINT *row, UINT *column )
 {
-    UINT i, r = ERROR_FUNCTION_FAILED, *data;
+    UINT i, hash, r = ERROR_FUNCTION_FAILED, *data;
+    MSIKEYINDEX *index;
 
     data = msi_record_to_row( tv, rec );
     if( !data )
         return r;
+
+    /* only the rows with the same key hash can match */
+    if ((index = table_get_key_index( tv )))
+    {
+        hash = table_data_key_hash( tv, data );
+        for (i = index->buckets[hash & (index->bucket_count - 1)]; i; i = index->next[i - 1])
+        {
+            if (index->hash[i - 1] != hash)
+                continue;
+
+            r = msi_row_matches( tv, key_index_row( index, i - 1 ), data, column );
+            if (r == ERROR_SUCCESS)
+            {
+                *row = key_index_row( index, i - 1 );
+                break;
+            }
+        }
+        msi_free( data );
+        return r;
+    }
+
     for( i = 0; i < tv->table->row_count; i++ )
     {
         r = msi_row_matches( tv, i, data, column );
@@ -599,16 +599,150 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+static inline UINT expr_value_offset( const struct expr *expr )
+{
+    return expr->type == EXPR_COL_NUMBER32 ? 0x80000000 : 0x8000;
+}
+
+static inline BOOL expr_is_column_of( const struct expr *expr, const JOINTABLE *table )
+{
+    return (expr->type == EXPR_COL_NUMBER || expr->type == EXPR_COL_NUMBER32 ||
+            expr->type == EXPR_COL_NUMBER_STRING) && expr->u.column.parsed.table == table;
+}
+
+/* a column of a table that comes before the one being iterated */
+static inline BOOL expr_is_bound_column( const struct expr *expr, const JOINTABLE *table,
+                                         const UINT rows[] )
+{
+    return (expr->type == EXPR_COL_NUMBER || expr->type == EXPR_COL_NUMBER32 ||
+            expr->type == EXPR_COL_NUMBER_STRING) && expr->u.column.parsed.table != table &&
+           rows[expr->u.column.parsed.table->table_index] != INVALID_ROW_INDEX;
+}
+
+/*
+ * Looks for an equality between a column of the table and a constant or a
+ * column of a table that is already bound, among the terms that are ANDed
+ * together at the top of the condition. On success, only the rows having
+ * the returned raw value in the column can satisfy the condition.
+ * Returns ERROR_NO_MORE_ITEMS when no row can, and ERROR_FUNCTION_FAILED
+ * when the table has to be scanned.
+ */
+static UINT get_lookup_value( MSIWHEREVIEW *wv, const struct expr *cond, const JOINTABLE *table,
+                              const UINT rows[], UINT *col, UINT *val )
+{
+    const struct expr *left, *right;
+    const WCHAR *str;
+    UINT r;
+
+    if (!cond || (cond->type != EXPR_COMPLEX && cond->type != EXPR_STRCMP))
+        return ERROR_FUNCTION_FAILED;
+
+    if (cond->type == EXPR_COMPLEX && cond->u.expr.op == OP_AND)
+    {
+        r = get_lookup_value( wv, cond->u.expr.left, table, rows, col, val );
+        if (r != ERROR_FUNCTION_FAILED)
+            return r;
+        return get_lookup_value( wv, cond->u.expr.right, table, rows, col, val );
+    }
+
+    if (cond->u.expr.op != OP_EQ)
+        return ERROR_FUNCTION_FAILED;
+
+    left = cond->u.expr.left;
+    right = cond->u.expr.right;
+    if (!expr_is_column_of( left, table ))
+    {
+        left = cond->u.expr.right;
+        right = cond->u.expr.left;
+        if (!expr_is_column_of( left, table ))
+            return ERROR_FUNCTION_FAILED;
+    }
+
+    if (cond->type == EXPR_STRCMP)
+    {
+        if (left->type != EXPR_COL_NUMBER_STRING)
+            return ERROR_FUNCTION_FAILED;
+
+        /* strings are stored once, so equal strings have the same id; empty
+         * strings also match null values, those are left to the scan */
+        if (right->type == EXPR_SVAL)
+        {
+            if (!right->u.sval || !*right->u.sval)
+                return ERROR_FUNCTION_FAILED;
+            if (msi_string2id( wv->db->strings, right->u.sval, -1, val ) != ERROR_SUCCESS)
+                return ERROR_NO_MORE_ITEMS;
+        }
+        else if (right->type == EXPR_COL_NUMBER_STRING && expr_is_bound_column( right, table, rows ))
+        {
+            if (expr_fetch_value( &right->u.column, rows, val ) != ERROR_SUCCESS)
+                return ERROR_FUNCTION_FAILED;
+            str = msi_string_lookup( wv->db->strings, *val, NULL );
+            if (!str || !*str)
+                return ERROR_FUNCTION_FAILED;
+        }
+        else
+            return ERROR_FUNCTION_FAILED;
+    }
+    else
+    {
+        if (left->type != EXPR_COL_NUMBER && left->type != EXPR_COL_NUMBER32)
+            return ERROR_FUNCTION_FAILED;
+
+        /* integers are stored with an offset, see WHERE_evaluate */
+        if (right->type == EXPR_UVAL)
+            *val = right->u.uval + expr_value_offset( left );
+        else if (right->type != EXPR_COL_NUMBER_STRING && expr_is_bound_column( right, table, rows ))
+        {
+            if (expr_fetch_value( &right->u.column, rows, val ) != ERROR_SUCCESS)
+                return ERROR_FUNCTION_FAILED;
+            *val = *val - expr_value_offset( right ) + expr_value_offset( left );
+        }
+        else
+            return ERROR_FUNCTION_FAILED;
+    }
+
+    *col = left->u.column.parsed.column;
+    return ERROR_SUCCESS;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
     UINT r = ERROR_FUNCTION_FAILED;
+    JOINTABLE *table = *tables;
+    MSIITERHANDLE handle = NULL;
+    UINT row, col, value, res;
+    BOOL lookup;
     INT val;
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    /* when the condition requires a value in a column of the table, only
+     * the rows found in the hash of the column are evaluated */
+    res = get_lookup_value( wv, wv->cond, table, table_rows, &col, &value );
+    if (res == ERROR_NO_MORE_ITEMS)
+        return ERROR_SUCCESS;
+    lookup = (res == ERROR_SUCCESS);
+    if (lookup)
+        r = ERROR_SUCCESS;
+
+    for (row = 0;; row++)
     {
+        if (lookup)
+        {
+            res = table->view->ops->find_matching_rows( table->view, col, value, &row, &handle );
+            if (res == ERROR_NO_MORE_ITEMS)
+                break;
+            if (res != ERROR_SUCCESS)
+            {
+                /* the hash could not be built, fall back to the scan */
+                lookup = FALSE;
+                row = 0;
+            }
+        }
+        if (!lookup && row >= table->row_count)
+            break;
+
+        table_rows[table->table_index] = row;
+
         val = 0;
         wv->rec_index = 0;
         r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
@@ -630,7 +764,7 @@ static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **ta
             }
         }
     }
-    table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
+    table_rows[table->table_index] = INVALID_ROW_INDEX;
     return r;
 }
 
@@ -0,0 +1,1133 @@
+/*
+ * PROJECT:     ReactOS RPC runtime
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     ncalrpc transport over LPC ports
+ *
+ * Each ncalrpc endpoint is a waitable LPC connection port named
+ * "\RPC Control\<endpoint>". The protseq thread waits on it and routes the
+ * messages of every client to its connection, whose io thread reads them
+ * as a byte stream like the pipe transport does.
+ *
+ * Small writes travel inline in the port messages. Larger ones are copied
+ * to a section the client maps when it connects, which holds one ring for
+ * each direction, and only their location is sent. A client whose ring is
+ * full waits for the server to read it, so that the messages the protseq
+ * thread queues for a connection stay bounded.
+ *
+ * A synchronous client sends the last message of a call as an LPC request
+ * and gets the first message of the answer as the reply. Besides saving a
+ * wakeup, this lets the server impersonate the client, which LPC only
+ * allows while the client thread waits for a reply. Everything else is
+ * sent as datagrams.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winbase.h"
+#include "winnls.h"
+#include "winerror.h"
+
+#include "rpc.h"
+#include "rpcndr.h"
+
+#define NTOS_MODE_USER
+#include <ndk/lpcfuncs.h>
+#include <ndk/mmfuncs.h>
+#include <ndk/obfuncs.h>
+#include <ndk/rtlfuncs.h>
+
+#include "wine/debug.h"
+
+#include "rpc_binding.h"
+#include "rpc_message.h"
+#include "rpc_server.h"
+#include "rpc_lpc.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(rpc);
+
+#define LRPC_VERSION            1
+
+/* LRPC_CONNECT_INFO flags */
+#define LRPC_CONNECT_PROBE      0x1 /* only checks the server is listening */
+
+/* LRPC_MESSAGE flags */
+#define LRPC_VIEW_DATA          0x1 /* data is in the ring of the sender */
+#define LRPC_KEEPALIVE          0x2 /* no data, checks the peer is still there */
+#define LRPC_CLOSE              0x4 /* no data, the server closed the connection */
+#define LRPC_WAKEUP             0x8 /* no data, echoed by the server to wake up the client reader */
+
+/* bytes in each direction of the shared view, a power of two */
+#define LRPC_RING_SIZE          0x8000
+
+/* how often a client waiting for data checks the server is still there,
+ * closing a server port does not wake up the client */
+#define LRPC_KEEPALIVE_INTERVAL 1000
+
+/* messages queued for a server connection before it is dropped */
+#define LRPC_MAX_QUEUED         1024
+
+typedef struct _LRPC_CONNECT_INFO
+{
+    ULONG Version;
+    ULONG Flags;
+} LRPC_CONNECT_INFO;
+
+typedef struct _LRPC_MESSAGE
+{
+    PORT_MESSAGE Header;
+    ULONG Flags;
+    ULONG Length;   /* data bytes, inline or in the ring */
+    ULONG Offset;   /* ring offset of the data */
+    ULONG Release;  /* ring bytes given back once the data was read */
+    UCHAR Data[PORT_MAXIMUM_MESSAGE_LENGTH - sizeof(PORT_MESSAGE) - 4 * sizeof(ULONG)];
+} LRPC_MESSAGE;
+
+C_ASSERT(sizeof(LRPC_MESSAGE) == PORT_MAXIMUM_MESSAGE_LENGTH);
+
+#define LRPC_MAX_INLINE_DATA    RTL_FIELD_SIZE(LRPC_MESSAGE, Data)
+#define LRPC_HEADER_DATA_LENGTH (FIELD_OFFSET(LRPC_MESSAGE, Data) - sizeof(PORT_MESSAGE))
+
+/* Shared view created by the client. The client writes Ring[0] and the
+ * server Ring[1], each reader adds what it consumed to Released[] */
+typedef struct _LRPC_VIEW
+{
+    LONG Released[2];
+    UCHAR Padding[64 - 2 * sizeof(LONG)];
+    UCHAR Ring[2][LRPC_RING_SIZE];
+} LRPC_VIEW;
+
+typedef struct _LRPC_QUEUED_MESSAGE
+{
+    struct list entry;
+    LRPC_MESSAGE msg;
+} LRPC_QUEUED_MESSAGE;
+
+typedef struct _RpcConnection_lpc
+{
+    RpcConnection common;
+    HANDLE port;            /* connection port of listeners, communication port otherwise */
+    BOOL listener;
+    LRPC_VIEW *view;
+    ULONG produced;         /* ring bytes used so far by our writes, CS write_cs */
+    CRITICAL_SECTION write_cs;
+    CRITICAL_SECTION cs;
+    /* server-only */
+    struct list queue;      /* messages routed by the protseq thread, CS cs */
+    ULONG queued;           /* entries in queue, CS cs */
+    HANDLE queue_event;
+    PORT_MESSAGE request;   /* LPC request waiting for our reply, CS cs */
+    BOOL request_pending;
+    /* message being read */
+    LRPC_MESSAGE recv;
+    ULONG recv_pos;
+    BOOL recv_valid;
+    volatile LONG read_closed;
+    volatile LONG cancelled;
+    volatile LONG disconnected;
+} RpcConnection_lpc;
+
+typedef struct _RpcServerProtseq_lpc
+{
+    RpcServerProtseq common;
+    HANDLE mgr_event;
+} RpcServerProtseq_lpc;
+
+static inline unsigned int lrpc_read_ring(const RpcConnection_lpc *conn)
+{
+    return conn->common.server ? 0 : 1;
+}
+
+static inline unsigned int lrpc_write_ring(const RpcConnection_lpc *conn)
+{
+    return conn->common.server ? 1 : 0;
+}
+
+static WCHAR *lrpc_port_name(const char *endpoint, UNICODE_STRING *name)
+{
+    static const WCHAR prefix[] = L"\\RPC Control\\";
+    WCHAR *buffer;
+    int len;
+
+    len = MultiByteToWideChar(CP_ACP, 0, endpoint, -1, NULL, 0);
+    buffer = HeapAlloc(GetProcessHeap(), 0, sizeof(prefix) + len * sizeof(WCHAR));
+    if (!buffer)
+        return NULL;
+
+    memcpy(buffer, prefix, sizeof(prefix));
+    MultiByteToWideChar(CP_ACP, 0, endpoint, -1, buffer + ARRAY_SIZE(prefix) - 1, len);
+    RtlInitUnicodeString(name, buffer);
+    return buffer;
+}
+
+static void lrpc_get_qos(const RpcConnection *conn, SECURITY_QUALITY_OF_SERVICE *qos)
+{
+    qos->Length = sizeof(*qos);
+    qos->ImpersonationLevel = SecurityImpersonation;
+    qos->ContextTrackingMode = SECURITY_DYNAMIC_TRACKING;
+    qos->EffectiveOnly = FALSE;
+
+    if (!conn || !conn->QOS)
+        return;
+
+    switch (conn->QOS->qos->ImpersonationType)
+    {
+        case RPC_C_IMP_LEVEL_ANONYMOUS:
+            qos->ImpersonationLevel = SecurityAnonymous;
+            break;
+        case RPC_C_IMP_LEVEL_IDENTIFY:
+            qos->ImpersonationLevel = SecurityIdentification;
+            break;
+        case RPC_C_IMP_LEVEL_IMPERSONATE:
+            qos->ImpersonationLevel = SecurityImpersonation;
+            break;
+        case RPC_C_IMP_LEVEL_DELEGATE:
+            qos->ImpersonationLevel = SecurityDelegation;
+            break;
+    }
+    if (conn->QOS->qos->IdentityTracking != RPC_C_QOS_IDENTITY_DYNAMIC)
+        qos->ContextTrackingMode = SECURITY_STATIC_TRACKING;
+}
+
+static void lrpc_init_message(LRPC_MESSAGE *msg, ULONG flags)
+{
+    memset(msg, 0, FIELD_OFFSET(LRPC_MESSAGE, Data));
+    msg->Header.u1.s1.DataLength = LRPC_HEADER_DATA_LENGTH;
+    msg->Header.u1.s1.TotalLength = FIELD_OFFSET(LRPC_MESSAGE, Data);
+    msg->Flags = flags;
+}
+
+static void lrpc_set_inline_length(LRPC_MESSAGE *msg, ULONG length)
+{
+    msg->Header.u1.s1.DataLength = (CSHORT)(LRPC_HEADER_DATA_LENGTH + length);
+    msg->Header.u1.s1.TotalLength = (CSHORT)(FIELD_OFFSET(LRPC_MESSAGE, Data) + length);
+}
+
+static RPC_STATUS lrpc_create_port(RpcConnection_lpc *conn)
+{
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name;
+    NTSTATUS status;
+    WCHAR *buffer;
+
+    TRACE("listening on %s\n", conn->common.Endpoint);
+
+    buffer = lrpc_port_name(conn->common.Endpoint, &name);
+    if (!buffer)
+        return RPC_S_OUT_OF_RESOURCES;
+
+    InitializeObjectAttributes(&attr, &name, OBJ_CASE_INSENSITIVE, NULL, NULL);
+    status = NtCreateWaitablePort(&conn->port, &attr, sizeof(LRPC_CONNECT_INFO),
+                                  sizeof(LRPC_MESSAGE), 0);
+    HeapFree(GetProcessHeap(), 0, buffer);
+    if (!NT_SUCCESS(status))
+    {
+        WARN("NtCreateWaitablePort failed with status %x\n", status);
+        conn->port = NULL;
+        if (status == STATUS_OBJECT_NAME_COLLISION)
+            return RPC_S_DUPLICATE_ENDPOINT;
+        return RPC_S_CANT_CREATE_ENDPOINT;
+    }
+
+    return RPC_S_OK;
+}
+
+static NTSTATUS lrpc_connect(const char *endpoint, const RpcConnection *conn,
+                             ULONG flags, HANDLE *port, PORT_VIEW *view)
+{
+    SECURITY_QUALITY_OF_SERVICE qos;
+    LRPC_CONNECT_INFO info;
+    ULONG info_length = sizeof(info);
+    UNICODE_STRING name;
+    NTSTATUS status;
+    WCHAR *buffer;
+
+    buffer = lrpc_port_name(endpoint, &name);
+    if (!buffer)
+        return STATUS_NO_MEMORY;
+
+    lrpc_get_qos(conn, &qos);
+    info.Version = LRPC_VERSION;
+    info.Flags = flags;
+
+    status = NtConnectPort(port, &name, &qos, view, NULL, NULL, &info, &info_length);
+    HeapFree(GetProcessHeap(), 0, buffer);
+    return status;
+}
+
+/* Makes the received message the one being read, FALSE if it has no data */
+static BOOL lrpc_accept_message(RpcConnection_lpc *conn)
+{
+    LRPC_MESSAGE *msg = &conn->recv;
+    ULONG data_length = (USHORT)msg->Header.u1.s1.DataLength;
+
+    if (data_length < LRPC_HEADER_DATA_LENGTH)
+    {
+        WARN("message too short, %u bytes\n", data_length);
+        return FALSE;
+    }
+
+    if (msg->Flags & LRPC_CLOSE)
+    {
+        TRACE("server closed connection %p\n", conn);
+        conn->disconnected = TRUE;
+        return FALSE;
+    }
+    if (msg->Flags & (LRPC_KEEPALIVE | LRPC_WAKEUP))
+        return FALSE;
+
+    if (msg->Flags & LRPC_VIEW_DATA)
+    {
+        if (!conn->view || !msg->Length || msg->Release > LRPC_RING_SIZE ||
+            msg->Length > msg->Release || msg->Offset > LRPC_RING_SIZE - msg->Length)
+        {
+            ERR("invalid view data %u/%u/%u\n", msg->Offset, msg->Length, msg->Release);
+            conn->disconnected = TRUE;
+            return FALSE;
+        }
+    }
+    else if (!msg->Length || msg->Length > data_length - LRPC_HEADER_DATA_LENGTH)
+    {
+        ERR("invalid inline data %u/%u\n", msg->Length, data_length);
+        conn->disconnected = TRUE;
+        return FALSE;
+    }
+
+    conn->recv_pos = 0;
+    conn->recv_valid = TRUE;
+    return TRUE;
+}
+
+static void lrpc_drop_queue(RpcConnection_lpc *conn)
+{
+    LRPC_QUEUED_MESSAGE *node, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE(node, next, &conn->queue, LRPC_QUEUED_MESSAGE, entry)
+    {
+        list_remove(&node->entry);
+        HeapFree(GetProcessHeap(), 0, node);
+    }
+    conn->queued = 0;
+}
+
+static void lrpc_release_message(RpcConnection_lpc *conn)
+{
+    if (conn->recv.Flags & LRPC_VIEW_DATA)
+        InterlockedExchangeAdd(&conn->view->Released[lrpc_read_ring(conn)], conn->recv.Release);
+    conn->recv_valid = FALSE;
+}
+
+static BOOL lrpc_send_keepalive(RpcConnection_lpc *conn)
+{
+    LRPC_MESSAGE msg;
+
+    lrpc_init_message(&msg, LRPC_KEEPALIVE);
+    return NT_SUCCESS(NtRequestPort(conn->port, &msg.Header));
+}
+
+static BOOL lrpc_server_receive(RpcConnection_lpc *conn)
+{
+    LRPC_QUEUED_MESSAGE *node;
+
+    for (;;)
+    {
+        node = NULL;
+        EnterCriticalSection(&conn->cs);
+        if (!list_empty(&conn->queue))
+        {
+            node = LIST_ENTRY(list_head(&conn->queue), LRPC_QUEUED_MESSAGE, entry);
+            list_remove(&node->entry);
+            conn->queued--;
+        }
+        LeaveCriticalSection(&conn->cs);
+
+        if (!node)
+        {
+            if (conn->read_closed || conn->disconnected || !conn->queue_event)
+                return FALSE;
+            WaitForSingleObject(conn->queue_event, INFINITE);
+            continue;
+        }
+
+        conn->recv = node->msg;
+        HeapFree(GetProcessHeap(), 0, node);
+
+        if (conn->recv.Header.u2.s2.Type == LPC_REQUEST)
+        {
+            EnterCriticalSection(&conn->cs);
+            conn->request = conn->recv.Header;
+            conn->request_pending = TRUE;
+            LeaveCriticalSection(&conn->cs);
+        }
+
+        if (lrpc_accept_message(conn))
+            return TRUE;
+    }
+}
+
+static BOOL lrpc_client_receive(RpcConnection_lpc *conn)
+{
+    LARGE_INTEGER timeout;
+    NTSTATUS status;
+
+    timeout.QuadPart = -10000LL * LRPC_KEEPALIVE_INTERVAL;
+
+    for (;;)
+    {
+        if (conn->read_closed || conn->disconnected)
+            return FALSE;
+        if (InterlockedExchange(&conn->cancelled, FALSE))
+            return FALSE;
+
+        status = NtReplyWaitReceivePortEx(conn->port, NULL, NULL, &conn->recv.Header, &timeout);
+        if (status == STATUS_TIMEOUT)
+        {
+            if (!lrpc_send_keepalive(conn))
+            {
+                TRACE("server of connection %p went away\n", conn);
+                conn->disconnected = TRUE;
+            }
+            continue;
+        }
+        if (!NT_SUCCESS(status))
+        {
+            WARN("NtReplyWaitReceivePortEx failed with status %x\n", status);
+            conn->disconnected = TRUE;
+            return FALSE;
+        }
+
+        switch (conn->recv.Header.u2.s2.Type)
+        {
+            case LPC_DATAGRAM:
+                if (lrpc_accept_message(conn))
+                    return TRUE;
+                break;
+
+            case LPC_PORT_CLOSED:
+            case LPC_CLIENT_DIED:
+                conn->disconnected = TRUE;
+                return FALSE;
+
+            default:
+                WARN("unexpected message type %d\n", conn->recv.Header.u2.s2.Type);
+                break;
+        }
+    }
+}
+
+static inline BOOL lrpc_receive(RpcConnection_lpc *conn)
+{
+    return conn->common.server ? lrpc_server_receive(conn) : lrpc_client_receive(conn);
+}
+
+/* Reserves ring space for the next part of a write, FALSE to send it inline.
+ * Sets full when the ring has no room for it yet. */
+static BOOL lrpc_reserve(RpcConnection_lpc *conn, ULONG remaining, LRPC_MESSAGE *msg, BOOL *full)
+{
+    ULONG used, avail, head, tail_room;
+
+    *full = FALSE;
+    if (!conn->view || remaining <= LRPC_MAX_INLINE_DATA)
+        return FALSE;
+
+    used = conn->produced - *(volatile ULONG *)&conn->view->Released[lrpc_write_ring(conn)];
+    if (used > LRPC_RING_SIZE)
+        return FALSE;
+
+    avail = LRPC_RING_SIZE - used;
+    head = conn->produced & (LRPC_RING_SIZE - 1);
+    tail_room = LRPC_RING_SIZE - head;
+
+    if (remaining > tail_room && (tail_room <= LRPC_MAX_INLINE_DATA || tail_room + remaining <= avail))
+    {
+        /* skip the end of the ring to keep the data in one piece */
+        msg->Offset = 0;
+        msg->Length = min(remaining, avail - min(avail, tail_room));
+        msg->Release = tail_room + msg->Length;
+    }
+    else
+    {
+        msg->Offset = head;
+        msg->Length = min(remaining, min(tail_room, avail));
+        msg->Release = msg->Length;
+    }
+
+    if (msg->Length <= LRPC_MAX_INLINE_DATA)
+    {
+        *full = TRUE;
+        return FALSE;
+    }
+
+    conn->produced += msg->Release;
+    return TRUE;
+}
+
+/* Waits for the server to read some of our ring, FALSE if it went away */
+static BOOL lrpc_wait_ring(RpcConnection_lpc *conn)
+{
+    LONG released = conn->view->Released[lrpc_write_ring(conn)];
+    DWORD start = GetTickCount();
+
+    while (*(volatile LONG *)&conn->view->Released[lrpc_write_ring(conn)] == released)
+    {
+        if (conn->disconnected)
+            return FALSE;
+
+        if (GetTickCount() - start >= LRPC_KEEPALIVE_INTERVAL)
+        {
+            if (!lrpc_send_keepalive(conn))
+            {
+                TRACE("server of connection %p went away\n", conn);
+                conn->disconnected = TRUE;
+                return FALSE;
+            }
+            start = GetTickCount();
+        }
+        Sleep(1);
+    }
+    return TRUE;
+}
+
+static NTSTATUS lrpc_send(RpcConnection_lpc *conn, LRPC_MESSAGE *msg, BOOL wait_reply)
+{
+    NTSTATUS status;
+    BOOL reply = FALSE;
+
+    if (conn->common.server)
+    {
+        EnterCriticalSection(&conn->cs);
+        if (conn->request_pending)
+        {
+            msg->Header.ClientId = conn->request.ClientId;
+            msg->Header.MessageId = conn->request.MessageId;
+            msg->Header.CallbackId = conn->request.CallbackId;
+            conn->request_pending = FALSE;
+            reply = TRUE;
+        }
+        LeaveCriticalSection(&conn->cs);
+
+        if (reply)
+            return NtReplyPort(conn->port, &msg->Header);
+    }
+    else if (wait_reply)
+    {
+        status = NtRequestWaitReplyPort(conn->port, &msg->Header, &conn->recv.Header);
+        if (NT_SUCCESS(status))
+            lrpc_accept_message(conn);
+        return status;
+    }
+
+    return NtRequestPort(conn->port, &msg->Header);
+}
+
+RpcConnection *rpcrt4_conn_lpc_alloc(void)
+{
+    RpcConnection_lpc *lpc = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(RpcConnection_lpc));
+    if (!lpc)
+        return NULL;
+
+    InitializeCriticalSection(&lpc->write_cs);
+    InitializeCriticalSection(&lpc->cs);
+    list_init(&lpc->queue);
+    return &lpc->common;
+}
+
+RPC_STATUS rpcrt4_ncalrpc_lpc_open(RpcConnection *Connection)
+{
+    RpcConnection_lpc *lpc = (RpcConnection_lpc *)Connection;
+    LARGE_INTEGER size;
+    HANDLE section;
+    PORT_VIEW view;
+    NTSTATUS status;
+
+    /* already connected? */
+    if (lpc->port)
+        return RPC_S_OK;
+
+    TRACE("connecting to %s\n", Connection->Endpoint);
+
+    /* without a view, large writes would flood the server with messages */
+    size.QuadPart = sizeof(LRPC_VIEW);
+    status = NtCreateSection(&section, SECTION_ALL_ACCESS, NULL, &size,
+                             PAGE_READWRITE, SEC_COMMIT, NULL);
+    if (!NT_SUCCESS(status))
+    {
+        WARN("NtCreateSection failed with status %x\n", status);
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    memset(&view, 0, sizeof(view));
+    view.Length = sizeof(view);
+    view.SectionHandle = section;
+    view.ViewSize = sizeof(LRPC_VIEW);
+
+    status = lrpc_connect(Connection->Endpoint, Connection, 0, &lpc->port, &view);
+    NtClose(section);
+    if (!NT_SUCCESS(status))
+    {
+        WARN("connection failed with status %x\n", status);
+        lpc->port = NULL;
+        if (status == STATUS_PORT_CONNECTION_REFUSED)
+            return RPC_S_SERVER_TOO_BUSY;
+        return RPC_S_SERVER_UNAVAILABLE;
+    }
+
+    if (view.ViewSize < sizeof(LRPC_VIEW))
+    {
+        WARN("view too small\n");
+        NtClose(lpc->port);
+        lpc->port = NULL;
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+    lpc->view = view.ViewBase;
+
+    return RPC_S_OK;
+}
+
+RPC_STATUS rpcrt4_ncalrpc_lpc_handoff(RpcConnection *old_conn, RpcConnection *new_conn)
+{
+    RpcConnection_lpc *lpc = (RpcConnection_lpc *)new_conn;
+    DWORD len = MAX_COMPUTERNAME_LENGTH + 1;
+
+    TRACE("%s\n", old_conn->Endpoint);
+
+    /* the communication port is set once the connection is accepted,
+     * the listener keeps its port */
+    lpc->queue_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!lpc->queue_event)
+        return RPC_S_OUT_OF_RESOURCES;
+
+    /* Store the local computer name as the NetworkAddr for ncalrpc. */
+    new_conn->NetworkAddr = HeapAlloc(GetProcessHeap(), 0, len);
+    if (!GetComputerNameA(new_conn->NetworkAddr, &len))
+    {
+        ERR("Failed to retrieve the computer name, error %u\n", GetLastError());
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    return RPC_S_OK;
+}
+
+int rpcrt4_conn_lpc_read(RpcConnection *conn, void *buffer, unsigned int count)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+    LRPC_MESSAGE *msg = &connection->recv;
+    unsigned int done = 0, length;
+    const UCHAR *data;
+
+    while (done < count)
+    {
+        if (!connection->recv_valid && !lrpc_receive(connection))
+            return -1;
+
+        if (msg->Flags & LRPC_VIEW_DATA)
+            data = connection->view->Ring[lrpc_read_ring(connection)] + msg->Offset;
+        else
+            data = msg->Data;
+
+        length = min(count - done, msg->Length - connection->recv_pos);
+        memcpy((char *)buffer + done, data + connection->recv_pos, length);
+        connection->recv_pos += length;
+        done += length;
+
+        if (connection->recv_pos == msg->Length)
+            lrpc_release_message(connection);
+    }
+
+    return done;
+}
+
+int rpcrt4_conn_lpc_write(RpcConnection *conn, const void *buffer, unsigned int count)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+    const RpcPktCommonHdr *hdr = buffer;
+    const char *data = buffer;
+    unsigned int written = 0;
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOL wait_reply = FALSE, full;
+    LRPC_MESSAGE msg;
+
+    /* the answer to a synchronous call comes back as the reply to its last message */
+    if (!conn->server && !conn->async_state && count >= sizeof(*hdr))
+    {
+        wait_reply = hdr->ptype == PKT_BIND || hdr->ptype == PKT_ALTER_CONTEXT ||
+                     (hdr->ptype == PKT_REQUEST && (hdr->flags & RPC_FLG_LAST));
+    }
+
+    EnterCriticalSection(&connection->write_cs);
+    while (written < count)
+    {
+        lrpc_init_message(&msg, 0);
+        if (lrpc_reserve(connection, count - written, &msg, &full))
+        {
+            memcpy(connection->view->Ring[lrpc_write_ring(connection)] + msg.Offset,
+                   data + written, msg.Length);
+            msg.Flags = LRPC_VIEW_DATA;
+        }
+        else if (full && !conn->server)
+        {
+            /* the server queues what it did not read yet, do not flood it */
+            if (!lrpc_wait_ring(connection))
+            {
+                status = STATUS_PORT_DISCONNECTED;
+                break;
+            }
+            continue;
+        }
+        else
+        {
+            msg.Length = min(count - written, LRPC_MAX_INLINE_DATA);
+            memcpy(msg.Data, data + written, msg.Length);
+            lrpc_set_inline_length(&msg, msg.Length);
+        }
+        written += msg.Length;
+
+        status = lrpc_send(connection, &msg, wait_reply && written == count);
+        if (!NT_SUCCESS(status))
+            break;
+    }
+    LeaveCriticalSection(&connection->write_cs);
+
+    if (!NT_SUCCESS(status))
+    {
+        WARN("send failed with status %x\n", status);
+        connection->disconnected = TRUE;
+        return -1;
+    }
+
+    return count;
+}
+
+int rpcrt4_conn_lpc_close(RpcConnection *conn)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+    LRPC_MESSAGE msg;
+
+    if (connection->port)
+    {
+        /* closing a communication port does not wake up a client waiting
+         * for data, so tell it first */
+        if (conn->server && !connection->listener && !connection->disconnected)
+        {
+            lrpc_init_message(&msg, LRPC_CLOSE);
+            NtRequestPort(connection->port, &msg.Header);
+        }
+        NtClose(connection->port);
+        connection->port = NULL;
+    }
+    /* the view is unmapped with the port */
+    connection->view = NULL;
+
+    lrpc_drop_queue(connection);
+    if (connection->queue_event)
+    {
+        CloseHandle(connection->queue_event);
+        connection->queue_event = NULL;
+    }
+
+    /* listeners are closed whenever the server stops listening and reused,
+     * they gave up their critical sections when they became listeners */
+    if (!connection->listener)
+    {
+        DeleteCriticalSection(&connection->write_cs);
+        DeleteCriticalSection(&connection->cs);
+    }
+    return 0;
+}
+
+void rpcrt4_conn_lpc_close_read(RpcConnection *conn)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+
+    connection->read_closed = TRUE;
+    if (connection->queue_event)
+        SetEvent(connection->queue_event);
+}
+
+void rpcrt4_conn_lpc_cancel_call(RpcConnection *conn)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+    LRPC_MESSAGE msg;
+
+    InterlockedExchange(&connection->cancelled, TRUE);
+
+    /* nothing else wakes up a client waiting on its port, have the server
+     * send a message back. If it is gone, the next keepalive notices it. */
+    if (!conn->server && connection->port)
+    {
+        lrpc_init_message(&msg, LRPC_WAKEUP);
+        NtRequestPort(connection->port, &msg.Header);
+    }
+}
+
+RPC_STATUS rpcrt4_ncalrpc_lpc_is_server_listening(const char *endpoint)
+{
+    NTSTATUS status;
+    HANDLE port;
+
+    /* a listening server refuses probes, the port only exists while listening */
+    status = lrpc_connect(endpoint, NULL, LRPC_CONNECT_PROBE, &port, NULL);
+    if (NT_SUCCESS(status))
+    {
+        NtClose(port);
+        return RPC_S_OK;
+    }
+    return status == STATUS_PORT_CONNECTION_REFUSED ? RPC_S_OK : RPC_S_NOT_LISTENING;
+}
+
+int rpcrt4_conn_lpc_wait_for_incoming_data(RpcConnection *conn)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+
+    if (!connection->recv_valid && !lrpc_receive(connection))
+        return -1;
+    return 0;
+}
+
+RPC_STATUS rpcrt4_conn_lpc_impersonate_client(RpcConnection *conn)
+{
+    RpcConnection_lpc *connection = (RpcConnection_lpc *)conn;
+    PORT_MESSAGE request;
+    BOOL pending;
+    NTSTATUS status;
+
+    TRACE("(%p)\n", conn);
+
+    if (conn->AuthInfo && SecIsValidHandle(&conn->ctx))
+        return RPCRT4_default_impersonate_client(conn);
+
+    EnterCriticalSection(&connection->cs);
+    pending = connection->request_pending;
+    request = connection->request;
+    LeaveCriticalSection(&connection->cs);
+
+    /* only a client waiting for our reply can be impersonated */
+    if (!pending)
+    {
+        WARN("no request to impersonate\n");
+        return RPC_S_NO_CONTEXT_AVAILABLE;
+    }
+
+    status = NtImpersonateClientOfPort(connection->port, &request);
+    if (!NT_SUCCESS(status))
+    {
+        WARN("NtImpersonateClientOfPort failed with status %x\n", status);
+        return RPC_S_NO_CONTEXT_AVAILABLE;
+    }
+    return RPC_S_OK;
+}
+
+RPC_STATUS rpcrt4_conn_lpc_revert_to_self(RpcConnection *conn)
+{
+    BOOL ret;
+
+    TRACE("(%p)\n", conn);
+
+    if (conn->AuthInfo && SecIsValidHandle(&conn->ctx))
+        return RPCRT4_default_revert_to_self(conn);
+
+    ret = RevertToSelf();
+    if (!ret)
+    {
+        WARN("RevertToSelf failed with error %u\n", GetLastError());
+        return RPC_S_NO_CONTEXT_AVAILABLE;
+    }
+    return RPC_S_OK;
+}
+
+RpcServerProtseq *rpcrt4_protseq_lpc_alloc(void)
+{
+    RpcServerProtseq_lpc *ps = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*ps));
+    if (ps)
+        ps->mgr_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    return &ps->common;
+}
+
+void rpcrt4_protseq_lpc_signal_state_changed(RpcServerProtseq *protseq)
+{
+    RpcServerProtseq_lpc *lpcps = CONTAINING_RECORD(protseq, RpcServerProtseq_lpc, common);
+    SetEvent(lpcps->mgr_event);
+}
+
+void *rpcrt4_protseq_lpc_get_wait_array(RpcServerProtseq *protseq, void *prev_array, unsigned int *count)
+{
+    HANDLE *objs = prev_array;
+    RpcConnection_lpc *conn;
+    RpcServerProtseq_lpc *lpcps = CONTAINING_RECORD(protseq, RpcServerProtseq_lpc, common);
+
+    EnterCriticalSection(&protseq->cs);
+
+    /* open and count ports */
+    *count = 1;
+    LIST_FOR_EACH_ENTRY(conn, &protseq->listeners, RpcConnection_lpc, common.protseq_entry)
+    {
+        if (!conn->port && lrpc_create_port(conn) != RPC_S_OK)
+            continue;
+        (*count)++;
+    }
+
+    /* make array of ports */
+    if (objs)
+        objs = HeapReAlloc(GetProcessHeap(), 0, objs, *count * sizeof(HANDLE));
+    else
+        objs = HeapAlloc(GetProcessHeap(), 0, *count * sizeof(HANDLE));
+    if (!objs)
+    {
+        ERR("couldn't allocate objs\n");
+        LeaveCriticalSection(&protseq->cs);
+        return NULL;
+    }
+
+    objs[0] = lpcps->mgr_event;
+    *count = 1;
+    LIST_FOR_EACH_ENTRY(conn, &protseq->listeners, RpcConnection_lpc, common.protseq_entry)
+    {
+        if (conn->port)
+            objs[(*count)++] = conn->port;
+    }
+    LeaveCriticalSection(&protseq->cs);
+    return objs;
+}
+
+void rpcrt4_protseq_lpc_free_wait_array(RpcServerProtseq *protseq, void *array)
+{
+    HeapFree(GetProcessHeap(), 0, array);
+}
+
+static void lrpc_accept_connection(RpcConnection_lpc *listener, LRPC_MESSAGE *msg)
+{
+    const LRPC_CONNECT_INFO *info = (const LRPC_CONNECT_INFO *)(&msg->Header + 1);
+    RpcConnection_lpc *conn = NULL;
+    REMOTE_PORT_VIEW view;
+    NTSTATUS status;
+    HANDLE port;
+
+    if ((USHORT)msg->Header.u1.s1.DataLength >= sizeof(*info) &&
+        info->Version == LRPC_VERSION && !(info->Flags & LRPC_CONNECT_PROBE))
+    {
+        conn = (RpcConnection_lpc *)rpcrt4_spawn_connection(&listener->common);
+    }
+
+    if (!conn || !conn->queue_event)
+    {
+        NtAcceptConnectPort(&port, NULL, &msg->Header, FALSE, NULL, NULL);
+        if (conn)
+            RPCRT4_ReleaseConnection(&conn->common);
+        return;
+    }
+
+    view.Length = sizeof(view);
+    view.ViewSize = 0;
+    view.ViewBase = NULL;
+    status = NtAcceptConnectPort(&conn->port, conn, &msg->Header, TRUE, NULL, &view);
+    if (!NT_SUCCESS(status))
+    {
+        ERR("NtAcceptConnectPort failed with status %x\n", status);
+        conn->port = NULL;
+        RPCRT4_ReleaseConnection(&conn->common);
+        return;
+    }
+
+    if (view.ViewSize >= sizeof(LRPC_VIEW))
+        conn->view = view.ViewBase;
+
+    status = NtCompleteConnectPort(conn->port);
+    if (!NT_SUCCESS(status))
+    {
+        ERR("NtCompleteConnectPort failed with status %x\n", status);
+        conn->disconnected = TRUE;
+        RPCRT4_ReleaseConnection(&conn->common);
+        return;
+    }
+
+    RPCRT4_new_client(&conn->common);
+}
+
+static void lrpc_route_message(RpcServerProtseq *protseq, void *context, const LRPC_MESSAGE *msg)
+{
+    RpcConnection_lpc *conn;
+    LRPC_QUEUED_MESSAGE *node;
+    LRPC_MESSAGE wakeup;
+    ULONG flags = 0;
+    BOOL closed;
+
+    closed = msg->Header.u2.s2.Type == LPC_PORT_CLOSED ||
+             msg->Header.u2.s2.Type == LPC_CLIENT_DIED;
+    if (!closed && (USHORT)msg->Header.u1.s1.DataLength >= LRPC_HEADER_DATA_LENGTH)
+        flags = msg->Flags;
+
+    /* keepalives only need to reach the port */
+    if (flags & LRPC_KEEPALIVE)
+        return;
+
+    /* the context is only valid while the connection is in the list */
+    EnterCriticalSection(&protseq->cs);
+    LIST_FOR_EACH_ENTRY(conn, &protseq->connections, RpcConnection_lpc, common.protseq_entry)
+    {
+        if (&conn->common != context)
+            continue;
+
+        if (closed)
+        {
+            conn->disconnected = TRUE;
+        }
+        else if (flags & LRPC_WAKEUP)
+        {
+            /* the client cancelled a call and waits for this on its port */
+            lrpc_init_message(&wakeup, LRPC_WAKEUP);
+            NtRequestPort(conn->port, &wakeup.Header);
+            break;
+        }
+        else
+        {
+            node = HeapAlloc(GetProcessHeap(), 0, sizeof(*node));
+            if (node)
+                memcpy(&node->msg, msg, (USHORT)msg->Header.u1.s1.TotalLength);
+
+            EnterCriticalSection(&conn->cs);
+            if (conn->disconnected)
+            {
+                /* the reader stops at the first missing message */
+                HeapFree(GetProcessHeap(), 0, node);
+            }
+            else if (!node)
+            {
+                ERR("couldn't queue message for %p\n", conn);
+                conn->disconnected = TRUE;
+            }
+            else if (conn->queued >= LRPC_MAX_QUEUED)
+            {
+                /* the stream is broken without this message, drop the connection */
+                ERR("too many messages queued for %p, disconnecting\n", conn);
+                HeapFree(GetProcessHeap(), 0, node);
+                lrpc_drop_queue(conn);
+                conn->disconnected = TRUE;
+            }
+            else
+            {
+                list_add_tail(&conn->queue, &node->entry);
+                conn->queued++;
+            }
+            LeaveCriticalSection(&conn->cs);
+        }
+        SetEvent(conn->queue_event);
+        break;
+    }
+    LeaveCriticalSection(&protseq->cs);
+}
+
+int rpcrt4_protseq_lpc_wait_for_new_connection(RpcServerProtseq *protseq, unsigned int count, void *wait_array)
+{
+    HANDLE *objs = wait_array;
+    RpcConnection_lpc *conn, *listener = NULL;
+    LARGE_INTEGER timeout;
+    LRPC_MESSAGE msg;
+    NTSTATUS status;
+    void *context;
+    DWORD res;
+
+    if (!objs)
+        return -1;
+
+    res = WaitForMultipleObjects(count, objs, FALSE, INFINITE);
+    if (res == WAIT_OBJECT_0)
+        return 0;
+    else if (res == WAIT_FAILED)
+    {
+        ERR("wait failed with error %d\n", GetLastError());
+        return -1;
+    }
+
+    /* listeners are only closed by the server thread, which is us */
+    EnterCriticalSection(&protseq->cs);
+    LIST_FOR_EACH_ENTRY(conn, &protseq->listeners, RpcConnection_lpc, common.protseq_entry)
+    {
+        if (conn->port == objs[res - WAIT_OBJECT_0])
+        {
+            listener = conn;
+            break;
+        }
+    }
+    LeaveCriticalSection(&protseq->cs);
+    if (!listener)
+    {
+        ERR("failed to locate connection for handle %p\n", objs[res - WAIT_OBJECT_0]);
+        return -1;
+    }
+
+    /* drain the port, the wait is satisfied until its queue is empty */
+    timeout.QuadPart = 0;
+    for (;;)
+    {
+        status = NtReplyWaitReceivePortEx(listener->port, &context, NULL, &msg.Header, &timeout);
+        if (status != STATUS_SUCCESS)
+            break;
+
+        switch (msg.Header.u2.s2.Type)
+        {
+            case LPC_CONNECTION_REQUEST:
+                lrpc_accept_connection(listener, &msg);
+                break;
+
+            case LPC_REQUEST:
+            case LPC_DATAGRAM:
+            case LPC_PORT_CLOSED:
+            case LPC_CLIENT_DIED:
+                lrpc_route_message(protseq, context, &msg);
+                break;
+
+            default:
+                WARN("unexpected message type %d\n", msg.Header.u2.s2.Type);
+                break;
+        }
+    }
+
+    return 1;
+}
+
+RPC_STATUS rpcrt4_protseq_ncalrpc_lpc_open_endpoint(RpcServerProtseq *protseq, const char *endpoint)
+{
+    RPC_STATUS r;
+    RpcConnection *Connection;
+    RpcConnection_lpc *lpc;
+    char generated_endpoint[22];
+
+    if (!endpoint)
+    {
+        static LONG lrpc_nameless_id;
+        DWORD process_id = GetCurrentProcessId();
+        ULONG id = InterlockedIncrement(&lrpc_nameless_id);
+        snprintf(generated_endpoint, sizeof(generated_endpoint),
+                 "LRPC%08x.%08x", process_id, id);
+        endpoint = generated_endpoint;
+    }
+
+    r = RPCRT4_CreateConnection(&Connection, TRUE, protseq->Protseq, NULL,
+                                endpoint, NULL, NULL, NULL, NULL);
+    if (r != RPC_S_OK)
+        return r;
+
+    /* listeners neither read nor write, and are never freed */
+    lpc = (RpcConnection_lpc *)Connection;
+    lpc->listener = TRUE;
+    DeleteCriticalSection(&lpc->write_cs);
+    DeleteCriticalSection(&lpc->cs);
+    r = lrpc_create_port(lpc);
+
+    /* clients connecting before the server listens would wait for it, make
+     * them fail instead. The server thread creates the port again. */
+    if (r == RPC_S_OK && !protseq->server_thread)
+    {
+        NtClose(lpc->port);
+        lpc->port = NULL;
+    }
+
+    EnterCriticalSection(&protseq->cs);
+    list_add_head(&protseq->listeners, &Connection->protseq_entry);
+    Connection->protseq = protseq;
+    LeaveCriticalSection(&protseq->cs);
+
+    return r;
+}
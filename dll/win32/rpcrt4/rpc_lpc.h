@@ -0,0 +1,33 @@
+/*
+ * PROJECT:     ReactOS RPC runtime
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     ncalrpc transport over LPC ports
+ */
+
+#ifndef __WINE_RPC_LPC_H
+#define __WINE_RPC_LPC_H
+
+#include "rpc_binding.h"
+#include "rpc_server.h"
+
+RpcConnection *rpcrt4_conn_lpc_alloc(void) DECLSPEC_HIDDEN;
+RPC_STATUS rpcrt4_ncalrpc_lpc_open(RpcConnection *conn) DECLSPEC_HIDDEN;
+RPC_STATUS rpcrt4_ncalrpc_lpc_handoff(RpcConnection *old_conn, RpcConnection *new_conn) DECLSPEC_HIDDEN;
+int rpcrt4_conn_lpc_read(RpcConnection *conn, void *buffer, unsigned int count) DECLSPEC_HIDDEN;
+int rpcrt4_conn_lpc_write(RpcConnection *conn, const void *buffer, unsigned int count) DECLSPEC_HIDDEN;
+int rpcrt4_conn_lpc_close(RpcConnection *conn) DECLSPEC_HIDDEN;
+void rpcrt4_conn_lpc_close_read(RpcConnection *conn) DECLSPEC_HIDDEN;
+void rpcrt4_conn_lpc_cancel_call(RpcConnection *conn) DECLSPEC_HIDDEN;
+RPC_STATUS rpcrt4_ncalrpc_lpc_is_server_listening(const char *endpoint) DECLSPEC_HIDDEN;
+int rpcrt4_conn_lpc_wait_for_incoming_data(RpcConnection *conn) DECLSPEC_HIDDEN;
+RPC_STATUS rpcrt4_conn_lpc_impersonate_client(RpcConnection *conn) DECLSPEC_HIDDEN;
+RPC_STATUS rpcrt4_conn_lpc_revert_to_self(RpcConnection *conn) DECLSPEC_HIDDEN;
+
+RpcServerProtseq *rpcrt4_protseq_lpc_alloc(void) DECLSPEC_HIDDEN;
+void rpcrt4_protseq_lpc_signal_state_changed(RpcServerProtseq *protseq) DECLSPEC_HIDDEN;
+void *rpcrt4_protseq_lpc_get_wait_array(RpcServerProtseq *protseq, void *prev_array, unsigned int *count) DECLSPEC_HIDDEN;
+void rpcrt4_protseq_lpc_free_wait_array(RpcServerProtseq *protseq, void *array) DECLSPEC_HIDDEN;
+int rpcrt4_protseq_lpc_wait_for_new_connection(RpcServerProtseq *protseq, unsigned int count, void *wait_array) DECLSPEC_HIDDEN;
+RPC_STATUS rpcrt4_protseq_ncalrpc_lpc_open_endpoint(RpcServerProtseq *protseq, const char *endpoint) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_RPC_LPC_H */
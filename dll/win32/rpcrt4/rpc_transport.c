@@ -53,6 +53,9 @@
 #include "rpc_message.h"
 #include "rpc_server.h"
 #include "epm_towers.h"
+#ifdef __REACTOS__
+#include "rpc_lpc.h"
+#endif
 
 #define DEFAULT_NCACN_HTTP_TIMEOUT (60 * 1000)
 
@@ -73,8 +76,6 @@ BOOL WINAPI CancelIoEx(HANDLE handle, LPOVERLAPPED lpOverlapped)
 }
 #endif
 
-static RpcConnection *rpcrt4_spawn_connection(RpcConnection *old_connection);
-
 /**** ncacn_np support ****/
 
 typedef struct _RpcConnection_np
@@ -196,6 +197,7 @@ static RPC_STATUS rpcrt4_conn_open_pipe(RpcConnection *Connection, LPCSTR pname,
   return RPC_S_OK;
 }
 
+#ifndef __REACTOS__ /* ncalrpc uses LPC ports, see rpc_lpc.c */
 static char *ncalrpc_pipe_name(const char *endpoint)
 {
   static const char prefix[] = "\\\\.\\pipe\\lrpc\\";
@@ -256,6 +258,7 @@ static RPC_STATUS rpcrt4_protseq_ncalrpc_open_endpoint(RpcServerProtseq* protseq
 
   return r;
 }
+#endif
 
 #ifdef __REACTOS__
 static char *ncacn_pipe_name(const char *server, const char *endpoint)
@@ -414,6 +417,7 @@ static RPC_STATUS rpcrt4_ncacn_np_is_server_listening(const char *endpoint)
   return status;
 }
 
+#ifndef __REACTOS__
 static RPC_STATUS rpcrt4_ncalrpc_np_is_server_listening(const char *endpoint)
 {
   char *pipe_name;
@@ -445,6 +449,7 @@ static RPC_STATUS rpcrt4_ncalrpc_handoff(RpcConnection *old_conn, RpcConnection
 
   return status;
 }
+#endif
 
 static int rpcrt4_conn_np_read(RpcConnection *conn, void *buffer, unsigned int count)
 {
@@ -3237,6 +3242,18 @@ static const struct connection_ops conn_protseq_list[] = {
   },
   { "ncalrpc",
     { EPM_PROTOCOL_NCALRPC, EPM_PROTOCOL_PIPE },
+#ifdef __REACTOS__
+    rpcrt4_conn_lpc_alloc,
+    rpcrt4_ncalrpc_lpc_open,
+    rpcrt4_ncalrpc_lpc_handoff,
+    rpcrt4_conn_lpc_read,
+    rpcrt4_conn_lpc_write,
+    rpcrt4_conn_lpc_close,
+    rpcrt4_conn_lpc_close_read,
+    rpcrt4_conn_lpc_cancel_call,
+    rpcrt4_ncalrpc_lpc_is_server_listening,
+    rpcrt4_conn_lpc_wait_for_incoming_data,
+#else
     rpcrt4_conn_np_alloc,
     rpcrt4_ncalrpc_open,
     rpcrt4_ncalrpc_handoff,
@@ -3247,14 +3264,20 @@ static const struct connection_ops conn_protseq_list[] = {
     rpcrt4_conn_np_cancel_call,
     rpcrt4_ncalrpc_np_is_server_listening,
     rpcrt4_conn_np_wait_for_incoming_data,
+#endif
     rpcrt4_ncalrpc_get_top_of_tower,
     rpcrt4_ncalrpc_parse_top_of_tower,
     NULL,
     rpcrt4_ncalrpc_is_authorized,
     rpcrt4_ncalrpc_authorize,
     rpcrt4_ncalrpc_secure_packet,
+#ifdef __REACTOS__
+    rpcrt4_conn_lpc_impersonate_client,
+    rpcrt4_conn_lpc_revert_to_self,
+#else
     rpcrt4_conn_np_impersonate_client,
     rpcrt4_conn_np_revert_to_self,
+#endif
     rpcrt4_ncalrpc_inquire_auth_client,
   },
   { "ncacn_ip_tcp",
@@ -3317,12 +3340,21 @@ static const struct protseq_ops protseq_list[] =
     },
     {
         "ncalrpc",
+#ifdef __REACTOS__
+        rpcrt4_protseq_lpc_alloc,
+        rpcrt4_protseq_lpc_signal_state_changed,
+        rpcrt4_protseq_lpc_get_wait_array,
+        rpcrt4_protseq_lpc_free_wait_array,
+        rpcrt4_protseq_lpc_wait_for_new_connection,
+        rpcrt4_protseq_ncalrpc_lpc_open_endpoint,
+#else
         rpcrt4_protseq_np_alloc,
         rpcrt4_protseq_np_signal_state_changed,
         rpcrt4_protseq_np_get_wait_array,
         rpcrt4_protseq_np_free_wait_array,
         rpcrt4_protseq_np_wait_for_new_connection,
         rpcrt4_protseq_ncalrpc_open_endpoint,
+#endif
     },
     {
         "ncacn_ip_tcp",
@@ -3417,7 +3449,7 @@ RPC_STATUS RPCRT4_CreateConnection(RpcConnection** Connection, BOOL server,
   return RPC_S_OK;
 }
 
-static RpcConnection *rpcrt4_spawn_connection(RpcConnection *old_connection)
+RpcConnection *rpcrt4_spawn_connection(RpcConnection *old_connection)
 {
     RpcConnection *connection;
     RPC_STATUS err;
@@ -33,6 +33,7 @@
 #include <wincrypt.h>
 
 #include "implglue.h"
+#include <cryptaccel.h>
 
 //#include <stdio.h>
 
@@ -378,6 +379,44 @@ BOOL encrypt_block_impl(ALG_ID aiAlgid, DWORD dwKeySpec, KEY_CONTEXT *pKeyContex
     return TRUE;
 }
 
+BOOL encrypt_blocks_impl(ALG_ID aiAlgid, KEY_CONTEXT *pKeyContext, DWORD dwMode, BYTE *pbChainVector,
+                         BYTE *pbInOut, DWORD dwBlocks, DWORD enc)
+{
+    aes_key *key = &pKeyContext->aes;
+
+    switch (aiAlgid) {
+        case CALG_AES:
+        case CALG_AES_128:
+        case CALG_AES_192:
+        case CALG_AES_256:
+            if (!(CryptAccelGetFeatures() & CRYPT_ACCEL_AES))
+                return FALSE;
+            break;
+
+        default:
+            return FALSE;
+    }
+
+    switch (dwMode) {
+        case CRYPT_MODE_ECB:
+            if (enc)
+                AesNiEncryptEcb(key->eK, key->Nr, pbInOut, pbInOut, dwBlocks);
+            else
+                AesNiDecryptEcb(key->dK, key->Nr, pbInOut, pbInOut, dwBlocks);
+            return TRUE;
+
+        case CRYPT_MODE_CBC:
+            if (enc)
+                AesNiEncryptCbc(key->eK, key->Nr, pbChainVector, pbInOut, pbInOut, dwBlocks);
+            else
+                AesNiDecryptCbc(key->dK, key->Nr, pbChainVector, pbInOut, pbInOut, dwBlocks);
+            return TRUE;
+
+        default:
+            return FALSE;
+    }
+}
+
 BOOL encrypt_stream_impl(ALG_ID aiAlgid, KEY_CONTEXT *pKeyContext, BYTE *stream, DWORD dwLen)
 {
     switch (aiAlgid) {
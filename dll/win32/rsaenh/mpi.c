@@ -98,6 +98,10 @@ static int s_mp_mul_high_digs(const mp_int *a, const mp_int *b, mp_int *c, int d
 static int s_mp_sqr(const mp_int *a, mp_int *b);
 static int s_mp_sub(const mp_int *a, const mp_int *b, mp_int *c);
 static int mp_exptmod_fast(const mp_int *G, const mp_int *X, mp_int *P, mp_int *Y, int mode);
+/* Fixed width limb Montgomery exponentiation, used up to the largest RSA
+ * modulus rsaenh generates */
+#define MONT_MAX_BITS 16384
+static int mp_exptmod_mont(const mp_int *G, const mp_int *X, mp_int *P, mp_int *Y);
 static int mp_invmod_slow (const mp_int * a, mp_int * b, mp_int * c);
 static int mp_karatsuba_mul(const mp_int *a, const mp_int *b, mp_int *c);
 static int mp_karatsuba_sqr(const mp_int *a, mp_int *b);
@@ -1957,6 +1961,9 @@ int mp_exptmod (const mp_int * G, const mp_int * X, mp_int * P, mp_int * Y)
 
   /* if the modulus is odd use the fast method */
   if (mp_isodd (P) == 1) {
+    if (mp_count_bits (P) <= MONT_MAX_BITS) {
+      return mp_exptmod_mont (G, X, P, Y);
+    }
     return mp_exptmod_fast (G, X, P, Y, dr);
   } else {
     /* otherwise use the generic Barrett reduction technique */
@@ -2224,6 +2231,321 @@ __M:
   return err;
 }
 
+/* Fixed width Montgomery exponentiation
+ *
+ * The mp_int code works on DIGIT_BIT wide digits and keeps the operands in
+ * growable arrays, which is a lot of overhead for the RSA private key
+ * operations.  The exponentiation for odd moduli is done here instead on
+ * full limbs: 64-bit ones where the compiler provides a 128-bit product,
+ * 32-bit ones with 64-bit products otherwise.
+ * The final subtraction of the Montgomery products is done without a branch.
+ */
+#if defined(__SIZEOF_INT128__)
+typedef ULONG64 mont_limb;
+typedef unsigned __int128 mont_dlimb;
+#define MONT_LIMB_BIT 64
+#else
+typedef ULONG mont_limb;
+typedef ULONG64 mont_dlimb;
+#define MONT_LIMB_BIT 32
+#endif
+
+/* The columns of the products are summed without carries, the low and the
+ * high limbs of the products apart: the column is lo + hi * 2**MONT_LIMB_BIT.
+ * lo += x * y */
+#define MONT_MULADD(x, y)                                          \
+  do {                                                             \
+    p   = (mont_dlimb)(x) * (y);                                   \
+    lo += (mont_limb)p;                                            \
+    hi += p >> MONT_LIMB_BIT;                                      \
+  } while (0)
+
+/* lo += 2 * p, p being a double limb product */
+#define MONT_ADD2(p)                                               \
+  do {                                                             \
+    lo += (mont_dlimb)(mont_limb)(p) << 1;                         \
+    hi += ((p) >> MONT_LIMB_BIT) << 1;                             \
+  } while (0)
+
+/* drops the low limb of the column, when moving on to the next one */
+#define MONT_NEXT_COLUMN()                                         \
+  do {                                                             \
+    hi += lo >> MONT_LIMB_BIT;                                     \
+    lo  = (mont_limb)hi;                                           \
+    hi  = hi >> MONT_LIMB_BIT;                                     \
+  } while (0)
+
+/* r = t[n..2n-1] + c * 2**(n * MONT_LIMB_BIT), less m if that is not negative */
+static void mont_final_sub(mont_limb *r, const mont_limb *t, mont_limb c,
+                           const mont_limb *m, int n)
+{
+  mont_dlimb acc;
+  mont_limb borrow, mask;
+  int j;
+
+  borrow = 0;
+  for (j = 0; j < n; j++) {
+    acc    = (mont_dlimb)t[n + j] - m[j] - borrow;
+    r[j]   = (mont_limb)acc;
+    borrow = (mont_limb)(acc >> MONT_LIMB_BIT) & 1;
+  }
+  mask = (mont_limb)0 - (mont_limb)(borrow > c);
+  for (j = 0; j < n; j++) {
+    r[j] = (r[j] & ~mask) | (t[n + j] & mask);
+  }
+}
+
+/* r = a * b / 2**(n * MONT_LIMB_BIT) mod m, t being 2n limbs of scratch
+ *
+ * Product scanning (Comba) form of the Montgomery multiplication: every
+ * column of a * b + q * m is summed in a three limb accumulator, the low
+ * half of the columns giving the quotient digits q[] and the high half the
+ * result.
+ */
+static void mont_mul(mont_limb *r, const mont_limb *a, const mont_limb *b,
+                     const mont_limb *m, mont_limb m0inv, int n, mont_limb *t)
+{
+  mont_dlimb lo, hi, p;
+  int i, j;
+
+  lo = hi = 0;
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < i; j++) {
+      MONT_MULADD(a[j], b[i - j]);
+      MONT_MULADD(t[j], m[i - j]);
+    }
+    MONT_MULADD(a[i], b[0]);
+    t[i] = (mont_limb)lo * m0inv;
+    MONT_MULADD(t[i], m[0]);
+    MONT_NEXT_COLUMN();
+  }
+  for (i = n; i < 2 * n; i++) {
+    for (j = i - n + 1; j < n; j++) {
+      MONT_MULADD(a[j], b[i - j]);
+      MONT_MULADD(t[j], m[i - j]);
+    }
+    t[i] = (mont_limb)lo;
+    MONT_NEXT_COLUMN();
+  }
+  mont_final_sub(r, t, (mont_limb)lo, m, n);
+}
+
+/* r = a * a / 2**(n * MONT_LIMB_BIT) mod m, computing each cross product once */
+static void mont_sqr(mont_limb *r, const mont_limb *a,
+                     const mont_limb *m, mont_limb m0inv, int n, mont_limb *t)
+{
+  mont_dlimb lo, hi, p;
+  int i, j;
+
+  lo = hi = 0;
+  for (i = 0; i < 2 * n; i++) {
+    for (j = (i < n) ? 0 : i - n + 1; j < i - j; j++) {
+      p = (mont_dlimb)a[j] * a[i - j];
+      MONT_ADD2(p);
+    }
+    if ((i & 1) == 0) {
+      MONT_MULADD(a[i / 2], a[i / 2]);
+    }
+    if (i < n) {
+      for (j = 0; j < i; j++) {
+        MONT_MULADD(t[j], m[i - j]);
+      }
+      t[i] = (mont_limb)lo * m0inv;
+      MONT_MULADD(t[i], m[0]);
+    } else {
+      for (j = i - n + 1; j < n; j++) {
+        MONT_MULADD(t[j], m[i - j]);
+      }
+      t[i] = (mont_limb)lo;
+    }
+    MONT_NEXT_COLUMN();
+  }
+  mont_final_sub(r, t, (mont_limb)lo, m, n);
+}
+
+/* packs the digits of 0 <= a < 2**(n * MONT_LIMB_BIT) into n limbs */
+static void mont_from_mp(mont_limb *r, int n, const mp_int *a)
+{
+  int i, bit, idx, shift;
+
+  for (i = 0; i < n; i++) {
+    r[i] = 0;
+  }
+  for (i = 0, bit = 0; i < a->used; i++, bit += DIGIT_BIT) {
+    idx   = bit / MONT_LIMB_BIT;
+    shift = bit % MONT_LIMB_BIT;
+    r[idx] |= (mont_limb)a->dp[i] << shift;
+    if (shift + DIGIT_BIT > MONT_LIMB_BIT && idx + 1 < n) {
+      r[idx + 1] |= (mont_limb)a->dp[i] >> (MONT_LIMB_BIT - shift);
+    }
+  }
+}
+
+/* unpacks n limbs into a */
+static int mont_to_mp(mp_int *a, const mont_limb *r, int n)
+{
+  int i, err, bit, idx, shift, digs;
+  mp_digit d;
+
+  digs = (n * MONT_LIMB_BIT + DIGIT_BIT - 1) / DIGIT_BIT;
+  if ((err = mp_grow(a, digs)) != MP_OKAY) {
+    return err;
+  }
+  for (i = 0, bit = 0; i < digs; i++, bit += DIGIT_BIT) {
+    idx   = bit / MONT_LIMB_BIT;
+    shift = bit % MONT_LIMB_BIT;
+    d = (mp_digit)(r[idx] >> shift);
+    if (shift + DIGIT_BIT > MONT_LIMB_BIT && idx + 1 < n) {
+      d |= (mp_digit)(r[idx + 1] << (MONT_LIMB_BIT - shift));
+    }
+    a->dp[i] = d & MP_MASK;
+  }
+  for (; i < a->alloc; i++) {
+    a->dp[i] = 0;
+  }
+  a->used = digs;
+  a->sign = MP_ZPOS;
+  mp_clamp(a);
+  return MP_OKAY;
+}
+
+/* computes Y == G**X mod P for odd P with the fixed width limbs above
+ *
+ * Same left-to-right sliding window as mp_exptmod_fast, but only the odd
+ * powers of G are kept in the table.
+ */
+static int mp_exptmod_mont(const mp_int *G, const mp_int *X, mp_int *P, mp_int *Y)
+{
+  mp_int     tmp;
+  mont_limb *mem, *m, *rr, *one, *res, *t, *tab;
+  mont_limb  inv;
+  SIZE_T     size;
+  int        err, n, i, j, l, k, val, winsize, started;
+
+  n = (mp_count_bits(P) + MONT_LIMB_BIT - 1) / MONT_LIMB_BIT;
+
+  /* same window sizes as mp_exptmod_fast, capped as only odd powers are kept */
+  i = mp_count_bits(X);
+  if (i <= 7) {
+    winsize = 2;
+  } else if (i <= 36) {
+    winsize = 3;
+  } else if (i <= 140) {
+    winsize = 4;
+  } else if (i <= 450) {
+    winsize = 5;
+  } else {
+    winsize = 6;
+  }
+
+  /* m, R**2, 1 and res take n limbs each, the scratch 2n and the table
+   * n per odd power */
+  size = sizeof(mont_limb) * n * (6 + (1 << (winsize - 1)));
+  mem  = HeapAlloc(GetProcessHeap(), 0, size);
+  if (mem == NULL) {
+    return MP_MEM;
+  }
+  m   = mem;
+  rr  = m + n;
+  one = rr + n;
+  res = one + n;
+  t   = res + n;
+  tab = t + 2 * n;
+
+  if ((err = mp_init(&tmp)) != MP_OKAY) {
+    goto __MEM;
+  }
+
+  mont_from_mp(m, n, P);
+
+  /* -1/m mod 2**MONT_LIMB_BIT, each Newton step doubling the correct bits */
+  inv = m[0];
+  for (i = 0; i < 5; i++) {
+    inv *= 2 - m[0] * inv;
+  }
+  inv = (mont_limb)0 - inv;
+
+  /* R**2 mod m, R being 2**(n * MONT_LIMB_BIT) */
+  if ((err = mp_2expt(&tmp, 2 * n * MONT_LIMB_BIT)) != MP_OKAY) {
+    goto __TMP;
+  }
+  if ((err = mp_mod(&tmp, P, &tmp)) != MP_OKAY) {
+    goto __TMP;
+  }
+  mont_from_mp(rr, n, &tmp);
+
+  for (i = 0; i < n; i++) {
+    one[i] = 0;
+  }
+  one[0] = 1;
+
+  /* tab[0] = G * R, tab[i] = G**(2i + 1) * R */
+  if (G->sign == MP_NEG || mp_cmp_mag(G, P) != MP_LT) {
+    if ((err = mp_mod(G, P, &tmp)) != MP_OKAY) {
+      goto __TMP;
+    }
+    mont_from_mp(res, n, &tmp);
+  } else {
+    mont_from_mp(res, n, G);
+  }
+  mont_mul(tab, res, rr, m, inv, n, t);
+  mont_sqr(res, tab, m, inv, n, t);
+  for (i = 1; i < (1 << (winsize - 1)); i++) {
+    mont_mul(tab + i * n, tab + (i - 1) * n, res, m, inv, n, t);
+  }
+
+  /* res = R, i.e. 1 in the Montgomery domain */
+  mont_mul(res, rr, one, m, inv, n, t);
+
+  started = 0;
+  for (i = mp_count_bits(X) - 1; i >= 0; ) {
+    if (((X->dp[i / DIGIT_BIT] >> (i % DIGIT_BIT)) & 1) == 0) {
+      mont_sqr(res, res, m, inv, n, t);
+      i--;
+      continue;
+    }
+
+    /* the longest window of at most winsize bits ending in a set bit */
+    l = i - winsize + 1;
+    if (l < 0) {
+      l = 0;
+    }
+    while (((X->dp[l / DIGIT_BIT] >> (l % DIGIT_BIT)) & 1) == 0) {
+      l++;
+    }
+    for (val = 0, j = i; j >= l; j--) {
+      val = (val << 1) | (int)((X->dp[j / DIGIT_BIT] >> (j % DIGIT_BIT)) & 1);
+    }
+
+    if (started) {
+      for (k = 0; k <= i - l; k++) {
+        mont_sqr(res, res, m, inv, n, t);
+      }
+      mont_mul(res, res, tab + (val >> 1) * n, m, inv, n, t);
+    } else {
+      for (k = 0; k < n; k++) {
+        res[k] = tab[(val >> 1) * n + k];
+      }
+      started = 1;
+    }
+    i = l - 1;
+  }
+
+  /* leave the Montgomery domain */
+  mont_mul(res, res, one, m, inv, n, t);
+
+  if ((err = mont_to_mp(Y, res, n)) != MP_OKAY) {
+    goto __TMP;
+  }
+  err = MP_OKAY;
+__TMP:
+  mp_clear(&tmp);
+__MEM:
+  SecureZeroMemory(mem, size);
+  HeapFree(GetProcessHeap(), 0, mem);
+  return err;
+}
+
 /* Greatest Common Divisor using the binary method */
 int mp_gcd (const mp_int * a, const mp_int * b, mp_int * c)
 {
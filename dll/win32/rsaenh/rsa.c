@@ -30,6 +30,9 @@
 
 #include "tomcrypt.h"
 
+/* random blinding values tried before giving up on a broken key */
+#define RSA_BLINDING_TRIES 16
+
 static const struct {
     int mpi_code, ltc_code;
 } mpi_to_ltc_codes[] = {
@@ -181,9 +184,10 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
                       unsigned char *out,  unsigned long *outlen, int which,
                       rsa_key *key)
 {
-   mp_int        tmp, tmpa, tmpb;
+   mp_int        tmp, tmpa, tmpb, rnd, rndi;
+   unsigned char buf[MAX_RSA_SIZE/8];
    unsigned long x;
-   int           err;
+   int           err, tries;
 
    /* is the key of the right type for the operation? */
    if (which == PK_PRIVATE && (key->type != PK_PRIVATE)) {
@@ -196,7 +200,7 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
    }
 
    /* init and copy into tmp */
-   if ((err = mp_init_multi(&tmp, &tmpa, &tmpb, NULL)) != MP_OKAY)    { return mpi_to_ltc_error(err); }
+   if ((err = mp_init_multi(&tmp, &tmpa, &tmpb, &rnd, &rndi, NULL)) != MP_OKAY) { return mpi_to_ltc_error(err); }
    if ((err = mp_read_unsigned_bin(&tmp, in, (int)inlen)) != MP_OKAY) { goto error; }
 
    /* sanity check on the input */
@@ -207,6 +211,30 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
 
    /* are we using the private exponent and is the key optimized? */
    if (which == PK_PRIVATE) {
+      /* blind the input with a random rnd that is invertible mod N, so the
+       * timing of the exponentiations below does not depend on it:
+       * tmp = tmp * rnd^e mod N, the result being multiplied by 1/rnd */
+      x = (unsigned long)mp_unsigned_bin_size(&key->N);
+      for (tries = 0; ; tries++) {
+         if (!gen_rand_impl(buf, x)) {
+            err = CRYPT_ERROR_READPRNG;
+            goto done;
+         }
+         if ((err = mp_read_unsigned_bin(&rnd, buf, (int)x)) != MP_OKAY)   { goto error; }
+         if ((err = mp_mod(&rnd, &key->N, &rnd)) != MP_OKAY)               { goto error; }
+
+         /* only a value sharing a factor with N has no inverse, which a
+          * real key makes next to impossible: don't try forever */
+         err = MP_VAL;
+         if (mp_cmp_d(&rnd, 1) == MP_GT) {
+            err = mp_invmod(&rnd, &key->N, &rndi);
+         }
+         if (err == MP_OKAY)                                               { break; }
+         if (err != MP_VAL || tries + 1 == RSA_BLINDING_TRIES)             { goto error; }
+      }
+      if ((err = mp_exptmod(&rnd, &key->e, &key->N, &rnd)) != MP_OKAY)     { goto error; }
+      if ((err = mp_mulmod(&tmp, &rnd, &key->N, &tmp)) != MP_OKAY)         { goto error; }
+
       /* tmpa = tmp^dP mod p */
       if ((err = mpi_to_ltc_error(mp_exptmod(&tmp, &key->dP, &key->p, &tmpa))) != MP_OKAY)    { goto error; }
       
@@ -220,6 +248,9 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
       /* tmp = tmpb + q * tmp */
       if ((err = mp_mul(&tmp, &key->q, &tmp)) != MP_OKAY)                   { goto error; }
       if ((err = mp_add(&tmp, &tmpb, &tmp)) != MP_OKAY)                     { goto error; }
+
+      /* unblind */
+      if ((err = mp_mulmod(&tmp, &rndi, &key->N, &tmp)) != MP_OKAY)         { goto error; }
    } else {
       /* exptmod it */
       if ((err = mp_exptmod(&tmp, &key->e, &key->N, &tmp)) != MP_OKAY) { goto error; }
@@ -243,6 +274,6 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
 error:
    err = mpi_to_ltc_error(err);
 done:
-   mp_clear_multi(&tmp, &tmpa, &tmpb, NULL);
+   mp_clear_multi(&tmp, &tmpa, &tmpb, &rnd, &rndi, NULL);
    return err;
 }
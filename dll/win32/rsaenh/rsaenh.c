@@ -2185,7 +2185,7 @@ BOOL WINAPI RSAENH_CPEncrypt(HCRYPTPROV hProv, HCRYPTKEY hKey, HCRYPTHASH hHash,
 {
     CRYPTKEY *pCryptKey;
     BYTE *in, out[RSAENH_MAX_BLOCK_SIZE], o[RSAENH_MAX_BLOCK_SIZE];
-    DWORD dwEncryptedLen, i, j, k;
+    DWORD dwEncryptedLen, dwDone, i, j, k;
         
     TRACE("(hProv=%08lx, hKey=%08lx, hHash=%08lx, Final=%d, dwFlags=%08x, pbData=%p, "
           "pdwDataLen=%p, dwBufLen=%d)\n", hProv, hKey, hHash, Final, dwFlags, pbData, pdwDataLen,
@@ -2244,7 +2244,14 @@ BOOL WINAPI RSAENH_CPEncrypt(HCRYPTPROV hProv, HCRYPTKEY hKey, HCRYPTHASH hHash,
         for (i=*pdwDataLen; i<dwEncryptedLen; i++) pbData[i] = dwEncryptedLen - *pdwDataLen;
         *pdwDataLen = dwEncryptedLen;
 
-        for (i=0, in=pbData; i<*pdwDataLen; i+=pCryptKey->dwBlockLen, in+=pCryptKey->dwBlockLen) {
+        /* Let the accelerated implementations take the whole blocks at once */
+        dwDone = *pdwDataLen - *pdwDataLen % pCryptKey->dwBlockLen;
+        if (!encrypt_blocks_impl(pCryptKey->aiAlgid, &pCryptKey->context, pCryptKey->dwMode,
+                                 pCryptKey->abChainVector, pbData,
+                                 dwDone / pCryptKey->dwBlockLen, RSAENH_ENCRYPT))
+            dwDone = 0;
+
+        for (i=dwDone, in=pbData+dwDone; i<*pdwDataLen; i+=pCryptKey->dwBlockLen, in+=pCryptKey->dwBlockLen) {
             switch (pCryptKey->dwMode) {
                 case CRYPT_MODE_ECB:
                     encrypt_block_impl(pCryptKey->aiAlgid, 0, &pCryptKey->context, in, out, 
@@ -2337,7 +2344,7 @@ BOOL WINAPI RSAENH_CPDecrypt(HCRYPTPROV hProv, HCRYPTKEY hKey, HCRYPTHASH hHash,
 {
     CRYPTKEY *pCryptKey;
     BYTE *in, out[RSAENH_MAX_BLOCK_SIZE], o[RSAENH_MAX_BLOCK_SIZE];
-    DWORD i, j, k;
+    DWORD dwDone, i, j, k;
     DWORD dwMax;
 
     TRACE("(hProv=%08lx, hKey=%08lx, hHash=%08lx, Final=%d, dwFlags=%08x, pbData=%p, "
@@ -2373,7 +2380,14 @@ BOOL WINAPI RSAENH_CPDecrypt(HCRYPTPROV hProv, HCRYPTKEY hKey, HCRYPTHASH hHash,
     dwMax=*pdwDataLen;
 
     if (GET_ALG_TYPE(pCryptKey->aiAlgid) == ALG_TYPE_BLOCK) {
-        for (i=0, in=pbData; i<*pdwDataLen; i+=pCryptKey->dwBlockLen, in+=pCryptKey->dwBlockLen) {
+        /* Let the accelerated implementations take the whole blocks at once */
+        dwDone = *pdwDataLen - *pdwDataLen % pCryptKey->dwBlockLen;
+        if (!encrypt_blocks_impl(pCryptKey->aiAlgid, &pCryptKey->context, pCryptKey->dwMode,
+                                 pCryptKey->abChainVector, pbData,
+                                 dwDone / pCryptKey->dwBlockLen, RSAENH_DECRYPT))
+            dwDone = 0;
+
+        for (i=dwDone, in=pbData+dwDone; i<*pdwDataLen; i+=pCryptKey->dwBlockLen, in+=pCryptKey->dwBlockLen) {
             switch (pCryptKey->dwMode) {
                 case CRYPT_MODE_ECB:
                     encrypt_block_impl(pCryptKey->aiAlgid, 0, &pCryptKey->context, in, out, 
@@ -35,6 +35,7 @@
 #include <string.h>
 #include <assert.h>
 #include "sha2.h"
+#include <cryptaccel.h>
 
 /*
  * ASSERT NOTE:
@@ -318,7 +319,7 @@ void SHA256_Init(SHA256_CTX* context) {
 	(h) = T1 + Sigma0_256(a) + Maj((a), (b), (c)); \
 	j++
 
-void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
+static void SHA256_Transform_C(SHA256_CTX* context, const sha2_word32* data) {
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
 	sha2_word32	T1, *W256;
 	int		j;
@@ -376,7 +377,7 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #else /* SHA2_UNROLL_TRANSFORM */
 
-void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
+static void SHA256_Transform_C(SHA256_CTX* context, const sha2_word32* data) {
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
 	sha2_word32	T1, T2, *W256;
 	int		j;
@@ -456,6 +457,14 @@ void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
+	if (CryptAccelGetFeatures() & CRYPT_ACCEL_SHA) {
+		ShaNiSha256Transform((ULONG*)context->state, (const sha2_byte*)data, 1);
+		return;
+	}
+	SHA256_Transform_C(context, data);
+}
+
 void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -488,6 +497,15 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
+	if (len >= SHA256_BLOCK_LENGTH && (CryptAccelGetFeatures() & CRYPT_ACCEL_SHA)) {
+		/* The SHA extensions take all the complete blocks at once */
+		size_t blocks = len / SHA256_BLOCK_LENGTH;
+
+		ShaNiSha256Transform((ULONG*)context->state, data, blocks);
+		context->bitcount += (sha2_word64)blocks * SHA256_BLOCK_LENGTH << 3;
+		len -= blocks * SHA256_BLOCK_LENGTH;
+		data += blocks * SHA256_BLOCK_LENGTH;
+	}
 	while (len >= SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
 		SHA256_Transform(context, (const sha2_word32*)data);
@@ -1352,6 +1352,95 @@ static HRESULT fill_array_desc(compile_ctx_t *ctx, dim_decl_t *dim_decl, array_d
     return S_OK;
 }
 
+static BOOL lookup_var_slot(function_t *func, const WCHAR *name, BOOL is_let, unsigned *ret)
+{
+    unsigned i;
+
+    /* Assigning to the function name sets its return value. */
+    if(is_let && (func->type == FUNC_FUNCTION || func->type == FUNC_PROPGET || func->type == FUNC_DEFGET)
+            && !wcsicmp(name, func->name))
+        return FALSE;
+
+    if(func->type == FUNC_GLOBAL) {
+        for(i=0; i < func->global_var_cnt; i++) {
+            if(!wcsicmp(func->global_var_names[i], name)) {
+                *ret = i;
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    for(i=0; i < func->var_cnt; i++) {
+        if(!wcsicmp(func->vars[i].name, name)) {
+            *ret = i;
+            return TRUE;
+        }
+    }
+
+    for(i=0; i < func->arg_cnt; i++) {
+        if(!wcsicmp(func->args[i].name, name)) {
+            *ret = func->var_cnt + i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*
+ * Binds the identifiers naming the function's own variables to slots, so that
+ * the interpreter doesn't have to look them up by name. Those are found first
+ * by lookup_identifier anyway: the locals and arguments of procedures, and the
+ * variables declared by the global code, which can't collide with the names
+ * of other scripts. The slots index the locals followed by the arguments, or
+ * global_var_names for the global code, whose variables the interpreter finds
+ * by name each time the code runs.
+ */
+static void bind_vars(compile_ctx_t *ctx, function_t *func)
+{
+    instr_t *instr;
+    unsigned slot;
+
+    for(instr = ctx->code->instrs+func->code_off; instr < ctx->code->instrs+ctx->instr_cnt; instr++) {
+        switch(instr->op) {
+        case OP_icall:
+            if(lookup_var_slot(func, instr->arg1.bstr, FALSE, &slot)) {
+                instr->op = OP_local;
+                instr->arg1.uint = slot;
+            }
+            break;
+        case OP_assign_ident:
+            if(lookup_var_slot(func, instr->arg1.bstr, TRUE, &slot)) {
+                instr->op = OP_assign_local;
+                instr->arg1.uint = slot;
+            }
+            break;
+        case OP_set_ident:
+            if(!instr->arg2.uint && lookup_var_slot(func, instr->arg1.bstr, TRUE, &slot)) {
+                instr->op = OP_set_local;
+                instr->arg1.uint = slot;
+            }
+            break;
+        case OP_incc:
+            if(lookup_var_slot(func, instr->arg1.bstr, TRUE, &slot)) {
+                instr->op = OP_incc_local;
+                instr->arg1.uint = slot;
+            }
+            break;
+        case OP_step:
+            if(lookup_var_slot(func, instr->arg2.bstr, FALSE, &slot)) {
+                instr->op = OP_step_local;
+                instr->arg2.uint = slot;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *func)
 {
     HRESULT hres;
@@ -1411,6 +1500,10 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
         if(func->type == FUNC_GLOBAL) {
             dynamic_var_t *new_var;
 
+            func->global_var_names = compiler_alloc(ctx->code, func->var_cnt * sizeof(*func->global_var_names));
+            if(!func->global_var_names)
+                return E_OUTOFMEMORY;
+
             func->var_cnt = 0;
 
             for(dim_decl = ctx->dim_decls; dim_decl; dim_decl = dim_decl->next) {
@@ -1427,6 +1520,7 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
 
                 new_var->next = ctx->global_vars;
                 ctx->global_vars = new_var;
+                func->global_var_names[func->global_var_cnt++] = new_var->name;
             }
         }else {
             unsigned i;
@@ -1464,6 +1558,7 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
         assert(array_id == func->array_cnt);
     }
 
+    bind_vars(ctx, func);
     return S_OK;
 }
 
@@ -1499,6 +1594,8 @@ static HRESULT create_function(compile_ctx_t *ctx, function_decl_t *decl, functi
 
     func->vars = NULL;
     func->var_cnt = 0;
+    func->global_var_names = NULL;
+    func->global_var_cnt = 0;
     func->array_cnt = 0;
     func->code_ctx = ctx->code;
     func->type = decl->type;
@@ -36,6 +36,7 @@ typedef struct {
 
     VARIANT *args;
     VARIANT *vars;
+    VARIANT **global_vars;
     SAFEARRAY **arrays;
 
     dynamic_var_t *dynamic_vars;
@@ -444,6 +445,55 @@ static HRESULT stack_assume_disp(exec_ctx_t *ctx, unsigned n, IDispatch **disp)
     return S_OK;
 }
 
+/*
+ * Most of the arithmetic in scripts is done on VT_I2 and VT_I4 values, so the
+ * operators handle them directly. The results have the types the Var* functions
+ * give them; on overflow the callers fall back to those functions.
+ */
+static inline BOOL get_int_val(const VARIANT *v, LONG *ret)
+{
+    switch(V_VT(v)) {
+    case VT_I2:
+        *ret = V_I2(v);
+        return TRUE;
+    case VT_I4:
+        *ret = V_I4(v);
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static BOOL set_int_result(const VARIANT *l, const VARIANT *r, LONGLONG val, VARIANT *ret)
+{
+    if(V_VT(l) == VT_I2 && V_VT(r) == VT_I2) {
+        if(val != (SHORT)val)
+            return FALSE;
+        V_VT(ret) = VT_I2;
+        V_I2(ret) = val;
+    }else {
+        if(val != (LONG)val)
+            return FALSE;
+        V_VT(ret) = VT_I4;
+        V_I4(ret) = val;
+    }
+    return TRUE;
+}
+
+static HRESULT var_cmp(exec_ctx_t *ctx, VARIANT *l, VARIANT *r)
+{
+    LONG li, ri;
+
+    TRACE("%s %s\n", debugstr_variant(l), debugstr_variant(r));
+
+    if(get_int_val(l, &li) && get_int_val(r, &ri))
+        return li < ri ? VARCMP_LT : li > ri ? VARCMP_GT : VARCMP_EQ;
+
+    /* FIXME: Fix comparing string to number */
+
+    return VarCmp(l, r, ctx->script->lcid, 0);
+}
+
 static inline void instr_jmp(exec_ctx_t *ctx, unsigned addr)
 {
     ctx->instr = ctx->code->instrs + addr;
@@ -515,6 +565,54 @@ static HRESULT array_access(exec_ctx_t *ctx, SAFEARRAY *array, DISPPARAMS *dp, V
     return hres;
 }
 
+static inline VARIANT *local_var(exec_ctx_t *ctx, unsigned slot)
+{
+    if(ctx->func->type == FUNC_GLOBAL)
+        return ctx->global_vars[slot];
+    return slot < ctx->func->var_cnt ? ctx->vars+slot : ctx->args+slot-ctx->func->var_cnt;
+}
+
+/* Returns a reference to the variable, or to its element or default value for calls with arguments */
+static HRESULT var_call(exec_ctx_t *ctx, VARIANT *var, unsigned arg_cnt, VARIANT *res)
+{
+    DISPPARAMS dp;
+    VARIANT *v;
+    HRESULT hres;
+
+    v = V_VT(var) == (VT_VARIANT|VT_BYREF) ? V_VARIANTREF(var) : var;
+
+    if(arg_cnt) {
+        SAFEARRAY *array = NULL;
+
+        switch(V_VT(v)) {
+        case VT_ARRAY|VT_BYREF|VT_VARIANT:
+            array = *V_ARRAYREF(var);
+            break;
+        case VT_ARRAY|VT_VARIANT:
+            array = V_ARRAY(var);
+            break;
+        case VT_DISPATCH:
+            vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
+            return disp_call(ctx->script, V_DISPATCH(v), DISPID_VALUE, &dp, res);
+        default:
+            FIXME("arguments not implemented\n");
+            return E_NOTIMPL;
+        }
+
+        if(!array)
+            return S_OK;
+
+        vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
+        hres = array_access(ctx, array, &dp, &v);
+        if(FAILED(hres))
+            return hres;
+    }
+
+    V_VT(res) = VT_BYREF|VT_VARIANT;
+    V_BYREF(res) = v;
+    return S_OK;
+}
+
 static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
 {
     BSTR identifier = ctx->instr->arg1.bstr;
@@ -529,50 +627,16 @@ static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
 
     switch(ref.type) {
     case REF_VAR:
-    case REF_CONST: {
-        VARIANT *v;
-
+    case REF_CONST:
         if(!res) {
             FIXME("REF_VAR no res\n");
             return E_NOTIMPL;
         }
 
-        v = V_VT(ref.u.v) == (VT_VARIANT|VT_BYREF) ? V_VARIANTREF(ref.u.v) : ref.u.v;
-
-        if(arg_cnt) {
-            SAFEARRAY *array = NULL;
-
-            switch(V_VT(v)) {
-            case VT_ARRAY|VT_BYREF|VT_VARIANT:
-                array = *V_ARRAYREF(ref.u.v);
-                break;
-            case VT_ARRAY|VT_VARIANT:
-                array = V_ARRAY(ref.u.v);
-                break;
-            case VT_DISPATCH:
-                vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
-                hres = disp_call(ctx->script, V_DISPATCH(v), DISPID_VALUE, &dp, res);
-                if(FAILED(hres))
-                    return hres;
-                break;
-            default:
-                FIXME("arguments not implemented\n");
-                return E_NOTIMPL;
-            }
-
-            if(!array)
-                break;
-
-            vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
-            hres = array_access(ctx, array, &dp, &v);
-            if(FAILED(hres))
-                return hres;
-        }
-
-        V_VT(res) = VT_BYREF|VT_VARIANT;
-        V_BYREF(res) = v;
+        hres = var_call(ctx, ref.u.v, arg_cnt, res);
+        if(FAILED(hres))
+            return hres;
         break;
-    }
     case REF_DISP:
         vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
         hres = disp_call(ctx->script, ref.u.d.disp, ref.u.d.id, &dp, res);
@@ -635,6 +699,23 @@ static HRESULT interp_icallv(exec_ctx_t *ctx)
     return do_icall(ctx, NULL);
 }
 
+static HRESULT interp_local(exec_ctx_t *ctx)
+{
+    const unsigned slot = ctx->instr->arg1.uint;
+    const unsigned arg_cnt = ctx->instr->arg2.uint;
+    VARIANT v;
+    HRESULT hres;
+
+    TRACE("%u %u\n", slot, arg_cnt);
+
+    hres = var_call(ctx, local_var(ctx, slot), arg_cnt, &v);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, arg_cnt);
+    return stack_push(ctx, &v);
+}
+
 static HRESULT do_mcall(exec_ctx_t *ctx, VARIANT *res)
 {
     const BSTR identifier = ctx->instr->arg1.bstr;
@@ -692,10 +773,16 @@ static HRESULT assign_value(exec_ctx_t *ctx, VARIANT *dst, VARIANT *src, WORD fl
     VARIANT value;
     HRESULT hres;
 
-    V_VT(&value) = VT_EMPTY;
-    hres = VariantCopyInd(&value, src);
-    if(FAILED(hres))
-        return hres;
+    if(V_ISBYREF(src)) {
+        V_VT(&value) = VT_EMPTY;
+        hres = VariantCopyInd(&value, src);
+        if(FAILED(hres))
+            return hres;
+    }else {
+        /* The source is a temporary owned by the caller, take it over instead of copying it. */
+        value = *src;
+        V_VT(src) = VT_EMPTY;
+    }
 
     if(V_VT(&value) == VT_DISPATCH && !(flags & DISPATCH_PROPERTYPUTREF)) {
         IDispatch *disp = V_DISPATCH(&value);
@@ -713,58 +800,62 @@ static HRESULT assign_value(exec_ctx_t *ctx, VARIANT *dst, VARIANT *src, WORD fl
     return S_OK;
 }
 
-static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, WORD flags, DISPPARAMS *dp)
+static HRESULT assign_var(exec_ctx_t *ctx, VARIANT *v, WORD flags, DISPPARAMS *dp)
 {
-    ref_t ref;
     HRESULT hres;
 
-    hres = lookup_identifier(ctx, name, VBDISP_LET, &ref);
-    if(FAILED(hres))
-        return hres;
+    if(V_VT(v) == (VT_VARIANT|VT_BYREF))
+        v = V_VARIANTREF(v);
 
-    switch(ref.type) {
-    case REF_VAR: {
-        VARIANT *v = ref.u.v;
+    if(arg_cnt(dp)) {
+        SAFEARRAY *array;
 
-        if(V_VT(v) == (VT_VARIANT|VT_BYREF))
-            v = V_VARIANTREF(v);
+        if(!(V_VT(v) & VT_ARRAY)) {
+            FIXME("array assign on type %d\n", V_VT(v));
+            return E_FAIL;
+        }
 
-        if(arg_cnt(dp)) {
-            SAFEARRAY *array;
+        switch(V_VT(v)) {
+        case VT_ARRAY|VT_BYREF|VT_VARIANT:
+            array = *V_ARRAYREF(v);
+            break;
+        case VT_ARRAY|VT_VARIANT:
+            array = V_ARRAY(v);
+            break;
+        default:
+            FIXME("Unsupported array type %x\n", V_VT(v));
+            return E_NOTIMPL;
+        }
 
-            if(!(V_VT(v) & VT_ARRAY)) {
-                FIXME("array assign on type %d\n", V_VT(v));
-                return E_FAIL;
-            }
+        if(!array) {
+            FIXME("null array\n");
+            return E_FAIL;
+        }
 
-            switch(V_VT(v)) {
-            case VT_ARRAY|VT_BYREF|VT_VARIANT:
-                array = *V_ARRAYREF(v);
-                break;
-            case VT_ARRAY|VT_VARIANT:
-                array = V_ARRAY(v);
-                break;
-            default:
-                FIXME("Unsupported array type %x\n", V_VT(v));
-                return E_NOTIMPL;
-            }
+        hres = array_access(ctx, array, dp, &v);
+        if(FAILED(hres))
+            return hres;
+    }else if(V_VT(v) == (VT_ARRAY|VT_BYREF|VT_VARIANT)) {
+        FIXME("non-array assign\n");
+        return E_NOTIMPL;
+    }
 
-            if(!array) {
-                FIXME("null array\n");
-                return E_FAIL;
-            }
+    return assign_value(ctx, v, dp->rgvarg, flags);
+}
 
-            hres = array_access(ctx, array, dp, &v);
-            if(FAILED(hres))
-                return hres;
-        }else if(V_VT(v) == (VT_ARRAY|VT_BYREF|VT_VARIANT)) {
-            FIXME("non-array assign\n");
-            return E_NOTIMPL;
-        }
+static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, WORD flags, DISPPARAMS *dp)
+{
+    ref_t ref;
+    HRESULT hres;
 
-        hres = assign_value(ctx, v, dp->rgvarg, flags);
+    hres = lookup_identifier(ctx, name, VBDISP_LET, &ref);
+    if(FAILED(hres))
+        return hres;
+
+    switch(ref.type) {
+    case REF_VAR:
+        hres = assign_var(ctx, ref.u.v, flags, dp);
         break;
-    }
     case REF_DISP:
         hres = disp_propput(ctx->script, ref.u.d.disp, ref.u.d.id, flags, dp);
         break;
@@ -844,6 +935,47 @@ static HRESULT interp_set_ident(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_assign_local(exec_ctx_t *ctx)
+{
+    const unsigned slot = ctx->instr->arg1.uint;
+    const unsigned arg_cnt = ctx->instr->arg2.uint;
+    DISPPARAMS dp;
+    HRESULT hres;
+
+    TRACE("%u\n", slot);
+
+    vbstack_to_dp(ctx, arg_cnt, TRUE, &dp);
+    hres = assign_var(ctx, local_var(ctx, slot), DISPATCH_PROPERTYPUT, &dp);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, arg_cnt+1);
+    return S_OK;
+}
+
+static HRESULT interp_set_local(exec_ctx_t *ctx)
+{
+    const unsigned slot = ctx->instr->arg1.uint;
+    DISPPARAMS dp;
+    HRESULT hres;
+
+    TRACE("%u\n", slot);
+
+    assert(!ctx->instr->arg2.uint);
+
+    hres = stack_assume_disp(ctx, 0, NULL);
+    if(FAILED(hres))
+        return hres;
+
+    vbstack_to_dp(ctx, 0, TRUE, &dp);
+    hres = assign_var(ctx, local_var(ctx, slot), DISPATCH_PROPERTYPUTREF, &dp);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, 1);
+    return S_OK;
+}
+
 static HRESULT interp_assign_member(exec_ctx_t *ctx)
 {
     BSTR identifier = ctx->instr->arg1.bstr;
@@ -1065,34 +1197,21 @@ static HRESULT interp_dim(exec_ctx_t *ctx)
     return S_OK;
 }
 
-static HRESULT interp_step(exec_ctx_t *ctx)
+static HRESULT do_step(exec_ctx_t *ctx, VARIANT *var)
 {
-    const BSTR ident = ctx->instr->arg2.bstr;
     BOOL gteq_zero;
     VARIANT zero;
-    ref_t ref;
     HRESULT hres;
 
-    TRACE("%s\n", debugstr_w(ident));
-
     V_VT(&zero) = VT_I2;
     V_I2(&zero) = 0;
-    hres = VarCmp(stack_top(ctx, 0), &zero, ctx->script->lcid, 0);
+    hres = var_cmp(ctx, stack_top(ctx, 0), &zero);
     if(FAILED(hres))
         return hres;
 
     gteq_zero = hres == VARCMP_GT || hres == VARCMP_EQ;
 
-    hres = lookup_identifier(ctx, ident, VBDISP_ANY, &ref);
-    if(FAILED(hres))
-        return hres;
-
-    if(ref.type != REF_VAR) {
-        FIXME("%s is not REF_VAR\n", debugstr_w(ident));
-        return E_FAIL;
-    }
-
-    hres = VarCmp(ref.u.v, stack_top(ctx, 1), ctx->script->lcid, 0);
+    hres = var_cmp(ctx, var, stack_top(ctx, 1));
     if(FAILED(hres))
         return hres;
 
@@ -1105,6 +1224,35 @@ static HRESULT interp_step(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_step(exec_ctx_t *ctx)
+{
+    const BSTR ident = ctx->instr->arg2.bstr;
+    ref_t ref;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(ident));
+
+    hres = lookup_identifier(ctx, ident, VBDISP_ANY, &ref);
+    if(FAILED(hres))
+        return hres;
+
+    if(ref.type != REF_VAR) {
+        FIXME("%s is not REF_VAR\n", debugstr_w(ident));
+        return E_FAIL;
+    }
+
+    return do_step(ctx, ref.u.v);
+}
+
+static HRESULT interp_step_local(exec_ctx_t *ctx)
+{
+    const unsigned slot = ctx->instr->arg2.uint;
+
+    TRACE("%u\n", slot);
+
+    return do_step(ctx, local_var(ctx, slot));
+}
+
 static HRESULT interp_newenum(exec_ctx_t *ctx)
 {
     variant_val_t v;
@@ -1552,15 +1700,6 @@ static HRESULT interp_imp(exec_ctx_t *ctx)
     return stack_push(ctx, &v);
 }
 
-static HRESULT var_cmp(exec_ctx_t *ctx, VARIANT *l, VARIANT *r)
-{
-    TRACE("%s %s\n", debugstr_variant(l), debugstr_variant(r));
-
-    /* FIXME: Fix comparing string to number */
-
-    return VarCmp(l, r, ctx->script->lcid, 0);
- }
-
 static HRESULT cmp_oper(exec_ctx_t *ctx)
 {
     variant_val_t l, r;
@@ -1813,6 +1952,7 @@ static HRESULT interp_concat(exec_ctx_t *ctx)
 static HRESULT interp_add(exec_ctx_t *ctx)
 {
     variant_val_t r, l;
+    LONG li, ri;
     VARIANT v;
     HRESULT hres;
 
@@ -1824,7 +1964,8 @@ static HRESULT interp_add(exec_ctx_t *ctx)
 
     hres = stack_pop_val(ctx, &l);
     if(SUCCEEDED(hres)) {
-        hres = VarAdd(l.v, r.v, &v);
+        if(!get_int_val(l.v, &li) || !get_int_val(r.v, &ri) || !set_int_result(l.v, r.v, (LONGLONG)li + ri, &v))
+            hres = VarAdd(l.v, r.v, &v);
         release_val(&l);
     }
     release_val(&r);
@@ -1837,6 +1978,7 @@ static HRESULT interp_add(exec_ctx_t *ctx)
 static HRESULT interp_sub(exec_ctx_t *ctx)
 {
     variant_val_t r, l;
+    LONG li, ri;
     VARIANT v;
     HRESULT hres;
 
@@ -1848,7 +1990,8 @@ static HRESULT interp_sub(exec_ctx_t *ctx)
 
     hres = stack_pop_val(ctx, &l);
     if(SUCCEEDED(hres)) {
-        hres = VarSub(l.v, r.v, &v);
+        if(!get_int_val(l.v, &li) || !get_int_val(r.v, &ri) || !set_int_result(l.v, r.v, (LONGLONG)li - ri, &v))
+            hres = VarSub(l.v, r.v, &v);
         release_val(&l);
     }
     release_val(&r);
@@ -1933,6 +2076,7 @@ static HRESULT interp_div(exec_ctx_t *ctx)
 static HRESULT interp_mul(exec_ctx_t *ctx)
 {
     variant_val_t r, l;
+    LONG li, ri;
     VARIANT v;
     HRESULT hres;
 
@@ -1944,7 +2088,8 @@ static HRESULT interp_mul(exec_ctx_t *ctx)
 
     hres = stack_pop_val(ctx, &l);
     if(SUCCEEDED(hres)) {
-        hres = VarMul(l.v, r.v, &v);
+        if(!get_int_val(l.v, &li) || !get_int_val(r.v, &ri) || !set_int_result(l.v, r.v, (LONGLONG)li * ri, &v))
+            hres = VarMul(l.v, r.v, &v);
         release_val(&l);
     }
     release_val(&r);
@@ -1996,10 +2141,30 @@ static HRESULT interp_neg(exec_ctx_t *ctx)
     return stack_push(ctx, &v);
 }
 
+static HRESULT do_incc(exec_ctx_t *ctx, VARIANT *var)
+{
+    VARIANT *step = stack_top(ctx, 0);
+    LONG si, vi;
+    VARIANT v;
+    HRESULT hres;
+
+    if(get_int_val(step, &si) && get_int_val(var, &vi) && set_int_result(step, var, (LONGLONG)si + vi, &v)) {
+        *var = v;
+        return S_OK;
+    }
+
+    hres = VarAdd(step, var, &v);
+    if(FAILED(hres))
+        return hres;
+
+    VariantClear(var);
+    *var = v;
+    return S_OK;
+}
+
 static HRESULT interp_incc(exec_ctx_t *ctx)
 {
     const BSTR ident = ctx->instr->arg1.bstr;
-    VARIANT v;
     ref_t ref;
     HRESULT hres;
 
@@ -2014,13 +2179,16 @@ static HRESULT interp_incc(exec_ctx_t *ctx)
         return E_FAIL;
     }
 
-    hres = VarAdd(stack_top(ctx, 0), ref.u.v, &v);
-    if(FAILED(hres))
-        return hres;
+    return do_incc(ctx, ref.u.v);
+}
 
-    VariantClear(ref.u.v);
-    *ref.u.v = v;
-    return S_OK;
+static HRESULT interp_incc_local(exec_ctx_t *ctx)
+{
+    const unsigned slot = ctx->instr->arg1.uint;
+
+    TRACE("%u\n", slot);
+
+    return do_incc(ctx, local_var(ctx, slot));
 }
 
 static HRESULT interp_catch(exec_ctx_t *ctx)
@@ -2083,6 +2251,37 @@ static void release_exec(exec_ctx_t *ctx)
     heap_free(ctx->stack);
 }
 
+/*
+ * The variables declared by the global code belong to the script context,
+ * which drops them when the script is reset while the code is kept. Resolve
+ * the slots of the global code by name each time it runs, adding the
+ * variables which are gone, so that it uses the ones lookup_identifier finds.
+ */
+static HRESULT resolve_global_vars(exec_ctx_t *ctx)
+{
+    const function_t *func = ctx->func;
+    ref_t ref;
+    unsigned i;
+    HRESULT hres;
+
+    ctx->global_vars = heap_pool_alloc(&ctx->heap, func->global_var_cnt * sizeof(*ctx->global_vars));
+    if(!ctx->global_vars)
+        return E_OUTOFMEMORY;
+
+    for(i=0; i < func->global_var_cnt; i++) {
+        if(lookup_dynamic_vars(ctx->script->global_vars, func->global_var_names[i], &ref)) {
+            ctx->global_vars[i] = ref.u.v;
+            continue;
+        }
+
+        hres = add_dynamic_var(ctx, func->global_var_names[i], FALSE, ctx->global_vars+i);
+        if(FAILED(hres))
+            return hres;
+    }
+
+    return S_OK;
+}
+
 HRESULT exec_script(script_ctx_t *ctx, BOOL extern_caller, function_t *func, vbdisp_t *vbthis, DISPPARAMS *dp, VARIANT *res)
 {
     exec_ctx_t exec = {func->code_ctx};
@@ -2145,6 +2344,16 @@ HRESULT exec_script(script_ctx_t *ctx, BOOL extern_caller, function_t *func, vbd
         return E_OUTOFMEMORY;
     }
 
+    if(func->global_var_cnt) {
+        exec.script = ctx;
+        exec.func = func;
+        hres = resolve_global_vars(&exec);
+        if(FAILED(hres)) {
+            release_exec(&exec);
+            return hres;
+        }
+    }
+
     if(extern_caller)
         IActiveScriptSite_OnEnterScript(ctx->site);
 
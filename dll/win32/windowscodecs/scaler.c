@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -33,6 +34,19 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* weights are fixed point numbers with 14 fractional bits */
+#define FILTER_SHIFT 14
+#define FILTER_ONE (1 << FILTER_SHIFT)
+
+/* source rows requested at once when scaling with a filter */
+#define FILTER_BAND_HEIGHT 16
+
+typedef struct ScalerFilter {
+    UINT taps;      /* source pixels contributing to each destination pixel */
+    UINT *first;    /* first contributing source pixel of each destination pixel */
+    SHORT *weights; /* taps weights for each destination pixel */
+} ScalerFilter;
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -44,9 +58,376 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    /* filtered modes: the source has one byte per channel */
+    ScalerFilter filter_x, filter_y;
+    UINT channels;
+    BOOL premultiply;       /* straight alpha, filtered premultiplied */
+    /* horizontally scaled source rows, kept between calls to CopyPixels so
+     * that copying one scanline at a time reads each source row once */
+    BYTE *rows;
+    INT *row_index;         /* source row held by each slot of rows, or -1 */
+    UINT rows_x, rows_width;
+    BYTE *band;             /* last rows read from the source */
+    UINT band_y, band_height;
+    INT *accum;
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
+static double Linear_Kernel(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Keys' cubic convolution with a = -0.5 */
+static double Cubic_Kernel(double x)
+{
+    x = fabs(x);
+    if (x < 1.0)
+        return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0)
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+static void Filter_Free(ScalerFilter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->first);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    filter->first = NULL;
+    filter->weights = NULL;
+    filter->taps = 0;
+}
+
+/* Computes the contribution of the source pixels to each destination pixel
+ * along one axis. Linear and cubic sample the source at the position of the
+ * destination pixel, Fant averages the source area it covers. */
+static HRESULT Filter_Init(ScalerFilter *filter, UINT src_size, UINT dst_size,
+    WICBitmapInterpolationMode mode)
+{
+    double scale = (double)src_size / dst_size, width = 1.0, support, center;
+    double *weights, sum, e0, e1;
+    INT x, lo, hi, first, total, largest;
+    UINT i, j, taps;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        support = 1.0;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        support = 2.0;
+        break;
+    default:
+        width = max(scale, 1.0);
+        support = width / 2.0 + 0.5;
+        break;
+    }
+
+    /* only the pixels strictly within the support contribute */
+    taps = min((UINT)ceil(support * 2.0), src_size);
+
+    filter->taps = taps;
+    filter->first = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(UINT));
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * taps * sizeof(SHORT));
+    weights = HeapAlloc(GetProcessHeap(), 0, taps * sizeof(double));
+    if (!filter->first || !filter->weights || !weights)
+    {
+        HeapFree(GetProcessHeap(), 0, weights);
+        Filter_Free(filter);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < dst_size; i++)
+    {
+        center = (i + 0.5) * scale - 0.5;
+        lo = (INT)floor(center - support) + 1;
+        hi = (INT)ceil(center + support) - 1;
+        first = max(0, min(lo, (INT)(src_size - taps)));
+
+        memset(weights, 0, taps * sizeof(double));
+        for (x = lo; x <= hi; x++)
+        {
+            double w;
+
+            if (mode == WICBitmapInterpolationModeLinear)
+                w = Linear_Kernel(x - center);
+            else if (mode == WICBitmapInterpolationModeCubic)
+                w = Cubic_Kernel(x - center);
+            else
+            {
+                /* coverage of the pixel by the destination pixel */
+                e0 = center + 0.5 - width / 2.0;
+                e1 = e0 + width;
+                w = min(e1, x + 1.0) - max(e0, (double)x);
+                if (w < 0.0) w = 0.0;
+            }
+
+            /* pixels past the edges are replaced by the edge pixels */
+            j = max(0, min(x, (INT)src_size - 1)) - first;
+            weights[min(j, taps - 1)] += w;
+        }
+
+        sum = 0.0;
+        for (j = 0; j < taps; j++)
+            sum += weights[j];
+
+        total = 0;
+        largest = 0;
+        for (j = 0; j < taps; j++)
+        {
+            SHORT w = sum != 0.0 ? (SHORT)floor(weights[j] * FILTER_ONE / sum + 0.5) : 0;
+
+            filter->weights[i * taps + j] = w;
+            total += w;
+            if (abs(w) > abs(filter->weights[i * taps + largest]))
+                largest = j;
+        }
+
+        /* make the weights add up to one exactly */
+        filter->weights[i * taps + largest] += FILTER_ONE - total;
+        filter->first[i] = first;
+    }
+
+    HeapFree(GetProcessHeap(), 0, weights);
+    return S_OK;
+}
+
+static inline BYTE Filter_Clamp(INT value)
+{
+    value >>= FILTER_SHIFT;
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/* Straight alpha is premultiplied before filtering and divided out afterwards,
+ * otherwise the color of transparent pixels bleeds into their neighbours.
+ * Both 32bppBGRA and 32bppRGBA have alpha in the last byte. */
+static void Filter_Premultiply(BYTE *pixel, UINT count)
+{
+    UINT i, a;
+
+    for (i = 0; i < count; i++, pixel += 4)
+    {
+        a = pixel[3];
+        if (a == 255) continue;
+        pixel[0] = (pixel[0] * a + 127) / 255;
+        pixel[1] = (pixel[1] * a + 127) / 255;
+        pixel[2] = (pixel[2] * a + 127) / 255;
+    }
+}
+
+static void Filter_Unpremultiply(BYTE *pixel, UINT count)
+{
+    UINT i, a, c;
+
+    for (i = 0; i < count; i++, pixel += 4)
+    {
+        a = pixel[3];
+        if (a == 255) continue;
+        if (a == 0)
+        {
+            pixel[0] = pixel[1] = pixel[2] = 0;
+            continue;
+        }
+        /* cubic may overshoot the alpha of the filtered pixel */
+        for (c = 0; c < 3; c++)
+            pixel[c] = min(255, (pixel[c] * 255 + a / 2) / a);
+    }
+}
+
+/* scales a source row horizontally, src starts at the source pixel span_x */
+static void Filter_ScaleRow(const ScalerFilter *filter, UINT channels, UINT dst_x,
+    UINT dst_width, UINT span_x, const BYTE *src, BYTE *dst)
+{
+    const UINT taps = filter->taps;
+    const SHORT *weights;
+    const BYTE *pixel;
+    UINT i, j, c;
+
+    for (i = 0; i < dst_width; i++)
+    {
+        weights = filter->weights + (dst_x + i) * taps;
+        pixel = src + (filter->first[dst_x + i] - span_x) * channels;
+
+        switch (channels)
+        {
+        case 4:
+        {
+            INT c0 = FILTER_ONE / 2, c1 = FILTER_ONE / 2, c2 = FILTER_ONE / 2, c3 = FILTER_ONE / 2;
+
+            for (j = 0; j < taps; j++, pixel += 4)
+            {
+                c0 += weights[j] * pixel[0];
+                c1 += weights[j] * pixel[1];
+                c2 += weights[j] * pixel[2];
+                c3 += weights[j] * pixel[3];
+            }
+            dst[0] = Filter_Clamp(c0);
+            dst[1] = Filter_Clamp(c1);
+            dst[2] = Filter_Clamp(c2);
+            dst[3] = Filter_Clamp(c3);
+            dst += 4;
+            break;
+        }
+        case 3:
+        {
+            INT c0 = FILTER_ONE / 2, c1 = FILTER_ONE / 2, c2 = FILTER_ONE / 2;
+
+            for (j = 0; j < taps; j++, pixel += 3)
+            {
+                c0 += weights[j] * pixel[0];
+                c1 += weights[j] * pixel[1];
+                c2 += weights[j] * pixel[2];
+            }
+            dst[0] = Filter_Clamp(c0);
+            dst[1] = Filter_Clamp(c1);
+            dst[2] = Filter_Clamp(c2);
+            dst += 3;
+            break;
+        }
+        default:
+            for (c = 0; c < channels; c++)
+            {
+                INT sum = FILTER_ONE / 2;
+
+                for (j = 0; j < taps; j++)
+                    sum += weights[j] * pixel[j * channels + c];
+                *dst++ = Filter_Clamp(sum);
+            }
+            break;
+        }
+    }
+}
+
+/* combines horizontally scaled rows, one tap at a time over whole rows */
+static void Filter_ScaleColumns(const SHORT *weights, UINT taps, BYTE * const *rows,
+    UINT count, INT *accum, BYTE *dst)
+{
+    UINT i, j;
+
+    for (i = 0; i < count; i++)
+        accum[i] = FILTER_ONE / 2;
+
+    for (j = 0; j < taps; j++)
+    {
+        const BYTE *row = rows[j];
+        const INT w = weights[j];
+
+        if (!w) continue;
+        for (i = 0; i < count; i++)
+            accum[i] += w * row[i];
+    }
+
+    for (i = 0; i < count; i++)
+        dst[i] = Filter_Clamp(accum[i]);
+}
+
+static void Filter_FreeRows(BitmapScaler *This)
+{
+    HeapFree(GetProcessHeap(), 0, This->rows);
+    HeapFree(GetProcessHeap(), 0, This->row_index);
+    HeapFree(GetProcessHeap(), 0, This->band);
+    HeapFree(GetProcessHeap(), 0, This->accum);
+    This->rows = NULL;
+    This->row_index = NULL;
+    This->band = NULL;
+    This->accum = NULL;
+    This->rows_width = 0;
+    This->band_height = 0;
+}
+
+static HRESULT Filter_CopyPixels(BitmapScaler *This, const WICRect *dest_rect,
+    UINT cbStride, BYTE *pbBuffer)
+{
+    const UINT taps_y = This->filter_y.taps;
+    UINT span_x, span_width, row_size, span_size, y, j;
+    BYTE *row_array[8], **row_ptrs = row_array;
+    HRESULT hr = S_OK;
+
+    span_x = This->filter_x.first[dest_rect->X];
+    span_width = This->filter_x.first[dest_rect->X + dest_rect->Width - 1] + This->filter_x.taps - span_x;
+    row_size = dest_rect->Width * This->channels;
+    span_size = span_width * This->channels;
+
+    /* the cached rows only hold the columns of the previous call */
+    if (!This->rows || This->rows_x != dest_rect->X || This->rows_width != dest_rect->Width)
+    {
+        Filter_FreeRows(This);
+        This->rows = HeapAlloc(GetProcessHeap(), 0, taps_y * row_size);
+        This->row_index = HeapAlloc(GetProcessHeap(), 0, taps_y * sizeof(INT));
+        This->band = HeapAlloc(GetProcessHeap(), 0, FILTER_BAND_HEIGHT * span_size);
+        This->accum = HeapAlloc(GetProcessHeap(), 0, row_size * sizeof(INT));
+        if (!This->rows || !This->row_index || !This->band || !This->accum)
+        {
+            Filter_FreeRows(This);
+            return E_OUTOFMEMORY;
+        }
+
+        for (j = 0; j < taps_y; j++)
+            This->row_index[j] = -1;
+        This->rows_x = dest_rect->X;
+        This->rows_width = dest_rect->Width;
+    }
+
+    if (taps_y > ARRAY_SIZE(row_array))
+    {
+        row_ptrs = HeapAlloc(GetProcessHeap(), 0, taps_y * sizeof(BYTE*));
+        if (!row_ptrs)
+            return E_OUTOFMEMORY;
+    }
+
+    for (y = 0; y < dest_rect->Height; y++)
+    {
+        UINT first_y = This->filter_y.first[dest_rect->Y + y];
+
+        for (j = 0; j < taps_y; j++)
+        {
+            UINT src_y = first_y + j, slot = src_y % taps_y;
+
+            row_ptrs[j] = This->rows + slot * row_size;
+            if (This->row_index[slot] == (INT)src_y)
+                continue;
+
+            /* read the source in bands of rows, but never all of it */
+            if (src_y < This->band_y || src_y >= This->band_y + This->band_height)
+            {
+                WICRect band_rect;
+
+                band_rect.X = span_x;
+                band_rect.Y = src_y;
+                band_rect.Width = span_width;
+                band_rect.Height = min(FILTER_BAND_HEIGHT, This->src_height - src_y);
+
+                This->band_height = 0;
+                hr = IWICBitmapSource_CopyPixels(This->source, &band_rect, span_size,
+                    span_size * band_rect.Height, This->band);
+                if (FAILED(hr))
+                    goto end;
+
+                if (This->premultiply)
+                    Filter_Premultiply(This->band, span_width * band_rect.Height);
+
+                This->band_y = src_y;
+                This->band_height = band_rect.Height;
+            }
+
+            Filter_ScaleRow(&This->filter_x, This->channels, dest_rect->X, dest_rect->Width,
+                span_x, This->band + (src_y - This->band_y) * span_size, row_ptrs[j]);
+            This->row_index[slot] = src_y;
+        }
+
+        Filter_ScaleColumns(This->filter_y.weights + (dest_rect->Y + y) * taps_y, taps_y,
+            row_ptrs, row_size, This->accum, pbBuffer + cbStride * y);
+        if (This->premultiply)
+            Filter_Unpremultiply(pbBuffer + cbStride * y, dest_rect->Width);
+    }
+
+end:
+    if (row_ptrs != row_array)
+        HeapFree(GetProcessHeap(), 0, row_ptrs);
+    return hr;
+}
+
 static inline BitmapScaler *impl_from_IWICBitmapScaler(IWICBitmapScaler *iface)
 {
     return CONTAINING_RECORD(iface, BitmapScaler, IWICBitmapScaler_iface);
@@ -108,6 +489,9 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        Filter_FreeRows(This);
+        Filter_Free(&This->filter_x);
+        Filter_Free(&This->filter_y);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -259,6 +643,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (This->channels)
+    {
+        hr = Filter_CopyPixels(This, &dest_rect, cbStride, pbBuffer);
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
@@ -353,6 +743,52 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            /* the filters work on bytes, other formats are converted */
+            if (IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat8bppGray) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat24bppBGR) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat24bppRGB) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGR) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGRA) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppPBGRA) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppRGBA) ||
+                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppPRGBA))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+            }
+            else
+            {
+                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                    pISource, &This->source);
+                This->bpp = 32;
+                src_pixelformat = GUID_WICPixelFormat32bppBGRA;
+            }
+
+            if (SUCCEEDED(hr))
+                hr = Filter_Init(&This->filter_x, This->src_width, This->width, mode);
+            if (SUCCEEDED(hr))
+                hr = Filter_Init(&This->filter_y, This->src_height, This->height, mode);
+
+            if (SUCCEEDED(hr))
+            {
+                This->channels = This->bpp / 8;
+                This->premultiply = IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGRA) ||
+                                    IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppRGBA);
+            }
+            else
+            {
+                Filter_Free(&This->filter_x);
+                Filter_Free(&This->filter_y);
+                if (This->source)
+                {
+                    IWICBitmapSource_Release(This->source);
+                    This->source = NULL;
+                }
+            }
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -529,6 +965,15 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->channels = 0;
+    This->rows = NULL;
+    This->row_index = NULL;
+    This->rows_x = This->rows_width = 0;
+    This->band = NULL;
+    This->band_y = This->band_height = 0;
+    This->accum = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -32,6 +32,13 @@
 #define MIN_INDEXED_LENGTH 5
 #define MAX_INDEXED_LENGTH 9
 
+/*
+ * Pending reads at least this large get their buffer locked, so that
+ * writers copy straight into it instead of going through pool, as long
+ * as the pipe quota covers them.
+ */
+#define NPFS_DIRECT_READ_THRESHOLD PAGE_SIZE
+
 /* TYPEDEFS & DEFINES *********************************************************/
 
 //
@@ -597,6 +604,16 @@ NpCancelWaiter(IN PNP_WAIT_QUEUE WaitQueue,
                IN PLIST_ENTRY ListEntry);
 
 
+NTSTATUS
+NTAPI
+NpLockReadBuffer(IN PIRP Irp,
+                 IN PVOID Buffer,
+                 IN ULONG BufferSize);
+
+VOID
+NTAPI
+NpUnlockReadBuffer(IN PIRP Irp);
+
 IO_STATUS_BLOCK
 NTAPI
 NpReadDataQueue(IN PNP_DATA_QUEUE DataQueue,
@@ -21,6 +21,53 @@ ULONG NpFastReadFalse;
 
 /* FUNCTIONS ******************************************************************/
 
+NTSTATUS
+NTAPI
+NpLockReadBuffer(IN PIRP Irp,
+                 IN PVOID Buffer,
+                 IN ULONG BufferSize)
+{
+    PMDL Mdl;
+    NTSTATUS Status;
+    PAGED_CODE();
+
+    /* We are still in the context of the reader, lock its buffer for the writers */
+    Mdl = IoAllocateMdl(Buffer, BufferSize, FALSE, TRUE, Irp);
+    if (!Mdl)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Status = STATUS_SUCCESS;
+    _SEH2_TRY
+    {
+        MmProbeAndLockPages(Mdl, Irp->RequestorMode, IoWriteAccess);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    /* The I/O manager unlocks and frees the MDL when the read completes */
+    if (!NT_SUCCESS(Status))
+    {
+        IoFreeMdl(Mdl);
+        Irp->MdlAddress = NULL;
+    }
+
+    return Status;
+}
+
+VOID
+NTAPI
+NpUnlockReadBuffer(IN PIRP Irp)
+{
+    MmUnlockPages(Irp->MdlAddress);
+    IoFreeMdl(Irp->MdlAddress);
+    Irp->MdlAddress = NULL;
+}
+
 BOOLEAN
 NTAPI
 NpCommonRead(IN PFILE_OBJECT FileObject,
@@ -129,6 +176,30 @@ NpCommonRead(IN PFILE_OBJECT FileObject,
         goto Quickie;
     }
 
+    /*
+     * Small reads are cheaper to complete through a pool buffer. Larger ones
+     * get their buffer locked for the writers to copy straight into it, as
+     * long as the pipe quota still covers the whole read: the pending reads
+     * are charged to it, which bounds the pages they keep locked. The pages
+     * must not be probed with our locks held, so NpFsdRead does it and then
+     * calls us again.
+     */
+    if (BufferSize >= NPFS_DIRECT_READ_THRESHOLD &&
+        ReadQueue->Quota - ReadQueue->QuotaUsed >= BufferSize)
+    {
+        if (!Irp->MdlAddress)
+        {
+            IoStatus->Status = STATUS_RETRY;
+            ReadOk = TRUE;
+            goto Quickie;
+        }
+    }
+    else if (Irp->MdlAddress)
+    {
+        /* Other reads used the quota meanwhile */
+        NpUnlockReadBuffer(Irp);
+    }
+
     Status = NpAddDataQueueEntry(NamedPipeEnd,
                                  Ccb,
                                  ReadQueue,
@@ -178,6 +249,26 @@ NpFsdRead(IN PDEVICE_OBJECT DeviceObject,
                  Irp,
                  &DeferredList);
 
+    /* Lock the buffer of a large read which has to wait, then try again */
+    if (IoStatus.Status == STATUS_RETRY)
+    {
+        NpReleaseVcb();
+        IoStatus.Status = NpLockReadBuffer(Irp,
+                                           Irp->UserBuffer,
+                                           IoStack->Parameters.Read.Length);
+        NpAcquireSharedVcb();
+
+        if (NT_SUCCESS(IoStatus.Status))
+        {
+            NpCommonRead(IoStack->FileObject,
+                         Irp->UserBuffer,
+                         IoStack->Parameters.Read.Length,
+                         &IoStatus,
+                         Irp,
+                         &DeferredList);
+        }
+    }
+
     NpReleaseVcb();
     NpCompleteDeferredIrps(&DeferredList);
     FsRtlExitFileSystem();
@@ -28,7 +28,7 @@ NpWriteDataQueue(IN PNP_DATA_QUEUE WriteQueue,
                  IN PETHREAD Thread,
                  IN PLIST_ENTRY List)
 {
-    BOOLEAN HaveContext = FALSE, MoreProcessing, AllocatedBuffer;
+    BOOLEAN HaveContext = FALSE, MoreProcessing, AllocatedBuffer, DirectBuffer;
     PNP_DATA_QUEUE_ENTRY DataEntry;
     ULONG DataSize, BufferSize;
     PIRP WriteIrp;
@@ -80,7 +80,24 @@ NpWriteDataQueue(IN PNP_DATA_QUEUE WriteQueue,
         BufferSize = *BytesNotWritten;
         if (BufferSize >= DataSize) BufferSize = DataSize;
 
-        if (DataEntry->DataEntryType != Unbuffered && BufferSize)
+        /*
+         * If the reader locked its buffer, copy straight into it;
+         * otherwise hand it a pool buffer the I/O manager copies out.
+         */
+        Buffer = NULL;
+        DirectBuffer = FALSE;
+        if (DataEntry->DataEntryType != Unbuffered && BufferSize &&
+            IoStack->MajorFunction == IRP_MJ_READ && DataEntry->Irp->MdlAddress)
+        {
+            Buffer = MmGetSystemAddressForMdlSafe(DataEntry->Irp->MdlAddress, NormalPagePriority);
+            DirectBuffer = (Buffer != NULL);
+        }
+
+        if (DirectBuffer)
+        {
+            AllocatedBuffer = FALSE;
+        }
+        else if (DataEntry->DataEntryType != Unbuffered && BufferSize)
         {
             Buffer = ExAllocatePoolWithTag(NonPagedPool, BufferSize, NPFS_DATA_ENTRY_TAG);
             if (!Buffer) return STATUS_INSUFFICIENT_RESOURCES;
@@ -22,6 +22,7 @@ BOOLEAN HalpPhysicalMemoryMayAppearAbove4GB;
 
 FADT HalpFixedAcpiDescTable;
 PDEBUG_PORT_TABLE HalpDebugPortTable;
+PHYSICAL_ADDRESS HalpHpetBaseAddress;
 PACPI_SRAT HalpAcpiSrat;
 PBOOT_TABLE HalpSimpleBootFlagTable;
 
@@ -793,6 +794,7 @@ HalpSetupAcpiPhase0(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
 {
     NTSTATUS Status;
     PFADT Fadt;
+    PHPET_TABLE Hpet;
     ULONG TableLength;
     PHYSICAL_ADDRESS PhysicalAddress;
 
@@ -825,6 +827,14 @@ HalpSetupAcpiPhase0(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
     /* Get the debug table for KD */
     HalpDebugPortTable = HalAcpiGetTable(LoaderBlock, DBGP_SIGNATURE);
 
+    /* Get the HPET, it can back the performance counter */
+    Hpet = HalAcpiGetTable(LoaderBlock, HPET_SIGNATURE);
+    if ((Hpet) && (Hpet->BaseAddress.AddressSpaceID == 0))
+    {
+        /* Only memory mapped HPETs are supported */
+        HalpHpetBaseAddress = Hpet->BaseAddress.Address;
+    }
+
     /* Initialize NUMA through the SRAT */
     HalpNumaInitializeStaticConfiguration(LoaderBlock);
 
@@ -127,6 +127,12 @@ HalpCalibrateStallExecution(VOID)
     HalpInitializeTsc();
 
     KeGetPcr()->StallScaleFactor = (ULONG)(HalpCpuClockFrequency.QuadPart / 1000000);
+
+    /* KeQueryPerformanceCounter returns the raw TSC. If it is invariant,
+       let user mode read it directly as well */
+    SharedUserTscQpcData->Bias = 0;
+    SharedUserTscQpcData->Shift = 0;
+    SharedUserTscQpcData->Enabled = HalpIsTscInvariant();
 }
 
 /* PUBLIC FUNCTIONS ***********************************************************/
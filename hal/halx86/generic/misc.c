@@ -212,6 +212,24 @@ HalpFlushTLB(VOID)
     __writeeflags(Flags);
 }
 
+BOOLEAN
+NTAPI
+HalpIsTscInvariant(VOID)
+{
+    INT CpuInfo[4];
+
+    /* Check if the CPU supports RDTSC at all */
+    if (!(KeGetCurrentPrcb()->FeatureBits & KF_RDTSC)) return FALSE;
+
+    /* Check if the advanced power management leaf is there */
+    __cpuid(CpuInfo, 0x80000000);
+    if ((ULONG)CpuInfo[0] < 0x80000007) return FALSE;
+
+    /* The TSC runs at a constant rate in all P-, C- and T-states if bit 8 is set */
+    __cpuid(CpuInfo, 0x80000007);
+    return (CpuInfo[3] & 0x100) != 0;
+}
+
 /* FUNCTIONS *****************************************************************/
 
 /*
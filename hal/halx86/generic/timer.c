@@ -17,8 +17,32 @@
 
 #define PIT_LATCH  0x00
 
+/* Calibrate the TSC over 50 ms worth of PIT ticks */
+#define TSC_CALIBRATION_TICKS  (PIT_FREQUENCY / 20)
+
+/* HPET registers and bits */
+#define HPET_GENERAL_CAPABILITIES   0x00
+#define HPET_CLOCK_PERIOD           0x04
+#define HPET_GENERAL_CONFIGURATION  0x10
+#define HPET_MAIN_COUNTER           0xF0
+#define HPET_COUNT_SIZE_CAP         0x2000
+#define HPET_ENABLE_CNF             0x01
+#define HPET_MAX_CLOCK_PERIOD       100000000 /* 100 ns, in femtoseconds */
+
+typedef enum _HALP_PERF_COUNTER_SOURCE
+{
+    HalpPerfCounterSourcePit,
+    HalpPerfCounterSourceHpet,
+    HalpPerfCounterSourceTsc
+} HALP_PERF_COUNTER_SOURCE;
+
 extern HALP_ROLLOVER HalpRolloverTable[15];
 
+HALP_PERF_COUNTER_SOURCE HalpPerfCounterSource = HalpPerfCounterSourcePit;
+LARGE_INTEGER HalpPerfCounterFrequency = {{PIT_FREQUENCY}};
+ULONG64 HalpPerfCounterBias;
+PUCHAR HalpHpetBase;
+
 LARGE_INTEGER HalpLastPerfCounter;
 LARGE_INTEGER HalpPerfCounter;
 ULONG HalpPerfCounterCutoff;
@@ -48,6 +72,145 @@ HalpRead8254Value(void)
     return TimerValue;
 }
 
+FORCEINLINE
+ULONG64
+HalpReadHpetCounter(VOID)
+{
+    ULONG High, Low;
+
+    /* Read the 64-bit counter in two halves, until the high part is stable */
+    do
+    {
+        High = READ_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_MAIN_COUNTER + 4));
+        Low = READ_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_MAIN_COUNTER));
+    } while (High != READ_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_MAIN_COUNTER + 4)));
+
+    return ((ULONG64)High << 32) | Low;
+}
+
+#ifndef _MINIHAL_
+CODE_SEG("INIT")
+static
+ULONG64
+HalpCalibrateTsc(VOID)
+{
+    ULONG64 StartTsc, EndTsc;
+    ULONG LastValue, CounterValue, Elapsed = 0;
+    ULONG_PTR Flags;
+
+    /* Disable interrupts */
+    Flags = __readeflags();
+    _disable();
+
+    /* Poll the PIT, which was just programmed with the current rollover */
+    LastValue = HalpRead8254Value();
+    StartTsc = __rdtsc();
+    while (Elapsed < TSC_CALIBRATION_TICKS)
+    {
+        CounterValue = HalpRead8254Value();
+
+        /* The counter counts down and is reloaded with the rollover value */
+        if (CounterValue <= LastValue)
+            Elapsed += LastValue - CounterValue;
+        else
+            Elapsed += LastValue + HalpCurrentRollOver - CounterValue;
+
+        LastValue = CounterValue;
+    }
+    EndTsc = __rdtsc();
+
+    /* Restore interrupts if they were previously enabled */
+    __writeeflags(Flags);
+
+    return (EndTsc - StartTsc) * PIT_FREQUENCY / Elapsed;
+}
+
+CODE_SEG("INIT")
+static
+BOOLEAN
+HalpInitializeHpet(VOID)
+{
+    ULONG Capabilities, ClockPeriod, Configuration;
+
+    /* Check if ACPI told us about a HPET */
+    if (HalpHpetBaseAddress.QuadPart == 0) return FALSE;
+
+    /* Map its registers */
+    HalpHpetBase = HalpMapPhysicalMemory64(HalpHpetBaseAddress, 1);
+    if (!HalpHpetBase) return FALSE;
+
+    /* Only use 64-bit counters with a sane period, 32-bit ones wrap within minutes */
+    Capabilities = READ_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_GENERAL_CAPABILITIES));
+    ClockPeriod = READ_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_CLOCK_PERIOD));
+    if (!(Capabilities & HPET_COUNT_SIZE_CAP) ||
+        (ClockPeriod == 0) ||
+        (ClockPeriod > HPET_MAX_CLOCK_PERIOD))
+    {
+        DPRINT("HPET not usable: capabilities 0x%lx, period %lu fs\n", Capabilities, ClockPeriod);
+        HalpUnmapVirtualAddress(HalpHpetBase, 1);
+        HalpHpetBase = NULL;
+        return FALSE;
+    }
+
+    /* Start the main counter, it keeps running from now on */
+    Configuration = READ_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_GENERAL_CONFIGURATION));
+    WRITE_REGISTER_ULONG((PULONG)(HalpHpetBase + HPET_GENERAL_CONFIGURATION),
+                         Configuration | HPET_ENABLE_CNF);
+
+    /* The period is given in femtoseconds */
+    HalpPerfCounterFrequency.QuadPart = 1000000000000000ULL / ClockPeriod;
+    return TRUE;
+}
+
+CODE_SEG("INIT")
+static
+VOID
+HalpSelectPerformanceCounter(VOID)
+{
+    ULONG64 Frequency;
+
+    /* User mode has to ask the kernel unless the TSC is published below */
+    SharedUserTscQpcData->Enabled = FALSE;
+
+    /* An invariant TSC is the cheapest source, and user mode can read it too */
+    if (HalpIsTscInvariant())
+    {
+        Frequency = HalpCalibrateTsc();
+        if (Frequency != 0)
+        {
+            /* Make the counter start at 0, like the PIT based one */
+            HalpPerfCounterFrequency.QuadPart = Frequency;
+            HalpPerfCounterBias = __rdtsc();
+            HalpPerfCounterSource = HalpPerfCounterSourceTsc;
+
+            /*
+             * Publish it, so RtlQueryPerformanceCounter can compute
+             * (rdtsc + Bias) >> Shift without a system call.
+             * There is only one processor, so the TSC is always in sync.
+             */
+            SharedUserTscQpcData->Bias = 0 - HalpPerfCounterBias;
+            SharedUserTscQpcData->Shift = 0;
+            SharedUserTscQpcData->Enabled = TRUE;
+
+            DPRINT("Performance counter: invariant TSC, %I64u Hz\n", Frequency);
+            return;
+        }
+    }
+
+    /* Otherwise the HPET still beats port I/O to the PIT */
+    if (HalpInitializeHpet())
+    {
+        HalpPerfCounterBias = HalpReadHpetCounter();
+        HalpPerfCounterSource = HalpPerfCounterSourceHpet;
+
+        DPRINT("Performance counter: HPET, %I64u Hz\n", HalpPerfCounterFrequency.QuadPart);
+        return;
+    }
+
+    DPRINT("Performance counter: PIT\n");
+}
+#endif /* !_MINIHAL_ */
+
 VOID
 NTAPI
 HalpSetTimerRollOver(USHORT RollOver)
@@ -113,6 +276,11 @@ HalpInitializeClock(VOID)
     /* Save rollover and increment */
     HalpCurrentRollOver = RollOver;
     HalpCurrentTimeIncrement = Increment;
+
+#ifndef _MINIHAL_
+    /* Now that the PIT runs, pick the best performance counter */
+    HalpSelectPerformanceCounter();
+#endif
 }
 
 #ifdef _M_IX86
@@ -258,6 +426,19 @@ KeQueryPerformanceCounter(PLARGE_INTEGER PerformanceFrequency)
     ULONG CounterValue, ClockDelta;
     KIRQL OldIrql;
 
+    /* The TSC and the HPET need neither IRQL raising nor rollover tracking */
+    if (HalpPerfCounterSource != HalpPerfCounterSourcePit)
+    {
+        if (PerformanceFrequency) *PerformanceFrequency = HalpPerfCounterFrequency;
+
+        if (HalpPerfCounterSource == HalpPerfCounterSourceTsc)
+            CurrentPerfCounter.QuadPart = __rdtsc() - HalpPerfCounterBias;
+        else
+            CurrentPerfCounter.QuadPart = HalpReadHpetCounter() - HalpPerfCounterBias;
+
+        return CurrentPerfCounter;
+    }
+
     /* If caller wants performance frequency, return hardcoded value */
     if (PerformanceFrequency) PerformanceFrequency->QuadPart = PIT_FREQUENCY;
 
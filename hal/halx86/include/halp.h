@@ -217,6 +217,7 @@ DECLSPEC_NORETURN VOID FASTCALL HalpDispatchInterrupt2ndEntry(IN PKTRAP_FRAME Tr
 extern BOOLEAN HalpProfilingStopped;
 
 /* timer.c */
+extern PHYSICAL_ADDRESS HalpHpetBaseAddress;
 VOID NTAPI HalpInitializeClock(VOID);
 VOID __cdecl HalpClockInterrupt(VOID);
 VOID __cdecl HalpProfileInterrupt(VOID);
@@ -245,6 +246,10 @@ VOID
 NTAPI
 HalpFlushTLB(VOID);
 
+BOOLEAN
+NTAPI
+HalpIsTscInvariant(VOID);
+
 //
 // KD Support
 //
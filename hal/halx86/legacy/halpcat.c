@@ -27,6 +27,9 @@ PWCHAR HalHardwareIdString = L"e_isa_up";
 PWCHAR HalName = L"PC Compatible Eisa/Isa HAL";
 #endif
 
+/* There is no ACPI table describing a HPET on these HALs */
+PHYSICAL_ADDRESS HalpHpetBaseAddress;
+
 /* PRIVATE FUNCTIONS **********************************************************/
 
 CODE_SEG("INIT")
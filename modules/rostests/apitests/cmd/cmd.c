@@ -319,6 +319,156 @@ static const TEST_ENTRY s_attrib_entries[] =
 
 };
 
+/* fs-test.txt; the last line has no newline */
+#define FIND_TEST_DATA \
+    "alpha one\r\nBeta two\r\ngamma three\r\nbeta four\r\nxx.yy\r\nend zzz"
+
+static const TEST_ENTRY s_findstr_entries[] =
+{
+    /* plain strings */
+    { __LINE__, 0,      "findstr beta fs-test.txt", TRUE, FALSE, "beta four", NULL, "Beta two" },
+    { __LINE__, 0,      "findstr alpha fs-test.txt", TRUE, FALSE, "alpha one" },
+    { __LINE__, 0,      "findstr zzz fs-test.txt", TRUE, FALSE, "end zzz" },
+    { __LINE__, 1,      "findstr delta fs-test.txt", TRUE, FALSE, NULL, NULL, "a" },
+
+    /* /I, /V, /N */
+    { __LINE__, 0,      "findstr /I beta fs-test.txt", TRUE, FALSE, "Beta two\r\nbeta four\r\n" },
+    { __LINE__, 0,      "findstr /V beta fs-test.txt", TRUE, FALSE, "Beta two\r\ngamma three\r\nxx.yy", NULL, "beta four" },
+    { __LINE__, 0,      "findstr /V /I beta fs-test.txt", TRUE, FALSE, "alpha one\r\ngamma three\r\nxx.yy", NULL, "Beta" },
+    { __LINE__, 0,      "findstr /N gamma fs-test.txt", TRUE, FALSE, "3:gamma three\r\n" },
+    { __LINE__, 0,      "findstr /N /V a fs-test.txt", TRUE, FALSE, "5:xx.yy\r\n6:end zzz\r\n" },
+    { __LINE__, 0,      "findstr /N /I /V a fs-test.txt", TRUE, FALSE, "5:xx.yy", NULL, "alpha" },
+
+    /* /R */
+    { __LINE__, 0,      "findstr /R \"^g.*e$\" fs-test.txt", TRUE, FALSE, "gamma three" },
+    { __LINE__, 0,      "findstr /R b[aeiou]ta fs-test.txt", TRUE, FALSE, "beta four", NULL, "Beta" },
+    { __LINE__, 0,      "findstr /R /I ^B[a-f]ta fs-test.txt", TRUE, FALSE, "Beta two\r\nbeta four\r\n" },
+    { __LINE__, 0,      "findstr /R [^a-z]t fs-test.txt", TRUE, FALSE, "Beta two\r\ngamma three\r\n" },
+    { __LINE__, 0,      "findstr /R \"\\<one\\>\" fs-test.txt", TRUE, FALSE, "alpha one" },
+    { __LINE__, 1,      "findstr /R \"\\<on\\>\" fs-test.txt", TRUE, FALSE, NULL, NULL, "alpha" },
+    { __LINE__, 0,      "findstr /R x*\\.y fs-test.txt", TRUE, FALSE, "xx.yy", NULL, "alpha" },
+    { __LINE__, 1,      "findstr /R /V . fs-test.txt", TRUE, FALSE, NULL, NULL, "alpha" },
+    { __LINE__, 0,      "findstr /R \".*.*.*.*.*.*.*.*z$\" fs-test.txt", TRUE, FALSE, "end zzz", NULL, "xx.yy" },
+    { __LINE__, 1,      "findstr /R \".*.*.*.*.*.*.*.*q\" fs-test.txt", TRUE, FALSE, NULL, NULL, "alpha" },
+
+    /* /C: */
+    { __LINE__, 0,      "findstr \"/C:a one\" fs-test.txt", TRUE, FALSE, "alpha one", NULL, "Beta" },
+    { __LINE__, 1,      "findstr /C:a.p fs-test.txt", TRUE, FALSE, NULL, NULL, "alpha" },
+    { __LINE__, 0,      "findstr /C:xx.yy fs-test.txt", TRUE, FALSE, "xx.yy" },
+    { __LINE__, 0,      "findstr /I \"/C:BETA T\" fs-test.txt", TRUE, FALSE, "Beta two", NULL, "beta four" },
+
+    /* /B, /E, /X, /M */
+    { __LINE__, 0,      "findstr /B beta fs-test.txt", TRUE, FALSE, "beta four\r\n", NULL, "Beta" },
+    { __LINE__, 1,      "findstr /B four fs-test.txt", TRUE, FALSE, NULL, NULL, "beta" },
+    { __LINE__, 0,      "findstr /E two fs-test.txt", TRUE, FALSE, "Beta two\r\n", NULL, "four" },
+    { __LINE__, 0,      "findstr /E zzz fs-test.txt", TRUE, FALSE, "end zzz\r\n" },
+    { __LINE__, 1,      "findstr /E beta fs-test.txt", TRUE, FALSE, NULL, NULL, "beta" },
+    { __LINE__, 0,      "findstr /X xx.yy fs-test.txt", TRUE, FALSE, "xx.yy\r\n", NULL, "alpha" },
+    { __LINE__, 1,      "findstr /X xx fs-test.txt", TRUE, FALSE, NULL, NULL, "xx.yy" },
+    { __LINE__, 0,      "findstr /X /I \"/C:BETA TWO\" fs-test.txt", TRUE, FALSE, "Beta two", NULL, "beta four" },
+    { __LINE__, 0,      "findstr /M beta fs-test.txt fs-short.txt", TRUE, FALSE, "fs-test.txt\r\n", NULL, "beta four" },
+    { __LINE__, 0,      "findstr /M ab fs-test.txt fs-short.txt", TRUE, FALSE, "fs-short.txt\r\n", NULL, "fs-test.txt" },
+
+    /* several files, searched in parallel and printed in command line order */
+    { __LINE__, 0,      "findstr a fs-short.txt fs-test.txt", TRUE, FALSE,
+      "---------------- fs-short.txt\r\nab\r\n---------------- fs-test.txt\r\nalpha one\r\n" },
+    { __LINE__, 0,      "findstr a fs-test.txt fs-empty.txt fs-short.txt fs-test.txt", TRUE, FALSE,
+      "beta four\r\n---------------- fs-empty.txt\r\n---------------- fs-short.txt\r\nab\r\n"
+      "---------------- fs-test.txt\r\nalpha one\r\n" },
+    { __LINE__, 0,      "findstr /N two fs-test.txt fs-missing.txt fs-test.txt", TRUE, TRUE,
+      "2:Beta two\r\n---------------- fs-test.txt\r\n2:Beta two\r\n", "fs-missing.txt" },
+
+    /* more output than kept in memory (MAX_KEPT_OUTPUT) for a file waiting its turn */
+    { __LINE__, 0,      "cmd /c findstr big fs-short.txt fs-big.txt fs-big.txt fs-short.txt > fs-out.txt" },
+    { __LINE__, 0,      "findstr /N /B /C:---------------- fs-out.txt", TRUE, FALSE,
+      "1:---------------- fs-short.txt\r\n2:---------------- fs-big.txt\r\n"
+      "100003:---------------- fs-big.txt\r\n200004:---------------- fs-short.txt\r\n" },
+    { __LINE__, 0,      "findstr /N /X \"/C:big line 099999\" fs-out.txt", TRUE, FALSE,
+      "100002:big line 099999\r\n200003:big line 099999\r\n" },
+
+    /* strings longer than the file, empty files */
+    { __LINE__, 0,      "findstr ab fs-short.txt", TRUE, FALSE, "\nab\r\n" },
+    { __LINE__, 1,      "findstr abc fs-short.txt", TRUE, FALSE, NULL, NULL, "\nab" },
+    { __LINE__, 1,      "findstr x fs-empty.txt", TRUE, FALSE },
+    { __LINE__, 1,      "findstr /V x fs-empty.txt", TRUE, FALSE },
+    { __LINE__, 1,      "findstr /R .* fs-empty.txt", TRUE, FALSE },
+
+    /* standard input, missing files */
+    { __LINE__, 0,      "cmd /c findstr /N beta < fs-test.txt", TRUE, FALSE, "4:beta four" },
+    { __LINE__, 1,      "cmd /c findstr x < fs-empty.txt" },
+    { __LINE__, 0,      "cmd /c findstr /N next < fs-long.txt", TRUE, FALSE, "2:next line\r\n" },
+    { __LINE__, 0,      "cmd /c findstr /M xEND < fs-long.txt", TRUE, FALSE, "(standard input)" },
+    { __LINE__, 1,      "findstr beta fs-missing.txt", FALSE, TRUE, NULL, "fs-missing.txt" },
+};
+
+static const TEST_ENTRY s_find_entries[] =
+{
+    /* plain strings */
+    { __LINE__, 0,      "find \"beta\" fs-test.txt", TRUE, FALSE, "beta four", NULL, "Beta two" },
+    { __LINE__, 0,      "find \"alpha\" fs-test.txt", TRUE, FALSE, "alpha one" },
+    { __LINE__, 0,      "find \"zzz\" fs-test.txt", TRUE, FALSE, "end zzz" },
+    { __LINE__, 0,      "find \"a o\" fs-test.txt", TRUE, FALSE, "alpha one" },
+    { __LINE__, 1,      "find \"delta\" fs-test.txt", TRUE, FALSE, NULL, NULL, "alpha" },
+
+    /* /I, /V, /N, /C */
+    { __LINE__, 0,      "find /I \"BETA\" fs-test.txt", TRUE, FALSE, "Beta two" },
+    { __LINE__, 0,      "find /I \"BETA\" fs-test.txt", TRUE, FALSE, "beta four" },
+    { __LINE__, 0,      "find /V \"beta\" fs-test.txt", TRUE, FALSE, "gamma three", NULL, "beta four" },
+    { __LINE__, 0,      "find /V /I \"beta\" fs-test.txt", TRUE, FALSE, "xx.yy", NULL, "Beta" },
+    { __LINE__, 0,      "find /N \"gamma\" fs-test.txt", TRUE, FALSE, "[3]gamma three" },
+    { __LINE__, 0,      "find /N /V \"a\" fs-test.txt", TRUE, FALSE, "[6]end zzz" },
+    { __LINE__, 0,      "find /C \"beta\" fs-test.txt", TRUE, FALSE, ": 1" },
+    { __LINE__, 0,      "find /C /I \"beta\" fs-test.txt", TRUE, FALSE, ": 2" },
+    { __LINE__, 1,      "find /C \"delta\" fs-test.txt", TRUE, FALSE, ": 0" },
+
+    /* strings longer than the file, empty files */
+    { __LINE__, 0,      "find \"ab\" fs-short.txt", TRUE, FALSE, "\nab" },
+    { __LINE__, 1,      "find \"abc\" fs-short.txt", TRUE, FALSE, NULL, NULL, "\nab" },
+    { __LINE__, 1,      "find \"x\" fs-empty.txt", TRUE, FALSE },
+    { __LINE__, 1,      "find /V \"x\" fs-empty.txt", TRUE, FALSE },
+
+    /* standard input, missing files */
+    { __LINE__, 0,      "cmd /c find /N \"beta\" < fs-test.txt", TRUE, FALSE, "[4]beta four" },
+    { __LINE__, 1,      "cmd /c find \"x\" < fs-empty.txt" },
+    { __LINE__, 2,      "find \"beta\" fs-missing.txt", FALSE, TRUE, NULL, "fs-missing.txt" },
+};
+
+static void CreateTestFile(const char *pszName, const char *pszData)
+{
+    HANDLE hFile;
+    DWORD cbWritten;
+
+    hFile = CreateFileA(pszName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "Failed to create %s\n", pszName);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+
+    WriteFile(hFile, pszData, (DWORD)strlen(pszData), &cbWritten, NULL);
+    CloseHandle(hFile);
+}
+
+/* Writes cLines lines numbered from 0, with the given printf format */
+static void CreateLinesFile(const char *pszName, const char *pszFormat, DWORD cLines)
+{
+    HANDLE hFile;
+    char szLine[64];
+    DWORD i, cbWritten;
+
+    hFile = CreateFileA(pszName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "Failed to create %s\n", pszName);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+
+    for (i = 0; i < cLines; ++i)
+    {
+        sprintf(szLine, pszFormat, i);
+        WriteFile(hFile, szLine, (DWORD)strlen(szLine), &cbWritten, NULL);
+    }
+    CloseHandle(hFile);
+}
+
 static BOOL MyDuplicateHandle(HANDLE hFile, PHANDLE phFile, BOOL bInherit)
 {
     HANDLE hProcess = GetCurrentProcess();
@@ -540,3 +690,57 @@ START_TEST(attrib)
         DoTestEntry(&s_attrib_entries[i]);
     }
 }
+
+START_TEST(findstr)
+{
+    SIZE_T i;
+    char *pszLong;
+
+    CreateTestFile("fs-test.txt", FIND_TEST_DATA);
+    CreateTestFile("fs-short.txt", "ab");
+    CreateTestFile("fs-empty.txt", "");
+
+    /* 1.7 MB of matching lines, more than findstr keeps in memory */
+    CreateLinesFile("fs-big.txt", "big line %06lu\r\n", 100000);
+
+    /* A line longer than the blocks standard input is read by (READ_SIZE) */
+    pszLong = malloc(100000 + 32);
+    ok(pszLong != NULL, "Out of memory\n");
+    if (pszLong)
+    {
+        memset(pszLong, 'x', 100000);
+        strcpy(pszLong + 100000, "END\r\nnext line\r\n");
+        CreateTestFile("fs-long.txt", pszLong);
+        free(pszLong);
+    }
+
+    for (i = 0; i < ARRAYSIZE(s_findstr_entries); ++i)
+    {
+        DoTestEntry(&s_findstr_entries[i]);
+    }
+
+    DeleteFileA("fs-test.txt");
+    DeleteFileA("fs-short.txt");
+    DeleteFileA("fs-empty.txt");
+    DeleteFileA("fs-big.txt");
+    DeleteFileA("fs-long.txt");
+    DeleteFileA("fs-out.txt");
+}
+
+START_TEST(find)
+{
+    SIZE_T i;
+
+    CreateTestFile("fs-test.txt", FIND_TEST_DATA);
+    CreateTestFile("fs-short.txt", "ab");
+    CreateTestFile("fs-empty.txt", "");
+
+    for (i = 0; i < ARRAYSIZE(s_find_entries); ++i)
+    {
+        DoTestEntry(&s_find_entries[i]);
+    }
+
+    DeleteFileA("fs-test.txt");
+    DeleteFileA("fs-short.txt");
+    DeleteFileA("fs-empty.txt");
+}
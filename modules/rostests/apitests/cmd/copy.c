@@ -0,0 +1,195 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Test for the COPY command of cmd.exe
+ */
+
+#include "precomp.h"
+
+#define TIMEOUT     30000
+
+/* COPY switches to overlapped I/O from this size on */
+#define BIG_SIZE    (1024 * 1024)
+
+static DWORD RunCmd(const char *pszCmdLine, DWORD dwTimeout)
+{
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    char szCmdLine[MAX_PATH];
+    DWORD dwExitCode;
+
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    si.hStdOutput = NULL;
+    si.hStdError = NULL;
+
+    lstrcpynA(szCmdLine, pszCmdLine, ARRAYSIZE(szCmdLine));
+    if (!CreateProcessA(NULL, szCmdLine, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi))
+        return (DWORD)-1;
+
+    if (WaitForSingleObject(pi.hProcess, dwTimeout) != WAIT_OBJECT_0)
+    {
+        TerminateProcess(pi.hProcess, 1);
+        dwExitCode = (DWORD)-2;
+    }
+    else
+    {
+        GetExitCodeProcess(pi.hProcess, &dwExitCode);
+    }
+
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    return dwExitCode;
+}
+
+static char TestByte(DWORD dwOffset, DWORD dwSize)
+{
+    return (char)(dwOffset * 7 + dwSize);
+}
+
+static BOOL CreateSizedFile(const char *pszName, DWORD dwSize)
+{
+    char Buffer[4096];
+    DWORD i, j, cb, cbWritten;
+    HANDLE hFile;
+
+    hFile = CreateFileA(pszName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    for (i = 0; i < dwSize; i += cb)
+    {
+        cb = min(dwSize - i, sizeof(Buffer));
+        for (j = 0; j < cb; j++)
+            Buffer[j] = TestByte(i + j, dwSize);
+        if (!WriteFile(hFile, Buffer, cb, &cbWritten, NULL) || cbWritten != cb)
+            break;
+    }
+
+    CloseHandle(hFile);
+    return i >= dwSize;
+}
+
+/* Checks the file holds dwCopies copies of the one CreateSizedFile made */
+static BOOL CheckSizedFile(const char *pszName, DWORD dwSize, DWORD dwCopies)
+{
+    char Buffer[4096];
+    DWORD i, j, cbRead;
+    HANDLE hFile;
+    BOOL bRet = TRUE;
+
+    hFile = CreateFileA(pszName, GENERIC_READ, 0, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    if (GetFileSize(hFile, NULL) != dwSize * dwCopies)
+        bRet = FALSE;
+
+    for (i = 0; bRet && i < dwSize * dwCopies; i += cbRead)
+    {
+        if (!ReadFile(hFile, Buffer, sizeof(Buffer), &cbRead, NULL) || !cbRead)
+        {
+            bRet = FALSE;
+            break;
+        }
+        for (j = 0; j < cbRead; j++)
+        {
+            if (Buffer[j] != TestByte((i + j) % dwSize, dwSize))
+            {
+                bRet = FALSE;
+                break;
+            }
+        }
+    }
+
+    CloseHandle(hFile);
+    return bRet;
+}
+
+static void TestBigCopy(INT line, DWORD dwSize, DWORD dwOldSize)
+{
+    DWORD dwExitCode;
+
+    if (!CreateSizedFile("copy-src.bin", dwSize))
+    {
+        skip("Line %d: Failed to create the source file\n", line);
+        DeleteFileA("copy-src.bin");
+        return;
+    }
+
+    /* Copy over an existing file, when asked to */
+    if (dwOldSize != (DWORD)-1 && !CreateSizedFile("copy-dst.bin", dwOldSize))
+        skip("Line %d: Failed to create the destination file\n", line);
+
+    dwExitCode = RunCmd("cmd /c copy /B /Y copy-src.bin copy-dst.bin", TIMEOUT);
+    ok(dwExitCode == 0, "Line %d: dwExitCode was %lu\n", line, dwExitCode);
+    ok(CheckSizedFile("copy-dst.bin", dwSize, 1),
+       "Line %d: copy-dst.bin is not a copy of %lu bytes\n", line, dwSize);
+
+    DeleteFileA("copy-dst.bin");
+    DeleteFileA("copy-src.bin");
+}
+
+static void TestBigAppend(void)
+{
+    DWORD dwExitCode;
+
+    if (!CreateSizedFile("copy-src.bin", 3 * BIG_SIZE + 123))
+    {
+        skip("Failed to create the source file\n");
+        DeleteFileA("copy-src.bin");
+        return;
+    }
+
+    /* The second file is written at the end of the first one */
+    dwExitCode = RunCmd("cmd /c copy /B copy-src.bin + copy-src.bin copy-dst.bin", TIMEOUT);
+    ok(dwExitCode == 0, "dwExitCode was %lu\n", dwExitCode);
+    ok(CheckSizedFile("copy-dst.bin", 3 * BIG_SIZE + 123, 2),
+       "copy-dst.bin is not the concatenation of the sources\n");
+
+    DeleteFileA("copy-dst.bin");
+    DeleteFileA("copy-src.bin");
+}
+
+/* Times the copy of a big file, compare with the same run of an older cmd */
+static void RunBenchmark(void)
+{
+    DWORD dwSize = 256 * 1024 * 1024, dwStart, dwExitCode;
+
+    if (!CreateSizedFile("copy-src.bin", dwSize))
+    {
+        skip("Failed to create the benchmark file\n");
+        DeleteFileA("copy-src.bin");
+        return;
+    }
+
+    dwStart = GetTickCount();
+    dwExitCode = RunCmd("cmd /c copy /B /Y copy-src.bin copy-dst.bin", INFINITE);
+    trace("copy of %lu MB: %lu ms\n", dwSize >> 20, GetTickCount() - dwStart);
+    ok(dwExitCode == 0, "dwExitCode was %lu\n", dwExitCode);
+    ok(CheckSizedFile("copy-dst.bin", dwSize, 1), "copy-dst.bin is not a copy\n");
+
+    DeleteFileA("copy-dst.bin");
+    DeleteFileA("copy-src.bin");
+}
+
+START_TEST(copy)
+{
+    /* Below, at and above the size where the overlapped copy starts */
+    TestBigCopy(__LINE__, BIG_SIZE - 1, (DWORD)-1);
+    TestBigCopy(__LINE__, BIG_SIZE, (DWORD)-1);
+    TestBigCopy(__LINE__, BIG_SIZE + 1, (DWORD)-1);
+    TestBigCopy(__LINE__, 2 * BIG_SIZE, (DWORD)-1);
+    TestBigCopy(__LINE__, 3 * BIG_SIZE + 123, (DWORD)-1);
+
+    /* Over a smaller and a bigger file, which must be trimmed */
+    TestBigCopy(__LINE__, 3 * BIG_SIZE + 123, 10);
+    TestBigCopy(__LINE__, 3 * BIG_SIZE + 123, 5 * BIG_SIZE);
+
+    TestBigAppend();
+
+    if (winetest_interactive)
+        RunBenchmark();
+}
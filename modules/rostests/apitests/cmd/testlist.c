@@ -3,16 +3,22 @@
 
 extern void func_attrib(void);
 extern void func_cd(void);
+extern void func_copy(void);
 extern void func_echo(void);
 extern void func_exit(void);
+extern void func_find(void);
+extern void func_findstr(void);
 extern void func_pushd(void);
 
 const struct test winetest_testlist[] =
 {
     { "attrib", func_attrib },
     { "cd", func_cd },
+    { "copy", func_copy },
     { "echo", func_echo },
     { "exit", func_exit },
+    { "find", func_find },
+    { "findstr", func_findstr },
     { "pushd", func_pushd },
     { 0, 0 }
 };
@@ -723,6 +723,35 @@ void TestHostName(void)
     if (dp != InvalidPointer && dns_status == NO_ERROR) DnsRecordListFree(dp, DnsFreeRecordList);
 }
 
+void TestNegativeCache(void)
+{
+    DNS_STATUS dns_status;
+    PDNS_RECORD dp;
+
+    dp = InvalidPointer;
+    dns_status = DnsQuery_W(L"nonexistent.invalid", DNS_TYPE_A, DNS_QUERY_STANDARD, 0, &dp, 0);
+    if (dns_status != DNS_ERROR_RCODE_NAME_ERROR)
+    {
+        skip("DnsQuery_W returned %lu, no DNS server to answer\n", dns_status);
+        if (dp != InvalidPointer && dns_status == NO_ERROR) DnsRecordListFree(dp, DnsFreeRecordList);
+        return;
+    }
+    ok(dp == NULL || broken(dp == InvalidPointer), "dp = %p\n", dp);
+
+    /* The resolver remembers that the name doesn't exist */
+    dp = InvalidPointer;
+    dns_status = DnsQuery_W(L"nonexistent.invalid", DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, 0, &dp, 0);
+    ok(dns_status == DNS_ERROR_RCODE_NAME_ERROR, "DnsQuery_W wrong status %lu expected %u\n", dns_status, DNS_ERROR_RCODE_NAME_ERROR);
+    ok(dp == NULL || broken(dp == InvalidPointer), "dp = %p\n", dp);
+    if (dp != InvalidPointer && dns_status == NO_ERROR) DnsRecordListFree(dp, DnsFreeRecordList);
+
+    /* Names are compared without case */
+    dp = InvalidPointer;
+    dns_status = DnsQuery_W(L"NonExistent.Invalid", DNS_TYPE_A, DNS_QUERY_NO_WIRE_QUERY, 0, &dp, 0);
+    ok(dns_status == DNS_ERROR_RCODE_NAME_ERROR, "DnsQuery_W wrong status %lu expected %u\n", dns_status, DNS_ERROR_RCODE_NAME_ERROR);
+    if (dp != InvalidPointer && dns_status == NO_ERROR) DnsRecordListFree(dp, DnsFreeRecordList);
+}
+
 START_TEST(DnsQuery)
 {
     WSADATA wsaData;
@@ -735,6 +764,7 @@ START_TEST(DnsQuery)
 
     // Tests
     TestHostName();
+    TestNegativeCache();
 
     WSACleanup();
 
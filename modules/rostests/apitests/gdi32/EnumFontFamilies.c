@@ -184,6 +184,70 @@ TestEnumFontFamilies(
     }
 }
 
+static
+int
+CALLBACK
+CountProcW(
+    _In_ const LOGFONTW *elf,
+    _In_ const TEXTMETRICW *ntm,
+    _In_ DWORD FontType,
+    _In_ LPARAM lParam)
+{
+    (*(int *)lParam)++;
+    return 1;
+}
+
+static
+void
+BenchmarkEnumFontFamilies(
+    _In_ HDC hdc)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    LOGFONTW lf;
+    HFONT hFont, hOldFont;
+    TEXTMETRICW tm;
+    int Count, i;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    ZeroMemory(&lf, sizeof(lf));
+    lf.lfCharSet = DEFAULT_CHARSET;
+
+    /* All the fonts */
+    Count = 0;
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < 100; i++)
+        EnumFontFamiliesExW(hdc, &lf, CountProcW, (LPARAM)&Count, 0);
+    QueryPerformanceCounter(&End);
+    trace("100 EnumFontFamiliesExW of all %d fonts: %lu ms\n", Count / 100,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+    /* One face name */
+    wcscpy(lf.lfFaceName, L"Tahoma");
+    Count = 0;
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < 1000; i++)
+        EnumFontFamiliesExW(hdc, &lf, CountProcW, (LPARAM)&Count, 0);
+    QueryPerformanceCounter(&End);
+    trace("1000 EnumFontFamiliesExW of '%ls': %lu ms\n", lf.lfFaceName,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+    /* Font matching */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < 1000; i++)
+    {
+        lf.lfHeight = -(8 + i % 16);
+        hFont = CreateFontIndirectW(&lf);
+        hOldFont = SelectObject(hdc, hFont);
+        GetTextMetricsW(hdc, &tm);
+        SelectObject(hdc, hOldFont);
+        DeleteObject(hFont);
+    }
+    QueryPerformanceCounter(&End);
+    trace("1000 font realizations of '%ls': %lu ms\n", lf.lfFaceName,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+}
+
 START_TEST(EnumFontFamilies)
 {
     HDC hdc;
@@ -207,6 +271,8 @@ START_TEST(EnumFontFamilies)
     TestEnumFontFamilies(hdc, L"Symbol", TRUE);
     TestEnumFontFamilies(hdc, L"VGA", FALSE);
 
+    BenchmarkEnumFontFamilies(hdc);
+
     DeleteDC(hdc);
 }
 
@@ -0,0 +1,138 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for GDI batching of drawing primitives
+ * PROGRAMMERS:
+ */
+
+#include "precomp.h"
+
+#include <ndk/rtlfuncs.h>
+
+#define BENCH_COUNT 20000
+
+static HDC hdcTarget;
+static HBITMAP hbmpTarget, hbmpOld;
+
+/* Returns TRUE if the call was queued in the TEB batch instead of entering win32k */
+#define IS_BATCHED(_call) \
+    (GdiFlush(), (_call), NtCurrentTeb()->GdiBatchCount == 1)
+
+static void Test_Batched(void)
+{
+    POINT apt[3] = { { 10, 20 }, { 30, 20 }, { 30, 40 } };
+    HPEN hpen, hpenOld;
+    HBRUSH hbr, hbrOld;
+    POINT pt;
+
+    ok(IS_BATCHED(SetPixelV(hdcTarget, 1, 1, RGB(255, 0, 0))), "SetPixelV was not batched\n");
+    ok(IS_BATCHED(LineTo(hdcTarget, 5, 0)), "LineTo was not batched\n");
+    ok(IS_BATCHED(Rectangle(hdcTarget, 0, 0, 2, 2)), "Rectangle was not batched\n");
+    ok(IS_BATCHED(Polyline(hdcTarget, apt, 3)), "Polyline was not batched\n");
+    ok(IS_BATCHED(PatBlt(hdcTarget, 0, 0, 1, 1, PATCOPY)), "PatBlt was not batched\n");
+    GdiFlush();
+
+    /* Draw with batched commands, then change the objects before the flush */
+    PatBlt(hdcTarget, 0, 0, 64, 64, WHITENESS);
+    hpen = CreatePen(PS_SOLID, 1, RGB(0, 0, 255));
+    hbr = CreateSolidBrush(RGB(0, 255, 0));
+    hpenOld = SelectObject(hdcTarget, hpen);
+    hbrOld = SelectObject(hdcTarget, hbr);
+
+    SetPixelV(hdcTarget, 50, 50, RGB(255, 0, 0));
+    MoveToEx(hdcTarget, 0, 10, NULL);
+    LineTo(hdcTarget, 20, 10);
+    Rectangle(hdcTarget, 30, 30, 40, 40);
+    Polyline(hdcTarget, apt, 3);
+
+    SelectObject(hdcTarget, hpenOld);
+    SelectObject(hdcTarget, hbrOld);
+    ok(NtCurrentTeb()->GdiBatchCount > 0, "Nothing was batched\n");
+
+    /* The current position was moved by the batched LineTo */
+    GetCurrentPositionEx(hdcTarget, &pt);
+    ok_long(pt.x, 20);
+    ok_long(pt.y, 10);
+
+    /* GetPixel flushes the batch */
+    ok_long(GetPixel(hdcTarget, 50, 50), RGB(255, 0, 0));
+    ok_long(NtCurrentTeb()->GdiBatchCount, 0);
+    ok_long(GetPixel(hdcTarget, 5, 10), RGB(0, 0, 255));
+    ok_long(GetPixel(hdcTarget, 30, 35), RGB(0, 0, 255));
+    ok_long(GetPixel(hdcTarget, 35, 35), RGB(0, 255, 0));
+    ok_long(GetPixel(hdcTarget, 20, 20), RGB(0, 0, 255));
+
+    /* The pen selected after the commands were queued is used for new ones */
+    PatBlt(hdcTarget, 0, 0, 64, 64, WHITENESS);
+    LineTo(hdcTarget, 20, 12);
+    ok_long(GetPixel(hdcTarget, 20, 11), RGB(0, 0, 0));
+
+    DeleteObject(hpen);
+    DeleteObject(hbr);
+}
+
+static void Test_Benchmark(void)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONG cBatched = 0, cFlushes = 0, LastCount = 0;
+    int i;
+
+    QueryPerformanceFrequency(&Frequency);
+    GdiFlush();
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_COUNT; i++)
+    {
+        switch (i & 3)
+        {
+            case 0: MoveToEx(hdcTarget, i & 63, 0, NULL); LineTo(hdcTarget, 63 - (i & 63), 63); break;
+            case 1: Rectangle(hdcTarget, i & 31, i & 31, 32 + (i & 31), 32 + (i & 31)); break;
+            case 2: SetPixelV(hdcTarget, i & 63, (i >> 6) & 63, RGB(i, i >> 8, 0)); break;
+            case 3: PatBlt(hdcTarget, i & 63, 0, 1, 64, PATINVERT); break;
+        }
+
+        /* Every drop of the batch count is a transition to win32k */
+        if (NtCurrentTeb()->GdiBatchCount > LastCount)
+            cBatched++;
+        else
+            cFlushes++;
+        LastCount = NtCurrentTeb()->GdiBatchCount;
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+
+    trace("%d primitives: %lu batched, %lu kernel transitions, %lu ms\n",
+          BENCH_COUNT, cBatched, cFlushes,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+    ok(cFlushes < BENCH_COUNT / 4, "Too many kernel transitions: %lu\n", cFlushes);
+}
+
+START_TEST(GdiBatch)
+{
+    HDC hdcScreen;
+
+    /* Batching is disabled for DIB sections, use a device dependent bitmap */
+    hdcScreen = GetDC(NULL);
+    hdcTarget = CreateCompatibleDC(hdcScreen);
+    hbmpTarget = CreateCompatibleBitmap(hdcScreen, 64, 64);
+    ReleaseDC(NULL, hdcScreen);
+    ok(hdcTarget != NULL, "CreateCompatibleDC failed\n");
+    ok(hbmpTarget != NULL, "CreateCompatibleBitmap failed\n");
+    if (!hdcTarget || !hbmpTarget)
+        return;
+
+    hbmpOld = SelectObject(hdcTarget, hbmpTarget);
+    if (GetDeviceCaps(hdcTarget, BITSPIXEL) < 24)
+    {
+        skip("Need a true color display\n");
+    }
+    else
+    {
+        Test_Batched();
+        Test_Benchmark();
+    }
+
+    SelectObject(hdcTarget, hbmpOld);
+    DeleteObject(hbmpTarget);
+    DeleteDC(hdcTarget);
+}
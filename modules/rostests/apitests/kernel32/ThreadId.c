@@ -0,0 +1,175 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for the reuse of thread IDs
+ */
+#include "precomp.h"
+
+#define FREED_COUNT         64
+#define STRESS_BATCH        16
+#define STRESS_ROUNDS       200
+#define MAX_LIVE_IDS        (MAXIMUM_PROCESSORS * STRESS_BATCH)
+
+static CRITICAL_SECTION s_LiveLock;
+static DWORD s_LiveIds[MAX_LIVE_IDS];
+static LONG s_Duplicates;
+
+static DWORD WINAPI EmptyThread(LPVOID Parameter)
+{
+    return 0;
+}
+
+static DWORD RunThread(void)
+{
+    HANDLE Thread;
+    DWORD ThreadId;
+
+    Thread = CreateThread(NULL, 0, EmptyThread, NULL, 0, &ThreadId);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (!Thread) return 0;
+
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+
+    /* Let the reaper drop its reference, which frees the ID */
+    Sleep(10);
+    return ThreadId;
+}
+
+static void TestReuseOrder(void)
+{
+    DWORD Freed[FREED_COUNT], ThreadId;
+    INT i, j, Last = -1, Reused = 0, OutOfOrder = 0;
+
+    /* Free a series of IDs, one after the other */
+    for (i = 0; i < FREED_COUNT; i++)
+    {
+        Freed[i] = RunThread();
+    }
+
+    /* IDs handed out again must come back in the order they were freed */
+    for (i = 0; i < FREED_COUNT; i++)
+    {
+        ThreadId = RunThread();
+
+        for (j = 0; j < FREED_COUNT; j++)
+        {
+            if (Freed[j] != ThreadId) continue;
+
+            Reused++;
+            if (j < Last) OutOfOrder++;
+            Last = j;
+            break;
+        }
+    }
+
+    ok(OutOfOrder == 0, "%d of %d reused IDs came back out of order\n", OutOfOrder, Reused);
+    trace("%d of %d freed IDs were reused\n", Reused, FREED_COUNT);
+}
+
+static void AddLiveId(DWORD ThreadId)
+{
+    ULONG i, Free = MAX_LIVE_IDS;
+
+    EnterCriticalSection(&s_LiveLock);
+    for (i = 0; i < MAX_LIVE_IDS; i++)
+    {
+        if (s_LiveIds[i] == ThreadId) InterlockedIncrement(&s_Duplicates);
+        if (!s_LiveIds[i] && Free == MAX_LIVE_IDS) Free = i;
+    }
+    if (Free < MAX_LIVE_IDS) s_LiveIds[Free] = ThreadId;
+    LeaveCriticalSection(&s_LiveLock);
+}
+
+static void RemoveLiveId(DWORD ThreadId)
+{
+    ULONG i;
+
+    EnterCriticalSection(&s_LiveLock);
+    for (i = 0; i < MAX_LIVE_IDS; i++)
+    {
+        if (s_LiveIds[i] == ThreadId)
+        {
+            s_LiveIds[i] = 0;
+            break;
+        }
+    }
+    LeaveCriticalSection(&s_LiveLock);
+}
+
+static DWORD WINAPI StressThread(LPVOID Parameter)
+{
+    HANDLE Threads[STRESS_BATCH];
+    DWORD ThreadIds[STRESS_BATCH];
+    ULONG Round, i, Failures = 0;
+
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)Parameter);
+
+    for (Round = 0; Round < STRESS_ROUNDS; Round++)
+    {
+        /* Create a batch, every ID must be unique while the thread lives */
+        for (i = 0; i < STRESS_BATCH; i++)
+        {
+            Threads[i] = CreateThread(NULL, 0, EmptyThread, NULL, CREATE_SUSPENDED, &ThreadIds[i]);
+            if (!Threads[i])
+            {
+                Failures++;
+                continue;
+            }
+            AddLiveId(ThreadIds[i]);
+        }
+
+        /* Now let them exit and free the IDs, in a different order */
+        for (i = STRESS_BATCH; i-- > 0;)
+        {
+            if (!Threads[i]) continue;
+            ResumeThread(Threads[i]);
+            WaitForSingleObject(Threads[i], INFINITE);
+            RemoveLiveId(ThreadIds[i]);
+            CloseHandle(Threads[i]);
+        }
+    }
+
+    return Failures;
+}
+
+static void TestStress(void)
+{
+    HANDLE Threads[MAXIMUM_WAIT_OBJECTS];
+    SYSTEM_INFO SystemInfo;
+    DWORD i, Count, Failures;
+
+    GetSystemInfo(&SystemInfo);
+    Count = min(SystemInfo.dwNumberOfProcessors, MAXIMUM_WAIT_OBJECTS);
+    if (Count == 1)
+        trace("Only one processor, the stress test won't run in parallel\n");
+
+    InitializeCriticalSection(&s_LiveLock);
+    ZeroMemory(s_LiveIds, sizeof(s_LiveIds));
+    s_Duplicates = 0;
+
+    /* One creator per processor */
+    for (i = 0; i < Count; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, StressThread, (LPVOID)((DWORD_PTR)1 << i), 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (!Threads[i]) Count = i;
+    }
+
+    WaitForMultipleObjects(Count, Threads, TRUE, INFINITE);
+    for (i = 0; i < Count; i++)
+    {
+        ok(GetExitCodeThread(Threads[i], &Failures), "GetExitCodeThread failed\n");
+        ok(Failures == 0, "Creator %lu failed to create %lu threads\n", i, Failures);
+        CloseHandle(Threads[i]);
+    }
+
+    ok(s_Duplicates == 0, "%ld IDs were handed out twice\n", s_Duplicates);
+    DeleteCriticalSection(&s_LiveLock);
+}
+
+START_TEST(ThreadId)
+{
+    TestReuseOrder();
+    TestStress();
+}
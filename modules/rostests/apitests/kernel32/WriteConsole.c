@@ -0,0 +1,151 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for WriteConsole with buffers of various sizes
+ */
+
+#include "precomp.h"
+
+#define BUFFER_WIDTH        80
+#define BUFFER_HEIGHT       300
+#define BENCHMARK_SIZE      (16 * 1024)
+#define BENCHMARK_WRITES    200
+
+static
+VOID
+FillText(
+    _Out_writes_(Count) PWCHAR Text,
+    _In_ DWORD Count,
+    _In_ DWORD Seed)
+{
+    DWORD i;
+
+    for (i = 0; i < Count; i++)
+        Text[i] = L'A' + (WCHAR)((i + Seed) % 26);
+}
+
+static
+VOID
+CheckWrite(
+    _In_ HANDLE Output,
+    _In_ DWORD Count,
+    _In_ BOOL Unicode)
+{
+    COORD Origin = {0, 0};
+    PWCHAR Text, ReadBack;
+    PCHAR AnsiText;
+    DWORD Written, Read, i;
+    BOOL Success;
+
+    Text = HeapAlloc(GetProcessHeap(), 0, Count * sizeof(WCHAR));
+    ReadBack = HeapAlloc(GetProcessHeap(), 0, Count * sizeof(WCHAR));
+    AnsiText = HeapAlloc(GetProcessHeap(), 0, Count);
+    if (!Text || !ReadBack || !AnsiText)
+    {
+        skip("Out of memory\n");
+        goto Quit;
+    }
+
+    FillText(Text, Count, Count);
+    for (i = 0; i < Count; i++)
+        AnsiText[i] = (CHAR)Text[i];
+
+    ok(SetConsoleCursorPosition(Output, Origin),
+       "SetConsoleCursorPosition failed, error %lu\n", GetLastError());
+
+    Written = 0;
+    if (Unicode)
+        Success = WriteConsoleW(Output, Text, Count, &Written, NULL);
+    else
+        Success = WriteConsoleA(Output, AnsiText, Count, &Written, NULL);
+    ok(Success, "WriteConsole(%lu, %d) failed, error %lu\n", Count, Unicode, GetLastError());
+    ok(Written == Count, "WriteConsole(%lu, %d) wrote %lu characters\n", Count, Unicode, Written);
+
+    /* Everything must have reached the screen buffer, in order */
+    Read = 0;
+    ok(ReadConsoleOutputCharacterW(Output, ReadBack, Count, Origin, &Read),
+       "ReadConsoleOutputCharacterW failed, error %lu\n", GetLastError());
+    ok(Read == Count, "Read %lu characters instead of %lu\n", Read, Count);
+    ok(!memcmp(Text, ReadBack, Read * sizeof(WCHAR)),
+       "WriteConsole(%lu, %d) output mismatch\n", Count, Unicode);
+
+Quit:
+    HeapFree(GetProcessHeap(), 0, AnsiText);
+    HeapFree(GetProcessHeap(), 0, ReadBack);
+    HeapFree(GetProcessHeap(), 0, Text);
+}
+
+static
+VOID
+BenchmarkWrites(
+    _In_ HANDLE Output)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    COORD Origin = {0, 0};
+    PWCHAR Text;
+    DWORD Written, i, Failures = 0;
+    ULONGLONG Elapsed;
+
+    Text = HeapAlloc(GetProcessHeap(), 0, BENCHMARK_SIZE * sizeof(WCHAR));
+    if (!Text)
+    {
+        skip("Out of memory\n");
+        return;
+    }
+    FillText(Text, BENCHMARK_SIZE, 0);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCHMARK_WRITES; i++)
+    {
+        SetConsoleCursorPosition(Output, Origin);
+        if (!WriteConsoleW(Output, Text, BENCHMARK_SIZE, &Written, NULL) ||
+            Written != BENCHMARK_SIZE)
+        {
+            Failures++;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    ok_long(Failures, 0);
+    Elapsed = (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+    trace("%u writes of %u characters in %I64u us (%I64u KB/s)\n",
+          BENCHMARK_WRITES, BENCHMARK_SIZE, Elapsed,
+          Elapsed ? (ULONGLONG)BENCHMARK_WRITES * BENCHMARK_SIZE * sizeof(WCHAR) * 1000000 / 1024 / Elapsed : 0);
+
+    HeapFree(GetProcessHeap(), 0, Text);
+}
+
+START_TEST(WriteConsole)
+{
+    static const DWORD Sizes[] = {16, 1024, 4 * 1024, BENCHMARK_SIZE};
+    COORD Size = {BUFFER_WIDTH, BUFFER_HEIGHT};
+    HANDLE Output;
+    DWORD i;
+
+    Output = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                       NULL,
+                                       CONSOLE_TEXTMODE_BUFFER,
+                                       NULL);
+    if (Output == INVALID_HANDLE_VALUE)
+    {
+        skip("No console, error %lu\n", GetLastError());
+        return;
+    }
+
+    /* Make room for the largest write, without wrapping to the top */
+    ok(SetConsoleScreenBufferSize(Output, Size),
+       "SetConsoleScreenBufferSize failed, error %lu\n", GetLastError());
+
+    /* Small writes fit in the message, larger ones go through a capture buffer */
+    for (i = 0; i < ARRAYSIZE(Sizes); i++)
+    {
+        CheckWrite(Output, Sizes[i], FALSE);
+        CheckWrite(Output, Sizes[i], TRUE);
+    }
+
+    BenchmarkWrites(Output);
+
+    CloseHandle(Output);
+}
@@ -34,8 +34,10 @@ extern void func_SetCurrentDirectory(void);
 extern void func_SetUnhandledExceptionFilter(void);
 extern void func_SystemFirmware(void);
 extern void func_TerminateProcess(void);
+extern void func_ThreadId(void);
 extern void func_TunnelCache(void);
 extern void func_WideCharToMultiByte(void);
+extern void func_WriteConsole(void);
 
 const struct test winetest_testlist[] =
 {
@@ -69,8 +71,10 @@ const struct test winetest_testlist[] =
     { "SetUnhandledExceptionFilter", func_SetUnhandledExceptionFilter },
     { "SystemFirmware",              func_SystemFirmware },
     { "TerminateProcess",            func_TerminateProcess },
+    { "ThreadId",                    func_ThreadId },
     { "TunnelCache",                 func_TunnelCache },
     { "WideCharToMultiByte",         func_WideCharToMultiByte },
+    { "WriteConsole",                func_WriteConsole },
     { "ActCtxWithXmlNamespaces",     func_ActCtxWithXmlNamespaces },
     { 0, 0 }
 };
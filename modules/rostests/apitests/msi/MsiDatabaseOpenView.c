@@ -0,0 +1,290 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for key lookups and joins on large MSI tables
+ */
+
+#include <apitest.h>
+#include <stdio.h>
+#include <msi.h>
+#include <msiquery.h>
+
+#define FEATURE_COUNT       2000
+#define COMPONENTS_PER_FEATURE 4
+#define BENCHMARK_LOOKUPS   2000
+
+static CHAR DatabasePath[MAX_PATH];
+
+static
+UINT
+RunQuery(
+    _In_ MSIHANDLE Database,
+    _In_ PCSTR Query,
+    _In_opt_ MSIHANDLE Record)
+{
+    MSIHANDLE View;
+    UINT Error;
+
+    Error = MsiDatabaseOpenViewA(Database, Query, &View);
+    if (Error != ERROR_SUCCESS)
+        return Error;
+
+    Error = MsiViewExecute(View, Record);
+    MsiViewClose(View);
+    MsiCloseHandle(View);
+    return Error;
+}
+
+static
+UINT
+CountRows(
+    _In_ MSIHANDLE Database,
+    _In_ PCSTR Query,
+    _Out_opt_ MSIHANDLE *LastRecord)
+{
+    MSIHANDLE View, Record;
+    UINT Count = 0;
+
+    if (LastRecord)
+        *LastRecord = 0;
+
+    if (MsiDatabaseOpenViewA(Database, Query, &View) != ERROR_SUCCESS)
+        return (UINT)-1;
+
+    if (MsiViewExecute(View, 0) == ERROR_SUCCESS)
+    {
+        while (MsiViewFetch(View, &Record) == ERROR_SUCCESS)
+        {
+            Count++;
+            if (LastRecord)
+            {
+                if (*LastRecord)
+                    MsiCloseHandle(*LastRecord);
+                *LastRecord = Record;
+            }
+            else
+            {
+                MsiCloseHandle(Record);
+            }
+        }
+    }
+
+    MsiViewClose(View);
+    MsiCloseHandle(View);
+    return Count;
+}
+
+static
+UINT
+InsertFeature(
+    _In_ MSIHANDLE Database,
+    _In_ UINT Index)
+{
+    MSIHANDLE Record;
+    CHAR Name[16];
+    UINT Error;
+
+    sprintf(Name, "F%05u", Index);
+    Record = MsiCreateRecord(3);
+    MsiRecordSetStringA(Record, 1, Name);
+    MsiRecordSetInteger(Record, 2, Index % 7);
+    MsiRecordSetInteger(Record, 3, Index * 10);
+    Error = RunQuery(Database,
+                     "INSERT INTO `Feature` (`Feature`, `Level`, `Rank`) VALUES (?, ?, ?)",
+                     Record);
+    MsiCloseHandle(Record);
+    return Error;
+}
+
+static
+BOOL
+FillDatabase(
+    _In_ MSIHANDLE Database)
+{
+    MSIHANDLE Record;
+    CHAR Name[16], Feature[16];
+    UINT i, Failures = 0;
+
+    if (RunQuery(Database,
+                 "CREATE TABLE `Feature` (`Feature` CHAR(72) NOT NULL, `Level` SHORT, "
+                 "`Rank` LONG PRIMARY KEY `Feature`)", 0) != ERROR_SUCCESS ||
+        RunQuery(Database,
+                 "CREATE TABLE `Component` (`Component` CHAR(72) NOT NULL, "
+                 "`Feature_` CHAR(72), `Size` LONG PRIMARY KEY `Component`)", 0) != ERROR_SUCCESS)
+    {
+        return FALSE;
+    }
+
+    /* Insert backwards, so that every row goes before the existing ones */
+    for (i = FEATURE_COUNT; i-- > 0;)
+    {
+        if (InsertFeature(Database, i) != ERROR_SUCCESS)
+            Failures++;
+    }
+
+    for (i = 0; i < FEATURE_COUNT * COMPONENTS_PER_FEATURE; i++)
+    {
+        sprintf(Name, "C%05u", i);
+        sprintf(Feature, "F%05u", i % FEATURE_COUNT);
+        Record = MsiCreateRecord(3);
+        MsiRecordSetStringA(Record, 1, Name);
+        MsiRecordSetStringA(Record, 2, Feature);
+        MsiRecordSetInteger(Record, 3, i);
+        if (RunQuery(Database,
+                     "INSERT INTO `Component` (`Component`, `Feature_`, `Size`) VALUES (?, ?, ?)",
+                     Record) != ERROR_SUCCESS)
+        {
+            Failures++;
+        }
+        MsiCloseHandle(Record);
+    }
+
+    ok(Failures == 0, "%u inserts failed\n", Failures);
+    return TRUE;
+}
+
+static
+VOID
+TestLookups(
+    _In_ MSIHANDLE Database)
+{
+    MSIHANDLE Record;
+    CHAR Query[256];
+    UINT Count;
+
+    /* The keys must still be unique */
+    ok_int(InsertFeature(Database, 1234), ERROR_FUNCTION_FAILED);
+    ok_int(InsertFeature(Database, 0), ERROR_FUNCTION_FAILED);
+    ok_int(InsertFeature(Database, FEATURE_COUNT - 1), ERROR_FUNCTION_FAILED);
+
+    Count = CountRows(Database, "SELECT `Rank` FROM `Feature` WHERE `Feature` = 'F01234'", &Record);
+    ok_int(Count, 1);
+    if (Record)
+    {
+        ok_int(MsiRecordGetInteger(Record, 1), 12340);
+        MsiCloseHandle(Record);
+    }
+
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Feature` = 'nonexistent'", NULL), 0);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Feature` = 'F00010' AND `Level` = 3", NULL), 1);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Feature` = 'F00010' AND `Level` = 4", NULL), 0);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Rank` = 500", NULL), 1);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Rank` = 505", NULL), 0);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Level` = 2", NULL),
+           (FEATURE_COUNT + 4) / 7);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Level` = 2 OR `Rank` = 0", NULL),
+           (FEATURE_COUNT + 4) / 7 + 1);
+
+    /* Equi-joins, in both directions and with a constant on either side */
+    ok_int(CountRows(Database,
+                     "SELECT `Component`.`Component`, `Feature`.`Rank` FROM `Component`, `Feature` "
+                     "WHERE `Component`.`Feature_` = `Feature`.`Feature`", NULL),
+           FEATURE_COUNT * COMPONENTS_PER_FEATURE);
+    ok_int(CountRows(Database,
+                     "SELECT `Component`.`Component` FROM `Feature`, `Component` "
+                     "WHERE `Feature`.`Feature` = `Component`.`Feature_` AND `Feature`.`Level` = 0", NULL),
+           ((FEATURE_COUNT + 6) / 7) * COMPONENTS_PER_FEATURE);
+
+    sprintf(Query,
+            "SELECT `Feature`.`Rank` FROM `Component`, `Feature` "
+            "WHERE `Component`.`Component` = 'C%05u' AND `Feature`.`Feature` = `Component`.`Feature_`",
+            FEATURE_COUNT + 7);
+    Count = CountRows(Database, Query, &Record);
+    ok_int(Count, 1);
+    if (Record)
+    {
+        ok_int(MsiRecordGetInteger(Record, 1), 70);
+        MsiCloseHandle(Record);
+    }
+
+    /* Integer columns joined to each other */
+    ok_int(CountRows(Database,
+                     "SELECT `Component`.`Component` FROM `Component`, `Feature` "
+                     "WHERE `Component`.`Size` = `Feature`.`Rank`", NULL),
+           FEATURE_COUNT * COMPONENTS_PER_FEATURE / 10);
+
+    /* Deleted keys are gone from the index, the other ones are still found */
+    ok_int(RunQuery(Database, "DELETE FROM `Feature` WHERE `Level` = 1", 0), ERROR_SUCCESS);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Feature` = 'F00008'", NULL), 0);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Feature` = 'F00009'", NULL), 1);
+    ok_int(InsertFeature(Database, 8), ERROR_SUCCESS);
+    ok_int(InsertFeature(Database, 8), ERROR_FUNCTION_FAILED);
+    ok_int(InsertFeature(Database, 9), ERROR_FUNCTION_FAILED);
+    ok_int(InsertFeature(Database, 15), ERROR_SUCCESS);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature` WHERE `Feature` = 'F00015'", NULL), 1);
+    ok_int(CountRows(Database, "SELECT * FROM `Feature`", NULL),
+           FEATURE_COUNT - (FEATURE_COUNT + 5) / 7 + 2);
+}
+
+static
+VOID
+BenchmarkLookups(
+    _In_ MSIHANDLE Database)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    CHAR Query[256];
+    UINT i, Failures = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCHMARK_LOOKUPS; i++)
+    {
+        sprintf(Query, "SELECT * FROM `Component` WHERE `Component` = 'C%05u'",
+                (i * 7919) % (FEATURE_COUNT * COMPONENTS_PER_FEATURE));
+        if (CountRows(Database, Query, NULL) != 1)
+            Failures++;
+    }
+    QueryPerformanceCounter(&End);
+    ok_int(Failures, 0);
+    trace("%u key lookups in %I64u us\n", BENCHMARK_LOOKUPS,
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart);
+
+    QueryPerformanceCounter(&Start);
+    ok_int(CountRows(Database,
+                     "SELECT `Component`.`Component`, `Feature`.`Rank` FROM `Component`, `Feature` "
+                     "WHERE `Component`.`Feature_` = `Feature`.`Feature`", NULL),
+           (FEATURE_COUNT - (FEATURE_COUNT + 5) / 7 + 2) * COMPONENTS_PER_FEATURE);
+    QueryPerformanceCounter(&End);
+    trace("join of %u x %u rows in %I64u us\n",
+          FEATURE_COUNT * COMPONENTS_PER_FEATURE, FEATURE_COUNT,
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart);
+}
+
+START_TEST(MsiDatabaseOpenView)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    CHAR TempPath[MAX_PATH];
+    MSIHANDLE Database;
+    UINT Error;
+
+    GetTempPathA(ARRAYSIZE(TempPath), TempPath);
+    GetTempFileNameA(TempPath, "msi", 0, DatabasePath);
+    DeleteFileA(DatabasePath);
+
+    Error = MsiOpenDatabaseA(DatabasePath, MSIDBOPEN_CREATE, &Database);
+    if (Error != ERROR_SUCCESS)
+    {
+        skip("MsiOpenDatabaseA failed, error %u\n", Error);
+        return;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    if (!FillDatabase(Database))
+    {
+        skip("Unable to create the tables\n");
+        goto Quit;
+    }
+    QueryPerformanceCounter(&End);
+    trace("filled %u rows in %I64u us\n",
+          FEATURE_COUNT * (COMPONENTS_PER_FEATURE + 1),
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart);
+
+    TestLookups(Database);
+    BenchmarkLookups(Database);
+
+Quit:
+    MsiCloseHandle(Database);
+    DeleteFileA(DatabasePath);
+}
@@ -0,0 +1,10 @@
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_MsiDatabaseOpenView(void);
+
+const struct test winetest_testlist[] =
+{
+    { "MsiDatabaseOpenView", func_MsiDatabaseOpenView },
+    { 0, 0 }
+};
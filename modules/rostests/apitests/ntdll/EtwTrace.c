@@ -0,0 +1,540 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for event trace sessions and kernel events
+ * PROGRAMMERS:
+ */
+
+#include "precomp.h"
+
+#include <winioctl.h>
+#include <wmistr.h>
+#include <evntrace.h>
+#include <wmiioctl.h>
+
+#define EVENT_COUNT 100000
+
+#define WORKLOAD_RUNS 7
+#define WORKLOAD_SWITCHES 5000
+#define WORKLOAD_PAGES 1024
+#define WORKLOAD_FILE_SIZE (1024 * 1024)
+#define WORKLOAD_IO_SIZE (64 * 1024)
+
+/* {7E4A4F64-6E1D-4C6B-9B43-2B1A7C3A5E10} */
+static const GUID ProviderGuid = { 0x7e4a4f64, 0x6e1d, 0x4c6b, { 0x9b, 0x43, 0x2b, 0x1a, 0x7c, 0x3a, 0x5e, 0x10 } };
+
+typedef struct _SESSION_PROPERTIES
+{
+    EVENT_TRACE_PROPERTIES Properties;
+    WCHAR LoggerName[64];
+    WCHAR LogFileName[MAX_PATH];
+} SESSION_PROPERTIES;
+
+typedef struct _TEST_EVENT
+{
+    EVENT_TRACE_HEADER Header;
+    ULONG Sequence;
+    ULONG Magic;
+} TEST_EVENT;
+
+/* Kernel event classes, see wmiioctl.h */
+static const GUID KernelSystemTraceGuid = { 0x9e814aad, 0x3204, 0x11d2, { 0x9a, 0x82, 0x00, 0x60, 0x08, 0xa8, 0x69, 0x39 } };
+static const GUID KernelThreadGuid = { 0x3d6fa8d1, 0xfe05, 0x11d0, { 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c } };
+static const GUID KernelPageFaultGuid = { 0x3d6fa8d3, 0xfe05, 0x11d0, { 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c } };
+static const GUID KernelDiskIoGuid = { 0x3d6fa8d4, 0xfe05, 0x11d0, { 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c } };
+
+#define KERNEL_TRACE_FLAGS (EVENT_TRACE_FLAG_CSWITCH | EVENT_TRACE_FLAG_DISPATCHER | \
+                            EVENT_TRACE_FLAG_DISK_IO | EVENT_TRACE_FLAG_MEMORY_PAGE_FAULTS | \
+                            EVENT_TRACE_FLAG_MEMORY_HARD_FAULTS)
+
+typedef struct _KERNEL_EVENT_COUNTS
+{
+    ULONG ContextSwitches;
+    ULONG ReadyThreads;
+    ULONG DiskIoStarts;
+    ULONG DiskIoCompletions;
+    ULONG DemandZeroFaults;
+    ULONG PageFaults;
+    ULONG HardFaults;
+} KERNEL_EVENT_COUNTS;
+
+static TRACEHANDLE ProviderLoggerHandle;
+static ULONG ProviderCallbacks;
+
+static ULONG WINAPI ProviderCallback(WMIDPREQUESTCODE RequestCode, PVOID Context, ULONG *BufferSize, PVOID Buffer)
+{
+    ProviderCallbacks++;
+    if (RequestCode == WMI_ENABLE_EVENTS)
+        ProviderLoggerHandle = GetTraceLoggerHandle(Buffer);
+    else if (RequestCode == WMI_DISABLE_EVENTS)
+        ProviderLoggerHandle = 0;
+    return ERROR_SUCCESS;
+}
+
+static void InitProperties(SESSION_PROPERTIES *Session, PCWSTR LogFileName)
+{
+    ZeroMemory(Session, sizeof(*Session));
+    Session->Properties.Wnode.BufferSize = sizeof(*Session);
+    Session->Properties.Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+    Session->Properties.Wnode.ClientContext = 1;
+    Session->Properties.LoggerNameOffset = FIELD_OFFSET(SESSION_PROPERTIES, LoggerName);
+    Session->Properties.LogFileNameOffset = FIELD_OFFSET(SESSION_PROPERTIES, LogFileName);
+    Session->Properties.LogFileMode = EVENT_TRACE_FILE_MODE_SEQUENTIAL;
+    Session->Properties.BufferSize = 64;
+    Session->Properties.MaximumBuffers = 64;
+    StringCchCopyW(Session->LogFileName, _countof(Session->LogFileName), LogFileName);
+}
+
+/* Returns the number of our events in the log file, checking that none is missing */
+static ULONG CountLogFileEvents(PCWSTR LogFileName)
+{
+    WMI_LOGFILE_HEADER LogHeader;
+    PWMI_TRACE_BUFFER_HEADER Buffer;
+    TEST_EVENT *Event;
+    PUCHAR Seen;
+    ULONG Count = 0, Offset;
+    DWORD dwRead;
+    HANDLE hFile;
+
+    hFile = CreateFileW(LogFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (hFile == INVALID_HANDLE_VALUE)
+        return 0;
+
+    ok(ReadFile(hFile, &LogHeader, sizeof(LogHeader), &dwRead, NULL), "ReadFile failed\n");
+    ok_long(LogHeader.Signature, WMI_LOGFILE_SIGNATURE);
+    ok_long(LogHeader.BufferSize, 64 * 1024);
+    ok_long(LogHeader.EventsLost, 0);
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, LogHeader.BufferSize);
+    Seen = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, EVENT_COUNT);
+    SetFilePointer(hFile, LogHeader.BufferSize, NULL, FILE_BEGIN);
+    while (ReadFile(hFile, Buffer, LogHeader.BufferSize, &dwRead, NULL) && dwRead == LogHeader.BufferSize)
+    {
+        for (Offset = sizeof(WMI_TRACE_BUFFER_HEADER); Offset + sizeof(EVENT_TRACE_HEADER) <= Buffer->SavedOffset; )
+        {
+            Event = (TEST_EVENT *)((PUCHAR)Buffer + Offset);
+            if (IsEqualGUID(&Event->Header.Guid, &ProviderGuid) &&
+                Event->Header.Size == sizeof(TEST_EVENT) &&
+                Event->Magic == 0x54455354 &&
+                Event->Sequence < EVENT_COUNT &&
+                !Seen[Event->Sequence])
+            {
+                ok_long(Event->Header.ProcessId, GetCurrentProcessId());
+                Seen[Event->Sequence] = 1;
+                Count++;
+            }
+            Offset += (Event->Header.Size + WMI_TRACE_ALIGNMENT - 1) & ~(WMI_TRACE_ALIGNMENT - 1);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, Seen);
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    CloseHandle(hFile);
+    return Count;
+}
+
+static void Test_Session(PCWSTR LogFileName)
+{
+    SESSION_PROPERTIES Session, Query;
+    TRACEHANDLE SessionHandle = 0, RegHandle = 0;
+    TRACE_GUID_REGISTRATION GuidReg = { &ProviderGuid, NULL };
+    LARGE_INTEGER Frequency, Start, End;
+    TEST_EVENT Event;
+    ULONG Error, i;
+
+    InitProperties(&Session, LogFileName);
+    Error = StartTraceW(&SessionHandle, L"ReactOS apitest session", &Session.Properties);
+    if (Error == ERROR_ACCESS_DENIED)
+    {
+        skip("Need SeSystemProfilePrivilege\n");
+        return;
+    }
+    ok_long(Error, ERROR_SUCCESS);
+    ok(SessionHandle != 0, "No session handle\n");
+    ok(!wcscmp(Session.LoggerName, L"ReactOS apitest session"), "Wrong logger name %S\n", Session.LoggerName);
+    if (Error != ERROR_SUCCESS)
+        return;
+
+    /* The same name cannot be used twice */
+    InitProperties(&Query, LogFileName);
+    Error = StartTraceW(&RegHandle, L"ReactOS apitest session", &Query.Properties);
+    ok_long(Error, ERROR_ALREADY_EXISTS);
+
+    /* The provider is told about the session when it is enabled */
+    Error = RegisterTraceGuidsW(ProviderCallback, NULL, &ProviderGuid, 1, &GuidReg, NULL, NULL, &RegHandle);
+    ok_long(Error, ERROR_SUCCESS);
+    ok_long(ProviderCallbacks, 0);
+    Error = EnableTrace(TRUE, 0x1234, TRACE_LEVEL_INFORMATION, &ProviderGuid, SessionHandle);
+    ok_long(Error, ERROR_SUCCESS);
+    ok_long(ProviderCallbacks, 1);
+    ok(ProviderLoggerHandle != 0, "Provider was not enabled\n");
+    ok_long(GetTraceEnableFlags(ProviderLoggerHandle), 0x1234);
+    ok_int(GetTraceEnableLevel(ProviderLoggerHandle), TRACE_LEVEL_INFORMATION);
+
+    ZeroMemory(&Event, sizeof(Event));
+    Event.Header.Size = sizeof(Event);
+    Event.Header.Flags = WNODE_FLAG_TRACED_GUID;
+    Event.Header.Guid = ProviderGuid;
+    Event.Header.Class.Type = EVENT_TRACE_TYPE_INFO;
+    Event.Magic = 0x54455354;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < EVENT_COUNT; i++)
+    {
+        Event.Sequence = i;
+        Error = TraceEvent(ProviderLoggerHandle, &Event.Header);
+        if (Error != ERROR_SUCCESS)
+        {
+            ok_long(Error, ERROR_SUCCESS);
+            break;
+        }
+    }
+    QueryPerformanceCounter(&End);
+    trace("%d TraceEvent calls: %lu ms\n", EVENT_COUNT,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+    /* Disabling the provider goes through the callback too */
+    Error = EnableTrace(FALSE, 0, 0, &ProviderGuid, SessionHandle);
+    ok_long(Error, ERROR_SUCCESS);
+    ok_long(ProviderCallbacks, 2);
+    ok(ProviderLoggerHandle == 0, "Provider is still enabled\n");
+    ok_long(UnregisterTraceGuids(RegHandle), ERROR_SUCCESS);
+    ok_long(UnregisterTraceGuids(RegHandle), ERROR_INVALID_PARAMETER);
+
+    /* Query by name */
+    InitProperties(&Query, L"");
+    Error = QueryTraceW(0, L"ReactOS apitest session", &Query.Properties);
+    ok_long(Error, ERROR_SUCCESS);
+    ok(Query.Properties.Wnode.HistoricalContext == SessionHandle, "Wrong session handle\n");
+    ok_long(Query.Properties.BufferSize, 64);
+
+    InitProperties(&Query, L"");
+    Error = ControlTraceW(SessionHandle, NULL, &Query.Properties, EVENT_TRACE_CONTROL_STOP);
+    ok_long(Error, ERROR_SUCCESS);
+    ok_long(Query.Properties.EventsLost, 0);
+    ok(Query.Properties.BuffersWritten > 0, "No buffer written\n");
+    trace("%lu buffers written, %lu events lost\n",
+          Query.Properties.BuffersWritten, Query.Properties.EventsLost);
+
+    Error = ControlTraceW(SessionHandle, NULL, &Query.Properties, EVENT_TRACE_CONTROL_STOP);
+    ok_long(Error, ERROR_WMI_INSTANCE_NOT_FOUND);
+
+    ok_long(CountLogFileEvents(LogFileName), EVENT_COUNT);
+}
+
+static HANDLE PingEvent, PongEvent;
+
+static DWORD WINAPI PongThread(PVOID Parameter)
+{
+    ULONG i;
+
+    for (i = 0; i < WORKLOAD_SWITCHES; i++)
+    {
+        WaitForSingleObject(PingEvent, INFINITE);
+        SetEvent(PongEvent);
+    }
+    return 0;
+}
+
+/* Switches threads, faults pages in and reads from the disk, returns the elapsed time */
+static LONGLONG RunWorkload(PCWSTR DataFileName, PVOID IoBuffer)
+{
+    LARGE_INTEGER Start, End;
+    HANDLE hThread, hFile, hMapping;
+    volatile UCHAR *Pages;
+    DWORD dwRead;
+    ULONG i;
+
+    QueryPerformanceCounter(&Start);
+
+    /* Context switches and ready threads */
+    hThread = CreateThread(NULL, 0, PongThread, NULL, 0, NULL);
+    for (i = 0; i < WORKLOAD_SWITCHES; i++)
+    {
+        SetEvent(PingEvent);
+        WaitForSingleObject(PongEvent, INFINITE);
+    }
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+
+    /* Demand zero faults */
+    Pages = VirtualAlloc(NULL, WORKLOAD_PAGES * PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    if (Pages)
+    {
+        for (i = 0; i < WORKLOAD_PAGES; i++)
+            Pages[i * PAGE_SIZE] = (UCHAR)i;
+        VirtualFree((PVOID)Pages, 0, MEM_RELEASE);
+    }
+
+    /* Disk reads that bypass the cache */
+    hFile = CreateFileW(DataFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_FLAG_NO_BUFFERING, NULL);
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        while (ReadFile(hFile, IoBuffer, WORKLOAD_IO_SIZE, &dwRead, NULL) && dwRead != 0)
+            ;
+        CloseHandle(hFile);
+    }
+
+    /* File backed faults */
+    hFile = CreateFileW(DataFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMapping)
+        {
+            Pages = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (Pages)
+            {
+                for (i = 0; i < WORKLOAD_FILE_SIZE; i += PAGE_SIZE)
+                    (void)Pages[i];
+                UnmapViewOfFile((PVOID)Pages);
+            }
+            CloseHandle(hMapping);
+        }
+        CloseHandle(hFile);
+    }
+
+    QueryPerformanceCounter(&End);
+    return End.QuadPart - Start.QuadPart;
+}
+
+/* Returns the shortest run, the others were disturbed by something else */
+static LONGLONG TimeWorkload(PCWSTR DataFileName, PVOID IoBuffer)
+{
+    LONGLONG Best = MAXLONGLONG, Time;
+    ULONG i;
+
+    for (i = 0; i < WORKLOAD_RUNS; i++)
+    {
+        Time = RunWorkload(DataFileName, IoBuffer);
+        if (Time < Best)
+            Best = Time;
+    }
+    return Best;
+}
+
+static void CountKernelEvents(PCWSTR LogFileName, KERNEL_EVENT_COUNTS *Counts)
+{
+    WMI_LOGFILE_HEADER LogHeader;
+    PWMI_TRACE_BUFFER_HEADER Buffer;
+    PEVENT_TRACE_HEADER Event;
+    ULONG Offset;
+    DWORD dwRead;
+    HANDLE hFile;
+
+    ZeroMemory(Counts, sizeof(*Counts));
+
+    hFile = CreateFileW(LogFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+
+    ok(ReadFile(hFile, &LogHeader, sizeof(LogHeader), &dwRead, NULL), "ReadFile failed\n");
+    ok_long(LogHeader.Signature, WMI_LOGFILE_SIGNATURE);
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, LogHeader.BufferSize);
+    SetFilePointer(hFile, LogHeader.BufferSize, NULL, FILE_BEGIN);
+    while (ReadFile(hFile, Buffer, LogHeader.BufferSize, &dwRead, NULL) && dwRead == LogHeader.BufferSize)
+    {
+        for (Offset = sizeof(WMI_TRACE_BUFFER_HEADER); Offset + sizeof(EVENT_TRACE_HEADER) <= Buffer->SavedOffset; )
+        {
+            Event = (PEVENT_TRACE_HEADER)((PUCHAR)Buffer + Offset);
+            if (IsEqualGUID(&Event->Guid, &KernelThreadGuid))
+            {
+                if (Event->Class.Type == WMI_TYPE_CSWITCH)
+                {
+                    ok_long(Event->Size, sizeof(EVENT_TRACE_HEADER) + sizeof(WMI_CSWITCH_EVENT));
+                    Counts->ContextSwitches++;
+                }
+                else if (Event->Class.Type == WMI_TYPE_READY_THREAD)
+                {
+                    Counts->ReadyThreads++;
+                }
+            }
+            else if (IsEqualGUID(&Event->Guid, &KernelDiskIoGuid))
+            {
+                if (Event->Class.Type == EVENT_TRACE_TYPE_IO_READ_INIT ||
+                    Event->Class.Type == EVENT_TRACE_TYPE_IO_WRITE_INIT)
+                {
+                    Counts->DiskIoStarts++;
+                }
+                else
+                {
+                    ok_long(Event->Size, sizeof(EVENT_TRACE_HEADER) + sizeof(WMI_DISKIO_EVENT));
+                    Counts->DiskIoCompletions++;
+                }
+            }
+            else if (IsEqualGUID(&Event->Guid, &KernelPageFaultGuid))
+            {
+                if (Event->Class.Type == WMI_TYPE_HARD_FAULT)
+                    Counts->HardFaults++;
+                else if (Event->Class.Type == EVENT_TRACE_TYPE_MM_DZF)
+                    Counts->DemandZeroFaults++;
+                else
+                    Counts->PageFaults++;
+            }
+            Offset += (Event->Size + WMI_TRACE_ALIGNMENT - 1) & ~(WMI_TRACE_ALIGNMENT - 1);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    CloseHandle(hFile);
+}
+
+static ULONG StartKernelLogger(PCWSTR LogFileName, ULONG EnableFlags, TRACEHANDLE *SessionHandle)
+{
+    SESSION_PROPERTIES Session;
+
+    InitProperties(&Session, LogFileName);
+    Session.Properties.Wnode.Guid = KernelSystemTraceGuid;
+    Session.Properties.EnableFlags = EnableFlags;
+    Session.Properties.MaximumBuffers = 256;
+    return StartTraceW(SessionHandle, KERNEL_LOGGER_NAMEW, &Session.Properties);
+}
+
+static void StopKernelLogger(TRACEHANDLE SessionHandle)
+{
+    SESSION_PROPERTIES Query;
+
+    InitProperties(&Query, L"");
+    ok_long(ControlTraceW(SessionHandle, NULL, &Query.Properties, EVENT_TRACE_CONTROL_STOP), ERROR_SUCCESS);
+    trace("%lu buffers written, %lu events lost\n",
+          Query.Properties.BuffersWritten, Query.Properties.EventsLost);
+}
+
+static void Test_KernelLogger(PCWSTR LogFileName, PCWSTR DataFileName)
+{
+    TRACEHANDLE SessionHandle = 0;
+    KERNEL_EVENT_COUNTS Counts;
+    LONGLONG Baseline, Disabled, Enabled;
+    LARGE_INTEGER Frequency;
+    PVOID IoBuffer;
+    HANDLE hFile;
+    DWORD dwWritten;
+    ULONG Error, i;
+
+    IoBuffer = VirtualAlloc(NULL, WORKLOAD_IO_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    PingEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    PongEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!IoBuffer || !PingEvent || !PongEvent)
+    {
+        skip("Out of resources\n");
+        goto Cleanup;
+    }
+
+    /* Data file for the disk reads */
+    hFile = CreateFileW(DataFileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (hFile == INVALID_HANDLE_VALUE)
+        goto Cleanup;
+    FillMemory(IoBuffer, WORKLOAD_IO_SIZE, 0x55);
+    for (i = 0; i < WORKLOAD_FILE_SIZE / WORKLOAD_IO_SIZE; i++)
+        WriteFile(hFile, IoBuffer, WORKLOAD_IO_SIZE, &dwWritten, NULL);
+    CloseHandle(hFile);
+
+    /* Warm up, then time the workload without any kernel logger */
+    RunWorkload(DataFileName, IoBuffer);
+    Baseline = TimeWorkload(DataFileName, IoBuffer);
+
+    /* The kernel logger with no group enabled must cost nothing */
+    Error = StartKernelLogger(LogFileName, 0, &SessionHandle);
+    if (Error == ERROR_ALREADY_EXISTS)
+    {
+        skip("NT Kernel Logger is already running\n");
+        goto Cleanup;
+    }
+    ok_long(Error, ERROR_SUCCESS);
+    if (Error != ERROR_SUCCESS)
+        goto Cleanup;
+    Disabled = TimeWorkload(DataFileName, IoBuffer);
+    StopKernelLogger(SessionHandle);
+
+    CountKernelEvents(LogFileName, &Counts);
+    ok_long(Counts.ContextSwitches + Counts.ReadyThreads, 0);
+    ok_long(Counts.DiskIoStarts + Counts.DiskIoCompletions, 0);
+    ok_long(Counts.DemandZeroFaults + Counts.PageFaults + Counts.HardFaults, 0);
+
+    /* Now with all the groups */
+    Error = StartKernelLogger(LogFileName, KERNEL_TRACE_FLAGS, &SessionHandle);
+    ok_long(Error, ERROR_SUCCESS);
+    if (Error != ERROR_SUCCESS)
+        goto Cleanup;
+    Enabled = TimeWorkload(DataFileName, IoBuffer);
+    StopKernelLogger(SessionHandle);
+
+    QueryPerformanceFrequency(&Frequency);
+    trace("Workload: %lu us without logger, %lu us disabled, %lu us enabled\n",
+          (ULONG)(Baseline * 1000000 / Frequency.QuadPart),
+          (ULONG)(Disabled * 1000000 / Frequency.QuadPart),
+          (ULONG)(Enabled * 1000000 / Frequency.QuadPart));
+
+    /* Best of several runs, allow 5% of noise */
+    ok(Disabled <= Baseline + Baseline / 20,
+       "Disabled providers cost %I64d ticks over %I64d\n", Disabled - Baseline, Baseline);
+
+    CountKernelEvents(LogFileName, &Counts);
+    trace("%lu context switches, %lu ready threads, %lu/%lu disk I/Os, %lu demand zero faults, %lu other faults, %lu hard faults\n",
+          Counts.ContextSwitches, Counts.ReadyThreads, Counts.DiskIoStarts, Counts.DiskIoCompletions,
+          Counts.DemandZeroFaults, Counts.PageFaults, Counts.HardFaults);
+    ok(Counts.ContextSwitches >= WORKLOAD_SWITCHES * WORKLOAD_RUNS, "Only %lu context switches\n", Counts.ContextSwitches);
+    ok(Counts.ReadyThreads >= WORKLOAD_SWITCHES * WORKLOAD_RUNS, "Only %lu ready threads\n", Counts.ReadyThreads);
+    ok(Counts.DemandZeroFaults >= WORKLOAD_PAGES * WORKLOAD_RUNS, "Only %lu demand zero faults\n", Counts.DemandZeroFaults);
+    ok(Counts.DiskIoCompletions > 0, "No disk I/O\n");
+
+Cleanup:
+    DeleteFileW(DataFileName);
+    if (PongEvent) CloseHandle(PongEvent);
+    if (PingEvent) CloseHandle(PingEvent);
+    if (IoBuffer) VirtualFree(IoBuffer, 0, MEM_RELEASE);
+}
+
+static void Test_Parameters(void)
+{
+    SESSION_PROPERTIES Session;
+    TRACEHANDLE SessionHandle = 0;
+
+    InitProperties(&Session, L"C:\\nothing.etl");
+    ok_long(StartTraceW(NULL, L"ReactOS apitest", &Session.Properties), ERROR_INVALID_PARAMETER);
+    ok_long(StartTraceW(&SessionHandle, NULL, &Session.Properties), ERROR_INVALID_PARAMETER);
+    ok_long(StartTraceW(&SessionHandle, L"ReactOS apitest", NULL), ERROR_INVALID_PARAMETER);
+
+    Session.Properties.Wnode.BufferSize = 0;
+    ok_long(StartTraceW(&SessionHandle, L"ReactOS apitest", &Session.Properties), ERROR_BAD_LENGTH);
+
+    InitProperties(&Session, L"C:\\nothing.etl");
+    Session.Properties.LogFileMode |= EVENT_TRACE_FILE_MODE_CIRCULAR;
+    ok_long(StartTraceW(&SessionHandle, L"ReactOS apitest", &Session.Properties), ERROR_INVALID_PARAMETER);
+
+    InitProperties(&Session, L"C:\\nothing.etl");
+    Session.Properties.LogFileNameOffset = 0;
+    ok_long(StartTraceW(&SessionHandle, L"ReactOS apitest", &Session.Properties), ERROR_BAD_PATHNAME);
+
+    ok_long(TraceEvent(0, NULL), ERROR_INVALID_PARAMETER);
+    ok_long(GetTraceEnableFlags(WMI_MAKE_LOGGER_HANDLE(2, 4, 0x8001)), 0x8001);
+    ok_int(GetTraceEnableLevel(WMI_MAKE_LOGGER_HANDLE(2, 4, 0x8001)), 4);
+}
+
+START_TEST(EtwTrace)
+{
+    WCHAR TempPath[MAX_PATH], LogFileName[MAX_PATH], DataFileName[MAX_PATH];
+    BOOLEAN WasEnabled;
+
+    Test_Parameters();
+
+    RtlAdjustPrivilege(SE_SYSTEM_PROFILE_PRIVILEGE, TRUE, FALSE, &WasEnabled);
+
+    GetTempPathW(_countof(TempPath), TempPath);
+    GetTempFileNameW(TempPath, L"etw", 0, LogFileName);
+    Test_Session(LogFileName);
+    DeleteFileW(LogFileName);
+
+    GetTempFileNameW(TempPath, L"etw", 0, LogFileName);
+    GetTempFileNameW(TempPath, L"etd", 0, DataFileName);
+    Test_KernelLogger(LogFileName, DataFileName);
+    DeleteFileW(LogFileName);
+
+    RtlAdjustPrivilege(SE_SYSTEM_PROFILE_PRIVILEGE, WasEnabled, FALSE, &WasEnabled);
+}
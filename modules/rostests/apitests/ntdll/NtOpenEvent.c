@@ -0,0 +1,242 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for repeated access checks when opening events
+ */
+
+#include "precomp.h"
+
+#define EVENT_NAME L"Local\\NtOpenEvent_apitest"
+#define BENCHMARK_OPENS 10000
+
+#define GRANTED_ACCESS (EVENT_QUERY_STATE | SYNCHRONIZE)
+
+static
+BOOL
+BuildDescriptor(
+    _Out_ PSECURITY_DESCRIPTOR SecurityDescriptor,
+    _Out_writes_bytes_(AclSize) PACL Acl,
+    _In_ DWORD AclSize,
+    _In_ ACCESS_MASK WorldAccess)
+{
+    SID_IDENTIFIER_AUTHORITY WorldAuthority = {SECURITY_WORLD_SID_AUTHORITY};
+    BYTE WorldSidBuffer[SECURITY_MAX_SID_SIZE];
+    PSID WorldSid = (PSID)WorldSidBuffer;
+
+    if (!InitializeSid(WorldSid, &WorldAuthority, 1))
+        return FALSE;
+    *GetSidSubAuthority(WorldSid, 0) = SECURITY_WORLD_RID;
+
+    return InitializeAcl(Acl, AclSize, ACL_REVISION) &&
+           AddAccessAllowedAce(Acl, ACL_REVISION, WorldAccess, WorldSid) &&
+           InitializeSecurityDescriptor(SecurityDescriptor, SECURITY_DESCRIPTOR_REVISION) &&
+           SetSecurityDescriptorDacl(SecurityDescriptor, TRUE, Acl, FALSE);
+}
+
+static
+ACCESS_MASK
+GetGrantedAccess(
+    _In_ HANDLE Handle)
+{
+    OBJECT_BASIC_INFORMATION BasicInfo;
+    NTSTATUS Status;
+
+    Status = NtQueryObject(Handle, ObjectBasicInformation, &BasicInfo, sizeof(BasicInfo), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    return NT_SUCCESS(Status) ? BasicInfo.GrantedAccess : 0;
+}
+
+static
+VOID
+CheckOpens(
+    _In_ BOOL ModifyAllowed,
+    _In_ PCSTR Stage)
+{
+    HANDLE Handle;
+    ACCESS_MASK Access;
+    ULONG i;
+
+    /* The first round fills the cache, the next ones should hit it */
+    for (i = 0; i < 3; i++)
+    {
+        Handle = OpenEventW(EVENT_QUERY_STATE, FALSE, EVENT_NAME);
+        ok(Handle != NULL, "%s, round %lu: query open failed, error %lu\n", Stage, i, GetLastError());
+        if (Handle)
+        {
+            ok_hex(GetGrantedAccess(Handle), EVENT_QUERY_STATE);
+            CloseHandle(Handle);
+        }
+
+        SetLastError(0xdeadbeef);
+        Handle = OpenEventW(EVENT_MODIFY_STATE, FALSE, EVENT_NAME);
+        if (ModifyAllowed)
+        {
+            ok(Handle != NULL, "%s, round %lu: modify open failed, error %lu\n", Stage, i, GetLastError());
+        }
+        else
+        {
+            ok(Handle == NULL, "%s, round %lu: modify open succeeded\n", Stage, i);
+            ok(GetLastError() == ERROR_ACCESS_DENIED, "%s, round %lu: error %lu\n", Stage, i, GetLastError());
+        }
+        if (Handle)
+            CloseHandle(Handle);
+
+        Handle = OpenEventW(MAXIMUM_ALLOWED, FALSE, EVENT_NAME);
+        ok(Handle != NULL, "%s, round %lu: maximum open failed, error %lu\n", Stage, i, GetLastError());
+        if (Handle)
+        {
+            Access = GetGrantedAccess(Handle);
+            ok((Access & GRANTED_ACCESS) == GRANTED_ACCESS,
+               "%s, round %lu: access 0x%lx\n", Stage, i, Access);
+            ok(!!(Access & EVENT_MODIFY_STATE) == !!ModifyAllowed,
+               "%s, round %lu: access 0x%lx\n", Stage, i, Access);
+            CloseHandle(Handle);
+        }
+    }
+}
+
+static
+BOOL
+GetModifiedId(
+    _In_ HANDLE Token,
+    _Out_ PLUID ModifiedId)
+{
+    TOKEN_STATISTICS Statistics;
+    DWORD Length;
+
+    if (!GetTokenInformation(Token, TokenStatistics, &Statistics, sizeof(Statistics), &Length))
+        return FALSE;
+
+    *ModifiedId = Statistics.ModifiedId;
+    return TRUE;
+}
+
+static
+VOID
+TestTokenAdjust(VOID)
+{
+    HANDLE Token;
+    PTOKEN_PRIVILEGES Privileges;
+    TOKEN_PRIVILEGES NewState;
+    LUID ModifiedId, NewModifiedId;
+    DWORD Length, i;
+
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY | TOKEN_ADJUST_PRIVILEGES, &Token))
+    {
+        skip("OpenProcessToken failed, error %lu\n", GetLastError());
+        return;
+    }
+
+    GetTokenInformation(Token, TokenPrivileges, NULL, 0, &Length);
+    Privileges = HeapAlloc(GetProcessHeap(), 0, Length);
+    if (!Privileges || !GetTokenInformation(Token, TokenPrivileges, Privileges, Length, &Length))
+    {
+        skip("Unable to query the privileges, error %lu\n", GetLastError());
+        goto Quit;
+    }
+
+    /* Find a privilege that we can toggle */
+    for (i = 0; i < Privileges->PrivilegeCount; i++)
+    {
+        if (!(Privileges->Privileges[i].Attributes & SE_PRIVILEGE_ENABLED))
+            break;
+    }
+    if (i == Privileges->PrivilegeCount)
+    {
+        skip("No disabled privilege in the token\n");
+        goto Quit;
+    }
+
+    ok(GetModifiedId(Token, &ModifiedId), "GetModifiedId failed, error %lu\n", GetLastError());
+
+    NewState.PrivilegeCount = 1;
+    NewState.Privileges[0].Luid = Privileges->Privileges[i].Luid;
+    NewState.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    ok(AdjustTokenPrivileges(Token, FALSE, &NewState, 0, NULL, NULL),
+       "AdjustTokenPrivileges failed, error %lu\n", GetLastError());
+
+    /* The adjustment makes the previous results of the token stale */
+    ok(GetModifiedId(Token, &NewModifiedId), "GetModifiedId failed, error %lu\n", GetLastError());
+    ok(!RtlEqualLuid(&ModifiedId, &NewModifiedId), "ModifiedId didn't change\n");
+    CheckOpens(FALSE, "adjusted token");
+
+    NewState.Privileges[0].Attributes = 0;
+    ok(AdjustTokenPrivileges(Token, FALSE, &NewState, 0, NULL, NULL),
+       "AdjustTokenPrivileges failed, error %lu\n", GetLastError());
+    CheckOpens(FALSE, "restored token");
+
+Quit:
+    if (Privileges)
+        HeapFree(GetProcessHeap(), 0, Privileges);
+    CloseHandle(Token);
+}
+
+static
+VOID
+BenchmarkOpens(VOID)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE Handle;
+    ULONG i, Failures = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCHMARK_OPENS; i++)
+    {
+        Handle = OpenEventW(EVENT_QUERY_STATE, FALSE, EVENT_NAME);
+        if (!Handle)
+        {
+            Failures++;
+            continue;
+        }
+        CloseHandle(Handle);
+    }
+    QueryPerformanceCounter(&End);
+
+    ok_long(Failures, 0);
+    trace("%u opens in %I64u us\n",
+          BENCHMARK_OPENS,
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart);
+}
+
+START_TEST(NtOpenEvent)
+{
+    SECURITY_ATTRIBUTES SecurityAttributes;
+    SECURITY_DESCRIPTOR SecurityDescriptor;
+    BYTE AclBuffer[256];
+    HANDLE Event;
+
+    if (!BuildDescriptor(&SecurityDescriptor, (PACL)AclBuffer, sizeof(AclBuffer), GRANTED_ACCESS))
+    {
+        skip("Unable to build the security descriptor, error %lu\n", GetLastError());
+        return;
+    }
+
+    SecurityAttributes.nLength = sizeof(SecurityAttributes);
+    SecurityAttributes.lpSecurityDescriptor = &SecurityDescriptor;
+    SecurityAttributes.bInheritHandle = FALSE;
+    Event = CreateEventW(&SecurityAttributes, TRUE, FALSE, EVENT_NAME);
+    if (!Event)
+    {
+        skip("CreateEventW failed, error %lu\n", GetLastError());
+        return;
+    }
+
+    CheckOpens(FALSE, "restricted");
+
+    /* A new descriptor must not get the results of the previous one */
+    BuildDescriptor(&SecurityDescriptor, (PACL)AclBuffer, sizeof(AclBuffer), GRANTED_ACCESS | EVENT_MODIFY_STATE);
+    ok(SetKernelObjectSecurity(Event, DACL_SECURITY_INFORMATION, &SecurityDescriptor),
+       "SetKernelObjectSecurity failed, error %lu\n", GetLastError());
+    CheckOpens(TRUE, "relaxed");
+
+    BuildDescriptor(&SecurityDescriptor, (PACL)AclBuffer, sizeof(AclBuffer), GRANTED_ACCESS);
+    ok(SetKernelObjectSecurity(Event, DACL_SECURITY_INFORMATION, &SecurityDescriptor),
+       "SetKernelObjectSecurity failed, error %lu\n", GetLastError());
+    CheckOpens(FALSE, "restricted again");
+
+    TestTokenAdjust();
+    BenchmarkOpens();
+
+    CloseHandle(Event);
+}
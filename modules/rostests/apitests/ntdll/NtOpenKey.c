@@ -1,13 +1,137 @@
 /*
  * PROJECT:         ReactOS api tests
  * LICENSE:         LGPLv2.1+ - See COPYING.LIB in the top level directory
- * PURPOSE:         Test for NtOpenKey data alignment
+ * PURPOSE:         Test for NtOpenKey data alignment and repeated access checks
  * PROGRAMMER:      Mark Jansen (mark.jansen@reactos.org)
  */
 
 #include "precomp.h"
 
 #define TEST_STR    L"\\Registry\\Machine\\SOFTWARE"
+#define TEST_KEY    L"NtOpenKey_apitest"
+#define BENCHMARK_OPENS 10000
+
+static
+NTSTATUS
+SetKeyDacl(
+    _In_ HANDLE KeyHandle,
+    _In_ ACCESS_MASK WorldAccess)
+{
+    SID_IDENTIFIER_AUTHORITY WorldAuthority = {SECURITY_WORLD_SID_AUTHORITY};
+    ULONG SidBuffer[SECURITY_MAX_SID_SIZE / sizeof(ULONG)];
+    ULONG AclBuffer[64];
+    SECURITY_DESCRIPTOR SecurityDescriptor;
+    PSID WorldSid = (PSID)SidBuffer;
+    PACL Acl = (PACL)AclBuffer;
+    NTSTATUS Status;
+
+    RtlInitializeSid(WorldSid, &WorldAuthority, 1);
+    *RtlSubAuthoritySid(WorldSid, 0) = SECURITY_WORLD_RID;
+
+    Status = RtlCreateAcl(Acl, sizeof(AclBuffer), ACL_REVISION);
+    if (NT_SUCCESS(Status))
+        Status = RtlAddAccessAllowedAce(Acl, ACL_REVISION, WorldAccess, WorldSid);
+    if (NT_SUCCESS(Status))
+        Status = RtlCreateSecurityDescriptor(&SecurityDescriptor, SECURITY_DESCRIPTOR_REVISION);
+    if (NT_SUCCESS(Status))
+        Status = RtlSetDaclSecurityDescriptor(&SecurityDescriptor, TRUE, Acl, FALSE);
+    if (NT_SUCCESS(Status))
+        Status = NtSetSecurityObject(KeyHandle, DACL_SECURITY_INFORMATION, &SecurityDescriptor);
+
+    return Status;
+}
+
+static
+VOID
+CheckKeyOpens(
+    _In_ HANDLE RootHandle,
+    _In_ BOOLEAN SetAllowed,
+    _In_ PCSTR Stage)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    UNICODE_STRING KeyName = RTL_CONSTANT_STRING(TEST_KEY);
+    HANDLE KeyHandle;
+    NTSTATUS Status;
+    ULONG i;
+
+    InitializeObjectAttributes(&ObjectAttributes, &KeyName, OBJ_CASE_INSENSITIVE, RootHandle, NULL);
+
+    /* The key has its own security method, the first round fills the cache */
+    for (i = 0; i < 3; i++)
+    {
+        Status = NtOpenKey(&KeyHandle, KEY_QUERY_VALUE, &ObjectAttributes);
+        ok(Status == STATUS_SUCCESS, "%s, round %lu: query open returned 0x%lx\n", Stage, i, Status);
+        if (NT_SUCCESS(Status))
+            NtClose(KeyHandle);
+
+        Status = NtOpenKey(&KeyHandle, KEY_SET_VALUE, &ObjectAttributes);
+        ok(Status == (SetAllowed ? STATUS_SUCCESS : STATUS_ACCESS_DENIED),
+           "%s, round %lu: set open returned 0x%lx\n", Stage, i, Status);
+        if (NT_SUCCESS(Status))
+            NtClose(KeyHandle);
+    }
+}
+
+static
+VOID
+TestRepeatedOpens(VOID)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    UNICODE_STRING KeyName = RTL_CONSTANT_STRING(TEST_KEY);
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE RootHandle, KeyHandle, Handle;
+    NTSTATUS Status;
+    ULONG i, Failures = 0;
+
+    Status = RtlOpenCurrentUser(KEY_CREATE_SUB_KEY, &RootHandle);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("RtlOpenCurrentUser failed with 0x%lx\n", Status);
+        return;
+    }
+
+    InitializeObjectAttributes(&ObjectAttributes, &KeyName, OBJ_CASE_INSENSITIVE, RootHandle, NULL);
+    Status = NtCreateKey(&KeyHandle, KEY_ALL_ACCESS, &ObjectAttributes, 0, NULL, REG_OPTION_VOLATILE, NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("NtCreateKey failed with 0x%lx\n", Status);
+        NtClose(RootHandle);
+        return;
+    }
+
+    ok_ntstatus(SetKeyDacl(KeyHandle, KEY_QUERY_VALUE), STATUS_SUCCESS);
+    CheckKeyOpens(RootHandle, FALSE, "restricted");
+
+    /* A new descriptor must not get the results of the previous one */
+    ok_ntstatus(SetKeyDacl(KeyHandle, KEY_QUERY_VALUE | KEY_SET_VALUE), STATUS_SUCCESS);
+    CheckKeyOpens(RootHandle, TRUE, "relaxed");
+
+    ok_ntstatus(SetKeyDacl(KeyHandle, KEY_QUERY_VALUE), STATUS_SUCCESS);
+    CheckKeyOpens(RootHandle, FALSE, "restricted again");
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCHMARK_OPENS; i++)
+    {
+        Status = NtOpenKey(&Handle, KEY_QUERY_VALUE, &ObjectAttributes);
+        if (!NT_SUCCESS(Status))
+        {
+            Failures++;
+            continue;
+        }
+        NtClose(Handle);
+    }
+    QueryPerformanceCounter(&End);
+
+    ok_long(Failures, 0);
+    trace("%u key opens in %I64u us\n",
+          BENCHMARK_OPENS,
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart);
+
+    NtDeleteKey(KeyHandle);
+    NtClose(KeyHandle);
+    NtClose(RootHandle);
+}
 
 START_TEST(NtOpenKey)
 {
@@ -50,4 +174,6 @@ START_TEST(NtOpenKey)
     {
         NtClose(*(HANDLE*)(UnalignedKey));
     }
+
+    TestRepeatedOpens();
 }
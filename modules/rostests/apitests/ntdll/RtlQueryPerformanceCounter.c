@@ -0,0 +1,92 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for RtlQueryPerformanceCounter
+ * PROGRAMMERS:
+ */
+
+#include "precomp.h"
+
+#define BENCH_COUNT 1000000
+
+static BOOLEAN (NTAPI *pRtlQueryPerformanceCounter)(PLARGE_INTEGER);
+
+/* kernel32 reads the same counter where ntdll doesn't export it */
+static BOOLEAN NTAPI QueryCounterThroughKernel32(PLARGE_INTEGER PerformanceCounter)
+{
+    return QueryPerformanceCounter(PerformanceCounter) != FALSE;
+}
+
+static void Test_Consistency(void)
+{
+    LARGE_INTEGER Counter1, Counter2, Counter3, Frequency;
+    NTSTATUS Status;
+    ULONG i;
+
+    /* The user mode counter and the kernel one must be the same clock */
+    ok(pRtlQueryPerformanceCounter(&Counter1), "RtlQueryPerformanceCounter failed\n");
+    Status = NtQueryPerformanceCounter(&Counter2, &Frequency);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(pRtlQueryPerformanceCounter(&Counter3), "RtlQueryPerformanceCounter failed\n");
+    ok(Frequency.QuadPart != 0, "Frequency is 0\n");
+    ok(Counter1.QuadPart <= Counter2.QuadPart, "%I64d > %I64d\n", Counter1.QuadPart, Counter2.QuadPart);
+    ok(Counter2.QuadPart <= Counter3.QuadPart, "%I64d > %I64d\n", Counter2.QuadPart, Counter3.QuadPart);
+
+    /* It never goes backwards */
+    for (i = 0; i < 10000; i++)
+    {
+        pRtlQueryPerformanceCounter(&Counter2);
+        if (Counter2.QuadPart < Counter1.QuadPart)
+        {
+            ok(FALSE, "Counter went backwards: %I64d < %I64d\n", Counter2.QuadPart, Counter1.QuadPart);
+            break;
+        }
+        Counter1 = Counter2;
+    }
+
+    /* A 100 ms sleep must be close to 100 ms on the counter */
+    pRtlQueryPerformanceCounter(&Counter1);
+    Sleep(100);
+    pRtlQueryPerformanceCounter(&Counter2);
+    ok((Counter2.QuadPart - Counter1.QuadPart) * 1000 / Frequency.QuadPart >= 90,
+       "Slept only %I64d ms\n", (Counter2.QuadPart - Counter1.QuadPart) * 1000 / Frequency.QuadPart);
+    ok((Counter2.QuadPart - Counter1.QuadPart) * 1000 / Frequency.QuadPart < 1000,
+       "Slept %I64d ms\n", (Counter2.QuadPart - Counter1.QuadPart) * 1000 / Frequency.QuadPart);
+}
+
+static void Test_Benchmark(void)
+{
+    LARGE_INTEGER Frequency, Start, End, Counter;
+    ULONG i;
+
+    NtQueryPerformanceCounter(&Start, &Frequency);
+    for (i = 0; i < BENCH_COUNT; i++)
+        pRtlQueryPerformanceCounter(&Counter);
+    NtQueryPerformanceCounter(&End, NULL);
+    trace("%d RtlQueryPerformanceCounter calls: %lu ms\n", BENCH_COUNT,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+    NtQueryPerformanceCounter(&Start, NULL);
+    for (i = 0; i < BENCH_COUNT; i++)
+        NtQueryPerformanceCounter(&Counter, NULL);
+    NtQueryPerformanceCounter(&End, NULL);
+    trace("%d NtQueryPerformanceCounter calls: %lu ms\n", BENCH_COUNT,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+}
+
+START_TEST(RtlQueryPerformanceCounter)
+{
+    pRtlQueryPerformanceCounter = (PVOID)GetProcAddress(GetModuleHandleW(L"ntdll.dll"),
+                                                        "RtlQueryPerformanceCounter");
+    if (!pRtlQueryPerformanceCounter)
+    {
+        trace("RtlQueryPerformanceCounter (NT >= 6.1 API) not available, testing QueryPerformanceCounter\n");
+        pRtlQueryPerformanceCounter = QueryCounterThroughKernel32;
+    }
+
+    trace("TSC counter enabled %u, shift %u\n",
+          SharedUserTscQpcData->Enabled, SharedUserTscQpcData->Shift);
+
+    Test_Consistency();
+    Test_Benchmark();
+}
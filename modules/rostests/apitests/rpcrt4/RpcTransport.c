@@ -0,0 +1,319 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for the ncalrpc and ncacn_np transports
+ * PROGRAMMER:
+ */
+
+#include <apitest.h>
+#include <stdio.h>
+#include <rpc.h>
+
+#define PROC_ECHO           0
+#define PROC_IMPERSONATE    1
+
+#define PING_PONG_CALLS     5000
+#define PING_PONG_SIZE      16
+#define THROUGHPUT_CALLS    500
+#define THROUGHPUT_SIZE     (64 * 1024)
+
+static const RPC_SYNTAX_IDENTIFIER NdrTransferSyntax =
+{
+    {0x8a885d04, 0x1ceb, 0x11c9, {0x9f, 0xe8, 0x08, 0x00, 0x2b, 0x10, 0x48, 0x60}}, {2, 0}
+};
+
+static const RPC_SYNTAX_IDENTIFIER EchoInterfaceId =
+{
+    {0x4f0a5b6c, 0x2f1d, 0x4e8a, {0x9b, 0x31, 0x6d, 0x52, 0x0e, 0x7a, 0xc4, 0x11}}, {1, 0}
+};
+
+static void __RPC_STUB Echo(PRPC_MESSAGE Message)
+{
+    void *Request = Message->Buffer;
+    RPC_STATUS Status;
+
+    /* Hand the request back in a new buffer, as a MIDL stub would */
+    Status = I_RpcGetBuffer(Message);
+    if (Status != RPC_S_OK)
+        RpcRaiseException(Status);
+    memcpy(Message->Buffer, Request, Message->BufferLength);
+}
+
+static void __RPC_STUB Impersonate(PRPC_MESSAGE Message)
+{
+    RPC_STATUS ImpersonateStatus, Status;
+
+    ImpersonateStatus = RpcImpersonateClient(NULL);
+    if (ImpersonateStatus == RPC_S_OK)
+        RpcRevertToSelf();
+
+    Message->BufferLength = sizeof(ImpersonateStatus);
+    Status = I_RpcGetBuffer(Message);
+    if (Status != RPC_S_OK)
+        RpcRaiseException(Status);
+    memcpy(Message->Buffer, &ImpersonateStatus, sizeof(ImpersonateStatus));
+}
+
+static RPC_DISPATCH_FUNCTION EchoDispatchFunctions[] =
+{
+    Echo,
+    Impersonate
+};
+
+static RPC_DISPATCH_TABLE EchoDispatchTable =
+{
+    ARRAYSIZE(EchoDispatchFunctions), EchoDispatchFunctions, 0
+};
+
+static RPC_SERVER_INTERFACE EchoServerInterface =
+{
+    sizeof(RPC_SERVER_INTERFACE),
+    EchoInterfaceId,
+    NdrTransferSyntax,
+    &EchoDispatchTable,
+    0, NULL, NULL, NULL, 0
+};
+
+static RPC_CLIENT_INTERFACE EchoClientInterface =
+{
+    sizeof(RPC_CLIENT_INTERFACE),
+    EchoInterfaceId,
+    NdrTransferSyntax,
+    NULL,
+    0, NULL, NULL, NULL, 0
+};
+
+static
+RPC_STATUS
+CallProcedure(
+    RPC_BINDING_HANDLE Binding,
+    UINT ProcNum,
+    const void *Input,
+    UINT InputLength,
+    void *Output,
+    UINT *OutputLength)
+{
+    RPC_MESSAGE Message;
+    RPC_STATUS Status;
+
+    ZeroMemory(&Message, sizeof(Message));
+    Message.Handle = Binding;
+    Message.ProcNum = ProcNum;
+    Message.RpcInterfaceInformation = &EchoClientInterface;
+    Message.BufferLength = InputLength;
+
+    Status = I_RpcGetBuffer(&Message);
+    if (Status != RPC_S_OK)
+        return Status;
+    memcpy(Message.Buffer, Input, InputLength);
+
+    Status = I_RpcSendReceive(&Message);
+    if (Status != RPC_S_OK)
+        return Status;
+
+    if (Message.BufferLength > *OutputLength)
+        Status = RPC_S_BUFFER_TOO_SMALL;
+    else
+        memcpy(Output, Message.Buffer, Message.BufferLength);
+    *OutputLength = Message.BufferLength;
+
+    I_RpcFreeBuffer(&Message);
+    return Status;
+}
+
+static
+RPC_BINDING_HANDLE
+BindTo(
+    const char *Protseq,
+    const char *Endpoint)
+{
+    RPC_BINDING_HANDLE Binding = NULL;
+    unsigned char *StringBinding;
+    RPC_STATUS Status;
+
+    Status = RpcStringBindingComposeA(NULL, (unsigned char *)Protseq, NULL,
+                                      (unsigned char *)Endpoint, NULL, &StringBinding);
+    ok(Status == RPC_S_OK, "RpcStringBindingComposeA(%s) returned %ld\n", Protseq, Status);
+    if (Status != RPC_S_OK)
+        return NULL;
+
+    Status = RpcBindingFromStringBindingA(StringBinding, &Binding);
+    ok(Status == RPC_S_OK, "RpcBindingFromStringBindingA(%s) returned %ld\n", StringBinding, Status);
+    RpcStringFreeA(&StringBinding);
+    return (Status == RPC_S_OK) ? Binding : NULL;
+}
+
+static
+double
+ElapsedSeconds(
+    const LARGE_INTEGER *Start,
+    const LARGE_INTEGER *End)
+{
+    LARGE_INTEGER Frequency;
+
+    QueryPerformanceFrequency(&Frequency);
+    return (double)(End->QuadPart - Start->QuadPart) / (double)Frequency.QuadPart;
+}
+
+static
+double
+PingPong(
+    RPC_BINDING_HANDLE Binding)
+{
+    UCHAR Request[PING_PONG_SIZE], Reply[PING_PONG_SIZE];
+    LARGE_INTEGER Start, End;
+    UINT i, Failures = 0, ReplyLength;
+    RPC_STATUS Status;
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < PING_PONG_CALLS; i++)
+    {
+        memset(Request, (UCHAR)i, sizeof(Request));
+        ReplyLength = sizeof(Reply);
+        Status = CallProcedure(Binding, PROC_ECHO, Request, sizeof(Request), Reply, &ReplyLength);
+        if (Status != RPC_S_OK || ReplyLength != sizeof(Request) ||
+            memcmp(Request, Reply, sizeof(Request)) != 0)
+        {
+            Failures++;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(Failures == 0, "%u of %u small calls failed\n", Failures, PING_PONG_CALLS);
+    return PING_PONG_CALLS / ElapsedSeconds(&Start, &End);
+}
+
+static
+double
+Throughput(
+    RPC_BINDING_HANDLE Binding)
+{
+    PUCHAR Request, Reply;
+    LARGE_INTEGER Start, End;
+    UINT i, j, Failures = 0, ReplyLength;
+    RPC_STATUS Status;
+
+    Request = HeapAlloc(GetProcessHeap(), 0, THROUGHPUT_SIZE);
+    Reply = HeapAlloc(GetProcessHeap(), 0, THROUGHPUT_SIZE);
+    if (!Request || !Reply)
+    {
+        skip("Out of memory\n");
+        HeapFree(GetProcessHeap(), 0, Request);
+        HeapFree(GetProcessHeap(), 0, Reply);
+        return 0.0;
+    }
+    for (j = 0; j < THROUGHPUT_SIZE; j++)
+        Request[j] = (UCHAR)(j * 7);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < THROUGHPUT_CALLS; i++)
+    {
+        Request[0] = (UCHAR)i;
+        ReplyLength = THROUGHPUT_SIZE;
+        Status = CallProcedure(Binding, PROC_ECHO, Request, THROUGHPUT_SIZE, Reply, &ReplyLength);
+        if (Status != RPC_S_OK || ReplyLength != THROUGHPUT_SIZE ||
+            memcmp(Request, Reply, THROUGHPUT_SIZE) != 0)
+        {
+            Failures++;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(Failures == 0, "%u of %u large calls failed\n", Failures, THROUGHPUT_CALLS);
+    HeapFree(GetProcessHeap(), 0, Request);
+    HeapFree(GetProcessHeap(), 0, Reply);
+
+    /* Both directions carry the payload */
+    return (2.0 * THROUGHPUT_CALLS * THROUGHPUT_SIZE) / (1024.0 * 1024.0) / ElapsedSeconds(&Start, &End);
+}
+
+static
+void
+TestImpersonation(
+    RPC_BINDING_HANDLE Binding,
+    const char *Protseq)
+{
+    RPC_STATUS Status, ServerStatus = RPC_S_INTERNAL_ERROR;
+    UINT ReplyLength = sizeof(ServerStatus);
+    UCHAR Dummy = 0;
+
+    Status = CallProcedure(Binding, PROC_IMPERSONATE, &Dummy, sizeof(Dummy), &ServerStatus, &ReplyLength);
+    ok(Status == RPC_S_OK, "%s: call returned %ld\n", Protseq, Status);
+    ok(ReplyLength == sizeof(ServerStatus), "%s: reply length %u\n", Protseq, ReplyLength);
+    ok(ServerStatus == RPC_S_OK, "%s: RpcImpersonateClient returned %ld\n", Protseq, ServerStatus);
+}
+
+static
+void
+TestTransport(
+    const char *Protseq,
+    const char *Endpoint,
+    double *CallsPerSecond,
+    double *MegabytesPerSecond)
+{
+    RPC_BINDING_HANDLE Binding;
+    RPC_STATUS Status;
+
+    *CallsPerSecond = 0.0;
+    *MegabytesPerSecond = 0.0;
+
+    Binding = BindTo(Protseq, Endpoint);
+    if (!Binding)
+        return;
+
+    Status = RpcMgmtIsServerListening(Binding);
+    ok(Status == RPC_S_OK, "%s: RpcMgmtIsServerListening returned %ld\n", Protseq, Status);
+
+    TestImpersonation(Binding, Protseq);
+
+    *CallsPerSecond = PingPong(Binding);
+    *MegabytesPerSecond = Throughput(Binding);
+    trace("%s: %.0f calls/s with %u byte payloads, %.1f MB/s with %u byte payloads\n",
+          Protseq, *CallsPerSecond, PING_PONG_SIZE, *MegabytesPerSecond, THROUGHPUT_SIZE);
+
+    RpcBindingFree(&Binding);
+}
+
+START_TEST(RpcTransport)
+{
+    char LrpcEndpoint[64], PipeEndpoint[64];
+    double LrpcCalls, LrpcThroughput, PipeCalls, PipeThroughput;
+    RPC_STATUS Status;
+
+    sprintf(LrpcEndpoint, "rpcrt4_apitest_%lu", GetCurrentProcessId());
+    sprintf(PipeEndpoint, "\\pipe\\rpcrt4_apitest_%lu", GetCurrentProcessId());
+
+    Status = RpcServerUseProtseqEpA((unsigned char *)"ncalrpc", 20, (unsigned char *)LrpcEndpoint, NULL);
+    ok(Status == RPC_S_OK, "RpcServerUseProtseqEpA(ncalrpc) returned %ld\n", Status);
+    Status = RpcServerUseProtseqEpA((unsigned char *)"ncacn_np", 20, (unsigned char *)PipeEndpoint, NULL);
+    ok(Status == RPC_S_OK, "RpcServerUseProtseqEpA(ncacn_np) returned %ld\n", Status);
+
+    Status = RpcServerRegisterIf(&EchoServerInterface, NULL, NULL);
+    ok(Status == RPC_S_OK, "RpcServerRegisterIf returned %ld\n", Status);
+    if (Status != RPC_S_OK)
+        return;
+
+    Status = RpcServerListen(1, 20, TRUE);
+    ok(Status == RPC_S_OK, "RpcServerListen returned %ld\n", Status);
+    if (Status != RPC_S_OK)
+    {
+        RpcServerUnregisterIf(NULL, NULL, FALSE);
+        return;
+    }
+
+    TestTransport("ncalrpc", LrpcEndpoint, &LrpcCalls, &LrpcThroughput);
+    TestTransport("ncacn_np", PipeEndpoint, &PipeCalls, &PipeThroughput);
+
+    if (PipeCalls > 0.0 && PipeThroughput > 0.0)
+    {
+        trace("ncalrpc vs ncacn_np: %.2fx calls/s, %.2fx throughput\n",
+              LrpcCalls / PipeCalls, LrpcThroughput / PipeThroughput);
+    }
+
+    Status = RpcMgmtStopServerListening(NULL);
+    ok(Status == RPC_S_OK, "RpcMgmtStopServerListening returned %ld\n", Status);
+    Status = RpcMgmtWaitServerListen();
+    ok(Status == RPC_S_OK, "RpcMgmtWaitServerListen returned %ld\n", Status);
+    Status = RpcServerUnregisterIf(NULL, NULL, FALSE);
+    ok(Status == RPC_S_OK, "RpcServerUnregisterIf returned %ld\n", Status);
+}
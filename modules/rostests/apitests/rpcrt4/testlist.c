@@ -0,0 +1,10 @@
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_RpcTransport(void);
+
+const struct test winetest_testlist[] =
+{
+    { "RpcTransport", func_RpcTransport },
+    { 0, 0 }
+};
@@ -0,0 +1,242 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for the RSA private key operations of rsaenh
+ */
+
+#include <apitest.h>
+#include <wincrypt.h>
+
+#define MAX_TEST_KEY_BITS       2048
+#define BENCHMARK_KEY_BITS      2048
+#define BENCHMARK_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURES    50
+
+/* 512-bit key pair with the public exponent 65537 */
+static const BYTE PrivateKeyBlob[] =
+{
+    0x07, 0x02, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x52, 0x53, 0x41, 0x32,
+    0x00, 0x02, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0xdf, 0x26, 0x8b, 0xb8,
+    0x51, 0x67, 0xea, 0x5b, 0x92, 0x25, 0xe6, 0x2e, 0xb6, 0x52, 0xea, 0xe6,
+    0x1a, 0x4c, 0xd9, 0x5a, 0xe1, 0x99, 0x84, 0xc1, 0x2d, 0x7d, 0x4c, 0x3d,
+    0xfb, 0x24, 0xa8, 0x63, 0x36, 0x85, 0xed, 0x18, 0xc5, 0xdf, 0x5d, 0x9b,
+    0x71, 0xd7, 0xd2, 0x43, 0x0a, 0x6e, 0xda, 0x15, 0x7d, 0xf2, 0xb3, 0xee,
+    0x50, 0x40, 0x9e, 0x3f, 0x2d, 0xc5, 0x15, 0x65, 0xba, 0xcd, 0x0d, 0xdf,
+    0x6d, 0x6d, 0xaf, 0x94, 0x4d, 0x42, 0xd9, 0x30, 0x6a, 0xd9, 0x4b, 0xa3,
+    0x99, 0x8a, 0xa4, 0xaa, 0x0b, 0x34, 0xe2, 0xec, 0x92, 0x88, 0xcf, 0xf1,
+    0x43, 0x58, 0xf1, 0x19, 0x05, 0xe3, 0xa3, 0xf1, 0xfb, 0x31, 0x5d, 0x8c,
+    0x7d, 0x92, 0x7e, 0xcc, 0x9f, 0x0d, 0x3c, 0x0f, 0x20, 0xa3, 0xb7, 0x34,
+    0x8e, 0xf2, 0x62, 0x8e, 0xff, 0x67, 0xcb, 0x43, 0x14, 0xbb, 0x4c, 0xf7,
+    0x2d, 0x29, 0x4f, 0xec, 0x8d, 0x01, 0x2d, 0xc8, 0x31, 0x3e, 0xf6, 0x4b,
+    0x33, 0xa2, 0x9d, 0xcf, 0x47, 0x75, 0x0a, 0xb7, 0x93, 0xd3, 0x2b, 0x18,
+    0x8a, 0xf5, 0xa9, 0x34, 0x40, 0x53, 0xf2, 0x11, 0x4f, 0x2c, 0xb7, 0xd8,
+    0xf1, 0xdd, 0x03, 0x5e, 0x07, 0x3a, 0xc5, 0x0a, 0x24, 0x7f, 0x4b, 0xe7,
+    0xac, 0x36, 0xb2, 0xe5, 0x13, 0xb1, 0x45, 0x5f, 0xea, 0x0e, 0xc1, 0x71,
+    0xf0, 0x6d, 0xe6, 0xba, 0xa5, 0x76, 0x29, 0xaa, 0x57, 0xa6, 0x96, 0x92,
+    0xb3, 0x42, 0x0d, 0xca, 0x2e, 0x9d, 0xa1, 0xd0, 0xef, 0xfc, 0x06, 0x11,
+    0xd6, 0xff, 0xbd, 0x02, 0x5d, 0xb8, 0xe6, 0x38, 0xf5, 0x08, 0xcb, 0x0c,
+    0xc1, 0xf3, 0xc3, 0xeb, 0x99, 0x03, 0x6b, 0xba, 0x91, 0x64, 0x89, 0x5b,
+    0x12, 0x16, 0x68, 0x6a, 0x46, 0x41, 0x68, 0xee, 0x84, 0x87, 0xfb, 0xa4,
+    0xee, 0x81, 0x8e, 0x08, 0x09, 0x43, 0xfb, 0x12, 0xd8, 0x59, 0x71, 0x2f,
+    0x9d, 0x8c, 0xa5, 0xfe, 0x8f, 0x08, 0x92, 0x13, 0xd4, 0x2f, 0x6a, 0x04,
+    0x08, 0xec, 0xc2, 0x08, 0xfa, 0xcd, 0xbd, 0x62, 0x09, 0xcc, 0x08, 0xdc,
+    0x15, 0xa6, 0xde, 0x4e, 0x8e, 0x5f, 0xee, 0xa7
+};
+
+/* PKCS #1 v1.5 signature of the SHA-1 hash of "abc", little endian */
+static const BYTE AbcSignature[] =
+{
+    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26
+};
+
+static
+VOID
+TestKnownSignature(
+    _In_ HCRYPTPROV Provider)
+{
+    HCRYPTKEY Key;
+    HCRYPTHASH Hash;
+    BYTE Signature[64];
+    DWORD Length;
+    ULONG i;
+    BOOL Ret;
+
+    Ret = CryptImportKey(Provider, PrivateKeyBlob, sizeof(PrivateKeyBlob), 0, 0, &Key);
+    ok(Ret, "CryptImportKey failed, error %lu\n", GetLastError());
+    if (!Ret)
+        return;
+
+    /* The input is blinded with a new random number every time */
+    for (i = 0; i < 3; i++)
+    {
+        Ret = CryptCreateHash(Provider, CALG_SHA1, 0, 0, &Hash);
+        ok(Ret, "CryptCreateHash failed, error %lu\n", GetLastError());
+        if (!Ret)
+            break;
+        Ret = CryptHashData(Hash, (const BYTE *)"abc", 3, 0);
+        ok(Ret, "CryptHashData failed, error %lu\n", GetLastError());
+
+        Length = sizeof(Signature);
+        Ret = CryptSignHashW(Hash, AT_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURE, NULL, 0, Signature, &Length);
+        ok(Ret, "CryptSignHashW failed, error %lu\n", GetLastError());
+        ok_dec(Length, sizeof(AbcSignature));
+        ok(Ret && !memcmp(Signature, AbcSignature, sizeof(AbcSignature)),
+           "Signature %lu differs\n", i);
+
+        Ret = CryptVerifySignatureW(Hash, AbcSignature, sizeof(AbcSignature), Key, NULL, 0);
+        ok(Ret, "CryptVerifySignatureW failed, error %lu\n", GetLastError());
+        CryptDestroyHash(Hash);
+    }
+
+    CryptDestroyKey(Key);
+}
+
+static
+VOID
+TestRoundTrip(
+    _In_ HCRYPTPROV Provider,
+    _In_ ULONG Bits)
+{
+    HCRYPTKEY Key;
+    BYTE Plain[MAX_TEST_KEY_BITS / 8];
+    BYTE Buffer[MAX_TEST_KEY_BITS / 8];
+    DWORD Length;
+    ULONG i;
+    BOOL Ret;
+
+    Ret = CryptGenKey(Provider, AT_KEYEXCHANGE, Bits << 16, &Key);
+    ok(Ret, "CryptGenKey(%lu) failed, error %lu\n", Bits, GetLastError());
+    if (!Ret)
+        return;
+
+    for (i = 0; i < 10; i++)
+    {
+        /* PKCS #1 v1.5 padding takes at least 11 bytes */
+        Length = Bits / 8 - 11 - i;
+        CryptGenRandom(Provider, Length, Plain);
+        RtlCopyMemory(Buffer, Plain, Length);
+
+        Ret = CryptEncrypt(Key, 0, TRUE, 0, Buffer, &Length, sizeof(Buffer));
+        ok(Ret, "CryptEncrypt(%lu) failed, error %lu\n", Bits, GetLastError());
+        ok_dec(Length, Bits / 8);
+
+        Ret = CryptDecrypt(Key, 0, TRUE, 0, Buffer, &Length);
+        ok(Ret, "CryptDecrypt(%lu) failed, error %lu\n", Bits, GetLastError());
+        ok_dec(Length, Bits / 8 - 11 - i);
+        ok(Ret && !memcmp(Buffer, Plain, Length), "%lu-bit round trip %lu differs\n", Bits, i);
+    }
+
+    CryptDestroyKey(Key);
+}
+
+static
+VOID
+BenchmarkSignatures(
+    _In_ HCRYPTPROV Provider)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    HCRYPTKEY Key;
+    HCRYPTHASH Hash;
+    BYTE Signature[BENCHMARK_KEY_BITS / 8];
+    DWORD Length;
+    ULONGLONG Microseconds;
+    ULONG i;
+    BOOL Ret;
+
+    Ret = CryptGenKey(Provider, AT_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURE, BENCHMARK_KEY_BITS << 16, &Key);
+    ok(Ret, "CryptGenKey failed, error %lu\n", GetLastError());
+    if (!Ret)
+        return;
+
+    Ret = CryptCreateHash(Provider, CALG_SHA1, 0, 0, &Hash);
+    ok(Ret, "CryptCreateHash failed, error %lu\n", GetLastError());
+    if (!Ret)
+    {
+        CryptDestroyKey(Key);
+        return;
+    }
+    CryptHashData(Hash, (const BYTE *)"abc", 3, 0);
+
+    /* One private key operation, like the server side of an RSA handshake */
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCHMARK_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURES; i++)
+    {
+        Length = sizeof(Signature);
+        Ret = CryptSignHashW(Hash, AT_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURE, NULL, 0, Signature, &Length);
+        if (!Ret)
+            break;
+    }
+    QueryPerformanceCounter(&End);
+    ok(Ret, "CryptSignHashW failed, error %lu\n", GetLastError());
+
+    Microseconds = (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+    trace("%u-bit signatures: %I64u us each, %I64u per second\n",
+          BENCHMARK_KEY_BITS, Microseconds / BENCHMARK_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURES,
+          Microseconds ? BENCHMARK_    0xe9, 0x1c, 0xac, 0xe6, 0xf3, 0x62, 0x7e, 0x84, 0xe1, 0xe3, 0xef, 0x91,
+    0xd4, 0xf0, 0x96, 0xad, 0x9b, 0x01, 0x33, 0xc5, 0xe5, 0xcf, 0x1f, 0xaf,
+    0xac, 0x89, 0x78, 0xa3, 0xf3, 0xca, 0x1f, 0x8b, 0x9c, 0xd7, 0x8c, 0x74,
+    0xf0, 0x65, 0x8d, 0x66, 0xf6, 0x4c, 0xa8, 0x7a, 0xff, 0x87, 0xec, 0xac,
+    0x68, 0xb5, 0x27, 0x6d, 0x5c, 0x72, 0x0a, 0x7a, 0x07, 0x68, 0x31, 0x84,
+    0x86, 0x71, 0xfe, 0x26NATURES * 1000000ULL / Microseconds : 0);
+
+    CryptDestroyHash(Hash);
+    CryptDestroyKey(Key);
+}
+
+START_TEST(RsaPrivateKey)
+{
+    HCRYPTPROV Provider;
+    BOOL Ret;
+
+    Ret = CryptAcquireContextW(&Provider, NULL, MS_ENHANCED_PROV_W, PROV_RSA_FULL,
+                               CRYPT_VERIFYCONTEXT);
+    ok(Ret, "CryptAcquireContextW failed, error %lu\n", GetLastError());
+    if (!Ret)
+        return;
+
+    TestKnownSignature(Provider);
+
+    /* Moduli and halves that are and are not whole 64-bit limbs */
+    TestRoundTrip(Provider, 512);
+    TestRoundTrip(Provider, 1032);
+    TestRoundTrip(Provider, 2048);
+
+    BenchmarkSignatures(Provider);
+
+    CryptReleaseContext(Provider, 0);
+}
@@ -0,0 +1,10 @@
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_RsaPrivateKey(void);
+
+const struct test winetest_testlist[] =
+{
+    { "RsaPrivateKey", func_RsaPrivateKey },
+    { 0, 0 }
+};
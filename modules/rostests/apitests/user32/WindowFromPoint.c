@@ -0,0 +1,162 @@
+/*
+ * PROJECT:         ReactOS api tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * PURPOSE:         Test and benchmark for WindowFromPoint with many top level windows
+ * PROGRAMMERS:
+ */
+
+#include "precomp.h"
+
+#define GRID_X  20
+#define GRID_Y  20
+#define WND_CX  40
+#define WND_CY  20
+#define MOVE_COUNT 20000
+
+static HWND hwnds[GRID_Y][GRID_X];
+
+static void FlushMessages(void)
+{
+    MSG msg;
+
+    while (PeekMessageA(&msg, 0, 0, 0, PM_REMOVE))
+        DispatchMessageA(&msg);
+}
+
+static HWND CreatePopup(int x, int y)
+{
+    return CreateWindowExA(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE, "WindowFromPointTest", NULL,
+                           WS_POPUP | WS_VISIBLE, x, y, WND_CX, WND_CY,
+                           NULL, NULL, GetModuleHandleA(NULL), NULL);
+}
+
+static void Test_HitTesting(void)
+{
+    HWND hwnd, hwndTop;
+    POINT pt;
+    int x, y;
+
+    /* Every window must be found at its center */
+    for (y = 0; y < GRID_Y; y++)
+    {
+        for (x = 0; x < GRID_X; x++)
+        {
+            pt.x = x * WND_CX + WND_CX / 2;
+            pt.y = y * WND_CY + WND_CY / 2;
+            hwnd = WindowFromPoint(pt);
+            ok(hwnd == hwnds[y][x], "(%d,%d): expected %p, got %p\n", x, y, hwnds[y][x], hwnd);
+        }
+    }
+
+    /* Moving a window must be seen by the next hit-test */
+    pt.x = WND_CX / 2;
+    pt.y = WND_CY / 2;
+    SetWindowPos(hwnds[0][1], HWND_TOP, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOACTIVATE);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == hwnds[0][1], "Expected moved window %p, got %p\n", hwnds[0][1], hwnd);
+
+    /* Z-order changes too */
+    SetWindowPos(hwnds[0][0], HWND_TOP, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOMOVE | SWP_NOACTIVATE);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == hwnds[0][0], "Expected raised window %p, got %p\n", hwnds[0][0], hwnd);
+
+    /* Hidden windows are skipped */
+    ShowWindow(hwnds[0][0], SW_HIDE);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == hwnds[0][1], "Expected window %p, got %p\n", hwnds[0][1], hwnd);
+    ShowWindow(hwnds[0][0], SW_SHOWNA);
+
+    /* Destroyed windows are gone */
+    hwndTop = CreatePopup(0, 0);
+    ok(hwndTop != NULL, "CreateWindowExA failed\n");
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == hwndTop, "Expected new window %p, got %p\n", hwndTop, hwnd);
+    DestroyWindow(hwndTop);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == hwnds[0][0], "Expected window %p, got %p\n", hwnds[0][0], hwnd);
+
+    SetWindowPos(hwnds[0][1], NULL, WND_CX, 0, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+}
+
+static void Test_Benchmark(void)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    POINT pt;
+    int i;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    /* WindowFromPoint alone */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < MOVE_COUNT; i++)
+    {
+        pt.x = (i * 7) % (GRID_X * WND_CX);
+        pt.y = (i * 13) % (GRID_Y * WND_CY);
+        WindowFromPoint(pt);
+    }
+    QueryPerformanceCounter(&End);
+    trace("%d WindowFromPoint calls over %d windows: %lu ms\n",
+          MOVE_COUNT, GRID_X * GRID_Y,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+
+    /* Injected mouse moves, going through the raw input thread */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < MOVE_COUNT; i++)
+    {
+        pt.x = (i * 7) % (GRID_X * WND_CX);
+        pt.y = (i * 13) % (GRID_Y * WND_CY);
+        mouse_event(MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE,
+                    pt.x * 65536 / GetSystemMetrics(SM_CXSCREEN),
+                    pt.y * 65536 / GetSystemMetrics(SM_CYSCREEN), 0, 0);
+        if ((i % 64) == 0)
+            FlushMessages();
+    }
+    FlushMessages();
+    QueryPerformanceCounter(&End);
+    trace("%d injected mouse moves over %d windows: %lu ms\n",
+          MOVE_COUNT, GRID_X * GRID_Y,
+          (ULONG)((End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart));
+}
+
+START_TEST(WindowFromPoint)
+{
+    WNDCLASSA wc = { 0 };
+    int x, y;
+
+    if (GetSystemMetrics(SM_CXSCREEN) < GRID_X * WND_CX ||
+        GetSystemMetrics(SM_CYSCREEN) < GRID_Y * WND_CY)
+    {
+        skip("Screen is too small\n");
+        return;
+    }
+
+    wc.lpfnWndProc = DefWindowProcA;
+    wc.hInstance = GetModuleHandleA(NULL);
+    wc.hCursor = LoadCursorA(NULL, IDC_ARROW);
+    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
+    wc.lpszClassName = "WindowFromPointTest";
+    ok(RegisterClassA(&wc) != 0, "RegisterClassA failed\n");
+
+    for (y = 0; y < GRID_Y; y++)
+    {
+        for (x = 0; x < GRID_X; x++)
+        {
+            hwnds[y][x] = CreatePopup(x * WND_CX, y * WND_CY);
+            ok(hwnds[y][x] != NULL, "CreateWindowExA failed\n");
+            if (!hwnds[y][x])
+                return;
+        }
+    }
+    FlushMessages();
+
+    Test_HitTesting();
+    Test_Benchmark();
+
+    for (y = 0; y < GRID_Y; y++)
+    {
+        for (x = 0; x < GRID_X; x++)
+            DestroyWindow(hwnds[y][x]);
+    }
+
+    UnregisterClassA("WindowFromPointTest", GetModuleHandleA(NULL));
+}
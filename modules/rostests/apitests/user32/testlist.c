@@ -47,6 +47,7 @@ extern void func_SetScrollRange(void);
 extern void func_SwitchToThisWindow(void);
 extern void func_SystemParametersInfo(void);
 extern void func_TrackMouseEvent(void);
+extern void func_WindowFromPoint(void);
 extern void func_WndProc(void);
 extern void func_wsprintf(void);
 
@@ -96,6 +97,7 @@ const struct test winetest_testlist[] =
     { "SwitchToThisWindow", func_SwitchToThisWindow },
     { "SystemParametersInfo", func_SystemParametersInfo },
     { "TrackMouseEvent", func_TrackMouseEvent },
+    { "WindowFromPoint", func_WindowFromPoint },
     { "WndProc", func_WndProc },
     { "wsprintfApi", func_wsprintf },
     { 0, 0 }
@@ -0,0 +1,416 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for the filtered modes of IWICBitmapScaler
+ */
+
+#define COBJMACROS
+#include <apitest.h>
+#include <initguid.h>
+#include <wincodec.h>
+
+#define BENCHMARK_WIDTH     2048
+#define BENCHMARK_HEIGHT    1536
+
+static IWICImagingFactory *Factory;
+
+static const WICBitmapInterpolationMode FilteredModes[] =
+{
+    WICBitmapInterpolationModeLinear,
+    WICBitmapInterpolationModeCubic,
+    WICBitmapInterpolationModeFant
+};
+
+static
+IWICBitmap *
+CreateBitmap(
+    _In_ UINT Width,
+    _In_ UINT Height,
+    _In_ const GUID *Format,
+    _In_ UINT BytesPerPixel,
+    _In_ const BYTE *Bits)
+{
+    IWICBitmap *Bitmap;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(Factory, Width, Height, Format,
+                                                   Width * BytesPerPixel,
+                                                   Width * Height * BytesPerPixel,
+                                                   (BYTE *)Bits, &Bitmap);
+    ok(hr == S_OK, "CreateBitmapFromMemory failed, hr 0x%lx\n", hr);
+    return SUCCEEDED(hr) ? Bitmap : NULL;
+}
+
+static
+IWICBitmapScaler *
+CreateScaler(
+    _In_ IWICBitmap *Bitmap,
+    _In_ UINT Width,
+    _In_ UINT Height,
+    _In_ WICBitmapInterpolationMode Mode)
+{
+    IWICBitmapScaler *Scaler;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapScaler(Factory, &Scaler);
+    ok(hr == S_OK, "CreateBitmapScaler failed, hr 0x%lx\n", hr);
+    if (FAILED(hr))
+        return NULL;
+
+    hr = IWICBitmapScaler_Initialize(Scaler, (IWICBitmapSource *)Bitmap, Width, Height, Mode);
+    ok(hr == S_OK, "Initialize(%d) failed, hr 0x%lx\n", Mode, hr);
+    if (FAILED(hr))
+    {
+        IWICBitmapScaler_Release(Scaler);
+        return NULL;
+    }
+    return Scaler;
+}
+
+static
+VOID
+TestConstantColor(VOID)
+{
+    static const UINT Sizes[][2] = {{100, 30}, {17, 13}, {1, 1}, {64, 48}};
+    BYTE Source[64 * 48 * 4], Result[100 * 48 * 4];
+    IWICBitmapScaler *Scaler;
+    IWICBitmap *Bitmap;
+    WICPixelFormatGUID Format;
+    UINT i, Mode, Size, Mismatches;
+    HRESULT hr;
+
+    for (i = 0; i < sizeof(Source); i += 4)
+    {
+        Source[i] = 0x10;
+        Source[i + 1] = 0x80;
+        Source[i + 2] = 0xf0;
+        Source[i + 3] = 0xff;
+    }
+
+    Bitmap = CreateBitmap(64, 48, &GUID_WICPixelFormat32bppBGRA, 4, Source);
+    if (!Bitmap)
+        return;
+
+    /* The weights add up to one, a flat color must come out unchanged */
+    for (Mode = 0; Mode < ARRAYSIZE(FilteredModes); Mode++)
+    {
+        for (Size = 0; Size < ARRAYSIZE(Sizes); Size++)
+        {
+            Scaler = CreateScaler(Bitmap, Sizes[Size][0], Sizes[Size][1], FilteredModes[Mode]);
+            if (!Scaler)
+                continue;
+
+            hr = IWICBitmapScaler_GetPixelFormat(Scaler, &Format);
+            ok(hr == S_OK && IsEqualGUID(&Format, &GUID_WICPixelFormat32bppBGRA),
+               "Unexpected pixel format, hr 0x%lx\n", hr);
+
+            memset(Result, 0, sizeof(Result));
+            hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, Sizes[Size][0] * 4, sizeof(Result), Result);
+            ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+
+            Mismatches = 0;
+            for (i = 0; i < Sizes[Size][0] * Sizes[Size][1] * 4; i++)
+            {
+                if (Result[i] != Source[i % 4])
+                    Mismatches++;
+            }
+            ok(Mismatches == 0, "Mode %d, %ux%u: %u bytes changed\n",
+               FilteredModes[Mode], Sizes[Size][0], Sizes[Size][1], Mismatches);
+
+            IWICBitmapScaler_Release(Scaler);
+        }
+    }
+
+    IWICBitmap_Release(Bitmap);
+}
+
+static
+VOID
+TestFilters(VOID)
+{
+    static const BYTE Ramp[2 * 3] = {0, 0, 0, 255, 255, 255};
+    static const BYTE Steps[4] = {0, 100, 200, 50};
+    IWICBitmapScaler *Scaler;
+    IWICBitmap *Bitmap;
+    BYTE Result[16 * 3];
+    HRESULT hr;
+
+    /* Linear samples between the pixel centers and clamps at the edges */
+    Bitmap = CreateBitmap(2, 1, &GUID_WICPixelFormat24bppBGR, 3, Ramp);
+    if (Bitmap)
+    {
+        Scaler = CreateScaler(Bitmap, 4, 1, WICBitmapInterpolationModeLinear);
+        if (Scaler)
+        {
+            hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, 4 * 3, sizeof(Result), Result);
+            ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+            ok_int(Result[0], 0);
+            ok_int(Result[3], 64);
+            ok_int(Result[6], 191);
+            ok_int(Result[9], 255);
+            ok_int(Result[7], Result[6]);
+            ok_int(Result[8], Result[6]);
+            IWICBitmapScaler_Release(Scaler);
+        }
+
+        /* Cubic overshoots between the samples but stays in range */
+        Scaler = CreateScaler(Bitmap, 16, 1, WICBitmapInterpolationModeCubic);
+        if (Scaler)
+        {
+            hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, 16 * 3, sizeof(Result), Result);
+            ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+            ok_int(Result[0], 0);
+            ok_int(Result[15 * 3], 255);
+            ok(Result[7 * 3] < Result[8 * 3], "Not increasing: %u, %u\n", Result[7 * 3], Result[8 * 3]);
+            IWICBitmapScaler_Release(Scaler);
+        }
+        IWICBitmap_Release(Bitmap);
+    }
+
+    /* Fant averages the pixels covered by each destination pixel */
+    Bitmap = CreateBitmap(4, 1, &GUID_WICPixelFormat8bppGray, 1, Steps);
+    if (Bitmap)
+    {
+        Scaler = CreateScaler(Bitmap, 2, 1, WICBitmapInterpolationModeFant);
+        if (Scaler)
+        {
+            hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, 4, sizeof(Result), Result);
+            ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+            ok_int(Result[0], 50);
+            ok_int(Result[1], 125);
+            IWICBitmapScaler_Release(Scaler);
+        }
+
+        Scaler = CreateScaler(Bitmap, 1, 1, WICBitmapInterpolationModeFant);
+        if (Scaler)
+        {
+            hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, 4, sizeof(Result), Result);
+            ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+            ok_int(Result[0], 88);
+            IWICBitmapScaler_Release(Scaler);
+        }
+        IWICBitmap_Release(Bitmap);
+    }
+}
+
+static
+VOID
+TestAlphaEdge(VOID)
+{
+    /* A transparent green column next to an opaque blue one */
+    static const BYTE Edge[2 * 2 * 4] =
+    {
+        0, 255, 0, 0,   255, 0, 0, 255,
+        0, 255, 0, 0,   255, 0, 0, 255
+    };
+    IWICBitmapScaler *Scaler;
+    IWICBitmap *Bitmap;
+    BYTE Result[4 * 4 * 4];
+    UINT i, Mode;
+    HRESULT hr;
+
+    Bitmap = CreateBitmap(2, 2, &GUID_WICPixelFormat32bppBGRA, 4, Edge);
+    if (!Bitmap)
+        return;
+
+    /* The color of the transparent pixels must not show through */
+    for (Mode = 0; Mode < ARRAYSIZE(FilteredModes); Mode++)
+    {
+        Scaler = CreateScaler(Bitmap, 4, 4, FilteredModes[Mode]);
+        if (!Scaler)
+            continue;
+
+        hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, 4 * 4, sizeof(Result), Result);
+        ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+
+        for (i = 0; i < 4 * 4 * 4; i += 4)
+        {
+            ok(Result[i + 1] == 0, "Mode %d, pixel %u: green is %u\n",
+               FilteredModes[Mode], i / 4, Result[i + 1]);
+            ok(Result[i] == (Result[i + 3] ? 255 : 0), "Mode %d, pixel %u: blue is %u, alpha %u\n",
+               FilteredModes[Mode], i / 4, Result[i], Result[i + 3]);
+        }
+        ok_int(Result[3], 0);
+        ok_int(Result[15], 255);
+        ok(Result[7] > 0 && Result[7] < 255, "Mode %d: alpha %u at the edge\n",
+           FilteredModes[Mode], Result[7]);
+
+        IWICBitmapScaler_Release(Scaler);
+    }
+
+    IWICBitmap_Release(Bitmap);
+}
+
+static
+VOID
+TestScanlines(VOID)
+{
+    const UINT Width = 97, Height = 61, DstWidth = 150, DstHeight = 40;
+    PBYTE Source, Whole, Lines;
+    IWICBitmapScaler *Scaler;
+    IWICBitmap *Bitmap;
+    WICRect Rect;
+    UINT i, Mode, y;
+    HRESULT hr;
+
+    Source = HeapAlloc(GetProcessHeap(), 0, Width * Height * 3);
+    Whole = HeapAlloc(GetProcessHeap(), 0, DstWidth * DstHeight * 3);
+    Lines = HeapAlloc(GetProcessHeap(), 0, DstWidth * DstHeight * 3);
+    if (!Source || !Whole || !Lines)
+    {
+        skip("Out of memory\n");
+        goto Quit;
+    }
+
+    for (i = 0; i < Width * Height * 3; i++)
+        Source[i] = (BYTE)(i * 7 + i / (Width * 3) * 13);
+
+    Bitmap = CreateBitmap(Width, Height, &GUID_WICPixelFormat24bppBGR, 3, Source);
+    if (!Bitmap)
+        goto Quit;
+
+    /* One scanline at a time, as MSDN recommends, or all at once */
+    for (Mode = 0; Mode < ARRAYSIZE(FilteredModes); Mode++)
+    {
+        Scaler = CreateScaler(Bitmap, DstWidth, DstHeight, FilteredModes[Mode]);
+        if (!Scaler)
+            continue;
+
+        hr = IWICBitmapScaler_CopyPixels(Scaler, NULL, DstWidth * 3, DstWidth * DstHeight * 3, Whole);
+        ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+
+        Rect.X = 0;
+        Rect.Width = DstWidth;
+        Rect.Height = 1;
+        for (y = 0; y < DstHeight; y++)
+        {
+            Rect.Y = y;
+            hr = IWICBitmapScaler_CopyPixels(Scaler, &Rect, DstWidth * 3, DstWidth * 3, Lines + y * DstWidth * 3);
+            ok(hr == S_OK, "CopyPixels(%u) failed, hr 0x%lx\n", y, hr);
+        }
+        ok(!memcmp(Whole, Lines, DstWidth * DstHeight * 3), "Mode %d: scanlines differ\n", FilteredModes[Mode]);
+
+        /* A sub-rectangle gets the same pixels */
+        Rect.X = 10;
+        Rect.Y = 5;
+        Rect.Width = 20;
+        Rect.Height = 3;
+        hr = IWICBitmapScaler_CopyPixels(Scaler, &Rect, 20 * 3, 20 * 3 * 3, Lines);
+        ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+        for (y = 0; y < 3; y++)
+        {
+            ok(!memcmp(Lines + y * 20 * 3, Whole + ((5 + y) * DstWidth + 10) * 3, 20 * 3),
+               "Mode %d: row %u of the rectangle differs\n", FilteredModes[Mode], y);
+        }
+
+        IWICBitmapScaler_Release(Scaler);
+    }
+
+    IWICBitmap_Release(Bitmap);
+
+Quit:
+    HeapFree(GetProcessHeap(), 0, Lines);
+    HeapFree(GetProcessHeap(), 0, Whole);
+    HeapFree(GetProcessHeap(), 0, Source);
+}
+
+static
+VOID
+BenchmarkScaling(VOID)
+{
+    static const UINT Sizes[][2] = {{BENCHMARK_WIDTH / 4, BENCHMARK_HEIGHT / 4}, {BENCHMARK_WIDTH * 3 / 2, BENCHMARK_HEIGHT * 3 / 2}};
+    static const WICBitmapInterpolationMode Modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant
+    };
+    LARGE_INTEGER Frequency, Start, End;
+    IWICBitmapScaler *Scaler;
+    IWICBitmap *Bitmap;
+    PBYTE Source, Result;
+    WICRect Rect;
+    ULONGLONG Elapsed;
+    UINT i, Mode, Size, y;
+    HRESULT hr;
+
+    Source = HeapAlloc(GetProcessHeap(), 0, BENCHMARK_WIDTH * BENCHMARK_HEIGHT * 4);
+    Result = HeapAlloc(GetProcessHeap(), 0, Sizes[1][0] * 4);
+    if (!Source || !Result)
+    {
+        skip("Out of memory\n");
+        goto Quit;
+    }
+
+    for (i = 0; i < BENCHMARK_WIDTH * BENCHMARK_HEIGHT * 4; i++)
+        Source[i] = (BYTE)(i ^ (i >> 13));
+
+    Bitmap = CreateBitmap(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, &GUID_WICPixelFormat32bppBGRA, 4, Source);
+    if (!Bitmap)
+        goto Quit;
+
+    QueryPerformanceFrequency(&Frequency);
+    for (Mode = 0; Mode < ARRAYSIZE(Modes); Mode++)
+    {
+        for (Size = 0; Size < ARRAYSIZE(Sizes); Size++)
+        {
+            Scaler = CreateScaler(Bitmap, Sizes[Size][0], Sizes[Size][1], Modes[Mode]);
+            if (!Scaler)
+                continue;
+
+            Rect.X = 0;
+            Rect.Width = Sizes[Size][0];
+            Rect.Height = 1;
+
+            QueryPerformanceCounter(&Start);
+            for (y = 0; y < Sizes[Size][1]; y++)
+            {
+                Rect.Y = y;
+                hr = IWICBitmapScaler_CopyPixels(Scaler, &Rect, Sizes[Size][0] * 4, Sizes[Size][0] * 4, Result);
+                if (FAILED(hr))
+                    break;
+            }
+            QueryPerformanceCounter(&End);
+            ok(hr == S_OK, "CopyPixels failed, hr 0x%lx\n", hr);
+
+            Elapsed = (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+            trace("mode %d, %ux%u to %ux%u: %I64u us (%I64u Mpixels/s)\n",
+                  Modes[Mode], BENCHMARK_WIDTH, BENCHMARK_HEIGHT, Sizes[Size][0], Sizes[Size][1], Elapsed,
+                  Elapsed ? (ULONGLONG)Sizes[Size][0] * Sizes[Size][1] / Elapsed : 0);
+
+            IWICBitmapScaler_Release(Scaler);
+        }
+    }
+
+    IWICBitmap_Release(Bitmap);
+
+Quit:
+    HeapFree(GetProcessHeap(), 0, Result);
+    HeapFree(GetProcessHeap(), 0, Source);
+}
+
+START_TEST(BitmapScaler)
+{
+    HRESULT hr;
+
+    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+                          &IID_IWICImagingFactory, (void **)&Factory);
+    if (FAILED(hr))
+    {
+        skip("No imaging factory, hr 0x%lx\n", hr);
+        CoUninitialize();
+        return;
+    }
+
+    TestConstantColor();
+    TestFilters();
+    TestAlphaEdge();
+    TestScanlines();
+    BenchmarkScaling();
+
+    IWICImagingFactory_Release(Factory);
+    CoUninitialize();
+}
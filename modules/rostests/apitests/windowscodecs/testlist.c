@@ -0,0 +1,10 @@
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_BitmapScaler(void);
+
+const struct test winetest_testlist[] =
+{
+    { "BitmapScaler", func_BitmapScaler },
+    { 0, 0 }
+};
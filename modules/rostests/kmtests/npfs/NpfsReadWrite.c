@@ -569,6 +569,103 @@ TestReadWrite(
     FinishWorkerThread(&ConnectContext);
 }
 
+#define THROUGHPUT_MAX_SIZE     (1024 * 1024)
+#define THROUGHPUT_ITERATIONS   64
+
+static KSTART_ROUTINE TestThroughput;
+static
+VOID
+NTAPI
+TestThroughput(
+    IN PVOID Context)
+{
+    PREAD_WRITE_TEST_CONTEXT TestContext = Context;
+    PCWSTR PipePath = TestContext->PipePath;
+    NTSTATUS Status;
+    HANDLE ServerHandle;
+    HANDLE ClientHandle;
+    LARGE_INTEGER DefaultTimeout;
+    LARGE_INTEGER Frequency, Start, End;
+    THREAD_CONTEXT ConnectContext;
+    THREAD_CONTEXT ClientReadContext;
+    THREAD_CONTEXT ServerWriteContext;
+    BOOLEAN Okay;
+    PUCHAR ReadBuffer;
+    PUCHAR WriteBuffer;
+    ULONG Size, Iteration, Failures, i;
+
+    ReadBuffer = ExAllocatePoolWithTag(PagedPool, THROUGHPUT_MAX_SIZE, 'TRmK');
+    WriteBuffer = ExAllocatePoolWithTag(PagedPool, THROUGHPUT_MAX_SIZE, 'TRmK');
+    if (skip(ReadBuffer && WriteBuffer, "Out of memory\n"))
+    {
+        if (ReadBuffer) ExFreePoolWithTag(ReadBuffer, 'TRmK');
+        if (WriteBuffer) ExFreePoolWithTag(WriteBuffer, 'TRmK');
+        return;
+    }
+
+    for (i = 0; i < THROUGHPUT_MAX_SIZE; i++)
+        WriteBuffer[i] = (UCHAR)(i * 7 + i / 256);
+
+    StartWorkerThread(&ConnectContext);
+    StartWorkerThread(&ClientReadContext);
+    StartWorkerThread(&ServerWriteContext);
+
+    DefaultTimeout.QuadPart = -50 * 1000 * 10;
+
+    Status = MakeServer(&ServerHandle, PipePath, TRUE);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Okay = CheckConnectPipe(&ConnectContext, PipePath, TRUE, 100);
+    ok_bool_true(Okay, "CheckConnectPipe returned");
+    ok_eq_hex(ConnectContext.Connect.Status, STATUS_SUCCESS);
+    ClientHandle = ConnectContext.Connect.ClientHandle;
+
+    /* Reads are posted first, so that writes go straight into the reader's buffer */
+    for (Size = 64; Size <= THROUGHPUT_MAX_SIZE; Size *= 4)
+    {
+        Failures = 0;
+        KeQueryPerformanceCounter(&Frequency);
+        Start = KeQueryPerformanceCounter(NULL);
+        for (Iteration = 0; Iteration < THROUGHPUT_ITERATIONS; Iteration++)
+        {
+            RtlFillMemory(ReadBuffer, Size, 0x55);
+            CheckReadPipe(&ClientReadContext, ClientHandle, ReadBuffer, Size, 0);
+            CheckWritePipe(&ServerWriteContext, ServerHandle, WriteBuffer, Size, 0);
+            if (!WaitForWork(&ServerWriteContext, 5000) ||
+                !WaitForWork(&ClientReadContext, 5000) ||
+                ServerWriteContext.ReadWrite.Status != STATUS_SUCCESS ||
+                ClientReadContext.ReadWrite.Status != STATUS_SUCCESS ||
+                ClientReadContext.ReadWrite.BytesTransferred != Size)
+            {
+                Failures++;
+                break;
+            }
+        }
+        End = KeQueryPerformanceCounter(NULL);
+
+        ok_eq_ulong(Failures, 0UL);
+        ok(RtlCompareMemory(ReadBuffer, WriteBuffer, Size) == Size,
+           "Data mismatch for %lu bytes\n", Size);
+        trace("%lu x %lu bytes in %I64u us\n",
+              (ULONG)THROUGHPUT_ITERATIONS, Size,
+              (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart);
+        CheckServerQuota(ServerHandle, 0, 0); CheckClientQuota(ClientHandle, 0, 0);
+        if (Failures)
+            break;
+    }
+
+    Status = ObCloseHandle(ClientHandle, KernelMode);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    Status = ObCloseHandle(ServerHandle, KernelMode);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    FinishWorkerThread(&ServerWriteContext);
+    FinishWorkerThread(&ClientReadContext);
+    FinishWorkerThread(&ConnectContext);
+
+    ExFreePoolWithTag(WriteBuffer, 'TRmK');
+    ExFreePoolWithTag(ReadBuffer, 'TRmK');
+}
+
 START_TEST(NpfsReadWrite)
 {
     PKTHREAD Thread;
@@ -595,4 +692,7 @@ START_TEST(NpfsReadWrite)
     TestContext.ClientSynchronous = FALSE;
     Thread = KmtStartThread(TestReadWrite, &TestContext);
     KmtFinishThread(Thread, NULL);
+
+    Thread = KmtStartThread(TestThroughput, &TestContext);
+    KmtFinishThread(Thread, NULL);
 }
@@ -47,6 +47,164 @@ TestTimerFunctional(
     CheckTimer(Timer, TimerNotificationObject + Type, 0L, FALSE, OriginalIrql, (PVOID *)NULL, 0);
 }
 
+#define STRESS_TIMERS       4096
+#define STRESS_NEAR_TIMERS  (STRESS_TIMERS / 4)
+
+typedef struct _STRESS_TIMER
+{
+    KTIMER Timer;
+    KDPC Dpc;
+} STRESS_TIMER, *PSTRESS_TIMER;
+
+static volatile LONG StressExpired;
+
+static
+VOID
+NTAPI
+StressDpcRoutine(
+    IN PKDPC Dpc,
+    IN PVOID DeferredContext,
+    IN PVOID SystemArgument1,
+    IN PVOID SystemArgument2)
+{
+    InterlockedIncrement(&StressExpired);
+}
+
+static
+ULONGLONG
+ElapsedMicroseconds(
+    IN LARGE_INTEGER Start)
+{
+    LARGE_INTEGER End, Frequency;
+
+    End = KeQueryPerformanceCounter(&Frequency);
+    return (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+}
+
+static
+VOID
+TestTimerStress(VOID)
+{
+    /* Near timers stay in the timer table, the others go to each wheel level and beyond */
+    static const LONGLONG FarDueTimes[] =
+    {
+        -10LL * 60 * 10000000,          /* 10 minutes */
+        -2LL * 24 * 3600 * 10000000,    /* 2 days */
+        -365LL * 24 * 3600 * 10000000,  /* A year */
+    };
+    PSTRESS_TIMER Timers;
+    KTIMER WheelTimer;
+    LARGE_INTEGER DueTime, Start, Timeout;
+    ULONG i, Canceled = 0;
+    NTSTATUS Status;
+
+    Timers = ExAllocatePoolWithTag(NonPagedPool, STRESS_TIMERS * sizeof(*Timers), 'TmtK');
+    if (skip(Timers != NULL, "Out of memory\n"))
+        return;
+
+    StressExpired = 0;
+    for (i = 0; i < STRESS_TIMERS; i++)
+    {
+        KeInitializeTimer(&Timers[i].Timer);
+        KeInitializeDpc(&Timers[i].Dpc, StressDpcRoutine, NULL);
+    }
+
+    /* Insert them all */
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < STRESS_TIMERS; i++)
+    {
+        if (i < STRESS_NEAR_TIMERS)
+            DueTime.QuadPart = -(LONGLONG)(100 + i % 200) * 10000;
+        else
+            DueTime.QuadPart = FarDueTimes[i % RTL_NUMBER_OF(FarDueTimes)] - i;
+        ok_bool_false(KeSetTimer(&Timers[i].Timer, DueTime, &Timers[i].Dpc), "KeSetTimer returned");
+    }
+    trace("%lu timers inserted in %I64u us\n", STRESS_TIMERS, ElapsedMicroseconds(Start));
+
+    /* Cancel the far ones, they all have to be found again */
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = STRESS_NEAR_TIMERS; i < STRESS_TIMERS; i++)
+    {
+        if (KeCancelTimer(&Timers[i].Timer))
+            Canceled++;
+    }
+    trace("%lu timers canceled in %I64u us\n", STRESS_TIMERS - STRESS_NEAR_TIMERS, ElapsedMicroseconds(Start));
+    ok_eq_ulong(Canceled, STRESS_TIMERS - STRESS_NEAR_TIMERS);
+
+    /* Wait for the near ones to expire */
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < 50 && StressExpired < STRESS_NEAR_TIMERS; i++)
+    {
+        Timeout.QuadPart = -100 * 10000;
+        KeDelayExecutionThread(KernelMode, FALSE, &Timeout);
+    }
+    trace("%ld timers expired in %I64u us\n", StressExpired, ElapsedMicroseconds(Start));
+    ok_eq_long(StressExpired, STRESS_NEAR_TIMERS);
+    for (i = 0; i < STRESS_TIMERS; i++)
+    {
+        ok_eq_bool(KeReadStateTimer(&Timers[i].Timer), i < STRESS_NEAR_TIMERS);
+        ok_bool_false(KeCancelTimer(&Timers[i].Timer), "KeCancelTimer returned");
+    }
+
+    ExFreePoolWithTag(Timers, 'TmtK');
+
+    /* A timer due after the first table round has to come back from the wheel */
+    KeInitializeTimer(&WheelTimer);
+    DueTime.QuadPart = -(LONGLONG)KeQueryTimeIncrement() * (2 * TIMER_TABLE_SIZE + 64);
+    KeSetTimer(&WheelTimer, DueTime, NULL);
+    Timeout.QuadPart = DueTime.QuadPart * 2;
+    Status = KeWaitForSingleObject(&WheelTimer, Executive, KernelMode, FALSE, &Timeout);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    KeCancelTimer(&WheelTimer);
+}
+
+/* Provided by ntoskrnl_vista, only declared for Windows 7 and later */
+BOOLEAN
+NTAPI
+KeSetCoalescableTimer(
+    IN OUT PKTIMER Timer,
+    IN LARGE_INTEGER DueTime,
+    IN ULONG Period,
+    IN ULONG TolerableDelay,
+    IN PKDPC Dpc OPTIONAL);
+
+static
+VOID
+TestCoalescableTimer(VOID)
+{
+    KTIMER Timer1, Timer2;
+    LARGE_INTEGER DueTime;
+    ULONGLONG Increment = KeQueryTimeIncrement();
+    ULONGLONG Granularity = Increment;
+
+    KeInitializeTimer(&Timer1);
+    KeInitializeTimer(&Timer2);
+
+    /* Get two absolute deadlines one tick apart, right after a multiple of the granularity */
+    while (Granularity * 2 <= 1000 * 10000)
+        Granularity *= 2;
+    KeQuerySystemTime(&DueTime);
+    DueTime.QuadPart = (DueTime.QuadPart / Granularity + 100) * Granularity + 1;
+
+    /* With a large enough tolerance, they are merged */
+    KeSetCoalescableTimer(&Timer1, DueTime, 0, 1000, NULL);
+    DueTime.QuadPart += Increment;
+    KeSetCoalescableTimer(&Timer2, DueTime, 0, 1000, NULL);
+    ok_eq_ulonglong(Timer2.DueTime.QuadPart, Timer1.DueTime.QuadPart);
+
+    /* Without tolerance, they stay apart */
+    DueTime.QuadPart -= Increment;
+    KeSetCoalescableTimer(&Timer1, DueTime, 0, 0, NULL);
+    DueTime.QuadPart += Increment;
+    KeSetCoalescableTimer(&Timer2, DueTime, 0, 0, NULL);
+    ok(Timer2.DueTime.QuadPart > Timer1.DueTime.QuadPart,
+       "Due times %I64u and %I64u were coalesced\n",
+       Timer1.DueTime.QuadPart, Timer2.DueTime.QuadPart);
+
+    KeCancelTimer(&Timer1);
+    KeCancelTimer(&Timer2);
+}
+
 START_TEST(KeTimer)
 {
     KTIMER Timer;
@@ -54,6 +212,9 @@ START_TEST(KeTimer)
     KIRQL Irqls[] = { PASSIVE_LEVEL, APC_LEVEL, DISPATCH_LEVEL, HIGH_LEVEL };
     INT i;
 
+    TestTimerStress();
+    TestCoalescableTimer();
+
     for (i = 0; i < sizeof Irqls / sizeof Irqls[0]; ++i)
     {
         /* DRIVER_IRQL_NOT_LESS_OR_EQUAL (TODO: on MP only?) */
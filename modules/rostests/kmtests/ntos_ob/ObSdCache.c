@@ -0,0 +1,151 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         LGPLv2.1+ - See COPYING.LIB in the top level directory
+ * PURPOSE:         Kernel-Mode Test Suite security descriptor cache test
+ */
+
+#include <kmt_test.h>
+
+#define STABLE_COUNT    8
+#define CHURN_COUNT     64
+#define THREAD_COUNT    4
+#define ITERATIONS      20000
+
+typedef struct _TEST_SD
+{
+    SECURITY_DESCRIPTOR_RELATIVE Header;
+    UCHAR Owner[SECURITY_MAX_SID_SIZE];
+} TEST_SD, *PTEST_SD;
+
+typedef struct _TEST_CONTEXT
+{
+    BOOLEAN Churn;
+    ULONG Mismatches;
+    ULONG Failures;
+} TEST_CONTEXT, *PTEST_CONTEXT;
+
+static TEST_SD StableSds[STABLE_COUNT];
+static TEST_SD ChurnSds[CHURN_COUNT];
+static PSECURITY_DESCRIPTOR StableCached[STABLE_COUNT];
+
+static
+VOID
+InitializeTestSd(
+    _Out_ PTEST_SD Sd,
+    _In_ ULONG Group,
+    _In_ ULONG Index)
+{
+    SID_IDENTIFIER_AUTHORITY Authority = SECURITY_NT_AUTHORITY;
+    PISID Sid = (PISID)Sd->Owner;
+
+    /* A distinct owner SID makes each descriptor distinct */
+    RtlZeroMemory(Sd, sizeof(*Sd));
+    RtlInitializeSid(Sid, &Authority, 3);
+    *RtlSubAuthoritySid(Sid, 0) = 0x4b4d5431;
+    *RtlSubAuthoritySid(Sid, 1) = Group;
+    *RtlSubAuthoritySid(Sid, 2) = Index;
+
+    Sd->Header.Revision = SECURITY_DESCRIPTOR_REVISION;
+    Sd->Header.Control = SE_SELF_RELATIVE;
+    Sd->Header.Owner = FIELD_OFFSET(TEST_SD, Owner);
+}
+
+static
+VOID
+NTAPI
+SdCacheThread(
+    _In_ PVOID Context)
+{
+    PTEST_CONTEXT TestContext = Context;
+    PSECURITY_DESCRIPTOR Cached;
+    PTEST_SD Sd;
+    ULONG i, Index, Length;
+    NTSTATUS Status;
+
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        /* Churners create and destroy entries, lookups hit existing ones */
+        Index = (i * 7 + (ULONG)(ULONG_PTR)PsGetCurrentThreadId()) % CHURN_COUNT;
+        Sd = TestContext->Churn ? &ChurnSds[Index] : &StableSds[Index % STABLE_COUNT];
+        Length = RtlLengthSecurityDescriptor(&Sd->Header);
+
+        Status = ObLogSecurityDescriptor(&Sd->Header, &Cached, 1);
+        if (!NT_SUCCESS(Status))
+        {
+            TestContext->Failures++;
+            continue;
+        }
+
+        /* Whatever we got must still be the descriptor we asked for */
+        if (RtlCompareMemory(Cached, Sd, Length) != Length)
+            TestContext->Mismatches++;
+        if (!TestContext->Churn && Cached != StableCached[Index % STABLE_COUNT])
+            TestContext->Mismatches++;
+
+        ObDereferenceSecurityDescriptor(Cached, 1);
+    }
+
+    PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
+START_TEST(ObSdCache)
+{
+    TEST_CONTEXT Contexts[THREAD_COUNT];
+    PKTHREAD Threads[THREAD_COUNT];
+    PSECURITY_DESCRIPTOR Cached;
+    NTSTATUS Status;
+    ULONG i;
+
+    for (i = 0; i < STABLE_COUNT; i++)
+        InitializeTestSd(&StableSds[i], 1, i);
+    for (i = 0; i < CHURN_COUNT; i++)
+        InitializeTestSd(&ChurnSds[i], 2, i);
+
+    /* Logging the same descriptor twice gives the same cached copy */
+    Status = ObLogSecurityDescriptor(&ChurnSds[0].Header, &Cached, 1);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!skip(NT_SUCCESS(Status), "No cached descriptor\n"))
+    {
+        PSECURITY_DESCRIPTOR Cached2;
+
+        ok(Cached != &ChurnSds[0].Header, "The descriptor wasn't copied\n");
+        Status = ObLogSecurityDescriptor(&ChurnSds[0].Header, &Cached2, 2);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok_eq_pointer(Cached2, Cached);
+        if (NT_SUCCESS(Status))
+            ObDereferenceSecurityDescriptor(Cached2, 2);
+        ObDereferenceSecurityDescriptor(Cached, 1);
+    }
+
+    /* Keep the stable descriptors alive for the whole run */
+    for (i = 0; i < STABLE_COUNT; i++)
+    {
+        Status = ObLogSecurityDescriptor(&StableSds[i].Header, &StableCached[i], 1);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        if (skip(NT_SUCCESS(Status), "No cached descriptor\n"))
+        {
+            while (i--)
+                ObDereferenceSecurityDescriptor(StableCached[i], 1);
+            return;
+        }
+    }
+
+    /* Half of the threads churn entries while the others look up */
+    for (i = 0; i < THREAD_COUNT; i++)
+    {
+        Contexts[i].Churn = (i % 2) == 0;
+        Contexts[i].Mismatches = 0;
+        Contexts[i].Failures = 0;
+        Threads[i] = KmtStartThread(SdCacheThread, &Contexts[i]);
+    }
+
+    for (i = 0; i < THREAD_COUNT; i++)
+    {
+        KmtFinishThread(Threads[i], NULL);
+        ok(Contexts[i].Mismatches == 0, "Thread %lu got %lu wrong descriptors\n", i, Contexts[i].Mismatches);
+        ok(Contexts[i].Failures == 0, "Thread %lu failed %lu lookups\n", i, Contexts[i].Failures);
+    }
+
+    for (i = 0; i < STABLE_COUNT; i++)
+        ObDereferenceSecurityDescriptor(StableCached[i], 1);
+}
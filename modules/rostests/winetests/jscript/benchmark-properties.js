@@ -0,0 +1,141 @@
+/*
+ * Property access benchmarks for the jscript winetest
+ *
+ * Small kernels in the spirit of the SunSpider access and 3d tests, spending
+ * their time in member lookups, method calls through prototypes and global
+ * identifier lookups. Each kernel checks its result and throws on mismatch.
+ */
+
+function check(name, got, expected) {
+    if(got !== expected)
+        throw name + ": got " + got + ", expected " + expected;
+}
+
+/* N-body style updates of the fields of a few objects */
+function Body(x, y, z, vx, vy, vz, mass) {
+    this.x = x;
+    this.y = y;
+    this.z = z;
+    this.vx = vx;
+    this.vy = vy;
+    this.vz = vz;
+    this.mass = mass;
+}
+
+function advance(bodies, dt) {
+    var i, j, bi, bj, dx, dy, dz, d2, mag;
+
+    for(i = 0; i < bodies.length; i++) {
+        bi = bodies[i];
+        for(j = i + 1; j < bodies.length; j++) {
+            bj = bodies[j];
+            dx = bi.x - bj.x;
+            dy = bi.y - bj.y;
+            dz = bi.z - bj.z;
+            d2 = dx * dx + dy * dy + dz * dz + 1;
+            mag = dt / (d2 * Math.sqrt(d2));
+            bi.vx -= dx * bj.mass * mag;
+            bi.vy -= dy * bj.mass * mag;
+            bi.vz -= dz * bj.mass * mag;
+            bj.vx += dx * bi.mass * mag;
+            bj.vy += dy * bi.mass * mag;
+            bj.vz += dz * bi.mass * mag;
+        }
+    }
+    for(i = 0; i < bodies.length; i++) {
+        bi = bodies[i];
+        bi.x += dt * bi.vx;
+        bi.y += dt * bi.vy;
+        bi.z += dt * bi.vz;
+    }
+}
+
+function runBodies() {
+    var bodies = [], i, sum = 0;
+
+    for(i = 0; i < 5; i++)
+        bodies.push(new Body(i, i * 2 - 3, 1 - i, 0.1 * i, 0, -0.1 * i, 1 + i));
+    for(i = 0; i < 2000; i++)
+        advance(bodies, 0.01);
+    for(i = 0; i < bodies.length; i++)
+        sum += bodies[i].x + bodies[i].y + bodies[i].z;
+    check("bodies", Math.round(sum * 100), 1950);
+}
+
+/* Binary trees, allocating objects and walking them through a method */
+function TreeNode(left, right, item) {
+    this.left = left;
+    this.right = right;
+    this.item = item;
+}
+
+TreeNode.prototype.check = function() {
+    if(!this.left)
+        return this.item;
+    return this.item + this.left.check() - this.right.check();
+};
+
+function bottomUpTree(item, depth) {
+    if(!depth)
+        return new TreeNode(null, null, item);
+    return new TreeNode(bottomUpTree(2 * item - 1, depth - 1), bottomUpTree(2 * item, depth - 1), item);
+}
+
+function runTrees() {
+    var depth, i, sum = 0;
+
+    for(depth = 4; depth <= 8; depth += 2) {
+        for(i = 1; i <= 16; i++)
+            sum += bottomUpTree(i, depth).check() + bottomUpTree(-i, depth).check();
+    }
+    check("trees", sum, -96);
+}
+
+/* Method calls on objects of two layouts sharing a prototype, and global function calls */
+function Vector(x, y) {
+    this.x = x;
+    this.y = y;
+}
+
+Vector.prototype.add = function(v) {
+    return new Vector(this.x + v.x, this.y + v.y);
+};
+
+Vector.prototype.dot = function(v) {
+    return this.x * v.x + this.y * v.y;
+};
+
+function scale(v, f) {
+    return new Vector(v.x * f, v.y * f);
+}
+
+function runVectors() {
+    var a = new Vector(1, 2), b, i, sum = 0;
+
+    b = new Vector(3, 4);
+    b.tag = "tagged";
+    for(i = 0; i < 20000; i++) {
+        a = scale(a.add(b), 0.5);
+        sum += a.dot(b) % 7;
+    }
+    check("vectors", Math.round(sum), 79993);
+}
+
+/* Objects used as dictionaries with computed names */
+function runDictionary() {
+    var dict = {}, i, sum = 0, key;
+
+    for(i = 0; i < 500; i++)
+        dict["k" + i] = i;
+    for(i = 0; i < 20000; i++) {
+        key = "k" + (i * 7 % 500);
+        dict[key] += 1;
+        sum += dict[key];
+    }
+    check("dictionary", sum, 5400000);
+}
+
+runBodies();
+runTrees();
+runVectors();
+runDictionary();
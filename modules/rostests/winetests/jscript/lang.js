@@ -1867,6 +1867,65 @@ function returnTest() {
 
 ok(returnTest() === undefined, "returnTest = " + returnTest());
 
+/* The same member and identifier lookups on objects of changing layouts */
+(function() {
+    function Point(x, y) { this.x = x; this.y = y; }
+    function getX(o) { return o.x; }
+    function setX(o, v) { o.x = v; }
+    function callGet(o) { return o.get(); }
+    var objs = [new Point(1, 2), {x: 3}, {y: 4, x: 5}, new Point(6, 7), {}], i, j, r, p;
+
+    for(j = 0; j < 2; j++) {
+        r = "";
+        for(i = 0; i < objs.length; i++)
+            r += getX(objs[i]) + ",";
+        ok(r === "1,3,5,6,undefined,", "r = " + r);
+    }
+
+    p = new Point(1, 2);
+    ok(getX(p) === 1, "getX(p) = " + getX(p));
+    delete p.x;
+    ok(getX(p) === undefined, "getX(p) = " + getX(p));
+    Point.prototype.x = 8;
+    ok(getX(p) === 8, "getX(p) = " + getX(p));
+    setX(p, 9);
+    ok(getX(p) === 9, "getX(p) = " + getX(p));
+    ok(getX(new Point(10, 11)) === 10, "getX(new Point(10, 11)) = " + getX(new Point(10, 11)));
+    delete p.x;
+    delete Point.prototype.x;
+    ok(getX(p) === undefined, "getX(p) = " + getX(p));
+
+    for(i = 0; i < objs.length; i++)
+        setX(objs[i], i);
+    for(i = 0; i < objs.length; i++)
+        ok(objs[i].x === i, "objs[" + i + "].x = " + objs[i].x);
+
+    p = {a: 1, b: 2, c: 3};
+    r = "";
+    for(i = 0; i < 6; i++)
+        r += p[["a", "b", "c"][i % 3]];
+    ok(r === "123123", "r = " + r);
+
+    Point.prototype.get = function() { return this.x; };
+    objs = [new Point(1, 2), {x: 3, get: function() { return -this.x; }}, new Point(4, 5)];
+    r = "";
+    for(i = 0; i < objs.length; i++)
+        r += callGet(objs[i]) + ",";
+    ok(r === "1,-3,4,", "r = " + r);
+    Point.prototype.get = function() { return this.y; };
+    ok(callGet(objs[0]) === 2, "callGet(objs[0]) = " + callGet(objs[0]));
+})();
+
+var cachedGlobal = 1;
+function getCachedGlobal() { return cachedGlobal; }
+ok(getCachedGlobal() === 1, "getCachedGlobal() = " + getCachedGlobal());
+cachedGlobal = 2;
+ok(getCachedGlobal() === 2, "getCachedGlobal() = " + getCachedGlobal());
+(function() {
+    var cachedGlobal = 3;
+    ok(getCachedGlobal() === 2, "getCachedGlobal() = " + getCachedGlobal());
+})();
+
 ActiveXObject = 1;
 ok(ActiveXObject === 1, "ActiveXObject = " + ActiveXObject);
 
@@ -2587,6 +2587,53 @@ static HRESULT test_global_vars_ref(BOOL use_close)
     return hres;
 }
 
+static void test_reset_global_vars(void)
+{
+    IActiveScriptParse *parser;
+    IActiveScript *engine;
+    HRESULT hres;
+    VARIANT var;
+    BSTR str;
+
+    if (!(engine = create_and_init_script(0, FALSE)))
+        return;
+
+    hres = IActiveScript_QueryInterface(engine, &IID_IActiveScriptParse, (void**)&parser);
+    ok(hres == S_OK, "Could not get IActiveScriptParse: %08x\n", hres);
+    if (FAILED(hres))
+    {
+        close_script(engine);
+        return;
+    }
+
+    /* Persistent code is kept when the script is reset, but not its variables */
+    str = a2bstr("Dim resetvar\nresetvar = 5\n");
+    hres = IActiveScriptParse_ParseScriptText(parser, str, NULL, NULL, NULL, 0, 0, SCRIPTTEXT_ISPERSISTENT, NULL, NULL);
+    ok(hres == S_OK, "ParseScriptText failed: %08x\n", hres);
+    SysFreeString(str);
+
+    hres = IActiveScript_SetScriptState(engine, SCRIPTSTATE_UNINITIALIZED);
+    ok(hres == S_OK, "SetScriptState(SCRIPTSTATE_UNINITIALIZED) failed: %08x\n", hres);
+
+    hres = IActiveScript_SetScriptSite(engine, &ActiveScriptSite);
+    ok(hres == S_OK, "SetScriptSite failed: %08x\n", hres);
+
+    hres = IActiveScript_SetScriptState(engine, SCRIPTSTATE_STARTED);
+    ok(hres == S_OK, "SetScriptState(SCRIPTSTATE_STARTED) failed: %08x\n", hres);
+
+    /* The pending code assigned the variable other code finds by name */
+    str = a2bstr("resetvar");
+    hres = IActiveScriptParse_ParseScriptText(parser, str, NULL, NULL, NULL, 0, 0, SCRIPTTEXT_ISEXPRESSION, &var, NULL);
+    ok(hres == S_OK, "ParseScriptText failed: %08x\n", hres);
+    ok(V_VT(&var) == VT_I2, "Expected VT_I2, got %s\n", vt2a(&var));
+    ok(V_I2(&var) == 5, "Expected 5, got %d\n", V_I2(&var));
+    VariantClear(&var);
+    SysFreeString(str);
+
+    IActiveScriptParse_Release(parser);
+    close_script(engine);
+}
+
 static void test_isexpression(void)
 {
     IActiveScriptParse *parser;
@@ -2775,16 +2822,12 @@ static void run_from_file(const char *filename)
     ok(hres == S_OK, "parse_script failed: %08x\n", hres);
 }
 
-static void run_from_res(const char *name)
+static BSTR load_res(const char *name)
 {
     const char *data;
     DWORD size, len;
     BSTR str;
     HRSRC src;
-    HRESULT hres;
-
-    strict_dispid_check = FALSE;
-    test_name = name;
 
     src = FindResourceA(NULL, name, (LPCSTR)40);
     ok(src != NULL, "Could not find resource %s\n", name);
@@ -2796,6 +2839,19 @@ static void run_from_res(const char *name)
     str = SysAllocStringLen(NULL, len);
     MultiByteToWideChar(CP_ACP, 0, data, size, str, len);
 
+    return str;
+}
+
+static void run_from_res(const char *name)
+{
+    BSTR str;
+    HRESULT hres;
+
+    strict_dispid_check = FALSE;
+    test_name = name;
+
+    str = load_res(name);
+
     SET_EXPECT(global_success_d);
     SET_EXPECT(global_success_i);
     hres = parse_script(SCRIPTITEM_GLOBALMEMBERS, str, NULL);
@@ -3044,11 +3100,41 @@ static void run_tests(void)
     test_gc();
     test_msgbox();
     test_isexpression();
+    test_reset_global_vars();
     test_parse_errors();
     test_parse_context();
     test_callbacks();
 }
 
+static void run_benchmark(const char *name)
+{
+    ULONG start, end;
+    BSTR str;
+    HRESULT hres;
+
+    strict_dispid_check = FALSE;
+    test_name = name;
+
+    str = load_res(name);
+
+    start = GetTickCount();
+    hres = parse_script(SCRIPTITEM_GLOBALMEMBERS, str, NULL);
+    end = GetTickCount();
+    ok(hres == S_OK, "%s: parse_script failed: %08x\n", name, hres);
+
+    trace("%s ran in %u ms\n", name, end-start);
+
+    SysFreeString(str);
+    test_name = "";
+}
+
+static void run_benchmarks(void)
+{
+    trace("Running benchmarks...\n");
+
+    run_benchmark("interp.vbs");
+}
+
 static BOOL check_vbscript(void)
 {
     IRegExp2 *regexp;
@@ -3091,6 +3177,9 @@ START_TEST(run)
         run_from_file(argv[2]);
     }else {
         run_tests();
+
+        if(winetest_interactive)
+            run_benchmarks();
     }
 
     CoUninitialize();
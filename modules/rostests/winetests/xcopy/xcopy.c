@@ -16,12 +16,13 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#include <stdio.h>
 #include <windows.h>
 
 #include "wine/test.h"
 
 
-static DWORD runcmd(const char* cmd)
+static DWORD runcmd_timeout(const char* cmd, DWORD timeout)
 {
     STARTUPINFOA si = {sizeof(STARTUPINFOA)};
     PROCESS_INFORMATION pi;
@@ -40,7 +41,7 @@ static DWORD runcmd(const char* cmd)
     if (!rc)
         return 260;
 
-    rc = WaitForSingleObject(pi.hProcess, 5000);
+    rc = WaitForSingleObject(pi.hProcess, timeout);
     if (rc == WAIT_OBJECT_0)
         GetExitCodeProcess(pi.hProcess, &rc);
     else
@@ -51,6 +52,131 @@ static DWORD runcmd(const char* cmd)
     return rc;
 }
 
+static DWORD runcmd(const char* cmd)
+{
+    return runcmd_timeout(cmd, 5000);
+}
+
+static BOOL create_test_file(const char *name, DWORD size)
+{
+    char buffer[4096];
+    DWORD i, len, written;
+    HANDLE hfile;
+
+    hfile = CreateFileA(name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hfile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    for (i = 0; i < size; i += len)
+    {
+        DWORD j;
+
+        len = min(size - i, sizeof(buffer));
+        for (j = 0; j < len; j++)
+            buffer[j] = (char)((i + j) * 7 + size);
+        if (!WriteFile(hfile, buffer, len, &written, NULL) || written != len)
+            break;
+    }
+    CloseHandle(hfile);
+    return i >= size;
+}
+
+static BOOL check_test_file(const char *name, DWORD size)
+{
+    char buffer[4096];
+    DWORD i, j, read;
+    HANDLE hfile;
+    BOOL ret = TRUE;
+
+    hfile = CreateFileA(name, GENERIC_READ, 0, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hfile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    if (GetFileSize(hfile, NULL) != size)
+        ret = FALSE;
+
+    for (i = 0; ret && i < size; i += read)
+    {
+        if (!ReadFile(hfile, buffer, sizeof(buffer), &read, NULL) || !read)
+        {
+            ret = FALSE;
+            break;
+        }
+        for (j = 0; j < read; j++)
+        {
+            if (buffer[j] != (char)((i + j) * 7 + size))
+            {
+                ret = FALSE;
+                break;
+            }
+        }
+    }
+    CloseHandle(hfile);
+    return ret;
+}
+
+/* Builds xcopysrc with count files in each of its dirs subdirectories,
+ * of sizes going up to 64K, plus one file of big_size bytes */
+static BOOL create_test_tree(DWORD dirs, DWORD count, DWORD big_size)
+{
+    char name[MAX_PATH];
+    DWORD i, j;
+
+    CreateDirectoryA("xcopysrc", NULL);
+    for (i = 0; i < dirs; i++)
+    {
+        sprintf(name, "xcopysrc\\dir%u", i);
+        CreateDirectoryA(name, NULL);
+        for (j = 0; j < count; j++)
+        {
+            sprintf(name, "xcopysrc\\dir%u\\file%u", i, j);
+            if (!create_test_file(name, (i * count + j) * 997 % 65536))
+                return FALSE;
+        }
+    }
+    return create_test_file("xcopysrc\\big", big_size);
+}
+
+static BOOL check_test_tree(const char *root, DWORD dirs, DWORD count, DWORD big_size)
+{
+    char name[MAX_PATH];
+    DWORD i, j;
+
+    for (i = 0; i < dirs; i++)
+    {
+        for (j = 0; j < count; j++)
+        {
+            sprintf(name, "%s\\dir%u\\file%u", root, i, j);
+            if (!check_test_file(name, (i * count + j) * 997 % 65536))
+                return FALSE;
+        }
+    }
+    sprintf(name, "%s\\big", root);
+    return check_test_file(name, big_size);
+}
+
+static void delete_test_tree(const char *root, DWORD dirs, DWORD count)
+{
+    char name[MAX_PATH];
+    DWORD i, j;
+
+    for (i = 0; i < dirs; i++)
+    {
+        for (j = 0; j < count; j++)
+        {
+            sprintf(name, "%s\\dir%u\\file%u", root, i, j);
+            DeleteFileA(name);
+        }
+        sprintf(name, "%s\\dir%u", root, i);
+        RemoveDirectoryA(name);
+    }
+    sprintf(name, "%s\\big", root);
+    DeleteFileA(name);
+    RemoveDirectoryA(root);
+}
+
 static void test_date_format(void)
 {
     DWORD rc;
@@ -132,6 +258,89 @@ static void test_keep_attributes(void)
 
     }
 
+static void test_recursive_copy(void)
+{
+    DWORD rc;
+
+    if (!create_test_tree(4, 25, 3 * 1024 * 1024 + 123))
+    {
+        skip("could not create the source tree\n");
+        delete_test_tree("xcopysrc", 4, 25);
+        return;
+    }
+
+    rc = runcmd_timeout("xcopy /S /I /Y xcopysrc xcopydst", 30000);
+    ok(rc == 0, "xcopy /S failed rc=%u\n", rc);
+    ok(check_test_tree("xcopydst", 4, 25, 3 * 1024 * 1024 + 123),
+       "xcopy /S did not copy the tree correctly\n");
+    delete_test_tree("xcopydst", 4, 25);
+
+    /* Copy the big file again, over the previous copy */
+    rc = runcmd_timeout("xcopy /Y xcopysrc\\big xcopytest", 30000);
+    ok(rc == 0, "xcopy of a big file failed rc=%u\n", rc);
+    rc = runcmd_timeout("xcopy /Y xcopysrc\\big xcopytest", 30000);
+    ok(rc == 0, "xcopy over a big file failed rc=%u\n", rc);
+    ok(check_test_file("xcopytest\\big", 3 * 1024 * 1024 + 123),
+       "xcopy did not copy the big file correctly\n");
+    DeleteFileA("xcopytest\\big");
+
+    delete_test_tree("xcopysrc", 4, 25);
+}
+
+static void test_recursive_copy_failure(void)
+{
+    DWORD rc;
+
+    if (!create_test_tree(4, 25, 0))
+    {
+        skip("could not create the source tree\n");
+        delete_test_tree("xcopysrc", 4, 25);
+        return;
+    }
+
+    /* A read only destination makes the copy of that file fail */
+    CreateDirectoryA("xcopydst", NULL);
+    CreateDirectoryA("xcopydst\\dir0", NULL);
+    create_test_file("xcopydst\\dir0\\file0", 1);
+    SetFileAttributesA("xcopydst\\dir0\\file0", FILE_ATTRIBUTE_READONLY);
+
+    rc = runcmd_timeout("xcopy /S /I /Y xcopysrc xcopydst", 30000);
+    ok(rc == 5, "xcopy /S did not fail rc=%u\n", rc);
+
+    /* Unless /C is given, then everything else is copied */
+    rc = runcmd_timeout("xcopy /S /I /Y /C xcopysrc xcopydst", 30000);
+    ok(rc == 0, "xcopy /S /C failed rc=%u\n", rc);
+    ok(check_test_file("xcopydst\\dir0\\file0", 1), "the read only file was overwritten\n");
+    ok(check_test_file("xcopydst\\dir3\\file24", (3 * 25 + 24) * 997 % 65536),
+       "xcopy /S /C did not copy the files after the failure\n");
+
+    SetFileAttributesA("xcopydst\\dir0\\file0", FILE_ATTRIBUTE_NORMAL);
+    delete_test_tree("xcopydst", 4, 25);
+    delete_test_tree("xcopysrc", 4, 25);
+}
+
+/* Times xcopy /S on many small files and a big one */
+static void run_benchmark(void)
+{
+    DWORD rc, start, big_size = 256 * 1024 * 1024;
+
+    if (!create_test_tree(20, 200, big_size))
+    {
+        skip("could not create the benchmark tree\n");
+        delete_test_tree("xcopysrc", 20, 200);
+        return;
+    }
+
+    start = GetTickCount();
+    rc = runcmd_timeout("xcopy /S /I /Y /Q xcopysrc xcopydst", INFINITE);
+    trace("xcopy /S of %u files: %u ms\n", 20 * 200 + 1, GetTickCount() - start);
+    ok(rc == 0, "xcopy /S failed rc=%u\n", rc);
+    ok(check_test_tree("xcopydst", 20, 200, big_size),
+       "xcopy /S did not copy the tree correctly\n");
+    delete_test_tree("xcopydst", 20, 200);
+    delete_test_tree("xcopysrc", 20, 200);
+}
+
 START_TEST(xcopy)
 {
     char tmpdir[MAX_PATH];
@@ -155,6 +364,11 @@ START_TEST(xcopy)
     test_date_format();
     test_parms_syntax();
     test_keep_attributes();
+    test_recursive_copy();
+    test_recursive_copy_failure();
+
+    if (winetest_interactive)
+        run_benchmark();
 
     DeleteFileA("xcopy1");
     RemoveDirectoryA("xcopytest");
@@ -244,6 +244,13 @@ ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
                               SizeOfHandle(HIGH_LEVEL_ENTRIES));
     }
 
+    /* Free the per-processor free handle caches */
+    if (ExpGetHandleTable(HandleTable)->Magazines)
+    {
+        ExFreePoolWithTag(ExpGetHandleTable(HandleTable)->Magazines,
+                          TAG_OBJECT_TABLE);
+    }
+
     /* Free the actual table and check if we need to release quota */
     ExFreePoolWithTag(HandleTable, TAG_OBJECT_TABLE);
     if (Process)
@@ -252,25 +259,27 @@ ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
     }
 }
 
+FORCEINLINE
+PEXP_HANDLE_MAGAZINE
+ExpGetHandleMagazine(IN PHANDLE_TABLE HandleTable)
+{
+    PEXP_HANDLE_TABLE Table = ExpGetHandleTable(HandleTable);
+    ULONG Processor = KeGetCurrentProcessorNumber();
+
+    /* Tables created before all processors started don't cover them all */
+    ASSERT(KeGetCurrentIrql() == DISPATCH_LEVEL);
+    if (Processor >= Table->MagazineCount) return NULL;
+    return &Table->Magazines[Processor];
+}
+
 VOID
 NTAPI
-ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
-                        IN EXHANDLE Handle,
-                        IN PHANDLE_TABLE_ENTRY HandleTableEntry)
+ExpPushFreeHandle(IN PHANDLE_TABLE HandleTable,
+                  IN EXHANDLE Handle,
+                  IN PHANDLE_TABLE_ENTRY HandleTableEntry)
 {
     ULONG OldValue, *Free;
     ULONG LockIndex;
-    PAGED_CODE();
-
-    /* Sanity checks */
-    ASSERT(HandleTableEntry->Object == NULL);
-    ASSERT(HandleTableEntry == ExpLookupHandleTableEntry(HandleTable, Handle));
-
-    /* Decrement the handle count */
-    InterlockedDecrement(&HandleTable->HandleCount);
-
-    /* Mark the handle as free */
-    Handle.TagBits = 0;
 
     /* Check if we're FIFO */
     if (!HandleTable->StrictFIFO)
@@ -301,6 +310,79 @@ ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
                    HandleTable->NextHandleNeedingPool);
             break;
         }
+
+        /* Somebody else changed the free list */
+        InterlockedIncrement(&ExpGetHandleTable(HandleTable)->Contention);
+    }
+}
+
+VOID
+NTAPI
+ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
+                        IN EXHANDLE Handle,
+                        IN PHANDLE_TABLE_ENTRY HandleTableEntry)
+{
+    PEXP_HANDLE_MAGAZINE Magazine;
+    ULONG Flush[EXP_HANDLE_MAGAZINE_SIZE / 2];
+    ULONG i;
+    KIRQL OldIrql;
+    PAGED_CODE();
+
+    /* Sanity checks */
+    ASSERT(HandleTableEntry->Object == NULL);
+    ASSERT(HandleTableEntry == ExpLookupHandleTableEntry(HandleTable, Handle));
+
+    /* Decrement the handle count */
+    InterlockedDecrement(&HandleTable->HandleCount);
+
+    /* Mark the handle as free */
+    Handle.TagBits = 0;
+
+    /* Check if we have per-processor caches */
+    if (!ExpGetHandleTable(HandleTable)->Magazines || HandleTable->StrictFIFO)
+    {
+        /* We don't, give it back to the table */
+        ExpPushFreeHandle(HandleTable, Handle, HandleTableEntry);
+        return;
+    }
+
+    /* The magazine is nonpaged, don't get moved to another processor */
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Magazine = ExpGetHandleMagazine(HandleTable);
+    if (!Magazine)
+    {
+        /* This processor has none, give it back to the table */
+        KeLowerIrql(OldIrql);
+        ExpPushFreeHandle(HandleTable, Handle, HandleTableEntry);
+        return;
+    }
+
+    /* Check if there's room left */
+    if (Magazine->Count < EXP_HANDLE_MAGAZINE_SIZE)
+    {
+        /* Keep it for the next allocation on this processor */
+        Magazine->Handles[Magazine->Count++] = Handle.AsULONG;
+        KeLowerIrql(OldIrql);
+        return;
+    }
+
+    /* It's full, take out the oldest half of it */
+    RtlCopyMemory(Flush, Magazine->Handles, sizeof(Flush));
+    RtlMoveMemory(Magazine->Handles,
+                  &Magazine->Handles[RTL_NUMBER_OF(Flush)],
+                  (EXP_HANDLE_MAGAZINE_SIZE - RTL_NUMBER_OF(Flush)) * sizeof(ULONG));
+    Magazine->Count -= RTL_NUMBER_OF(Flush);
+    Magazine->Handles[Magazine->Count++] = Handle.AsULONG;
+    Magazine->Flushes++;
+    KeLowerIrql(OldIrql);
+
+    /* And give it back to the table, the entries are pageable */
+    for (i = 0; i < RTL_NUMBER_OF(Flush); i++)
+    {
+        Handle.Value = Flush[i];
+        ExpPushFreeHandle(HandleTable,
+                          Handle,
+                          ExpLookupHandleTableEntry(HandleTable, Handle));
     }
 }
 
@@ -316,7 +398,7 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
 
     /* Allocate the table */
     HandleTable = ExAllocatePoolWithTag(PagedPool,
-                                        sizeof(HANDLE_TABLE),
+                                        sizeof(EXP_HANDLE_TABLE),
                                         TAG_OBJECT_TABLE);
     if (!HandleTable) return NULL;
 
@@ -327,7 +409,7 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
     }
 
     /* Clear the table */
-    RtlZeroMemory(HandleTable, sizeof(HANDLE_TABLE));
+    RtlZeroMemory(HandleTable, sizeof(EXP_HANDLE_TABLE));
 
     /* Now allocate the first level structures */
     HandleTableTable = ExpAllocateTablePagedPoolNoZero(Process, PAGE_SIZE);
@@ -384,8 +466,26 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
         ExInitializePushLock(&HandleTable->HandleTableLock[i]);
     }
 
-    /* Initialize the contention event lock and return the lock */
+    /* Initialize the contention event lock */
     ExInitializePushLock(&HandleTable->HandleContentionEvent);
+
+    /* Only SMP systems can contend on the free list */
+    if (KeNumberProcessors > 1)
+    {
+        /* Allocate the free handle caches, it's fine to live without them */
+        ExpGetHandleTable(HandleTable)->Magazines =
+            ExAllocatePoolWithTag(NonPagedPool,
+                                  KeNumberProcessors * sizeof(EXP_HANDLE_MAGAZINE),
+                                  TAG_OBJECT_TABLE);
+        if (ExpGetHandleTable(HandleTable)->Magazines)
+        {
+            RtlZeroMemory(ExpGetHandleTable(HandleTable)->Magazines,
+                          KeNumberProcessors * sizeof(EXP_HANDLE_MAGAZINE));
+            ExpGetHandleTable(HandleTable)->MagazineCount = KeNumberProcessors;
+        }
+    }
+
+    /* Return the table */
     return HandleTable;
 }
 
@@ -581,6 +681,7 @@ ExpAllocateHandleTableEntrySlow(IN PHANDLE_TABLE HandleTable,
     /* Update the index of the next handle */
     Index = InterlockedExchangeAdd((PLONG) &HandleTable->NextHandleNeedingPool,
                                    INDEX_TO_HANDLE_VALUE(LOW_LEVEL_ENTRIES));
+    InterlockedIncrement(&ExpGetHandleTable(HandleTable)->Expansions);
 
     /* Check if need to initialize the table */
     if (DoInit)
@@ -611,7 +712,45 @@ ULONG
 NTAPI
 ExpMoveFreeHandles(IN PHANDLE_TABLE HandleTable)
 {
-    ULONG LastFree, i;
+    ULONG LastFree, FirstFree, Next, i;
+    PHANDLE_TABLE_ENTRY Entry;
+    EXHANDLE Handle;
+
+    /* Check if we're strict FIFO */
+    if (HandleTable->StrictFIFO)
+    {
+        /* Keep everyone out of the free list while the entries are reversed */
+        for (i = 1; i < 4; i++)
+        {
+            /* Acquire this lock exclusively */
+            ExAcquirePushLockExclusive(&HandleTable->HandleTableLock[i]);
+        }
+
+        /* Take the entries freed so far, newest first */
+        LastFree = InterlockedExchange((PLONG) &HandleTable->LastFree, 0);
+        FirstFree = 0;
+        while (LastFree)
+        {
+            /* Link this entry to the one freed after it */
+            Handle.Value = LastFree & FREE_HANDLE_MASK;
+            Entry = ExpLookupHandleTableEntry(HandleTable, Handle);
+            Next = Entry->NextFreeTableEntry;
+            Entry->NextFreeTableEntry = FirstFree;
+            FirstFree = LastFree;
+            LastFree = Next;
+        }
+
+        /* The oldest free entry is handed out first */
+        ASSERT(HandleTable->FirstFree == 0);
+        InterlockedExchange((PLONG)&HandleTable->FirstFree, FirstFree);
+
+        /* Release the locks */
+        for (i = 3; i > 0; i--)
+        {
+            ExReleasePushLockExclusive(&HandleTable->HandleTableLock[i]);
+        }
+        return FirstFree;
+    }
 
     /* Clear the last free index */
     LastFree = InterlockedExchange((PLONG) &HandleTable->LastFree, 0);
@@ -644,8 +783,8 @@ ExpMoveFreeHandles(IN PHANDLE_TABLE HandleTable)
 
 PHANDLE_TABLE_ENTRY
 NTAPI
-ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
-                            OUT PEXHANDLE NewHandle)
+ExpPopFreeHandle(IN PHANDLE_TABLE HandleTable,
+                 OUT PEXHANDLE NewHandle)
 {
     ULONG OldValue, NewValue, NewValue1;
     PHANDLE_TABLE_ENTRY Entry;
@@ -723,6 +862,7 @@ ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
             /* It did, so try again */
             ExReleasePushLockShared(&HandleTable->HandleTableLock[i]);
             KeLeaveCriticalRegion();
+            InterlockedIncrement(&ExpGetHandleTable(HandleTable)->Contention);
             continue;
         }
 
@@ -749,17 +889,108 @@ ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
             /* The compare failed, make sure we expected it */
             ASSERT((NewValue1 & FREE_HANDLE_MASK) !=
                    (OldValue & FREE_HANDLE_MASK));
+            InterlockedIncrement(&ExpGetHandleTable(HandleTable)->Contention);
         }
     }
 
-    /* Increase the number of handles */
-    InterlockedIncrement(&HandleTable->HandleCount);
-
     /* Return the handle and the entry */
     *NewHandle = Handle;
     return Entry;
 }
 
+PHANDLE_TABLE_ENTRY
+NTAPI
+ExpAllocateCachedHandleTableEntry(IN PHANDLE_TABLE HandleTable,
+                                  OUT PEXHANDLE NewHandle)
+{
+    PEXP_HANDLE_MAGAZINE Magazine;
+    ULONG Refill[EXP_HANDLE_MAGAZINE_SIZE / 2];
+    ULONG Count, i;
+    EXHANDLE Handle;
+    KIRQL OldIrql;
+
+    /* The magazine is nonpaged, don't get moved to another processor */
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Magazine = ExpGetHandleMagazine(HandleTable);
+    if (!Magazine)
+    {
+        /* This processor has none, use the table */
+        KeLowerIrql(OldIrql);
+        return ExpPopFreeHandle(HandleTable, NewHandle);
+    }
+
+    /* Check if this processor has a free handle */
+    if (Magazine->Count)
+    {
+        /* Use the most recently freed one */
+        Handle.Value = Magazine->Handles[--Magazine->Count];
+        Magazine->Hits++;
+        KeLowerIrql(OldIrql);
+
+        *NewHandle = Handle;
+        return ExpLookupHandleTableEntry(HandleTable, Handle);
+    }
+
+    /* It's empty, we'll refill it from the table */
+    Magazine->Refills++;
+    KeLowerIrql(OldIrql);
+
+    /* Take a batch of free handles, expanding the table if needed */
+    for (Count = 0; Count < RTL_NUMBER_OF(Refill); Count++)
+    {
+        if (!ExpPopFreeHandle(HandleTable, &Handle)) break;
+        Refill[Count] = Handle.AsULONG;
+    }
+
+    /* Check if we didn't even get one */
+    if (!Count)
+    {
+        NewHandle->GenericHandleOverlay = NULL;
+        return NULL;
+    }
+
+    /* Keep the rest for this processor, which may not be the same anymore */
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Magazine = ExpGetHandleMagazine(HandleTable);
+    for (i = 1; Magazine && (i < Count) && (Magazine->Count < EXP_HANDLE_MAGAZINE_SIZE); i++)
+    {
+        Magazine->Handles[Magazine->Count++] = Refill[i];
+    }
+    KeLowerIrql(OldIrql);
+
+    /* Give back whatever didn't fit */
+    for (; i < Count; i++)
+    {
+        Handle.Value = Refill[i];
+        ExpPushFreeHandle(HandleTable,
+                          Handle,
+                          ExpLookupHandleTableEntry(HandleTable, Handle));
+    }
+
+    /* Return the first one */
+    Handle.Value = Refill[0];
+    *NewHandle = Handle;
+    return ExpLookupHandleTableEntry(HandleTable, Handle);
+}
+
+PHANDLE_TABLE_ENTRY
+NTAPI
+ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
+                            OUT PEXHANDLE NewHandle)
+{
+    PHANDLE_TABLE_ENTRY Entry;
+
+    /* Use the per-processor caches if we have them */
+    if (ExpGetHandleTable(HandleTable)->Magazines && !HandleTable->StrictFIFO)
+        Entry = ExpAllocateCachedHandleTableEntry(HandleTable, NewHandle);
+    else
+        Entry = ExpPopFreeHandle(HandleTable, NewHandle);
+
+    /* Increase the number of handles */
+    if (Entry) InterlockedIncrement(&HandleTable->HandleCount);
+    return Entry;
+}
+
 PHANDLE_TABLE
 NTAPI
 ExCreateHandleTable(IN PEPROCESS Process OPTIONAL)
@@ -903,6 +1134,25 @@ ExUnlockHandleTableEntry(IN PHANDLE_TABLE HandleTable,
     ExfUnblockPushLock(&HandleTable->HandleContentionEvent, NULL);
 }
 
+VOID
+NTAPI
+ExSetHandleTableStrictFIFO(IN PHANDLE_TABLE HandleTable)
+{
+    PEXP_HANDLE_TABLE Table = ExpGetHandleTable(HandleTable);
+    PAGED_CODE();
+
+    /* Free handles must go back in order, so they can't be cached */
+    HandleTable->StrictFIFO = TRUE;
+
+    /* Nobody used the table yet, so the caches are still empty */
+    if (Table->Magazines)
+    {
+        ExFreePoolWithTag(Table->Magazines, TAG_OBJECT_TABLE);
+        Table->Magazines = NULL;
+        Table->MagazineCount = 0;
+    }
+}
+
 VOID
 NTAPI
 ExRemoveHandleTable(IN PHANDLE_TABLE HandleTable)
@@ -1284,6 +1534,30 @@ ExEnumHandleTable(IN PHANDLE_TABLE HandleTable,
 }
 
 #if DBG && defined(KDBG)
+static
+VOID
+ExpKdbgPrintHandleTableStatistics(IN PHANDLE_TABLE HandleTable)
+{
+    PEXP_HANDLE_TABLE Table = ExpGetHandleTable(HandleTable);
+    ULONG i, Cached = 0, Hits = 0, Refills = 0, Flushes = 0;
+
+    if (Table->Magazines)
+    {
+        for (i = 0; i < Table->MagazineCount; i++)
+        {
+            Cached += Table->Magazines[i].Count;
+            Hits += Table->Magazines[i].Hits;
+            Refills += Table->Magazines[i].Refills;
+            Flushes += Table->Magazines[i].Flushes;
+        }
+    }
+
+    KdbpPrint("Cached free handles: %lu, hits: %lu, refills: %lu, flushes: %lu\n",
+              Cached, Hits, Refills, Flushes);
+    KdbpPrint("Free list contention: %ld, expansions: %ld\n",
+              Table->Contention, Table->Expansions);
+}
+
 BOOLEAN ExpKdbgExtHandle(ULONG Argc, PCHAR Argv[])
 {
     USHORT i;
@@ -1359,6 +1633,7 @@ BOOLEAN ExpKdbgExtHandle(ULONG Argc, PCHAR Argv[])
         KdbpPrint("\n");
 
         KdbpPrint("Handle table at %p with %d entries in use\n", HandleTable, HandleTable->HandleCount);
+        ExpKdbgPrintHandleTableStatistics(HandleTable);
 
         ExHandle.Value = 0;
         while ((TableEntry = ExpLookupHandleTableEntry(HandleTable, ExHandle)))
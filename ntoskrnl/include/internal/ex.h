@@ -153,6 +153,35 @@ typedef struct _HARDERROR_USER_PARAMETERS
 #define MAX_MID_INDEX       (MID_LEVEL_ENTRIES * LOW_LEVEL_ENTRIES)
 #define MAX_HIGH_INDEX      (MID_LEVEL_ENTRIES * MID_LEVEL_ENTRIES * LOW_LEVEL_ENTRIES)
 
+//
+// Per-processor cache of free handles, so that handle creation and
+// destruction on several processors don't all fight over FirstFree
+//
+#define EXP_HANDLE_MAGAZINE_SIZE    12
+
+typedef struct _EXP_HANDLE_MAGAZINE
+{
+    ULONG Count;
+    ULONG Handles[EXP_HANDLE_MAGAZINE_SIZE];
+    ULONG Hits;
+    ULONG Refills;
+    ULONG Flushes;
+} EXP_HANDLE_MAGAZINE, *PEXP_HANDLE_MAGAZINE;
+
+//
+// Handle table as allocated by the executive, the public part must be first
+//
+typedef struct _EXP_HANDLE_TABLE
+{
+    HANDLE_TABLE Table;
+    PEXP_HANDLE_MAGAZINE Magazines;
+    ULONG MagazineCount;
+    LONG Contention;
+    LONG Expansions;
+} EXP_HANDLE_TABLE, *PEXP_HANDLE_TABLE;
+
+#define ExpGetHandleTable(x) CONTAINING_RECORD((x), EXP_HANDLE_TABLE, Table)
+
 #define ExpChangeRundown(x, y, z) (ULONG_PTR)InterlockedCompareExchangePointer(&x->Ptr, (PVOID)y, (PVOID)z)
 #define ExpChangePushlock(x, y, z) InterlockedCompareExchangePointer((PVOID*)x, (PVOID)y, (PVOID)z)
 #define ExpSetRundown(x, y) InterlockedExchangePointer(&x->Ptr, (PVOID)y)
@@ -438,6 +467,12 @@ ExCreateHandleTable(
     IN PEPROCESS Process OPTIONAL
 );
 
+VOID
+NTAPI
+ExSetHandleTableStrictFIFO(
+    IN PHANDLE_TABLE HandleTable
+);
+
 VOID
 NTAPI
 ExUnlockHandleTableEntry(
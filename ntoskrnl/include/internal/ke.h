@@ -63,6 +63,22 @@ typedef struct _KI_SAMPLE_MAP
 
 #define MAX_TIMER_DPCS                      16
 
+//
+// Timer wheel levels above the timer table. Each level has TIMER_WHEEL_SIZE
+// slots, and a slot of a level spans a whole turn of the level below it.
+// Timers due beyond the last level wait on the overflow list.
+//
+#define TIMER_WHEEL_LEVELS                  3
+#define TIMER_WHEEL_SIZE                    64
+#define TIMER_WHEEL_SHIFT                   6
+#define TIMER_WHEEL_LEVEL_SHIFT(Level)      (TIMER_TABLE_SHIFT + (Level) * TIMER_WHEEL_SHIFT)
+
+//
+// Values of Timer->Header.Hand while a timer is inserted
+//
+#define TIMER_HAND_TABLE                    0
+#define TIMER_HAND_OVERFLOW                 (TIMER_WHEEL_LEVELS + 1)
+
 typedef struct _DPC_QUEUE_ENTRY
 {
     PKDPC Dpc;
@@ -124,6 +140,10 @@ extern LIST_ENTRY KeBugcheckCallbackListHead, KeBugcheckReasonCallbackListHead;
 extern KSPIN_LOCK BugCheckCallbackLock;
 extern KDPC KiTimerExpireDpc;
 extern KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+extern LIST_ENTRY KiTimerWheelListHead[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+extern LIST_ENTRY KiTimerWheelOverflowListHead;
+extern ULONGLONG KiTimerWheelBase;
+extern ULONGLONG KiTimerWheelCascadeTime;
 extern FAST_MUTEX KiGenericCallDpcMutex;
 extern LIST_ENTRY KiProfileListHead, KiProfileSourceListHead;
 extern KSPIN_LOCK KiProfileLock;
@@ -279,6 +299,18 @@ KiInsertTimerTable(
     IN ULONG Hand
 );
 
+BOOLEAN
+FASTCALL
+KiInsertTimerWheel(
+    IN PKTIMER Timer
+);
+
+BOOLEAN
+FASTCALL
+KiCascadeTimerWheel(
+    IN ULONGLONG InterruptTime
+);
+
 VOID
 FASTCALL
 KiTimerListExpire(
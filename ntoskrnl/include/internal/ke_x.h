@@ -890,7 +890,8 @@ KiRemoveEntryTimer(IN PKTIMER Timer)
     PKTIMER_TABLE_ENTRY TableEntry;
 
     /* Remove the timer from the timer list and check if it's empty */
-    Hand = Timer->Header.Hand;
+    ASSERT(Timer->Header.Hand == TIMER_HAND_TABLE);
+    Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
     if (RemoveEntryList(&Timer->TimerListEntry))
     {
         /* Get the respective timer table entry */
@@ -921,6 +922,14 @@ KxInsertTimer(IN PKTIMER Timer,
     PKSPIN_LOCK_QUEUE LockQueue;
     ASSERT(KeGetCurrentIrql() >= SYNCH_LEVEL);
 
+    /* Timers due after the current table round go to the timer wheel */
+    if (KiInsertTimerWheel(Timer))
+    {
+        /* The wheel is protected by the dispatcher lock, we're done */
+        KiReleaseDispatcherLockFromSynchLevel();
+        return;
+    }
+
     /* Acquire the lock and release the dispatcher lock */
     LockQueue = KiAcquireTimerLock(Hand);
     KiReleaseDispatcherLockFromSynchLevel();
@@ -984,7 +993,6 @@ KiComputeDueTime(IN PKTIMER Timer,
 
     /* Get the handle */
     *Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
-    Timer->Header.Hand = (UCHAR)*Hand;
     Timer->Header.Inserted = TRUE;
     return TRUE;
 }
@@ -998,11 +1006,22 @@ FORCEINLINE
 VOID
 KxRemoveTreeTimer(IN PKTIMER Timer)
 {
-    ULONG Hand = Timer->Header.Hand;
+    ULONG Hand;
     PKSPIN_LOCK_QUEUE LockQueue;
     PKTIMER_TABLE_ENTRY TimerEntry;
 
+    /* Check if the timer is still waiting on the timer wheel */
+    if (Timer->Header.Hand != TIMER_HAND_TABLE)
+    {
+        /* The dispatcher lock protects the wheel, just unlink it */
+        Timer->Header.Inserted = FALSE;
+        RemoveEntryList(&Timer->TimerListEntry);
+        Timer->Header.Hand = TIMER_HAND_TABLE;
+        return;
+    }
+
     /* Acquire timer lock */
+    Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
     LockQueue = KiAcquireTimerLock(Hand);
 
     /* Set the timer as non-inserted */
@@ -1065,7 +1084,6 @@ KxSetTimerForThreadWait(IN PKTIMER Timer,
 
     /* Calculate the timer handle */
     *Hand = KiComputeTimerTableIndex(DueTime);
-    Timer->Header.Hand = (UCHAR)*Hand;
 }
 
 #define KxDelayThreadWait()                                                 \
@@ -78,6 +78,7 @@
 #include "vdm.h"
 #include "hal.h"
 #include "hdl.h"
+#include "wmi.h"
 #include "arch/intrin_i.h"
 #include <arbiter.h>
 
@@ -136,6 +137,10 @@ typedef struct _INFORMATION_CLASS_INFO
 
 #endif
 
+/* The HAL publishes its TSC data in the shared user page, after the documented part */
+C_ASSERT(sizeof(KUSER_SHARED_DATA) <= KUSER_TSC_QPC_DATA_OFFSET);
+C_ASSERT(KUSER_TSC_QPC_DATA_OFFSET + sizeof(KUSER_TSC_QPC_DATA) <= PAGE_SIZE);
+
 #ifndef _WIN64
 C_ASSERT(FIELD_OFFSET(KUSER_SHARED_DATA, SystemCall) == 0x300);
 
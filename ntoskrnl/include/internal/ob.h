@@ -123,16 +123,39 @@ typedef struct _SECURITY_DESCRIPTOR_HEADER
     LIST_ENTRY Link;
     ULONG RefCount;
     ULONG FullHash;
+    SINGLE_LIST_ENTRY FreeLink;
     QUAD SecurityDescriptor;
 } SECURITY_DESCRIPTOR_HEADER, *PSECURITY_DESCRIPTOR_HEADER;
 
 //
 // Cached Security Descriptor List
 //
+// Lookups walk the list without the push lock, which only serializes the
+// writers. Readers count themselves in the slot of the current generation,
+// and headers unlinked during a generation are queued in its slot. Once the
+// generation moves on, no new reader enters the old slot, so its headers
+// are freed as soon as its last reader leaves.
+//
 typedef struct _OB_SD_CACHE_LIST
 {
     EX_PUSH_LOCK PushLock;
     LIST_ENTRY Head;
+    ULONG Generation;
+    LONG Readers[2];
+    SINGLE_LIST_ENTRY DeferredFree[2];
+
+    //
+    // Statistics, the lock-free counters are approximate
+    //
+    ULONG Entries;
+    ULONG MaxEntries;
+    ULONG Lookups;
+    ULONG Hits;
+    ULONG LockedHits;
+    ULONG Collisions;
+    ULONG Inserts;
+    ULONG Frees;
+    ULONG DeferredFrees;
 } OB_SD_CACHE_LIST, *POB_SD_CACHE_LIST;
 
 //
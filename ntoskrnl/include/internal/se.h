@@ -197,6 +197,53 @@ extern PSECURITY_DESCRIPTOR SeSystemDefaultSd;
 extern PSECURITY_DESCRIPTOR SeUnrestrictedSd;
 
 
+//
+// Per-token cache of access check results. An entry is only valid for the
+// state of the token it was computed with, identified by its ModifiedId, and
+// keeps a reference on its security descriptor, which must come from the
+// object manager's descriptor cache, so that the address can't be reused.
+// The TOKEN layout is shared through the NDK, so the caches are kept in a
+// table of their own, hashed by token address.
+//
+#define SEP_ACCESS_CACHE_ENTRIES 64
+#define SEP_ACCESS_CACHE_BUCKETS 64
+
+typedef struct _SEP_ACCESS_CACHE_ENTRY
+{
+    PSECURITY_DESCRIPTOR SecurityDescriptor;
+    PGENERIC_MAPPING GenericMapping;
+    LUID ModifiedId;
+    ACCESS_MASK DesiredAccess;
+    ACCESS_MASK PreviouslyGrantedAccess;
+    ACCESS_MASK GrantedAccess;
+    NTSTATUS AccessStatus;
+} SEP_ACCESS_CACHE_ENTRY, *PSEP_ACCESS_CACHE_ENTRY;
+
+typedef struct _SEP_ACCESS_CACHE
+{
+    struct _SEP_ACCESS_CACHE *Next;     // Next cache in the same bucket
+    PTOKEN Token;
+    EX_PUSH_LOCK PushLock;
+    SEP_ACCESS_CACHE_ENTRY Entries[SEP_ACCESS_CACHE_ENTRIES];
+} SEP_ACCESS_CACHE, *PSEP_ACCESS_CACHE;
+
+//
+// Statistics of all the access check caches, the counters are approximate
+//
+typedef struct _SEP_ACCESS_CACHE_STATISTICS
+{
+    ULONG Lookups;
+    ULONG Hits;
+    ULONG Stale;
+    ULONG Inserts;
+    ULONG Replaced;
+    ULONG Uncacheable;
+    ULONG Logged;
+    ULONG Caches;
+} SEP_ACCESS_CACHE_STATISTICS, *PSEP_ACCESS_CACHE_STATISTICS;
+
+extern SEP_ACCESS_CACHE_STATISTICS SepAccessCacheStatistics;
+
 #define SepAcquireTokenLockExclusive(Token)                                    \
 {                                                                              \
     KeEnterCriticalRegion();                                                   \
@@ -242,6 +289,31 @@ SepSidInTokenEx(
     IN BOOLEAN Restricted
 );
 
+//
+// Access Check Functions
+//
+BOOLEAN
+NTAPI
+SepAccessCheckWithCache(
+    _In_ PSECURITY_DESCRIPTOR SecurityDescriptor,
+    _In_ PSECURITY_SUBJECT_CONTEXT SubjectSecurityContext,
+    _In_ BOOLEAN SubjectContextLocked,
+    _In_ ACCESS_MASK DesiredAccess,
+    _In_ ACCESS_MASK PreviouslyGrantedAccess,
+    _Out_ PPRIVILEGE_SET* Privileges,
+    _In_ PGENERIC_MAPPING GenericMapping,
+    _In_ KPROCESSOR_MODE AccessMode,
+    _Out_ PACCESS_MASK GrantedAccess,
+    _Out_ PNTSTATUS AccessStatus,
+    _In_ BOOLEAN DescriptorCached
+);
+
+VOID
+NTAPI
+SepDeleteAccessCache(
+    _In_ PTOKEN Token
+);
+
 /* Functions */
 BOOLEAN
 NTAPI
@@ -182,6 +182,7 @@
 #define TAG_SE_DIR_BUFFER     'bDeS'
 #define TAG_SE_PROXY_DATA     'dPoT'
 #define TAG_SE_TOKEN_LOCK     'lTeS'
+#define TAG_SE_ACCESS_CACHE   'hCeS'
 
 /* LPC Tags */
 #define TAG_LPC_MESSAGE   'McpL'
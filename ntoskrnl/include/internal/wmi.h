@@ -0,0 +1,151 @@
+/*
+ * PROJECT:         ReactOS Kernel
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            ntoskrnl/include/internal/wmi.h
+ * PURPOSE:         Internal header for the kernel event providers
+ * PROGRAMMERS:
+ */
+
+#pragma once
+
+//
+// NT Kernel Logger event groups, same values as the EVENT_TRACE_FLAG_*
+// enable flags of evntrace.h
+//
+#define WMI_KERNEL_TRACE_CSWITCH            0x00000010
+#define WMI_KERNEL_TRACE_DISK_IO            0x00000100
+#define WMI_KERNEL_TRACE_DISPATCHER         0x00000800
+#define WMI_KERNEL_TRACE_PAGE_FAULTS        0x00001000
+#define WMI_KERNEL_TRACE_HARD_FAULTS        0x00002000
+
+//
+// EnableFlags of the NT Kernel Logger, 0 when it is not running.
+// Every provider hook below tests it inline, so a disabled provider
+// costs one load and one branch.
+//
+extern ULONG WmipKernelLoggerFlags;
+
+VOID
+FASTCALL
+WmipLogContextSwitch(
+    _In_ PKTHREAD OldThread,
+    _In_ PKTHREAD NewThread
+);
+
+VOID
+FASTCALL
+WmipLogReadyThread(
+    _In_ PKTHREAD Thread
+);
+
+VOID
+FASTCALL
+WmipLogDiskIoStart(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp
+);
+
+VOID
+FASTCALL
+WmipLogDiskIoCompletion(
+    _In_ PIRP Irp
+);
+
+VOID
+FASTCALL
+WmipLogPageFault(
+    _In_ NTSTATUS Status,
+    _In_ PVOID Address,
+    _In_opt_ PVOID TrapInformation
+);
+
+LONG64
+FASTCALL
+WmipGetKernelTraceTimeStamp(
+    VOID
+);
+
+VOID
+FASTCALL
+WmipLogHardFault(
+    _In_ LONG64 InitialTime,
+    _In_ ULONG64 ReadOffset,
+    _In_ PVOID Address,
+    _In_opt_ PFILE_OBJECT FileObject,
+    _In_ ULONG ByteCount
+);
+
+FORCEINLINE
+VOID
+WmipTraceContextSwitch(
+    _In_ PKTHREAD OldThread,
+    _In_ PKTHREAD NewThread)
+{
+    if (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_CSWITCH)
+        WmipLogContextSwitch(OldThread, NewThread);
+}
+
+FORCEINLINE
+VOID
+WmipTraceReadyThread(
+    _In_ PKTHREAD Thread)
+{
+    if (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_DISPATCHER)
+        WmipLogReadyThread(Thread);
+}
+
+FORCEINLINE
+VOID
+WmipTraceDiskIoStart(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp)
+{
+    if (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_DISK_IO)
+        WmipLogDiskIoStart(DeviceObject, Irp);
+}
+
+FORCEINLINE
+VOID
+WmipTraceDiskIoCompletion(
+    _In_ PIRP Irp)
+{
+    if (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_DISK_IO)
+        WmipLogDiskIoCompletion(Irp);
+}
+
+FORCEINLINE
+VOID
+WmipTracePageFault(
+    _In_ NTSTATUS Status,
+    _In_ PVOID Address,
+    _In_opt_ PVOID TrapInformation)
+{
+    if (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_PAGE_FAULTS)
+        WmipLogPageFault(Status, Address, TrapInformation);
+}
+
+//
+// Hard faults are reported once the page was read, with the time the
+// read started. WmipTraceHardFaultStart returns 0 when they are disabled.
+//
+FORCEINLINE
+LONG64
+WmipTraceHardFaultStart(VOID)
+{
+    if (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_HARD_FAULTS)
+        return WmipGetKernelTraceTimeStamp();
+    return 0;
+}
+
+FORCEINLINE
+VOID
+WmipTraceHardFault(
+    _In_ LONG64 InitialTime,
+    _In_ ULONG64 ReadOffset,
+    _In_ PVOID Address,
+    _In_opt_ PFILE_OBJECT FileObject,
+    _In_ ULONG ByteCount)
+{
+    if (InitialTime && (WmipKernelLoggerFlags & WMI_KERNEL_TRACE_HARD_FAULTS))
+        WmipLogHardFault(InitialTime, ReadOffset, Address, FileObject, ByteCount);
+}
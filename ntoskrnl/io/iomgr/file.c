@@ -461,18 +461,17 @@ IopParseDevice(IN PVOID ParseObject,
                 LockHeld = TRUE;
 
                 /* Do access check */
-                AccessGranted = SeAccessCheck(OriginalDeviceObject->
-                                              SecurityDescriptor,
-                                              &AccessState->SubjectSecurityContext,
-                                              LockHeld,
-                                              DesiredAccess,
-                                              0,
-                                              &Privileges,
-                                              &IoFileObjectType->
-                                              TypeInfo.GenericMapping,
-                                              UserMode,
-                                              &GrantedAccess,
-                                              &Status);
+                AccessGranted = SepAccessCheckWithCache(OriginalDeviceObject->SecurityDescriptor,
+                                                        &AccessState->SubjectSecurityContext,
+                                                        LockHeld,
+                                                        DesiredAccess,
+                                                        0,
+                                                        &Privileges,
+                                                        &IoFileObjectType->TypeInfo.GenericMapping,
+                                                        UserMode,
+                                                        &GrantedAccess,
+                                                        &Status,
+                                                        TRUE);
                 if (Privileges)
                 {
                     /* Append and free the privileges */
@@ -535,18 +534,17 @@ IopParseDevice(IN PVOID ParseObject,
                         LockHeld = TRUE;
 
                         /* Do access check */
-                        AccessGranted = SeAccessCheck(OriginalDeviceObject->
-                                                      SecurityDescriptor,
-                                                      &AccessState->SubjectSecurityContext,
-                                                      LockHeld,
-                                                      FILE_TRAVERSE,
-                                                      0,
-                                                      &Privileges,
-                                                      &IoFileObjectType->
-                                                      TypeInfo.GenericMapping,
-                                                      UserMode,
-                                                      &GrantedAccess,
-                                                      &Status);
+                        AccessGranted = SepAccessCheckWithCache(OriginalDeviceObject->SecurityDescriptor,
+                                                                &AccessState->SubjectSecurityContext,
+                                                                LockHeld,
+                                                                FILE_TRAVERSE,
+                                                                0,
+                                                                &Privileges,
+                                                                &IoFileObjectType->TypeInfo.GenericMapping,
+                                                                UserMode,
+                                                                &GrantedAccess,
+                                                                &Status,
+                                                                TRUE);
                         if (Privileges)
                         {
                             /* Append and free the privileges */
@@ -688,16 +686,17 @@ IopParseDevice(IN PVOID ParseObject,
             SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
             /* Do access check */
-            AccessGranted = SeAccessCheck(OriginalDeviceObject->SecurityDescriptor,
-                                          &AccessState->SubjectSecurityContext,
-                                          TRUE,
-                                          DesiredAccess,
-                                          0,
-                                          &Privileges,
-                                          &IoFileObjectType->TypeInfo.GenericMapping,
-                                          UserMode,
-                                          &GrantedAccess,
-                                          &Status);
+            AccessGranted = SepAccessCheckWithCache(OriginalDeviceObject->SecurityDescriptor,
+                                                    &AccessState->SubjectSecurityContext,
+                                                    TRUE,
+                                                    DesiredAccess,
+                                                    0,
+                                                    &Privileges,
+                                                    &IoFileObjectType->TypeInfo.GenericMapping,
+                                                    UserMode,
+                                                    &GrantedAccess,
+                                                    &Status,
+                                                    TRUE);
             if (Privileges != NULL)
             {
                 /* Append and free the privileges */
@@ -1282,6 +1282,9 @@ IofCallDriver(IN PDEVICE_OBJECT DeviceObject,
     /* Get the Device Object */
     StackPtr->DeviceObject = DeviceObject;
 
+    /* Report disk requests to the kernel logger */
+    WmipTraceDiskIoStart(DeviceObject, Irp);
+
     /* Call it */
     return DriverObject->MajorFunction[StackPtr->MajorFunction](DeviceObject,
                                                                 Irp);
@@ -1337,6 +1340,9 @@ IofCompleteRequest(IN PIRP Irp,
     ASSERT(Irp->IoStatus.Status != STATUS_PENDING);
     ASSERT(Irp->IoStatus.Status != (NTSTATUS)0xFFFFFFFF);
 
+    /* Report disk requests to the kernel logger, before the stack is cleared */
+    WmipTraceDiskIoCompletion(Irp);
+
     /* Get the last stack */
     LastStackPtr = (PIO_STACK_LOCATION)(Irp + 1);
     if (LastStackPtr->Control & SL_ERROR_RETURNED)
@@ -185,6 +185,14 @@ KiInitializeKernel(IN PKPROCESS InitProcess,
         KiTimerTableListHead[i].Time.LowPart = 0;
     }
 
+    /* Loop the timer wheel */
+    for (i = 0; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE; i++)
+    {
+        /* Initialize the slot */
+        InitializeListHead(&KiTimerWheelListHead[i / TIMER_WHEEL_SIZE][i % TIMER_WHEEL_SIZE]);
+    }
+    InitializeListHead(&KiTimerWheelOverflowListHead);
+
     /* Initialize the Swap event and all swap lists */
     KeInitializeEvent(&KiSwapEvent, SynchronizationEvent, FALSE);
     InitializeListHead(&KiProcessInSwapListHead);
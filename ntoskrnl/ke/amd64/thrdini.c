@@ -184,6 +184,9 @@ KiSwapContextResume(
                      0);
     }
 
+    /* Report the switch to the kernel logger */
+    WmipTraceContextSwitch(OldThread, NewThread);
+
     /* Kernel APCs may be pending */
     if (NewThread->ApcState.KernelApcPending)
     {
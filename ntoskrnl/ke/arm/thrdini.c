@@ -241,6 +241,9 @@ KiSwapContextExit(IN PKTHREAD OldThread,
                      0);
     }
 
+    /* Report the switch to the kernel logger */
+    WmipTraceContextSwitch(OldThread, NewThread);
+
     /* Kernel APCs may be pending */
     if (NewThread->ApcState.KernelApcPending)
     {
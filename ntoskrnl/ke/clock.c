@@ -106,6 +106,33 @@ KeSetSystemTime(IN PLARGE_INTEGER NewTime,
         KiReleaseTimerLock(LockQueue);
     }
 
+    /* Loop the timer wheel too, it is protected by the dispatcher lock */
+    for (i = 0; i <= TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE; i++)
+    {
+        /* Get the slot, or the overflow list after the last one */
+        if (i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE)
+        {
+            ListHead = &KiTimerWheelListHead[i / TIMER_WHEEL_SIZE][i % TIMER_WHEEL_SIZE];
+        }
+        else
+        {
+            ListHead = &KiTimerWheelOverflowListHead;
+        }
+
+        /* Move its absolute timers to our temporary list */
+        NextEntry = ListHead->Flink;
+        while (NextEntry != ListHead)
+        {
+            Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
+            NextEntry = NextEntry->Flink;
+            if (Timer->Header.Absolute)
+            {
+                RemoveEntryList(&Timer->TimerListEntry);
+                InsertTailList(&TempList, &Timer->TimerListEntry);
+            }
+        }
+    }
+
     /* Setup a temporary list of expired timers */
     InitializeListHead(&TempList2);
 
@@ -116,10 +143,12 @@ KeSetSystemTime(IN PLARGE_INTEGER NewTime,
         Timer = CONTAINING_RECORD(TempList.Flink, KTIMER, TimerListEntry);
         RemoveEntryList(&Timer->TimerListEntry);
 
-        /* Update the due time and handle */
+        /* Update the due time, and check if it's now far enough for the wheel */
         Timer->DueTime.QuadPart -= DeltaTime.QuadPart;
+        if (KiInsertTimerWheel(Timer)) continue;
+
+        /* Get the handle */
         Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
-        Timer->Header.Hand = (UCHAR)Hand;
 
         /* Lock the timer and re-insert it */
         LockQueue = KiAcquireTimerLock(Hand);
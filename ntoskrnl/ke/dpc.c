@@ -125,6 +125,13 @@ KiTimerExpiration(IN PKDPC Dpc,
     /* Lock the Database and Raise IRQL */
     OldIrql = KiAcquireDispatcherLock();
 
+    /* Check if the next timer wheel round should move to the table */
+    if (InterruptTime.QuadPart >= KiTimerWheelCascadeTime)
+    {
+        /* Cascade it, and scan the whole table if a timer was already due */
+        if (KiCascadeTimerWheel(InterruptTime.QuadPart)) Index = Limit;
+    }
+
     /* Start expiration loop */
     do
     {
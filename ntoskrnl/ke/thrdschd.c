@@ -451,6 +451,9 @@ KiReadyThread(IN PKTHREAD Thread)
     }
     else
     {
+        /* Report the thread to the kernel logger */
+        WmipTraceReadyThread(Thread);
+
         /* Insert the thread on the deferred ready list */
         KiInsertDeferredReadyList(Thread);
     }
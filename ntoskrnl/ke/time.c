@@ -44,9 +44,10 @@ KiCheckForTimerExpiration(
 {
     ULONG Hand;
 
-    /* Check for timer expiration */
+    /* Check for timer expiration, or for timers to cascade from the wheel */
     Hand = KeTickCount.LowPart & (TIMER_TABLE_SIZE - 1);
-    if (KiTimerTableListHead[Hand].Time.QuadPart <= InterruptTime.QuadPart)
+    if ((KiTimerTableListHead[Hand].Time.QuadPart <= InterruptTime.QuadPart) ||
+        (KiTimerWheelCascadeTime <= InterruptTime.QuadPart))
     {
         /* Check if we are already doing expiration */
         if (!Prcb->TimerRequest)
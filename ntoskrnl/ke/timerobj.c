@@ -15,6 +15,10 @@
 /* GLOBALS *******************************************************************/
 
 KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+LIST_ENTRY KiTimerWheelListHead[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+LIST_ENTRY KiTimerWheelOverflowListHead;
+ULONGLONG KiTimerWheelBase;
+ULONGLONG KiTimerWheelCascadeTime;
 LARGE_INTEGER KiTimeIncrementReciprocal;
 UCHAR KiTimeIncrementShiftCount;
 BOOLEAN KiEnableTimerWatchdog = FALSE;
@@ -34,6 +38,9 @@ KiInsertTreeTimer(IN PKTIMER Timer,
     /* Setup the timer's due time */
     if (KiComputeDueTime(Timer, Interval, &Hand))
     {
+        /* Timers due after the current table round go to the timer wheel */
+        if (KiInsertTimerWheel(Timer)) return TRUE;
+
         /* Acquire the lock */
         LockQueue = KiAcquireTimerLock(Hand);
 
@@ -109,6 +116,126 @@ KiInsertTimerTable(IN PKTIMER Timer,
     return Expired;
 }
 
+BOOLEAN
+FASTCALL
+KiInsertTimerWheel(IN PKTIMER Timer)
+{
+    ULONGLONG Tick, Delta;
+    PLIST_ENTRY ListHead;
+    ULONG Level, Slot;
+
+    /* Timers due in the current table round go to the timer table */
+    Tick = Timer->DueTime.QuadPart / KeMaximumIncrement;
+    if (Tick < KiTimerWheelBase)
+    {
+        Timer->Header.Hand = TIMER_HAND_TABLE;
+        return FALSE;
+    }
+
+    /* Check if the period is zero */
+    if (!Timer->Period) Timer->Header.SignalState = FALSE;
+
+    /* Find the first level whose turn covers the due time */
+    Delta = Tick - KiTimerWheelBase;
+    for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++)
+    {
+        if (Delta < (1ULL << TIMER_WHEEL_LEVEL_SHIFT(Level + 1))) break;
+    }
+
+    /* Get the list, the overflow one if the timer is too far away */
+    if (Level < TIMER_WHEEL_LEVELS)
+    {
+        Slot = (ULONG)(Tick >> TIMER_WHEEL_LEVEL_SHIFT(Level)) & (TIMER_WHEEL_SIZE - 1);
+        ListHead = &KiTimerWheelListHead[Level][Slot];
+    }
+    else
+    {
+        ListHead = &KiTimerWheelOverflowListHead;
+    }
+
+    /* The slots aren't sorted, they are only sorted in the timer table */
+    Timer->Header.Hand = (UCHAR)(Level + 1);
+    InsertTailList(ListHead, &Timer->TimerListEntry);
+    return TRUE;
+}
+
+static
+BOOLEAN
+KiCascadeTimerList(IN PLIST_ENTRY ListHead)
+{
+    LIST_ENTRY CascadeList;
+    PKSPIN_LOCK_QUEUE LockQueue;
+    PKTIMER Timer;
+    ULONG Hand;
+    BOOLEAN Expired = FALSE;
+
+    /* Take all the timers off the list first, some may go back on it */
+    InitializeListHead(&CascadeList);
+    while (!IsListEmpty(ListHead))
+    {
+        InsertTailList(&CascadeList, RemoveHeadList(ListHead));
+    }
+
+    /* Insert them again relative to the new base */
+    while (!IsListEmpty(&CascadeList))
+    {
+        Timer = CONTAINING_RECORD(RemoveHeadList(&CascadeList), KTIMER, TimerListEntry);
+        if (KiInsertTimerWheel(Timer)) continue;
+
+        /* This one is due in the current round, move it to the timer table */
+        Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
+        LockQueue = KiAcquireTimerLock(Hand);
+        if (KiInsertTimerTable(Timer, Hand)) Expired = TRUE;
+        KiReleaseTimerLock(LockQueue);
+    }
+
+    /* Return whether a timer was already due */
+    return Expired;
+}
+
+BOOLEAN
+FASTCALL
+KiCascadeTimerWheel(IN ULONGLONG InterruptTime)
+{
+    ULONGLONG Tick, Base;
+    ULONG Level, Slot;
+    BOOLEAN Expired = FALSE;
+
+    /* The caller must own the dispatcher lock, which protects the wheel */
+    ASSERT(KeGetCurrentIrql() >= SYNCH_LEVEL);
+
+    /* Always keep a whole table round of timers ahead of the current tick */
+    Tick = InterruptTime / KeMaximumIncrement;
+    while (Tick + TIMER_TABLE_SIZE >= KiTimerWheelBase)
+    {
+        Base = KiTimerWheelBase;
+
+        /* Give the far away timers another look once the last level wraps */
+        if (!(Base & ((1ULL << TIMER_WHEEL_LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) - 1)))
+        {
+            KiCascadeTimerList(&KiTimerWheelOverflowListHead);
+        }
+
+        /* Spread the slots of the upper levels starting here over the lower ones */
+        for (Level = TIMER_WHEEL_LEVELS - 1; Level > 0; Level--)
+        {
+            if (Base & ((1ULL << TIMER_WHEEL_LEVEL_SHIFT(Level)) - 1)) continue;
+
+            Slot = (ULONG)(Base >> TIMER_WHEEL_LEVEL_SHIFT(Level)) & (TIMER_WHEEL_SIZE - 1);
+            KiCascadeTimerList(&KiTimerWheelListHead[Level][Slot]);
+        }
+
+        /* Now move the round starting at the base to the timer table */
+        KiTimerWheelBase = Base + TIMER_TABLE_SIZE;
+        Slot = (ULONG)(Base >> TIMER_TABLE_SHIFT) & (TIMER_WHEEL_SIZE - 1);
+        if (KiCascadeTimerList(&KiTimerWheelListHead[0][Slot])) Expired = TRUE;
+    }
+
+    /* Set the time at which the clock interrupt should bring us back */
+    KiTimerWheelCascadeTime = (KiTimerWheelBase - TIMER_TABLE_SIZE) * KeMaximumIncrement;
+    return Expired;
+}
+
 BOOLEAN
 FASTCALL
 KiSignalTimer(IN PKTIMER Timer)
@@ -891,6 +891,7 @@ MiResolvePageFileFault(_In_ BOOLEAN StoreInstruction,
     NTSTATUS Status;
     MMPTE TempPte = *PointerPte;
     PMMPFN Pfn1;
+    LONG64 StartTime;
     ULONG PageFileIndex = TempPte.u.Soft.PageFileLow;
     ULONG_PTR PageFileOffset = TempPte.u.Soft.PageFileHigh;
     ULONG Protection = TempPte.u.Soft.Protection;
@@ -930,7 +931,13 @@ MiResolvePageFileFault(_In_ BOOLEAN StoreInstruction,
     MiReleasePfnLock(*OldIrql);
 
     /* Do the paging IO */
+    StartTime = WmipTraceHardFaultStart();
     Status = MiReadPageFile(Page, PageFileIndex, PageFileOffset);
+    WmipTraceHardFault(StartTime,
+                       (ULONG64)(PageFileOffset - 1) * PAGE_SIZE,
+                       FaultingAddress,
+                       MmPagingFile[PageFileIndex]->FileObject,
+                       PAGE_SIZE);
 
     /* Lock the PFN database again */
     *OldIrql = MiAcquirePfnLock();
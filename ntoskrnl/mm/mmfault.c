@@ -207,6 +207,7 @@ MmAccessFault(IN ULONG FaultCode,
               IN PVOID TrapInformation)
 {
     PMEMORY_AREA MemoryArea = NULL;
+    NTSTATUS Status;
 
     /* Cute little hack for ROS */
     if ((ULONG_PTR)Address >= (ULONG_PTR)MmSystemRangeStart)
@@ -226,7 +227,9 @@ MmAccessFault(IN ULONG FaultCode,
     {
         /* This is an ARM3 fault */
         DPRINT("ARM3 fault %p\n", MemoryArea);
-        return MmArmAccessFault(FaultCode, Address, Mode, TrapInformation);
+        Status = MmArmAccessFault(FaultCode, Address, Mode, TrapInformation);
+        WmipTracePageFault(Status, Address, TrapInformation);
+        return Status;
     }
 
     /* Is there a ReactOS address space yet? */
@@ -248,19 +251,22 @@ MmAccessFault(IN ULONG FaultCode,
     {
         /* This is an ARM3 fault */
         DPRINT("ARM3 fault %p\n", MemoryArea);
-        return MmArmAccessFault(FaultCode, Address, Mode, TrapInformation);
+        Status = MmArmAccessFault(FaultCode, Address, Mode, TrapInformation);
     }
-
     /* Keep same old ReactOS Behaviour */
-    if (!MI_IS_NOT_PRESENT_FAULT(FaultCode))
+    else if (!MI_IS_NOT_PRESENT_FAULT(FaultCode))
     {
         /* Call access fault */
-        return MmpAccessFault(Mode, (ULONG_PTR)Address, TrapInformation ? FALSE : TRUE);
+        Status = MmpAccessFault(Mode, (ULONG_PTR)Address, TrapInformation ? FALSE : TRUE);
     }
     else
     {
         /* Call not present */
-        return MmNotPresentFault(Mode, (ULONG_PTR)Address, TrapInformation ? FALSE : TRUE);
+        Status = MmNotPresentFault(Mode, (ULONG_PTR)Address, TrapInformation ? FALSE : TRUE);
     }
+
+    /* Report the fault to the kernel logger */
+    WmipTracePageFault(Status, Address, TrapInformation);
+    return Status;
 }
 
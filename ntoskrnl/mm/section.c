@@ -1764,9 +1764,12 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         FsRtlAcquireFileExclusive(Segment->FileObject);
 
         PFSRTL_COMMON_FCB_HEADER FcbHeader = Segment->FileObject->FsContext;
+        LONG64 StartTime = WmipTraceHardFaultStart();
 
         Status = MmMakeSegmentResident(Segment, Offset.QuadPart, PAGE_SIZE, &FcbHeader->ValidDataLength);
 
+        WmipTraceHardFault(StartTime, Offset.QuadPart, Address, Segment->FileObject, PAGE_SIZE);
+
         FsRtlReleaseFile(Segment->FileObject);
 
         /* Lock address space again */
@@ -37,24 +37,6 @@ ObpSdReleaseLock(IN POB_SD_CACHE_LIST CacheEntry)
     KeLeaveCriticalRegion();
 }
 
-FORCEINLINE
-VOID
-ObpSdAcquireLockShared(IN POB_SD_CACHE_LIST CacheEntry)
-{
-    /* Acquire the lock */
-    KeEnterCriticalRegion();
-    ExAcquirePushLockShared(&CacheEntry->PushLock);
-}
-
-FORCEINLINE
-VOID
-ObpSdReleaseLockShared(IN POB_SD_CACHE_LIST CacheEntry)
-{
-    /* Release the lock */
-    ExReleasePushLock(&CacheEntry->PushLock);
-    KeLeaveCriticalRegion();
-}
-
 CODE_SEG("INIT")
 NTSTATUS
 NTAPI
@@ -171,11 +153,224 @@ ObpDestroySecurityDescriptorHeader(IN PSECURITY_DESCRIPTOR_HEADER SdHeader)
 {
     ASSERT(SdHeader->RefCount == 0);
 
-    /* Just unlink the SD and return it back to the caller */
+    /*
+     * Just unlink the SD and return it back to the caller. Its Flink is left
+     * alone, so that a lock-free reader standing on it can still move on.
+     */
     RemoveEntryList(&SdHeader->Link);
     return SdHeader;
 }
 
+VOID
+NTAPI
+ObpInsertSecurityDescriptorHeader(IN PLIST_ENTRY NextEntry,
+                                  IN PSECURITY_DESCRIPTOR_HEADER SdHeader)
+{
+    PLIST_ENTRY PreviousEntry = NextEntry->Blink;
+
+    /* Setup the entry completely before lock-free readers can see it */
+    SdHeader->Link.Flink = NextEntry;
+    SdHeader->Link.Blink = PreviousEntry;
+    KeMemoryBarrier();
+
+    /* Now publish it */
+    NextEntry->Blink = &SdHeader->Link;
+    *(volatile PLIST_ENTRY *)&PreviousEntry->Flink = &SdHeader->Link;
+}
+
+PSINGLE_LIST_ENTRY
+NTAPI
+ObpReclaimSecurityDescriptorHeaders(IN POB_SD_CACHE_LIST CacheEntry,
+                                    IN PSECURITY_DESCRIPTOR_HEADER SdHeader OPTIONAL)
+{
+    SINGLE_LIST_ENTRY FreeList;
+    PSINGLE_LIST_ENTRY Entry;
+    ULONG Old;
+
+    /* Queue the header that was just unlinked, if any, in this generation */
+    if (SdHeader)
+    {
+        PushEntryList(&CacheEntry->DeferredFree[CacheEntry->Generation & 1],
+                      &SdHeader->FreeLink);
+        CacheEntry->Entries--;
+    }
+
+    FreeList.Next = NULL;
+    for (;;)
+    {
+        /* Make the unlinks visible before looking for readers */
+        KeMemoryBarrier();
+
+        /* Readers of the previous generation may still walk on its headers */
+        Old = (CacheEntry->Generation + 1) & 1;
+        if (*(volatile LONG *)&CacheEntry->Readers[Old] != 0) break;
+
+        /* They're all gone, so nobody can reach those headers anymore */
+        while ((Entry = PopEntryList(&CacheEntry->DeferredFree[Old])))
+        {
+            PushEntryList(&FreeList, Entry);
+        }
+
+        /* Stop unless the current generation has headers waiting too */
+        if (!CacheEntry->DeferredFree[Old ^ 1].Next) break;
+
+        /* Move on, new readers now go to the slot that just drained */
+        InterlockedIncrement((PLONG)&CacheEntry->Generation);
+    }
+
+    /* Remember if the header has to wait for readers */
+    if (SdHeader &&
+        (CacheEntry->DeferredFree[0].Next || CacheEntry->DeferredFree[1].Next))
+    {
+        CacheEntry->DeferredFrees++;
+    }
+
+    /* Hand whatever can be freed to the caller */
+    return FreeList.Next;
+}
+
+VOID
+NTAPI
+ObpFreeSecurityDescriptorHeaders(IN POB_SD_CACHE_LIST CacheEntry,
+                                 IN PSINGLE_LIST_ENTRY FreeList)
+{
+    PSECURITY_DESCRIPTOR_HEADER SdHeader;
+
+    /* Free everything that the reclaim gave us, outside of the lock */
+    while (FreeList)
+    {
+        SdHeader = CONTAINING_RECORD(FreeList, SECURITY_DESCRIPTOR_HEADER, FreeLink);
+        FreeList = FreeList->Next;
+        CacheEntry->Frees++;
+        ExFreePoolWithTag(SdHeader, TAG_OB_SD_CACHE);
+    }
+}
+
+VOID
+NTAPI
+ObpSdDropReader(IN POB_SD_CACHE_LIST CacheEntry,
+                IN ULONG Slot)
+{
+    PSINGLE_LIST_ENTRY FreeList;
+
+    /* This is a full barrier, we don't touch any header after it */
+    if (InterlockedDecrement(&CacheEntry->Readers[Slot])) return;
+
+    /* Check if writers left headers behind for the readers to drain */
+    if (!*(volatile PSINGLE_LIST_ENTRY *)&CacheEntry->DeferredFree[0].Next &&
+        !*(volatile PSINGLE_LIST_ENTRY *)&CacheEntry->DeferredFree[1].Next)
+    {
+        return;
+    }
+
+    /* We were the last one, so free them now instead of waiting for a writer */
+    ObpSdAcquireLock(CacheEntry);
+    FreeList = ObpReclaimSecurityDescriptorHeaders(CacheEntry, NULL);
+    ObpSdReleaseLock(CacheEntry);
+    ObpFreeSecurityDescriptorHeaders(CacheEntry, FreeList);
+}
+
+FORCEINLINE
+ULONG
+ObpSdEnterReader(IN POB_SD_CACHE_LIST CacheEntry)
+{
+    ULONG Generation;
+
+    /* Don't get suspended while writers have to defer their frees */
+    KeEnterCriticalRegion();
+
+    for (;;)
+    {
+        /* Count ourselves in the slot of the current generation */
+        Generation = *(volatile ULONG *)&CacheEntry->Generation;
+        InterlockedIncrement(&CacheEntry->Readers[Generation & 1]);
+
+        /* This is a full barrier, the list is read after it */
+        if (*(volatile ULONG *)&CacheEntry->Generation == Generation) break;
+
+        /* The generation moved on, its old slot may be draining already */
+        ObpSdDropReader(CacheEntry, Generation & 1);
+    }
+
+    return Generation & 1;
+}
+
+FORCEINLINE
+VOID
+ObpSdLeaveReader(IN POB_SD_CACHE_LIST CacheEntry,
+                 IN ULONG Slot)
+{
+    ObpSdDropReader(CacheEntry, Slot);
+    KeLeaveCriticalRegion();
+}
+
+BOOLEAN
+NTAPI
+ObpTryReferenceSecurityDescriptorHeader(IN PSECURITY_DESCRIPTOR_HEADER SdHeader,
+                                        IN ULONG Count)
+{
+    LONG OldValue, NewValue;
+
+    /* Never bring back a header that is being destroyed */
+    OldValue = *(volatile LONG *)&SdHeader->RefCount;
+    while (OldValue != 0)
+    {
+        NewValue = InterlockedCompareExchange((PLONG)&SdHeader->RefCount,
+                                              OldValue + Count,
+                                              OldValue);
+        if (NewValue == OldValue) return TRUE;
+
+        /* Try again */
+        OldValue = NewValue;
+    }
+
+    return FALSE;
+}
+
+PSECURITY_DESCRIPTOR_HEADER
+NTAPI
+ObpLookupSecurityDescriptorHeader(IN POB_SD_CACHE_LIST CacheEntry,
+                                  IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+                                  IN ULONG Length,
+                                  IN ULONG Hash,
+                                  OUT PLIST_ENTRY *InsertEntry)
+{
+    PSECURITY_DESCRIPTOR_HEADER SdHeader;
+    PLIST_ENTRY NextEntry;
+
+    /* Loop the hash list, following the Flinks only */
+    NextEntry = *(volatile PLIST_ENTRY *)&CacheEntry->Head.Flink;
+    while (NextEntry != &CacheEntry->Head)
+    {
+        /* Get the header */
+        SdHeader = ObpGetHeaderForEntry(NextEntry);
+
+        /* Our hashes are ordered, so quickly check if we should stop now */
+        if (SdHeader->FullHash > Hash) break;
+
+        /* We survived the quick hash check, now check for equalness */
+        if (SdHeader->FullHash == Hash)
+        {
+            /* Hashes match, now compare descriptors */
+            if (ObpCompareSecurityDescriptors(SecurityDescriptor,
+                                              Length,
+                                              &SdHeader->SecurityDescriptor))
+            {
+                return SdHeader;
+            }
+
+            CacheEntry->Collisions++;
+        }
+
+        /* Go to the next entry */
+        NextEntry = *(volatile PLIST_ENTRY *)&NextEntry->Flink;
+    }
+
+    /* Tell the caller where the SD would go */
+    *InsertEntry = NextEntry;
+    return NULL;
+}
+
 PSECURITY_DESCRIPTOR
 NTAPI
 ObpReferenceSecurityDescriptor(IN POBJECT_HEADER ObjectHeader)
@@ -291,6 +486,7 @@ ObDereferenceSecurityDescriptor(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
     LONG OldValue, NewValue;
     ULONG Index;
     POB_SD_CACHE_LIST CacheEntry;
+    PSINGLE_LIST_ENTRY FreeList;
     
     /* Get the header */
     SdHeader = ObpGetHeaderForSd(SecurityDescriptor);
@@ -324,12 +520,15 @@ ObDereferenceSecurityDescriptor(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
     {
         /* We're down to zero -- destroy the header */
         SdHeader = ObpDestroySecurityDescriptorHeader(SdHeader);
-        
+
+        /* Lock-free readers may still look at it, see if it can be freed */
+        FreeList = ObpReclaimSecurityDescriptorHeaders(CacheEntry, SdHeader);
+
         /* Release the lock */
         ObpSdReleaseLock(CacheEntry);
         
-        /* Free the header */
-        ExFreePool(SdHeader);
+        /* Free the header(s) */
+        ObpFreeSecurityDescriptorHeaders(CacheEntry, FreeList);
     }
     else
     {
@@ -365,11 +564,13 @@ ObLogSecurityDescriptor(IN PSECURITY_DESCRIPTOR InputSecurityDescriptor,
                         OUT PSECURITY_DESCRIPTOR *OutputSecurityDescriptor,
                         IN ULONG RefBias)
 {
-    PSECURITY_DESCRIPTOR_HEADER SdHeader = NULL, NewHeader  = NULL;
+    PSECURITY_DESCRIPTOR_HEADER SdHeader, NewHeader;
     ULONG Length, Hash, Index;
     POB_SD_CACHE_LIST CacheEntry;
-    BOOLEAN Result;
     PLIST_ENTRY NextEntry;
+    PSINGLE_LIST_ENTRY FreeList;
+    BOOLEAN Result = FALSE;
+    ULONG Slot;
 
     /* Get the length */
     Length = RtlLengthSecurityDescriptor(InputSecurityDescriptor);
@@ -380,89 +581,116 @@ ObLogSecurityDescriptor(IN PSECURITY_DESCRIPTOR InputSecurityDescriptor,
     /* Now select the appropriate cache entry */
     Index = Hash % SD_CACHE_ENTRIES;
     CacheEntry = &ObsSecurityDescriptorCache[Index];
+    CacheEntry->Lookups++;
     
-    /* Lock it shared */
-    ObpSdAcquireLockShared(CacheEntry);
-    
-    /* Start our search */
-    while (TRUE)
+    /* Search it without the lock, this is the common case */
+    Slot = ObpSdEnterReader(CacheEntry);
+    SdHeader = ObpLookupSecurityDescriptorHeader(CacheEntry,
+                                                 InputSecurityDescriptor,
+                                                 Length,
+                                                 Hash,
+                                                 &NextEntry);
+    if (SdHeader)
     {
-        /* Reset result found */
-        Result = FALSE;
-        
-        /* Loop the hash list */
-        NextEntry = CacheEntry->Head.Flink;
-        while (NextEntry != &CacheEntry->Head)
-        {
-            /* Get the header */
-            SdHeader = ObpGetHeaderForEntry(NextEntry);
-            
-            /* Our hashes are ordered, so quickly check if we should stop now */
-            if (SdHeader->FullHash > Hash) break;
-            
-            /* We survived the quick hash check, now check for equalness */
-            if (SdHeader->FullHash == Hash)
-            {
-                /* Hashes match, now compare descriptors */
-                Result = ObpCompareSecurityDescriptors(InputSecurityDescriptor,
-                                                       Length,
-                                                       &SdHeader->SecurityDescriptor);
-                if (Result) break;
-            }
-            
-            /* Go to the next entry */
-            NextEntry = NextEntry->Flink;
-        }
-        
-        /* Check if we found anything */
-        if (Result)
-        {
-            /* Increment its reference count */
-            InterlockedExchangeAdd((PLONG)&SdHeader->RefCount, RefBias);
-            
-            /* Release the lock */
-            ObpSdReleaseLockShared(CacheEntry);
-            
-            /* Return the descriptor */
-            *OutputSecurityDescriptor = &SdHeader->SecurityDescriptor;
-            
-            /* Free anything that we may have had to create */
-            if (NewHeader) ExFreePoolWithTag(NewHeader, TAG_OB_SD_CACHE);
-            return STATUS_SUCCESS;
-        }
-        
-        /* Check if we got here, and didn't create a descriptor yet */
-        if (!NewHeader)
-        {
-            /* Release the lock */
-            ObpSdReleaseLockShared(CacheEntry);
-            
-            /* This should be our first time in the loop, create it */
-            NewHeader = ObpCreateCacheEntry(InputSecurityDescriptor,
-                                            Length,
-                                            Hash,
-                                            RefBias);
-            if (!NewHeader) return STATUS_INSUFFICIENT_RESOURCES;
-            
-            /* Now acquire the exclusive lock and we should hit the right path */
-            ObpSdAcquireLock(CacheEntry);
-        }
-        else
-        {
-            /* We have inserted the SD, we're fine now */
-            break;
-        }
+        /* Reference it, unless it's being destroyed */
+        Result = ObpTryReferenceSecurityDescriptorHeader(SdHeader, RefBias);
     }
+    ObpSdLeaveReader(CacheEntry, Slot);
+
+    /* Check if we found anything */
+    if (Result)
+    {
+        /* Return the descriptor */
+        CacheEntry->Hits++;
+        *OutputSecurityDescriptor = &SdHeader->SecurityDescriptor;
+        return STATUS_SUCCESS;
+    }
+    
+    /* Create the new descriptor before taking the lock */
+    NewHeader = ObpCreateCacheEntry(InputSecurityDescriptor,
+                                    Length,
+                                    Hash,
+                                    RefBias);
+    if (!NewHeader) return STATUS_INSUFFICIENT_RESOURCES;
     
-    /* Okay, now let's do the insert, we should have the exclusive lock */
-    InsertTailList(NextEntry, &NewHeader->Link);
+    /* Now acquire the exclusive lock, and search again since we raced */
+    ObpSdAcquireLock(CacheEntry);
+    SdHeader = ObpLookupSecurityDescriptorHeader(CacheEntry,
+                                                 InputSecurityDescriptor,
+                                                 Length,
+                                                 Hash,
+                                                 &NextEntry);
+    if (SdHeader)
+    {
+        /* Somebody inserted it meanwhile, increment its reference count */
+        InterlockedExchangeAdd((PLONG)&SdHeader->RefCount, RefBias);
+        CacheEntry->LockedHits++;
+    }
+    else
+    {
+        /* Okay, now let's do the insert, we have the exclusive lock */
+        ObpInsertSecurityDescriptorHeader(NextEntry, NewHeader);
+        CacheEntry->Inserts++;
+        if (++CacheEntry->Entries > CacheEntry->MaxEntries)
+            CacheEntry->MaxEntries = CacheEntry->Entries;
+
+        SdHeader = NewHeader;
+        NewHeader = NULL;
+    }
+
+    /* Free whatever the earlier destroys had to leave around */
+    FreeList = ObpReclaimSecurityDescriptorHeaders(CacheEntry, NULL);
     
     /* Release the lock */
     ObpSdReleaseLock(CacheEntry);
+    ObpFreeSecurityDescriptorHeaders(CacheEntry, FreeList);
     
-    /* Return the SD*/
-    *OutputSecurityDescriptor = &NewHeader->SecurityDescriptor;
+    /* Free anything that we didn't need */
+    if (NewHeader) ExFreePoolWithTag(NewHeader, TAG_OB_SD_CACHE);
+
+    /* Return the SD */
+    *OutputSecurityDescriptor = &SdHeader->SecurityDescriptor;
     return STATUS_SUCCESS;
 }
 
+#if DBG && defined(KDBG)
+BOOLEAN
+ExpKdbgExtSdCache(ULONG Argc, PCHAR Argv[])
+{
+    POB_SD_CACHE_LIST CacheEntry;
+    ULONG i, Entries = 0, Lookups = 0, Hits = 0, Inserts = 0, Used = 0;
+
+    KdbpPrint("Bucket\tEntries\tMax\tLookups\tHits\tLocked\tCollide\tInserts\tFrees\tDeferred\n");
+
+    /* No need to lock anything here, we're in the debugger */
+    for (i = 0; i < SD_CACHE_ENTRIES; i++)
+    {
+        CacheEntry = &ObsSecurityDescriptorCache[i];
+
+        Entries += CacheEntry->Entries;
+        Lookups += CacheEntry->Lookups;
+        Hits += CacheEntry->Hits + CacheEntry->LockedHits;
+        Inserts += CacheEntry->Inserts;
+        if (!CacheEntry->Lookups) continue;
+
+        Used++;
+        KdbpPrint("%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\n",
+                  i,
+                  CacheEntry->Entries,
+                  CacheEntry->MaxEntries,
+                  CacheEntry->Lookups,
+                  CacheEntry->Hits,
+                  CacheEntry->LockedHits,
+                  CacheEntry->Collisions,
+                  CacheEntry->Inserts,
+                  CacheEntry->Frees,
+                  CacheEntry->DeferredFrees);
+    }
+
+    KdbpPrint("%lu SDs in %lu/%lu buckets, %lu lookups, %lu hits, %lu inserts\n",
+              Entries, Used, SD_CACHE_ENTRIES, Lookups, Hits, Inserts);
+    return TRUE;
+}
+#endif // DBG && KDBG
+
 /* EOF */
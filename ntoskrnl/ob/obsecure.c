@@ -238,16 +238,17 @@ ObCheckCreateObjectAccess(IN PVOID Object,
     if (SecurityDescriptor)
     {
         /* Now do the entire access check */
-        Result = SeAccessCheck(SecurityDescriptor,
-                               &AccessState->SubjectSecurityContext,
-                               TRUE,
-                               CreateAccess,
-                               0,
-                               &Privileges,
-                               &ObjectType->TypeInfo.GenericMapping,
-                               AccessMode,
-                               &GrantedAccess,
-                               AccessStatus);
+        Result = SepAccessCheckWithCache(SecurityDescriptor,
+                                         &AccessState->SubjectSecurityContext,
+                                         TRUE,
+                                         CreateAccess,
+                                         0,
+                                         &Privileges,
+                                         &ObjectType->TypeInfo.GenericMapping,
+                                         AccessMode,
+                                         &GrantedAccess,
+                                         AccessStatus,
+                                         !SdAllocated);
         if (Privileges)
         {
             /* We got privileges, append them to the access state and free them */
@@ -312,16 +313,17 @@ ObpCheckTraverseAccess(IN PVOID Object,
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     /* Now do the entire access check */
-    Result = SeAccessCheck(SecurityDescriptor,
-                           &AccessState->SubjectSecurityContext,
-                           TRUE,
-                           TraverseAccess,
-                           0,
-                           &Privileges,
-                           &ObjectType->TypeInfo.GenericMapping,
-                           AccessMode,
-                           &GrantedAccess,
-                           AccessStatus);
+    Result = SepAccessCheckWithCache(SecurityDescriptor,
+                                     &AccessState->SubjectSecurityContext,
+                                     TRUE,
+                                     TraverseAccess,
+                                     0,
+                                     &Privileges,
+                                     &ObjectType->TypeInfo.GenericMapping,
+                                     AccessMode,
+                                     &GrantedAccess,
+                                     AccessStatus,
+                                     !SdAllocated);
     if (Privileges)
     {
         /* We got privileges, append them to the access state and free them */
@@ -370,16 +372,17 @@ ObpCheckObjectReference(IN PVOID Object,
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     /* Now do the entire access check */
-    Result = SeAccessCheck(SecurityDescriptor,
-                           &AccessState->SubjectSecurityContext,
-                           TRUE,
-                           AccessState->RemainingDesiredAccess,
-                           AccessState->PreviouslyGrantedAccess,
-                           &Privileges,
-                           &ObjectType->TypeInfo.GenericMapping,
-                           AccessMode,
-                           &GrantedAccess,
-                           AccessStatus);
+    Result = SepAccessCheckWithCache(SecurityDescriptor,
+                                     &AccessState->SubjectSecurityContext,
+                                     TRUE,
+                                     AccessState->RemainingDesiredAccess,
+                                     AccessState->PreviouslyGrantedAccess,
+                                     &Privileges,
+                                     &ObjectType->TypeInfo.GenericMapping,
+                                     AccessMode,
+                                     &GrantedAccess,
+                                     AccessStatus,
+                                     !SdAllocated);
     if (Result)
     {
         /* Update the access state */
@@ -477,16 +480,17 @@ ObCheckObjectAccess(IN PVOID Object,
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     /* Now do the entire access check */
-    Result = SeAccessCheck(SecurityDescriptor,
-                           &AccessState->SubjectSecurityContext,
-                           TRUE,
-                           AccessState->RemainingDesiredAccess,
-                           AccessState->PreviouslyGrantedAccess,
-                           &Privileges,
-                           &ObjectType->TypeInfo.GenericMapping,
-                           AccessMode,
-                           &GrantedAccess,
-                           ReturnedStatus);
+    Result = SepAccessCheckWithCache(SecurityDescriptor,
+                                     &AccessState->SubjectSecurityContext,
+                                     TRUE,
+                                     AccessState->RemainingDesiredAccess,
+                                     AccessState->PreviouslyGrantedAccess,
+                                     &Privileges,
+                                     &ObjectType->TypeInfo.GenericMapping,
+                                     AccessMode,
+                                     &GrantedAccess,
+                                     ReturnedStatus,
+                                     !SdAllocated);
     if (Privileges)
     {
         /* We got privileges, append them to the access state and free them */
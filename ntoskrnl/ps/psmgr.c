@@ -540,6 +540,9 @@ PspInitPhase0(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
     PspCidTable = ExCreateHandleTable(NULL);
     if (!PspCidTable) return FALSE;
 
+    /* Don't hand out the IDs of threads and processes that just died */
+    ExSetHandleTableStrictFIFO(PspCidTable);
+
     /* FIXME: Initialize LDT/VDM support */
 
     /* Setup the reaper */
@@ -15,9 +15,353 @@
 
 /* GLOBALS ********************************************************************/
 
+SEP_ACCESS_CACHE_STATISTICS SepAccessCacheStatistics;
+
+/* Access check caches, hashed by the address of their token */
+typedef struct _SEP_ACCESS_CACHE_BUCKET
+{
+    EX_PUSH_LOCK PushLock;
+    PSEP_ACCESS_CACHE Caches;
+} SEP_ACCESS_CACHE_BUCKET, *PSEP_ACCESS_CACHE_BUCKET;
+
+static SEP_ACCESS_CACHE_BUCKET SepAccessCacheTable[SEP_ACCESS_CACHE_BUCKETS];
 
 /* PRIVATE FUNCTIONS **********************************************************/
 
+FORCEINLINE
+PSEP_ACCESS_CACHE_BUCKET
+SepAccessCacheBucket(IN PTOKEN Token)
+{
+    ULONG_PTR Hash = (ULONG_PTR)Token;
+
+    /* Tokens are pool allocations, skip the alignment bits */
+    Hash = (Hash >> 4) ^ (Hash >> 10);
+    return &SepAccessCacheTable[Hash & (SEP_ACCESS_CACHE_BUCKETS - 1)];
+}
+
+/*
+ * Returns the cache of the token, which stays valid until the token is
+ * deleted, or NULL if it has none yet. The caller holds the token lock.
+ */
+static
+PSEP_ACCESS_CACHE
+SepFindAccessCache(IN PTOKEN Token)
+{
+    PSEP_ACCESS_CACHE_BUCKET Bucket = SepAccessCacheBucket(Token);
+    PSEP_ACCESS_CACHE Cache;
+
+    ExAcquirePushLockShared(&Bucket->PushLock);
+    for (Cache = Bucket->Caches; Cache; Cache = Cache->Next)
+    {
+        if (Cache->Token == Token) break;
+    }
+    ExReleasePushLockShared(&Bucket->PushLock);
+
+    return Cache;
+}
+
+FORCEINLINE
+ULONG
+SepAccessCacheIndex(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+                    IN ACCESS_MASK DesiredAccess,
+                    IN ACCESS_MASK PreviouslyGrantedAccess)
+{
+    ULONG Hash;
+
+    /* Cached descriptors are pool aligned, mix the access masks in */
+    Hash = (ULONG)((ULONG_PTR)SecurityDescriptor >> 3);
+    Hash ^= DesiredAccess ^ (DesiredAccess >> 16) ^ _rotl(PreviouslyGrantedAccess, 5);
+    Hash ^= (Hash >> 6) ^ (Hash >> 12);
+
+    return Hash & (SEP_ACCESS_CACHE_ENTRIES - 1);
+}
+
+static
+BOOLEAN
+SepAccessCacheLookup(IN PTOKEN Token,
+                     IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+                     IN ACCESS_MASK DesiredAccess,
+                     IN ACCESS_MASK PreviouslyGrantedAccess,
+                     IN PGENERIC_MAPPING GenericMapping,
+                     OUT PACCESS_MASK GrantedAccess,
+                     OUT PNTSTATUS AccessStatus)
+{
+    PSEP_ACCESS_CACHE Cache;
+    PSEP_ACCESS_CACHE_ENTRY Entry;
+    BOOLEAN Found = FALSE;
+
+    /* The token was never checked against a cached descriptor yet */
+    Cache = SepFindAccessCache(Token);
+    if (!Cache) return FALSE;
+
+    Entry = &Cache->Entries[SepAccessCacheIndex(SecurityDescriptor,
+                                                DesiredAccess,
+                                                PreviouslyGrantedAccess)];
+
+    ExAcquirePushLockShared(&Cache->PushLock);
+    if ((Entry->SecurityDescriptor == SecurityDescriptor) &&
+        (Entry->DesiredAccess == DesiredAccess) &&
+        (Entry->PreviouslyGrantedAccess == PreviouslyGrantedAccess) &&
+        (Entry->GenericMapping == GenericMapping))
+    {
+        /* The token lock is held, so the modified ID can't change under us */
+        if (RtlEqualLuid(&Entry->ModifiedId, &Token->ModifiedId))
+        {
+            *GrantedAccess = Entry->GrantedAccess;
+            *AccessStatus = Entry->AccessStatus;
+            Found = TRUE;
+        }
+        else
+        {
+            /* The token was adjusted since this result was computed */
+            SepAccessCacheStatistics.Stale++;
+        }
+    }
+    ExReleasePushLockShared(&Cache->PushLock);
+
+    return Found;
+}
+
+static
+VOID
+SepAccessCacheInsert(IN PTOKEN Token,
+                     IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+                     IN ACCESS_MASK DesiredAccess,
+                     IN ACCESS_MASK PreviouslyGrantedAccess,
+                     IN PGENERIC_MAPPING GenericMapping,
+                     IN ACCESS_MASK GrantedAccess,
+                     IN NTSTATUS AccessStatus)
+{
+    PSEP_ACCESS_CACHE_BUCKET Bucket;
+    PSEP_ACCESS_CACHE Cache, NewCache;
+    PSEP_ACCESS_CACHE_ENTRY Entry;
+    PSECURITY_DESCRIPTOR OldDescriptor;
+
+    /* Allocate the cache of the token on first use */
+    Cache = SepFindAccessCache(Token);
+    if (!Cache)
+    {
+        NewCache = ExAllocatePoolWithTag(PagedPool,
+                                         sizeof(SEP_ACCESS_CACHE),
+                                         TAG_SE_ACCESS_CACHE);
+        if (!NewCache) return;
+
+        RtlZeroMemory(NewCache, sizeof(SEP_ACCESS_CACHE));
+        NewCache->Token = Token;
+        ExInitializePushLock(&NewCache->PushLock);
+
+        /* Other checks may run on the token at the same time, only one wins */
+        Bucket = SepAccessCacheBucket(Token);
+        ExAcquirePushLockExclusive(&Bucket->PushLock);
+        for (Cache = Bucket->Caches; Cache; Cache = Cache->Next)
+        {
+            if (Cache->Token == Token) break;
+        }
+        if (!Cache)
+        {
+            NewCache->Next = Bucket->Caches;
+            Bucket->Caches = NewCache;
+        }
+        ExReleasePushLockExclusive(&Bucket->PushLock);
+
+        if (Cache)
+        {
+            ExFreePoolWithTag(NewCache, TAG_SE_ACCESS_CACHE);
+        }
+        else
+        {
+            Cache = NewCache;
+            SepAccessCacheStatistics.Caches++;
+        }
+    }
+
+    Entry = &Cache->Entries[SepAccessCacheIndex(SecurityDescriptor,
+                                                DesiredAccess,
+                                                PreviouslyGrantedAccess)];
+
+    /* The entry keeps the descriptor alive, so that its address stays unique */
+    ObReferenceSecurityDescriptor(SecurityDescriptor, 1);
+
+    ExAcquirePushLockExclusive(&Cache->PushLock);
+    OldDescriptor = Entry->SecurityDescriptor;
+    Entry->SecurityDescriptor = SecurityDescriptor;
+    Entry->GenericMapping = GenericMapping;
+    Entry->ModifiedId = Token->ModifiedId;
+    Entry->DesiredAccess = DesiredAccess;
+    Entry->PreviouslyGrantedAccess = PreviouslyGrantedAccess;
+    Entry->GrantedAccess = GrantedAccess;
+    Entry->AccessStatus = AccessStatus;
+    ExReleasePushLockExclusive(&Cache->PushLock);
+
+    SepAccessCacheStatistics.Inserts++;
+    if (OldDescriptor)
+    {
+        /* Release the descriptor of the result we replaced */
+        SepAccessCacheStatistics.Replaced++;
+        ObDereferenceSecurityDescriptor(OldDescriptor, 1);
+    }
+}
+
+VOID
+NTAPI
+SepDeleteAccessCache(IN PTOKEN Token)
+{
+    PSEP_ACCESS_CACHE_BUCKET Bucket = SepAccessCacheBucket(Token);
+    PSEP_ACCESS_CACHE Cache, *Link;
+    ULONG i;
+
+    /* Unlink the cache of the token, if it has one */
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&Bucket->PushLock);
+    for (Link = &Bucket->Caches; (Cache = *Link) != NULL; Link = &Cache->Next)
+    {
+        if (Cache->Token == Token)
+        {
+            *Link = Cache->Next;
+            break;
+        }
+    }
+    ExReleasePushLockExclusive(&Bucket->PushLock);
+    KeLeaveCriticalRegion();
+
+    if (!Cache) return;
+
+    /* Nobody else can use the token anymore, release the descriptors */
+    for (i = 0; i < SEP_ACCESS_CACHE_ENTRIES; i++)
+    {
+        if (Cache->Entries[i].SecurityDescriptor)
+            ObDereferenceSecurityDescriptor(Cache->Entries[i].SecurityDescriptor, 1);
+    }
+
+    SepAccessCacheStatistics.Caches--;
+    ExFreePoolWithTag(Cache, TAG_SE_ACCESS_CACHE);
+}
+
+/*
+ * Same as SeAccessCheck, but the result is cached in the token, so that
+ * repeated opens of objects sharing the descriptor skip the DACL walk. The
+ * descriptor is either from the object manager's cache and referenced by the
+ * caller for the duration of the call (DescriptorCached), or a self-relative
+ * copy that gets looked up in that cache. GenericMapping must be the one of
+ * an object type, as entries compare it by address.
+ */
+BOOLEAN
+NTAPI
+SepAccessCheckWithCache(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
+                        IN PSECURITY_SUBJECT_CONTEXT SubjectSecurityContext,
+                        IN BOOLEAN SubjectContextLocked,
+                        IN ACCESS_MASK DesiredAccess,
+                        IN ACCESS_MASK PreviouslyGrantedAccess,
+                        OUT PPRIVILEGE_SET* Privileges,
+                        IN PGENERIC_MAPPING GenericMapping,
+                        IN KPROCESSOR_MODE AccessMode,
+                        OUT PACCESS_MASK GrantedAccess,
+                        OUT PNTSTATUS AccessStatus,
+                        IN BOOLEAN DescriptorCached)
+{
+    PSECURITY_DESCRIPTOR LoggedDescriptor = NULL;
+    PTOKEN Token;
+    BOOLEAN Result;
+    PAGED_CODE();
+
+    /*
+     * Kernel mode, missing descriptor and bad impersonation are quick anyway.
+     * Objects with their own security method, like registry keys and files,
+     * hand out a fresh copy of their descriptor, so the cached descriptor with
+     * the same contents is used as the key instead. A changed descriptor gets
+     * a different one.
+     */
+    if ((AccessMode == KernelMode) ||
+        !(SecurityDescriptor) ||
+        ((SubjectSecurityContext->ClientToken) &&
+         (SubjectSecurityContext->ImpersonationLevel < SecurityImpersonation)) ||
+        (!(DescriptorCached) &&
+         (!(((PISECURITY_DESCRIPTOR)SecurityDescriptor)->Control & SE_SELF_RELATIVE) ||
+          !NT_SUCCESS(ObLogSecurityDescriptor(SecurityDescriptor, &LoggedDescriptor, 1)))))
+    {
+        return SeAccessCheck(SecurityDescriptor,
+                             SubjectSecurityContext,
+                             SubjectContextLocked,
+                             DesiredAccess,
+                             PreviouslyGrantedAccess,
+                             Privileges,
+                             GenericMapping,
+                             AccessMode,
+                             GrantedAccess,
+                             AccessStatus);
+    }
+
+    /* Acquire the lock if needed, it also keeps the token from changing */
+    if (!SubjectContextLocked)
+        SeLockSubjectContext(SubjectSecurityContext);
+
+    Token = SubjectSecurityContext->ClientToken ?
+        SubjectSecurityContext->ClientToken : SubjectSecurityContext->PrimaryToken;
+
+    if (LoggedDescriptor)
+    {
+        SecurityDescriptor = LoggedDescriptor;
+        SepAccessCacheStatistics.Logged++;
+    }
+
+    SepAccessCacheStatistics.Lookups++;
+    if (SepAccessCacheLookup(Token,
+                             SecurityDescriptor,
+                             DesiredAccess,
+                             PreviouslyGrantedAccess,
+                             GenericMapping,
+                             GrantedAccess,
+                             AccessStatus))
+    {
+        /* Only results that didn't need any privilege are cached */
+        SepAccessCacheStatistics.Hits++;
+        *Privileges = NULL;
+        Result = NT_SUCCESS(*AccessStatus);
+    }
+    else
+    {
+        /* Do the real check */
+        *Privileges = NULL;
+        Result = SeAccessCheck(SecurityDescriptor,
+                               SubjectSecurityContext,
+                               TRUE,
+                               DesiredAccess,
+                               PreviouslyGrantedAccess,
+                               Privileges,
+                               GenericMapping,
+                               AccessMode,
+                               GrantedAccess,
+                               AccessStatus);
+
+        /* Privileges are audited and appended to the access state, don't cache them */
+        if (!(*Privileges) &&
+            !(DesiredAccess & (ACCESS_SYSTEM_SECURITY | WRITE_OWNER)))
+        {
+            SepAccessCacheInsert(Token,
+                                 SecurityDescriptor,
+                                 DesiredAccess,
+                                 PreviouslyGrantedAccess,
+                                 GenericMapping,
+                                 *GrantedAccess,
+                                 *AccessStatus);
+        }
+        else
+        {
+            SepAccessCacheStatistics.Uncacheable++;
+        }
+    }
+
+    /* Release the lock if needed */
+    if (!SubjectContextLocked)
+        SeUnlockSubjectContext(SubjectSecurityContext);
+
+    /* A cache entry keeps its own reference, drop ours */
+    if (LoggedDescriptor)
+        ObDereferenceSecurityDescriptor(LoggedDescriptor, 1);
+
+    return Result;
+}
+
 /*
  * FIXME: Incomplete!
  */
@@ -805,4 +1149,27 @@ NtAccessCheckByTypeResultList(IN PSECURITY_DESCRIPTOR SecurityDescriptor,
     return STATUS_NOT_IMPLEMENTED;
 }
 
+#if DBG && defined(KDBG)
+BOOLEAN
+ExpKdbgExtAccessCache(ULONG Argc, PCHAR Argv[])
+{
+    PSEP_ACCESS_CACHE_STATISTICS Statistics = &SepAccessCacheStatistics;
+
+    /* No need to lock anything here, we're in the debugger */
+    KdbpPrint("%lu token caches of %lu entries\n", Statistics->Caches, SEP_ACCESS_CACHE_ENTRIES);
+    KdbpPrint("%lu lookups, %lu hits (%lu%%), %lu stale\n",
+              Statistics->Lookups,
+              Statistics->Hits,
+              Statistics->Lookups ? (ULONG)((ULONGLONG)Statistics->Hits * 100 / Statistics->Lookups) : 0,
+              Statistics->Stale);
+    KdbpPrint("%lu inserts, %lu replaced, %lu uncacheable\n",
+              Statistics->Inserts,
+              Statistics->Replaced,
+              Statistics->Uncacheable);
+    KdbpPrint("%lu lookups of descriptors from security methods\n",
+              Statistics->Logged);
+    return TRUE;
+}
+#endif // DBG && KDBG
+
 /* EOF */
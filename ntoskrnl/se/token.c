@@ -1073,6 +1073,9 @@ SepDeleteToken(PVOID ObjectBody)
     if (AccessToken->TokenLock)
         SepDeleteTokenLock(AccessToken);
 
+    /* Release the cached access check results */
+    SepDeleteAccessCache(AccessToken);
+
     /* Delete the dynamic information area */
     if (AccessToken->DynamicPart)
         ExFreePoolWithTag(AccessToken->DynamicPart, TAG_TOKEN_DYNAMIC);
@@ -0,0 +1,573 @@
+/*
+ * PROJECT:         ReactOS Kernel
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            ntoskrnl/wmi/ktrace.c
+ * PURPOSE:         NT Kernel Logger event providers
+ * PROGRAMMERS:
+ */
+
+/*
+ * The scheduler, the I/O manager and the memory manager call the inline
+ * WmipTrace* gates of internal/wmi.h, which only call in here when the
+ * matching group is set in WmipKernelLoggerFlags. Everything below can run
+ * at any IRQL, including from the context switch path with the dispatcher
+ * lock held, and must therefore not block.
+ *
+ * Context switch and ready thread events are not logged where they happen:
+ * getting a trace buffer can allocate pool and queue a DPC. They are stored
+ * in a ring of the processor instead, preallocated when the kernel logger
+ * starts, and a periodic DPC on that processor logs them at DISPATCH_LEVEL.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntoskrnl.h>
+#include "wmip.h"
+
+#define NDEBUG
+#include <debug.h>
+
+C_ASSERT(WMI_KERNEL_TRACE_CSWITCH == EVENT_TRACE_FLAG_CSWITCH);
+C_ASSERT(WMI_KERNEL_TRACE_DISK_IO == EVENT_TRACE_FLAG_DISK_IO);
+C_ASSERT(WMI_KERNEL_TRACE_DISPATCHER == EVENT_TRACE_FLAG_DISPATCHER);
+C_ASSERT(WMI_KERNEL_TRACE_PAGE_FAULTS == EVENT_TRACE_FLAG_MEMORY_PAGE_FAULTS);
+C_ASSERT(WMI_KERNEL_TRACE_HARD_FAULTS == EVENT_TRACE_FLAG_MEMORY_HARD_FAULTS);
+
+/*
+ * Start times of the disk requests in flight, used to compute the response
+ * time when they complete. Slots are claimed with a compare-exchange, a
+ * request that finds no free slot is reported without a response time.
+ */
+#define WMIP_DISK_IO_SLOTS      256
+#define WMIP_DISK_IO_PROBES     16
+#define WMIP_DISK_IO_CLAIMED    ((PIRP)1)
+
+typedef struct _WMIP_DISK_IO_START
+{
+    PIRP Irp;
+    LONG64 TimeStamp;
+} WMIP_DISK_IO_START, *PWMIP_DISK_IO_START;
+
+/*
+ * Per-processor ring of scheduler events. The processor's context switches
+ * and ready thread calls are the only producers and its drain DPC is the
+ * only consumer while the logger runs, all at DISPATCH_LEVEL or above on
+ * that processor, so they never run at the same time. The last drain when
+ * the logger stops also runs on that processor, once it no longer logs.
+ */
+#define WMIP_THREAD_RING_SIZE       1024
+#define WMIP_THREAD_DRAIN_INTERVAL  50      /* ms */
+
+C_ASSERT((WMIP_THREAD_RING_SIZE & (WMIP_THREAD_RING_SIZE - 1)) == 0);
+
+typedef struct _WMIP_THREAD_RECORD
+{
+    WMIP_EVENT_STAMP Stamp;
+    UCHAR Type;
+    union
+    {
+        WMI_CSWITCH_EVENT CSwitch;
+        WMI_READY_THREAD_EVENT ReadyThread;
+    };
+} WMIP_THREAD_RECORD, *PWMIP_THREAD_RECORD;
+
+typedef struct DECLSPEC_CACHEALIGN _WMIP_THREAD_RING
+{
+    volatile ULONG Head;            /* Next record to write */
+    volatile ULONG Tail;            /* Next record to log */
+    volatile LONG Lost;
+    KTIMER DrainTimer;
+    KDPC DrainDpc;
+    WMIP_THREAD_RECORD Records[WMIP_THREAD_RING_SIZE];
+} WMIP_THREAD_RING, *PWMIP_THREAD_RING;
+
+/* GLOBALS *******************************************************************/
+
+static WMIP_DISK_IO_START WmipDiskIoStart[WMIP_DISK_IO_SLOTS];
+
+/* Allocated the first time the kernel logger starts, and kept */
+static PWMIP_THREAD_RING WmipThreadRings;
+static ULONG WmipThreadRingCount;
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+FORCEINLINE
+ULONG
+WmipGetThreadId(
+    _In_ PKTHREAD Thread)
+{
+    return HandleToUlong(CONTAINING_RECORD(Thread, ETHREAD, Tcb)->Cid.UniqueThread);
+}
+
+FORCEINLINE
+ULONG
+WmipDiskIoHash(
+    _In_ PIRP Irp)
+{
+    ULONG_PTR Value = (ULONG_PTR)Irp;
+
+    return (ULONG)((Value >> 6) ^ (Value >> 14));
+}
+
+static
+VOID
+WmipLogKernelEvent(
+    _In_ const GUID *Guid,
+    _In_ UCHAR Type,
+    _In_reads_bytes_(Length) PVOID Data,
+    _In_ ULONG Length)
+{
+    EVENT_TRACE_HEADER Header;
+    MOF_FIELD Field;
+
+    RtlZeroMemory(&Header, sizeof(Header));
+    Header.Guid = *Guid;
+    Header.Class.Type = Type;
+
+    Field.DataPtr = (ULONG64)(ULONG_PTR)Data;
+    Field.Length = Length;
+    Field.DataType = 0;
+
+    WmipLogEvent(WMI_KERNEL_LOGGER_ID, &Header, &Field, 1);
+}
+
+/* Returns the stack location of the driver the IRP was first sent to */
+FORCEINLINE
+PIO_STACK_LOCATION
+WmipGetFirstStackLocation(
+    _In_ PIRP Irp)
+{
+    return (PIO_STACK_LOCATION)(Irp + 1) + Irp->StackCount - 1;
+}
+
+static
+BOOLEAN
+WmipIsDiskTransfer(
+    _In_ PIO_STACK_LOCATION StackLocation)
+{
+    return StackLocation->DeviceObject &&
+           StackLocation->DeviceObject->DeviceType == FILE_DEVICE_DISK &&
+           (StackLocation->MajorFunction == IRP_MJ_READ ||
+            StackLocation->MajorFunction == IRP_MJ_WRITE);
+}
+
+/*
+ * Returns the next free record of the ring of the current processor, which
+ * the caller fills and publishes with WmipCommitThreadRecord.
+ */
+static
+PWMIP_THREAD_RECORD
+WmipGetThreadRecord(
+    _Out_ PWMIP_THREAD_RING *OutRing)
+{
+    PWMIP_THREAD_RING Ring;
+    PWMIP_THREAD_RECORD Record;
+    PKTHREAD Thread;
+    ULONG Processor;
+
+    /* Only this processor writes its ring, nobody may preempt us */
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+    Processor = KeGetCurrentProcessorNumber();
+    if (Processor >= WmipThreadRingCount)
+        return NULL;
+
+    /* A full ring drops the event, the drain DPC will catch up */
+    Ring = &WmipThreadRings[Processor];
+    if (Ring->Head - Ring->Tail >= WMIP_THREAD_RING_SIZE)
+    {
+        InterlockedIncrement(&Ring->Lost);
+        return NULL;
+    }
+
+    /* Stamp it like WmipLogEvent would have */
+    Record = &Ring->Records[Ring->Head & (WMIP_THREAD_RING_SIZE - 1)];
+    Thread = KeGetCurrentThread();
+    Record->Stamp.TimeStamp = WmipGetKernelTraceTimeStamp();
+    Record->Stamp.ThreadId = HandleToUlong(PsGetCurrentThreadId());
+    Record->Stamp.ProcessId = HandleToUlong(PsGetCurrentProcessId());
+    Record->Stamp.KernelTime = Thread->KernelTime;
+    Record->Stamp.UserTime = Thread->UserTime;
+    Record->Stamp.ProcessorNumber = Processor;
+
+    *OutRing = Ring;
+    return Record;
+}
+
+FORCEINLINE
+VOID
+WmipCommitThreadRecord(
+    _In_ PWMIP_THREAD_RING Ring)
+{
+    /* The record must be complete before the consumer can see it */
+    KeMemoryBarrier();
+    Ring->Head = Ring->Head + 1;
+}
+
+static
+VOID
+WmipDrainThreadRing(
+    _In_ PWMIP_THREAD_RING Ring)
+{
+    PWMIP_LOGGER_CONTEXT Logger = WmipLoggerContext[WMI_KERNEL_LOGGER_ID];
+    PWMIP_THREAD_RECORD Record;
+    EVENT_TRACE_HEADER Header;
+    MOF_FIELD Field;
+    ULONG Head, Tail;
+    LONG Lost;
+
+    Head = Ring->Head;
+    KeMemoryBarrier();
+
+    RtlZeroMemory(&Header, sizeof(Header));
+    Header.Guid = ThreadGuid;
+    Field.DataType = 0;
+
+    for (Tail = Ring->Tail; Tail != Head; Tail++)
+    {
+        Record = &Ring->Records[Tail & (WMIP_THREAD_RING_SIZE - 1)];
+        Header.Class.Type = Record->Type;
+        if (Record->Type == WMI_TYPE_CSWITCH)
+        {
+            Field.DataPtr = (ULONG64)(ULONG_PTR)&Record->CSwitch;
+            Field.Length = sizeof(Record->CSwitch);
+        }
+        else
+        {
+            Field.DataPtr = (ULONG64)(ULONG_PTR)&Record->ReadyThread;
+            Field.Length = sizeof(Record->ReadyThread);
+        }
+
+        WmipLogStampedEvent(WMI_KERNEL_LOGGER_ID, &Header, &Field, 1, &Record->Stamp);
+    }
+
+    /* Give the records back once they were copied */
+    KeMemoryBarrier();
+    Ring->Tail = Tail;
+
+    /* Account for the events the full ring dropped */
+    Lost = InterlockedExchange(&Ring->Lost, 0);
+    if (Lost && Logger)
+        InterlockedExchangeAdd(&Logger->EventsLost, Lost);
+}
+
+_Function_class_(KDEFERRED_ROUTINE)
+static
+VOID
+NTAPI
+WmipDrainDpcRoutine(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    WmipDrainThreadRing(DeferredContext);
+}
+
+VOID
+NTAPI
+WmipStartKernelTrace(
+    VOID)
+{
+    PWMIP_THREAD_RING Rings;
+    LARGE_INTEGER DueTime;
+    ULONG i;
+
+    /* Forget the requests of the previous session, the kernel logger is not running */
+    RtlZeroMemory(WmipDiskIoStart, sizeof(WmipDiskIoStart));
+
+    /* Preallocate the scheduler event rings, without them those events are dropped */
+    if (!WmipThreadRings)
+    {
+        Rings = ExAllocatePoolWithTag(NonPagedPool,
+                                      KeNumberProcessors * sizeof(WMIP_THREAD_RING),
+                                      TAG_WMI_BUFFER);
+        if (!Rings)
+            return;
+
+        for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+        {
+            KeInitializeTimerEx(&Rings[i].DrainTimer, NotificationTimer);
+            KeInitializeDpc(&Rings[i].DrainDpc, WmipDrainDpcRoutine, &Rings[i]);
+            KeSetTargetProcessorDpc(&Rings[i].DrainDpc, (CCHAR)i);
+        }
+
+        WmipThreadRings = Rings;
+        WmipThreadRingCount = KeNumberProcessors;
+    }
+
+    /* Start empty, and drain every ring on its own processor */
+    DueTime.QuadPart = -(LONGLONG)WMIP_THREAD_DRAIN_INTERVAL * 10 * 1000;
+    for (i = 0; i < WmipThreadRingCount; i++)
+    {
+        WmipThreadRings[i].Head = 0;
+        WmipThreadRings[i].Tail = 0;
+        WmipThreadRings[i].Lost = 0;
+        KeSetTimerEx(&WmipThreadRings[i].DrainTimer,
+                     DueTime,
+                     WMIP_THREAD_DRAIN_INTERVAL,
+                     &WmipThreadRings[i].DrainDpc);
+    }
+}
+
+VOID
+NTAPI
+WmipStopKernelTrace(
+    VOID)
+{
+    KIRQL OldIrql;
+    ULONG i;
+
+    /* The caller cleared WmipKernelLoggerFlags, no new event gets recorded */
+    ASSERT(WmipKernelLoggerFlags == 0);
+    KeMemoryBarrier();
+
+    for (i = 0; i < WmipThreadRingCount; i++)
+        KeCancelTimer(&WmipThreadRings[i].DrainTimer);
+
+    /*
+     * Records are written at DISPATCH_LEVEL or above, so once this thread
+     * runs on a processor, the record it was writing when the flags were
+     * cleared is committed and no other one follows. Log what is left in
+     * its ring from there, without racing with a drain DPC that was already
+     * queued when the timer got cancelled.
+     */
+    for (i = 0; i < WmipThreadRingCount; i++)
+    {
+        if (!(KeActiveProcessors & AFFINITY_MASK(i)))
+            continue;
+
+        KeSetSystemAffinityThread(AFFINITY_MASK(i));
+        KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+        WmipDrainThreadRing(&WmipThreadRings[i]);
+        KeLowerIrql(OldIrql);
+    }
+    KeRevertToUserAffinityThread();
+}
+
+LONG64
+FASTCALL
+WmipGetKernelTraceTimeStamp(
+    VOID)
+{
+    PWMIP_LOGGER_CONTEXT Logger = WmipLoggerContext[WMI_KERNEL_LOGGER_ID];
+
+    return WmipGetTimeStamp(Logger ? Logger->ClockType : 0);
+}
+
+VOID
+FASTCALL
+WmipLogContextSwitch(
+    _In_ PKTHREAD OldThread,
+    _In_ PKTHREAD NewThread)
+{
+    PWMIP_THREAD_RING Ring;
+    PWMIP_THREAD_RECORD Record;
+
+    Record = WmipGetThreadRecord(&Ring);
+    if (!Record)
+        return;
+
+    Record->Type = WMI_TYPE_CSWITCH;
+    Record->CSwitch.NewThreadId = WmipGetThreadId(NewThread);
+    Record->CSwitch.OldThreadId = WmipGetThreadId(OldThread);
+    Record->CSwitch.NewThreadPriority = NewThread->Priority;
+    Record->CSwitch.OldThreadPriority = OldThread->Priority;
+    Record->CSwitch.OldThreadWaitReason = OldThread->WaitReason;
+    Record->CSwitch.OldThreadWaitMode = OldThread->WaitMode;
+    Record->CSwitch.OldThreadState = OldThread->State;
+    RtlZeroMemory(Record->CSwitch.Reserved, sizeof(Record->CSwitch.Reserved));
+    Record->CSwitch.NewThreadWaitTime = KeTickCount.LowPart - NewThread->WaitTime;
+
+    WmipCommitThreadRecord(Ring);
+}
+
+VOID
+FASTCALL
+WmipLogReadyThread(
+    _In_ PKTHREAD Thread)
+{
+    PWMIP_THREAD_RING Ring;
+    PWMIP_THREAD_RECORD Record;
+
+    Record = WmipGetThreadRecord(&Ring);
+    if (!Record)
+        return;
+
+    Record->Type = WMI_TYPE_READY_THREAD;
+    Record->ReadyThread.ThreadId = WmipGetThreadId(Thread);
+    Record->ReadyThread.Priority = Thread->Priority;
+    RtlZeroMemory(Record->ReadyThread.Reserved, sizeof(Record->ReadyThread.Reserved));
+
+    WmipCommitThreadRecord(Ring);
+}
+
+VOID
+FASTCALL
+WmipLogDiskIoStart(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp)
+{
+    PIO_STACK_LOCATION StackLocation;
+    PWMIP_DISK_IO_START Slot;
+    WMI_DISKIO_INIT_EVENT Event;
+    ULONG Hash, i;
+
+    /* Only report the request once, when it leaves its originator */
+    if (Irp->CurrentLocation != Irp->StackCount)
+        return;
+
+    StackLocation = WmipGetFirstStackLocation(Irp);
+    ASSERT(StackLocation->DeviceObject == DeviceObject);
+    if (!WmipIsDiskTransfer(StackLocation))
+        return;
+
+    /* Remember when it started */
+    Hash = WmipDiskIoHash(Irp);
+    for (i = 0; i < WMIP_DISK_IO_PROBES; i++)
+    {
+        Slot = &WmipDiskIoStart[(Hash + i) % WMIP_DISK_IO_SLOTS];
+        if (!Slot->Irp &&
+            InterlockedCompareExchangePointer((PVOID*)&Slot->Irp,
+                                              WMIP_DISK_IO_CLAIMED,
+                                              NULL) == NULL)
+        {
+            Slot->TimeStamp = WmipGetKernelTraceTimeStamp();
+            InterlockedExchangePointer((PVOID*)&Slot->Irp, Irp);
+            break;
+        }
+    }
+
+    Event.Irp = (ULONG64)(ULONG_PTR)Irp;
+    WmipLogKernelEvent(&DiskIoGuid,
+                       (StackLocation->MajorFunction == IRP_MJ_READ) ?
+                       EVENT_TRACE_TYPE_IO_READ_INIT : EVENT_TRACE_TYPE_IO_WRITE_INIT,
+                       &Event,
+                       sizeof(Event));
+}
+
+VOID
+FASTCALL
+WmipLogDiskIoCompletion(
+    _In_ PIRP Irp)
+{
+    PIO_STACK_LOCATION StackLocation;
+    PWMIP_DISK_IO_START Slot;
+    WMI_DISKIO_EVENT Event;
+    ULONG Hash, i;
+
+    /* IoCompleteRequest did not touch the stack locations yet */
+    StackLocation = WmipGetFirstStackLocation(Irp);
+    if (Irp->StackCount == 0 || !WmipIsDiskTransfer(StackLocation))
+        return;
+
+    Event.ResponseTime = 0;
+    Hash = WmipDiskIoHash(Irp);
+    for (i = 0; i < WMIP_DISK_IO_PROBES; i++)
+    {
+        Slot = &WmipDiskIoStart[(Hash + i) % WMIP_DISK_IO_SLOTS];
+        if (Slot->Irp == Irp)
+        {
+            Event.ResponseTime = WmipGetKernelTraceTimeStamp() - Slot->TimeStamp;
+            InterlockedExchangePointer((PVOID*)&Slot->Irp, NULL);
+            break;
+        }
+    }
+
+    Event.Irp = (ULONG64)(ULONG_PTR)Irp;
+    Event.DeviceObject = (ULONG64)(ULONG_PTR)StackLocation->DeviceObject;
+    Event.FileObject = (ULONG64)(ULONG_PTR)StackLocation->FileObject;
+    Event.IrpFlags = Irp->Flags;
+    Event.Status = Irp->IoStatus.Status;
+    Event.Reserved = 0;
+    if (StackLocation->MajorFunction == IRP_MJ_READ)
+    {
+        Event.ByteOffset = StackLocation->Parameters.Read.ByteOffset.QuadPart;
+        Event.TransferSize = StackLocation->Parameters.Read.Length;
+    }
+    else
+    {
+        Event.ByteOffset = StackLocation->Parameters.Write.ByteOffset.QuadPart;
+        Event.TransferSize = StackLocation->Parameters.Write.Length;
+    }
+
+    WmipLogKernelEvent(&DiskIoGuid,
+                       (StackLocation->MajorFunction == IRP_MJ_READ) ?
+                       EVENT_TRACE_TYPE_IO_READ : EVENT_TRACE_TYPE_IO_WRITE,
+                       &Event,
+                       sizeof(Event));
+}
+
+VOID
+FASTCALL
+WmipLogPageFault(
+    _In_ NTSTATUS Status,
+    _In_ PVOID Address,
+    _In_opt_ PVOID TrapInformation)
+{
+    WMI_PAGE_FAULT_EVENT Event;
+    UCHAR Type;
+
+    switch (Status)
+    {
+        case STATUS_SUCCESS:
+        case STATUS_PAGE_FAULT_TRANSITION:
+            Type = EVENT_TRACE_TYPE_MM_TF;
+            break;
+
+        case STATUS_PAGE_FAULT_DEMAND_ZERO:
+            Type = EVENT_TRACE_TYPE_MM_DZF;
+            break;
+
+        case STATUS_PAGE_FAULT_COPY_ON_WRITE:
+            Type = EVENT_TRACE_TYPE_MM_COW;
+            break;
+
+        case STATUS_PAGE_FAULT_GUARD_PAGE:
+        case STATUS_GUARD_PAGE_VIOLATION:
+            Type = EVENT_TRACE_TYPE_MM_GPF;
+            break;
+
+        case STATUS_PAGE_FAULT_PAGING_FILE:
+            Type = EVENT_TRACE_TYPE_MM_HPF;
+            break;
+
+        case STATUS_ACCESS_VIOLATION:
+            Type = EVENT_TRACE_TYPE_MM_AV;
+            break;
+
+        default:
+            /* In-page errors and the like are reported by the hard fault events */
+            return;
+    }
+
+    Event.VirtualAddress = (ULONG64)(ULONG_PTR)Address;
+    Event.ProgramCounter = 0;
+    if (TrapInformation &&
+        TrapInformation != (PVOID)(ULONG_PTR)0xBADBADA3BADBADA3ULL)
+    {
+        Event.ProgramCounter = (ULONG64)KeGetTrapFramePc((PKTRAP_FRAME)TrapInformation);
+    }
+
+    WmipLogKernelEvent(&PageFaultGuid, Type, &Event, sizeof(Event));
+}
+
+VOID
+FASTCALL
+WmipLogHardFault(
+    _In_ LONG64 InitialTime,
+    _In_ ULONG64 ReadOffset,
+    _In_ PVOID Address,
+    _In_opt_ PFILE_OBJECT FileObject,
+    _In_ ULONG ByteCount)
+{
+    WMI_HARD_FAULT_EVENT Event;
+
+    Event.InitialTime.QuadPart = InitialTime;
+    Event.ReadOffset = ReadOffset;
+    Event.VirtualAddress = (ULONG64)(ULONG_PTR)Address;
+    Event.FileObject = (ULONG64)(ULONG_PTR)FileObject;
+    Event.ThreadId = HandleToUlong(PsGetCurrentThreadId());
+    Event.ByteCount = ByteCount;
+
+    WmipLogKernelEvent(&PageFaultGuid, WMI_TYPE_HARD_FAULT, &Event, sizeof(Event));
+}
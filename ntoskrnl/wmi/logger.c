@@ -0,0 +1,1447 @@
+/*
+ * PROJECT:         ReactOS Kernel
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            ntoskrnl/wmi/logger.c
+ * PURPOSE:         Event Trace Sessions (Loggers)
+ * PROGRAMMERS:
+ */
+
+/*
+ * Every logger owns one current trace buffer per processor. Writers raise
+ * to DISPATCH_LEVEL so that they stay on their processor while reserving
+ * room in its buffer with a compare-exchange on the buffer offset; the only
+ * writers that can race with them are interrupts nested on that processor.
+ * A full buffer is replaced with a free one by a compare-exchange on the
+ * processor slot and pushed onto the flush list, from where the logger
+ * thread writes it to the log file or queues it for real-time consumers,
+ * and then puts it back onto the free list.
+ *
+ * Nothing on the write path blocks or signals a dispatcher object: the
+ * logger thread is woken by a DPC, and stopping a logger only waits for the
+ * per-processor writer counts to drain. Events can therefore be logged at
+ * any IRQL and with the dispatcher lock held, as long as the event data is
+ * resident. Above DISPATCH_LEVEL, full buffers can only be replaced with
+ * already allocated free buffers.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntoskrnl.h>
+#include "wmip.h"
+
+#define NDEBUG
+#include <debug.h>
+
+#define TAG_WMI_LOGGER 'gLmW'
+#define TAG_WMI_BUFFER 'bTmW'
+#define TAG_WMI_GUID   'gTmW'
+
+/* Limits for the user supplied logger parameters */
+#define WMIP_MIN_BUFFER_SIZE        (4 * 1024)
+#define WMIP_MAX_BUFFER_SIZE        (1024 * 1024)
+#define WMIP_DEFAULT_BUFFER_SIZE    (64 * 1024)
+#define WMIP_MAX_REALTIME_BUFFERS   64
+
+typedef struct _WMIP_TRACE_GUID_ENTRY
+{
+    LIST_ENTRY ListEntry;
+    GUID Guid;
+    ULONG64 LoggerHandle;
+} WMIP_TRACE_GUID_ENTRY, *PWMIP_TRACE_GUID_ENTRY;
+
+/* GLOBALS *******************************************************************/
+
+/* Logger contexts are allocated on first use and never freed, so that writers
+ * can look them up without taking any lock */
+PWMIP_LOGGER_CONTEXT WmipLoggerContext[WMI_MAX_LOGGERS];
+
+/* Protects the logger slots and the enabled trace GUIDs */
+KGUARDED_MUTEX WmipLoggerLock;
+LIST_ENTRY WmipTraceGuidListHead;
+
+/* EnableFlags of the NT Kernel Logger, 0 when it is not running */
+ULONG WmipKernelLoggerFlags;
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+VOID
+NTAPI
+WmipInitializeLoggers(
+    VOID)
+{
+    KeInitializeGuardedMutex(&WmipLoggerLock);
+    InitializeListHead(&WmipTraceGuidListHead);
+}
+
+LONG64
+NTAPI
+WmipGetTimeStamp(
+    _In_ ULONG ClockType)
+{
+    LARGE_INTEGER Time;
+
+    /* ClockType is Wnode.ClientContext: 1 is the performance counter,
+     * 2 is the system time and 3 is the CPU cycle counter */
+    switch (ClockType)
+    {
+        case 2:
+            KeQuerySystemTime(&Time);
+            return Time.QuadPart;
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+        case 3:
+            return (LONG64)__rdtsc();
+#endif
+
+        default:
+            return KeQueryPerformanceCounter(NULL).QuadPart;
+    }
+}
+
+static
+PWMIP_TRACE_BUFFER
+WmipGetFreeBuffer(
+    _In_ PWMIP_LOGGER_CONTEXT Logger)
+{
+    PWMIP_TRACE_BUFFER Buffer;
+
+    /* Use a free buffer if there is one */
+    Buffer = (PWMIP_TRACE_BUFFER)InterlockedPopEntrySList(&Logger->FreeList);
+    if (Buffer)
+        return Buffer;
+
+    /* Pool can only be allocated up to DISPATCH_LEVEL */
+    if (KeGetCurrentIrql() > DISPATCH_LEVEL)
+        return NULL;
+
+    /* Grow the logger, up to MaximumBuffers */
+    if (InterlockedIncrement(&Logger->NumberOfBuffers) > (LONG)Logger->MaximumBuffers)
+    {
+        InterlockedDecrement(&Logger->NumberOfBuffers);
+        return NULL;
+    }
+
+    Buffer = ExAllocatePoolWithTag(NonPagedPool,
+                                   FIELD_OFFSET(WMIP_TRACE_BUFFER, Header) + Logger->BufferSize,
+                                   TAG_WMI_BUFFER);
+    if (!Buffer)
+    {
+        InterlockedDecrement(&Logger->NumberOfBuffers);
+        return NULL;
+    }
+
+    Buffer->ReferenceCount = 0;
+    Buffer->CurrentOffset = sizeof(WMI_TRACE_BUFFER_HEADER);
+    return Buffer;
+}
+
+static
+VOID
+WmipQueueFlush(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _In_ PWMIP_TRACE_BUFFER Buffer)
+{
+    InterlockedPushEntrySList(&Logger->FlushList, &Buffer->ListEntry);
+
+    /* The DPC wakes up the logger thread, KeSetEvent cannot be used here
+     * because the caller may hold the dispatcher lock */
+    KeInsertQueueDpc(&Logger->FlushDpc, NULL, NULL);
+}
+
+/*
+ * Replaces the current buffer of a processor, returns FALSE if there is no
+ * free buffer. Returns TRUE when the slot no longer contains OldBuffer,
+ * whoever replaced it.
+ */
+static
+BOOLEAN
+WmipSwitchBuffer(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _In_ PWMIP_PROCESSOR_BUFFER Processor,
+    _In_opt_ PWMIP_TRACE_BUFFER OldBuffer,
+    _In_ ULONG ProcessorNumber)
+{
+    PWMIP_TRACE_BUFFER NewBuffer;
+
+    NewBuffer = WmipGetFreeBuffer(Logger);
+    if (!NewBuffer)
+        return FALSE;
+
+    NewBuffer->ProcessorNumber = ProcessorNumber;
+    if (InterlockedCompareExchangePointer((PVOID*)&Processor->Buffer,
+                                          NewBuffer,
+                                          OldBuffer) != OldBuffer)
+    {
+        /* A nested writer or the logger thread was faster */
+        InterlockedPushEntrySList(&Logger->FreeList, &NewBuffer->ListEntry);
+        return TRUE;
+    }
+
+    if (OldBuffer)
+        WmipQueueFlush(Logger, OldBuffer);
+
+    return TRUE;
+}
+
+/*
+ * Reserves Size bytes in the current buffer of the processor and returns a
+ * referenced buffer, or NULL if the event has to be dropped.
+ */
+static
+PVOID
+WmipReserveEvent(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _In_ PWMIP_PROCESSOR_BUFFER Processor,
+    _In_ ULONG ProcessorNumber,
+    _In_ ULONG Size,
+    _Out_ PWMIP_TRACE_BUFFER *OutBuffer)
+{
+    PWMIP_TRACE_BUFFER Buffer;
+    LONG Offset;
+
+    for (;;)
+    {
+        Buffer = Processor->Buffer;
+        if (!Buffer)
+        {
+            if (!WmipSwitchBuffer(Logger, Processor, NULL, ProcessorNumber))
+                return NULL;
+            continue;
+        }
+
+        /* Reference the buffer, then make sure it was not switched meanwhile */
+        InterlockedIncrement(&Buffer->ReferenceCount);
+        if (Buffer != Processor->Buffer)
+        {
+            InterlockedDecrement(&Buffer->ReferenceCount);
+            continue;
+        }
+
+        do
+        {
+            Offset = Buffer->CurrentOffset;
+            if (Offset + Size > Logger->BufferSize)
+                break;
+        } while (InterlockedCompareExchange(&Buffer->CurrentOffset,
+                                            Offset + Size,
+                                            Offset) != Offset);
+
+        if (Offset + Size <= Logger->BufferSize)
+        {
+            *OutBuffer = Buffer;
+            return (PUCHAR)&Buffer->Header + Offset;
+        }
+
+        /* The buffer is full */
+        InterlockedDecrement(&Buffer->ReferenceCount);
+        if (!WmipSwitchBuffer(Logger, Processor, Buffer, ProcessorNumber))
+            return NULL;
+    }
+}
+
+/*
+ * Logs one event: Header is used as a template for the event header and is
+ * followed by the fields. Both must stay resident if the caller is running
+ * at DISPATCH_LEVEL or above. Without a Stamp, the event is stamped with
+ * the current time, thread and processor.
+ */
+static
+NTSTATUS
+WmipLogEventInternal(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER Header,
+    _In_reads_(FieldCount) PMOF_FIELD Fields,
+    _In_ ULONG FieldCount,
+    _In_opt_ PWMIP_EVENT_STAMP Stamp)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    PWMIP_PROCESSOR_BUFFER Processor;
+    PWMIP_TRACE_BUFFER Buffer;
+    PEVENT_TRACE_HEADER Event;
+    PKTHREAD Thread;
+    ULONG ProcessorNumber, Size, i;
+    PUCHAR Data;
+    KIRQL OldIrql;
+
+    if (LoggerId == 0 || LoggerId >= WMI_MAX_LOGGERS)
+        return STATUS_INVALID_HANDLE;
+
+    Logger = WmipLoggerContext[LoggerId];
+    if (!Logger || !Logger->Active)
+        return STATUS_INVALID_HANDLE;
+
+    /* Compute the event size */
+    Size = sizeof(EVENT_TRACE_HEADER);
+    for (i = 0; i < FieldCount; i++)
+        Size += Fields[i].Length;
+    if (Size > MAXUSHORT)
+        return STATUS_BUFFER_OVERFLOW;
+
+    /* Stay on this processor while reserving room in its buffer */
+    OldIrql = KeGetCurrentIrql();
+    if (OldIrql < DISPATCH_LEVEL)
+        KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
+    ProcessorNumber = Stamp ? Stamp->ProcessorNumber : KeGetCurrentProcessorNumber();
+    Processor = &Logger->Processors[ProcessorNumber];
+    InterlockedIncrement(&Processor->WriterCount);
+
+    /* The logger may have been stopped, or stopped and restarted with smaller buffers */
+    if (!Logger->Active ||
+        ALIGN_UP_BY(Size, WMI_TRACE_ALIGNMENT) > Logger->BufferSize - sizeof(WMI_TRACE_BUFFER_HEADER))
+    {
+        InterlockedDecrement(&Processor->WriterCount);
+        if (OldIrql < DISPATCH_LEVEL)
+            KeLowerIrql(OldIrql);
+        return Logger->Active ? STATUS_BUFFER_OVERFLOW : STATUS_INVALID_HANDLE;
+    }
+
+    Event = WmipReserveEvent(Logger,
+                             Processor,
+                             ProcessorNumber,
+                             ALIGN_UP_BY(Size, WMI_TRACE_ALIGNMENT),
+                             &Buffer);
+    if (!Event)
+    {
+        InterlockedIncrement(&Logger->EventsLost);
+        InterlockedDecrement(&Processor->WriterCount);
+        if (OldIrql < DISPATCH_LEVEL)
+            KeLowerIrql(OldIrql);
+        return STATUS_NO_MEMORY;
+    }
+
+    /* Stamp the event while still on the processor it was reserved on */
+    if (Stamp)
+    {
+        Event->TimeStamp.QuadPart = Stamp->TimeStamp;
+        Event->ThreadId = Stamp->ThreadId;
+        Event->ProcessId = Stamp->ProcessId;
+        Event->KernelTime = Stamp->KernelTime;
+        Event->UserTime = Stamp->UserTime;
+    }
+    else
+    {
+        Thread = KeGetCurrentThread();
+        Event->TimeStamp.QuadPart = WmipGetTimeStamp(Logger->ClockType);
+        Event->ThreadId = HandleToUlong(PsGetCurrentThreadId());
+        Event->ProcessId = HandleToUlong(PsGetCurrentProcessId());
+        Event->KernelTime = Thread->KernelTime;
+        Event->UserTime = Thread->UserTime;
+    }
+
+    /* The room is ours, the copy can page fault if the caller allows it */
+    if (OldIrql < DISPATCH_LEVEL)
+        KeLowerIrql(OldIrql);
+
+    Event->Size = (USHORT)Size;
+    Event->HeaderType = (Header->HeaderType == WMI_HEADER_TYPE_MESSAGE) ?
+                        WMI_HEADER_TYPE_MESSAGE : WMI_HEADER_TYPE_EVENT;
+    Event->MarkerFlags = Header->MarkerFlags;
+    Event->Version = Header->Version;
+    Event->Guid = Header->Guid;
+
+    Data = (PUCHAR)(Event + 1);
+    for (i = 0; i < FieldCount; i++)
+    {
+        RtlCopyMemory(Data, (PVOID)(ULONG_PTR)Fields[i].DataPtr, Fields[i].Length);
+        Data += Fields[i].Length;
+    }
+
+    /* Let the logger thread flush the buffer */
+    InterlockedDecrement(&Buffer->ReferenceCount);
+    InterlockedDecrement(&Processor->WriterCount);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+WmipLogEvent(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER Header,
+    _In_reads_(FieldCount) PMOF_FIELD Fields,
+    _In_ ULONG FieldCount)
+{
+    return WmipLogEventInternal(LoggerId, Header, Fields, FieldCount, NULL);
+}
+
+/*
+ * Logs an event that was captured earlier, into the buffer of the processor
+ * it was captured on. Used by providers that cannot log where they run.
+ */
+NTSTATUS
+NTAPI
+WmipLogStampedEvent(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER Header,
+    _In_reads_(FieldCount) PMOF_FIELD Fields,
+    _In_ ULONG FieldCount,
+    _In_ PWMIP_EVENT_STAMP Stamp)
+{
+    if (Stamp->ProcessorNumber >= MAXIMUM_PROCESSORS)
+        return STATUS_INVALID_PARAMETER;
+
+    return WmipLogEventInternal(LoggerId, Header, Fields, FieldCount, Stamp);
+}
+
+/*
+ * Captures a user mode event, flattening WNODE_FLAG_USE_MOF_PTR and
+ * WNODE_FLAG_USE_GUID_PTR events, and logs it.
+ */
+NTSTATUS
+NTAPI
+WmipTraceUserEvent(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER TraceHeader,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    UCHAR LocalBuffer[512];
+    EVENT_TRACE_HEADER Header;
+    MOF_FIELD Fields[MAX_MOF_FIELDS];
+    MOF_FIELD Captured;
+    ULONG FieldCount, DataLength, Flags, i;
+    PUCHAR Data = NULL;
+    NTSTATUS Status;
+
+    _SEH2_TRY
+    {
+        /* Capture the header */
+        if (PreviousMode != KernelMode)
+            ProbeForRead(TraceHeader, sizeof(EVENT_TRACE_HEADER), sizeof(ULONG));
+        Header = *TraceHeader;
+
+        if (Header.Size < sizeof(EVENT_TRACE_HEADER))
+            _SEH2_YIELD(return STATUS_INVALID_BUFFER_SIZE);
+
+        Flags = Header.Flags;
+        if (Flags & WNODE_FLAG_USE_GUID_PTR)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForRead((PVOID)(ULONG_PTR)Header.GuidPtr, sizeof(GUID), sizeof(ULONG));
+            Header.Guid = *(LPGUID)(ULONG_PTR)Header.GuidPtr;
+        }
+
+        /* Describe the event data */
+        if (Flags & WNODE_FLAG_USE_MOF_PTR)
+        {
+            FieldCount = (Header.Size - sizeof(EVENT_TRACE_HEADER)) / sizeof(MOF_FIELD);
+            if (FieldCount > MAX_MOF_FIELDS)
+                _SEH2_YIELD(return STATUS_INVALID_PARAMETER);
+
+            if (PreviousMode != KernelMode)
+                ProbeForRead(TraceHeader + 1, FieldCount * sizeof(MOF_FIELD), sizeof(ULONG));
+            RtlCopyMemory(Fields, TraceHeader + 1, FieldCount * sizeof(MOF_FIELD));
+        }
+        else
+        {
+            FieldCount = 1;
+            Fields[0].DataPtr = (ULONG64)(ULONG_PTR)(TraceHeader + 1);
+            Fields[0].Length = Header.Size - sizeof(EVENT_TRACE_HEADER);
+        }
+
+        DataLength = 0;
+        for (i = 0; i < FieldCount; i++)
+        {
+            if (Fields[i].Length > MAXUSHORT - sizeof(EVENT_TRACE_HEADER) - DataLength)
+                _SEH2_YIELD(return STATUS_BUFFER_OVERFLOW);
+            DataLength += Fields[i].Length;
+        }
+
+        /* Capture the data, the trace buffers are written at DISPATCH_LEVEL */
+        if (DataLength <= sizeof(LocalBuffer))
+        {
+            Data = LocalBuffer;
+        }
+        else
+        {
+            Data = ExAllocatePoolWithTag(PagedPool, DataLength, TAG_WMI_BUFFER);
+            if (!Data)
+                _SEH2_YIELD(return STATUS_INSUFFICIENT_RESOURCES);
+        }
+
+        DataLength = 0;
+        for (i = 0; i < FieldCount; i++)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForRead((PVOID)(ULONG_PTR)Fields[i].DataPtr, Fields[i].Length, sizeof(UCHAR));
+            RtlCopyMemory(Data + DataLength, (PVOID)(ULONG_PTR)Fields[i].DataPtr, Fields[i].Length);
+            DataLength += Fields[i].Length;
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        if (Data && Data != LocalBuffer)
+            ExFreePoolWithTag(Data, TAG_WMI_BUFFER);
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    Captured.DataPtr = (ULONG64)(ULONG_PTR)Data;
+    Captured.Length = DataLength;
+    Captured.DataType = 0;
+    Status = WmipLogEvent(LoggerId, &Header, &Captured, 1);
+
+    if (Data != LocalBuffer)
+        ExFreePoolWithTag(Data, TAG_WMI_BUFFER);
+
+    return Status;
+}
+
+static
+VOID
+WmipRecycleBuffer(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _In_ PWMIP_TRACE_BUFFER Buffer)
+{
+    Buffer->CurrentOffset = sizeof(WMI_TRACE_BUFFER_HEADER);
+    InterlockedPushEntrySList(&Logger->FreeList, &Buffer->ListEntry);
+}
+
+static
+VOID
+WmipWriteLogFileHeader(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _In_ BOOLEAN Final)
+{
+    PWMI_LOGFILE_HEADER LogFileHeader;
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER Offset;
+    ULONG Length;
+    NTSTATUS Status;
+
+    /* The header takes a whole buffer so that buffers stay aligned in the file */
+    Length = Final ? sizeof(WMI_LOGFILE_HEADER) : Logger->BufferSize;
+    LogFileHeader = ExAllocatePoolWithTag(PagedPool, Length, TAG_WMI_LOGGER);
+    if (!LogFileHeader)
+        return;
+
+    RtlZeroMemory(LogFileHeader, Length);
+    LogFileHeader->Signature = WMI_LOGFILE_SIGNATURE;
+    LogFileHeader->Version = WMI_LOGFILE_VERSION;
+    LogFileHeader->BufferSize = Logger->BufferSize;
+    LogFileHeader->NumberOfProcessors = KeNumberProcessors;
+    LogFileHeader->LogFileMode = Logger->LogFileMode;
+    LogFileHeader->ClockType = Logger->ClockType;
+    LogFileHeader->StartTime = Logger->StartTime;
+    if (Final)
+        KeQuerySystemTime(&LogFileHeader->EndTime);
+    if (Logger->ClockType == 2)
+        LogFileHeader->PerfFreq.QuadPart = 10 * 1000 * 1000;
+    else if (Logger->ClockType != 3)
+        KeQueryPerformanceCounter(&LogFileHeader->PerfFreq);
+    LogFileHeader->BuffersWritten = Logger->BuffersWritten;
+    LogFileHeader->EventsLost = Logger->EventsLost;
+    LogFileHeader->BuffersLost = Logger->LogBuffersLost;
+    RtlCopyMemory(LogFileHeader->LoggerName, Logger->LoggerName, sizeof(Logger->LoggerName));
+
+    Offset.QuadPart = 0;
+    Status = ZwWriteFile(Logger->FileHandle,
+                         NULL,
+                         NULL,
+                         NULL,
+                         &IoStatusBlock,
+                         LogFileHeader,
+                         Length,
+                         &Offset,
+                         NULL);
+    if (!NT_SUCCESS(Status))
+        DPRINT1("Failed to write the header of logger %lu: 0x%lx\n", Logger->LoggerId, Status);
+
+    ExFreePoolWithTag(LogFileHeader, TAG_WMI_LOGGER);
+}
+
+static
+VOID
+WmipWriteBuffer(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _In_ PWMIP_TRACE_BUFFER Buffer)
+{
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER TimeStamp;
+    NTSTATUS Status;
+    KIRQL OldIrql;
+
+    /* Wait for the writers that still copy into the buffer */
+    while (Buffer->ReferenceCount != 0)
+    {
+        TimeStamp.QuadPart = -10 * 1000;
+        KeDelayExecutionThread(KernelMode, FALSE, &TimeStamp);
+    }
+
+    /* Nothing can touch the buffer anymore, finish its header */
+    Buffer->Header.BufferSize = Logger->BufferSize;
+    Buffer->Header.SavedOffset = Buffer->CurrentOffset;
+    Buffer->Header.SequenceNumber = Logger->SequenceNumber++;
+    Buffer->Header.ProcessorNumber = (USHORT)Buffer->ProcessorNumber;
+    Buffer->Header.LoggerId = (USHORT)Logger->LoggerId;
+    Buffer->Header.TimeStamp.QuadPart = WmipGetTimeStamp(Logger->ClockType);
+    RtlZeroMemory((PUCHAR)&Buffer->Header + Buffer->CurrentOffset,
+                  Logger->BufferSize - Buffer->CurrentOffset);
+
+    if (Logger->FileHandle)
+    {
+        /* Sequential files stop growing at their maximum size, circular ones
+         * wrap around to the first buffer after the header */
+        if (Logger->MaximumFileSize &&
+            (ULONG64)Logger->FileOffset.QuadPart + Logger->BufferSize > Logger->MaximumFileSize)
+        {
+            if (Logger->LogFileMode & EVENT_TRACE_FILE_MODE_CIRCULAR)
+                Logger->FileOffset.QuadPart = Logger->BufferSize;
+        }
+
+        if (Logger->MaximumFileSize &&
+            (ULONG64)Logger->FileOffset.QuadPart + Logger->BufferSize > Logger->MaximumFileSize)
+        {
+            InterlockedIncrement(&Logger->LogBuffersLost);
+        }
+        else
+        {
+            Status = ZwWriteFile(Logger->FileHandle,
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 &IoStatusBlock,
+                                 &Buffer->Header,
+                                 Logger->BufferSize,
+                                 &Logger->FileOffset,
+                                 NULL);
+            if (NT_SUCCESS(Status))
+            {
+                Logger->FileOffset.QuadPart += Logger->BufferSize;
+                InterlockedIncrement(&Logger->BuffersWritten);
+            }
+            else
+            {
+                DPRINT1("Failed to write a buffer of logger %lu: 0x%lx\n", Logger->LoggerId, Status);
+                InterlockedIncrement(&Logger->LogBuffersLost);
+            }
+        }
+    }
+
+    if (Logger->LogFileMode & EVENT_TRACE_REAL_TIME_MODE)
+    {
+        /* Keep the buffer until a consumer reads it */
+        KeAcquireSpinLock(&Logger->RealTimeLock, &OldIrql);
+        if (Logger->RealTimeCount < WMIP_MAX_REALTIME_BUFFERS)
+        {
+            InsertTailList(&Logger->RealTimeListHead, &Buffer->RealTimeLink);
+            Logger->RealTimeCount++;
+            Buffer = NULL;
+        }
+        KeReleaseSpinLock(&Logger->RealTimeLock, OldIrql);
+
+        if (!Buffer)
+        {
+            KeSetEvent(&Logger->RealTimeEvent, IO_NO_INCREMENT, FALSE);
+            return;
+        }
+
+        InterlockedIncrement(&Logger->RealTimeBuffersLost);
+    }
+
+    WmipRecycleBuffer(Logger, Buffer);
+}
+
+static
+VOID
+WmipFlushBuffers(
+    _In_ PWMIP_LOGGER_CONTEXT Logger)
+{
+    PSLIST_ENTRY Entry, Next, Ordered = NULL;
+
+    /* The flush list is LIFO, write the buffers in the order they were queued */
+    Entry = InterlockedFlushSList(&Logger->FlushList);
+    while (Entry)
+    {
+        Next = Entry->Next;
+        Entry->Next = Ordered;
+        Ordered = Entry;
+        Entry = Next;
+    }
+
+    while (Ordered)
+    {
+        Next = Ordered->Next;
+        WmipWriteBuffer(Logger, CONTAINING_RECORD(Ordered, WMIP_TRACE_BUFFER, ListEntry));
+        Ordered = Next;
+    }
+}
+
+/*
+ * Takes the current buffer of every processor that has events, so that they
+ * get written even if they never fill up.
+ */
+static
+VOID
+WmipSwapProcessorBuffers(
+    _In_ PWMIP_LOGGER_CONTEXT Logger)
+{
+    PWMIP_TRACE_BUFFER Buffer;
+    ULONG i;
+
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        Buffer = Logger->Processors[i].Buffer;
+        if (!Buffer || Buffer->CurrentOffset == sizeof(WMI_TRACE_BUFFER_HEADER))
+            continue;
+
+        /* Writers will get a new buffer on their next event */
+        if (InterlockedCompareExchangePointer((PVOID*)&Logger->Processors[i].Buffer,
+                                              NULL,
+                                              Buffer) == Buffer)
+        {
+            InterlockedPushEntrySList(&Logger->FlushList, &Buffer->ListEntry);
+        }
+    }
+}
+
+_Function_class_(KDEFERRED_ROUTINE)
+static
+VOID
+NTAPI
+WmipFlushDpcRoutine(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PWMIP_LOGGER_CONTEXT Logger = DeferredContext;
+
+    KeSetEvent(&Logger->FlushEvent, IO_NO_INCREMENT, FALSE);
+}
+
+_Function_class_(KSTART_ROUTINE)
+static
+VOID
+NTAPI
+WmipLoggerThread(
+    _In_ PVOID Context)
+{
+    PWMIP_LOGGER_CONTEXT Logger = Context;
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+
+    Logger->LoggerThreadId = HandleToUlong(PsGetCurrentThreadId());
+
+    for (;;)
+    {
+        Timeout.QuadPart = -(LONGLONG)Logger->FlushTimer * 10 * 1000 * 1000;
+        Status = KeWaitForSingleObject(&Logger->FlushEvent,
+                                       Executive,
+                                       KernelMode,
+                                       FALSE,
+                                       Logger->FlushTimer ? &Timeout : NULL);
+
+        /* Flush the partially filled buffers on timeout, on request and on stop */
+        if (Status == STATUS_TIMEOUT || Logger->FlushRequested || Logger->StopRequested)
+            WmipSwapProcessorBuffers(Logger);
+
+        WmipFlushBuffers(Logger);
+
+        if (Logger->FlushRequested)
+        {
+            Logger->FlushRequested = FALSE;
+            KeSetEvent(&Logger->FlushDoneEvent, IO_NO_INCREMENT, FALSE);
+        }
+
+        if (Logger->StopRequested)
+            break;
+    }
+
+    if (Logger->FileHandle)
+    {
+        WmipWriteLogFileHeader(Logger, TRUE);
+        ZwClose(Logger->FileHandle);
+        Logger->FileHandle = NULL;
+    }
+
+    PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
+static
+VOID
+WmipFreeLoggerBuffers(
+    _In_ PWMIP_LOGGER_CONTEXT Logger)
+{
+    PWMIP_TRACE_BUFFER Buffer;
+    PLIST_ENTRY ListEntry;
+    ULONG i;
+
+    /* Buffers never read by a real-time consumer */
+    while (!IsListEmpty(&Logger->RealTimeListHead))
+    {
+        ListEntry = RemoveHeadList(&Logger->RealTimeListHead);
+        Buffer = CONTAINING_RECORD(ListEntry, WMIP_TRACE_BUFFER, RealTimeLink);
+        InterlockedPushEntrySList(&Logger->FreeList, &Buffer->ListEntry);
+    }
+    Logger->RealTimeCount = 0;
+
+    /* Buffers that were never used for an event */
+    for (i = 0; i < MAXIMUM_PROCESSORS; i++)
+    {
+        Buffer = Logger->Processors[i].Buffer;
+        if (Buffer)
+        {
+            Logger->Processors[i].Buffer = NULL;
+            InterlockedPushEntrySList(&Logger->FreeList, &Buffer->ListEntry);
+        }
+    }
+
+    while ((Buffer = (PWMIP_TRACE_BUFFER)InterlockedPopEntrySList(&Logger->FreeList)))
+    {
+        ExFreePoolWithTag(Buffer, TAG_WMI_BUFFER);
+        InterlockedDecrement(&Logger->NumberOfBuffers);
+    }
+
+    ASSERT(Logger->NumberOfBuffers == 0);
+}
+
+static
+PWMIP_LOGGER_CONTEXT
+WmipFindLogger(
+    _In_ PWMI_LOGGER_INFORMATION LoggerInfo)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    ULONG LoggerId;
+
+    /* Must be called with the logger lock held */
+    LoggerId = WMI_LOGGER_ID(LoggerInfo->LoggerHandle);
+    if (LoggerId != 0)
+    {
+        if (LoggerId >= WMI_MAX_LOGGERS)
+            return NULL;
+
+        Logger = WmipLoggerContext[LoggerId];
+        return (Logger && Logger->InUse) ? Logger : NULL;
+    }
+
+    /* Look it up by name */
+    LoggerInfo->LoggerName[WMI_MAX_LOGGER_NAME - 1] = UNICODE_NULL;
+    for (LoggerId = 1; LoggerId < WMI_MAX_LOGGERS; LoggerId++)
+    {
+        Logger = WmipLoggerContext[LoggerId];
+        if (Logger && Logger->InUse && _wcsicmp(Logger->LoggerName, LoggerInfo->LoggerName) == 0)
+            return Logger;
+    }
+
+    return NULL;
+}
+
+static
+VOID
+WmipFillLoggerInformation(
+    _In_ PWMIP_LOGGER_CONTEXT Logger,
+    _Out_ PWMI_LOGGER_INFORMATION LoggerInfo)
+{
+    LoggerInfo->LoggerHandle = WMI_MAKE_LOGGER_HANDLE(Logger->LoggerId, 0, 0);
+    LoggerInfo->Guid = Logger->Guid;
+    LoggerInfo->ClockType = Logger->ClockType;
+    LoggerInfo->BufferSize = Logger->BufferSize / 1024;
+    LoggerInfo->MinimumBuffers = Logger->MinimumBuffers;
+    LoggerInfo->MaximumBuffers = Logger->MaximumBuffers;
+    LoggerInfo->MaximumFileSize = (ULONG)(Logger->MaximumFileSize / (1024 * 1024));
+    LoggerInfo->LogFileMode = Logger->LogFileMode;
+    LoggerInfo->FlushTimer = Logger->FlushTimer;
+    LoggerInfo->EnableFlags = Logger->EnableFlags;
+    LoggerInfo->NumberOfBuffers = Logger->NumberOfBuffers;
+    LoggerInfo->FreeBuffers = ExQueryDepthSList(&Logger->FreeList);
+    LoggerInfo->EventsLost = Logger->EventsLost;
+    LoggerInfo->BuffersWritten = Logger->BuffersWritten;
+    LoggerInfo->LogBuffersLost = Logger->LogBuffersLost;
+    LoggerInfo->RealTimeBuffersLost = Logger->RealTimeBuffersLost;
+    LoggerInfo->LoggerThreadId = Logger->LoggerThreadId;
+    RtlCopyMemory(LoggerInfo->LoggerName, Logger->LoggerName, sizeof(Logger->LoggerName));
+    RtlCopyMemory(LoggerInfo->LogFileName, Logger->LogFileName, sizeof(Logger->LogFileName));
+}
+
+static
+NTSTATUS
+WmipOpenLogFile(
+    _In_ PWMIP_LOGGER_CONTEXT Logger)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    UNICODE_STRING FileName;
+
+    RtlInitUnicodeString(&FileName, Logger->LogFileName);
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &FileName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+
+    /* The handle is a kernel one, but the file is opened on behalf of the
+     * caller: check its access to the file */
+    return IoCreateFile(&Logger->FileHandle,
+                        GENERIC_WRITE | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatusBlock,
+                        NULL,
+                        FILE_ATTRIBUTE_NORMAL,
+                        FILE_SHARE_READ,
+                        FILE_OVERWRITE_IF,
+                        FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE,
+                        NULL,
+                        0,
+                        CreateFileTypeNone,
+                        NULL,
+                        IO_FORCE_ACCESS_CHECK);
+}
+
+static
+VOID
+WmipPurgeTraceGuids(
+    _In_ ULONG LoggerId)
+{
+    PWMIP_TRACE_GUID_ENTRY GuidEntry;
+    PLIST_ENTRY ListEntry;
+
+    /* Must be called with the logger lock held */
+    ListEntry = WmipTraceGuidListHead.Flink;
+    while (ListEntry != &WmipTraceGuidListHead)
+    {
+        GuidEntry = CONTAINING_RECORD(ListEntry, WMIP_TRACE_GUID_ENTRY, ListEntry);
+        ListEntry = ListEntry->Flink;
+
+        if (WMI_LOGGER_ID(GuidEntry->LoggerHandle) == LoggerId)
+        {
+            RemoveEntryList(&GuidEntry->ListEntry);
+            ExFreePoolWithTag(GuidEntry, TAG_WMI_GUID);
+        }
+    }
+}
+
+/* PUBLIC FUNCTIONS **********************************************************/
+
+NTSTATUS
+NTAPI
+WmipStartLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    PWMIP_TRACE_BUFFER Buffer;
+    BOOLEAN KernelLogger;
+    HANDLE ThreadHandle;
+    ULONG LoggerId, i;
+    NTSTATUS Status;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    LoggerInfo->LoggerName[WMI_MAX_LOGGER_NAME - 1] = UNICODE_NULL;
+    LoggerInfo->LogFileName[WMI_MAX_LOGFILE_NAME - 1] = UNICODE_NULL;
+    if (LoggerInfo->LoggerName[0] == UNICODE_NULL)
+        return STATUS_INVALID_PARAMETER;
+
+    /* Only the NT Kernel Logger can use the system trace GUID */
+    KernelLogger = (_wcsicmp(LoggerInfo->LoggerName, KERNEL_LOGGER_NAMEW) == 0);
+    if (IsEqualGUID(&LoggerInfo->Guid, &SystemTraceControlGuid) && !KernelLogger)
+        return STATUS_INVALID_PARAMETER;
+
+    /* Sessions go to a file, to real-time consumers, or both */
+    if ((LoggerInfo->LogFileMode & EVENT_TRACE_FILE_MODE_SEQUENTIAL) &&
+        (LoggerInfo->LogFileMode & EVENT_TRACE_FILE_MODE_CIRCULAR))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+    if (!(LoggerInfo->LogFileMode & EVENT_TRACE_REAL_TIME_MODE) &&
+        LoggerInfo->LogFileName[0] == UNICODE_NULL)
+    {
+        return STATUS_OBJECT_PATH_SYNTAX_BAD;
+    }
+    if ((LoggerInfo->LogFileMode & EVENT_TRACE_FILE_MODE_CIRCULAR) &&
+        LoggerInfo->MaximumFileSize == 0)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    /* Session names are unique */
+    LoggerInfo->LoggerHandle = 0;
+    if (WmipFindLogger(LoggerInfo))
+    {
+        Status = STATUS_OBJECT_NAME_COLLISION;
+        goto Quit;
+    }
+
+    /* The kernel logger always gets the same slot */
+    if (KernelLogger)
+    {
+        LoggerId = WMI_KERNEL_LOGGER_ID;
+    }
+    else
+    {
+        for (LoggerId = WMI_KERNEL_LOGGER_ID + 1; LoggerId < WMI_MAX_LOGGERS; LoggerId++)
+        {
+            if (!WmipLoggerContext[LoggerId] || !WmipLoggerContext[LoggerId]->InUse)
+                break;
+        }
+
+        if (LoggerId == WMI_MAX_LOGGERS)
+        {
+            Status = STATUS_NO_MORE_ENTRIES;
+            goto Quit;
+        }
+    }
+
+    Logger = WmipLoggerContext[LoggerId];
+    if (!Logger)
+    {
+        Logger = ExAllocatePoolWithTag(NonPagedPool, sizeof(WMIP_LOGGER_CONTEXT), TAG_WMI_LOGGER);
+        if (!Logger)
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto Quit;
+        }
+
+        RtlZeroMemory(Logger, sizeof(WMIP_LOGGER_CONTEXT));
+        Logger->LoggerId = LoggerId;
+        InitializeSListHead(&Logger->FreeList);
+        InitializeSListHead(&Logger->FlushList);
+        InitializeListHead(&Logger->RealTimeListHead);
+        KeInitializeSpinLock(&Logger->RealTimeLock);
+        KeInitializeDpc(&Logger->FlushDpc, WmipFlushDpcRoutine, Logger);
+        KeInitializeGuardedMutex(&Logger->FlushLock);
+        ExInitializeRundownProtection(&Logger->RundownProtect);
+        WmipLoggerContext[LoggerId] = Logger;
+    }
+    else
+    {
+        ExReInitializeRundownProtection(&Logger->RundownProtect);
+    }
+
+    ASSERT(!Logger->Active);
+    KeInitializeEvent(&Logger->FlushEvent, SynchronizationEvent, FALSE);
+    KeInitializeEvent(&Logger->FlushDoneEvent, SynchronizationEvent, FALSE);
+    KeInitializeEvent(&Logger->RealTimeEvent, SynchronizationEvent, FALSE);
+
+    /* Capture the parameters, with sane defaults */
+    Logger->Guid = LoggerInfo->Guid;
+    Logger->ClockType = LoggerInfo->ClockType;
+    Logger->BufferSize = LoggerInfo->BufferSize ? LoggerInfo->BufferSize * 1024 : WMIP_DEFAULT_BUFFER_SIZE;
+    Logger->BufferSize = max(Logger->BufferSize, WMIP_MIN_BUFFER_SIZE);
+    Logger->BufferSize = min(Logger->BufferSize, WMIP_MAX_BUFFER_SIZE);
+    Logger->MinimumBuffers = max(LoggerInfo->MinimumBuffers, 2 * (ULONG)KeNumberProcessors);
+    Logger->MaximumBuffers = max(LoggerInfo->MaximumBuffers, Logger->MinimumBuffers + 20);
+    Logger->MaximumFileSize = (ULONG64)LoggerInfo->MaximumFileSize * 1024 * 1024;
+    Logger->LogFileMode = LoggerInfo->LogFileMode;
+    Logger->FlushTimer = LoggerInfo->FlushTimer;
+    if (!Logger->FlushTimer && (Logger->LogFileMode & EVENT_TRACE_REAL_TIME_MODE))
+        Logger->FlushTimer = 1;
+    Logger->EnableFlags = LoggerInfo->EnableFlags;
+    RtlCopyMemory(Logger->LoggerName, LoggerInfo->LoggerName, sizeof(Logger->LoggerName));
+    RtlCopyMemory(Logger->LogFileName, LoggerInfo->LogFileName, sizeof(Logger->LogFileName));
+    Logger->StopRequested = FALSE;
+    Logger->FlushRequested = FALSE;
+    Logger->SequenceNumber = 0;
+    Logger->EventsLost = 0;
+    Logger->BuffersWritten = 0;
+    Logger->LogBuffersLost = 0;
+    Logger->RealTimeBuffersLost = 0;
+    KeQuerySystemTime(&Logger->StartTime);
+
+    /* Preallocate the buffers */
+    for (i = 0; i < Logger->MinimumBuffers; i++)
+    {
+        Buffer = WmipGetFreeBuffer(Logger);
+        if (!Buffer)
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto Cleanup;
+        }
+        InterlockedPushEntrySList(&Logger->FreeList, &Buffer->ListEntry);
+    }
+
+    /* Open the log file */
+    Logger->FileHandle = NULL;
+    if (Logger->LogFileName[0] != UNICODE_NULL)
+    {
+        Status = WmipOpenLogFile(Logger);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to open log file %S: 0x%lx\n", Logger->LogFileName, Status);
+            Logger->FileHandle = NULL;
+            goto Cleanup;
+        }
+
+        WmipWriteLogFileHeader(Logger, FALSE);
+        Logger->FileOffset.QuadPart = Logger->BufferSize;
+    }
+
+    /* Start the logger thread */
+    Status = PsCreateSystemThread(&ThreadHandle,
+                                  THREAD_ALL_ACCESS,
+                                  NULL,
+                                  NULL,
+                                  NULL,
+                                  WmipLoggerThread,
+                                  Logger);
+    if (!NT_SUCCESS(Status))
+        goto Cleanup;
+
+    Status = ObReferenceObjectByHandle(ThreadHandle,
+                                       SYNCHRONIZE,
+                                       PsThreadType,
+                                       KernelMode,
+                                       (PVOID*)&Logger->LoggerThread,
+                                       NULL);
+    ZwClose(ThreadHandle);
+    ASSERT(NT_SUCCESS(Status));
+
+    /* Writers can come in now */
+    Logger->InUse = TRUE;
+    InterlockedExchange(&Logger->Active, TRUE);
+    if (KernelLogger)
+    {
+        WmipStartKernelTrace();
+        WmipKernelLoggerFlags = Logger->EnableFlags;
+    }
+
+    WmipFillLoggerInformation(Logger, LoggerInfo);
+    LoggerInfo->LoggerHandle = WMI_MAKE_LOGGER_HANDLE(LoggerId, 0, 0);
+    Status = STATUS_SUCCESS;
+    goto Quit;
+
+Cleanup:
+    if (Logger->FileHandle)
+    {
+        ZwClose(Logger->FileHandle);
+        Logger->FileHandle = NULL;
+    }
+    WmipFreeLoggerBuffers(Logger);
+    ExWaitForRundownProtectionRelease(&Logger->RundownProtect);
+
+Quit:
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+WmipStopLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    LARGE_INTEGER Interval;
+    ULONG i;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    Logger = WmipFindLogger(LoggerInfo);
+    if (!Logger)
+    {
+        KeReleaseGuardedMutex(&WmipLoggerLock);
+        return STATUS_WMI_INSTANCE_NOT_FOUND;
+    }
+
+    /* Stop new events, then wait for the writers that are still logging */
+    if (Logger->LoggerId == WMI_KERNEL_LOGGER_ID)
+    {
+        WmipKernelLoggerFlags = 0;
+        WmipStopKernelTrace();
+    }
+    InterlockedExchange(&Logger->Active, FALSE);
+    WmipPurgeTraceGuids(Logger->LoggerId);
+
+    Interval.QuadPart = -10 * 1000;
+    for (i = 0; i < MAXIMUM_PROCESSORS; i++)
+    {
+        while (Logger->Processors[i].WriterCount != 0)
+            KeDelayExecutionThread(KernelMode, FALSE, &Interval);
+    }
+
+    /* Wake up and wait for the real-time readers and flush requests */
+    KeSetEvent(&Logger->RealTimeEvent, IO_NO_INCREMENT, FALSE);
+    ExWaitForRundownProtectionRelease(&Logger->RundownProtect);
+
+    /* The logger thread writes the remaining buffers and closes the file */
+    Logger->StopRequested = TRUE;
+    KeSetEvent(&Logger->FlushEvent, IO_NO_INCREMENT, FALSE);
+    KeWaitForSingleObject(Logger->LoggerThread, Executive, KernelMode, FALSE, NULL);
+    ObDereferenceObject(Logger->LoggerThread);
+    Logger->LoggerThread = NULL;
+
+    /* Drop a wake up that is no longer needed */
+    KeRemoveQueueDpc(&Logger->FlushDpc);
+
+    WmipFillLoggerInformation(Logger, LoggerInfo);
+    WmipFreeLoggerBuffers(Logger);
+    Logger->InUse = FALSE;
+
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+WmipQueryLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    NTSTATUS Status = STATUS_WMI_INSTANCE_NOT_FOUND;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    Logger = WmipFindLogger(LoggerInfo);
+    if (Logger)
+    {
+        WmipFillLoggerInformation(Logger, LoggerInfo);
+        Status = STATUS_SUCCESS;
+    }
+
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+WmipUpdateLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    NTSTATUS Status = STATUS_WMI_INSTANCE_NOT_FOUND;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    /* Only the flags, the flush timer and the buffer limit can change */
+    Logger = WmipFindLogger(LoggerInfo);
+    if (Logger)
+    {
+        Logger->EnableFlags = LoggerInfo->EnableFlags;
+        if (Logger->LoggerId == WMI_KERNEL_LOGGER_ID)
+            WmipKernelLoggerFlags = Logger->EnableFlags;
+
+        if (LoggerInfo->FlushTimer)
+            Logger->FlushTimer = LoggerInfo->FlushTimer;
+
+        if (LoggerInfo->MaximumBuffers > Logger->MaximumBuffers)
+            Logger->MaximumBuffers = LoggerInfo->MaximumBuffers;
+
+        WmipFillLoggerInformation(Logger, LoggerInfo);
+        Status = STATUS_SUCCESS;
+    }
+
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+WmipFlushLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    Logger = WmipFindLogger(LoggerInfo);
+    if (!Logger || !ExAcquireRundownProtection(&Logger->RundownProtect))
+    {
+        KeReleaseGuardedMutex(&WmipLoggerLock);
+        return STATUS_WMI_INSTANCE_NOT_FOUND;
+    }
+
+    /* The rundown reference keeps the logger running until the flush is done,
+     * stopping it waits for the reference without the logger lock held */
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+
+    /* Let the logger thread write everything that was logged so far */
+    KeAcquireGuardedMutex(&Logger->FlushLock);
+    Logger->FlushRequested = TRUE;
+    KeSetEvent(&Logger->FlushEvent, IO_NO_INCREMENT, FALSE);
+    KeWaitForSingleObject(&Logger->FlushDoneEvent, Executive, KernelMode, FALSE, NULL);
+    KeReleaseGuardedMutex(&Logger->FlushLock);
+
+    WmipFillLoggerInformation(Logger, LoggerInfo);
+    ExReleaseRundownProtection(&Logger->RundownProtect);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+WmipEnableTrace(
+    _Inout_ PWMI_TRACE_GUID_CONTROL Control,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_TRACE_GUID_ENTRY GuidEntry, NewEntry = NULL;
+    PWMIP_LOGGER_CONTEXT Logger;
+    PLIST_ENTRY ListEntry;
+    ULONG LoggerId;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    LoggerId = WMI_LOGGER_ID(Control->LoggerHandle);
+    if (LoggerId == 0 || LoggerId >= WMI_MAX_LOGGERS)
+        return STATUS_INVALID_HANDLE;
+
+    if (Control->Enable)
+    {
+        NewEntry = ExAllocatePoolWithTag(PagedPool, sizeof(WMIP_TRACE_GUID_ENTRY), TAG_WMI_GUID);
+        if (!NewEntry)
+            return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    Logger = WmipLoggerContext[LoggerId];
+    if (!Logger || !Logger->InUse)
+    {
+        KeReleaseGuardedMutex(&WmipLoggerLock);
+        if (NewEntry)
+            ExFreePoolWithTag(NewEntry, TAG_WMI_GUID);
+        return STATUS_INVALID_HANDLE;
+    }
+
+    /* A provider is enabled on one logger at a time */
+    for (ListEntry = WmipTraceGuidListHead.Flink;
+         ListEntry != &WmipTraceGuidListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        GuidEntry = CONTAINING_RECORD(ListEntry, WMIP_TRACE_GUID_ENTRY, ListEntry);
+        if (IsEqualGUID(&GuidEntry->Guid, &Control->Guid))
+        {
+            RemoveEntryList(&GuidEntry->ListEntry);
+            ExFreePoolWithTag(GuidEntry, TAG_WMI_GUID);
+            break;
+        }
+    }
+
+    Control->LoggerHandle = 0;
+    if (NewEntry)
+    {
+        NewEntry->Guid = Control->Guid;
+        NewEntry->LoggerHandle = WMI_MAKE_LOGGER_HANDLE(LoggerId,
+                                                        Control->Level,
+                                                        Control->EnableFlags);
+        InsertTailList(&WmipTraceGuidListHead, &NewEntry->ListEntry);
+        Control->LoggerHandle = NewEntry->LoggerHandle;
+    }
+
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+WmipQueryTraceGuid(
+    _Inout_ PWMI_TRACE_GUID_CONTROL Control)
+{
+    PWMIP_TRACE_GUID_ENTRY GuidEntry;
+    PLIST_ENTRY ListEntry;
+
+    KeAcquireGuardedMutex(&WmipLoggerLock);
+
+    Control->LoggerHandle = 0;
+    Control->Enable = FALSE;
+    for (ListEntry = WmipTraceGuidListHead.Flink;
+         ListEntry != &WmipTraceGuidListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        GuidEntry = CONTAINING_RECORD(ListEntry, WMIP_TRACE_GUID_ENTRY, ListEntry);
+        if (IsEqualGUID(&GuidEntry->Guid, &Control->Guid))
+        {
+            Control->LoggerHandle = GuidEntry->LoggerHandle;
+            Control->EnableFlags = WMI_LOGGER_FLAGS(GuidEntry->LoggerHandle);
+            Control->Level = WMI_LOGGER_LEVEL(GuidEntry->LoggerHandle);
+            Control->Enable = TRUE;
+            break;
+        }
+    }
+
+    KeReleaseGuardedMutex(&WmipLoggerLock);
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Returns the oldest buffer queued for real-time consumers, waiting for up
+ * to a second for one. Returns 0 bytes when there is none.
+ */
+NTSTATUS
+NTAPI
+WmipReadLoggerBuffer(
+    _In_ ULONG64 LoggerHandle,
+    _Out_writes_bytes_(BufferLength) PVOID OutBuffer,
+    _In_ ULONG BufferLength,
+    _Out_ PULONG ReturnedLength,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    PWMIP_LOGGER_CONTEXT Logger;
+    PWMIP_TRACE_BUFFER Buffer = NULL;
+    PLIST_ENTRY ListEntry;
+    LARGE_INTEGER Timeout;
+    ULONG LoggerId, Try;
+    KIRQL OldIrql;
+
+    *ReturnedLength = 0;
+
+    if (!SeSinglePrivilegeCheck(SeSystemProfilePrivilege, PreviousMode))
+        return STATUS_ACCESS_DENIED;
+
+    LoggerId = WMI_LOGGER_ID(LoggerHandle);
+    if (LoggerId == 0 || LoggerId >= WMI_MAX_LOGGERS)
+        return STATUS_INVALID_HANDLE;
+
+    Logger = WmipLoggerContext[LoggerId];
+    if (!Logger || !ExAcquireRundownProtection(&Logger->RundownProtect))
+        return STATUS_INVALID_HANDLE;
+
+    if (!Logger->Active || !(Logger->LogFileMode & EVENT_TRACE_REAL_TIME_MODE))
+    {
+        ExReleaseRundownProtection(&Logger->RundownProtect);
+        return STATUS_INVALID_HANDLE;
+    }
+
+    if (BufferLength < Logger->BufferSize)
+    {
+        ExReleaseRundownProtection(&Logger->RundownProtect);
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    for (Try = 0; Try < 2 && !Buffer; Try++)
+    {
+        KeAcquireSpinLock(&Logger->RealTimeLock, &OldIrql);
+        if (!IsListEmpty(&Logger->RealTimeListHead))
+        {
+            ListEntry = RemoveHeadList(&Logger->RealTimeListHead);
+            Buffer = CONTAINING_RECORD(ListEntry, WMIP_TRACE_BUFFER, RealTimeLink);
+            Logger->RealTimeCount--;
+        }
+        KeReleaseSpinLock(&Logger->RealTimeLock, OldIrql);
+
+        if (!Buffer && Try == 0)
+        {
+            Timeout.QuadPart = -10 * 1000 * 1000;
+            KeWaitForSingleObject(&Logger->RealTimeEvent, Executive, UserMode, FALSE, &Timeout);
+        }
+    }
+
+    if (Buffer)
+    {
+        RtlCopyMemory(OutBuffer, &Buffer->Header, Logger->BufferSize);
+        *ReturnedLength = Logger->BufferSize;
+        WmipRecycleBuffer(Logger, Buffer);
+    }
+
+    ExReleaseRundownProtection(&Logger->RundownProtect);
+    return STATUS_SUCCESS;
+}
+
+/* EOF */
@@ -19,18 +19,6 @@
 #define NDEBUG
 #include <debug.h>
 
-typedef PVOID PWMI_LOGGER_INFORMATION; // FIXME
-
-typedef enum _WMI_CLOCK_TYPE
-{
-    WMICT_DEFAULT,
-    WMICT_SYSTEMTIME,
-    WMICT_PERFCOUNTER,
-    WMICT_PROCESS,
-    WMICT_THREAD,
-    WMICT_CPUCYCLE
-} WMI_CLOCK_TYPE;
-
 /* FUNCTIONS *****************************************************************/
 
 BOOLEAN
@@ -41,6 +29,9 @@ WmiInitialize(
     UNICODE_STRING DriverName = RTL_CONSTANT_STRING(L"\\Driver\\WMIxWDM");
     NTSTATUS Status;
 
+    /* Initialize the trace sessions */
+    WmipInitializeLoggers();
+
     /* Initialize the GUID object type */
     Status = WmipInitializeGuidObjectType();
     if (!NT_SUCCESS(Status))
@@ -346,7 +337,7 @@ WmiQueryTraceInformation(IN TRACE_INFORMATION_CLASS TraceInformationClass,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 __cdecl
@@ -356,12 +347,22 @@ WmiTraceMessage(IN TRACEHANDLE LoggerHandle,
                 IN USHORT MessageNumber,
                 IN ...)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    va_list MessageArgList;
+    NTSTATUS Status;
+
+    va_start(MessageArgList, MessageNumber);
+    Status = WmiTraceMessageVa(LoggerHandle,
+                               MessageFlags,
+                               MessageGuid,
+                               MessageNumber,
+                               MessageArgList);
+    va_end(MessageArgList);
+
+    return Status;
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 NTAPI
@@ -371,16 +372,37 @@ WmiTraceMessageVa(IN TRACEHANDLE LoggerHandle,
                   IN USHORT MessageNumber,
                   IN va_list MessageArgList)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    EVENT_TRACE_HEADER Header;
+    MOF_FIELD Fields[MAX_MOF_FIELDS];
+    ULONG FieldCount = 0;
+    PVOID Argument;
+
+    /* The arguments are (PVOID, SIZE_T) pairs terminated by a NULL pointer */
+    while ((Argument = va_arg(MessageArgList, PVOID)) != NULL)
+    {
+        if (FieldCount == MAX_MOF_FIELDS)
+            return STATUS_INVALID_PARAMETER;
+
+        Fields[FieldCount].DataPtr = (ULONG64)(ULONG_PTR)Argument;
+        Fields[FieldCount].Length = (ULONG)va_arg(MessageArgList, SIZE_T);
+        Fields[FieldCount].DataType = 0;
+        FieldCount++;
+    }
+
+    RtlZeroMemory(&Header, sizeof(Header));
+    Header.HeaderType = WMI_HEADER_TYPE_MESSAGE;
+    Header.Class.Version = MessageNumber;
+    if ((MessageFlags & TRACE_MESSAGE_GUID) && MessageGuid)
+        Header.Guid = *MessageGuid;
+
+    return WmipLogEvent(WMI_LOGGER_ID(LoggerHandle), &Header, Fields, FieldCount);
 }
 
 NTSTATUS
 NTAPI
 WmiFlushTrace(IN OUT PWMI_LOGGER_INFORMATION LoggerInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    return WmipFlushLogger(LoggerInfo, KernelMode);
 }
 
 LONG64
@@ -388,52 +410,68 @@ FASTCALL
 WmiGetClock(IN WMI_CLOCK_TYPE ClockType,
             IN PVOID Context)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    ULONG KernelTime, UserTime;
+
+    switch (ClockType)
+    {
+        case WMICT_SYSTEMTIME:
+            return WmipGetTimeStamp(2);
+
+        case WMICT_CPUCYCLE:
+            return WmipGetTimeStamp(3);
+
+        case WMICT_THREAD:
+            return KeGetCurrentThread()->KernelTime + KeGetCurrentThread()->UserTime;
+
+        case WMICT_PROCESS:
+            KernelTime = KeQueryRuntimeProcess(&PsGetCurrentProcess()->Pcb, &UserTime);
+            return (LONG64)KernelTime + UserTime;
+
+        default:
+            return WmipGetTimeStamp(1);
+    }
 }
 
 NTSTATUS
 NTAPI
 WmiQueryTrace(IN OUT PWMI_LOGGER_INFORMATION LoggerInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    return WmipQueryLogger(LoggerInfo, KernelMode);
 }
 
 NTSTATUS
 NTAPI
 WmiStartTrace(IN OUT PWMI_LOGGER_INFORMATION LoggerInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    return WmipStartLogger(LoggerInfo, KernelMode);
 }
 
 NTSTATUS
 NTAPI
 WmiStopTrace(IN PWMI_LOGGER_INFORMATION LoggerInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    return WmipStopLogger(LoggerInfo, KernelMode);
 }
 
 NTSTATUS
 FASTCALL
 WmiTraceFastEvent(IN PWNODE_HEADER Wnode)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* The logger handle is in HistoricalContext, the event in the rest */
+    return WmipTraceUserEvent(WMI_LOGGER_ID(Wnode->HistoricalContext),
+                              (PEVENT_TRACE_HEADER)Wnode,
+                              KernelMode);
 }
 
 NTSTATUS
 NTAPI
 WmiUpdateTrace(IN OUT PWMI_LOGGER_INFORMATION LoggerInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    return WmipUpdateLogger(LoggerInfo, KernelMode);
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 NTAPI
@@ -442,8 +480,13 @@ NtTraceEvent(IN ULONG TraceHandle,
              IN ULONG TraceHeaderLength,
              IN struct _EVENT_TRACE_HEADER* TraceHeader)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    PAGED_CODE();
+
+    if (TraceHeaderLength < sizeof(EVENT_TRACE_HEADER))
+        return STATUS_INVALID_PARAMETER;
+
+    /* TraceHandle is the logger id */
+    return WmipTraceUserEvent(TraceHandle, TraceHeader, ExGetPreviousMode());
 }
 
 /*Eof*/
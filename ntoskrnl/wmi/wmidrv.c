@@ -102,8 +102,22 @@ WmiTraceEvent(
     PVOID InputBuffer,
     KPROCESSOR_MODE PreviousMode)
 {
-    UNIMPLEMENTED_DBGBREAK();
-    return STATUS_SUCCESS;
+    ULONG64 LoggerHandle;
+
+    /* The logger handle is in the HistoricalContext of the WNODE_HEADER */
+    _SEH2_TRY
+    {
+        if (PreviousMode != KernelMode)
+            ProbeForRead(InputBuffer, sizeof(WNODE_HEADER), sizeof(ULONG));
+        LoggerHandle = ((PWNODE_HEADER)InputBuffer)->HistoricalContext;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    return WmipTraceUserEvent(WMI_LOGGER_ID(LoggerHandle), InputBuffer, PreviousMode);
 }
 
 static
@@ -443,6 +457,51 @@ WmiSetMark(
     return STATUS_SUCCESS;
 }
 
+static
+NTSTATUS
+WmipLoggerControl(
+    _In_ ULONG IoControlCode,
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ ULONG InputLength,
+    _Inout_ PULONG OutputLength,
+    _In_ KPROCESSOR_MODE PreviousMode)
+{
+    NTSTATUS Status;
+
+    if ((InputLength < sizeof(WMI_LOGGER_INFORMATION)) ||
+        (*OutputLength < sizeof(WMI_LOGGER_INFORMATION)))
+    {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    switch (IoControlCode)
+    {
+        case IOCTL_WMI_START_LOGGER:
+            Status = WmipStartLogger(LoggerInfo, PreviousMode);
+            break;
+
+        case IOCTL_WMI_STOP_LOGGER:
+            Status = WmipStopLogger(LoggerInfo, PreviousMode);
+            break;
+
+        case IOCTL_WMI_QUERY_LOGGER:
+            Status = WmipQueryLogger(LoggerInfo, PreviousMode);
+            break;
+
+        case IOCTL_WMI_UPDATE_LOGGER:
+            Status = WmipUpdateLogger(LoggerInfo, PreviousMode);
+            break;
+
+        default:
+            ASSERT(IoControlCode == IOCTL_WMI_FLUSH_LOGGER);
+            Status = WmipFlushLogger(LoggerInfo, PreviousMode);
+            break;
+    }
+
+    *OutputLength = sizeof(WMI_LOGGER_INFORMATION);
+    return Status;
+}
+
 NTSTATUS
 NTAPI
 WmipIoControl(
@@ -507,6 +566,54 @@ WmipIoControl(
             break;
         }
 
+        case IOCTL_WMI_START_LOGGER:
+        case IOCTL_WMI_STOP_LOGGER:
+        case IOCTL_WMI_QUERY_LOGGER:
+        case IOCTL_WMI_UPDATE_LOGGER:
+        case IOCTL_WMI_FLUSH_LOGGER:
+        {
+            Status = WmipLoggerControl(IoControlCode,
+                                       Buffer,
+                                       InputLength,
+                                       &OutputLength,
+                                       Irp->RequestorMode);
+            break;
+        }
+
+        case IOCTL_WMI_ENABLE_TRACE:
+        case IOCTL_WMI_QUERY_TRACE_GUID:
+        {
+            if ((InputLength < sizeof(WMI_TRACE_GUID_CONTROL)) ||
+                (OutputLength < sizeof(WMI_TRACE_GUID_CONTROL)))
+            {
+                Status = STATUS_INFO_LENGTH_MISMATCH;
+                break;
+            }
+
+            if (IoControlCode == IOCTL_WMI_ENABLE_TRACE)
+                Status = WmipEnableTrace(Buffer, Irp->RequestorMode);
+            else
+                Status = WmipQueryTraceGuid(Buffer);
+            OutputLength = sizeof(WMI_TRACE_GUID_CONTROL);
+            break;
+        }
+
+        case IOCTL_WMI_READ_LOGGER_BUFFER:
+        {
+            if (InputLength < sizeof(ULONG64))
+            {
+                Status = STATUS_INFO_LENGTH_MISMATCH;
+                break;
+            }
+
+            Status = WmipReadLoggerBuffer(*(PULONG64)Buffer,
+                                          Buffer,
+                                          OutputLength,
+                                          &OutputLength,
+                                          Irp->RequestorMode);
+            break;
+        }
+
         case IOCTL_WMI_SET_MARK:
         {
             if (InputLength < FIELD_OFFSET(WMI_SET_MARK, Mark))
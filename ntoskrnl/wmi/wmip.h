@@ -1,6 +1,10 @@
 
 #pragma once
 
+#include <wmistr.h>
+#include <evntrace.h>
+#include <wmiioctl.h>
+
 extern POBJECT_TYPE WmipGuidObjectType;
 
 #define GUID_STRING_LENGTH 36
@@ -56,3 +60,189 @@ WmipQueryRawSMBiosTables(
     _Inout_ ULONG *InOutBufferSize,
     _Out_opt_ PVOID OutBuffer);
 
+
+/* Trace sessions *************************************************************/
+
+typedef enum _WMI_CLOCK_TYPE
+{
+    WMICT_DEFAULT,
+    WMICT_SYSTEMTIME,
+    WMICT_PERFCOUNTER,
+    WMICT_PROCESS,
+    WMICT_THREAD,
+    WMICT_CPUCYCLE
+} WMI_CLOCK_TYPE;
+
+typedef struct _WMIP_TRACE_BUFFER
+{
+    SLIST_ENTRY ListEntry;          /* Free list or flush list */
+    LIST_ENTRY RealTimeLink;
+    volatile LONG ReferenceCount;   /* Writers still copying into the buffer */
+    volatile LONG CurrentOffset;    /* From Header */
+    ULONG ProcessorNumber;
+    WMI_TRACE_BUFFER_HEADER Header; /* BufferSize bytes from here */
+} WMIP_TRACE_BUFFER, *PWMIP_TRACE_BUFFER;
+
+typedef struct DECLSPEC_CACHEALIGN _WMIP_PROCESSOR_BUFFER
+{
+    PWMIP_TRACE_BUFFER volatile Buffer;
+    volatile LONG WriterCount;
+} WMIP_PROCESSOR_BUFFER, *PWMIP_PROCESSOR_BUFFER;
+
+typedef struct _WMIP_LOGGER_CONTEXT
+{
+    /* Written by the control path only */
+    ULONG LoggerId;
+    volatile LONG Active;
+    BOOLEAN InUse;
+    BOOLEAN StopRequested;
+    BOOLEAN FlushRequested;
+    GUID Guid;
+    ULONG ClockType;
+    ULONG BufferSize;               /* In bytes */
+    ULONG MinimumBuffers;
+    ULONG MaximumBuffers;
+    ULONG64 MaximumFileSize;        /* In bytes, 0 for no limit */
+    ULONG LogFileMode;
+    ULONG FlushTimer;
+    ULONG EnableFlags;
+    WCHAR LoggerName[WMI_MAX_LOGGER_NAME];
+    WCHAR LogFileName[WMI_MAX_LOGFILE_NAME];
+    LARGE_INTEGER StartTime;
+    EX_RUNDOWN_REF RundownProtect;  /* Real-time readers and flush requests */
+
+    /* Logger thread */
+    PETHREAD LoggerThread;
+    ULONG LoggerThreadId;
+    KEVENT FlushEvent;
+    KEVENT FlushDoneEvent;
+    KGUARDED_MUTEX FlushLock;       /* One flush request at a time */
+    KDPC FlushDpc;
+    HANDLE FileHandle;
+    LARGE_INTEGER FileOffset;
+    ULONG SequenceNumber;
+
+    /* Buffers */
+    SLIST_HEADER FreeList;
+    SLIST_HEADER FlushList;
+    volatile LONG NumberOfBuffers;
+    volatile LONG EventsLost;
+    volatile LONG BuffersWritten;
+    volatile LONG LogBuffersLost;
+    volatile LONG RealTimeBuffersLost;
+
+    /* Real-time consumers */
+    KSPIN_LOCK RealTimeLock;
+    LIST_ENTRY RealTimeListHead;
+    ULONG RealTimeCount;
+    KEVENT RealTimeEvent;
+
+    WMIP_PROCESSOR_BUFFER Processors[MAXIMUM_PROCESSORS];
+} WMIP_LOGGER_CONTEXT, *PWMIP_LOGGER_CONTEXT;
+
+extern PWMIP_LOGGER_CONTEXT WmipLoggerContext[WMI_MAX_LOGGERS];
+
+VOID
+NTAPI
+WmipInitializeLoggers(
+    VOID);
+
+LONG64
+NTAPI
+WmipGetTimeStamp(
+    _In_ ULONG ClockType);
+
+NTSTATUS
+NTAPI
+WmipLogEvent(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER Header,
+    _In_reads_(FieldCount) PMOF_FIELD Fields,
+    _In_ ULONG FieldCount);
+
+/* Header fields of an event captured before it is logged */
+typedef struct _WMIP_EVENT_STAMP
+{
+    LONG64 TimeStamp;
+    ULONG ThreadId;
+    ULONG ProcessId;
+    ULONG KernelTime;
+    ULONG UserTime;
+    ULONG ProcessorNumber;
+} WMIP_EVENT_STAMP, *PWMIP_EVENT_STAMP;
+
+NTSTATUS
+NTAPI
+WmipLogStampedEvent(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER Header,
+    _In_reads_(FieldCount) PMOF_FIELD Fields,
+    _In_ ULONG FieldCount,
+    _In_ PWMIP_EVENT_STAMP Stamp);
+
+NTSTATUS
+NTAPI
+WmipTraceUserEvent(
+    _In_ ULONG LoggerId,
+    _In_ PEVENT_TRACE_HEADER TraceHeader,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipStartLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipStopLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipQueryLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipUpdateLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipFlushLogger(
+    _Inout_ PWMI_LOGGER_INFORMATION LoggerInfo,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipEnableTrace(
+    _Inout_ PWMI_TRACE_GUID_CONTROL Control,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+NTSTATUS
+NTAPI
+WmipQueryTraceGuid(
+    _Inout_ PWMI_TRACE_GUID_CONTROL Control);
+
+NTSTATUS
+NTAPI
+WmipReadLoggerBuffer(
+    _In_ ULONG64 LoggerHandle,
+    _Out_writes_bytes_(BufferLength) PVOID Buffer,
+    _In_ ULONG BufferLength,
+    _Out_ PULONG ReturnedLength,
+    _In_ KPROCESSOR_MODE PreviousMode);
+
+VOID
+NTAPI
+WmipStartKernelTrace(
+    VOID);
+
+VOID
+NTAPI
+WmipStopKernelTrace(
+    VOID);
@@ -831,6 +831,50 @@ function(create_registry_hives)
 
 endfunction()
 
+function(create_boot_bundle)
+    # The boot set of the live CD, in the order FreeLoader opens it.
+    # Targets that are not built for this architecture are skipped.
+    set(_bundle_content "system32\\config\\SYSTEM=${CMAKE_BINARY_DIR}/boot/bootdata/system\n")
+    foreach(_nls c_1252.nls c_437.nls l_intl.nls)
+        string(APPEND _bundle_content "system32\\${_nls}=${REACTOS_SOURCE_DIR}/media/nls/${_nls}\n")
+    endforeach()
+
+    set(_bundle_depends livecd_hives)
+    foreach(_target ntoskrnl hal kdcom bootvid)
+        if(TARGET ${_target})
+            string(APPEND _bundle_content "system32\\$<TARGET_FILE_NAME:${_target}>=$<TARGET_FILE:${_target}>\n")
+            list(APPEND _bundle_depends ${_target})
+        endif()
+    endforeach()
+    foreach(_target acpi pci pciidex atapi uniata scsiport storport classpnp disk cdrom partmgr mountmgr
+                    ramdisk wmilib ksecdd fltmgr fastfat cdfs)
+        if(TARGET ${_target})
+            string(APPEND _bundle_content "system32\\drivers\\$<TARGET_FILE_NAME:${_target}>=$<TARGET_FILE:${_target}>\n")
+            list(APPEND _bundle_depends ${_target})
+        endif()
+    endforeach()
+
+    file(GENERATE
+         OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.$<CONFIG>.lst
+         CONTENT "${_bundle_content}")
+
+    add_custom_command(
+        OUTPUT ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.bin
+        COMMAND native-mkbundle ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.$<CONFIG>.lst ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.bin
+        DEPENDS native-mkbundle ${_bundle_depends} ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.$<CONFIG>.lst)
+
+    add_custom_target(bootbundle
+        DEPENDS ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.bin)
+
+    if(BOOT_BUNDLE)
+        add_cd_file(
+            FILE ${CMAKE_BINARY_DIR}/boot/bootdata/bootset.bin
+            TARGET bootbundle
+            DESTINATION reactos/system32
+            FOR livecd)
+    endif()
+endfunction()
+
 function(add_driver_inf _module)
     # Add to the inf files list
     foreach(_file ${ARGN})
@@ -79,6 +79,9 @@ set(BUILD_MP TRUE CACHE BOOL
 set(GENERATE_DEPENDENCY_GRAPH FALSE CACHE BOOL
 "Whether to create a GraphML dependency graph of DLLs.")
 
+set(BOOT_BUNDLE FALSE CACHE BOOL
+"Whether to put a compressed bundle of the boot set on the live CD.")
+
 if(MSVC)
 set(_PREFAST_ FALSE CACHE BOOL
 "Whether to enable PREFAST while compiling.")
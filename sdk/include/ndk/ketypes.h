@@ -509,6 +509,22 @@ typedef enum _VDMSERVICECLASS
    VdmQueryVdmProcess = 14,
 } VDMSERVICECLASS;
 
+//
+// ReactOS Extension: TSC Performance Counter Data
+// Published by the HAL for RtlQueryPerformanceCounter in the shared user
+// data page, past the end of KUSER_SHARED_DATA, which keeps its layout
+//
+typedef struct _KUSER_TSC_QPC_DATA
+{
+    volatile ULONG64 Bias;
+    volatile BOOLEAN Enabled;
+    UCHAR Shift;
+} KUSER_TSC_QPC_DATA, *PKUSER_TSC_QPC_DATA;
+
+#define KUSER_TSC_QPC_DATA_OFFSET       0xF00
+#define SharedUserTscQpcData            ((KUSER_TSC_QPC_DATA *)((ULONG_PTR)SharedUserData + \
+                                                                KUSER_TSC_QPC_DATA_OFFSET))
+
 #ifdef NTOS_MODE_USER
 
 //
@@ -4539,6 +4539,12 @@ NTAPI
 RtlQueryTimeZoneInformation(
     _Out_ PRTL_TIME_ZONE_INFORMATION TimeZoneInformation);
 
+NTSYSAPI
+BOOLEAN
+NTAPI
+RtlQueryPerformanceCounter(
+    _Out_ PLARGE_INTEGER PerformanceCounter);
+
 NTSYSAPI
 VOID
 NTAPI
@@ -0,0 +1,44 @@
+/*
+ * PROJECT:     ReactOS Boot Loader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot bundle file format, shared by FreeLoader and mkbundle
+ */
+
+#pragma once
+
+/*
+ * A boot bundle packs the files loaded at boot time (kernel, HAL, boot
+ * drivers, NLS data, SYSTEM hive) into one file stored in the system root,
+ * so that the boot loader reads them with a single sequential read.
+ *
+ * The file starts with a BOOT_BUNDLE_HEADER, followed by EntryCount
+ * BOOT_BUNDLE_ENTRY structures and their names. The file data starts at
+ * DataOffset and is stored in the same order as the entries. All values
+ * are little-endian.
+ */
+#define BOOT_BUNDLE_FILE_NAME       "system32\\bootset.bin"
+#define BOOT_BUNDLE_SIGNATURE       0x444E4242 /* "BBND" */
+#define BOOT_BUNDLE_VERSION         1
+
+/* Entry data is LZNT1 compressed, otherwise it is stored as is */
+#define BOOT_BUNDLE_ENTRY_LZNT1     0x00000001
+
+typedef struct _BOOT_BUNDLE_HEADER
+{
+    ULONG Signature;
+    USHORT Version;
+    USHORT HeaderSize;          /* sizeof(BOOT_BUNDLE_HEADER) */
+    ULONG EntryCount;
+    ULONG DataOffset;           /* Offset of the file data, end of the entries and names */
+    ULONG CompressedSize;       /* Size of the file data */
+    ULONG UncompressedSize;     /* Sum of the sizes of all files */
+} BOOT_BUNDLE_HEADER, *PBOOT_BUNDLE_HEADER;
+
+typedef struct _BOOT_BUNDLE_ENTRY
+{
+    ULONG NameOffset;           /* NUL-terminated path relative to the system root, e.g. "system32\ntoskrnl.exe" */
+    ULONG Flags;                /* BOOT_BUNDLE_ENTRY_* */
+    ULONG DataOffset;           /* Offset of the stored data */
+    ULONG DataSize;             /* Size of the stored data */
+    ULONG FileSize;             /* Size of the file */
+} BOOT_BUNDLE_ENTRY, *PBOOT_BUNDLE_ENTRY;
@@ -239,6 +239,9 @@ typedef struct _CSR_SERVER_DLL
     PCSR_NEWPROCESS_CALLBACK NewProcessCallback;
     PCSR_SHUTDOWNPROCESS_CALLBACK ShutdownProcessCallback;
     ULONG Unknown2[3];
+
+    /* ReactOS extensions, left zeroed by CSRSRV for servers which do not know them */
+    PBOOLEAN ByReferenceTable; // Table of booleans which describe whether or not a server function can use large capture buffers in place, without copying them.
 } CSR_SERVER_DLL, *PCSR_SERVER_DLL;
 #ifndef _WIN64
     #ifdef CSR_DBG
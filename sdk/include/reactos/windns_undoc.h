@@ -18,6 +18,17 @@ typedef struct _DNS_CACHE_ENTRY
     unsigned short wFlags;          /* DNS Record Flags */
 } DNS_CACHE_ENTRY, *PDNS_CACHE_ENTRY;
 
+typedef struct _DNS_CACHE_STATS
+{
+    unsigned long dwHashTableSize;      /* Number of hash buckets */
+    unsigned long dwEntries;            /* Cached names, including negative ones */
+    unsigned long dwNegativeEntries;    /* Cached names that don't resolve */
+    unsigned long dwHits;               /* Queries answered from the cache */
+    unsigned long dwNegativeHits;       /* Of which with a cached failure */
+    unsigned long dwMisses;             /* Queries not found in the cache */
+    unsigned long dwExpired;            /* Entries removed once their TTL ran out */
+} DNS_CACHE_STATS, *PDNS_CACHE_STATS;
+
 
 #ifndef __WIDL__
 // Hack
@@ -6,16 +6,18 @@
 #define IOCTL_WMI_SET_SINGLE_INSTANCE CTL_CODE(FILE_DEVICE_UNKNOWN, 0x02, METHOD_BUFFERED, FILE_WRITE_ACCESS) // 0x228008
 #define IOCTL_WMI_SET_SINGLE_ITEM CTL_CODE(FILE_DEVICE_UNKNOWN, 0x03, METHOD_BUFFERED, FILE_WRITE_ACCESS) // 0x22800C
 #define IOCTL_WMI_09 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x09, METHOD_BUFFERED, FILE_WRITE_ACCESS) // 0x228024
-#define IOCTL_WMI_20 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x20, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220080
-#define IOCTL_WMI_21 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x21, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220084
-#define IOCTL_WMI_22 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x22, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220088
+#define IOCTL_WMI_START_LOGGER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x20, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220080
+#define IOCTL_WMI_STOP_LOGGER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x21, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220084
+#define IOCTL_WMI_QUERY_LOGGER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x22, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220088
 #define IOCTL_WMI_TRACE_EVENT CTL_CODE(FILE_DEVICE_UNKNOWN, 0x23, METHOD_NEITHER, FILE_WRITE_ACCESS) // 0x22808F
-#define IOCTL_WMI_24 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x24, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220090
-#define IOCTL_WMI_25 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x25, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220094
+#define IOCTL_WMI_UPDATE_LOGGER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x24, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220090
+#define IOCTL_WMI_FLUSH_LOGGER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x25, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220094
+#define IOCTL_WMI_READ_LOGGER_BUFFER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x26, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x220098
+#define IOCTL_WMI_QUERY_TRACE_GUID CTL_CODE(FILE_DEVICE_UNKNOWN, 0x27, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x22009C
 #define IOCTL_WMI_TRACE_USER_MESSAGE CTL_CODE(FILE_DEVICE_UNKNOWN, 0x28, METHOD_NEITHER, FILE_WRITE_ACCESS) // 0x2280A3
 #define IOCTL_WMI_SET_MARK CTL_CODE(FILE_DEVICE_UNKNOWN, 0x29, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x2200A4
 #define IOCTL_WMI_2a CTL_CODE(FILE_DEVICE_UNKNOWN, 0x2a, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x2200A8
-#define IOCTL_WMI_2b CTL_CODE(FILE_DEVICE_UNKNOWN, 0x2b, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x2200AC
+#define IOCTL_WMI_ENABLE_TRACE CTL_CODE(FILE_DEVICE_UNKNOWN, 0x2b, METHOD_BUFFERED, FILE_ANY_ACCESS) // 0x2200AC
 #define IOCTL_WMI_42 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x42, METHOD_BUFFERED, FILE_READ_ACCESS) // 0x224108
 #define IOCTL_WMI_47 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x47, METHOD_BUFFERED, FILE_WRITE_ACCESS) // 0x22811C
 #define IOCTL_WMI_49 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x49, METHOD_BUFFERED, FILE_READ_ACCESS) // 0x224124
@@ -35,3 +37,184 @@
 #define IOCTL_WMI_58 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x58, METHOD_BUFFERED, FILE_READ_ACCESS) // 0x224160
 #define IOCTL_WMI_59 CTL_CODE(FILE_DEVICE_UNKNOWN, 0x59, METHOD_BUFFERED, FILE_READ_ACCESS) // 0x224164
 #define IOCTL_WMI_5a CTL_CODE(FILE_DEVICE_UNKNOWN, 0x5a, METHOD_BUFFERED, FILE_WRITE_ACCESS) // 0x228168
+
+/*
+ * Trace sessions ("loggers")
+ *
+ * A logger handle carries the logger id in its low word, the enable level
+ * in bits 16-23 and the enable flags in its high dword, so that providers
+ * can check whether they are enabled without calling into the kernel.
+ */
+#define WMI_MAX_LOGGERS             32
+#define WMI_KERNEL_LOGGER_ID        1
+#define WMI_MAX_LOGGER_NAME         128
+#define WMI_MAX_LOGFILE_NAME        260
+
+#define WMI_MAKE_LOGGER_HANDLE(Id, Level, Flags) \
+    ((ULONG64)(Id) | ((ULONG64)((Level) & 0xFF) << 16) | ((ULONG64)(Flags) << 32))
+#define WMI_LOGGER_ID(Handle)       ((ULONG)((Handle) & 0xFFFF))
+#define WMI_LOGGER_LEVEL(Handle)    ((UCHAR)((Handle) >> 16))
+#define WMI_LOGGER_FLAGS(Handle)    ((ULONG)((Handle) >> 32))
+
+/* Input and output of IOCTL_WMI_START/STOP/QUERY/UPDATE/FLUSH_LOGGER */
+typedef struct _WMI_LOGGER_INFORMATION
+{
+    ULONG64 LoggerHandle;
+    GUID Guid;
+    ULONG ClockType;
+    ULONG BufferSize;           /* In KB */
+    ULONG MinimumBuffers;
+    ULONG MaximumBuffers;
+    ULONG MaximumFileSize;      /* In MB */
+    ULONG LogFileMode;
+    ULONG FlushTimer;           /* In seconds */
+    ULONG EnableFlags;
+    ULONG NumberOfBuffers;
+    ULONG FreeBuffers;
+    ULONG EventsLost;
+    ULONG BuffersWritten;
+    ULONG LogBuffersLost;
+    ULONG RealTimeBuffersLost;
+    ULONG LoggerThreadId;
+    WCHAR LoggerName[WMI_MAX_LOGGER_NAME];
+    WCHAR LogFileName[WMI_MAX_LOGFILE_NAME];    /* NT path */
+} WMI_LOGGER_INFORMATION, *PWMI_LOGGER_INFORMATION;
+
+/* Input and output of IOCTL_WMI_ENABLE_TRACE and IOCTL_WMI_QUERY_TRACE_GUID */
+typedef struct _WMI_TRACE_GUID_CONTROL
+{
+    GUID Guid;
+    ULONG64 LoggerHandle;       /* Out: includes the level and the flags */
+    ULONG EnableFlags;
+    ULONG Level;
+    ULONG Enable;
+    ULONG Reserved;
+} WMI_TRACE_GUID_CONTROL, *PWMI_TRACE_GUID_CONTROL;
+
+/*
+ * Log file layout
+ *
+ * The first BufferSize bytes of a log file hold a WMI_LOGFILE_HEADER,
+ * every following block of BufferSize bytes is a trace buffer. A trace
+ * buffer starts with a WMI_TRACE_BUFFER_HEADER and is followed by events,
+ * each one an EVENT_TRACE_HEADER whose Size covers the header and the
+ * event data, rounded up to WMI_TRACE_ALIGNMENT in the buffer.
+ * IOCTL_WMI_READ_LOGGER_BUFFER returns buffers with the same layout.
+ */
+#define WMI_LOGFILE_SIGNATURE       'FLTE'
+#define WMI_LOGFILE_VERSION         1
+#define WMI_TRACE_ALIGNMENT         8
+
+#define WMI_HEADER_TYPE_EVENT       0x01    /* EVENT_TRACE_HEADER.HeaderType */
+#define WMI_HEADER_TYPE_MESSAGE     0x02    /* Class.Version is the message number */
+
+typedef struct _WMI_LOGFILE_HEADER
+{
+    ULONG Signature;
+    ULONG Version;
+    ULONG BufferSize;           /* In bytes */
+    ULONG NumberOfProcessors;
+    ULONG LogFileMode;
+    ULONG ClockType;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    LARGE_INTEGER PerfFreq;
+    ULONG BuffersWritten;
+    ULONG EventsLost;
+    ULONG BuffersLost;
+    ULONG Reserved;
+    WCHAR LoggerName[WMI_MAX_LOGGER_NAME];
+} WMI_LOGFILE_HEADER, *PWMI_LOGFILE_HEADER;
+
+typedef struct _WMI_TRACE_BUFFER_HEADER
+{
+    ULONG BufferSize;           /* In bytes */
+    ULONG SavedOffset;          /* End of the last event */
+    ULONG SequenceNumber;
+    USHORT ProcessorNumber;
+    USHORT LoggerId;
+    LARGE_INTEGER TimeStamp;
+} WMI_TRACE_BUFFER_HEADER, *PWMI_TRACE_BUFFER_HEADER;
+
+/*
+ * NT Kernel Logger events
+ *
+ * The kernel logs these events when the matching EVENT_TRACE_FLAG_* is set
+ * in the EnableFlags of the NT Kernel Logger. Pointers are logged as 64-bit
+ * values so that the layouts are the same on every architecture.
+ */
+DEFINE_GUID(ThreadGuid, 0x3d6fa8d1, 0xfe05, 0x11d0, 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c);
+DEFINE_GUID(PageFaultGuid, 0x3d6fa8d3, 0xfe05, 0x11d0, 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c);
+DEFINE_GUID(DiskIoGuid, 0x3d6fa8d4, 0xfe05, 0x11d0, 0x9d, 0xda, 0x00, 0xc0, 0x4f, 0xd7, 0xba, 0x7c);
+
+/* ThreadGuid, EVENT_TRACE_FLAG_CSWITCH */
+#define WMI_TYPE_CSWITCH            36
+
+typedef struct _WMI_CSWITCH_EVENT
+{
+    ULONG NewThreadId;
+    ULONG OldThreadId;
+    CHAR NewThreadPriority;
+    CHAR OldThreadPriority;
+    UCHAR OldThreadWaitReason;
+    CHAR OldThreadWaitMode;
+    UCHAR OldThreadState;
+    UCHAR Reserved[3];
+    ULONG NewThreadWaitTime;    /* In clock ticks */
+} WMI_CSWITCH_EVENT, *PWMI_CSWITCH_EVENT;
+
+/* ThreadGuid, EVENT_TRACE_FLAG_DISPATCHER */
+#define WMI_TYPE_READY_THREAD       50
+
+typedef struct _WMI_READY_THREAD_EVENT
+{
+    ULONG ThreadId;
+    CHAR Priority;
+    UCHAR Reserved[3];
+} WMI_READY_THREAD_EVENT, *PWMI_READY_THREAD_EVENT;
+
+/*
+ * DiskIoGuid, EVENT_TRACE_FLAG_DISK_IO
+ * EVENT_TRACE_TYPE_IO_READ_INIT and _WRITE_INIT when a request is sent to a
+ * disk, EVENT_TRACE_TYPE_IO_READ and _WRITE when it completes.
+ */
+typedef struct _WMI_DISKIO_INIT_EVENT
+{
+    ULONG64 Irp;
+} WMI_DISKIO_INIT_EVENT, *PWMI_DISKIO_INIT_EVENT;
+
+typedef struct _WMI_DISKIO_EVENT
+{
+    ULONG64 Irp;
+    ULONG64 DeviceObject;
+    ULONG64 FileObject;
+    ULONG64 ByteOffset;
+    ULONG TransferSize;
+    ULONG IrpFlags;
+    LONG Status;
+    ULONG Reserved;
+    ULONG64 ResponseTime;       /* In units of the logger clock, 0 if unknown */
+} WMI_DISKIO_EVENT, *PWMI_DISKIO_EVENT;
+
+/*
+ * PageFaultGuid, EVENT_TRACE_FLAG_MEMORY_PAGE_FAULTS
+ * The event type is one of EVENT_TRACE_TYPE_MM_*.
+ */
+typedef struct _WMI_PAGE_FAULT_EVENT
+{
+    ULONG64 VirtualAddress;
+    ULONG64 ProgramCounter;
+} WMI_PAGE_FAULT_EVENT, *PWMI_PAGE_FAULT_EVENT;
+
+/* PageFaultGuid, EVENT_TRACE_FLAG_MEMORY_HARD_FAULTS */
+#define WMI_TYPE_HARD_FAULT         32
+
+typedef struct _WMI_HARD_FAULT_EVENT
+{
+    LARGE_INTEGER InitialTime;  /* When the read was started */
+    ULONG64 ReadOffset;         /* In the file or in the paging file */
+    ULONG64 VirtualAddress;
+    ULONG64 FileObject;
+    ULONG ThreadId;
+    ULONG ByteCount;
+} WMI_HARD_FAULT_EVENT, *PWMI_HARD_FAULT_EVENT;
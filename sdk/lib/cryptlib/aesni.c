@@ -0,0 +1,345 @@
+/*
+ * PROJECT:     ReactOS Crypto Library
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     AES block modes on top of the AES-NI instructions
+ */
+
+#include "cryptaccel.h"
+#include <string.h>
+
+#ifdef CRYPT_ACCEL_BUILTINS
+
+#define AESNI_TARGET        __attribute__((target("aes,ssse3")))
+#define AESNI_MAX_ROUNDS    14
+#define AESNI_PARALLEL      4
+
+typedef long long AESNI_BLOCK __attribute__((vector_size(16)));
+typedef char AESNI_BYTES __attribute__((vector_size(16)));
+
+/* Turns the big endian words of the LibTomCrypt schedules into byte order */
+static const AESNI_BYTES AesNiKeySwap = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+
+static inline
+AESNI_BLOCK
+AesNiLoad(IN const VOID *Data)
+{
+    AESNI_BLOCK Block;
+
+    memcpy(&Block, Data, sizeof(Block));
+    return Block;
+}
+
+static inline
+VOID
+AesNiStore(OUT VOID *Data, IN AESNI_BLOCK Block)
+{
+    memcpy(Data, &Block, sizeof(Block));
+}
+
+AESNI_TARGET
+static inline
+VOID
+AesNiLoadKey(
+    IN const ULONG32 *Key,
+    IN ULONG Rounds,
+    OUT AESNI_BLOCK RoundKeys[AESNI_MAX_ROUNDS + 1])
+{
+    ULONG i;
+
+    for (i = 0; i <= Rounds; i++)
+    {
+        RoundKeys[i] = (AESNI_BLOCK)__builtin_ia32_pshufb128((AESNI_BYTES)AesNiLoad(&Key[i * 4]),
+                                                             AesNiKeySwap);
+    }
+}
+
+AESNI_TARGET
+static inline
+AESNI_BLOCK
+AesNiEncryptBlock(
+    IN const AESNI_BLOCK *RoundKeys,
+    IN ULONG Rounds,
+    IN AESNI_BLOCK Block)
+{
+    ULONG i;
+
+    Block ^= RoundKeys[0];
+    for (i = 1; i < Rounds; i++)
+        Block = __builtin_ia32_aesenc128(Block, RoundKeys[i]);
+    return __builtin_ia32_aesenclast128(Block, RoundKeys[Rounds]);
+}
+
+AESNI_TARGET
+static inline
+AESNI_BLOCK
+AesNiDecryptBlock(
+    IN const AESNI_BLOCK *RoundKeys,
+    IN ULONG Rounds,
+    IN AESNI_BLOCK Block)
+{
+    ULONG i;
+
+    Block ^= RoundKeys[0];
+    for (i = 1; i < Rounds; i++)
+        Block = __builtin_ia32_aesdec128(Block, RoundKeys[i]);
+    return __builtin_ia32_aesdeclast128(Block, RoundKeys[Rounds]);
+}
+
+/*
+ * The instructions have a latency of several cycles but a throughput of
+ * one per cycle, so independent blocks go through the rounds together.
+ */
+AESNI_TARGET
+static inline
+VOID
+AesNiEncryptParallel(
+    IN const AESNI_BLOCK *RoundKeys,
+    IN ULONG Rounds,
+    IN OUT AESNI_BLOCK Blocks[AESNI_PARALLEL])
+{
+    ULONG i, j;
+
+    for (j = 0; j < AESNI_PARALLEL; j++)
+        Blocks[j] ^= RoundKeys[0];
+    for (i = 1; i < Rounds; i++)
+    {
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            Blocks[j] = __builtin_ia32_aesenc128(Blocks[j], RoundKeys[i]);
+    }
+    for (j = 0; j < AESNI_PARALLEL; j++)
+        Blocks[j] = __builtin_ia32_aesenclast128(Blocks[j], RoundKeys[Rounds]);
+}
+
+AESNI_TARGET
+static inline
+VOID
+AesNiDecryptParallel(
+    IN const AESNI_BLOCK *RoundKeys,
+    IN ULONG Rounds,
+    IN OUT AESNI_BLOCK Blocks[AESNI_PARALLEL])
+{
+    ULONG i, j;
+
+    for (j = 0; j < AESNI_PARALLEL; j++)
+        Blocks[j] ^= RoundKeys[0];
+    for (i = 1; i < Rounds; i++)
+    {
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            Blocks[j] = __builtin_ia32_aesdec128(Blocks[j], RoundKeys[i]);
+    }
+    for (j = 0; j < AESNI_PARALLEL; j++)
+        Blocks[j] = __builtin_ia32_aesdeclast128(Blocks[j], RoundKeys[Rounds]);
+}
+
+AESNI_TARGET
+VOID
+AesNiEncryptEcb(IN const ULONG32 *EncryptKey, IN ULONG Rounds,
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+    AESNI_BLOCK RoundKeys[AESNI_MAX_ROUNDS + 1];
+    AESNI_BLOCK Parallel[AESNI_PARALLEL];
+    ULONG j;
+
+    AesNiLoadKey(EncryptKey, Rounds, RoundKeys);
+
+    for (; Blocks >= AESNI_PARALLEL; Blocks -= AESNI_PARALLEL)
+    {
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            Parallel[j] = AesNiLoad(Input + j * 16);
+        AesNiEncryptParallel(RoundKeys, Rounds, Parallel);
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            AesNiStore(Output + j * 16, Parallel[j]);
+        Input += AESNI_PARALLEL * 16;
+        Output += AESNI_PARALLEL * 16;
+    }
+
+    for (; Blocks > 0; Blocks--)
+    {
+        AesNiStore(Output, AesNiEncryptBlock(RoundKeys, Rounds, AesNiLoad(Input)));
+        Input += 16;
+        Output += 16;
+    }
+}
+
+AESNI_TARGET
+VOID
+AesNiDecryptEcb(IN const ULONG32 *DecryptKey, IN ULONG Rounds,
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+    AESNI_BLOCK RoundKeys[AESNI_MAX_ROUNDS + 1];
+    AESNI_BLOCK Parallel[AESNI_PARALLEL];
+    ULONG j;
+
+    AesNiLoadKey(DecryptKey, Rounds, RoundKeys);
+
+    for (; Blocks >= AESNI_PARALLEL; Blocks -= AESNI_PARALLEL)
+    {
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            Parallel[j] = AesNiLoad(Input + j * 16);
+        AesNiDecryptParallel(RoundKeys, Rounds, Parallel);
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            AesNiStore(Output + j * 16, Parallel[j]);
+        Input += AESNI_PARALLEL * 16;
+        Output += AESNI_PARALLEL * 16;
+    }
+
+    for (; Blocks > 0; Blocks--)
+    {
+        AesNiStore(Output, AesNiDecryptBlock(RoundKeys, Rounds, AesNiLoad(Input)));
+        Input += 16;
+        Output += 16;
+    }
+}
+
+/* Every block depends on the previous one, so encryption stays serial */
+AESNI_TARGET
+VOID
+AesNiEncryptCbc(IN const ULONG32 *EncryptKey, IN ULONG Rounds, IN OUT UCHAR Iv[16],
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+    AESNI_BLOCK RoundKeys[AESNI_MAX_ROUNDS + 1];
+    AESNI_BLOCK Chain;
+
+    AesNiLoadKey(EncryptKey, Rounds, RoundKeys);
+
+    Chain = AesNiLoad(Iv);
+    for (; Blocks > 0; Blocks--)
+    {
+        Chain = AesNiEncryptBlock(RoundKeys, Rounds, AesNiLoad(Input) ^ Chain);
+        AesNiStore(Output, Chain);
+        Input += 16;
+        Output += 16;
+    }
+    AesNiStore(Iv, Chain);
+}
+
+AESNI_TARGET
+VOID
+AesNiDecryptCbc(IN const ULONG32 *DecryptKey, IN ULONG Rounds, IN OUT UCHAR Iv[16],
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+    AESNI_BLOCK RoundKeys[AESNI_MAX_ROUNDS + 1];
+    AESNI_BLOCK Parallel[AESNI_PARALLEL], Cipher[AESNI_PARALLEL];
+    AESNI_BLOCK Chain;
+    ULONG j;
+
+    AesNiLoadKey(DecryptKey, Rounds, RoundKeys);
+
+    /* The input is read before the output is written, so both may overlap */
+    Chain = AesNiLoad(Iv);
+    for (; Blocks >= AESNI_PARALLEL; Blocks -= AESNI_PARALLEL)
+    {
+        for (j = 0; j < AESNI_PARALLEL; j++)
+            Parallel[j] = Cipher[j] = AesNiLoad(Input + j * 16);
+        AesNiDecryptParallel(RoundKeys, Rounds, Parallel);
+        AesNiStore(Output, Parallel[0] ^ Chain);
+        for (j = 1; j < AESNI_PARALLEL; j++)
+            AesNiStore(Output + j * 16, Parallel[j] ^ Cipher[j - 1]);
+        Chain = Cipher[AESNI_PARALLEL - 1];
+        Input += AESNI_PARALLEL * 16;
+        Output += AESNI_PARALLEL * 16;
+    }
+
+    for (; Blocks > 0; Blocks--)
+    {
+        Cipher[0] = AesNiLoad(Input);
+        AesNiStore(Output, AesNiDecryptBlock(RoundKeys, Rounds, Cipher[0]) ^ Chain);
+        Chain = Cipher[0];
+        Input += 16;
+        Output += 16;
+    }
+    AesNiStore(Iv, Chain);
+}
+
+static inline
+VOID
+AesNiStoreCounter(
+    OUT UCHAR Counter[16],
+    IN ULONGLONG High,
+    IN ULONGLONG Low)
+{
+    ULONG i;
+
+    for (i = 0; i < 8; i++)
+    {
+        Counter[7 - i] = (UCHAR)(High >> (i * 8));
+        Counter[15 - i] = (UCHAR)(Low >> (i * 8));
+    }
+}
+
+AESNI_TARGET
+VOID
+AesNiCryptCtr(IN const ULONG32 *EncryptKey, IN ULONG Rounds, IN OUT UCHAR Counter[16],
+              IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+    AESNI_BLOCK RoundKeys[AESNI_MAX_ROUNDS + 1];
+    AESNI_BLOCK Parallel[AESNI_PARALLEL];
+    ULONGLONG High = 0, Low = 0;
+    ULONG i, j;
+
+    AesNiLoadKey(EncryptKey, Rounds, RoundKeys);
+
+    for (i = 0; i < 8; i++)
+    {
+        High = (High << 8) | Counter[i];
+        Low = (Low << 8) | Counter[8 + i];
+    }
+
+    while (Blocks > 0)
+    {
+        ULONG Count = (Blocks >= AESNI_PARALLEL) ? AESNI_PARALLEL : (ULONG)Blocks;
+
+        for (j = 0; j < AESNI_PARALLEL; j++)
+        {
+            Parallel[j] = (AESNI_BLOCK){(long long)__builtin_bswap64(High),
+                                        (long long)__builtin_bswap64(Low)};
+            if (j < Count && ++Low == 0)
+                High++;
+        }
+        AesNiEncryptParallel(RoundKeys, Rounds, Parallel);
+        for (j = 0; j < Count; j++)
+            AesNiStore(Output + j * 16, AesNiLoad(Input + j * 16) ^ Parallel[j]);
+
+        Input += Count * 16;
+        Output += Count * 16;
+        Blocks -= Count;
+    }
+
+    AesNiStoreCounter(Counter, High, Low);
+}
+
+#else /* CRYPT_ACCEL_BUILTINS */
+
+/* CryptAccelGetFeatures never reports AES-NI here, so these are never called */
+
+VOID
+AesNiEncryptEcb(IN const ULONG32 *EncryptKey, IN ULONG Rounds,
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+}
+
+VOID
+AesNiDecryptEcb(IN const ULONG32 *DecryptKey, IN ULONG Rounds,
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+}
+
+VOID
+AesNiEncryptCbc(IN const ULONG32 *EncryptKey, IN ULONG Rounds, IN OUT UCHAR Iv[16],
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+}
+
+VOID
+AesNiDecryptCbc(IN const ULONG32 *DecryptKey, IN ULONG Rounds, IN OUT UCHAR Iv[16],
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+}
+
+VOID
+AesNiCryptCtr(IN const ULONG32 *EncryptKey, IN ULONG Rounds, IN OUT UCHAR Counter[16],
+              IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks)
+{
+}
+
+#endif /* CRYPT_ACCEL_BUILTINS */
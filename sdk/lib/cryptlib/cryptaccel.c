@@ -0,0 +1,87 @@
+/*
+ * PROJECT:     ReactOS Crypto Library
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Detection of the processor features used for AES and SHA
+ */
+
+#include "cryptaccel.h"
+
+#ifdef CRYPT_ACCEL_BUILTINS
+#ifdef CRYPTLIB_HOST
+#include <cpuid.h>
+#else
+#include <intrin.h>
+#endif
+#endif
+
+#define CPUID1_ECX_SSSE3    (1 << 9)
+#define CPUID1_ECX_SSE41    (1 << 19)
+#define CPUID1_ECX_AES      (1 << 25)
+#define CPUID7_EBX_SHA      (1 << 29)
+
+/* Detected features, or -1 before the first call */
+static LONG CryptAccelFeatures = -1;
+static ULONG CryptAccelMask = CRYPT_ACCEL_ALL;
+
+#ifdef CRYPT_ACCEL_BUILTINS
+static
+VOID
+CryptAccelCpuid(
+    OUT int Info[4],
+    IN int Leaf)
+{
+#ifdef CRYPTLIB_HOST
+    __cpuid_count(Leaf, 0, Info[0], Info[1], Info[2], Info[3]);
+#else
+    __cpuidex(Info, Leaf, 0);
+#endif
+}
+#endif
+
+static
+ULONG
+CryptAccelDetect(VOID)
+{
+    ULONG Features = 0;
+#ifdef CRYPT_ACCEL_BUILTINS
+    int Info[4];
+    int MaxLeaf, Ecx1;
+
+    CryptAccelCpuid(Info, 0);
+    MaxLeaf = Info[0];
+    if (MaxLeaf < 1)
+        return 0;
+
+    CryptAccelCpuid(Info, 1);
+    Ecx1 = Info[2];
+    if ((Ecx1 & (CPUID1_ECX_AES | CPUID1_ECX_SSSE3)) == (CPUID1_ECX_AES | CPUID1_ECX_SSSE3))
+        Features |= CRYPT_ACCEL_AES;
+
+    if (MaxLeaf >= 7)
+    {
+        CryptAccelCpuid(Info, 7);
+        if ((Info[1] & CPUID7_EBX_SHA) &&
+            (Ecx1 & (CPUID1_ECX_SSSE3 | CPUID1_ECX_SSE41)) == (CPUID1_ECX_SSSE3 | CPUID1_ECX_SSE41))
+        {
+            Features |= CRYPT_ACCEL_SHA;
+        }
+    }
+#endif
+    return Features;
+}
+
+ULONG
+CryptAccelGetFeatures(VOID)
+{
+    /* Racing threads detect the same value, so there is no need to lock */
+    if (CryptAccelFeatures < 0)
+        CryptAccelFeatures = (LONG)CryptAccelDetect();
+
+    return (ULONG)CryptAccelFeatures & CryptAccelMask;
+}
+
+VOID
+CryptAccelSetMask(IN ULONG Mask)
+{
+    CryptAccelMask = Mask;
+}
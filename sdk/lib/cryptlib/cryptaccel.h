@@ -0,0 +1,75 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef CRYPTLIB_HOST
+#include <typedefs.h>
+#else
+#include <ntdef.h>
+#endif
+
+/*
+ * Hardware accelerated AES and SHA block functions.
+ *
+ * The instructions are used through the compiler builtins, so only GCC and
+ * Clang builds on x86 and x64 get them; everywhere else CryptAccelGetFeatures
+ * returns 0 and the callers keep to the portable code.
+ *
+ * These functions use the XMM registers. Kernel mode callers would have to
+ * save the extended processor state around them, so for now only user mode
+ * code calls them.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define CRYPT_ACCEL_BUILTINS
+#endif
+
+#define CRYPT_ACCEL_AES     0x00000001  /* AES-NI and SSSE3 */
+#define CRYPT_ACCEL_SHA     0x00000002  /* SHA extensions and SSE4.1 */
+#define CRYPT_ACCEL_ALL     0xFFFFFFFF
+
+ULONG
+CryptAccelGetFeatures(VOID);
+
+/* Restricts the features that are used, for the tests and benchmarks */
+VOID
+CryptAccelSetMask(IN ULONG Mask);
+
+/*
+ * The key schedules are the ones of the LibTomCrypt aes_setup: Rounds + 1
+ * round keys of four big endian words, the decryption one being the
+ * equivalent inverse cipher schedule.
+ */
+VOID
+AesNiEncryptEcb(IN const ULONG32 *EncryptKey, IN ULONG Rounds,
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks);
+
+VOID
+AesNiDecryptEcb(IN const ULONG32 *DecryptKey, IN ULONG Rounds,
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks);
+
+VOID
+AesNiEncryptCbc(IN const ULONG32 *EncryptKey, IN ULONG Rounds, IN OUT UCHAR Iv[16],
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks);
+
+VOID
+AesNiDecryptCbc(IN const ULONG32 *DecryptKey, IN ULONG Rounds, IN OUT UCHAR Iv[16],
+                IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks);
+
+/* The counter is a 128-bit big endian number, incremented once per block */
+VOID
+AesNiCryptCtr(IN const ULONG32 *EncryptKey, IN ULONG Rounds, IN OUT UCHAR Counter[16],
+              IN const UCHAR *Input, OUT UCHAR *Output, IN SIZE_T Blocks);
+
+/* The states are the usual host order words, the data whole 64-byte blocks */
+VOID
+ShaNiSha1Transform(IN OUT ULONG State[5], IN const UCHAR *Data, IN SIZE_T Blocks);
+
+VOID
+ShaNiSha256Transform(IN OUT ULONG State[8], IN const UCHAR *Data, IN SIZE_T Blocks);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,8 @@
  */
 
 #include "sha1.h"
+#include "cryptaccel.h"
+#include <string.h>
 
 /* SHA1 Helper Macros */
 
@@ -44,6 +46,12 @@ static void SHA1Transform(ULONG State[5], UCHAR Buffer[64])
    ULONG a, b, c, d, e;
    ULONG *Block;
 
+   if (CryptAccelGetFeatures() & CRYPT_ACCEL_SHA)
+   {
+      ShaNiSha1Transform(State, Buffer, 1);
+      return;
+   }
+
    Block = (ULONG*)Buffer;
 
    /* Copy Context->State[] to working variables */
@@ -144,6 +152,14 @@ A_SHAUpdate(PSHA_CTX Context, const unsigned char *Buffer, ULONG BufferSize)
    {
       while (BufferContentSize + BufferSize >= 64)
       {
+         /* The SHA extensions read whole blocks straight from the input */
+         if (BufferContentSize == 0 && (CryptAccelGetFeatures() & CRYPT_ACCEL_SHA))
+         {
+            ShaNiSha1Transform(Context->State, Buffer, BufferSize / 64);
+            Buffer += BufferSize & ~63;
+            BufferSize &= 63;
+            break;
+         }
          memcpy(Context->Buffer + BufferContentSize, Buffer,
                        64 - BufferContentSize);
          Buffer += 64 - BufferContentSize;
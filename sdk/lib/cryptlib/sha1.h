@@ -6,7 +6,11 @@ extern "C" {
 #endif
 
 
+#ifdef CRYPTLIB_HOST
+#include <typedefs.h>
+#else
 #include <ntdef.h>
+#endif
 
 /* SHA Context Structure Declaration */
 typedef struct
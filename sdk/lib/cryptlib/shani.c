@@ -0,0 +1,277 @@
+/*
+ * PROJECT:     ReactOS Crypto Library
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     SHA-1 and SHA-256 block transforms on top of the SHA extensions
+ */
+
+#include "cryptaccel.h"
+#include <string.h>
+
+#ifdef CRYPT_ACCEL_BUILTINS
+
+#define SHANI_TARGET        __attribute__((target("sha,sse4.1,ssse3")))
+
+typedef unsigned int SHANI_WORDS __attribute__((vector_size(16)));
+typedef int SHANI_V4SI __attribute__((vector_size(16)));
+typedef char SHANI_BYTES __attribute__((vector_size(16)));
+
+/* Reverses the bytes of each word, resp. of the whole block */
+static const SHANI_BYTES ShaNiSwapWords = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+static const SHANI_BYTES ShaNiSwapBlock = {15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+
+static const SHANI_WORDS ShaNiK256[16] =
+{
+    {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5},
+    {0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5},
+    {0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3},
+    {0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174},
+    {0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc},
+    {0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da},
+    {0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7},
+    {0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967},
+    {0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13},
+    {0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85},
+    {0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3},
+    {0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070},
+    {0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5},
+    {0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3},
+    {0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208},
+    {0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2}
+};
+
+#define ShaNiLoad(Data, Swap) \
+    (SHANI_WORDS)__builtin_ia32_pshufb128((SHANI_BYTES)ShaNiLoadBlock(Data), (Swap))
+
+#define Sha1Rnds4(Abcd, E, Function) \
+    (SHANI_WORDS)__builtin_ia32_sha1rnds4((SHANI_V4SI)(Abcd), (SHANI_V4SI)(E), (Function))
+#define Sha1Nexte(E, Msg) \
+    (SHANI_WORDS)__builtin_ia32_sha1nexte((SHANI_V4SI)(E), (SHANI_V4SI)(Msg))
+#define Sha1Msg1(Msg, Next) \
+    (SHANI_WORDS)__builtin_ia32_sha1msg1((SHANI_V4SI)(Msg), (SHANI_V4SI)(Next))
+#define Sha1Msg2(Msg, Next) \
+    (SHANI_WORDS)__builtin_ia32_sha1msg2((SHANI_V4SI)(Msg), (SHANI_V4SI)(Next))
+
+#define Sha256Rnds2(Cdgh, Abef, Msg) \
+    (SHANI_WORDS)__builtin_ia32_sha256rnds2((SHANI_V4SI)(Cdgh), (SHANI_V4SI)(Abef), (SHANI_V4SI)(Msg))
+#define Sha256Msg1(Msg, Next) \
+    (SHANI_WORDS)__builtin_ia32_sha256msg1((SHANI_V4SI)(Msg), (SHANI_V4SI)(Next))
+#define Sha256Msg2(Msg, Next) \
+    (SHANI_WORDS)__builtin_ia32_sha256msg2((SHANI_V4SI)(Msg), (SHANI_V4SI)(Next))
+
+static inline
+SHANI_WORDS
+ShaNiLoadBlock(IN const UCHAR *Data)
+{
+    SHANI_WORDS Words;
+
+    memcpy(&Words, Data, sizeof(Words));
+    return Words;
+}
+
+/*
+ * Four rounds per step. The message words of step n + 1 are completed
+ * while step n runs: sha1msg1 and the XOR prepare the words three and two
+ * steps ahead, sha1msg2 finishes the next ones.
+ */
+#define SHA1_ROUNDS(E, NextE, Msg, Function) \
+    E = Sha1Nexte(E, Msg); \
+    NextE = Abcd; \
+    Abcd = Sha1Rnds4(Abcd, E, Function)
+
+#define SHA1_SCHEDULE(Prev2, Prev1, Msg, Next) \
+    Next = Sha1Msg2(Next, Msg); \
+    Prev1 = Sha1Msg1(Prev1, Msg); \
+    Prev2 ^= Msg
+
+SHANI_TARGET
+VOID
+ShaNiSha1Transform(IN OUT ULONG State[5], IN const UCHAR *Data, IN SIZE_T Blocks)
+{
+    SHANI_WORDS Abcd, E0, E1, SavedAbcd, SavedE;
+    SHANI_WORDS Msg0, Msg1, Msg2, Msg3;
+
+    Abcd = (SHANI_WORDS){State[3], State[2], State[1], State[0]};
+    E0 = (SHANI_WORDS){0, 0, 0, State[4]};
+
+    for (; Blocks > 0; Blocks--, Data += 64)
+    {
+        SavedAbcd = Abcd;
+        SavedE = E0;
+
+        /* Rounds 0-15 */
+        Msg0 = ShaNiLoad(Data, ShaNiSwapBlock);
+        E0 += Msg0;
+        E1 = Abcd;
+        Abcd = Sha1Rnds4(Abcd, E0, 0);
+
+        Msg1 = ShaNiLoad(Data + 16, ShaNiSwapBlock);
+        SHA1_ROUNDS(E1, E0, Msg1, 0);
+        Msg0 = Sha1Msg1(Msg0, Msg1);
+
+        Msg2 = ShaNiLoad(Data + 32, ShaNiSwapBlock);
+        SHA1_ROUNDS(E0, E1, Msg2, 0);
+        Msg1 = Sha1Msg1(Msg1, Msg2);
+        Msg0 ^= Msg2;
+
+        Msg3 = ShaNiLoad(Data + 48, ShaNiSwapBlock);
+        SHA1_ROUNDS(E1, E0, Msg3, 0);
+        SHA1_SCHEDULE(Msg1, Msg2, Msg3, Msg0);
+
+        /* Rounds 16-63 */
+        SHA1_ROUNDS(E0, E1, Msg0, 0);
+        SHA1_SCHEDULE(Msg2, Msg3, Msg0, Msg1);
+        SHA1_ROUNDS(E1, E0, Msg1, 1);
+        SHA1_SCHEDULE(Msg3, Msg0, Msg1, Msg2);
+        SHA1_ROUNDS(E0, E1, Msg2, 1);
+        SHA1_SCHEDULE(Msg0, Msg1, Msg2, Msg3);
+        SHA1_ROUNDS(E1, E0, Msg3, 1);
+        SHA1_SCHEDULE(Msg1, Msg2, Msg3, Msg0);
+        SHA1_ROUNDS(E0, E1, Msg0, 1);
+        SHA1_SCHEDULE(Msg2, Msg3, Msg0, Msg1);
+        SHA1_ROUNDS(E1, E0, Msg1, 1);
+        SHA1_SCHEDULE(Msg3, Msg0, Msg1, Msg2);
+        SHA1_ROUNDS(E0, E1, Msg2, 2);
+        SHA1_SCHEDULE(Msg0, Msg1, Msg2, Msg3);
+        SHA1_ROUNDS(E1, E0, Msg3, 2);
+        SHA1_SCHEDULE(Msg1, Msg2, Msg3, Msg0);
+        SHA1_ROUNDS(E0, E1, Msg0, 2);
+        SHA1_SCHEDULE(Msg2, Msg3, Msg0, Msg1);
+        SHA1_ROUNDS(E1, E0, Msg1, 2);
+        SHA1_SCHEDULE(Msg3, Msg0, Msg1, Msg2);
+        SHA1_ROUNDS(E0, E1, Msg2, 2);
+        SHA1_SCHEDULE(Msg0, Msg1, Msg2, Msg3);
+        SHA1_ROUNDS(E1, E0, Msg3, 3);
+        SHA1_SCHEDULE(Msg1, Msg2, Msg3, Msg0);
+
+        /* Rounds 64-79, only the last words are left to compute */
+        SHA1_ROUNDS(E0, E1, Msg0, 3);
+        SHA1_SCHEDULE(Msg2, Msg3, Msg0, Msg1);
+        SHA1_ROUNDS(E1, E0, Msg1, 3);
+        Msg2 = Sha1Msg2(Msg2, Msg1);
+        Msg3 ^= Msg1;
+        SHA1_ROUNDS(E0, E1, Msg2, 3);
+        Msg3 = Sha1Msg2(Msg3, Msg2);
+        SHA1_ROUNDS(E1, E0, Msg3, 3);
+
+        /* E is the rotated A of four rounds ago, sha1nexte derives it */
+        E0 = Sha1Nexte(E0, SavedE);
+        Abcd += SavedAbcd;
+    }
+
+    State[0] = Abcd[3];
+    State[1] = Abcd[2];
+    State[2] = Abcd[1];
+    State[3] = Abcd[0];
+    State[4] = E0[3];
+}
+
+/* Four rounds, two per sha256rnds2, each of which takes the low half of Msg */
+#define SHA256_ROUNDS(Step, Msg) \
+    Tmp = (Msg) + ShaNiK256[Step]; \
+    Cdgh = Sha256Rnds2(Cdgh, Abef, Tmp); \
+    Tmp = (SHANI_WORDS){Tmp[2], Tmp[3], 0, 0}; \
+    Abef = Sha256Rnds2(Abef, Cdgh, Tmp)
+
+/* Completes the message words of the next step, Next was prepared by sha256msg1 */
+#define SHA256_SCHEDULE(Prev, Msg, Next) \
+    Next += (SHANI_WORDS){Prev[1], Prev[2], Prev[3], Msg[0]}; \
+    Next = Sha256Msg2(Next, Msg)
+
+SHANI_TARGET
+VOID
+ShaNiSha256Transform(IN OUT ULONG State[8], IN const UCHAR *Data, IN SIZE_T Blocks)
+{
+    SHANI_WORDS Abef, Cdgh, SavedAbef, SavedCdgh, Tmp;
+    SHANI_WORDS Msg0, Msg1, Msg2, Msg3;
+
+    /* The instructions keep the state as the ABEF and CDGH halves */
+    Abef = (SHANI_WORDS){State[5], State[4], State[1], State[0]};
+    Cdgh = (SHANI_WORDS){State[7], State[6], State[3], State[2]};
+
+    for (; Blocks > 0; Blocks--, Data += 64)
+    {
+        SavedAbef = Abef;
+        SavedCdgh = Cdgh;
+
+        /* Rounds 0-15 */
+        Msg0 = ShaNiLoad(Data, ShaNiSwapWords);
+        SHA256_ROUNDS(0, Msg0);
+
+        Msg1 = ShaNiLoad(Data + 16, ShaNiSwapWords);
+        SHA256_ROUNDS(1, Msg1);
+        Msg0 = Sha256Msg1(Msg0, Msg1);
+
+        Msg2 = ShaNiLoad(Data + 32, ShaNiSwapWords);
+        SHA256_ROUNDS(2, Msg2);
+        Msg1 = Sha256Msg1(Msg1, Msg2);
+
+        Msg3 = ShaNiLoad(Data + 48, ShaNiSwapWords);
+        SHA256_ROUNDS(3, Msg3);
+        SHA256_SCHEDULE(Msg2, Msg3, Msg0);
+        Msg2 = Sha256Msg1(Msg2, Msg3);
+
+        /* Rounds 16-51 */
+        SHA256_ROUNDS(4, Msg0);
+        SHA256_SCHEDULE(Msg3, Msg0, Msg1);
+        Msg3 = Sha256Msg1(Msg3, Msg0);
+        SHA256_ROUNDS(5, Msg1);
+        SHA256_SCHEDULE(Msg0, Msg1, Msg2);
+        Msg0 = Sha256Msg1(Msg0, Msg1);
+        SHA256_ROUNDS(6, Msg2);
+        SHA256_SCHEDULE(Msg1, Msg2, Msg3);
+        Msg1 = Sha256Msg1(Msg1, Msg2);
+        SHA256_ROUNDS(7, Msg3);
+        SHA256_SCHEDULE(Msg2, Msg3, Msg0);
+        Msg2 = Sha256Msg1(Msg2, Msg3);
+        SHA256_ROUNDS(8, Msg0);
+        SHA256_SCHEDULE(Msg3, Msg0, Msg1);
+        Msg3 = Sha256Msg1(Msg3, Msg0);
+        SHA256_ROUNDS(9, Msg1);
+        SHA256_SCHEDULE(Msg0, Msg1, Msg2);
+        Msg0 = Sha256Msg1(Msg0, Msg1);
+        SHA256_ROUNDS(10, Msg2);
+        SHA256_SCHEDULE(Msg1, Msg2, Msg3);
+        Msg1 = Sha256Msg1(Msg1, Msg2);
+        SHA256_ROUNDS(11, Msg3);
+        SHA256_SCHEDULE(Msg2, Msg3, Msg0);
+        Msg2 = Sha256Msg1(Msg2, Msg3);
+        SHA256_ROUNDS(12, Msg0);
+        SHA256_SCHEDULE(Msg3, Msg0, Msg1);
+        Msg3 = Sha256Msg1(Msg3, Msg0);
+
+        /* Rounds 52-63 */
+        SHA256_ROUNDS(13, Msg1);
+        SHA256_SCHEDULE(Msg0, Msg1, Msg2);
+        SHA256_ROUNDS(14, Msg2);
+        SHA256_SCHEDULE(Msg1, Msg2, Msg3);
+        SHA256_ROUNDS(15, Msg3);
+
+        Abef += SavedAbef;
+        Cdgh += SavedCdgh;
+    }
+
+    State[0] = Abef[3];
+    State[1] = Abef[2];
+    State[2] = Cdgh[3];
+    State[3] = Cdgh[2];
+    State[4] = Abef[1];
+    State[5] = Abef[0];
+    State[6] = Cdgh[1];
+    State[7] = Cdgh[0];
+}
+
+#else /* CRYPT_ACCEL_BUILTINS */
+
+/* CryptAccelGetFeatures never reports the SHA extensions here */
+
+VOID
+ShaNiSha1Transform(IN OUT ULONG State[5], IN const UCHAR *Data, IN SIZE_T Blocks)
+{
+}
+
+VOID
+ShaNiSha256Transform(IN OUT ULONG State[8], IN const UCHAR *Data, IN SIZE_T Blocks)
+{
+}
+
+#endif /* CRYPT_ACCEL_BUILTINS */
@@ -36,7 +36,11 @@
 #include <string.h>
 #include <stdlib.h>
 //#include <limits.h>
+#ifdef CRYPTLIB_HOST
+#include <typedefs.h>
+#else
 #include <basetsd.h>
+#endif
 
 /* error codes [will be expanded in future releases] */
 enum {
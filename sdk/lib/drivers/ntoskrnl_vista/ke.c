@@ -53,5 +53,36 @@ KeSetCoalescableTimer(
     _In_ ULONG TolerableDelay,
     _In_opt_ PKDPC Dpc)
 {
+    ULONGLONG Tolerance, Granularity, Target;
+    LONGLONG InterruptTime;
+
+    /*
+     * Move the due time to the coarsest multiple of the clock tick that the
+     * tolerable delay allows, so that timers with close deadlines share the
+     * same due time and expire together.
+     */
+    Granularity = KeQueryTimeIncrement();
+    Tolerance = (ULONGLONG)TolerableDelay * 10000;
+    if (Granularity && Tolerance >= Granularity)
+    {
+        while (Granularity * 2 <= Tolerance)
+            Granularity *= 2;
+
+        if (DueTime.QuadPart < 0)
+        {
+            /* Relative: align the interrupt time at which it expires */
+            InterruptTime = KeQueryInterruptTime();
+            Target = InterruptTime - DueTime.QuadPart;
+            Target = (Target + Granularity - 1) / Granularity * Granularity;
+            DueTime.QuadPart = InterruptTime - (LONGLONG)Target;
+        }
+        else
+        {
+            /* Absolute: align the system time */
+            Target = (ULONGLONG)DueTime.QuadPart;
+            DueTime.QuadPart = (LONGLONG)((Target + Granularity - 1) / Granularity * Granularity);
+        }
+    }
+
     return KeSetTimerEx(Timer, DueTime, Period, Dpc);
 }
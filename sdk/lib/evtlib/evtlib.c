@@ -33,6 +33,51 @@ static const EVENTLOGEOF EOFRecord =
 
 /* HELPER FUNCTIONS **********************************************************/
 
+#ifdef EVTLIB_HOST
+
+VOID NTAPI
+RtlCopyUnicodeString(
+    IN OUT PUNICODE_STRING DestinationString,
+    IN PCUNICODE_STRING SourceString)
+{
+    USHORT Length;
+
+    Length = min(SourceString->Length, DestinationString->MaximumLength);
+    RtlCopyMemory(DestinationString->Buffer, SourceString->Buffer, Length);
+    DestinationString->Length = Length;
+}
+
+SIZE_T NTAPI
+RtlCompareMemory(
+    IN const VOID *Source1,
+    IN const VOID *Source2,
+    IN SIZE_T Length)
+{
+    SIZE_T i;
+
+    for (i = 0; i < Length; i++)
+    {
+        if (((const UCHAR*)Source1)[i] != ((const UCHAR*)Source2)[i])
+            break;
+    }
+    return i;
+}
+
+VOID NTAPI
+RtlFillMemoryUlong(
+    OUT PVOID Destination,
+    IN SIZE_T Length,
+    IN ULONG Fill)
+{
+    PULONG Dest = Destination;
+    SIZE_T Count = Length / sizeof(ULONG);
+
+    while (Count--)
+        *Dest++ = Fill;
+}
+
+#endif /* EVTLIB_HOST */
+
 static NTSTATUS
 ReadLogBuffer(
     IN  PEVTLOGFILE LogFile,
@@ -192,37 +237,73 @@ WriteLogBuffer(
 }
 
 
+/*
+ * The offset information is a ring of OffsetInfoCount entries starting at
+ * OffsetInfoFirst, in increasing record number order. Records are added at
+ * the end and discarded from the beginning, and as their numbers are normally
+ * consecutive, the entry of a record is found directly from its number.
+ */
+#define OFFSET_INFO_INITIAL_SIZE    64
+
+#define ElfpOffsetInfoEntry(LogFile, Index) \
+    (&(LogFile)->OffsetInfo[((LogFile)->OffsetInfoFirst + (Index)) & ((LogFile)->OffsetInfoSize - 1)])
+
+static VOID
+ElfpResetOffsetInformation(
+    IN PEVTLOGFILE LogFile)
+{
+    LogFile->OffsetInfoFirst = 0;
+    LogFile->OffsetInfoCount = 0;
+    LogFile->OffsetInfoSparse = FALSE;
+}
+
 /* Returns 0 if nothing is found */
 static ULONG
 ElfpOffsetByNumber(
     IN PEVTLOGFILE LogFile,
     IN ULONG RecordNumber)
 {
-    UINT i;
+    PEVENT_OFFSET_INFO OffsetInfo;
+    ULONG Index;
+
+    if (LogFile->OffsetInfoCount == 0)
+        return 0;
 
-    for (i = 0; i < LogFile->OffsetInfoNext; i++)
+    /* Record numbers below the first one wrap to a large index */
+    Index = RecordNumber - ElfpOffsetInfoEntry(LogFile, 0)->EventNumber;
+    if (!LogFile->OffsetInfoSparse)
     {
-        if (LogFile->OffsetInfo[i].EventNumber == RecordNumber)
-            return LogFile->OffsetInfo[i].EventOffset;
+        if (Index >= LogFile->OffsetInfoCount)
+            return 0;
+
+        OffsetInfo = ElfpOffsetInfoEntry(LogFile, Index);
+        ASSERT(OffsetInfo->EventNumber == RecordNumber);
+        return OffsetInfo->EventOffset;
+    }
+
+    /* The log has holes in its record numbers, search for the record */
+    for (Index = 0; Index < LogFile->OffsetInfoCount; Index++)
+    {
+        OffsetInfo = ElfpOffsetInfoEntry(LogFile, Index);
+        if (OffsetInfo->EventNumber == RecordNumber)
+            return OffsetInfo->EventOffset;
     }
     return 0;
 }
 
-#define OFFSET_INFO_INCREMENT   64
-
 static BOOL
 ElfpAddOffsetInformation(
     IN PEVTLOGFILE LogFile,
     IN ULONG ulNumber,
     IN ULONG ulOffset)
 {
-    PVOID NewOffsetInfo;
+    PEVENT_OFFSET_INFO NewOffsetInfo, OffsetInfo;
+    ULONG FirstPart;
 
-    if (LogFile->OffsetInfoNext == LogFile->OffsetInfoSize)
+    if (LogFile->OffsetInfoCount == LogFile->OffsetInfoSize)
     {
-        /* Allocate a new offset table */
-        NewOffsetInfo = LogFile->Allocate((LogFile->OffsetInfoSize + OFFSET_INFO_INCREMENT) *
-                                              sizeof(EVENT_OFFSET_INFO),
+        /* Allocate a new offset table, twice as large */
+        NewOffsetInfo = LogFile->Allocate(LogFile->OffsetInfoSize * 2 * sizeof(EVENT_OFFSET_INFO),
                                           HEAP_ZERO_MEMORY,
                                           TAG_ELF);
         if (!NewOffsetInfo)
@@ -231,22 +312,33 @@ ElfpAddOffsetInformation(
             return FALSE;
         }
 
+        /* Copy the entries from the old ring to the start of the new one */
+        FirstPart = LogFile->OffsetInfoSize - LogFile->OffsetInfoFirst;
+        RtlCopyMemory(NewOffsetInfo,
+                      &LogFile->OffsetInfo[LogFile->OffsetInfoFirst],
+                      FirstPart * sizeof(EVENT_OFFSET_INFO));
+        RtlCopyMemory(&NewOffsetInfo[FirstPart],
+                      LogFile->OffsetInfo,
+                      LogFile->OffsetInfoFirst * sizeof(EVENT_OFFSET_INFO));
+
         /* Free the old offset table and use the new one */
-        if (LogFile->OffsetInfo)
-        {
-            /* Copy the handles from the old table to the new one */
-            RtlCopyMemory(NewOffsetInfo,
-                          LogFile->OffsetInfo,
-                          LogFile->OffsetInfoSize * sizeof(EVENT_OFFSET_INFO));
-            LogFile->Free(LogFile->OffsetInfo, 0, TAG_ELF);
-        }
-        LogFile->OffsetInfo = (PEVENT_OFFSET_INFO)NewOffsetInfo;
-        LogFile->OffsetInfoSize += OFFSET_INFO_INCREMENT;
+        LogFile->Free(LogFile->OffsetInfo, 0, TAG_ELF);
+        LogFile->OffsetInfo = NewOffsetInfo;
+        LogFile->OffsetInfoSize *= 2;
+        LogFile->OffsetInfoFirst = 0;
+    }
+
+    /* Remember whether the record numbers stop being consecutive */
+    if (LogFile->OffsetInfoCount != 0 &&
+        ElfpOffsetInfoEntry(LogFile, LogFile->OffsetInfoCount - 1)->EventNumber + 1 != ulNumber)
+    {
+        LogFile->OffsetInfoSparse = TRUE;
     }
 
-    LogFile->OffsetInfo[LogFile->OffsetInfoNext].EventNumber = ulNumber;
-    LogFile->OffsetInfo[LogFile->OffsetInfoNext].EventOffset = ulOffset;
-    LogFile->OffsetInfoNext++;
+    OffsetInfo = ElfpOffsetInfoEntry(LogFile, LogFile->OffsetInfoCount);
+    OffsetInfo->EventNumber = ulNumber;
+    OffsetInfo->EventOffset = ulOffset;
+    LogFile->OffsetInfoCount++;
 
     return TRUE;
 }
@@ -257,8 +349,6 @@ ElfpDeleteOffsetInformation(
     IN ULONG ulNumberMin,
     IN ULONG ulNumberMax)
 {
-    UINT i;
-
     if (ulNumberMin > ulNumberMax)
         return FALSE;
 
@@ -270,25 +360,22 @@ ElfpDeleteOffsetInformation(
          * to keep the list without holes, we demand that ulNumberMin is the first
          * element in the list.
          */
-        if (ulNumberMin != LogFile->OffsetInfo[0].EventNumber)
-            return FALSE;
-
-        /*
-         * RtlMoveMemory(&LogFile->OffsetInfo[0],
-         *               &LogFile->OffsetInfo[1],
-         *               sizeof(EVENT_OFFSET_INFO) * (LogFile->OffsetInfoNext - 1));
-         */
-        for (i = 0; i < LogFile->OffsetInfoNext - 1; i++)
+        if (LogFile->OffsetInfoCount == 0 ||
+            ulNumberMin != ElfpOffsetInfoEntry(LogFile, 0)->EventNumber)
         {
-            LogFile->OffsetInfo[i].EventNumber = LogFile->OffsetInfo[i + 1].EventNumber;
-            LogFile->OffsetInfo[i].EventOffset = LogFile->OffsetInfo[i + 1].EventOffset;
+            return FALSE;
         }
-        LogFile->OffsetInfoNext--;
+
+        LogFile->OffsetInfoFirst = (LogFile->OffsetInfoFirst + 1) & (LogFile->OffsetInfoSize - 1);
+        LogFile->OffsetInfoCount--;
 
         /* Go to the next offset information */
         ulNumberMin++;
     }
 
+    if (LogFile->OffsetInfoCount == 0)
+        ElfpResetOffsetInformation(LogFile);
+
     return TRUE;
 }
 
@@ -305,6 +392,9 @@ ElfpInitNewFile(
     SIZE_T WrittenLength;
     EVENTLOGEOF EofRec;
 
+    /* The new log does not contain any record */
+    ElfpResetOffsetInformation(LogFile);
+
     /* Initialize the event log header */
     RtlZeroMemory(&LogFile->Header, sizeof(EVENTLOGHEADER));
 
@@ -920,7 +1010,7 @@ ElfCreateFile(
         }
     }
 
-    LogFile->OffsetInfo = LogFile->Allocate(OFFSET_INFO_INCREMENT * sizeof(EVENT_OFFSET_INFO),
+    LogFile->OffsetInfo = LogFile->Allocate(OFFSET_INFO_INITIAL_SIZE * sizeof(EVENT_OFFSET_INFO),
                                             HEAP_ZERO_MEMORY,
                                             TAG_ELF);
     if (LogFile->OffsetInfo == NULL)
@@ -929,8 +1019,8 @@ ElfCreateFile(
         Status = STATUS_NO_MEMORY;
         goto Quit;
     }
-    LogFile->OffsetInfoSize = OFFSET_INFO_INCREMENT;
-    LogFile->OffsetInfoNext = 0;
+    LogFile->OffsetInfoSize = OFFSET_INFO_INITIAL_SIZE;
+    ElfpResetOffsetInformation(LogFile);
 
     // FIXME: Always use the regitry values for MaxSize,
     // even for existing logs!
@@ -1205,7 +1295,7 @@ ElfReadRecord(
     NTSTATUS Status;
     LARGE_INTEGER FileOffset;
     ULONG RecOffset;
-    SIZE_T RecSize;
+    ULONG RecSize;
     SIZE_T ReadLength;
 
     ASSERT(LogFile);
@@ -1264,6 +1354,121 @@ ElfReadRecord(
     return Status;
 }
 
+/*
+ * Reads as many consecutive event records as fit in the buffer, starting
+ * at RecordNumber and going forwards. Records stored contiguously in the
+ * file are read at once; the read stops before a record that wraps around
+ * the end of the log, which a following call starts with.
+ */
+NTSTATUS
+NTAPI
+ElfReadRecords(
+    IN  PEVTLOGFILE LogFile,
+    IN  ULONG RecordNumber,
+    OUT PEVENTLOGRECORD Records,
+    IN  SIZE_T  BufSize, // Length
+    OUT PSIZE_T BytesRead OPTIONAL,
+    OUT PSIZE_T BytesNeeded OPTIONAL,
+    OUT PULONG  RecordsRead OPTIONAL)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER FileOffset;
+    PEVENTLOGRECORD Record;
+    ULONG StartOffset, RecOffset, NextOffset;
+    ULONG RecordCount, i;
+    SIZE_T Length, ReadLength;
+
+    ASSERT(LogFile);
+
+    if (RecordsRead)
+        *RecordsRead = 0;
+
+    /* Retrieve the offset of the first event record */
+    StartOffset = ElfpOffsetByNumber(LogFile, RecordNumber);
+    if (StartOffset == 0)
+        return STATUS_NOT_FOUND;
+
+    /*
+     * Find the records that follow each other in the file and fit in the
+     * buffer; each one ends where the next one, or the EOF record, starts.
+     */
+    RecOffset = StartOffset;
+    for (RecordCount = 0; ; RecordCount++)
+    {
+        if (RecordNumber + RecordCount + 1 == LogFile->Header.CurrentRecordNumber)
+            NextOffset = LogFile->Header.EndOffset;
+        else
+            NextOffset = ElfpOffsetByNumber(LogFile, RecordNumber + RecordCount + 1);
+
+        if (NextOffset <= RecOffset || NextOffset - StartOffset > BufSize)
+            break;
+
+        RecOffset = NextOffset;
+    }
+
+    /* Let the single record path deal with wrapping and small buffers */
+    if (RecordCount == 0)
+    {
+        Status = ElfReadRecord(LogFile,
+                               RecordNumber,
+                               Records,
+                               BufSize,
+                               BytesRead,
+                               BytesNeeded);
+        if (NT_SUCCESS(Status) && RecordsRead)
+            *RecordsRead = 1;
+        return Status;
+    }
+
+    if (BytesNeeded)
+        *BytesNeeded = 0;
+
+    FileOffset.QuadPart = StartOffset;
+    Length = RecOffset - StartOffset;
+    Status = LogFile->FileRead(LogFile,
+                               &FileOffset,
+                               Records,
+                               Length,
+                               &ReadLength);
+    if (!NT_SUCCESS(Status))
+    {
+        EVTLTRACE1("FileRead() failed (Status 0x%08lx)\n", Status);
+        if (BytesRead)
+            *BytesRead = 0;
+        return Status;
+    }
+
+    /* Only return the records that are complete and consistent */
+    Length = 0;
+    for (i = 0; i < RecordCount; i++)
+    {
+        Record = (PEVENTLOGRECORD)((ULONG_PTR)Records + Length);
+        if (ReadLength - Length < sizeof(EVENTLOGRECORD) ||
+            Record->Reserved != LOGFILE_SIGNATURE ||
+            Record->Length < sizeof(EVENTLOGRECORD) ||
+            Record->Length > ReadLength - Length)
+        {
+            break;
+        }
+        Length += Record->Length;
+    }
+
+    if (i == 0)
+    {
+        EVTLTRACE1("Record %lu is corrupted\n", RecordNumber);
+        if (BytesRead)
+            *BytesRead = 0;
+        return STATUS_EVENTLOG_FILE_CORRUPT;
+    }
+
+    if (BytesRead)
+        *BytesRead = Length;
+    if (RecordsRead)
+        *RecordsRead = i;
+
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS
 NTAPI
 ElfWriteRecord(
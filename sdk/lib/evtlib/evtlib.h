@@ -18,6 +18,52 @@
 extern "C" {
 #endif
 
+#ifdef EVTLIB_HOST
+    #include <typedefs.h>
+    #include <stdio.h>
+    #include <string.h>
+
+    /* C_ASSERT Definition */
+    #define C_ASSERT(expr) extern char (*c_assert(void)) [(expr) ? 1 : -1]
+
+    // Definitions copied from <ntstatus.h> and <winnt.h>
+    // We only want to include host headers, so we define them manually
+    #define STATUS_SUCCESS                   ((NTSTATUS)0x00000000)
+    #define STATUS_BUFFER_TOO_SMALL          ((NTSTATUS)0xC0000023)
+    #define STATUS_ACCESS_DENIED             ((NTSTATUS)0xC0000022)
+    #define STATUS_INVALID_PARAMETER         ((NTSTATUS)0xC000000D)
+    #define STATUS_NO_MEMORY                 ((NTSTATUS)0xC0000017)
+    #define STATUS_END_OF_FILE               ((NTSTATUS)0xC0000011)
+    #define STATUS_NOT_FOUND                 ((NTSTATUS)0xC0000225)
+    #define STATUS_LOG_FILE_FULL             ((NTSTATUS)0xC0000188)
+    #define STATUS_EVENTLOG_FILE_CORRUPT     ((NTSTATUS)0xC0000189)
+
+    #define HEAP_ZERO_MEMORY                 0x00000008
+
+    #ifndef min
+    #define min(a, b)  (((a) < (b)) ? (a) : (b))
+    #endif
+
+    #define RtlInitEmptyUnicodeString(UnicodeString, Buf, Size) \
+        ((UnicodeString)->Buffer = (Buf), (UnicodeString)->MaximumLength = (Size), (UnicodeString)->Length = 0)
+
+    VOID NTAPI
+    RtlCopyUnicodeString(
+        IN OUT PUNICODE_STRING DestinationString,
+        IN PCUNICODE_STRING SourceString);
+
+    SIZE_T NTAPI
+    RtlCompareMemory(
+        IN const VOID *Source1,
+        IN const VOID *Source2,
+        IN SIZE_T Length);
+
+    VOID NTAPI
+    RtlFillMemoryUlong(
+        OUT PVOID Destination,
+        IN SIZE_T Length,
+        IN ULONG Fill);
+#else
 /* PSDK/NDK Headers */
 // #define WIN32_NO_STATUS
 // #include <windef.h>
@@ -26,6 +72,7 @@ extern "C" {
 
 #define NTOS_MODE_USER
 #include <ndk/rtlfuncs.h>
+#endif
 
 #ifndef ROUND_DOWN
 #define ROUND_DOWN(n, align) (((ULONG)n) & ~((align) - 1l))
@@ -211,9 +258,11 @@ typedef struct _EVTLOGFILE
     EVENTLOGHEADER Header;
     ULONG CurrentSize;  /* Equivalent to the file size, is <= MaxSize and can be extended to MaxSize if needed */
     UNICODE_STRING FileName;
-    PEVENT_OFFSET_INFO OffsetInfo;
+    PEVENT_OFFSET_INFO OffsetInfo;  /* Ring of record offsets, OffsetInfoSize is a power of 2 */
     ULONG OffsetInfoSize;
-    ULONG OffsetInfoNext;
+    ULONG OffsetInfoFirst;
+    ULONG OffsetInfoCount;
+    BOOLEAN OffsetInfoSparse;       /* The record numbers are not all consecutive */
     BOOLEAN ReadOnly;
 } EVTLOGFILE, *PEVTLOGFILE;
 
@@ -269,6 +318,17 @@ ElfReadRecord(
     OUT PSIZE_T BytesRead OPTIONAL,
     OUT PSIZE_T BytesNeeded OPTIONAL);
 
+NTSTATUS
+NTAPI
+ElfReadRecords(
+    IN  PEVTLOGFILE LogFile,
+    IN  ULONG RecordNumber,
+    OUT PEVENTLOGRECORD Records,
+    IN  SIZE_T  BufSize, // Length
+    OUT PSIZE_T BytesRead OPTIONAL,
+    OUT PSIZE_T BytesNeeded OPTIONAL,
+    OUT PULONG  RecordsRead OPTIONAL);
+
 NTSTATUS
 NTAPI
 ElfWriteRecord(
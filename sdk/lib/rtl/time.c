@@ -420,4 +420,30 @@ RtlSecondsSince1980ToTime(IN ULONG SecondsSince1980,
     Time->QuadPart = ((LONGLONG)SecondsSince1980 * TICKSPERSEC) + TICKSTO1980;
 }
 
+
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+RtlQueryPerformanceCounter(OUT PLARGE_INTEGER PerformanceCounter)
+{
+    LARGE_INTEGER Frequency;
+    NTSTATUS Status;
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+    /* The HAL publishes the TSC when it is safe to read it from user mode */
+    if (SharedUserTscQpcData->Enabled)
+    {
+        PerformanceCounter->QuadPart = (__rdtsc() + SharedUserTscQpcData->Bias) >>
+                                       SharedUserTscQpcData->Shift;
+        return TRUE;
+    }
+#endif
+
+    /* Otherwise ask the kernel */
+    Status = NtQueryPerformanceCounter(PerformanceCounter, &Frequency);
+    return NT_SUCCESS(Status) && (Frequency.QuadPart != 0);
+}
+
 /* EOF */
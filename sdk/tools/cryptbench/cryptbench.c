@@ -0,0 +1,562 @@
+/*
+ * PROJECT:     ReactOS Build Tools
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Crypto library known answer tests and benchmark
+ *
+ * Usage: cryptbench [megabytes]
+ *
+ * Checks the portable and the hardware accelerated AES and SHA code of
+ * cryptlib against the FIPS-197, SP 800-38A and FIPS 180 test vectors and
+ * against each other on random data, then measures the throughput of both.
+ * The accelerated paths are only run when the host processor has them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <tomcrypt.h>
+#include <sha1.h>
+#include <cryptaccel.h>
+
+#define DEFAULT_MEGABYTES   64
+#define RANDOM_ROUNDS       200
+
+static int Failures;
+
+static void Check(int Condition, const char *Name)
+{
+    if (!Condition)
+    {
+        fprintf(stderr, "FAILED: %s\n", Name);
+        Failures++;
+    }
+}
+
+static void ParseHex(const char *Hex, UCHAR *Data)
+{
+    unsigned Value;
+
+    for (; Hex[0] && Hex[1]; Hex += 2)
+    {
+        sscanf(Hex, "%2x", &Value);
+        *Data++ = (UCHAR)Value;
+    }
+}
+
+static int CompareHex(const UCHAR *Data, const char *Hex)
+{
+    UCHAR Expected[64];
+    size_t Length = strlen(Hex) / 2;
+
+    ParseHex(Hex, Expected);
+    return !memcmp(Data, Expected, Length);
+}
+
+static void FillRandom(UCHAR *Data, size_t Length)
+{
+    while (Length--)
+        *Data++ = (UCHAR)rand();
+}
+
+/* Portable versions of the block modes, on top of the LibTomCrypt functions */
+
+static void PortableEcb(aes_key *Key, int Encrypt, const UCHAR *Input, UCHAR *Output, size_t Blocks)
+{
+    for (; Blocks > 0; Blocks--, Input += 16, Output += 16)
+    {
+        if (Encrypt)
+            aes_ecb_encrypt(Input, Output, Key);
+        else
+            aes_ecb_decrypt(Input, Output, Key);
+    }
+}
+
+static void PortableCbc(aes_key *Key, int Encrypt, UCHAR Iv[16],
+                        const UCHAR *Input, UCHAR *Output, size_t Blocks)
+{
+    UCHAR Block[16], Cipher[16];
+    int i;
+
+    for (; Blocks > 0; Blocks--, Input += 16, Output += 16)
+    {
+        if (Encrypt)
+        {
+            for (i = 0; i < 16; i++)
+                Block[i] = Input[i] ^ Iv[i];
+            aes_ecb_encrypt(Block, Output, Key);
+            memcpy(Iv, Output, 16);
+        }
+        else
+        {
+            memcpy(Cipher, Input, 16);
+            aes_ecb_decrypt(Cipher, Block, Key);
+            for (i = 0; i < 16; i++)
+                Output[i] = Block[i] ^ Iv[i];
+            memcpy(Iv, Cipher, 16);
+        }
+    }
+}
+
+static void PortableCtr(aes_key *Key, UCHAR Counter[16], const UCHAR *Input, UCHAR *Output, size_t Blocks)
+{
+    UCHAR Stream[16];
+    int i;
+
+    for (; Blocks > 0; Blocks--, Input += 16, Output += 16)
+    {
+        aes_ecb_encrypt(Counter, Stream, Key);
+        for (i = 0; i < 16; i++)
+            Output[i] = Input[i] ^ Stream[i];
+        for (i = 15; i >= 0 && ++Counter[i] == 0; i--);
+    }
+}
+
+/* The portable SHA-256 lives in rsaenh, this is a plain reference for the host */
+
+static const ULONG Sha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void PortableSha256Transform(ULONG State[8], const UCHAR *Data, SIZE_T Blocks)
+{
+    ULONG W[64], S[8], T1, T2;
+    int i;
+
+    for (; Blocks > 0; Blocks--, Data += 64)
+    {
+        for (i = 0; i < 16; i++)
+            W[i] = (ULONG)Data[i * 4] << 24 | Data[i * 4 + 1] << 16 | Data[i * 4 + 2] << 8 | Data[i * 4 + 3];
+        for (; i < 64; i++)
+        {
+            W[i] = W[i - 16] + W[i - 7] +
+                   (ROTR(W[i - 15], 7) ^ ROTR(W[i - 15], 18) ^ (W[i - 15] >> 3)) +
+                   (ROTR(W[i - 2], 17) ^ ROTR(W[i - 2], 19) ^ (W[i - 2] >> 10));
+        }
+
+        memcpy(S, State, sizeof(S));
+        for (i = 0; i < 64; i++)
+        {
+            T1 = S[7] + (ROTR(S[4], 6) ^ ROTR(S[4], 11) ^ ROTR(S[4], 25)) +
+                 ((S[4] & S[5]) ^ (~S[4] & S[6])) + Sha256K[i] + W[i];
+            T2 = (ROTR(S[0], 2) ^ ROTR(S[0], 13) ^ ROTR(S[0], 22)) +
+                 ((S[0] & S[1]) ^ (S[0] & S[2]) ^ (S[1] & S[2]));
+            memmove(&S[1], &S[0], 7 * sizeof(ULONG));
+            S[4] += T1;
+            S[0] = T1 + T2;
+        }
+        for (i = 0; i < 8; i++)
+            State[i] += S[i];
+    }
+}
+
+typedef void (*SHA256_TRANSFORM)(ULONG State[8], const UCHAR *Data, SIZE_T Blocks);
+
+static void Sha256(SHA256_TRANSFORM Transform, const UCHAR *Data, size_t Length, UCHAR Digest[32])
+{
+    ULONG State[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    UCHAR Last[128];
+    size_t Rest = Length % 64, Padded;
+    ULONGLONG Bits = (ULONGLONG)Length * 8;
+    int i;
+
+    Transform(State, Data, Length / 64);
+
+    memset(Last, 0, sizeof(Last));
+    memcpy(Last, Data + Length - Rest, Rest);
+    Last[Rest] = 0x80;
+    Padded = (Rest < 56) ? 64 : 128;
+    for (i = 0; i < 8; i++)
+        Last[Padded - 1 - i] = (UCHAR)(Bits >> (i * 8));
+    Transform(State, Last, Padded / 64);
+
+    for (i = 0; i < 32; i++)
+        Digest[i] = (UCHAR)(State[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static void Sha1(const UCHAR *Data, size_t Length, UCHAR Digest[20])
+{
+    SHA_CTX Context;
+    ULONG Result[5];
+
+    A_SHAInit(&Context);
+    A_SHAUpdate(&Context, Data, (ULONG)Length);
+    A_SHAFinal(&Context, Result);
+    memcpy(Digest, Result, sizeof(Result));
+}
+
+static void TestAesVectors(void)
+{
+    static const char *Keys[] =
+    {
+        "000102030405060708090a0b0c0d0e0f",
+        "000102030405060708090a0b0c0d0e0f1011121314151617",
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    };
+    static const char *Ciphers[] =
+    {
+        "69c4e0d86a7b0430d8cdb78070b4c55a",
+        "dda97ca4864cdfe06eaf70a0ec0d7191",
+        "8ea2b7ca516745bfeafc49904b496089"
+    };
+    static const char Plain[] = "00112233445566778899aabbccddeeff";
+    static const char ModeKey[] = "2b7e151628aed2a6abf7158809cf4f3c";
+    static const char ModePlain[] =
+        "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+        "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+    static const char CbcCipher[] =
+        "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+        "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7";
+    static const char CtrCipher[] =
+        "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+        "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee";
+    int Accelerated = (CryptAccelGetFeatures() & CRYPT_ACCEL_AES) != 0;
+    UCHAR KeyBytes[32], Input[64], Output[64], Iv[16];
+    aes_key Key;
+    int i;
+
+    /* FIPS-197 appendix C, one block with each key size */
+    for (i = 0; i < 3; i++)
+    {
+        ParseHex(Keys[i], KeyBytes);
+        ParseHex(Plain, Input);
+        aes_setup(KeyBytes, 16 + i * 8, 0, &Key);
+
+        PortableEcb(&Key, 1, Input, Output, 1);
+        Check(CompareHex(Output, Ciphers[i]), "AES portable encryption");
+        PortableEcb(&Key, 0, Output, Output, 1);
+        Check(CompareHex(Output, Plain), "AES portable decryption");
+
+        if (Accelerated)
+        {
+            AesNiEncryptEcb(Key.eK, Key.Nr, Input, Output, 1);
+            Check(CompareHex(Output, Ciphers[i]), "AES-NI encryption");
+            AesNiDecryptEcb(Key.dK, Key.Nr, Output, Output, 1);
+            Check(CompareHex(Output, Plain), "AES-NI decryption");
+        }
+    }
+
+    /* SP 800-38A F.2.1 and F.5.1, four blocks of CBC and CTR */
+    ParseHex(ModeKey, KeyBytes);
+    ParseHex(ModePlain, Input);
+    aes_setup(KeyBytes, 16, 0, &Key);
+
+    ParseHex("000102030405060708090a0b0c0d0e0f", Iv);
+    PortableCbc(&Key, 1, Iv, Input, Output, 4);
+    Check(CompareHex(Output, CbcCipher), "AES portable CBC");
+    ParseHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", Iv);
+    PortableCtr(&Key, Iv, Input, Output, 4);
+    Check(CompareHex(Output, CtrCipher), "AES portable CTR");
+
+    if (!Accelerated)
+        return;
+
+    ParseHex("000102030405060708090a0b0c0d0e0f", Iv);
+    AesNiEncryptCbc(Key.eK, Key.Nr, Iv, Input, Output, 4);
+    Check(CompareHex(Output, CbcCipher), "AES-NI CBC encryption");
+    Check(CompareHex(Iv, CbcCipher + 96), "AES-NI CBC encryption chain");
+    ParseHex("000102030405060708090a0b0c0d0e0f", Iv);
+    AesNiDecryptCbc(Key.dK, Key.Nr, Iv, Output, Output, 4);
+    Check(CompareHex(Output, ModePlain), "AES-NI CBC decryption");
+
+    ParseHex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", Iv);
+    AesNiCryptCtr(Key.eK, Key.Nr, Iv, Input, Output, 4);
+    Check(CompareHex(Output, CtrCipher), "AES-NI CTR");
+    Check(CompareHex(Iv, "f0f1f2f3f4f5f6f7f8f9fafbfcfdff03"), "AES-NI CTR counter");
+}
+
+static void TestAesRandom(void)
+{
+    UCHAR KeyBytes[32], Input[16 * 37], Expected[16 * 37], Output[16 * 37];
+    UCHAR Iv[16], IvExpected[16];
+    aes_key Key;
+    size_t Blocks;
+    int i;
+
+    if (!(CryptAccelGetFeatures() & CRYPT_ACCEL_AES))
+        return;
+
+    for (i = 0; i < RANDOM_ROUNDS; i++)
+    {
+        FillRandom(KeyBytes, sizeof(KeyBytes));
+        FillRandom(Input, sizeof(Input));
+        FillRandom(Iv, sizeof(Iv));
+        aes_setup(KeyBytes, 16 + (i % 3) * 8, 0, &Key);
+        Blocks = 1 + rand() % 37;
+
+        /* Cover the carries out of the low bytes and words of the counter */
+        if (i % 4 == 0)
+            memset(Iv + 8 + i % 8, 0xFF, 8 - i % 8);
+
+        PortableEcb(&Key, 1, Input, Expected, Blocks);
+        AesNiEncryptEcb(Key.eK, Key.Nr, Input, Output, Blocks);
+        Check(!memcmp(Output, Expected, Blocks * 16), "random ECB encryption");
+        AesNiDecryptEcb(Key.dK, Key.Nr, Output, Output, Blocks);
+        Check(!memcmp(Output, Input, Blocks * 16), "random ECB decryption");
+
+        memcpy(IvExpected, Iv, 16);
+        PortableCbc(&Key, 0, IvExpected, Input, Expected, Blocks);
+        memcpy(Output, Input, Blocks * 16);
+        AesNiDecryptCbc(Key.dK, Key.Nr, Iv, Output, Output, Blocks);
+        Check(!memcmp(Output, Expected, Blocks * 16) && !memcmp(Iv, IvExpected, 16),
+              "random CBC decryption");
+
+        PortableCtr(&Key, IvExpected, Input, Expected, Blocks);
+        AesNiCryptCtr(Key.eK, Key.Nr, Iv, Input, Output, Blocks);
+        Check(!memcmp(Output, Expected, Blocks * 16) && !memcmp(Iv, IvExpected, 16),
+              "random CTR");
+    }
+}
+
+static void TestShaVectors(void)
+{
+    static const char Abc[] = "abc";
+    static const char Long[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    UCHAR *Million;
+    UCHAR Digest[32];
+    ULONG Features = CryptAccelGetFeatures();
+    ULONG Pass;
+
+    Million = malloc(1000000);
+    if (!Million)
+        return;
+    memset(Million, 'a', 1000000);
+
+    /* The first pass uses the portable code, the second one the accelerated one */
+    for (Pass = 0; Pass < 2; Pass++)
+    {
+        CryptAccelSetMask(Pass ? CRYPT_ACCEL_ALL : 0);
+        if (Pass && !(Features & CRYPT_ACCEL_SHA))
+            break;
+
+        Sha1((const UCHAR *)Abc, 3, Digest);
+        Check(CompareHex(Digest, "a9993e364706816aba3e25717850c26c9cd0d89d"), "SHA-1 abc");
+        Sha1((const UCHAR *)Long, strlen(Long), Digest);
+        Check(CompareHex(Digest, "84983e441c3bd26ebaae4aa1f95129e5e54670f1"), "SHA-1 448 bits");
+        Sha1(Million, 1000000, Digest);
+        Check(CompareHex(Digest, "34aa973cd4c4daa4f61eeb2bdbad27316534016f"), "SHA-1 million a");
+
+        if (!Pass)
+            continue;
+
+        Sha256(ShaNiSha256Transform, (const UCHAR *)Abc, 3, Digest);
+        Check(CompareHex(Digest, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"),
+              "SHA-256 abc");
+        Sha256(ShaNiSha256Transform, (const UCHAR *)Long, strlen(Long), Digest);
+        Check(CompareHex(Digest, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"),
+              "SHA-256 448 bits");
+        Sha256(ShaNiSha256Transform, Million, 1000000, Digest);
+        Check(CompareHex(Digest, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"),
+              "SHA-256 million a");
+    }
+
+    Sha256(PortableSha256Transform, Million, 1000000, Digest);
+    Check(CompareHex(Digest, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"),
+          "SHA-256 reference million a");
+
+    CryptAccelSetMask(CRYPT_ACCEL_ALL);
+    free(Million);
+}
+
+static void TestShaRandom(void)
+{
+    UCHAR Data[1000], Expected[32], Digest[32];
+    SHA_CTX Context;
+    ULONG Result[5];
+    size_t Length, Offset, Chunk;
+    int i;
+
+    if (!(CryptAccelGetFeatures() & CRYPT_ACCEL_SHA))
+        return;
+
+    for (i = 0; i < RANDOM_ROUNDS; i++)
+    {
+        Length = rand() % sizeof(Data);
+        FillRandom(Data, Length);
+
+        CryptAccelSetMask(0);
+        Sha1(Data, Length, Expected);
+        CryptAccelSetMask(CRYPT_ACCEL_ALL);
+
+        /* Feed the data in pieces, so that blocks straddle the updates */
+        A_SHAInit(&Context);
+        for (Offset = 0; Offset < Length; Offset += Chunk)
+        {
+            Chunk = 1 + rand() % 150;
+            if (Chunk > Length - Offset)
+                Chunk = Length - Offset;
+            A_SHAUpdate(&Context, Data + Offset, (ULONG)Chunk);
+        }
+        A_SHAFinal(&Context, Result);
+        Check(!memcmp(Result, Expected, 20), "random SHA-1");
+
+        Sha256(PortableSha256Transform, Data, Length, Expected);
+        Sha256(ShaNiSha256Transform, Data, Length, Digest);
+        Check(!memcmp(Digest, Expected, 32), "random SHA-256");
+    }
+}
+
+static double Throughput(clock_t Start, size_t Size)
+{
+    double Seconds = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+    return Seconds > 0 ? Size / Seconds / (1024 * 1024) : 0;
+}
+
+static void Benchmark(size_t Size)
+{
+    ULONG Features = CryptAccelGetFeatures();
+    UCHAR *Buffer, KeyBytes[32], Iv[16], Digest[32];
+    size_t Blocks = Size / 16;
+    aes_key Key;
+    clock_t Start;
+    int i;
+
+    Buffer = malloc(Size);
+    if (!Buffer)
+    {
+        fprintf(stderr, "Out of memory\n");
+        Failures++;
+        return;
+    }
+    FillRandom(Buffer, Size);
+    FillRandom(KeyBytes, sizeof(KeyBytes));
+    memset(Iv, 0, sizeof(Iv));
+
+    printf("%-22s %12s %12s\n", "MB/s", "portable", "accelerated");
+
+    for (i = 0; i < 3; i++)
+    {
+        aes_setup(KeyBytes, 16 + i * 8, 0, &Key);
+
+        printf("AES-%d ECB encrypt     ", 128 + i * 64);
+        Start = clock();
+        PortableEcb(&Key, 1, Buffer, Buffer, Blocks);
+        printf(" %12.1f", Throughput(Start, Size));
+        if (Features & CRYPT_ACCEL_AES)
+        {
+            Start = clock();
+            AesNiEncryptEcb(Key.eK, Key.Nr, Buffer, Buffer, Blocks);
+            printf(" %12.1f", Throughput(Start, Size));
+        }
+        printf("\n");
+    }
+
+    aes_setup(KeyBytes, 16, 0, &Key);
+
+    printf("AES-128 CBC encrypt    ");
+    Start = clock();
+    PortableCbc(&Key, 1, Iv, Buffer, Buffer, Blocks);
+    printf(" %12.1f", Throughput(Start, Size));
+    if (Features & CRYPT_ACCEL_AES)
+    {
+        Start = clock();
+        AesNiEncryptCbc(Key.eK, Key.Nr, Iv, Buffer, Buffer, Blocks);
+        printf(" %12.1f", Throughput(Start, Size));
+    }
+    printf("\n");
+
+    printf("AES-128 CBC decrypt    ");
+    Start = clock();
+    PortableCbc(&Key, 0, Iv, Buffer, Buffer, Blocks);
+    printf(" %12.1f", Throughput(Start, Size));
+    if (Features & CRYPT_ACCEL_AES)
+    {
+        Start = clock();
+        AesNiDecryptCbc(Key.dK, Key.Nr, Iv, Buffer, Buffer, Blocks);
+        printf(" %12.1f", Throughput(Start, Size));
+    }
+    printf("\n");
+
+    printf("AES-128 CTR            ");
+    Start = clock();
+    PortableCtr(&Key, Iv, Buffer, Buffer, Blocks);
+    printf(" %12.1f", Throughput(Start, Size));
+    if (Features & CRYPT_ACCEL_AES)
+    {
+        Start = clock();
+        AesNiCryptCtr(Key.eK, Key.Nr, Iv, Buffer, Buffer, Blocks);
+        printf(" %12.1f", Throughput(Start, Size));
+    }
+    printf("\n");
+
+    printf("SHA-1                  ");
+    CryptAccelSetMask(0);
+    Start = clock();
+    Sha1(Buffer, Size, Digest);
+    printf(" %12.1f", Throughput(Start, Size));
+    CryptAccelSetMask(CRYPT_ACCEL_ALL);
+    if (Features & CRYPT_ACCEL_SHA)
+    {
+        Start = clock();
+        Sha1(Buffer, Size, Digest);
+        printf(" %12.1f", Throughput(Start, Size));
+    }
+    printf("\n");
+
+    printf("SHA-256                ");
+    Start = clock();
+    Sha256(PortableSha256Transform, Buffer, Size, Digest);
+    printf(" %12.1f", Throughput(Start, Size));
+    if (Features & CRYPT_ACCEL_SHA)
+    {
+        Start = clock();
+        Sha256(ShaNiSha256Transform, Buffer, Size, Digest);
+        printf(" %12.1f", Throughput(Start, Size));
+    }
+    printf("\n");
+
+    free(Buffer);
+}
+
+int main(int argc, char *argv[])
+{
+    ULONG Features = CryptAccelGetFeatures();
+    unsigned long Megabytes = DEFAULT_MEGABYTES;
+
+    if (argc > 2 || (argc == 2 && !strcmp(argv[1], "/?")))
+    {
+        printf("Tests and benchmarks the crypto library.\n"
+               "Syntax: cryptbench [megabytes]\n");
+        return 1;
+    }
+
+    if (argc == 2)
+        Megabytes = strtoul(argv[1], NULL, 0);
+    if (Megabytes == 0 || Megabytes > 4000)
+    {
+        fprintf(stderr, "Invalid size\n");
+        return 1;
+    }
+
+    printf("AES-NI: %s, SHA extensions: %s\n",
+           (Features & CRYPT_ACCEL_AES) ? "yes" : "no",
+           (Features & CRYPT_ACCEL_SHA) ? "yes" : "no");
+
+    srand(1);
+    TestAesVectors();
+    TestAesRandom();
+    TestShaVectors();
+    TestShaRandom();
+    if (Failures)
+    {
+        fprintf(stderr, "%d known answer tests failed\n", Failures);
+        return 1;
+    }
+    printf("Known answer tests passed\n\n");
+
+    Benchmark((size_t)Megabytes * 1024 * 1024);
+    return Failures ? 1 : 0;
+}
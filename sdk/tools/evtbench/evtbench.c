@@ -0,0 +1,360 @@
+/*
+ * PROJECT:     ReactOS Build Tools
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Event log library benchmark
+ *
+ * Usage: evtbench <log file> [record count]
+ *
+ * Builds an event log file with the given number of records through the
+ * callback interface of evtlib, then opens it again and reads it back,
+ * sequentially and at random, timing each step. A second, smaller log
+ * is filled until it wraps several times to check the offset table.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <evtlib.h>
+
+#define DEFAULT_RECORD_COUNT    1000000
+#define RANDOM_READ_COUNT       100000
+#define READ_BUFFER_SIZE        0x10000
+#define WRAP_LOG_SIZE           0x10000
+#define WRAP_RECORD_COUNT       5000
+
+typedef struct _BENCH_LOGFILE
+{
+    EVTLOGFILE LogFile;
+    FILE *File;
+} BENCH_LOGFILE, *PBENCH_LOGFILE;
+
+static PVOID NTAPI BenchAlloc(IN SIZE_T Size, IN ULONG Flags, IN ULONG Tag)
+{
+    return (Flags & HEAP_ZERO_MEMORY) ? calloc(1, Size) : malloc(Size);
+}
+
+static VOID NTAPI BenchFree(IN PVOID Ptr, IN ULONG Flags, IN ULONG Tag)
+{
+    free(Ptr);
+}
+
+static NTSTATUS NTAPI BenchReadFile(IN PEVTLOGFILE LogFile, IN PLARGE_INTEGER FileOffset,
+                                    OUT PVOID Buffer, IN SIZE_T Length, OUT PSIZE_T ReadLength OPTIONAL)
+{
+    FILE *File = ((PBENCH_LOGFILE)LogFile)->File;
+    size_t Read;
+
+    if (FileOffset && fseek(File, (long)FileOffset->QuadPart, SEEK_SET) != 0)
+        return STATUS_END_OF_FILE;
+
+    Read = fread(Buffer, 1, Length, File);
+    if (ReadLength)
+        *ReadLength = Read;
+    return (Read || !Length) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+}
+
+static NTSTATUS NTAPI BenchWriteFile(IN PEVTLOGFILE LogFile, IN PLARGE_INTEGER FileOffset,
+                                     IN PVOID Buffer, IN SIZE_T Length, OUT PSIZE_T WrittenLength OPTIONAL)
+{
+    FILE *File = ((PBENCH_LOGFILE)LogFile)->File;
+    size_t Written;
+
+    if (FileOffset && fseek(File, (long)FileOffset->QuadPart, SEEK_SET) != 0)
+        return STATUS_ACCESS_DENIED;
+
+    Written = fwrite(Buffer, 1, Length, File);
+    if (WrittenLength)
+        *WrittenLength = Written;
+    return (Written == Length) ? STATUS_SUCCESS : STATUS_ACCESS_DENIED;
+}
+
+static NTSTATUS NTAPI BenchSetFileSize(IN PEVTLOGFILE LogFile, IN ULONG FileSize, IN ULONG OldFileSize)
+{
+    FILE *File = ((PBENCH_LOGFILE)LogFile)->File;
+
+    fflush(File);
+#ifdef _WIN32
+    return _chsize(_fileno(File), FileSize) ? STATUS_ACCESS_DENIED : STATUS_SUCCESS;
+#else
+    return ftruncate(fileno(File), FileSize) ? STATUS_ACCESS_DENIED : STATUS_SUCCESS;
+#endif
+}
+
+static NTSTATUS NTAPI BenchFlushFile(IN PEVTLOGFILE LogFile, IN PLARGE_INTEGER FileOffset, IN ULONG Length)
+{
+    return fflush(((PBENCH_LOGFILE)LogFile)->File) ? STATUS_ACCESS_DENIED : STATUS_SUCCESS;
+}
+
+static NTSTATUS OpenLog(PBENCH_LOGFILE Log, const char *FileName, ULONG MaxSize, BOOLEAN CreateNew)
+{
+    NTSTATUS Status;
+
+    Log->File = fopen(FileName, CreateNew ? "w+b" : "rb");
+    if (!Log->File)
+    {
+        fprintf(stderr, "Unable to open '%s'\n", FileName);
+        return STATUS_ACCESS_DENIED;
+    }
+
+    Status = ElfCreateFile(&Log->LogFile, NULL, CreateNew ? 0 : MaxSize, MaxSize, 0,
+                           CreateNew, !CreateNew,
+                           BenchAlloc, BenchFree, BenchSetFileSize,
+                           BenchWriteFile, BenchReadFile, BenchFlushFile);
+    if (!NT_SUCCESS(Status))
+    {
+        fprintf(stderr, "ElfCreateFile failed for '%s', Status 0x%08x\n", FileName, (unsigned)Status);
+        fclose(Log->File);
+    }
+    return Status;
+}
+
+static VOID CloseLog(PBENCH_LOGFILE Log)
+{
+    ElfCloseFile(&Log->LogFile);
+    fclose(Log->File);
+}
+
+/* Builds a record with the layout of the event log service, varying its size */
+static ULONG BuildRecord(PEVENTLOGRECORD Record, ULONG Index)
+{
+    static const WCHAR SourceName[] = {'E','v','t','B','e','n','c','h',0};
+    static const WCHAR ComputerName[] = {'H','O','S','T',0};
+    PUCHAR Ptr = (PUCHAR)(Record + 1);
+    ULONG DataLength = 8 + (Index % 7) * 12;
+    ULONG i;
+
+    memset(Record, 0, sizeof(*Record));
+    Record->Reserved = LOGFILE_SIGNATURE;
+    Record->TimeGenerated = Record->TimeWritten = Index;
+    Record->EventID = Index;
+    Record->EventType = EVENTLOG_INFORMATION_TYPE;
+
+    memcpy(Ptr, SourceName, sizeof(SourceName));
+    Ptr += sizeof(SourceName);
+    memcpy(Ptr, ComputerName, sizeof(ComputerName));
+    Ptr += sizeof(ComputerName);
+    while ((Ptr - (PUCHAR)Record) % sizeof(ULONG))
+        *Ptr++ = 0;
+
+    Record->UserSidOffset = (ULONG)(Ptr - (PUCHAR)Record);
+    Record->StringOffset = Record->UserSidOffset;
+    Record->DataOffset = Record->StringOffset;
+    Record->DataLength = DataLength;
+    for (i = 0; i < DataLength; i++)
+        *Ptr++ = (UCHAR)(Index + i);
+    while ((Ptr - (PUCHAR)Record) % sizeof(ULONG))
+        *Ptr++ = 0;
+
+    Record->Length = (ULONG)(Ptr - (PUCHAR)Record) + sizeof(ULONG);
+    memcpy(Ptr, &Record->Length, sizeof(ULONG));
+    return Record->Length;
+}
+
+static double Elapsed(clock_t Start)
+{
+    return (double)(clock() - Start) * 1000 / CLOCKS_PER_SEC;
+}
+
+/* Reads all the records forwards, checks that they follow each other */
+static int ReadAll(PEVTLOGFILE LogFile, PUCHAR Buffer, BOOLEAN Batched, ULONG *Count)
+{
+    PEVENTLOGRECORD Record;
+    ULONG RecordNumber, RecordsRead, Offset;
+    SIZE_T BytesRead, BytesNeeded;
+    NTSTATUS Status;
+
+    *Count = 0;
+    RecordNumber = ElfGetOldestRecord(LogFile);
+    for (;;)
+    {
+        if (Batched)
+        {
+            Status = ElfReadRecords(LogFile, RecordNumber, (PEVENTLOGRECORD)Buffer, READ_BUFFER_SIZE,
+                                    &BytesRead, &BytesNeeded, &RecordsRead);
+        }
+        else
+        {
+            Status = ElfReadRecord(LogFile, RecordNumber, (PEVENTLOGRECORD)Buffer, READ_BUFFER_SIZE,
+                                   &BytesRead, &BytesNeeded);
+            RecordsRead = 1;
+        }
+        if (Status == STATUS_NOT_FOUND)
+            break;
+        if (!NT_SUCCESS(Status))
+        {
+            fprintf(stderr, "Reading record %u failed, Status 0x%08x\n", RecordNumber, (unsigned)Status);
+            return 0;
+        }
+
+        for (Offset = 0; RecordsRead--; Offset += Record->Length)
+        {
+            Record = (PEVENTLOGRECORD)(Buffer + Offset);
+            if (Offset >= BytesRead || Record->RecordNumber != RecordNumber)
+            {
+                fprintf(stderr, "Expected record %u at offset %u\n", RecordNumber, Offset);
+                return 0;
+            }
+            RecordNumber++;
+            (*Count)++;
+        }
+    }
+
+    return 1;
+}
+
+static int RunBenchmark(const char *FileName, ULONG RecordCount)
+{
+    BENCH_LOGFILE Log;
+    PUCHAR Buffer;
+    PEVENTLOGRECORD Record;
+    SIZE_T BytesRead, BytesNeeded;
+    ULONG MaxSize, Count, i;
+    NTSTATUS Status;
+    clock_t Start;
+
+    Buffer = malloc(READ_BUFFER_SIZE);
+    if (!Buffer)
+        return 0;
+    Record = (PEVENTLOGRECORD)Buffer;
+
+    /* Make room for all the records, so that none is overwritten */
+    MaxSize = sizeof(EVENTLOGHEADER) + RecordCount * 0x100 + sizeof(EVENTLOGEOF);
+    if (!NT_SUCCESS(OpenLog(&Log, FileName, MaxSize, TRUE)))
+        goto Fail;
+
+    Start = clock();
+    for (i = 0; i < RecordCount; i++)
+    {
+        Status = ElfWriteRecord(&Log.LogFile, Record, BuildRecord(Record, i));
+        if (!NT_SUCCESS(Status))
+        {
+            fprintf(stderr, "Writing record %u failed, Status 0x%08x\n", i, (unsigned)Status);
+            CloseLog(&Log);
+            goto Fail;
+        }
+    }
+    printf("Write %u records:       %10.1f ms\n", RecordCount, Elapsed(Start));
+    CloseLog(&Log);
+
+    Start = clock();
+    if (!NT_SUCCESS(OpenLog(&Log, FileName, MaxSize, FALSE)))
+        goto Fail;
+    printf("Open existing log:        %10.1f ms\n", Elapsed(Start));
+
+    Start = clock();
+    if (!ReadAll(&Log.LogFile, Buffer, FALSE, &Count) || Count != RecordCount)
+        goto FailRead;
+    printf("Read one by one:          %10.1f ms\n", Elapsed(Start));
+
+    Start = clock();
+    if (!ReadAll(&Log.LogFile, Buffer, TRUE, &Count) || Count != RecordCount)
+        goto FailRead;
+    printf("Read in batches:          %10.1f ms\n", Elapsed(Start));
+
+    srand(1);
+    Start = clock();
+    for (i = 0; i < RANDOM_READ_COUNT; i++)
+    {
+        ULONG RecordNumber = ElfGetOldestRecord(&Log.LogFile) + (ULONG)(((unsigned long)rand() * (RAND_MAX + 1UL) + rand()) % RecordCount);
+
+        Status = ElfReadRecord(&Log.LogFile, RecordNumber, Record, READ_BUFFER_SIZE, &BytesRead, &BytesNeeded);
+        if (!NT_SUCCESS(Status) || Record->RecordNumber != RecordNumber)
+        {
+            fprintf(stderr, "Reading record %u failed, Status 0x%08x\n", RecordNumber, (unsigned)Status);
+            goto FailRead;
+        }
+    }
+    printf("Read %u at random:    %10.1f ms\n", RANDOM_READ_COUNT, Elapsed(Start));
+
+    CloseLog(&Log);
+    free(Buffer);
+    return 1;
+
+FailRead:
+    fprintf(stderr, "Read %u records out of %u\n", Count, RecordCount);
+    CloseLog(&Log);
+Fail:
+    free(Buffer);
+    return 0;
+}
+
+/* Fills a small log until it wraps, then reads back what it keeps */
+static int RunWrapTest(const char *FileName)
+{
+    BENCH_LOGFILE Log;
+    PUCHAR Buffer;
+    PEVENTLOGRECORD Record;
+    ULONG Count, Expected, i;
+    NTSTATUS Status;
+    int Result = 0;
+
+    Buffer = malloc(READ_BUFFER_SIZE);
+    if (!Buffer)
+        return 0;
+    Record = (PEVENTLOGRECORD)Buffer;
+
+    if (!NT_SUCCESS(OpenLog(&Log, FileName, WRAP_LOG_SIZE, TRUE)))
+    {
+        free(Buffer);
+        return 0;
+    }
+
+    for (i = 0; i < WRAP_RECORD_COUNT; i++)
+    {
+        Status = ElfWriteRecord(&Log.LogFile, Record, BuildRecord(Record, i));
+        if (!NT_SUCCESS(Status))
+        {
+            fprintf(stderr, "Writing record %u failed, Status 0x%08x\n", i, (unsigned)Status);
+            goto Quit;
+        }
+    }
+
+    Expected = ElfGetCurrentRecord(&Log.LogFile) - ElfGetOldestRecord(&Log.LogFile);
+    if (!ReadAll(&Log.LogFile, Buffer, TRUE, &Count) || Count != Expected ||
+        !(ElfGetFlags(&Log.LogFile) & ELF_LOGFILE_HEADER_WRAP))
+    {
+        fprintf(stderr, "Wrapped log: read %u records out of %u\n", Count, Expected);
+        goto Quit;
+    }
+    printf("Wrapped log keeps records %u to %u\n",
+           ElfGetOldestRecord(&Log.LogFile), ElfGetCurrentRecord(&Log.LogFile) - 1);
+    Result = 1;
+
+Quit:
+    CloseLog(&Log);
+    free(Buffer);
+    return Result;
+}
+
+int main(int argc, char *argv[])
+{
+    ULONG RecordCount = DEFAULT_RECORD_COUNT;
+
+    if (argc < 2 || argc > 3)
+    {
+        printf("Benchmarks the event log library.\n"
+               "Syntax: evtbench <log file> [record count]\n");
+        return 1;
+    }
+
+    if (argc == 3)
+        RecordCount = strtoul(argv[2], NULL, 0);
+    if (RecordCount == 0 || RecordCount > (0xFFFFFFFF - 0x1000) / 0x100)
+    {
+        fprintf(stderr, "Invalid record count\n");
+        return 1;
+    }
+
+    if (!RunWrapTest(argv[1]) || !RunBenchmark(argv[1], RecordCount))
+        return 1;
+
+    remove(argv[1]);
+    return 0;
+}
@@ -0,0 +1,397 @@
+/*
+ * PROJECT:     ReactOS Build Tools
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Packs the boot set into a compressed boot bundle
+ *
+ * Usage: mkbundle <list file> <output file>
+ *
+ * Each line of the list file has the form "<name>=<file>", where <name>
+ * is the path of the file relative to the system root on the target,
+ * e.g. "system32\ntoskrnl.exe", and <file> is the file to pack. Files are
+ * stored in the order of the list, which should be the order in which
+ * the boot loader opens them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <typedefs.h>
+
+#include "../../include/reactos/bootbundle.h"
+
+#define LZNT1_CHUNK_SIZE    0x1000
+#define LZNT1_HASH_BITS     12
+#define LZNT1_HASH_SIZE     (1 << LZNT1_HASH_BITS)
+#define LZNT1_MAX_CHAIN     256
+
+typedef struct _BUNDLE_FILE
+{
+    char *Name;
+    unsigned char *Data;
+    ULONG Size;
+    ULONG Flags;
+    ULONG StoredSize;
+} BUNDLE_FILE;
+
+static BUNDLE_FILE *Files;
+static ULONG FileCount;
+
+static unsigned int Lznt1Hash(const unsigned char *p)
+{
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & (LZNT1_HASH_SIZE - 1);
+}
+
+/*
+ * Compresses one chunk, returns the size of the compressed data without
+ * the chunk header, or 0 when it does not get smaller than the input.
+ */
+static ULONG Lznt1CompressChunk(const unsigned char *Src, ULONG Size, unsigned char *Dst)
+{
+    static int Head[LZNT1_HASH_SIZE];
+    static int Prev[LZNT1_CHUNK_SIZE];
+    ULONG Pos = 0, Out = 0, FlagPos = 0, Bit = 8;
+    ULONG DisplacementBits, MaxLength, MaxDisplacement;
+    ULONG BestLength, BestDisplacement, Length, Chain, i;
+    unsigned char Flags = 0;
+    int Candidate;
+
+    memset(Head, -1, sizeof(Head));
+
+    while (Pos < Size)
+    {
+        if (Bit == 8)
+        {
+            if (Out)
+                Dst[FlagPos] = Flags;
+            FlagPos = Out++;
+            Flags = 0;
+            Bit = 0;
+        }
+
+        /* The split between displacement and length depends on the position */
+        for (DisplacementBits = 4; DisplacementBits < 12; DisplacementBits++)
+        {
+            if ((1u << DisplacementBits) >= Pos)
+                break;
+        }
+        MaxDisplacement = 1u << DisplacementBits;
+        MaxLength = (1u << (16 - DisplacementBits)) - 1 + 3;
+        if (MaxLength > Size - Pos)
+            MaxLength = Size - Pos;
+
+        BestLength = 0;
+        BestDisplacement = 0;
+        if (MaxLength >= 3)
+        {
+            Candidate = Head[Lznt1Hash(Src + Pos)];
+            for (Chain = 0; Candidate >= 0 && Chain < LZNT1_MAX_CHAIN; Chain++)
+            {
+                if (Pos - Candidate > MaxDisplacement)
+                    break;
+
+                for (Length = 0; Length < MaxLength && Src[Candidate + Length] == Src[Pos + Length]; Length++);
+                if (Length > BestLength)
+                {
+                    BestLength = Length;
+                    BestDisplacement = Pos - Candidate;
+                    if (Length == MaxLength)
+                        break;
+                }
+                Candidate = Prev[Candidate];
+            }
+        }
+
+        if (BestLength >= 3)
+        {
+            USHORT Code = (USHORT)(((BestDisplacement - 1) << (16 - DisplacementBits)) | (BestLength - 3));
+
+            Dst[Out++] = Code & 0xFF;
+            Dst[Out++] = Code >> 8;
+            Flags |= 1 << Bit;
+        }
+        else
+        {
+            BestLength = 1;
+            Dst[Out++] = Src[Pos];
+        }
+        Bit++;
+
+        for (i = 0; i < BestLength; i++, Pos++)
+        {
+            if (Pos + 3 <= Size)
+            {
+                unsigned int Hash = Lznt1Hash(Src + Pos);
+
+                Prev[Pos] = Head[Hash];
+                Head[Hash] = Pos;
+            }
+        }
+
+        if (Out >= Size)
+            return 0;
+    }
+
+    Dst[FlagPos] = Flags;
+    return (Out < Size) ? Out : 0;
+}
+
+/*
+ * Compresses a whole file into LZNT1 chunks, returns the compressed size
+ * or 0 when storing the file as is is smaller.
+ */
+static ULONG Lznt1Compress(const unsigned char *Src, ULONG Size, unsigned char *Dst)
+{
+    ULONG Pos, Out = 0, ChunkSize, CompressedSize;
+    USHORT Header;
+
+    for (Pos = 0; Pos < Size; Pos += ChunkSize)
+    {
+        ChunkSize = Size - Pos;
+        if (ChunkSize > LZNT1_CHUNK_SIZE)
+            ChunkSize = LZNT1_CHUNK_SIZE;
+
+        CompressedSize = Lznt1CompressChunk(Src + Pos, ChunkSize, Dst + Out + 2);
+        if (CompressedSize)
+        {
+            Header = (USHORT)(0xB000 | (CompressedSize - 1));
+        }
+        else
+        {
+            memcpy(Dst + Out + 2, Src + Pos, ChunkSize);
+            CompressedSize = ChunkSize;
+            Header = (USHORT)(0x3000 | (CompressedSize - 1));
+        }
+        Dst[Out] = Header & 0xFF;
+        Dst[Out + 1] = Header >> 8;
+        Out += 2 + CompressedSize;
+
+        if (Out >= Size)
+            return 0;
+    }
+
+    return Out;
+}
+
+static unsigned char *ReadFileData(const char *FileName, ULONG *Size)
+{
+    unsigned char *Data;
+    FILE *File;
+    long Length;
+
+    File = fopen(FileName, "rb");
+    if (!File)
+    {
+        fprintf(stderr, "Unable to open '%s'\n", FileName);
+        return NULL;
+    }
+
+    fseek(File, 0, SEEK_END);
+    Length = ftell(File);
+    fseek(File, 0, SEEK_SET);
+    if (Length <= 0)
+    {
+        fprintf(stderr, "'%s' is empty\n", FileName);
+        fclose(File);
+        return NULL;
+    }
+
+    Data = malloc(Length);
+    if (!Data || fread(Data, 1, Length, File) != (size_t)Length)
+    {
+        fprintf(stderr, "Unable to read '%s'\n", FileName);
+        free(Data);
+        fclose(File);
+        return NULL;
+    }
+
+    fclose(File);
+    *Size = (ULONG)Length;
+    return Data;
+}
+
+static int AddFile(char *Line)
+{
+    BUNDLE_FILE *NewFiles, *File;
+    unsigned char *Compressed;
+    char *Separator, *p;
+    ULONG CompressedSize;
+
+    Separator = strchr(Line, '=');
+    if (!Separator || Separator == Line || !Separator[1])
+    {
+        fprintf(stderr, "Invalid line '%s'\n", Line);
+        return 0;
+    }
+    *Separator = '\0';
+
+    NewFiles = realloc(Files, (FileCount + 1) * sizeof(BUNDLE_FILE));
+    if (!NewFiles)
+        return 0;
+    Files = NewFiles;
+    File = &Files[FileCount];
+
+    File->Name = strdup(Line);
+    if (!File->Name)
+        return 0;
+    for (p = File->Name; *p; p++)
+    {
+        if (*p == '/')
+            *p = '\\';
+    }
+
+    File->Data = ReadFileData(Separator + 1, &File->Size);
+    if (!File->Data)
+        return 0;
+
+    /* Worst case: every chunk stored with its header */
+    Compressed = malloc(File->Size + (File->Size / LZNT1_CHUNK_SIZE + 1) * 2 + 3);
+    if (!Compressed)
+        return 0;
+
+    CompressedSize = Lznt1Compress(File->Data, File->Size, Compressed);
+    if (CompressedSize)
+    {
+        free(File->Data);
+        File->Data = Compressed;
+        File->Flags = BOOT_BUNDLE_ENTRY_LZNT1;
+        File->StoredSize = CompressedSize;
+    }
+    else
+    {
+        free(Compressed);
+        File->Flags = 0;
+        File->StoredSize = File->Size;
+    }
+
+    FileCount++;
+    return 1;
+}
+
+static int ReadList(const char *ListName)
+{
+    char Line[1024];
+    size_t Length;
+    FILE *List;
+
+    List = fopen(ListName, "r");
+    if (!List)
+    {
+        fprintf(stderr, "Unable to open '%s'\n", ListName);
+        return 0;
+    }
+
+    while (fgets(Line, sizeof(Line), List))
+    {
+        Length = strlen(Line);
+        while (Length && (Line[Length - 1] == '\n' || Line[Length - 1] == '\r'))
+            Line[--Length] = '\0';
+
+        if (!Length || Line[0] == '#')
+            continue;
+
+        if (!AddFile(Line))
+        {
+            fclose(List);
+            return 0;
+        }
+    }
+
+    fclose(List);
+    return 1;
+}
+
+static int WriteBundle(const char *OutputName)
+{
+    BOOT_BUNDLE_HEADER Header;
+    BOOT_BUNDLE_ENTRY Entry;
+    ULONG NameOffset, DataOffset, i;
+    unsigned long long CompressedSize = 0, UncompressedSize = 0;
+    FILE *Output;
+
+    NameOffset = sizeof(Header) + FileCount * sizeof(Entry);
+    DataOffset = NameOffset;
+    for (i = 0; i < FileCount; i++)
+    {
+        DataOffset += (ULONG)strlen(Files[i].Name) + 1;
+        CompressedSize += Files[i].StoredSize;
+        UncompressedSize += Files[i].Size;
+    }
+    DataOffset = (DataOffset + 15) & ~15;
+
+    if (DataOffset + CompressedSize > 0xFFFFFFFF ||
+        DataOffset + UncompressedSize > 0xFFFFFFFF)
+    {
+        fprintf(stderr, "The boot set is too large\n");
+        return 0;
+    }
+
+    Output = fopen(OutputName, "wb");
+    if (!Output)
+    {
+        fprintf(stderr, "Unable to create '%s'\n", OutputName);
+        return 0;
+    }
+
+    memset(&Header, 0, sizeof(Header));
+    Header.Signature = BOOT_BUNDLE_SIGNATURE;
+    Header.Version = BOOT_BUNDLE_VERSION;
+    Header.HeaderSize = sizeof(Header);
+    Header.EntryCount = FileCount;
+    Header.DataOffset = DataOffset;
+    Header.CompressedSize = (ULONG)CompressedSize;
+    Header.UncompressedSize = (ULONG)UncompressedSize;
+    fwrite(&Header, sizeof(Header), 1, Output);
+
+    for (i = 0; i < FileCount; i++)
+    {
+        Entry.NameOffset = NameOffset;
+        Entry.Flags = Files[i].Flags;
+        Entry.DataOffset = DataOffset;
+        Entry.DataSize = Files[i].StoredSize;
+        Entry.FileSize = Files[i].Size;
+        fwrite(&Entry, sizeof(Entry), 1, Output);
+
+        NameOffset += (ULONG)strlen(Files[i].Name) + 1;
+        DataOffset += Files[i].StoredSize;
+    }
+
+    for (i = 0; i < FileCount; i++)
+        fwrite(Files[i].Name, strlen(Files[i].Name) + 1, 1, Output);
+    while (ftell(Output) < (long)Header.DataOffset)
+        fputc(0, Output);
+
+    for (i = 0; i < FileCount; i++)
+        fwrite(Files[i].Data, Files[i].StoredSize, 1, Output);
+
+    if (ferror(Output))
+    {
+        fprintf(stderr, "Unable to write '%s'\n", OutputName);
+        fclose(Output);
+        remove(OutputName);
+        return 0;
+    }
+
+    fclose(Output);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        printf("Packs the boot set into a compressed boot bundle.\n"
+               "Syntax: mkbundle <list file> <output file>\n");
+        return 1;
+    }
+
+    if (!ReadList(argv[1]))
+        return 1;
+
+    if (!FileCount)
+    {
+        fprintf(stderr, "No file to pack\n");
+        return 1;
+    }
+
+    return WriteBundle(argv[2]) ? 0 : 1;
+}
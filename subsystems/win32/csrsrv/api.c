@@ -802,7 +802,10 @@ CsrApiRequestThread(IN PVOID Parameter)
         if (ReceiveMsg.CsrCaptureData)
         {
             /* Capture the arguments */
-            if (!CsrCaptureArguments(CsrThread, &ReceiveMsg))
+            if (!CsrCaptureArguments(CsrThread,
+                                     &ReceiveMsg,
+                                     ServerDll->ByReferenceTable &&
+                                     ServerDll->ByReferenceTable[ApiId]))
             {
                 /* Ignore this message if we failed to get the arguments */
                 CsrDereferenceThread(CsrThread);
@@ -1109,15 +1112,25 @@ CsrQueryApiPort(VOID)
  *        Pointer to the CSR API Message containing the Capture Buffer
  *        that needs to be validated.
  *
+ * @param ByReference
+ *        Whether the API accepts to work on the data of a large buffer
+ *        directly in the client view of the port section.
+ *
  * @return TRUE if validation succeeded, FALSE otherwise.
  *
- * @remarks None.
+ * @remarks When the data is used by reference, only the header and the
+ *          pointer offsets of the buffer are captured, so that they cannot
+ *          change after validation. The data itself stays shared with the
+ *          client, whose other threads can still modify it: only the APIs
+ *          which never read it, but only write their results to it, may
+ *          ask for it to be used by reference.
  *
  *--*/
 BOOLEAN
 NTAPI
 CsrCaptureArguments(IN PCSR_THREAD CsrThread,
-                    IN PCSR_API_MESSAGE ApiMessage)
+                    IN PCSR_API_MESSAGE ApiMessage,
+                    IN BOOLEAN ByReference)
 {
     PCSR_PROCESS CsrProcess = CsrThread->Process;
     PCSR_CAPTURE_BUFFER ClientCaptureBuffer, ServerCaptureBuffer = NULL;
@@ -1203,8 +1216,16 @@ CsrCaptureArguments(IN PCSR_THREAD CsrThread,
     }
     _SEH2_END;
 
-    /* We validated the client buffer, now allocate the server buffer */
-    ServerCaptureBuffer = RtlAllocateHeap(CsrHeap, HEAP_ZERO_MEMORY, Length);
+    /* Only large buffers are worth being used by reference */
+    if (Length < CSR_CAPTURE_BY_REFERENCE_THRESHOLD) ByReference = FALSE;
+
+    /*
+     * We validated the client buffer, now allocate the server buffer,
+     * or only its header if the data is used by reference.
+     */
+    ServerCaptureBuffer = RtlAllocateHeap(CsrHeap,
+                                          HEAP_ZERO_MEMORY,
+                                          ByReference ? SizeOfBufferThroughOffsetsArray : Length);
     if (!ServerCaptureBuffer)
     {
         /* We're out of memory */
@@ -1218,7 +1239,9 @@ CsrCaptureArguments(IN PCSR_THREAD CsrThread,
      */
     _SEH2_TRY
     {
-        RtlMoveMemory(ServerCaptureBuffer, ClientCaptureBuffer, Length);
+        RtlMoveMemory(ServerCaptureBuffer,
+                      ClientCaptureBuffer,
+                      ByReference ? SizeOfBufferThroughOffsetsArray : Length);
     }
     _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
     {
@@ -1236,8 +1259,21 @@ CsrCaptureArguments(IN PCSR_THREAD CsrThread,
     ServerCaptureBuffer->Size = Length;
     ServerCaptureBuffer->PointerCount = PointerCount;
 
-    /* Calculate the difference between our buffer and the client's */
-    BufferDistance = (ULONG_PTR)ServerCaptureBuffer - (ULONG_PTR)ClientCaptureBuffer;
+    /*
+     * Calculate the difference between our buffer and the client's.
+     * The pointers keep pointing to the client's buffer when the data
+     * is used by reference, which is remembered in BufferEnd.
+     */
+    if (ByReference)
+    {
+        BufferDistance = 0;
+        ServerCaptureBuffer->BufferEnd = ClientCaptureBuffer;
+    }
+    else
+    {
+        BufferDistance = (ULONG_PTR)ServerCaptureBuffer - (ULONG_PTR)ClientCaptureBuffer;
+        ServerCaptureBuffer->BufferEnd = NULL;
+    }
 
     /*
      * All the pointer offsets correspond to pointers that point
@@ -1351,6 +1387,13 @@ CsrReleaseCapturedArguments(IN PCSR_API_MESSAGE ApiMessage)
     ServerCaptureBuffer->PreviousCaptureBuffer = NULL;
     ApiMessage->CsrCaptureData = ClientCaptureBuffer;
 
+    /* If the data was used by reference, the client already has it */
+    if (CsrIsCaptureBufferByReference(ServerCaptureBuffer, ClientCaptureBuffer))
+    {
+        RtlFreeHeap(CsrHeap, 0, ServerCaptureBuffer);
+        return;
+    }
+
     /* Calculate the difference between our buffer and the client's */
     BufferDistance = (ULONG_PTR)ServerCaptureBuffer - (ULONG_PTR)ClientCaptureBuffer;
 
@@ -1430,6 +1473,7 @@ CsrValidateMessageBuffer(IN PCSR_API_MESSAGE ApiMessage,
 {
     PCSR_CAPTURE_BUFFER CaptureBuffer = ApiMessage->CsrCaptureData;
     SIZE_T BufferDistance = (ULONG_PTR)Buffer - (ULONG_PTR)ApiMessage;
+    ULONG_PTR BufferStart;
     ULONG PointerCount;
     PULONG_PTR OffsetPointer;
 
@@ -1460,8 +1504,13 @@ CsrValidateMessageBuffer(IN PCSR_API_MESSAGE ApiMessage,
     }
     else
     {
+        /* The data of a buffer used by reference is in the client's buffer */
+        BufferStart = (ULONG_PTR)CaptureBuffer;
+        if (CsrIsCaptureBufferByReference(CaptureBuffer, CaptureBuffer->PreviousCaptureBuffer))
+            BufferStart = (ULONG_PTR)CaptureBuffer->PreviousCaptureBuffer;
+
         /* Make sure that there is still space left in the capture buffer */
-        if ((CaptureBuffer->Size - (ULONG_PTR)*Buffer + (ULONG_PTR)CaptureBuffer) >=
+        if ((CaptureBuffer->Size - (ULONG_PTR)*Buffer + BufferStart) >=
             (ElementCount * ElementSize))
         {
             /* Perform the validation test */
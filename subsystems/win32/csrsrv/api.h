@@ -75,10 +75,22 @@ NTAPI
 CsrServerDllInitialization(IN PCSR_SERVER_DLL LoadedServerDll);
 
 
+/*
+ * Capture buffers at least this large are used in place, in the client view
+ * of the port section, by the APIs which allow it (see ByReferenceTable).
+ * These must only write to the data, never trust what they read from it.
+ */
+#define CSR_CAPTURE_BY_REFERENCE_THRESHOLD  PORT_MAXIMUM_MESSAGE_LENGTH
+
+/* A server capture buffer used by reference points to the client's in BufferEnd */
+#define CsrIsCaptureBufferByReference(ServerBuffer, ClientBuffer) \
+    ((ClientBuffer) && (ServerBuffer)->BufferEnd == (PVOID)(ClientBuffer))
+
 BOOLEAN
 NTAPI
 CsrCaptureArguments(IN PCSR_THREAD CsrThread,
-                    IN PCSR_API_MESSAGE ApiMessage);
+                    IN PCSR_API_MESSAGE ApiMessage,
+                    IN BOOLEAN ByReference);
 
 VOID
 NTAPI
@@ -402,6 +402,10 @@ GdiAllocBatchCommand(
     else if (Cmd == GdiBCSelObj) cjSize = sizeof(GDIBSOBJECT);
     else if (Cmd == GdiBCDelRgn) cjSize = sizeof(GDIBSOBJECT);
     else if (Cmd == GdiBCDelObj) cjSize = sizeof(GDIBSOBJECT);
+    else if (Cmd == GdiBCSetPixel) cjSize = sizeof(GDIBSSETPIXEL);
+    else if (Cmd == GdiBCLineTo) cjSize = sizeof(GDIBSLINETO);
+    else if (Cmd == GdiBCRectangle) cjSize = sizeof(GDIBSRECTANGLE);
+    else if (Cmd == GdiBCPolyline) cjSize = sizeof(GDIBSPOLYLINE);
     else cjSize = 0;
 
     /* Unsupported operation */
@@ -11,10 +11,38 @@ LineTo(
     _In_ INT x,
     _In_ INT y )
 {
+    PDC_ATTR pdcattr;
+
     HANDLE_METADC(BOOL, LineTo, FALSE, hdc, x, y);
 
     if ( GdiConvertAndCheckDC(hdc) == NULL ) return FALSE;
 
+    /* Get the DC attribute, the start point must be known in logical units */
+    pdcattr = GdiGetDcAttr(hdc);
+    if (pdcattr && !(pdcattr->ulDirty_ & (DC_DIBSECTION | DIRTY_PTLCURRENT)))
+    {
+        PGDIBSLINETO pgO;
+
+        pgO = GdiAllocBatchCommand(hdc, GdiBCLineTo);
+        if (pgO)
+        {
+            pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+            pgO->ptlStart = pdcattr->ptlCurrent;
+            pgO->ptlEnd.x = x;
+            pgO->ptlEnd.y = y;
+            /* Snapshot attributes */
+            pgO->hpen     = pdcattr->hpen;
+            pgO->crPenClr = pdcattr->crPenClr;
+            pgO->ulPenClr = pdcattr->ulPenClr;
+            /* Move the current position now, like win32k will do */
+            pdcattr->ptlCurrent.x = x;
+            pdcattr->ptlCurrent.y = y;
+            pdcattr->ulDirty_ &= ~DIRTY_PTLCURRENT;
+            pdcattr->ulDirty_ |= (DIRTY_PTFXCURRENT|DIRTY_STYLESTATE);
+            return TRUE;
+        }
+    }
+
     return NtGdiLineTo(hdc, x, y);
 }
 
@@ -95,10 +123,37 @@ Rectangle(
     _In_ INT right,
     _In_ INT bottom)
 {
+    PDC_ATTR pdcattr;
+
     HANDLE_METADC(BOOL, Rectangle, FALSE, hdc, left, top, right, bottom);
 
     if ( GdiConvertAndCheckDC(hdc) == NULL ) return FALSE;
 
+    /* Get the DC attribute */
+    pdcattr = GdiGetDcAttr(hdc);
+    if (pdcattr && !(pdcattr->ulDirty_ & DC_DIBSECTION))
+    {
+        PGDIBSRECTANGLE pgO;
+
+        pgO = GdiAllocBatchCommand(hdc, GdiBCRectangle);
+        if (pgO)
+        {
+            pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+            pgO->rcl.left   = left;
+            pgO->rcl.top    = top;
+            pgO->rcl.right  = right;
+            pgO->rcl.bottom = bottom;
+            /* Snapshot attributes */
+            pgO->hpen       = pdcattr->hpen;
+            pgO->hbrush     = pdcattr->hbrush;
+            pgO->crPenClr   = pdcattr->crPenClr;
+            pgO->ulPenClr   = pdcattr->ulPenClr;
+            pgO->crBrushClr = pdcattr->crBrushClr;
+            pgO->ulBrushClr = pdcattr->ulBrushClr;
+            return TRUE;
+        }
+    }
+
     return NtGdiRectangle(hdc, left, top, right, bottom);
 }
 
@@ -171,6 +226,29 @@ SetPixelV(
     _In_ INT y,
     _In_ COLORREF crColor)
 {
+    PDC_ATTR pdcattr;
+
+    /* SetPixelV doesn't return the color, so it can be batched for plain DCs */
+    if ((GDI_HANDLE_GET_TYPE(hdc) == GDILoObjType_LO_DC_TYPE) &&
+        (GdiConvertAndCheckDC(hdc) != NULL))
+    {
+        pdcattr = GdiGetDcAttr(hdc);
+        if (pdcattr && !(pdcattr->ulDirty_ & DC_DIBSECTION))
+        {
+            PGDIBSSETPIXEL pgO;
+
+            pgO = GdiAllocBatchCommand(hdc, GdiBCSetPixel);
+            if (pgO)
+            {
+                pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+                pgO->x       = x;
+                pgO->y       = y;
+                pgO->crColor = crColor;
+                return TRUE;
+            }
+        }
+    }
+
     return SetPixel(hdc, x, y, crColor) != CLR_INVALID;
 }
 
@@ -338,10 +416,45 @@ Polyline(
     _In_reads_(cpt) const POINT *apt,
     _In_ INT cpt)
 {
+    PDC_ATTR pdcattr;
+
     HANDLE_METADC(BOOL, Polyline, FALSE, hdc, apt, cpt);
 
     if ( GdiConvertAndCheckDC(hdc) == NULL ) return FALSE;
 
+    /* Get the DC attribute, small polylines go through the batch */
+    pdcattr = GdiGetDcAttr(hdc);
+    if ((cpt >= 2) && (cpt <= (INT)(GDIBATCHBUFSIZE / sizeof(POINT))) &&
+        pdcattr && !(pdcattr->ulDirty_ & DC_DIBSECTION))
+    {
+        PGDIBSPOLYLINE pgO;
+        PTEB pTeb = NtCurrentTeb();
+
+        pgO = GdiAllocBatchCommand(hdc, GdiBCPolyline);
+        if (pgO)
+        {
+            USHORT cjSize = (cpt - 1) * sizeof(POINT);
+
+            if ((pTeb->GdiTebBatch.Offset + cjSize) <= GDIBATCHBUFSIZE)
+            {
+                pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+                pgO->Count = cpt;
+                /* Snapshot attributes */
+                pgO->hpen     = pdcattr->hpen;
+                pgO->crPenClr = pdcattr->crPenClr;
+                pgO->ulPenClr = pdcattr->ulPenClr;
+                RtlCopyMemory(pgO->apt, apt, cpt * sizeof(POINT));
+                // Recompute offset and return size, remember one is already accounted for in the structure.
+                pTeb->GdiTebBatch.Offset += cjSize;
+                ((PGDIBATCHHDR)pgO)->Size += cjSize;
+                return TRUE;
+            }
+            // Reset offset and count then fall through
+            pTeb->GdiTebBatch.Offset -= sizeof(GDIBSPOLYLINE);
+            pTeb->GdiBatchCount--;
+        }
+    }
+
     return NtGdiPolyPolyDraw(hdc, (PPOINT)apt, (PULONG)&cpt, 1, GdiPolyPolyLine);
 }
 
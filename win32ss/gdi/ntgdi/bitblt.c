@@ -1415,33 +1415,23 @@ NtGdiInvertRgn(
 }
 
 COLORREF
-APIENTRY
-NtGdiSetPixel(
-    _In_ HDC hdc,
+FASTCALL
+IntGdiSetPixel(
+    _In_ PDC pdc,
     _In_ INT x,
     _In_ INT y,
     _In_ COLORREF crColor)
 {
-    PDC pdc;
     ULONG iOldColor, iSolidColor;
     BOOL bResult;
     PEBRUSHOBJ pebo;
     ULONG ulDirty;
     EXLATEOBJ exlo;
 
-    /* Lock the DC */
-    pdc = DC_LockDc(hdc);
-    if (!pdc)
-    {
-        EngSetLastError(ERROR_INVALID_HANDLE);
-        return -1;
-    }
-
     /* Check if the DC has no surface (empty mem or info DC) */
     if (pdc->dclevel.pSurface == NULL)
     {
         /* Fail! */
-        DC_UnlockDc(pdc);
         return -1;
     }
 
@@ -1496,11 +1486,35 @@ NtGdiSetPixel(
     /* Cleanup and return the target format color */
     EXLATEOBJ_vCleanup(&exlo);
 
+    /* Return the new RGB color or -1 on failure */
+    return bResult ? crColor : -1;
+}
+
+COLORREF
+APIENTRY
+NtGdiSetPixel(
+    _In_ HDC hdc,
+    _In_ INT x,
+    _In_ INT y,
+    _In_ COLORREF crColor)
+{
+    PDC pdc;
+
+    /* Lock the DC */
+    pdc = DC_LockDc(hdc);
+    if (!pdc)
+    {
+        EngSetLastError(ERROR_INVALID_HANDLE);
+        return -1;
+    }
+
+    /* Call the internal function */
+    crColor = IntGdiSetPixel(pdc, x, y, crColor);
+
     /* Unlock the DC */
     DC_UnlockDc(pdc);
 
-    /* Return the new RGB color or -1 on failure */
-    return bResult ? crColor : -1;
+    return crColor;
 }
 
 COLORREF
@@ -685,6 +685,24 @@ NtGdiRectangle(HDC  hDC,
         return FALSE;
     }
 
+    ret = IntGdiRectangle(dc, LeftRect, TopRect, RightRect, BottomRect);
+
+    DC_UnlockDc(dc);
+
+    return ret;
+}
+
+/* Same as NtGdiRectangle, for an already locked DC */
+BOOL
+FASTCALL
+IntGdiRectangle(PDC  dc,
+                int  LeftRect,
+                int  TopRect,
+                int  RightRect,
+                int  BottomRect)
+{
+    BOOL ret;
+
     /* Do we rotate or shear? */
     if (!(dc->pdcattr->mxWorldToDevice.flAccel & XFORM_SCALE))
     {
@@ -703,8 +721,6 @@ NtGdiRectangle(HDC  hDC,
         ret = IntRectangle(dc, LeftRect, TopRect, RightRect, BottomRect );
     }
 
-    DC_UnlockDc(dc);
-
     return ret;
 }
 
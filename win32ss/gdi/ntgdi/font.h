@@ -1,6 +1,18 @@
 #pragma once
 
 
+/*
+ * FONT_CATALOG_ENTRY --- the enumeration data of a font, built on first use
+ * so that font enumeration and font matching don't have to compute the
+ * outline metrics of every font again and again.
+ */
+typedef struct _FONT_CATALOG_ENTRY
+{
+    ULONG FamilyNameHash;
+    ULONG FullNameHash;
+    FONTFAMILYINFO Info;
+} FONT_CATALOG_ENTRY, *PFONT_CATALOG_ENTRY;
+
 typedef struct _FONT_ENTRY
 {
     LIST_ENTRY ListEntry;
@@ -8,6 +20,7 @@ typedef struct _FONT_ENTRY
     UNICODE_STRING FaceName;
     UNICODE_STRING StyleName;
     BYTE NotEnum;
+    PFONT_CATALOG_ENTRY Catalog;
 } FONT_ENTRY, *PFONT_ENTRY;
 
 typedef struct _FONT_ENTRY_MEM
@@ -353,6 +353,9 @@ CleanupFontEntryEx(PFONT_ENTRY FontEntry, PFONTGDI FontGDI)
     if (FontEntry->FaceName.Buffer)
         RtlFreeUnicodeString(&FontEntry->FaceName);
 
+    if (FontEntry->Catalog)
+        ExFreePoolWithTag(FontEntry->Catalog, TAG_FONT);
+
     EngFreeMem(FontGDI);
     SharedFace_Release(SharedFace);
     ExFreePoolWithTag(FontEntry, TAG_FONT);
@@ -1145,6 +1148,7 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
         EngSetLastError(ERROR_NOT_ENOUGH_MEMORY);
         return 0;   /* failure */
     }
+    Entry->Catalog = NULL;
 
     /* allocate a FONTGDI */
     FontGDI = EngAllocMem(FL_ZERO_MEMORY, sizeof(FONTGDI), GDITAG_RFONT);
@@ -2794,7 +2798,8 @@ IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
     return Status;
 }
 
-static void FASTCALL
+/* Returns FALSE if the info couldn't be filled in completely */
+static BOOL FASTCALL
 FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
                    LPCWSTR FullName, PFONTGDI FontGDI)
 {
@@ -2820,13 +2825,13 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     Otm = ExAllocatePoolWithTag(PagedPool, Size, GDITAG_TEXT);
     if (!Otm)
     {
-        return;
+        return FALSE;
     }
     Size = IntGetOutlineTextMetrics(FontGDI, Size, Otm);
     if (!Size)
     {
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
-        return;
+        return FALSE;
     }
 
     Lf = &Info->EnumLogFontEx.elfLogFont;
@@ -2897,7 +2902,7 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     if (!NT_SUCCESS(status))
     {
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
-        return;
+        return FALSE;
     }
     Info->EnumLogFontEx.elfScript[0] = UNICODE_NULL;
 
@@ -2906,9 +2911,10 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
 
     if (!pOS2)
     {
+        /* only raster fonts come without an OS/2 table, and this is all they have */
         IntUnLockFreeType();
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
-        return;
+        return !FT_IS_SFNT(Face);
     }
 
     Ntm->ntmSizeEM = Otm->otmEMSquare;
@@ -2976,6 +2982,109 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
         }
     }
     Info->NewTextMetricEx.ntmFontSig = fs;
+    return TRUE;
+}
+
+/* Hashes a face name the way _wcsnicmp compares the first LF_FACESIZE - 1 characters */
+static ULONG FASTCALL
+IntHashFaceName(LPCWSTR Name)
+{
+    ULONG Hash = 0;
+    SIZE_T i;
+
+    for (i = 0; i < LF_FACESIZE - 1 && Name[i] != UNICODE_NULL; ++i)
+    {
+        Hash = Hash * 31 + towlower(Name[i]);
+    }
+
+    return Hash;
+}
+
+/*
+ * The font list lock of the entry must be held. Returns NULL if the entry
+ * couldn't be built; it is tried again the next time.
+ */
+static PFONT_CATALOG_ENTRY FASTCALL
+IntGetFontCatalogEntry(PFONT_ENTRY FontEntry)
+{
+    PFONT_CATALOG_ENTRY Catalog = FontEntry->Catalog;
+    PFONTGDI FontGDI = FontEntry->Font;
+    FT_Face Face = FontGDI->SharedFace->Face;
+    LONG tmHeight, tmAscent, tmDescent, tmInternalLeading, EmHeight;
+    FT_Size_Metrics SizeMetrics;
+    FT_Size_RequestRec req;
+    BOOL Filled;
+
+    if (Catalog)
+        return Catalog;
+
+    Catalog = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_CATALOG_ENTRY), TAG_FONT);
+    if (!Catalog)
+        return NULL;
+
+    /* describe the font at the default size it was loaded with */
+    IntLockFreeType();
+    tmHeight = FontGDI->tmHeight;
+    tmAscent = FontGDI->tmAscent;
+    tmDescent = FontGDI->tmDescent;
+    tmInternalLeading = FontGDI->tmInternalLeading;
+    EmHeight = FontGDI->EmHeight;
+    SizeMetrics = Face->size->metrics;
+    IntRequestFontSize(NULL, FontGDI, 0, 0);
+    IntUnLockFreeType();
+
+    Filled = FontFamilyFillInfo(&Catalog->Info, NULL, NULL, FontGDI);
+
+    /* put back the size the face was last requested at */
+    IntLockFreeType();
+    FontGDI->tmHeight = tmHeight;
+    FontGDI->tmAscent = tmAscent;
+    FontGDI->tmDescent = tmDescent;
+    FontGDI->tmInternalLeading = tmInternalLeading;
+    FontGDI->EmHeight = EmHeight;
+    if (FT_IS_SCALABLE(Face))
+    {
+        /* IntRequestFontSize always requests the em height this way */
+        req.type           = FT_SIZE_REQUEST_TYPE_NOMINAL;
+        req.width          = 0;
+        req.height         = (EmHeight << 6);
+        req.horiResolution = 0;
+        req.vertResolution = 0;
+        if (FT_Request_Size(Face, &req))
+            Face->size->metrics = SizeMetrics;
+    }
+    else
+    {
+        /* bitmap strikes can't be requested back, their metrics are all there is */
+        Face->size->metrics = SizeMetrics;
+    }
+    IntUnLockFreeType();
+
+    if (!Filled)
+    {
+        ExFreePoolWithTag(Catalog, TAG_FONT);
+        return NULL;
+    }
+
+    Catalog->FamilyNameHash =
+        IntHashFaceName(Catalog->Info.EnumLogFontEx.elfLogFont.lfFaceName);
+    Catalog->FullNameHash =
+        IntHashFaceName(Catalog->Info.EnumLogFontEx.elfFullName);
+
+    FontEntry->Catalog = Catalog;
+    return Catalog;
+}
+
+/* Returns FALSE if the face name can't be the family or full name of the font */
+static __inline BOOL FASTCALL
+IntFontCatalogMayMatchName(PFONT_ENTRY FontEntry, ULONG NameHash)
+{
+    PFONT_CATALOG_ENTRY Catalog = IntGetFontCatalogEntry(FontEntry);
+
+    if (!Catalog)
+        return TRUE;
+
+    return (Catalog->FamilyNameHash == NameHash || Catalog->FullNameHash == NameHash);
 }
 
 static BOOLEAN FASTCALL
@@ -2988,9 +3097,14 @@ GetFontFamilyInfoForList(const LOGFONTW *LogFont,
 {
     PLIST_ENTRY Entry;
     PFONT_ENTRY CurrentEntry;
+    PFONT_CATALOG_ENTRY Catalog;
     FONTGDI *FontGDI;
     FONTFAMILYINFO InfoEntry;
     LONG Count = *pCount;
+    ULONG NameHash = 0;
+
+    if (LogFont->lfFaceName[0] != UNICODE_NULL)
+        NameHash = IntHashFaceName(LogFont->lfFaceName);
 
     for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
     {
@@ -3005,10 +3119,22 @@ GetFontFamilyInfoForList(const LOGFONTW *LogFont,
         }
 
         /* get one info entry */
-        FontFamilyFillInfo(&InfoEntry, NULL, NULL, FontGDI);
+        Catalog = IntGetFontCatalogEntry(CurrentEntry);
+        if (Catalog)
+            RtlCopyMemory(&InfoEntry, &Catalog->Info, sizeof(InfoEntry));
+        else
+            FontFamilyFillInfo(&InfoEntry, NULL, NULL, FontGDI);
 
         if (LogFont->lfFaceName[0] != UNICODE_NULL)
         {
+            /* most of the fonts are rejected by the name hashes */
+            if (Catalog &&
+                Catalog->FamilyNameHash != NameHash &&
+                Catalog->FullNameHash != NameHash)
+            {
+                continue;
+            }
+
             /* check name */
             if (_wcsnicmp(LogFont->lfFaceName,
                           InfoEntry.EnumLogFontEx.elfLogFont.lfFaceName,
@@ -5034,6 +5160,8 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
     OUTLINETEXTMETRICW *Otm = NULL;
     UINT OtmSize, OldOtmSize = 0;
     FT_Face Face;
+    ULONG NameHash = 0;
+    UINT Pass, PassCount = 1;
 
     ASSERT(FontObj);
     ASSERT(MatchPenalty);
@@ -5044,42 +5172,65 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
     OldOtmSize = 0x200;
     Otm = ExAllocatePoolWithTag(PagedPool, OldOtmSize, GDITAG_TEXT);
 
-    /* get the FontObj of lowest penalty */
-    for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
+    /*
+     * If a face name is requested, first score the fonts whose catalog name
+     * hash matches it. All the other fonts get the FaceName penalty of 10000,
+     * so they are only scored if nothing better was found.
+     */
+    if (LogFont->lfFaceName[0] != UNICODE_NULL)
     {
-        CurrentEntry = CONTAINING_RECORD(Entry, FONT_ENTRY, ListEntry);
-
-        FontGDI = CurrentEntry->Font;
-        ASSERT(FontGDI);
-        Face = FontGDI->SharedFace->Face;
+        NameHash = IntHashFaceName(LogFont->lfFaceName);
+        PassCount = 2;
+    }
 
-        /* get text metrics */
-        OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
-        if (OtmSize > OldOtmSize)
-        {
-            if (Otm)
-                ExFreePoolWithTag(Otm, GDITAG_TEXT);
-            Otm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
-        }
+    /* get the FontObj of lowest penalty */
+    for (Pass = 0; Pass < PassCount; ++Pass)
+    {
+        if (Pass == 1 && *MatchPenalty <= 10000)
+            break;
 
-        /* update FontObj if lowest penalty */
-        if (Otm)
+        for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
         {
-            IntLockFreeType();
-            IntRequestFontSize(NULL, FontGDI, LogFont->lfWidth, LogFont->lfHeight);
-            IntUnLockFreeType();
+            CurrentEntry = CONTAINING_RECORD(Entry, FONT_ENTRY, ListEntry);
 
-            OtmSize = IntGetOutlineTextMetrics(FontGDI, OtmSize, Otm);
-            if (!OtmSize)
+            if (PassCount == 2 &&
+                IntFontCatalogMayMatchName(CurrentEntry, NameHash) != (Pass == 0))
+            {
                 continue;
+            }
 
-            OldOtmSize = OtmSize;
+            FontGDI = CurrentEntry->Font;
+            ASSERT(FontGDI);
+            Face = FontGDI->SharedFace->Face;
 
-            Penalty = GetFontPenalty(LogFont, Otm, Face->style_name);
-            if (*MatchPenalty == 0xFFFFFFFF || Penalty < *MatchPenalty)
+            /* get text metrics */
+            OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
+            if (OtmSize > OldOtmSize)
             {
-                *FontObj = GDIToObj(FontGDI, FONT);
-                *MatchPenalty = Penalty;
+                if (Otm)
+                    ExFreePoolWithTag(Otm, GDITAG_TEXT);
+                Otm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
+            }
+
+            /* update FontObj if lowest penalty */
+            if (Otm)
+            {
+                IntLockFreeType();
+                IntRequestFontSize(NULL, FontGDI, LogFont->lfWidth, LogFont->lfHeight);
+                IntUnLockFreeType();
+
+                OtmSize = IntGetOutlineTextMetrics(FontGDI, OtmSize, Otm);
+                if (!OtmSize)
+                    continue;
+
+                OldOtmSize = OtmSize;
+
+                Penalty = GetFontPenalty(LogFont, Otm, Face->style_name);
+                if (*MatchPenalty == 0xFFFFFFFF || Penalty < *MatchPenalty)
+                {
+                    *FontObj = GDIToObj(FontGDI, FONT);
+                    *MatchPenalty = Penalty;
+                }
             }
         }
     }
@@ -453,6 +453,125 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
         break;
      }
 
+     case GdiBCSetPixel:
+     {
+        PGDIBSSETPIXEL pgO;
+        if (!dc) break;
+        pgO = (PGDIBSSETPIXEL) pHdr;
+        IntGdiSetPixel(dc, pgO->x, pgO->y, pgO->crColor);
+        break;
+     }
+
+     case GdiBCLineTo:
+     {
+        PGDIBSLINETO pgO;
+        HANDLE hOrgPen;
+        COLORREF crPenClr;
+        ULONG ulPenClr;
+        POINTL ptlCurrent;
+        DWORD flags;
+        if (!dc) break;
+        pgO = (PGDIBSLINETO) pHdr;
+        // Save current attributes and flags
+        hOrgPen    = pdcattr->hpen;
+        crPenClr   = pdcattr->crPenClr;
+        ulPenClr   = pdcattr->ulPenClr;
+        ptlCurrent = pdcattr->ptlCurrent;
+        flags = pdcattr->ulDirty_ & (DIRTY_PTLCURRENT | DIRTY_PTFXCURRENT | DIRTY_STYLESTATE);
+        // Set the attribute snapshot, the pen is realized again by IntLineTo
+        pdcattr->hpen       = pgO->hpen;
+        pdcattr->crPenClr   = pgO->crPenClr;
+        pdcattr->ulPenClr   = pgO->ulPenClr;
+        pdcattr->ptlCurrent = pgO->ptlStart;
+        pdcattr->ulDirty_ &= ~DIRTY_PTLCURRENT;
+        pdcattr->ulDirty_ |= DIRTY_LINE | DC_PEN_DIRTY | DIRTY_PTFXCURRENT | DIRTY_STYLESTATE;
+        /* Call the internal function */
+        IntLineTo(dc, pgO->ptlEnd.x, pgO->ptlEnd.y);
+        // Restore attributes and flags. The current position was already moved by gdi32.
+        pdcattr->hpen       = hOrgPen;
+        pdcattr->crPenClr   = crPenClr;
+        pdcattr->ulPenClr   = ulPenClr;
+        pdcattr->ptlCurrent = ptlCurrent;
+        pdcattr->ulDirty_ &= ~(DIRTY_PTLCURRENT | DIRTY_PTFXCURRENT | DIRTY_STYLESTATE);
+        pdcattr->ulDirty_ |= flags | DIRTY_LINE | DC_PEN_DIRTY;
+        break;
+     }
+
+     case GdiBCRectangle:
+     {
+        PGDIBSRECTANGLE pgO;
+        HANDLE hOrgPen, hOrgBrush;
+        COLORREF crPenClr, crBrushClr;
+        ULONG ulPenClr, ulBrushClr;
+        if (!dc) break;
+        pgO = (PGDIBSRECTANGLE) pHdr;
+        // Save current attributes
+        hOrgPen    = pdcattr->hpen;
+        hOrgBrush  = pdcattr->hbrush;
+        crPenClr   = pdcattr->crPenClr;
+        ulPenClr   = pdcattr->ulPenClr;
+        crBrushClr = pdcattr->crBrushClr;
+        ulBrushClr = pdcattr->ulBrushClr;
+        // Set the attribute snapshot, pen and brush are realized again by IntRectangle
+        pdcattr->hpen       = pgO->hpen;
+        pdcattr->hbrush     = pgO->hbrush;
+        pdcattr->crPenClr   = pgO->crPenClr;
+        pdcattr->ulPenClr   = pgO->ulPenClr;
+        pdcattr->crBrushClr = pgO->crBrushClr;
+        pdcattr->ulBrushClr = pgO->ulBrushClr;
+        pdcattr->ulDirty_ |= DIRTY_LINE | DC_PEN_DIRTY | DIRTY_FILL | DC_BRUSH_DIRTY;
+        /* Call the internal function */
+        IntGdiRectangle(dc, pgO->rcl.left, pgO->rcl.top, pgO->rcl.right, pgO->rcl.bottom);
+        // Restore attributes and flags
+        pdcattr->hpen       = hOrgPen;
+        pdcattr->hbrush     = hOrgBrush;
+        pdcattr->crPenClr   = crPenClr;
+        pdcattr->ulPenClr   = ulPenClr;
+        pdcattr->crBrushClr = crBrushClr;
+        pdcattr->ulBrushClr = ulBrushClr;
+        pdcattr->ulDirty_ |= DIRTY_LINE | DC_PEN_DIRTY | DIRTY_FILL | DC_BRUSH_DIRTY;
+        break;
+     }
+
+     case GdiBCPolyline:
+     {
+        PGDIBSPOLYLINE pgO;
+        HANDLE hOrgPen;
+        COLORREF crPenClr;
+        ULONG ulPenClr, Count;
+        if (!dc) break;
+        pgO = (PGDIBSPOLYLINE) pHdr;
+        Count = pgO->Count;
+        /* The points must fit in the entry */
+        if ((Count < 2) ||
+            (Count > (GDIBATCHBUFSIZE / sizeof(POINT))) ||
+            ((ULONG)Size < FIELD_OFFSET(GDIBSPOLYLINE, apt[Count])))
+        {
+           break;
+        }
+        // Save current attributes
+        hOrgPen  = pdcattr->hpen;
+        crPenClr = pdcattr->crPenClr;
+        ulPenClr = pdcattr->ulPenClr;
+        // Set the attribute snapshot
+        pdcattr->hpen     = pgO->hpen;
+        pdcattr->crPenClr = pgO->crPenClr;
+        pdcattr->ulPenClr = pgO->ulPenClr;
+        pdcattr->ulDirty_ |= DIRTY_LINE | DC_PEN_DIRTY;
+        /* Same as NtGdiPolyPolyDraw with GdiPolyPolyLine */
+        DC_vPrepareDCsForBlit(dc, NULL, NULL, NULL);
+        if (pdcattr->ulDirty_ & (DIRTY_LINE | DC_PEN_DIRTY))
+            DC_vUpdateLineBrush(dc);
+        IntGdiPolyPolyline(dc, pgO->apt, &Count, 1);
+        DC_vFinishBlit(dc, NULL);
+        // Restore attributes and flags
+        pdcattr->hpen     = hOrgPen;
+        pdcattr->crPenClr = crPenClr;
+        pdcattr->ulPenClr = ulPenClr;
+        pdcattr->ulDirty_ |= DIRTY_LINE | DC_PEN_DIRTY;
+        break;
+     }
+
      default:
         break;
   }
@@ -21,6 +21,11 @@ IntGdiLineTo(DC  *dc,
              int XEnd,
              int YEnd);
 
+BOOL FASTCALL
+IntLineTo(DC  *dc,
+          int XEnd,
+          int YEnd);
+
 BOOL FASTCALL
 IntGdiMoveToEx(DC      *dc,
                int     X,
@@ -61,6 +66,19 @@ GreMoveTo( HDC hdc,
 
 /* Shape functions */
 
+BOOL FASTCALL
+IntGdiRectangle(PDC dc,
+                int LeftRect,
+                int TopRect,
+                int RightRect,
+                int BottomRect);
+
+COLORREF FASTCALL
+IntGdiSetPixel(PDC pdc,
+               INT x,
+               INT y,
+               COLORREF crColor);
+
 BOOL
 NTAPI
 GreGradientFill(
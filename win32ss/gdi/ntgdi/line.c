@@ -430,7 +430,6 @@ NtGdiLineTo(HDC  hDC,
 {
     DC *dc;
     BOOL Ret;
-    RECT rcLockRect ;
 
     dc = DC_LockDc(hDC);
     if (!dc)
@@ -439,6 +438,21 @@ NtGdiLineTo(HDC  hDC,
         return FALSE;
     }
 
+    Ret = IntLineTo(dc, XEnd, YEnd);
+
+    DC_UnlockDc(dc);
+    return Ret;
+}
+
+/* Same as NtGdiLineTo, for an already locked DC */
+BOOL FASTCALL
+IntLineTo(DC  *dc,
+          int XEnd,
+          int YEnd)
+{
+    BOOL Ret;
+    RECT rcLockRect ;
+
     rcLockRect.left = dc->pdcattr->ptlCurrent.x;
     rcLockRect.top = dc->pdcattr->ptlCurrent.y;
     rcLockRect.right = XEnd;
@@ -458,7 +472,6 @@ NtGdiLineTo(HDC  hDC,
 
     DC_vFinishBlit(dc, NULL);
 
-    DC_UnlockDc(dc);
     return Ret;
 }
 
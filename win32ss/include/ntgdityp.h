@@ -92,6 +92,11 @@ typedef enum _GDIBATCHCMD
     GdiBCSelObj,
     GdiBCDelObj,
     GdiBCDelRgn,
+    /* ReactOS specific */
+    GdiBCSetPixel,
+    GdiBCLineTo,
+    GdiBCRectangle,
+    GdiBCPolyline,
 } GDIBATCHCMD, *PGDIBATCHCMD;
 
 typedef enum _TRANSFORMTYPE
@@ -197,7 +202,7 @@ typedef DWORD LFTYPE;
 
 /* DEFINES *******************************************************************/
 
-#define GDIBATCHBUFSIZE 0x136*4
+#define GDIBATCHBUFSIZE (0x136*4)
 #define GDI_BATCH_LIMIT 20
 
 // NtGdiGetCharWidthW Flags
@@ -560,6 +565,47 @@ typedef struct _GDIBSOBJECT
   HGDIOBJ hgdiobj;
 } GDIBSOBJECT, *PGDIBSOBJECT;
 
+/* ReactOS specific batch structures. */
+typedef struct _GDIBSSETPIXEL
+{
+  GDIBATCHHDR gbHdr;
+  int x;
+  int y;
+  COLORREF crColor;
+} GDIBSSETPIXEL, *PGDIBSSETPIXEL;
+
+typedef struct _GDIBSLINETO
+{
+  GDIBATCHHDR gbHdr;
+  POINTL ptlStart;
+  POINTL ptlEnd;
+  HANDLE hpen;
+  COLORREF crPenClr;
+  ULONG ulPenClr;
+} GDIBSLINETO, *PGDIBSLINETO;
+
+typedef struct _GDIBSRECTANGLE
+{
+  GDIBATCHHDR gbHdr;
+  RECTL rcl;
+  HANDLE hpen;
+  HANDLE hbrush;
+  COLORREF crPenClr;
+  ULONG ulPenClr;
+  COLORREF crBrushClr;
+  ULONG ulBrushClr;
+} GDIBSRECTANGLE, *PGDIBSRECTANGLE;
+
+typedef struct _GDIBSPOLYLINE
+{
+  GDIBATCHHDR gbHdr;
+  HANDLE hpen;
+  COLORREF crPenClr;
+  ULONG ulPenClr;
+  DWORD Count;
+  POINT apt[1]; // Polyline
+} GDIBSPOLYLINE, *PGDIBSPOLYLINE;
+
 /* Declaration missing in ddk/winddi.h */
 typedef VOID (APIENTRY *PFN_DrvMovePanning)(LONG, LONG, FLONG);
 
@@ -162,6 +162,8 @@ IntDesktopObjectDelete(
     if (pdesk->spwndMessage)
         co_UserDestroyWindow(pdesk->spwndMessage);
 
+    IntFreeHitIndex(pdesk);
+
     /* Remove the desktop from the window station's list of associcated desktops */
     RemoveEntryList(&pdesk->ListEntry);
 
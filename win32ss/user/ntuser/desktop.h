@@ -41,6 +41,8 @@ typedef struct _DESKTOP
     /* Thread blocking input */
     PVOID BlockInputThread;
     LIST_ENTRY ShellHookWindows;
+    /* Spatial index of the top level windows, see hittest.c */
+    struct _WND_HIT_INDEX *pHitIndex;
 } DESKTOP, *PDESKTOP;
 
 // Desktop flags
@@ -0,0 +1,259 @@
+/*
+ * COPYRIGHT:        See COPYING in the top level directory
+ * PROJECT:          ReactOS Win32k subsystem
+ * PURPOSE:          Spatial index of top level windows for hit-testing
+ * FILE:             win32ss/user/ntuser/hittest.c
+ * PROGRAMER:
+ */
+
+/*
+ * Every mouse move has to find the top level window under the cursor.
+ * Instead of walking the whole z-ordered list of top level windows each
+ * time, the desktop area is split in a fixed grid and every cell keeps the
+ * z-ordered list of the windows whose rcWindow overlaps it.
+ *
+ * The index is only marked dirty when a top level window is linked,
+ * unlinked, moved or sized, and it is rebuilt on the next lookup, so long
+ * mouse move streams between two layout changes all hit the same grid.
+ * Style dependent checks (visibility, transparency, window regions,
+ * destruction) stay with the callers, so the index never has to be
+ * updated when those change.
+ */
+
+#include <win32k.h>
+DBG_DEFAULT_CHANNEL(UserWinpos);
+
+/* FUNCTIONS *****************************************************************/
+
+static
+BOOL
+IntGetHitCells(
+    _In_ PWND_HIT_INDEX HitIndex,
+    _In_ PWND pWnd,
+    _Out_ PRECTL prcCells)
+{
+    RECTL rc;
+
+    if (!RECTL_bIntersectRect(&rc, &pWnd->rcWindow, &HitIndex->rcBounds))
+        return FALSE;
+
+    /* Cell coordinates, inclusive */
+    prcCells->left   = (rc.left - HitIndex->rcBounds.left) / HitIndex->cxCell;
+    prcCells->top    = (rc.top - HitIndex->rcBounds.top) / HitIndex->cyCell;
+    prcCells->right  = (rc.right - 1 - HitIndex->rcBounds.left) / HitIndex->cxCell;
+    prcCells->bottom = (rc.bottom - 1 - HitIndex->rcBounds.top) / HitIndex->cyCell;
+    return TRUE;
+}
+
+static
+BOOL
+IntRebuildHitIndex(
+    _Inout_ PWND_HIT_INDEX HitIndex,
+    _In_ PWND pwndDesktop)
+{
+    PWND pWnd;
+    RECTL rcCells;
+    ULONG cEntries, iCell, cpwndMax;
+    LONG x, y, cx, cy;
+
+    HitIndex->rcBounds = pwndDesktop->rcWindow;
+    cx = HitIndex->rcBounds.right - HitIndex->rcBounds.left;
+    cy = HitIndex->rcBounds.bottom - HitIndex->rcBounds.top;
+    if (cx <= 0 || cy <= 0)
+        return FALSE;
+
+    HitIndex->cxCell = (cx + HITINDEX_CELLS_X - 1) / HITINDEX_CELLS_X;
+    HitIndex->cyCell = (cy + HITINDEX_CELLS_Y - 1) / HITINDEX_CELLS_Y;
+
+    /* First pass: count the windows of each cell in aiFirst[iCell + 1] */
+    RtlZeroMemory(HitIndex->aiFirst, sizeof(HitIndex->aiFirst));
+    cEntries = 0;
+    for (pWnd = pwndDesktop->spwndChild; pWnd != NULL; pWnd = pWnd->spwndNext)
+    {
+        if (!IntGetHitCells(HitIndex, pWnd, &rcCells))
+            continue;
+
+        for (y = rcCells.top; y <= rcCells.bottom; y++)
+        {
+            for (x = rcCells.left; x <= rcCells.right; x++)
+            {
+                HitIndex->aiFirst[y * HITINDEX_CELLS_X + x + 1]++;
+                cEntries++;
+            }
+        }
+    }
+
+    /* Grow the entry array geometrically */
+    if (cEntries > HitIndex->cpwndMax)
+    {
+        cpwndMax = max(cEntries, 2 * HitIndex->cpwndMax);
+
+        if (HitIndex->apwnd)
+            ExFreePoolWithTag(HitIndex->apwnd, TAG_HITINDEX);
+
+        HitIndex->apwnd = ExAllocatePoolWithTag(PagedPool,
+                                                cpwndMax * sizeof(PWND),
+                                                TAG_HITINDEX);
+        if (!HitIndex->apwnd)
+        {
+            HitIndex->cpwndMax = 0;
+            return FALSE;
+        }
+        HitIndex->cpwndMax = cpwndMax;
+    }
+
+    /* aiFirst[iCell] becomes the first slot of each cell */
+    for (iCell = 1; iCell <= HITINDEX_CELLS; iCell++)
+        HitIndex->aiFirst[iCell] += HitIndex->aiFirst[iCell - 1];
+
+    /* Second pass: fill the cells in z-order, using aiFirst[] as cursor */
+    for (pWnd = pwndDesktop->spwndChild; pWnd != NULL; pWnd = pWnd->spwndNext)
+    {
+        if (!IntGetHitCells(HitIndex, pWnd, &rcCells))
+            continue;
+
+        for (y = rcCells.top; y <= rcCells.bottom; y++)
+        {
+            for (x = rcCells.left; x <= rcCells.right; x++)
+            {
+                HitIndex->apwnd[HitIndex->aiFirst[y * HITINDEX_CELLS_X + x]++] = pWnd;
+            }
+        }
+    }
+
+    /* Each cursor now points at the start of the next cell, shift them back */
+    for (iCell = HITINDEX_CELLS; iCell > 0; iCell--)
+        HitIndex->aiFirst[iCell] = HitIndex->aiFirst[iCell - 1];
+    HitIndex->aiFirst[0] = 0;
+
+    HitIndex->bDirty = FALSE;
+    HitIndex->cRebuilds++;
+
+    TRACE("Hit index rebuilt: %lu entries, %lu rebuilds, %lu lookups, %lu fallbacks\n",
+          cEntries, HitIndex->cRebuilds, HitIndex->cLookups, HitIndex->cFallbacks);
+    return TRUE;
+}
+
+/*
+ * Must be called whenever the position, size or z-order of a window
+ * changes. Only top level windows and the desktop window are indexed.
+ */
+VOID
+FASTCALL
+IntInvalidateHitIndex(PWND Wnd)
+{
+    PDESKTOP Desktop;
+
+    if (!Wnd)
+        return;
+
+    if (!UserIsDesktopWindow(Wnd) && !UserIsDesktopWindow(Wnd->spwndParent))
+        return;
+
+    Desktop = Wnd->head.rpdesk;
+    if (Desktop && Desktop->pHitIndex)
+        Desktop->pHitIndex->bDirty = TRUE;
+}
+
+VOID
+FASTCALL
+IntFreeHitIndex(PDESKTOP Desktop)
+{
+    PWND_HIT_INDEX HitIndex = Desktop->pHitIndex;
+
+    if (!HitIndex)
+        return;
+
+    if (HitIndex->apwnd)
+        ExFreePoolWithTag(HitIndex->apwnd, TAG_HITINDEX);
+
+    ExFreePoolWithTag(HitIndex, TAG_HITINDEX);
+    Desktop->pHitIndex = NULL;
+}
+
+/*
+ * Returns the z-ordered top level windows that may contain the point,
+ * or NULL if the index cannot answer and the caller has to walk the
+ * full list of top level windows.
+ */
+PWND*
+FASTCALL
+IntHitIndexLookup(PWND pwndDesktop, INT x, INT y, PULONG pcWnds)
+{
+    PDESKTOP Desktop = pwndDesktop->head.rpdesk;
+    PWND_HIT_INDEX HitIndex;
+    ULONG iCell;
+
+    if (!Desktop)
+        return NULL;
+
+    HitIndex = Desktop->pHitIndex;
+    if (!HitIndex)
+    {
+        HitIndex = ExAllocatePoolWithTag(PagedPool, sizeof(WND_HIT_INDEX), TAG_HITINDEX);
+        if (!HitIndex)
+            return NULL;
+
+        RtlZeroMemory(HitIndex, sizeof(WND_HIT_INDEX));
+        HitIndex->bDirty = TRUE;
+        Desktop->pHitIndex = HitIndex;
+    }
+
+    /* The desktop window may have been resized by a mode change */
+    if (HitIndex->bDirty ||
+        !RtlEqualMemory(&HitIndex->rcBounds, &pwndDesktop->rcWindow, sizeof(RECT)))
+    {
+        if (!IntRebuildHitIndex(HitIndex, pwndDesktop))
+        {
+            HitIndex->bDirty = TRUE;
+            HitIndex->cFallbacks++;
+            return NULL;
+        }
+    }
+
+    if (!RECTL_bPointInRect(&HitIndex->rcBounds, x, y))
+    {
+        HitIndex->cFallbacks++;
+        return NULL;
+    }
+
+    iCell = ((y - HitIndex->rcBounds.top) / HitIndex->cyCell) * HITINDEX_CELLS_X +
+            (x - HitIndex->rcBounds.left) / HitIndex->cxCell;
+
+    HitIndex->cLookups++;
+    *pcWnds = HitIndex->aiFirst[iCell + 1] - HitIndex->aiFirst[iCell];
+    return &HitIndex->apwnd[HitIndex->aiFirst[iCell]];
+}
+
+/*
+ * Same as IntWinListChildren for the desktop window, but only returns the
+ * top level windows whose rectangle contains the point. The list must be
+ * freed with ExFreePoolWithTag(List, USERTAG_WINDOWLIST).
+ */
+HWND*
+FASTCALL
+IntHitIndexListWindows(PWND pwndDesktop, INT x, INT y)
+{
+    PWND *ppwnd;
+    HWND *List;
+    ULONG cWnds, i, Index = 0;
+
+    ppwnd = IntHitIndexLookup(pwndDesktop, x, y, &cWnds);
+    if (!ppwnd)
+        return NULL;
+
+    List = ExAllocatePoolWithTag(PagedPool, (cWnds + 1) * sizeof(HWND), USERTAG_WINDOWLIST);
+    if (!List)
+        return NULL;
+
+    for (i = 0; i < cWnds; i++)
+    {
+        if (RECTL_bPointInRect(&ppwnd[i]->rcWindow, x, y))
+            List[Index++] = UserHMGetHandle(ppwnd[i]);
+    }
+    List[Index] = NULL;
+
+    return List;
+}
+
+/* EOF */
@@ -0,0 +1,39 @@
+/*
+ * COPYRIGHT:        See COPYING in the top level directory
+ * PROJECT:          ReactOS Win32k subsystem
+ * PURPOSE:          Spatial index of top level windows for hit-testing
+ * FILE:             win32ss/user/ntuser/hittest.h
+ * PROGRAMER:
+ */
+
+#pragma once
+
+/* The desktop area is split in HITINDEX_CELLS_X x HITINDEX_CELLS_Y cells */
+#define HITINDEX_CELLS_X 16
+#define HITINDEX_CELLS_Y 16
+#define HITINDEX_CELLS   (HITINDEX_CELLS_X * HITINDEX_CELLS_Y)
+
+typedef struct _WND_HIT_INDEX
+{
+    /* Set whenever a top level window is moved, sized or re-linked */
+    BOOL bDirty;
+    /* Area covered by the grid, in screen coordinates */
+    RECT rcBounds;
+    LONG cxCell;
+    LONG cyCell;
+    /* Windows of cell i are apwnd[aiFirst[i]] .. apwnd[aiFirst[i + 1] - 1], in z-order */
+    ULONG aiFirst[HITINDEX_CELLS + 1];
+    PWND *apwnd;
+    ULONG cpwndMax;
+    /* Statistics */
+    ULONG cRebuilds;
+    ULONG cLookups;
+    ULONG cFallbacks;
+} WND_HIT_INDEX, *PWND_HIT_INDEX;
+
+VOID FASTCALL IntInvalidateHitIndex(PWND Wnd);
+VOID FASTCALL IntFreeHitIndex(PDESKTOP Desktop);
+PWND* FASTCALL IntHitIndexLookup(PWND pwndDesktop, INT x, INT y, PULONG pcWnds);
+HWND* FASTCALL IntHitIndexListWindows(PWND pwndDesktop, INT x, INT y);
+
+/* EOF */
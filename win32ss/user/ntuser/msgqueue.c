@@ -57,30 +57,51 @@ MsqInitializeImpl(VOID)
    return(STATUS_SUCCESS);
 }
 
+static BOOL
+IntIsTopLevelWindowAtPoint(PWND pWnd, INT x, INT y)
+{
+    if (pWnd->state2 & WNDS2_INDESTROY || pWnd->state & WNDS_DESTROYED)
+    {
+        TRACE("The Window is in DESTROY!\n");
+        return FALSE;
+    }
+
+    return (pWnd->style & WS_VISIBLE) &&
+           (pWnd->ExStyle & (WS_EX_LAYERED|WS_EX_TRANSPARENT)) != (WS_EX_LAYERED|WS_EX_TRANSPARENT) &&
+           IntPtInWindow(pWnd, x, y);
+}
+
 PWND FASTCALL
 IntTopLevelWindowFromPoint(INT x, INT y)
 {
     PWND pWnd, pwndDesktop;
+    PWND *ppwnd;
+    ULONG cWnds, i;
 
     /* Get the desktop window */
     pwndDesktop = UserGetDesktopWindow();
     if (!pwndDesktop)
         return NULL;
 
+    /* Only look at the top level windows overlapping the point */
+    ppwnd = IntHitIndexLookup(pwndDesktop, x, y, &cWnds);
+    if (ppwnd)
+    {
+        for (i = 0; i < cWnds; i++)
+        {
+            if (IntIsTopLevelWindowAtPoint(ppwnd[i], x, y))
+                return ppwnd[i];
+        }
+
+        return pwndDesktop;
+    }
+
     /* Loop all top level windows */
     for (pWnd = pwndDesktop->spwndChild;
          pWnd != NULL;
          pWnd = pWnd->spwndNext)
     {
-        if (pWnd->state2 & WNDS2_INDESTROY || pWnd->state & WNDS_DESTROYED)
-        {
-            TRACE("The Window is in DESTROY!\n");
-            continue;
-        }
-
-        if ((pWnd->style & WS_VISIBLE) &&
-            (pWnd->ExStyle & (WS_EX_LAYERED|WS_EX_TRANSPARENT)) != (WS_EX_LAYERED|WS_EX_TRANSPARENT) &&
-            IntPtInWindow(pWnd, x, y))
+        if (IntIsTopLevelWindowAtPoint(pWnd, x, y))
             return pWnd;
     }
 
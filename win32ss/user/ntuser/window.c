@@ -929,6 +929,8 @@ IntLinkWindow(
 
         Wnd->spwndParent->spwndChild = Wnd;
     }
+
+    IntInvalidateHitIndex(Wnd);
 }
 
 /*
@@ -1318,6 +1320,8 @@ IntUnlinkWindow(PWND Wnd)
         Wnd->spwndParent->spwndChild = Wnd->spwndNext;
 
     Wnd->spwndPrev = Wnd->spwndNext = NULL;
+
+    IntInvalidateHitIndex(Wnd);
 }
 
 /* FUNCTIONS *****************************************************************/
@@ -2239,6 +2243,7 @@ co_UserCreateWindowEx(CREATESTRUCTW* Cs,
 
    RECTL_vOffsetRect(&Window->rcWindow, MaxPos.x - Window->rcWindow.left,
                                      MaxPos.y - Window->rcWindow.top);
+   IntInvalidateHitIndex(Window);
    }
 
    /* Send the WM_CREATE message. */
@@ -1506,6 +1506,8 @@ WinPosInternalMoveWindow(PWND Window, INT MoveX, INT MoveY)
    Window->rcClient.top += MoveY;
    Window->rcClient.bottom += MoveY;
 
+   IntInvalidateHitIndex(Window);
+
    for(Child = Window->spwndChild; Child; Child = Child->spwndNext)
    {
       WinPosInternalMoveWindow(Child, MoveX, MoveY);
@@ -1885,6 +1887,7 @@ co_WinPosSetWindowPos(
 
    Window->rcWindow = NewWindowRect;
    Window->rcClient = NewClientRect;
+   IntInvalidateHitIndex(Window);
 
    /* erase parent when hiding or resizing child */
    if (WinPos.flags & SWP_HIDEWINDOW)
@@ -2801,7 +2804,12 @@ co_WinPosSearchChildren(
     {
         UserReferenceObject(ScopeWin);
 
-        List = IntWinListChildren(ScopeWin);
+        /* Top level windows not overlapping the point are skipped right away */
+        List = NULL;
+        if (UserIsDesktopWindow(ScopeWin))
+            List = IntHitIndexListWindows(ScopeWin, Point->x, Point->y);
+        if (!List)
+            List = IntWinListChildren(ScopeWin);
         if (List)
         {
             for (phWnd = List; *phWnd; ++phWnd)
@@ -216,6 +216,108 @@ BOOLEAN ConsoleServerApiServerValidTable[ConsolepMaxApiNumber - CONSRV_FIRST_API
     // FALSE,   // SrvConsoleClientConnect,
 };
 
+/*
+ * Large capture buffers of these APIs only receive text or cells, which they
+ * can write directly in the client view of the port section. The client can
+ * change that view at any time, so the APIs which read their data from it
+ * (WriteConsole, WriteConsoleOutput...) always get a private copy instead.
+ */
+BOOLEAN ConsoleServerApiByReferenceTable[ConsolepMaxApiNumber - CONSRV_FIRST_API_NUMBER] =
+{
+    FALSE,   // SrvOpenConsole,
+    FALSE,   // SrvGetConsoleInput,
+    FALSE,   // SrvWriteConsoleInput,
+    TRUE,    // SrvReadConsoleOutput,
+    FALSE,   // SrvWriteConsoleOutput,
+    TRUE,    // SrvReadConsoleOutputString,
+    FALSE,   // SrvWriteConsoleOutputString,
+    FALSE,   // SrvFillConsoleOutput,
+    FALSE,   // SrvGetConsoleMode,
+    FALSE,   // SrvGetConsoleNumberOfFonts,
+    FALSE,   // SrvGetConsoleNumberOfInputEvents,
+    FALSE,   // SrvGetConsoleScreenBufferInfo,
+    FALSE,   // SrvGetConsoleCursorInfo,
+    FALSE,   // SrvGetConsoleMouseInfo,
+    FALSE,   // SrvGetConsoleFontInfo,
+    FALSE,   // SrvGetConsoleFontSize,
+    FALSE,   // SrvGetConsoleCurrentFont,
+    FALSE,   // SrvSetConsoleMode,
+    FALSE,   // SrvSetConsoleActiveScreenBuffer,
+    FALSE,   // SrvFlushConsoleInputBuffer,
+    FALSE,   // SrvGetLargestConsoleWindowSize,
+    FALSE,   // SrvSetConsoleScreenBufferSize,
+    FALSE,   // SrvSetConsoleCursorPosition,
+    FALSE,   // SrvSetConsoleCursorInfo,
+    FALSE,   // SrvSetConsoleWindowInfo,
+    FALSE,   // SrvScrollConsoleScreenBuffer,
+    FALSE,   // SrvSetConsoleTextAttribute,
+    FALSE,   // SrvSetConsoleFont,
+    FALSE,   // SrvSetConsoleIcon,
+    FALSE,   // SrvReadConsole,
+    FALSE,   // SrvWriteConsole,
+    FALSE,   // SrvDuplicateHandle,
+    FALSE,   // SrvGetHandleInformation,
+    FALSE,   // SrvSetHandleInformation,
+    FALSE,   // SrvCloseHandle,
+    FALSE,   // SrvVerifyConsoleIoHandle,
+    FALSE,   // SrvAllocConsole,
+    FALSE,   // SrvFreeConsole,
+    FALSE,   // SrvGetConsoleTitle,
+    FALSE,   // SrvSetConsoleTitle,
+    FALSE,   // SrvCreateConsoleScreenBuffer,
+    FALSE,   // SrvInvalidateBitMapRect,
+    FALSE,   // SrvVDMConsoleOperation,
+    FALSE,   // SrvSetConsoleCursor,
+    FALSE,   // SrvShowConsoleCursor,
+    FALSE,   // SrvConsoleMenuControl,
+    FALSE,   // SrvSetConsolePalette,
+    FALSE,   // SrvSetConsoleDisplayMode,
+    FALSE,   // SrvRegisterConsoleVDM,
+    FALSE,   // SrvGetConsoleHardwareState,
+    FALSE,   // SrvSetConsoleHardwareState,
+    FALSE,   // SrvGetConsoleDisplayMode,
+    FALSE,   // SrvAddConsoleAlias,
+    FALSE,   // SrvGetConsoleAlias,
+    FALSE,   // SrvGetConsoleAliasesLength,
+    FALSE,   // SrvGetConsoleAliasExesLength,
+    FALSE,   // SrvGetConsoleAliases,
+    FALSE,   // SrvGetConsoleAliasExes,
+    FALSE,   // SrvExpungeConsoleCommandHistory,
+    FALSE,   // SrvSetConsoleNumberOfCommands,
+    FALSE,   // SrvGetConsoleCommandHistoryLength,
+    FALSE,   // SrvGetConsoleCommandHistory,
+    FALSE,   // SrvSetConsoleCommandHistoryMode,
+    FALSE,   // SrvGetConsoleCP,
+    FALSE,   // SrvSetConsoleCP,
+    FALSE,   // SrvSetConsoleKeyShortcuts,
+    FALSE,   // SrvSetConsoleMenuClose,
+    FALSE,   // SrvConsoleNotifyLastClose,
+    FALSE,   // SrvGenerateConsoleCtrlEvent,
+    FALSE,   // SrvGetConsoleKeyboardLayoutName,
+    FALSE,   // SrvGetConsoleWindow,
+    FALSE,   // SrvGetConsoleCharType,
+    FALSE,   // SrvSetConsoleLocalEUDC,
+    FALSE,   // SrvSetConsoleCursorMode,
+    FALSE,   // SrvGetConsoleCursorMode,
+    FALSE,   // SrvRegisterConsoleOS2,
+    FALSE,   // SrvSetConsoleOS2OemFormat,
+    FALSE,   // SrvGetConsoleNlsMode,
+    FALSE,   // SrvSetConsoleNlsMode,
+    FALSE,   // SrvRegisterConsoleIME,
+    FALSE,   // SrvUnregisterConsoleIME,
+    // FALSE,   // SrvQueryConsoleIME,
+    FALSE,   // SrvGetConsoleLangId,
+    FALSE,   // SrvAttachConsole,
+    FALSE,   // SrvGetConsoleSelectionInfo,
+    FALSE,   // SrvGetConsoleProcessList,
+
+    FALSE,   // SrvGetConsoleHistory,
+    FALSE,   // SrvSetConsoleHistory
+    // FALSE,   // SrvSetConsoleCurrentFont,
+    // FALSE,   // SrvSetScreenBufferInfo,
+    // FALSE,   // SrvConsoleClientConnect,
+};
+
 /*
  * On Windows Server 2003, CSR Servers contain
  * the API Names Table only in Debug Builds.
@@ -571,6 +673,7 @@ CSR_SERVER_DLL_INIT(ConServerDllInitialization)
     LoadedServerDll->HighestApiSupported = ConsolepMaxApiNumber;
     LoadedServerDll->DispatchTable = ConsoleServerApiDispatchTable;
     LoadedServerDll->ValidTable = ConsoleServerApiServerValidTable;
+    LoadedServerDll->ByReferenceTable = ConsoleServerApiByReferenceTable;
 #ifdef CSR_DBG
     LoadedServerDll->NameTable = ConsoleServerApiNameTable;
 #endif